@@ -38,8 +38,16 @@
 #include "dds_loader.h"
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 
+#if !defined(Platform_Windows_MSVC)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
 #ifdef _DEBUG
 #   define ENABLE_ASSERT
 #   define DEBUG_SELECT(A, B) A
@@ -229,34 +237,31 @@ namespace dds {
 
 
 
-    uint8_t** load(const char* filepath, int32_t* width, int32_t* height, int32_t* mipCount, size_t** sizes, Format* format) {
-        std::ifstream ifs(filepath, std::ios::in | std::ios::binary);
-        if (!ifs.is_open()) {
-            hpprintf("Not found: %s\n", filepath);
-            return nullptr;
-        }
-
-        ifs.seekg(0, std::ios::end);
-        size_t fileSize = ifs.tellg();
-
-        ifs.clear();
-        ifs.seekg(0, std::ios::beg);
-
+    static bool readHeader(const uint8_t* fileData, size_t fileSize, const char* filepath,
+                           int32_t* width, int32_t* height, int32_t* mipCount, Format* format, size_t* headerSize) {
         Header header;
-        ifs.read((char*)&header, sizeof(Header));
+        if (fileSize < sizeof(Header)) {
+            hpprintf("Non dds (dx10) file: %s", filepath);
+            return false;
+        }
+        std::memcpy(&header, fileData, sizeof(Header));
         if (header.m_magic != 0x20534444) {
             hpprintf("Non dds (dx10) file: %s", filepath);
-            return nullptr;
+            return false;
         }
         *width = header.m_width;
         *height = header.m_height;
 
-        size_t headerSize = sizeof(Header);
+        *headerSize = sizeof(Header);
         if (header.m_fourCC == 0x30315844) {
+            if (fileSize < sizeof(Header) + sizeof(HeaderDX10)) {
+                hpprintf("Non dds (dx10) file: %s", filepath);
+                return false;
+            }
             HeaderDX10 dx10Header;
-            ifs.read((char*)&dx10Header, sizeof(HeaderDX10));
+            std::memcpy(&dx10Header, fileData + sizeof(Header), sizeof(HeaderDX10));
             *format = static_cast<Format>(dx10Header.m_format);
-            headerSize += sizeof(HeaderDX10);
+            *headerSize += sizeof(HeaderDX10);
         }
         else {
             const auto makeFourCC = [](uint32_t B0, uint32_t B1, uint32_t B2, uint32_t B3) {
@@ -289,48 +294,179 @@ namespace dds {
             *format != Format::BC6H_UF16 && *format != Format::BC6H_SF16 &&
             *format != Format::BC7_UNorm && *format != Format::BC7_UNorm_sRGB) {
             hpprintf("No support for non block compressed formats: %s", filepath);
-            return nullptr;
+            return false;
         }
 
-        const size_t dataSize = fileSize - headerSize;
-
         *mipCount = 1;
-        if ((header.m_flags & Header::Flags::MipMapCount) != 0)
+        if ((header.m_flags & Header::Flags::MipMapCount) != 0) {
+            // JP: ミップレベル数は1以上、floor(log2(max(w, h))) + 1以下でなければならない。
+            //     範囲外の値はミップレベルの配列やサイズの計算を壊すので不正なファイルとして扱う。
+            // EN: The mip count must be at least 1 and at most floor(log2(max(w, h))) + 1.
+            //     An out-of-range value would break the mip level arrays and the size computation,
+            //     so treat it as a malformed file.
+            uint32_t maxMipCount = 1;
+            for (uint32_t size = std::max(header.m_width, header.m_height); size > 1; size >>= 1)
+                ++maxMipCount;
+            if (header.m_mipmapCount < 1 || header.m_mipmapCount > maxMipCount) {
+                hpprintf("Invalid mip count %u (1-%u): %s", header.m_mipmapCount, maxMipCount, filepath);
+                return false;
+            }
             *mipCount = header.m_mipmapCount;
+        }
 
-        uint8_t* singleData = new uint8_t[dataSize];
-        ifs.read((char*)singleData, dataSize);
+        return true;
+    }
 
-        uint8_t** data = new uint8_t*[*mipCount];
-        *sizes = new size_t[*mipCount];
-        int32_t mipWidth = *width;
-        int32_t mipHeight = *height;
+    // JP: 各ミップレベルのポインターとサイズを設定し、データの合計サイズを返す。
+    // EN: Set the pointer and size of each mip level and return the total data size.
+    static size_t setupMipLevels(uint8_t* singleData, int32_t width, int32_t height, int32_t mipCount, Format format,
+                                 uint8_t** data, size_t* sizes) {
+        int32_t mipWidth = width;
+        int32_t mipHeight = height;
         uint32_t blockSize = 16;
-        if (*format == Format::BC1_UNorm || *format == Format::BC1_UNorm_sRGB ||
-            *format == Format::BC4_UNorm || *format == Format::BC4_SNorm)
+        if (format == Format::BC1_UNorm || format == Format::BC1_UNorm_sRGB ||
+            format == Format::BC4_UNorm || format == Format::BC4_SNorm)
             blockSize = 8;
         size_t accDataSize = 0;
-        for (int i = 0; i < *mipCount; ++i) {
+        for (int i = 0; i < mipCount; ++i) {
             int32_t bw = (mipWidth + 3) / 4;
             int32_t bh = (mipHeight + 3) / 4;
-            size_t mipDataSize = bw * bh * blockSize;
+            size_t mipDataSize = static_cast<size_t>(bw) * bh * blockSize;
 
             data[i] = singleData + accDataSize;
-            (*sizes)[i] = mipDataSize;
+            sizes[i] = mipDataSize;
             accDataSize += mipDataSize;
 
             mipWidth = std::max<int32_t>(1, mipWidth / 2);
             mipHeight = std::max<int32_t>(1, mipHeight / 2);
         }
+
+        return accDataSize;
+    }
+
+    uint8_t** load(const char* filepath, int32_t* width, int32_t* height, int32_t* mipCount, size_t** sizes, Format* format) {
+        std::ifstream ifs(filepath, std::ios::in | std::ios::binary);
+        if (!ifs.is_open()) {
+            hpprintf("Not found: %s\n", filepath);
+            return nullptr;
+        }
+
+        ifs.seekg(0, std::ios::end);
+        size_t fileSize = ifs.tellg();
+
+        ifs.clear();
+        ifs.seekg(0, std::ios::beg);
+
+        uint8_t headerData[sizeof(Header) + sizeof(HeaderDX10)];
+        ifs.read(reinterpret_cast<char*>(headerData), std::min(fileSize, sizeof(headerData)));
+        size_t headerSize;
+        if (!readHeader(headerData, std::min(fileSize, sizeof(headerData)), filepath,
+                        width, height, mipCount, format, &headerSize))
+            return nullptr;
+
+        const size_t dataSize = fileSize - headerSize;
+
+        uint8_t* singleData = new uint8_t[dataSize];
+        ifs.clear();
+        ifs.seekg(headerSize, std::ios::beg);
+        ifs.read((char*)singleData, dataSize);
+
+        uint8_t** data = new uint8_t*[*mipCount];
+        *sizes = new size_t[*mipCount];
+        size_t accDataSize = setupMipLevels(singleData, *width, *height, *mipCount, *format, data, *sizes);
         Assert(accDataSize == dataSize, "Data size mismatch.");
 
         return data;
     }
 
     void free(uint8_t** data, int32_t mipCount, size_t* sizes) {
-        void* singleData = data[0];
+        uint8_t* singleData = data[0];
         delete[] sizes;
         delete[] data;
-        delete singleData;
+        delete[] singleData;
+    }
+
+
+
+    MappedImage* map(const char* filepath) {
+        void* mappedAddress = nullptr;
+        size_t fileSize = 0;
+#if defined(Platform_Windows_MSVC)
+        HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            hpprintf("Not found: %s\n", filepath);
+            return nullptr;
+        }
+        LARGE_INTEGER largeFileSize;
+        if (GetFileSizeEx(file, &largeFileSize) && largeFileSize.QuadPart > 0) {
+            fileSize = static_cast<size_t>(largeFileSize.QuadPart);
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                mappedAddress = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                // JP: ビューが開いている間はマッピングが保たれるのでハンドルはすぐに閉じてよい。
+                // EN: The mapping stays alive while the view is open, so the handle can be closed right away.
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = open(filepath, O_RDONLY);
+        if (fd < 0) {
+            hpprintf("Not found: %s\n", filepath);
+            return nullptr;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+            fileSize = static_cast<size_t>(fileStat.st_size);
+            mappedAddress = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mappedAddress == MAP_FAILED)
+                mappedAddress = nullptr;
+        }
+        close(fd);
+#endif
+        if (mappedAddress == nullptr) {
+            hpprintf("Failed to map: %s\n", filepath);
+            return nullptr;
+        }
+
+        MappedImage* image = new MappedImage();
+        image->mappedAddress = mappedAddress;
+        image->mappedSize = fileSize;
+        image->data = nullptr;
+        image->sizes = nullptr;
+
+        uint8_t* fileData = static_cast<uint8_t*>(mappedAddress);
+        size_t headerSize;
+        if (!readHeader(fileData, fileSize, filepath,
+                        &image->width, &image->height, &image->mipCount, &image->format, &headerSize)) {
+            unmap(image);
+            return nullptr;
+        }
+
+        image->data = new uint8_t*[image->mipCount];
+        image->sizes = new size_t[image->mipCount];
+        size_t accDataSize = setupMipLevels(fileData + headerSize, image->width, image->height, image->mipCount,
+                                            image->format, image->data, image->sizes);
+        // JP: 切り詰められたファイルの範囲外に触れるとアクセス違反になるので読み込み時より厳しく検証する。
+        // EN: Touching beyond a truncated file causes an access violation, so validate more strictly than on load.
+        if (accDataSize > fileSize - headerSize) {
+            hpprintf("Data size mismatch: %s\n", filepath);
+            unmap(image);
+            return nullptr;
+        }
+
+        return image;
+    }
+
+    void unmap(MappedImage* image) {
+#if defined(Platform_Windows_MSVC)
+        UnmapViewOfFile(image->mappedAddress);
+#else
+        munmap(image->mappedAddress, image->mappedSize);
+#endif
+        delete[] image->sizes;
+        delete[] image->data;
+        delete image;
     }
 }
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 // For DDS image read (block compressed format)
 namespace dds {
@@ -42,4 +43,23 @@ namespace dds {
     [[nodiscard]]
     uint8_t** load(const char* filepath, int32_t* width, int32_t* height, int32_t* mipCount, size_t** sizes, Format* format);
     void free(uint8_t** data, int32_t mipCount, size_t* sizes);
+
+    // JP: ファイルを読み込まずにメモリにマップする。各ミップレベルのポインターはマップした領域を直接指す(読み取り専用)。
+    //     実際の読み込みはページに触れた時にOSが行うので、使わないミップレベルはメモリを消費しない。
+    // EN: Map the file into memory instead of reading it. The pointer of each mip level points directly into the mapped region (read-only).
+    //     The OS actually reads pages when they are touched, so unused mip levels don't consume memory.
+    struct MappedImage {
+        int32_t width;
+        int32_t height;
+        int32_t mipCount;
+        Format format;
+        uint8_t** data;
+        size_t* sizes;
+        void* mappedAddress;
+        size_t mappedSize;
+    };
+
+    [[nodiscard]]
+    MappedImage* map(const char* filepath);
+    void unmap(MappedImage* image);
 }
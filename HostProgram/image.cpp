@@ -12,44 +12,76 @@
 #include <ImfArray.h>
 
 #include "dds_loader.h"
+#include "texture_cache.h"
 
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 
-static std::map<std::tuple<std::string, std::string, std::string>, vlr::Image2DRef> s_image2DCache;
 
-// TODO: Should colorSpace be determined from the read image?
-vlr::Image2DRef loadImage2D(const vlr::ContextRef &context, const std::string &filepath, const std::string &spectrumType, const std::string &colorSpace) {
-    using namespace vlr;
+using ImageKey = std::tuple<std::string, std::string, std::string>;
 
-    Image2DRef ret;
+// JP: 作成済みの画像と、先行してデコードしたがまだImage2Dにしていない画像。どちらもs_imageCacheMutexで保護する。
+// EN: Created images and images decoded ahead but not yet turned into Image2D. Both are guarded by s_imageCacheMutex.
+static std::mutex s_imageCacheMutex;
+static std::map<ImageKey, vlr::Image2DRef> s_image2DCache;
+static std::map<ImageKey, DecodedImage> s_preloadedImages;
 
+static ImageKey makeImageKey(const std::string &filepath, const std::string &spectrumType, const std::string &colorSpace) {
     const auto tolower = [](std::string str) {
         const auto tolower = [](unsigned char c) { return std::tolower(c); };
         std::transform(str.cbegin(), str.cend(), str.begin(), tolower);
         return str;
     };
+    return std::make_tuple(filepath, tolower(spectrumType), tolower(colorSpace));
+}
 
-    auto key = std::make_tuple(filepath, tolower(spectrumType), tolower(colorSpace));
-    if (s_image2DCache.count(key))
-        return s_image2DCache.at(key);
 
-    hpprintf("Read image: %s...", filepath.c_str());
+
+// JP: 有効にすると非圧縮のRGB(A)テクスチャーをロード時にBC7(LDR)/BC6H(HDR)にエンコードする。
+// EN: Enable to encode uncompressed RGB(A) textures into BC7 (LDR) / BC6H (HDR) on load.
+//#define COMPRESS_TEXTURES_ON_LOAD
+
+//#define OVERRIDE_BY_DDS
+
+static uint32_t s_numDDSMipTailLevels = 0;
+
+// JP: フル解像度に差し替える前のミップテールだけで作ったDDS画像。
+// EN: DDS images created from only the mip tail before being replaced with the full resolution.
+struct StreamingImage {
+    std::string filepath;
+    vlr::BlockCompressedImage2DRef image;
+    std::shared_ptr<dds::MappedImage> mapping;
+};
+static std::vector<StreamingImage> s_streamingImages;
+
+// JP: 各画像がマッピングへの参照を1つずつ持ち、最後の参照が解放された時にアンマップされる。
+// EN: Each image holds a reference to the mapping, and it is unmapped when the last reference is released.
+static void releaseDDSMapping(void* userData) {
+    delete static_cast<std::shared_ptr<dds::MappedImage>*>(userData);
+}
+
+// JP: ファイルを読んでデコードする。libVLRのオブジェクトは作らないので複数のスレッドから呼べる。
+// EN: Read and decode a file. Doesn't create libVLR objects, so it can be called from multiple threads.
+static DecodedImage decodeImage2D(const vlr::ContextRef &context, const std::string &filepath,
+                                  const std::string &spectrumType, const std::string &colorSpace,
+                                  bool useTextureCache) {
+    DecodedImage ret;
 
     bool fileExists = false;
     {
         std::ifstream ifs(filepath);
         fileExists = ifs.is_open();
     }
-    if (!fileExists) {
-        hpprintf("Not found.\n");
+    if (!fileExists)
         return ret;
-    }
 
     std::string ext = filepath.substr(filepath.find_last_of('.') + 1);
     std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
 
-    //#define OVERRIDE_BY_DDS
-
 #if defined(OVERRIDE_BY_DDS)
     std::string ddsFilepath = filepath;
     ddsFilepath = filepath.substr(0, filepath.find_last_of('.'));
@@ -61,6 +93,20 @@ vlr::Image2DRef loadImage2D(const vlr::ContextRef &context, const std::string &f
     }
 #endif
 
+    // JP: DDS以外は変換済みテクスチャーのキャッシュを先に参照してデコードと変換を省く。
+    //     ロード時にエンコードする場合はキャッシュしない。
+    // EN: For non-DDS files, consult the cache of converted textures first to skip decoding and conversion.
+    //     Nothing is cached when encoding on load.
+#if !defined(COMPRESS_TEXTURES_ON_LOAD)
+    std::string textureCacheKey;
+    if (textureCacheEnabled() && ext != "dds" &&
+        computeTextureCacheKey(context, filepath, spectrumType, colorSpace, &textureCacheKey)) {
+        if (useTextureCache && readCachedTexture(textureCacheKey, &ret))
+            return ret;
+        ret.textureCacheKey = textureCacheKey;
+    }
+#endif
+
     if (ext == "exr") {
         using namespace Imf;
         using namespace Imath;
@@ -70,40 +116,40 @@ vlr::Image2DRef loadImage2D(const vlr::ContextRef &context, const std::string &f
         Box2i dw = file.dataWindow();
         long width = dw.max.x - dw.min.x + 1;
         long height = dw.max.y - dw.min.y + 1;
-        Array2D<Rgba> pixels{ height, width };
-        pixels.resizeErase(height, width);
-        file.setFrameBuffer(&pixels[0][0] - dw.min.x - dw.min.y * width, 1, width);
+        // JP: 中間バッファーを介さず渡すバッファーに直接読み込む。
+        // EN: Read directly into the buffer to be handed over without an intermediate buffer.
+        Rgba* linearImageData = new Rgba[width * height];
+        file.setFrameBuffer(linearImageData - dw.min.x - dw.min.y * width, 1, width);
         file.readPixels(dw.min.y, dw.max.y);
 
-        Rgba* linearImageData = new Rgba[width * height];
-        Rgba* curDataHead = linearImageData;
-        for (int i = 0; i < height; ++i) {
-            std::copy_n(pixels[i], width, reinterpret_cast<Rgba*>(curDataHead));
-            for (int j = 0; j < width; ++j) {
-                Rgba &pix = curDataHead[j];
-                pix.r = pix.r >= 0.0f ? pix.r : (half)0.0f;
-                pix.g = pix.g >= 0.0f ? pix.g : (half)0.0f;
-                pix.b = pix.b >= 0.0f ? pix.b : (half)0.0f;
-                pix.a = pix.a >= 0.0f ? pix.a : (half)0.0f;
-            }
-            curDataHead += width;
+        for (long i = 0; i < width * height; ++i) {
+            Rgba &pix = linearImageData[i];
+            pix.r = pix.r >= 0.0f ? pix.r : (half)0.0f;
+            pix.g = pix.g >= 0.0f ? pix.g : (half)0.0f;
+            pix.b = pix.b >= 0.0f ? pix.b : (half)0.0f;
+            pix.a = pix.a >= 0.0f ? pix.a : (half)0.0f;
         }
 
-        ret = context->createLinearImage2D(
-            reinterpret_cast<uint8_t*>(linearImageData), width, height, "RGBA16Fx4",
-            spectrumType.c_str(), colorSpace.c_str());
-
-        delete[] linearImageData;
+        ret.kind = DecodedImage::Kind::Linear;
+        ret.width = width;
+        ret.height = height;
+        ret.format = "RGBA16Fx4";
+        ret.levels.push_back(reinterpret_cast<uint8_t*>(linearImageData));
+        ret.sizes.push_back(sizeof(Rgba) * width * height);
+        ret.release = [](void* userData) { delete[] static_cast<Rgba*>(userData); };
+        ret.userData = linearImageData;
     }
     else if (ext == "dds") {
-        int32_t width, height, mipCount;
-        size_t* sizes;
-        dds::Format format;
+        // JP: ファイルをマップし、各ミップレベルはマップした領域を直接指したままlibVLRに渡す。
+        // EN: Map the file and hand each mip level over to libVLR pointing directly into the mapped region.
 #if defined(OVERRIDE_BY_DDS)
-        uint8_t** data = dds::load(ddsFilepath.c_str(), &width, &height, &mipCount, &sizes, &format);
+        dds::MappedImage* mappedImage = dds::map(ddsFilepath.c_str());
 #else
-        uint8_t** data = dds::load(filepath.c_str(), &width, &height, &mipCount, &sizes, &format);
+        dds::MappedImage* mappedImage = dds::map(filepath.c_str());
 #endif
+        if (mappedImage == nullptr)
+            return ret;
+        std::shared_ptr<dds::MappedImage> mapping(mappedImage, dds::unmap);
 
         const auto translate = [](dds::Format ddsFormat, const char** vlrFormat, bool* needsDegamma) {
             *needsDegamma = false;
@@ -161,38 +207,276 @@ vlr::Image2DRef loadImage2D(const vlr::ContextRef &context, const std::string &f
 
         const char* vlrFormat;
         bool needsDegamma;
-        translate(format, &vlrFormat, &needsDegamma);
-
-        ret = context->createBlockCompressedImage2D(
-            data, sizes, mipCount, width, height, vlrFormat,
-            spectrumType.c_str(), colorSpace.c_str());
-        Assert(ret, "failed to load a block compressed texture.");
+        translate(mapping->format, &vlrFormat, &needsDegamma);
+
+        // JP: ミップテールのストリーミングが有効なら最小のs_numDDSMipTailLevels個のレベルだけで先に作る。
+        //     ミップテールの最上位レベルもブロック境界に揃う必要がある。
+        // EN: When mip tail streaming is enabled, create the image from only the smallest s_numDDSMipTailLevels levels first.
+        //     The top level of the mip tail also needs to be aligned to the block boundary.
+        int32_t firstLevel = 0;
+        if (s_numDDSMipTailLevels > 0 && mapping->mipCount > static_cast<int32_t>(s_numDDSMipTailLevels)) {
+            firstLevel = mapping->mipCount - s_numDDSMipTailLevels;
+            while (firstLevel > 0 &&
+                   ((mapping->width >> firstLevel) % 4 != 0 || (mapping->height >> firstLevel) % 4 != 0))
+                --firstLevel;
+        }
 
-        dds::free(data, mipCount, sizes);
+        ret.kind = DecodedImage::Kind::BlockCompressed;
+        ret.width = std::max<uint32_t>(mapping->width >> firstLevel, 1);
+        ret.height = std::max<uint32_t>(mapping->height >> firstLevel, 1);
+        ret.format = vlrFormat;
+        ret.levels.assign(mapping->data + firstLevel, mapping->data + mapping->mipCount);
+        ret.sizes.assign(mapping->sizes + firstLevel, mapping->sizes + mapping->mipCount);
+        ret.release = releaseDDSMapping;
+        ret.userData = new std::shared_ptr<dds::MappedImage>(mapping);
+        if (firstLevel > 0)
+            ret.fullResolutionSource = mapping;
     }
     else {
         int32_t width, height, n;
         uint8_t* linearImageData = stbi_load(filepath.c_str(), &width, &height, &n, 0);
+        if (linearImageData == nullptr)
+            return ret;
+
+        ret.release = [](void* userData) { stbi_image_free(userData); };
+        ret.userData = linearImageData;
         if (n == 4)
-            ret = context->createLinearImage2D(linearImageData, width, height, "RGBA8x4", spectrumType.c_str(), colorSpace.c_str());
+            ret.format = "RGBA8x4";
         else if (n == 3)
-            ret = context->createLinearImage2D(linearImageData, width, height, "RGB8x3", spectrumType.c_str(), colorSpace.c_str());
+            ret.format = "RGB8x3";
         else if (n == 2)
-            ret = context->createLinearImage2D(linearImageData, width, height, "GrayA8x2", spectrumType.c_str(), colorSpace.c_str());
+            ret.format = "GrayA8x2";
         else if (n == 1)
-            ret = context->createLinearImage2D(linearImageData, width, height, "Gray8", spectrumType.c_str(), colorSpace.c_str());
-        else
+            ret.format = "Gray8";
+        else {
             Assert_ShouldNotBeCalled();
-        stbi_image_free(linearImageData);
+            ret.reset();
+            return ret;
+        }
+        ret.kind = DecodedImage::Kind::Linear;
+        ret.width = width;
+        ret.height = height;
+        ret.levels.push_back(linearImageData);
+        ret.sizes.push_back(static_cast<size_t>(n) * width * height);
     }
 
-    hpprintf("done.\n");
+    return ret;
+}
+
+// JP: デコード済みのデータからImage2Dを作る。デコードしたバッファーの所有権をlibVLRに渡してコピーを避ける。
+// EN: Create an Image2D from decoded data. Transfer ownership of decoded buffers to libVLR to avoid copies.
+static vlr::Image2DRef createImage2D(const vlr::ContextRef &context, const std::string &filepath, DecodedImage &&image,
+                                     const std::string &spectrumType, const std::string &colorSpace) {
+    using namespace vlr;
+
+    Image2DRef ret;
+    VLRImageDataReleaseFunction release = image.release;
+    void* userData = image.userData;
+
+    switch (image.kind) {
+    case DecodedImage::Kind::Converted: {
+        // JP: 以降はエラーの場合もlibVLRがバッファーを解放する。
+        // EN: From here on, libVLR releases the buffer even on error.
+        image.handOver();
+        try {
+            ret = context->createLinearImage2DFromConvertedData(
+                image.levels.data(), image.sizes.data(), static_cast<uint32_t>(image.levels.size()),
+                image.width, image.height,
+                image.originalFormat.c_str(), image.format.c_str(), spectrumType.c_str(), colorSpace.c_str(),
+                release, userData);
+        }
+        catch (const std::exception &) {
+            hpprintf("Ignored an invalid texture cache %s.\n", image.textureCacheKey.c_str());
+        }
+        break;
+    }
+    case DecodedImage::Kind::Linear: {
+#if defined(COMPRESS_TEXTURES_ON_LOAD)
+        if (image.format != "GrayA8x2" && image.format != "Gray8") {
+            ret = context->createBlockCompressedImage2DFromLinearData(
+                image.levels[0], image.width, image.height, image.format.c_str(),
+                spectrumType.c_str(), colorSpace.c_str(), true, "Normal");
+            image.reset();
+            break;
+        }
+#endif
+        image.handOver();
+        ret = context->createLinearImage2DFromOwnedData(
+            image.levels[0], image.width, image.height, image.format.c_str(),
+            spectrumType.c_str(), colorSpace.c_str(), false,
+            release, userData);
+
+        if (!image.textureCacheKey.empty()) {
+            if (auto linearImage = std::dynamic_pointer_cast<LinearImage2DHolder>(ret))
+                storeCachedTexture(image.textureCacheKey, linearImage);
+        }
+        break;
+    }
+    case DecodedImage::Kind::BlockCompressed: {
+        image.handOver();
+        ret = context->createBlockCompressedImage2DFromOwnedData(
+            image.levels.data(), image.sizes.data(), static_cast<uint32_t>(image.levels.size()),
+            image.width, image.height, image.format.c_str(),
+            spectrumType.c_str(), colorSpace.c_str(),
+            release, userData);
+        Assert(ret, "failed to load a block compressed texture.");
 
-    s_image2DCache[key] = ret;
+        if (image.fullResolutionSource) {
+            s_streamingImages.push_back(StreamingImage{
+                filepath, std::dynamic_pointer_cast<BlockCompressedImage2DHolder>(ret), image.fullResolutionSource });
+        }
+        break;
+    }
+    default:
+        break;
+    }
 
     return ret;
 }
 
+// TODO: Should colorSpace be determined from the read image?
+vlr::Image2DRef loadImage2D(const vlr::ContextRef &context, const std::string &filepath, const std::string &spectrumType, const std::string &colorSpace) {
+    using namespace vlr;
+
+    ImageKey key = makeImageKey(filepath, spectrumType, colorSpace);
+    DecodedImage decodedImage;
+    {
+        std::lock_guard<std::mutex> lock(s_imageCacheMutex);
+        if (s_image2DCache.count(key))
+            return s_image2DCache.at(key);
+        auto it = s_preloadedImages.find(key);
+        if (it != s_preloadedImages.end()) {
+            decodedImage = std::move(it->second);
+            s_preloadedImages.erase(it);
+        }
+    }
+
+    hpprintf("Read image: %s...", filepath.c_str());
+
+    bool preloaded = decodedImage.kind != DecodedImage::Kind::Invalid;
+    if (!preloaded)
+        decodedImage = decodeImage2D(context, filepath, spectrumType, colorSpace, true);
+    if (decodedImage.kind == DecodedImage::Kind::Invalid) {
+        hpprintf("Not found.\n");
+        return nullptr;
+    }
+
+    bool cached = decodedImage.kind == DecodedImage::Kind::Converted;
+    bool fromLinearData = decodedImage.kind == DecodedImage::Kind::Linear;
+    Image2DRef ret = createImage2D(context, filepath, std::move(decodedImage), spectrumType, colorSpace);
+    if (!ret && cached) {
+        // JP: キャッシュが不正だった場合は元のファイルから読み直す。
+        // EN: Read the original file again when the cache was invalid.
+        cached = false;
+        ret = createImage2D(context, filepath, decodeImage2D(context, filepath, spectrumType, colorSpace, false),
+                            spectrumType, colorSpace);
+    }
+
+    auto encodedImage = std::dynamic_pointer_cast<BlockCompressedImage2DHolder>(ret);
+    if (encodedImage && fromLinearData) {
+        float psnr, encodingTime;
+        encodedImage->getEncodingStatistics(&psnr, &encodingTime);
+        hpprintf("done (encoded, PSNR %.2f [dB], %.3f [ms]).\n", psnr, encodingTime);
+    }
+    else {
+        hpprintf("done%s.\n", cached ? " (cached)" : preloaded ? " (preloaded)" : "");
+    }
+
+    std::lock_guard<std::mutex> lock(s_imageCacheMutex);
+    auto it = s_image2DCache.emplace(key, ret).first;
+    return it->second;
+}
+
+void preloadImage2Ds(const vlr::ContextRef &context, const std::vector<ImageLoadRequest> &requests) {
+    // JP: 作成済みか既に先行デコード済みのものと重複を除く。
+    // EN: Exclude ones already created or decoded ahead, and duplicates.
+    std::vector<const ImageLoadRequest*> pendingRequests;
+    std::set<ImageKey> pendingKeys;
+    {
+        std::lock_guard<std::mutex> lock(s_imageCacheMutex);
+        for (const ImageLoadRequest &request : requests) {
+            ImageKey key = makeImageKey(request.filepath, request.spectrumType, request.colorSpace);
+            if (s_image2DCache.count(key) || s_preloadedImages.count(key) || pendingKeys.count(key))
+                continue;
+            pendingKeys.insert(key);
+            pendingRequests.push_back(&request);
+        }
+    }
+    if (pendingRequests.empty())
+        return;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    uint32_t numThreads = std::max(std::min<uint32_t>(std::thread::hardware_concurrency(),
+                                                      static_cast<uint32_t>(pendingRequests.size())), 1u);
+    std::atomic<uint32_t> nextIndex = 0;
+    const auto decodeTask = [&]() {
+        while (true) {
+            uint32_t index = nextIndex++;
+            if (index >= pendingRequests.size())
+                break;
+            const ImageLoadRequest &request = *pendingRequests[index];
+            DecodedImage image = decodeImage2D(context, request.filepath, request.spectrumType, request.colorSpace, true);
+            if (image.kind == DecodedImage::Kind::Invalid)
+                continue;
+
+            std::lock_guard<std::mutex> lock(s_imageCacheMutex);
+            s_preloadedImages[makeImageKey(request.filepath, request.spectrumType, request.colorSpace)] = std::move(image);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < numThreads; ++i)
+        threads.emplace_back(decodeTask);
+    decodeTask();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    hpprintf("Decoded %u images: %.3f [ms] (%u threads)\n",
+             static_cast<uint32_t>(pendingRequests.size()),
+             std::chrono::duration<double, std::milli>(endTime - startTime).count(), numThreads);
+}
+
+void discardPreloadedImage2Ds() {
+    std::lock_guard<std::mutex> lock(s_imageCacheMutex);
+    s_preloadedImages.clear();
+}
+
+void setDDSMipTailStreaming(uint32_t numLevels) {
+    s_numDDSMipTailLevels = numLevels;
+}
+
+uint32_t streamFullResolutionImage2Ds(uint32_t maxNumImages) {
+    uint32_t numImages = 0;
+    while (numImages < maxNumImages && !s_streamingImages.empty()) {
+        StreamingImage streamingImage = std::move(s_streamingImages.back());
+        s_streamingImages.pop_back();
+
+        const std::shared_ptr<dds::MappedImage> &mapping = streamingImage.mapping;
+        // JP: 環境テクスチャーとして使われている画像は差し替えが拒否される。
+        //     検証で拒否された場合は所有権が移っていないので、ここでマッピングを解放してミップテールのまま使う。
+        // EN: Replacement is rejected for an image used as an environment texture.
+        //     Ownership hasn't been transferred when rejected by validation,
+        //     so release the mapping here and keep using the mip tail.
+        auto userData = new std::shared_ptr<dds::MappedImage>(mapping);
+        VLRResult result = vlrBlockCompressedImage2DReplaceWithOwnedData(
+            streamingImage.image->getRaw<VLRBlockCompressedImage2D>(),
+            mapping->data, mapping->sizes, mapping->mipCount, mapping->width, mapping->height,
+            releaseDDSMapping, userData);
+        if (result != VLRResult_NoError) {
+            if (result == VLRResult_InvalidArgument)
+                releaseDDSMapping(userData);
+            hpprintf("Kept the mip tail: %s (%s)\n", streamingImage.filepath.c_str(), vlrGetErrorMessage(result));
+            continue;
+        }
+        hpprintf("Streamed full resolution: %s (%ux%u)\n",
+                 streamingImage.filepath.c_str(), mapping->width, mapping->height);
+        ++numImages;
+    }
+
+    return numImages;
+}
+
 void writePNG(const std::filesystem::path &filePath, uint32_t width, uint32_t height, const uint32_t* data) {
     stbi_write_png(filePath.string().c_str(), width, height, 4, data, width * 4);
 }
@@ -3,7 +3,112 @@
 #include "common.h"
 #include <VLR/vlrcpp.h>
 
+namespace dds {
+    struct MappedImage;
+}
+
+// JP: ファイルからデコードしたがまだImage2Dにしていない画像。デコードしたバッファーを所有する。
+// EN: An image decoded from a file but not yet turned into Image2D. Owns the decoded buffers.
+struct DecodedImage {
+    enum class Kind {
+        Invalid = 0,
+        Linear,
+        BlockCompressed,
+        Converted, // JP: 変換済みテクスチャーのキャッシュから読んだもの。 EN: Read from the cache of converted textures.
+    };
+
+    Kind kind;
+    uint32_t width;
+    uint32_t height;
+    std::string format;
+    std::string originalFormat;
+    std::vector<uint8_t*> levels;
+    std::vector<size_t> sizes;
+    VLRImageDataReleaseFunction release;
+    void* userData;
+    // JP: 空でなければImage2Dを作った後にこのキーで変換済みテクスチャーのキャッシュに書き込む。
+    // EN: When not empty, the image is written into the cache of converted textures with this key after creating Image2D.
+    std::string textureCacheKey;
+    // JP: 空でなければlevelsはミップテールだけで、後からこのファイルのフル解像度に差し替える。
+    // EN: When not empty, levels contain only the mip tail and the image is replaced later with the full resolution of this file.
+    std::shared_ptr<dds::MappedImage> fullResolutionSource;
+
+    DecodedImage() :
+        kind(Kind::Invalid), width(0), height(0), release(nullptr), userData(nullptr) {}
+    DecodedImage(DecodedImage &&v) :
+        kind(v.kind), width(v.width), height(v.height),
+        format(std::move(v.format)), originalFormat(std::move(v.originalFormat)),
+        levels(std::move(v.levels)), sizes(std::move(v.sizes)),
+        release(v.release), userData(v.userData),
+        textureCacheKey(std::move(v.textureCacheKey)),
+        fullResolutionSource(std::move(v.fullResolutionSource)) {
+        v.handOver();
+        v.kind = Kind::Invalid;
+    }
+    ~DecodedImage() {
+        reset();
+    }
+    DecodedImage &operator=(DecodedImage &&v) {
+        if (this != &v) {
+            reset();
+            kind = v.kind;
+            width = v.width;
+            height = v.height;
+            format = std::move(v.format);
+            originalFormat = std::move(v.originalFormat);
+            levels = std::move(v.levels);
+            sizes = std::move(v.sizes);
+            release = v.release;
+            userData = v.userData;
+            textureCacheKey = std::move(v.textureCacheKey);
+            fullResolutionSource = std::move(v.fullResolutionSource);
+            v.handOver();
+            v.kind = Kind::Invalid;
+        }
+        return *this;
+    }
+    DecodedImage(const DecodedImage &) = delete;
+    DecodedImage &operator=(const DecodedImage &) = delete;
+
+    // JP: バッファーを解放する。
+    // EN: Release the buffers.
+    void reset() {
+        if (release)
+            release(userData);
+        handOver();
+    }
+
+    // JP: バッファーの所有権を手放す。以降は解放関数を受け取った側が解放する。
+    // EN: Give up ownership of the buffers. The receiver of the release function frees them afterwards.
+    void handOver() {
+        release = nullptr;
+        userData = nullptr;
+    }
+};
+
+struct ImageLoadRequest {
+    std::string filepath;
+    std::string spectrumType;
+    std::string colorSpace;
+};
+
 vlr::Image2DRef loadImage2D(const vlr::ContextRef &context, const std::string &filepath, const std::string &spectrumType, const std::string &colorSpace);
 
+// JP: 複数の画像を複数のスレッドで先行してデコードしておく。Image2Dの作成は後のloadImage2D()でメインスレッドが行う。
+// EN: Decode multiple images ahead on multiple threads. Image2D creation is done later by loadImage2D() on the main thread.
+void preloadImage2Ds(const vlr::ContextRef &context, const std::vector<ImageLoadRequest> &requests);
+// JP: loadImage2D()で使われなかった先行デコード済みの画像を解放する。
+// EN: Free images decoded ahead that weren't consumed by loadImage2D().
+void discardPreloadedImage2Ds();
+
+// JP: 0より大きい場合、それより多くのミップレベルを持つDDSは最小のnumLevels個のミップレベルだけで先に作る。
+//     フル解像度はstreamFullResolutionImage2Ds()で後から差し替える。
+// EN: When greater than 0, DDS with more mip levels are created from only the smallest numLevels mip levels first.
+//     The full resolution is swapped in later by streamFullResolutionImage2Ds().
+void setDDSMipTailStreaming(uint32_t numLevels);
+// JP: 最大maxNumImages個の画像をフル解像度に差し替え、差し替えた数を返す。
+// EN: Replace up to maxNumImages images with the full resolution and return the number replaced.
+uint32_t streamFullResolutionImage2Ds(uint32_t maxNumImages);
+
 void writePNG(const std::filesystem::path &filePath, uint32_t width, uint32_t height, const uint32_t* data);
 void writeEXR(const std::filesystem::path &filePath, uint32_t width, uint32_t height, const float* data);
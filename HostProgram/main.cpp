@@ -9,6 +9,9 @@
 #include "GLFW/glfw3.h"
 
 #include "scene.h"
+#include "texture_cache.h"
+#include "mesh_optimizer.h"
+#include "scene_cache.h"
 
 #include "../libVLR/utils/cuda_util.h"
 #include "StopWatch.h"
@@ -1170,6 +1173,11 @@ public:
                 m_sceneChanged = false;
                 showSceneWindow();
 
+                // JP: ミップテールだけで作ったテクスチャーを1フレームに1枚ずつフル解像度に差し替える。
+                // EN: Replace textures created from only the mip tail with the full resolution, one per frame.
+                if (streamFullResolutionImage2Ds(1) > 0)
+                    m_sceneChanged = true;
+
                 if (m_cameraTypeIndex == 0) {
                     m_perspectiveCamera->set("position", m_cameraPosition);
                     m_perspectiveCamera->set("orientation", m_tempCameraOrientation);
@@ -1284,6 +1292,20 @@ public:
 
 
 
+// JP: コマンドラインで指定された列挙子がライブラリに存在するかを調べる。
+// EN: Check if an enum member given on the command line exists in the library.
+static bool isValidEnumMember(const char* typeName, const char* member) {
+    uint32_t numMembers = 0;
+    if (member == nullptr || vlrGetNumEnumMembers(typeName, &numMembers) != VLRResult_NoError)
+        return false;
+    for (uint32_t i = 0; i < numMembers; ++i) {
+        const char* value = nullptr;
+        if (vlrGetEnumMember(typeName, i, &value) == VLRResult_NoError && strcmp(value, member) == 0)
+            return true;
+    }
+    return false;
+}
+
 static int32_t mainFunc(int32_t argc, const char* argv[]) {
     StopWatch swGlobal;
 
@@ -1296,6 +1318,7 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
     uint32_t renderImageSizeX = 1920;
     uint32_t renderImageSizeY = 1080;
     uint32_t maxCallableDepth = 8;
+    const char* imageResidencyPolicy = nullptr;
 
     for (int i = 1; i < argc; ++i) {
         if (strncmp(argv[i], "--", 2) == 0) {
@@ -1316,6 +1339,37 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
                 if (strncmp(argv[i], "--", 2) != 0)
                     maxCallableDepth = atoi(argv[i]);
             }
+            else if (strcmp(argv[i] + 2, "imageresidency") == 0) { // Keep, DropAfterUpload or SpillToDisk
+                ++i;
+                imageResidencyPolicy = i < argc ? argv[i] : nullptr;
+                if (!isValidEnumMember("ImageResidencyPolicy", imageResidencyPolicy)) {
+                    hpprintf("Invalid image residency policy: %s (Keep, DropAfterUpload or SpillToDisk)\n",
+                             imageResidencyPolicy ? imageResidencyPolicy : "(none)");
+                    return -1;
+                }
+            }
+            else if (strcmp(argv[i] + 2, "texturecache") == 0) {
+                ++i;
+                setTextureCacheDirectory(argv[i]);
+            }
+            else if (strcmp(argv[i] + 2, "scenecache") == 0) {
+                ++i;
+                setSceneCacheDirectory(argv[i]);
+            }
+            else if (strcmp(argv[i] + 2, "optimizemeshes") == 0) {
+                setMeshOptimizationEnabled(true);
+            }
+            else if (strcmp(argv[i] + 2, "compactvertices") == 0) {
+                setCompactVertexFormat(true);
+            }
+            else if (strcmp(argv[i] + 2, "instancemeshes") == 0) { // exact or translation
+                ++i;
+                setMeshInstancing(true, strcmp(argv[i], "translation") == 0);
+            }
+            else if (strcmp(argv[i] + 2, "ddsmiptail") == 0) { // number of smallest mip levels loaded first
+                ++i;
+                setDDSMipTailStreaming(atoi(argv[i]));
+            }
         }
     }
 
@@ -1329,10 +1383,30 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
     vlr::ContextRef context = vlr::Context::create(cuContext, enableLogging, maxCallableDepth);
 
     context->enableAllExceptions();
+    if (imageResidencyPolicy)
+        context->setDefaultImageResidencyPolicy(imageResidencyPolicy);
 
     Shot shot;
     createScene(context, &shot);
 
+    {
+        uint32_t numImages, numReleasedImages;
+        size_t hostResidentSize, spilledSize, deviceSize;
+        context->getImageMemoryReport(&numImages, &numReleasedImages, &hostResidentSize, &spilledSize, &deviceSize);
+        hpprintf("Images: %u (%u released), host %.2f [MB], spilled %.2f [MB], device %.2f [MB]\n",
+                 numImages, numReleasedImages,
+                 hostResidentSize / (1024.0 * 1024.0), spilledSize / (1024.0 * 1024.0), deviceSize / (1024.0 * 1024.0));
+    }
+    {
+        uint32_t numMeshes, numCompactMeshes, numVertices;
+        size_t fullFormatSize, compactFormatSize;
+        context->getVertexMemoryReport(&numMeshes, &numCompactMeshes, &numVertices, &fullFormatSize, &compactFormatSize);
+        hpprintf("Vertices: %u in %u meshes (%u compact), Full %.2f [MB], Compact %.2f [MB] (%.1f%%)\n",
+                 numVertices, numMeshes, numCompactMeshes,
+                 fullFormatSize / (1024.0 * 1024.0), compactFormatSize / (1024.0 * 1024.0),
+                 100.0 * compactFormatSize / std::max<size_t>(fullFormatSize, 1));
+    }
+
     if (enableGUI) {
         glfwSetErrorCallback(glfw_error_callback);
         if (!glfwInit()) {
@@ -1359,6 +1433,10 @@ static int32_t mainFunc(int32_t argc, const char* argv[]) {
 
         context->bindOutputBuffer(renderTargetSizeX, renderTargetSizeY, 0);
 
+        // JP: 途中で画像が変わると蓄積をやり直すことになるので、描画前に全てフル解像度にする。
+        // EN: Changing images midway would restart accumulation, so bring everything to the full resolution before rendering.
+        streamFullResolutionImage2Ds(UINT32_MAX);
+
         hpprintf("Setup: %g[s]\n", swGlobal.elapsed(StopWatch::Milliseconds) * 1e-3f);
         swGlobal.start();
 
@@ -0,0 +1,63 @@
+#include "mapped_file.h"
+
+#if !defined(HP_Platform_Windows_MSVC)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+#if defined(HP_Platform_Windows_MSVC)
+    m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr),
+#endif
+    m_data(nullptr), m_size(0) {}
+
+MappedFile::~MappedFile() {
+#if defined(HP_Platform_Windows_MSVC)
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+#else
+    if (m_data)
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+}
+
+bool MappedFile::open(const std::filesystem::path &path) {
+#if defined(HP_Platform_Windows_MSVC)
+    m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+        return false;
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping)
+        return false;
+    m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data)
+        return false;
+    m_size = static_cast<uint64_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    m_data = static_cast<const uint8_t*>(data);
+    m_size = static_cast<uint64_t>(st.st_size);
+#endif
+    return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common.h"
+
+// JP: ファイル全体を読み取り専用でメモリにマップする。
+// EN: Maps a whole file into memory as read-only.
+class MappedFile {
+#if defined(HP_Platform_Windows_MSVC)
+    HANDLE m_file;
+    HANDLE m_mapping;
+#endif
+    const uint8_t* m_data;
+    uint64_t m_size;
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const std::filesystem::path &path);
+
+    const uint8_t* data() const {
+        return m_data;
+    }
+    uint64_t size() const {
+        return m_size;
+    }
+};
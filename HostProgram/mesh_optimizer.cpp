@@ -0,0 +1,189 @@
+#include "mesh_optimizer.h"
+
+#include "StopWatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+static bool s_meshOptimizationEnabled = false;
+
+void setMeshOptimizationEnabled(bool enable) {
+    s_meshOptimizationEnabled = enable;
+}
+
+bool meshOptimizationEnabled() {
+    return s_meshOptimizationEnabled;
+}
+
+
+
+float computeACMR(const uint32_t* indices, uint32_t numIndices, uint32_t numVertices, uint32_t cacheSize) {
+    if (numIndices < 3)
+        return 0.0f;
+
+    // JP: 各頂点がキャッシュに入った時点のミス回数を覚えておけば、FIFOに残っているかは差で分かる。
+    // EN: Remembering the miss count at the time each vertex entered the cache,
+    //     whether it still remains in the FIFO is known from the difference.
+    std::vector<uint32_t> insertedAt(numVertices, UINT32_MAX);
+    uint32_t numMisses = 0;
+    for (uint32_t i = 0; i < numIndices; ++i) {
+        uint32_t &entry = insertedAt[indices[i]];
+        if (entry == UINT32_MAX || numMisses - entry >= cacheSize) {
+            entry = numMisses;
+            ++numMisses;
+        }
+    }
+
+    return static_cast<float>(numMisses) / (numIndices / 3);
+}
+
+static float computeACMR(const std::vector<uint32_t>* const* materialGroups, uint32_t numMaterialGroups, uint32_t numVertices) {
+    float sumMisses = 0.0f;
+    uint32_t numTriangles = 0;
+    for (uint32_t g = 0; g < numMaterialGroups; ++g) {
+        const std::vector<uint32_t> &indices = *materialGroups[g];
+        uint32_t numGroupTriangles = static_cast<uint32_t>(indices.size() / 3);
+        sumMisses += computeACMR(indices.data(), 3 * numGroupTriangles, numVertices) * numGroupTriangles;
+        numTriangles += numGroupTriangles;
+    }
+    return numTriangles > 0 ? sumMisses / numTriangles : 0.0f;
+}
+
+
+
+// JP: 頂点をバイト列として比較する。法線やUVが少しでも違う頂点はまとめない。
+// EN: Compare vertices as byte sequences. Vertices whose normals or UVs differ even slightly aren't merged.
+struct VertexKey {
+    const vlr::Vertex* vertex;
+
+    bool operator==(const VertexKey &r) const {
+        return std::memcmp(vertex, r.vertex, sizeof(vlr::Vertex)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(key.vertex);
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (size_t i = 0; i < sizeof(vlr::Vertex); ++i) {
+            hash ^= bytes[i];
+            hash *= 0x100000001B3ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+static uint32_t expandBits10(uint32_t x) {
+    x &= 0x3FF;
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x << 8)) & 0x0300F00F;
+    x = (x | (x << 4)) & 0x030C30C3;
+    x = (x | (x << 2)) & 0x09249249;
+    return x;
+}
+
+static uint32_t computeMortonCode(const vlr::Point3D &p, const vlr::Point3D &minP, const vlr::Vector3D &invExtent) {
+    const auto quantize = [](float x) {
+        return static_cast<uint32_t>(std::min(std::max(x * 1024.0f, 0.0f), 1023.0f));
+    };
+    uint32_t x = quantize((p.x - minP.x) * invExtent.x);
+    uint32_t y = quantize((p.y - minP.y) * invExtent.y);
+    uint32_t z = quantize((p.z - minP.z) * invExtent.z);
+    return (expandBits10(x) << 2) | (expandBits10(y) << 1) | expandBits10(z);
+}
+
+void optimizeMesh(std::vector<vlr::Vertex>* vertices,
+                  std::vector<uint32_t>* const* materialGroups, uint32_t numMaterialGroups,
+                  MeshOptimizationStats* stats) {
+    using namespace vlr;
+
+    StopWatchHiRes sw;
+    sw.start();
+
+    uint32_t numVertices = static_cast<uint32_t>(vertices->size());
+    stats->numVerticesBefore = numVertices;
+    stats->numTriangles = 0;
+    for (uint32_t g = 0; g < numMaterialGroups; ++g)
+        stats->numTriangles += static_cast<uint32_t>(materialGroups[g]->size() / 3);
+    stats->acmrBefore = computeACMR(materialGroups, numMaterialGroups, numVertices);
+
+    // JP: 重複した頂点を最初に現れたものに置き換える。
+    // EN: Replace duplicate vertices with the first occurrence.
+    std::vector<uint32_t> canonicalIndices(numVertices);
+    {
+        std::unordered_map<VertexKey, uint32_t, VertexKeyHash> vertexMap;
+        vertexMap.reserve(numVertices);
+        for (uint32_t v = 0; v < numVertices; ++v)
+            canonicalIndices[v] = vertexMap.emplace(VertexKey{ &(*vertices)[v] }, v).first->second;
+    }
+    for (uint32_t g = 0; g < numMaterialGroups; ++g) {
+        for (uint32_t &index : *materialGroups[g])
+            index = canonicalIndices[index];
+    }
+
+    // JP: メッシュ全体のAABBの中で三角形の重心のモートンコードを計算し、グループごとに安定ソートする。
+    // EN: Compute the Morton codes of triangle centroids within the AABB of the whole mesh,
+    //     then stable-sort triangles per group.
+    Point3D minP(INFINITY, INFINITY, INFINITY);
+    Point3D maxP(-INFINITY, -INFINITY, -INFINITY);
+    for (uint32_t g = 0; g < numMaterialGroups; ++g) {
+        for (uint32_t index : *materialGroups[g]) {
+            const Point3D &p = (*vertices)[index].position;
+            minP = Point3D(std::min(minP.x, p.x), std::min(minP.y, p.y), std::min(minP.z, p.z));
+            maxP = Point3D(std::max(maxP.x, p.x), std::max(maxP.y, p.y), std::max(maxP.z, p.z));
+        }
+    }
+    Vector3D extent = maxP - minP;
+    Vector3D invExtent(extent.x > 0 ? 1 / extent.x : 0,
+                       extent.y > 0 ? 1 / extent.y : 0,
+                       extent.z > 0 ? 1 / extent.z : 0);
+
+    std::vector<std::pair<uint32_t, uint32_t>> keyedTriangles;
+    std::vector<uint32_t> sortedIndices;
+    for (uint32_t g = 0; g < numMaterialGroups; ++g) {
+        std::vector<uint32_t> &indices = *materialGroups[g];
+        uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+        keyedTriangles.resize(numTriangles);
+        for (uint32_t t = 0; t < numTriangles; ++t) {
+            const Point3D &p0 = (*vertices)[indices[3 * t + 0]].position;
+            const Point3D &p1 = (*vertices)[indices[3 * t + 1]].position;
+            const Point3D &p2 = (*vertices)[indices[3 * t + 2]].position;
+            Point3D centroid = (p0 + p1 + p2) / 3.0f;
+            keyedTriangles[t] = std::make_pair(computeMortonCode(centroid, minP, invExtent), t);
+        }
+        // JP: 元の三角形番号も比較するので結果は安定ソートと同じになる。
+        // EN: The original triangle index is also compared, so the result equals a stable sort.
+        std::sort(keyedTriangles.begin(), keyedTriangles.end());
+
+        sortedIndices.resize(3 * numTriangles);
+        for (uint32_t t = 0; t < numTriangles; ++t) {
+            uint32_t srcTri = keyedTriangles[t].second;
+            sortedIndices[3 * t + 0] = indices[3 * srcTri + 0];
+            sortedIndices[3 * t + 1] = indices[3 * srcTri + 1];
+            sortedIndices[3 * t + 2] = indices[3 * srcTri + 2];
+        }
+        std::swap(indices, sortedIndices);
+    }
+
+    // JP: 頂点を最初に参照される順に番号を振り直す。参照されない頂点はここで落ちる。
+    // EN: Renumber vertices in the order of their first reference. Unreferenced vertices are dropped here.
+    std::vector<uint32_t> newIndices(numVertices, UINT32_MAX);
+    std::vector<Vertex> newVertices;
+    newVertices.reserve(numVertices);
+    for (uint32_t g = 0; g < numMaterialGroups; ++g) {
+        for (uint32_t &index : *materialGroups[g]) {
+            if (newIndices[index] == UINT32_MAX) {
+                newIndices[index] = static_cast<uint32_t>(newVertices.size());
+                newVertices.push_back((*vertices)[index]);
+            }
+            index = newIndices[index];
+        }
+    }
+    newVertices.shrink_to_fit();
+    *vertices = std::move(newVertices);
+
+    stats->numVerticesAfter = static_cast<uint32_t>(vertices->size());
+    stats->acmrAfter = computeACMR(materialGroups, numMaterialGroups, stats->numVerticesAfter);
+    stats->milliseconds = sw.stop(StopWatchHiRes::Microseconds) * 1e-3f;
+}
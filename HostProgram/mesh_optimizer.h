@@ -0,0 +1,36 @@
+#pragma once
+
+#include "common.h"
+
+#include <VLR/vlrcpp.h>
+
+// JP: メッシュの頂点とインデックスの並びを最適化するオプションのパス。
+//     重複した頂点をまとめ、マテリアルグループごとに三角形を重心のモートン順に並べ替え、
+//     頂点を三角形から最初に参照される順に並べ直す。ジオメトリ自体は変わらない。
+// EN: Optional pass optimizing the order of vertices and indices of a mesh.
+//     Merges duplicate vertices, sorts triangles per material group in the Morton order of their centroids
+//     and renumbers vertices in the order of their first reference from triangles. The geometry itself doesn't change.
+
+struct MeshOptimizationStats {
+    uint32_t numVerticesBefore;
+    uint32_t numVerticesAfter;
+    uint32_t numTriangles;
+    // JP: 三角形あたりの頂点キャッシュミス数(ACMR)。
+    // EN: Average cache miss ratio (vertex cache misses per triangle).
+    float acmrBefore;
+    float acmrAfter;
+    float milliseconds;
+};
+
+void setMeshOptimizationEnabled(bool enable);
+bool meshOptimizationEnabled();
+
+// JP: FIFOの頂点キャッシュを仮定してインデックス列のACMRを計算する。
+// EN: Compute the ACMR of an index list assuming a FIFO vertex cache.
+float computeACMR(const uint32_t* indices, uint32_t numIndices, uint32_t numVertices, uint32_t cacheSize = 32);
+
+// JP: 各マテリアルグループのインデックス列はその場で書き換えられる。参照されない頂点は取り除かれる。
+// EN: The index list of each material group is rewritten in place. Unreferenced vertices are removed.
+void optimizeMesh(std::vector<vlr::Vertex>* vertices,
+                  std::vector<uint32_t>* const* materialGroups, uint32_t numMaterialGroups,
+                  MeshOptimizationStats* stats);
@@ -1,5 +1,19 @@
 #include "scene.h"
 
+#include "mesh_optimizer.h"
+#include "scene_cache.h"
+#include "StopWatch.h"
+
+#include <cstring>
+#include <map>
+#include <tuple>
+
+const std::vector<MaterialTextureSlot> defaultMaterialTextureSlots = {
+    { aiTextureType_DIFFUSE, 0, "Reflectance", "Rec709(D65) sRGB Gamma" },
+    { aiTextureType_HEIGHT, 0, "NA", "Rec709(D65)" },
+    { aiTextureType_OPACITY, 0, "NA", "Rec709(D65)" },
+};
+
 SurfaceMaterialAttributeTuple createMaterialDefaultFunction(const vlr::ContextRef &context, const aiMaterial* aiMat, const std::string &pathPrefix) {
     using namespace vlr;
 
@@ -71,9 +85,231 @@ MeshAttributeTuple perMeshDefaultFunction(const aiMesh* mesh) {
     return MeshAttributeTuple(true);
 }
 
+static bool s_meshInstancingEnabled = false;
+static bool s_canonicalizeMeshTranslation = false;
+static bool s_compactVertexFormatEnabled = false;
+
+void setMeshInstancing(bool enable, bool canonicalizeTranslation) {
+    s_meshInstancingEnabled = enable;
+    s_canonicalizeMeshTranslation = enable && canonicalizeTranslation;
+}
+
+void setCompactVertexFormat(bool enable) {
+    s_compactVertexFormatEnabled = enable;
+}
+
+// JP: 4バイト単位のデータを2系統で処理する128bitのハッシュ。
+// EN: 128-bit hash processing 4-byte words in two lanes.
+static void hashWords(const void* data, size_t sizeInBytes, uint64_t hash[2]) {
+    const auto fmix = [](uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xFF51AFD7ED558CCDull;
+        k ^= k >> 33;
+        k *= 0xC4CEB9FE1A85EC53ull;
+        k ^= k >> 33;
+        return k;
+    };
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < sizeInBytes / sizeof(uint32_t); ++i) {
+        uint32_t word;
+        std::memcpy(&word, bytes + sizeof(uint32_t) * i, sizeof(word));
+        hash[0] = (hash[0] ^ word) * 0x100000001B3ull;
+        hash[1] = (hash[1] + word) * 0x9E3779B97F4A7C15ull;
+        hash[1] ^= hash[1] >> 29;
+    }
+    hash[0] = fmix(hash[0] ^ sizeInBytes);
+    hash[1] = fmix(hash[1] + hash[0]);
+}
+
+// JP: 内容のハッシュ(マテリアル、頂点数、インデックス数を含む)から作成済みのサーフェスノードを引く。
+//     キーの最後の要素は、ハッシュが一致したのにバイト列が異なる内容を区別する番号。
+// EN: Looks up created surface nodes by the hash of contents (including the material, vertex and index counts).
+//     The last element of the key is a number distinguishing contents whose hashes match but whose bytes differ.
+struct MeshInstanceCache {
+    typedef std::tuple<uint64_t, uint64_t, uint32_t, uint32_t, uint32_t, uint32_t> Key;
+    // JP: GASはParentNodeごとに作られるので、共有するには全インスタンスが同じ親ノードを経由する必要がある。
+    //     メッシュは恒等変換のプロトタイプノードの下に置き、各インスタンスはこのノードを参照する。
+    // EN: A GAS is created per ParentNode, so sharing it requires all instances to go through the same parent node.
+    //     The mesh is placed under a prototype node with the identity transform, and each instance refers to this node.
+    struct Entry {
+        vlr::InternalNodeRef prototype;
+        uint32_t numVertices;
+        uint32_t numTriangles;
+    };
+    // JP: 複数のノードから参照されるaiMeshは頂点を作り直さない。
+    //     各内容を最初に参照するaiMeshは、参照数を数える際に変換した頂点とインデックスを構築まで保持する。
+    //     それ以外は内容の比較の後に破棄する。
+    // EN: An aiMesh referenced from multiple nodes doesn't rebuild its vertices.
+    //     The aiMesh referring to each content first keeps the vertices and indices converted while counting references
+    //     until construction. Others discard them after comparing the contents.
+    struct MeshReference {
+        Key key;
+        vlr::Vector3D offset;
+        std::vector<vlr::Vertex> vertices;
+        std::vector<uint32_t> indices;
+    };
+
+    std::map<Key, Entry> entries;
+    std::map<uint32_t, MeshReference> meshReferences;
+    // JP: 内容ごとに、それを最初に参照したaiMeshのインデックス。
+    // EN: Index of the aiMesh that referred to each content first.
+    std::map<Key, uint32_t> representatives;
+    // JP: 事前のパスで数えた内容ごとの参照数。2回以上参照される内容だけをプロトタイプノード経由で共有し、
+    //     1回だけの内容は親ノードのGASに直接入れて、GASとIASの階層を増やさない。
+    // EN: Number of references per content counted in a pre-pass. Only contents referenced twice or more are shared
+    //     through a prototype node, and contents referenced once go directly into the parent node's GAS
+    //     without adding a GAS and an IAS level.
+    std::map<Key, uint32_t> referenceCounts;
+    uint32_t numReferences = 0;
+    uint32_t numSingletons = 0;
+    uint64_t numSavedTriangles = 0;
+    uint64_t numSavedBytes = 0;
+};
+
+// JP: geometriesが与えられた場合は頂点とインデックスをaiMeshからではなく変換済みのデータから取る。
+// EN: When geometries is given, vertices and indices are taken from the converted data instead of aiMesh.
+static void loadMeshGeometry(const aiMesh* mesh, uint32_t meshIndex, const MeshGeometryView* geometries,
+                             std::vector<vlr::Vertex>* vertices, std::vector<uint32_t>* indices) {
+    if (geometries) {
+        const MeshGeometryView &geom = geometries[meshIndex];
+        vertices->assign(geom.vertices, geom.vertices + geom.numVertices);
+        indices->assign(geom.indices, geom.indices + geom.numIndices);
+    }
+    else {
+        convertMeshGeometry(mesh, vertices, indices);
+    }
+}
+
+// JP: メッシュの内容のキーと、プロトタイプの座標系への平行移動を求める。
+//     AABBの最小点を原点に移した頂点でハッシュを取ると、平行移動だけが異なるメッシュが一致する。
+//     移した頂点はscratchVerticesに作り、verticesは変更しない。
+// EN: Computes the key of the mesh contents and the translation to the coordinate system of the prototype.
+//     Hashing vertices with the minimum point of the AABB moved to the origin makes meshes differing only by a translation match.
+//     The moved vertices are made in scratchVertices, and vertices is left unchanged.
+static MeshInstanceCache::MeshReference computeMeshReference(const aiMesh* mesh,
+                                                             const std::vector<vlr::Vertex> &vertices, const std::vector<uint32_t> &indices,
+                                                             std::vector<vlr::Vertex>* scratchVertices) {
+    using namespace vlr;
+
+    Vector3D offset(0, 0, 0);
+    const std::vector<Vertex>* hashedVertices = &vertices;
+    if (s_canonicalizeMeshTranslation && !vertices.empty()) {
+        Point3D minP = vertices[0].position;
+        for (const Vertex &v : vertices)
+            minP = Point3D(std::min(minP.x, v.position.x),
+                           std::min(minP.y, v.position.y),
+                           std::min(minP.z, v.position.z));
+        offset = Vector3D(minP.x, minP.y, minP.z);
+        *scratchVertices = vertices;
+        for (Vertex &v : *scratchVertices)
+            v.position -= offset;
+        hashedVertices = scratchVertices;
+    }
+
+    uint64_t hash[2] = { 0xCBF29CE484222325ull, 0x9E3779B97F4A7C15ull };
+    hashWords(hashedVertices->data(), sizeof(Vertex) * hashedVertices->size(), hash);
+    hashWords(indices.data(), sizeof(uint32_t) * indices.size(), hash);
+    MeshInstanceCache::Key key(hash[0], hash[1], mesh->mMaterialIndex,
+                               static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size()), 0);
+    return MeshInstanceCache::MeshReference{ key, offset };
+}
+
+// JP: ハッシュを取ったのと同じ、プロトタイプの座標系に移した頂点とインデックスのバイト列を比較する。
+// EN: Compares the bytes of vertices moved to the coordinate system of the prototype, the same as hashed, and indices.
+static bool meshContentsMatch(const MeshInstanceCache::MeshReference &a, const MeshInstanceCache::MeshReference &b) {
+    using namespace vlr;
+
+    if (a.vertices.size() != b.vertices.size() || a.indices.size() != b.indices.size())
+        return false;
+    if (std::memcmp(a.indices.data(), b.indices.data(), sizeof(uint32_t) * a.indices.size()) != 0)
+        return false;
+    for (size_t i = 0; i < a.vertices.size(); ++i) {
+        Vertex va = a.vertices[i];
+        Vertex vb = b.vertices[i];
+        va.position -= a.offset;
+        vb.position -= b.offset;
+        if (std::memcmp(&va, &vb, sizeof(Vertex)) != 0)
+            return false;
+    }
+    return true;
+}
+
+// JP: 構築の前にノードの階層をたどり、各aiMeshのキーを一度だけ求めて内容ごとの参照数を数える。
+//     ハッシュが一致した場合は、その内容を最初に参照したaiMeshとバイト列を比較してから同じ内容とみなす。
+// EN: Walks the node hierarchy before construction, computes the key of each aiMesh only once
+//     and counts the references per content.
+//     When the hash matches, the mesh is regarded as the same content only after comparing the bytes
+//     with the aiMesh that referred to the content first.
+static void countMeshReferences(const aiScene* objSrc, const aiNode* nodeSrc, const PerMeshFunction &meshFunc,
+                                const MeshGeometryView* geometries, MeshInstanceCache* instanceCache) {
+    std::vector<vlr::Vertex> scratchVertices;
+    for (int m = 0; m < nodeSrc->mNumMeshes; ++m) {
+        uint32_t meshIndex = nodeSrc->mMeshes[m];
+        const aiMesh* mesh = objSrc->mMeshes[meshIndex];
+        if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE || !meshFunc(mesh).visible)
+            continue;
+
+        auto itRef = instanceCache->meshReferences.find(meshIndex);
+        if (itRef == instanceCache->meshReferences.cend()) {
+            std::vector<vlr::Vertex> vertices;
+            std::vector<uint32_t> indices;
+            loadMeshGeometry(mesh, meshIndex, geometries, &vertices, &indices);
+            MeshInstanceCache::MeshReference ref = computeMeshReference(mesh, vertices, indices, &scratchVertices);
+            ref.vertices = std::move(vertices);
+            ref.indices = std::move(indices);
+            for (uint32_t &collisionIndex = std::get<5>(ref.key); ; ++collisionIndex) {
+                auto itRep = instanceCache->representatives.find(ref.key);
+                if (itRep == instanceCache->representatives.cend()) {
+                    instanceCache->representatives[ref.key] = meshIndex;
+                    break;
+                }
+                if (meshContentsMatch(ref, instanceCache->meshReferences.at(itRep->second))) {
+                    ref.vertices = std::vector<vlr::Vertex>();
+                    ref.indices = std::vector<uint32_t>();
+                    break;
+                }
+            }
+            itRef = instanceCache->meshReferences.emplace(meshIndex, std::move(ref)).first;
+        }
+        ++instanceCache->referenceCounts[itRef->second.key];
+    }
+
+    for (int c = 0; c < nodeSrc->mNumChildren; ++c)
+        countMeshReferences(objSrc, nodeSrc->mChildren[c], meshFunc, geometries, instanceCache);
+}
+
+// JP: std::vectorの中身をコピーせずにlibVLRへ渡すため、ヒープ上に移して解放関数と共に渡す。
+// EN: Move the contents of a std::vector to the heap and hand it over to libVLR together with a release function
+//     so that it isn't copied.
+template <typename T>
+static std::vector<T>* releaseToLibrary(std::vector<T> &&v) {
+    return new std::vector<T>(std::move(v));
+}
+
+template <typename T>
+static void deleteReleasedVector(void* userData) {
+    delete static_cast<std::vector<T>*>(userData);
+}
+
+// JP: マップしたキャッシュを指すデータをlibVLRに渡す間、ファイルのマップを保つ参照。
+// EN: Reference keeping the file mapped while data pointing into the mapped cache is handed over to libVLR.
+static void* retainMappedFile(const std::shared_ptr<const void> &mappedFile) {
+    return new std::shared_ptr<const void>(mappedFile);
+}
+
+static void releaseMappedFile(void* userData) {
+    delete static_cast<std::shared_ptr<const void>*>(userData);
+}
+
+// JP: instanceCacheが与えられた場合はcountMeshReferences()で参照数を数えておく必要がある。
+//     mappedFileはgeometriesが指すマップしたキャッシュ。非nullptrで内容を変更しないメッシュはコピーせずに渡す。
+// EN: When instanceCache is given, the references must have been counted by countMeshReferences().
+//     mappedFile is the mapped cache geometries point into.
+//     When it is non-null, meshes whose contents aren't modified are handed over without copying.
 void recursiveConstruct(const vlr::ContextRef &context, const aiScene* objSrc, const aiNode* nodeSrc,
                         const std::vector<SurfaceMaterialAttributeTuple> &matAttrTuples, const PerMeshFunction &meshFunc,
-                        vlr::InternalNodeRef* nodeOut) {
+                        const MeshGeometryView* geometries, const std::shared_ptr<const void> &mappedFile,
+                        MeshInstanceCache* instanceCache, vlr::InternalNodeRef* nodeOut) {
     using namespace vlr;
 
     if (nodeSrc->mNumMeshes == 0 && nodeSrc->mNumChildren == 0) {
@@ -92,8 +328,22 @@ void recursiveConstruct(const vlr::ContextRef &context, const aiScene* objSrc, c
     *nodeOut = context->createInternalNode(nodeSrc->mName.C_Str(), context->createStaticTransform(tfElems));
 
     std::vector<uint32_t> meshIndices;
+    // JP: インスタンスはメッシュ自体の座標系に置き、必要なら平行移動を挟む。
+    // EN: An instance is placed in the coordinate system of the mesh itself with a translation in between if needed.
+    const auto addInstance = [&](const InternalNodeRef &prototype, const Vector3D &offset) {
+        if (offset == Vector3D(0, 0, 0)) {
+            (*nodeOut)->addChild(prototype);
+            return;
+        }
+        InternalNodeRef instanceNode = context->createInternalNode(prototype->getName(),
+                                                                   context->createStaticTransform(translate<float>(offset)));
+        instanceNode->addChild(prototype);
+        (*nodeOut)->addChild(instanceNode);
+    };
+
     for (int m = 0; m < nodeSrc->mNumMeshes; ++m) {
-        const aiMesh* mesh = objSrc->mMeshes[nodeSrc->mMeshes[m]];
+        uint32_t meshIndex = nodeSrc->mMeshes[m];
+        const aiMesh* mesh = objSrc->mMeshes[meshIndex];
         if (mesh->mPrimitiveTypes != aiPrimitiveType_TRIANGLE) {
             hpprintf("ignored non triangle mesh: %s.\n", mesh->mName.C_Str());
             continue;
@@ -104,52 +354,112 @@ void recursiveConstruct(const vlr::ContextRef &context, const aiScene* objSrc, c
         if (!meshAttr.visible)
             continue;
 
-        auto surfMesh = context->createTriangleMeshSurfaceNode(mesh->mName.C_Str());
+        MeshInstanceCache::MeshReference* meshRef = nullptr;
+        MeshInstanceCache::MeshReference* cachedGeometry = nullptr;
+        if (instanceCache) {
+            MeshInstanceCache::MeshReference &ref = instanceCache->meshReferences.at(meshIndex);
+            cachedGeometry = &ref;
+            if (instanceCache->referenceCounts.at(ref.key) >= 2)
+                meshRef = &ref;
+            else
+                ++instanceCache->numSingletons;
+        }
+        if (meshRef) {
+            auto itEntry = instanceCache->entries.find(meshRef->key);
+            if (itEntry != instanceCache->entries.cend()) {
+                const MeshInstanceCache::Entry &entry = itEntry->second;
+                addInstance(entry.prototype, meshRef->offset);
+                ++instanceCache->numReferences;
+                instanceCache->numSavedTriangles += entry.numTriangles;
+                instanceCache->numSavedBytes += sizeof(Vertex) * entry.numVertices + 3 * sizeof(uint32_t) * entry.numTriangles;
+                continue;
+            }
+        }
+
         const SurfaceMaterialAttributeTuple attrTuple = matAttrTuples[mesh->mMaterialIndex];
         const SurfaceMaterialRef &surfMat = attrTuple.material;
         const ShaderNodePlug &nodeNormal = attrTuple.nodeNormal;
         const ShaderNodePlug &nodeTangent = attrTuple.nodeTangent;
         const ShaderNodePlug &nodeAlpha = attrTuple.nodeAlpha;
 
-        std::vector<Vertex> vertices;
-        for (int v = 0; v < mesh->mNumVertices; ++v) {
-            const aiVector3D &p = mesh->mVertices[v];
-            const aiVector3D &n = mesh->mNormals[v];
-            Vector3D tangent, bitangent;
-            if (mesh->mTangents == nullptr)
-                Normal3D(n.x, n.y, n.z).makeCoordinateSystem(&tangent, &bitangent);
-            aiVector3D t(NAN, NAN, NAN);
-            if (mesh->mTangents)
-                t = mesh->mTangents[v];
-            if (!std::isfinite(t.x) || !std::isfinite(t.y) || !std::isfinite(t.z))
-                t = aiVector3D(tangent[0], tangent[1], tangent[2]);
-            const aiVector3D &uv = mesh->mNumUVComponents[0] > 0 ? mesh->mTextureCoords[0][v] : aiVector3D(0, 0, 0);
-
-            Vertex outVtx{ Point3D(p.x, p.y, p.z), Normal3D(n.x, n.y, n.z), Vector3D(t.x, t.y, t.z), TexCoord2D(uv.x, uv.y) };
-            float dotNT = dot(outVtx.normal, outVtx.tc0Direction);
-            if (std::fabs(dotNT) >= 0.01f)
-                outVtx.tc0Direction = normalize(outVtx.tc0Direction - dotNT * outVtx.normal);
-            //VLRAssert(absDot(outVtx.normal, outVtx.tc0Direction) < 0.01f, "shading normal and tangent must be orthogonal: %g", absDot(outVtx.normal, outVtx.tangent));
-            vertices.push_back(outVtx);
+        auto surfMesh = context->createTriangleMeshSurfaceNode(mesh->mName.C_Str());
+        if (s_compactVertexFormatEnabled)
+            surfMesh->setVertexFormat(VLRVertexFormat_Compact);
+
+        const bool hasCachedGeometry = cachedGeometry && !cachedGeometry->vertices.empty();
+        const bool isTranslated = meshRef && !(meshRef->offset == Vector3D(0, 0, 0));
+        uint32_t numVertices;
+        uint32_t numIndices;
+        // JP: キャッシュの内容をそのまま使えるメッシュはマップしたファイルを指したまま渡す。
+        // EN: Meshes that can use the cache contents as is are handed over still pointing into the mapped file.
+        if (mappedFile && !hasCachedGeometry && !isTranslated && !meshOptimizationEnabled()) {
+            const MeshGeometryView &geom = geometries[meshIndex];
+            numVertices = geom.numVertices;
+            numIndices = geom.numIndices;
+            surfMesh->setVerticesFromOwnedData(geom.vertices, numVertices,
+                                               releaseMappedFile, retainMappedFile(mappedFile));
+            surfMesh->addMaterialGroupFromOwnedData(geom.indices, numIndices, surfMat, nodeNormal, nodeTangent, nodeAlpha,
+                                                    releaseMappedFile, retainMappedFile(mappedFile));
         }
-        surfMesh->setVertices(vertices.data(), vertices.size());
-
-        meshIndices.clear();
-        for (int f = 0; f < mesh->mNumFaces; ++f) {
-            const aiFace &face = mesh->mFaces[f];
-            meshIndices.push_back(face.mIndices[0]);
-            meshIndices.push_back(face.mIndices[1]);
-            meshIndices.push_back(face.mIndices[2]);
+        else {
+            // JP: 参照数を数える際に変換した頂点とインデックスがあればそれを使う。
+            // EN: Use the vertices and indices converted while counting references if available.
+            std::vector<Vertex> vertices;
+            if (hasCachedGeometry) {
+                vertices = std::move(cachedGeometry->vertices);
+                meshIndices = std::move(cachedGeometry->indices);
+            }
+            else {
+                loadMeshGeometry(mesh, meshIndex, geometries, &vertices, &meshIndices);
+            }
+            // JP: 共有する内容はハッシュを取ったときと同じくプロトタイプの座標系に移す。
+            // EN: Shared contents are moved to the coordinate system of the prototype as when hashed.
+            if (isTranslated) {
+                for (Vertex &v : vertices)
+                    v.position -= meshRef->offset;
+            }
+
+            if (meshOptimizationEnabled()) {
+                std::vector<uint32_t>* materialGroups[] = { &meshIndices };
+                MeshOptimizationStats stats;
+                optimizeMesh(&vertices, materialGroups, 1, &stats);
+                hpprintf("  optimized: vertices %u -> %u (%.1f%%), ACMR %.3f -> %.3f, %.2f[ms]\n",
+                         stats.numVerticesBefore, stats.numVerticesAfter,
+                         100.0f * stats.numVerticesAfter / std::max(stats.numVerticesBefore, 1u),
+                         stats.acmrBefore, stats.acmrAfter, stats.milliseconds);
+            }
+
+            numVertices = static_cast<uint32_t>(vertices.size());
+            numIndices = static_cast<uint32_t>(meshIndices.size());
+
+            std::vector<Vertex>* ownedVertices = releaseToLibrary(std::move(vertices));
+            surfMesh->setVerticesFromOwnedData(ownedVertices->data(), numVertices,
+                                               deleteReleasedVector<Vertex>, ownedVertices);
+            std::vector<uint32_t>* ownedIndices = releaseToLibrary(std::move(meshIndices));
+            surfMesh->addMaterialGroupFromOwnedData(ownedIndices->data(), numIndices, surfMat, nodeNormal, nodeTangent, nodeAlpha,
+                                                    deleteReleasedVector<uint32_t>, ownedIndices);
         }
-        surfMesh->addMaterialGroup(meshIndices.data(), meshIndices.size(), surfMat, nodeNormal, nodeTangent, nodeAlpha);
 
-        (*nodeOut)->addChild(surfMesh);
+        if (meshRef) {
+            // JP: 最適化で頂点数が変わり得るので登録は最後に行う。
+            // EN: Register at the end since the optimization may change the vertex count.
+            InternalNodeRef prototype = context->createInternalNode(mesh->mName.C_Str());
+            prototype->addChild(surfMesh);
+            instanceCache->entries[meshRef->key] = MeshInstanceCache::Entry{
+                prototype, numVertices, numIndices / 3 };
+            ++instanceCache->numReferences;
+            addInstance(prototype, meshRef->offset);
+        }
+        else {
+            (*nodeOut)->addChild(surfMesh);
+        }
     }
 
     if (nodeSrc->mNumChildren) {
         for (int c = 0; c < nodeSrc->mNumChildren; ++c) {
             InternalNodeRef subNode;
-            recursiveConstruct(context, objSrc, nodeSrc->mChildren[c], matAttrTuples, meshFunc, &subNode);
+            recursiveConstruct(context, objSrc, nodeSrc->mChildren[c], matAttrTuples, meshFunc, geometries, mappedFile,
+                               instanceCache, &subNode);
             if (subNode != nullptr)
                 (*nodeOut)->addChild(subNode);
         }
@@ -157,32 +467,101 @@ void recursiveConstruct(const vlr::ContextRef &context, const aiScene* objSrc, c
 }
 
 void construct(const vlr::ContextRef &context, const std::string &filePath, bool flipWinding, bool flipV, vlr::InternalNodeRef* nodeOut,
-               CreateMaterialFunction matFunc, PerMeshFunction meshFunc) {
+               CreateMaterialFunction matFunc, PerMeshFunction meshFunc, const std::vector<MaterialTextureSlot> &preloadSlots) {
     using namespace vlr;
 
+    StopWatchHiRes sw;
+    sw.start();
+
+    // JP: キャッシュがあればassimpを使わずにマップしたファイルから直接頂点とインデックスを取る。
+    // EN: When a cache exists, take vertices and indices directly from the mapped file without using assimp.
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(filePath, 
-        aiProcess_Triangulate |
-        aiProcess_CalcTangentSpace |
-        (flipWinding ? aiProcess_FlipWindingOrder : 0) |
-        (flipV ? aiProcess_FlipUVs : 0));
-    if (!scene) {
-        hpprintf("Failed to load %s.\n", filePath.c_str());
-        *nodeOut = nullptr;
-        return;
+    CachedScene cachedScene;
+    std::vector<std::vector<Vertex>> convertedVertices;
+    std::vector<std::vector<uint32_t>> convertedIndices;
+    const aiScene* scene = nullptr;
+    const MeshGeometryView* geometries = nullptr;
+    if (readSceneCache(filePath, flipWinding, flipV, &cachedScene)) {
+        scene = cachedScene.scene.get();
+        geometries = cachedScene.geometries.data();
+        hpprintf("Reading: %s done from the scene cache (%.2f[ms]).\n", filePath.c_str(),
+                 sw.stop(StopWatchHiRes::Microseconds) * 1e-3f);
+    }
+    else {
+        scene = importer.ReadFile(filePath,
+            aiProcess_Triangulate |
+            aiProcess_CalcTangentSpace |
+            (flipWinding ? aiProcess_FlipWindingOrder : 0) |
+            (flipV ? aiProcess_FlipUVs : 0));
+        if (!scene) {
+            hpprintf("Failed to load %s.\n", filePath.c_str());
+            *nodeOut = nullptr;
+            return;
+        }
+        hpprintf("Reading: %s done (%.2f[ms]).\n", filePath.c_str(),
+                 sw.stop(StopWatchHiRes::Microseconds) * 1e-3f);
+
+        if (sceneCacheEnabled()) {
+            sw.start();
+            std::vector<MeshGeometryView> geometryViews(scene->mNumMeshes);
+            convertedVertices.resize(scene->mNumMeshes);
+            convertedIndices.resize(scene->mNumMeshes);
+            for (uint32_t m = 0; m < scene->mNumMeshes; ++m) {
+                const aiMesh* mesh = scene->mMeshes[m];
+                if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+                    convertMeshGeometry(mesh, &convertedVertices[m], &convertedIndices[m]);
+                MeshGeometryView &geom = geometryViews[m];
+                geom.vertices = convertedVertices[m].data();
+                geom.numVertices = static_cast<uint32_t>(convertedVertices[m].size());
+                geom.indices = convertedIndices[m].data();
+                geom.numIndices = static_cast<uint32_t>(convertedIndices[m].size());
+            }
+            storeSceneCache(filePath, flipWinding, flipV, scene, geometryViews.data());
+            hpprintf("Storing the scene cache: %s done (%.2f[ms]).\n", filePath.c_str(),
+                     sw.stop(StopWatchHiRes::Microseconds) * 1e-3f);
+
+            cachedScene.geometries = std::move(geometryViews);
+            geometries = cachedScene.geometries.data();
+        }
     }
-    hpprintf("Reading: %s done.\n", filePath.c_str());
 
     std::string pathPrefix = filePath.substr(0, filePath.find_last_of("/") + 1);
 
+    // JP: マテリアル関数が読み込むテクスチャーを先に並列にデコードしておく。
+    // EN: Decode textures that the material function will load in parallel beforehand.
+    if (!preloadSlots.empty()) {
+        std::vector<ImageLoadRequest> requests;
+        aiString strValue;
+        for (int m = 0; m < scene->mNumMaterials; ++m) {
+            const aiMaterial* aiMat = scene->mMaterials[m];
+            for (const MaterialTextureSlot &slot : preloadSlots) {
+                if (aiMat->Get(AI_MATKEY_TEXTURE(slot.type, slot.index), strValue) == aiReturn_SUCCESS)
+                    requests.push_back(ImageLoadRequest{ pathPrefix + strValue.C_Str(), slot.spectrumType, slot.colorSpace });
+            }
+        }
+        preloadImage2Ds(context, requests);
+    }
+
     // create materials
     std::vector<SurfaceMaterialAttributeTuple> attrTuples;
     for (int m = 0; m < scene->mNumMaterials; ++m) {
         const aiMaterial* aiMat = scene->mMaterials[m];
         attrTuples.push_back(matFunc(context, aiMat, pathPrefix));
     }
-
-    recursiveConstruct(context, scene, scene->mRootNode, attrTuples, meshFunc, nodeOut);
+    discardPreloadedImage2Ds();
+
+    MeshInstanceCache instanceCache;
+    if (s_meshInstancingEnabled)
+        countMeshReferences(scene, scene->mRootNode, meshFunc, geometries, &instanceCache);
+    recursiveConstruct(context, scene, scene->mRootNode, attrTuples, meshFunc, geometries, cachedScene.mappedFile,
+                       s_meshInstancingEnabled ? &instanceCache : nullptr, nodeOut);
+    if (s_meshInstancingEnabled) {
+        hpprintf("Instancing: %u mesh references share %u surface nodes, %u meshes are referenced once, "
+                 "saved %llu triangles (%.2f MiB of vertices and indices).\n",
+                 instanceCache.numReferences, static_cast<uint32_t>(instanceCache.entries.size()), instanceCache.numSingletons,
+                 static_cast<unsigned long long>(instanceCache.numSavedTriangles),
+                 instanceCache.numSavedBytes / (1024.0 * 1024.0));
+    }
 
     hpprintf("Constructing: %s done.\n", filePath.c_str());
 }
@@ -205,6 +584,7 @@ void createTempScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     auto cornellBox = context->createTriangleMeshSurfaceNode("CornellBox");
     {
@@ -476,6 +856,7 @@ void createSingleSphereScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef sphere;
     construct(context, "resources/sphere/sphere.obj", false, false, &sphere,
@@ -531,6 +912,7 @@ void createCornellBoxScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     auto cornellBox = context->createTriangleMeshSurfaceNode("CornellBox");
     {
@@ -809,6 +1191,7 @@ void createMaterialTestScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -982,6 +1365,7 @@ void createAnisotropyScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -1129,6 +1513,7 @@ void createWhiteFurnaceTestScene(const vlr::ContextRef& context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -1217,6 +1602,7 @@ void createColorCheckerScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     const float ColorCheckerLambdas[] = {
         380, 390, 400, 410, 420, 430, 440, 450, 460, 470, 480, 490, 500, 510, 520, 530, 540, 550, 560, 570, 580, 590, 600, 610, 620, 630, 640, 650, 660, 670, 680, 690, 700, 710, 720, 730
@@ -1378,6 +1764,7 @@ void createColorInterpolationTestScene(const vlr::ContextRef &context, Shot* sho
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -1514,6 +1901,7 @@ void createSubstanceManScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -1722,6 +2110,7 @@ void createGalleryScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -1776,7 +2165,8 @@ void createGalleryScene(const vlr::ContextRef &context, Shot* shot) {
 
         return SurfaceMaterialAttributeTuple(mat, plugNormal, plugTangent, plugAlpha);
     };
-    construct(context, ASSETS_DIR"gallery/gallery.obj", false, true, &modelNode, createMaterialDefaultFunction);
+    construct(context, ASSETS_DIR"gallery/gallery.obj", false, true, &modelNode, createMaterialDefaultFunction,
+              perMeshDefaultFunction, defaultMaterialTextureSlots);
     shot->scene->addChild(modelNode);
     modelNode->setTransform(context->createStaticTransform(translate<float>(0, 0, 0) * scale<float>(0.5f)));
 
@@ -1809,6 +2199,7 @@ void createHairballScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -1896,6 +2287,7 @@ void createRungholtScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -1949,7 +2341,8 @@ void createRungholtScene(const vlr::ContextRef &context, Shot* shot) {
 
         return SurfaceMaterialAttributeTuple(mat, plugNormal, plugTangent, plugAlpha);
     };
-    construct(context, ASSETS_DIR"rungholt/rungholt.obj", false, true, &modelNode, rungholtMaterialFunc);
+    construct(context, ASSETS_DIR"rungholt/rungholt.obj", false, true, &modelNode, rungholtMaterialFunc,
+              perMeshDefaultFunction, { { aiTextureType_DIFFUSE, 0, "Reflectance", "Rec709(D65) sRGB Gamma" } });
     shot->scene->addChild(modelNode);
     modelNode->setTransform(context->createStaticTransform(translate<float>(0, 0, 0) * scale<float>(0.04f)));
 
@@ -2022,6 +2415,7 @@ void createPowerplantScene(const vlr::ContextRef &context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -2048,7 +2442,8 @@ void createPowerplantScene(const vlr::ContextRef &context, Shot* shot) {
 
         return SurfaceMaterialAttributeTuple(mat, plugNormal, plugTangent, plugAlpha);
     };
-    construct(context, ASSETS_DIR"powerplant/powerplant.obj", false, true, &modelNode, createMaterialDefaultFunction);
+    construct(context, ASSETS_DIR"powerplant/powerplant.obj", false, true, &modelNode, createMaterialDefaultFunction,
+              perMeshDefaultFunction, defaultMaterialTextureSlots);
     shot->scene->addChild(modelNode);
     modelNode->setTransform(context->createStaticTransform(translate<float>(0, 0, 0) * scale<float>(0.0001f)));
 
@@ -2091,6 +2486,7 @@ void createAmazonBistroExteriorScene(const vlr::ContextRef &context, Shot* shot)
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -2297,6 +2693,7 @@ void createAmazonBistroInteriorScene(const vlr::ContextRef &context, Shot* shot)
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -2426,7 +2823,13 @@ void createAmazonBistroInteriorScene(const vlr::ContextRef &context, Shot* shot)
 
         return SurfaceMaterialAttributeTuple(mat, plugNormal, plugTangent, plugAlpha);
     };
-    construct(context, ASSETS_DIR"Amazon_Bistro/Interior/interior.obj", false, true, &modelNode, bistroMaterialFunc);
+    construct(context, ASSETS_DIR"Amazon_Bistro/Interior/interior.obj", false, true, &modelNode, bistroMaterialFunc,
+              perMeshDefaultFunction, {
+                  { aiTextureType_DIFFUSE, 0, "Reflectance", "Rec709(D65) sRGB Gamma" },
+                  { aiTextureType_SPECULAR, 0, "Reflectance", "Rec709(D65) sRGB Gamma" },
+                  { aiTextureType_HEIGHT, 0, "NA", "Rec709(D65)" },
+                  { aiTextureType_OPACITY, 0, "NA", "Rec709(D65)" },
+              });
     shot->scene->addChild(modelNode);
     modelNode->setTransform(context->createStaticTransform(translate<float>(0, 0, 0) * scale<float>(0.001f)));
 
@@ -2490,6 +2893,7 @@ void createSanMiguelScene(const vlr::ContextRef& context, Shot* shot) {
     using namespace vlr;
 
     shot->scene = context->createScene();
+    shot->scene->beginEdits();
 
     InternalNodeRef modelNode;
 
@@ -2567,7 +2971,8 @@ void createSanMiguelScene(const vlr::ContextRef& context, Shot* shot) {
         return SurfaceMaterialAttributeTuple(mat, plugNormal, plugTangent, plugAlpha);
     };
 
-    construct(context, ASSETS_DIR"San_Miguel/san-miguel.obj", false, true, &modelNode, sanMiguelMaterialFunc);
+    construct(context, ASSETS_DIR"San_Miguel/san-miguel.obj", false, true, &modelNode, sanMiguelMaterialFunc,
+              perMeshDefaultFunction, defaultMaterialTextureSlots);
     shot->scene->addChild(modelNode);
     modelNode->setTransform(context->createStaticTransform(translate<float>(0, 0, 0) * scale<float>(1.0f)));
 
@@ -2643,5 +3048,10 @@ void createScene(const vlr::ContextRef &context, Shot* shot) {
     //createAmazonBistroExteriorScene(context, shot);
     //createAmazonBistroInteriorScene(context, shot);
     //createSanMiguelScene(context, shot);
+
+    // JP: 各シーン関数はシーンを作った直後に編集を開始する。ノードの追加によるIASの変更をここでまとめて反映する。
+    // EN: Each scene function begins edits right after creating the scene.
+    //     Changes to the IAS caused by adding nodes are reflected at once here.
+    shot->scene->commitEdits();
     context->setScene(shot->scene);
 }
@@ -36,8 +36,38 @@ SurfaceMaterialAttributeTuple createMaterialDefaultFunction(const vlr::ContextRe
 
 MeshAttributeTuple perMeshDefaultFunction(const aiMesh* mesh);
 
+// JP: construct()で内容が同一のメッシュを1つのサーフェスノードにまとめ、複数のノードから参照させる。
+//     canonicalizeTranslationが有効な場合は平行移動だけが異なるメッシュもまとめる。
+// EN: Make construct() merge meshes with identical contents into a single surface node referenced from multiple nodes.
+//     When canonicalizeTranslation is enabled, meshes differing only by a translation are merged as well.
+void setMeshInstancing(bool enable, bool canonicalizeTranslation);
+
+// JP: construct()で作るメッシュの頂点をコンパクトな頂点形式で保持させる。
+// EN: Make meshes created by construct() hold their vertices in the compact vertex format.
+void setCompactVertexFormat(bool enable);
+
+// JP: マテリアル関数がaiMaterialから読み込むテクスチャー。
+//     スペクトルタイプと色空間はマテリアル関数内のloadImage2D()の呼び出しと一致する必要がある。
+// EN: A texture that a material function loads from aiMaterial.
+//     The spectrum type and color space need to match the loadImage2D() call in the material function.
+struct MaterialTextureSlot {
+    aiTextureType type;
+    uint32_t index;
+    const char* spectrumType;
+    const char* colorSpace;
+};
+
+// JP: createMaterialDefaultFunction()が読み込むテクスチャー。
+// EN: Textures that createMaterialDefaultFunction() loads.
+extern const std::vector<MaterialTextureSlot> defaultMaterialTextureSlots;
+
+// JP: マテリアルを作る前に、各マテリアルのpreloadSlotsに対応するテクスチャーを並列にデコードしておく。
+//     preloadSlotsはmatFuncが実際に読み込むものだけを挙げる。空の場合は先読みしない。
+// EN: Decode the textures of each material corresponding to preloadSlots in parallel before creating materials.
+//     preloadSlots should list only those matFunc actually loads. No textures are preloaded when it is empty.
 static void construct(const vlr::ContextRef &context, const std::string &filePath, bool flipWinding, bool flipV, vlr::InternalNodeRef* nodeOut,
-                      CreateMaterialFunction matFunc = createMaterialDefaultFunction, PerMeshFunction meshFunc = perMeshDefaultFunction);
+                      CreateMaterialFunction matFunc = createMaterialDefaultFunction, PerMeshFunction meshFunc = perMeshDefaultFunction,
+                      const std::vector<MaterialTextureSlot> &preloadSlots = {});
 
 
 
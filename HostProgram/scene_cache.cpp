@@ -0,0 +1,523 @@
+#include "scene_cache.h"
+#include "mapped_file.h"
+
+#include <cstring>
+
+static std::filesystem::path s_sceneCacheDirectory;
+
+// JP: ファイルの構成:
+//     ヘッダー、ノード、ノードのメッシュ番号、メッシュ、マテリアル、マテリアルのプロパティ、文字列、プロパティのデータ、
+//     各メッシュの頂点とインデックス。全てDataAlignmentにアラインする。
+//     ノードは幅優先で並べるので各ノードの子は連続し、子の番号は常に親より大きい。
+// EN: File layout:
+//     header, nodes, mesh indices of nodes, meshes, materials, material properties, strings, property data,
+//     vertices and indices of each mesh. Everything is aligned to DataAlignment.
+//     Nodes are stored in breadth-first order, so children of each node are contiguous
+//     and the index of a child is always greater than its parent.
+static constexpr uint32_t SceneCacheMagic = 0x53524C56; // "VLRS"
+static constexpr uint32_t SceneCacheVersion = 1;
+static constexpr uint64_t DataAlignment = 64;
+
+struct SceneCacheSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct SceneCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t flags;
+    uint64_t sourceSize;
+    int64_t sourceWriteTime;
+    uint64_t fileSize;
+    uint32_t numNodes;
+    uint32_t numMeshes;
+    uint32_t numMaterials;
+    uint32_t numProperties;
+    SceneCacheSection nodes;
+    SceneCacheSection nodeMeshIndices;
+    SceneCacheSection meshes;
+    SceneCacheSection materials;
+    SceneCacheSection properties;
+    SceneCacheSection strings;
+    SceneCacheSection propertyData;
+};
+
+struct SceneCacheNode {
+    float transform[16];
+    uint32_t nameOffset;
+    uint32_t firstMeshIndex;
+    uint32_t numMeshes;
+    uint32_t firstChild;
+    uint32_t numChildren;
+    uint32_t padding[3];
+};
+
+struct SceneCacheMesh {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint32_t materialIndex;
+    uint32_t primitiveTypes;
+    uint32_t nameOffset;
+    uint32_t padding;
+};
+
+struct SceneCacheMaterial {
+    uint32_t firstProperty;
+    uint32_t numProperties;
+};
+
+// JP: aiMaterialPropertyをそのまま保存する。dataOffsetはプロパティのデータのセクション内のオフセット。
+// EN: Stores aiMaterialProperty as is. dataOffset is the offset within the property data section.
+struct SceneCacheProperty {
+    uint64_t dataOffset;
+    uint32_t dataSize;
+    uint32_t keyOffset;
+    uint32_t semantic;
+    uint32_t index;
+    uint32_t type;
+    uint32_t padding;
+};
+
+enum SceneCacheFlag : uint32_t {
+    SceneCacheFlag_FlipWinding = 1 << 0,
+    SceneCacheFlag_FlipV = 1 << 1,
+};
+
+
+
+void setSceneCacheDirectory(const std::filesystem::path &dirPath) {
+    s_sceneCacheDirectory = dirPath;
+    if (s_sceneCacheDirectory.empty())
+        return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(s_sceneCacheDirectory, ec);
+    if (ec) {
+        hpprintf("Failed to create the scene cache directory %s, the cache is disabled.\n",
+                 s_sceneCacheDirectory.string().c_str());
+        s_sceneCacheDirectory.clear();
+    }
+}
+
+bool sceneCacheEnabled() {
+    return !s_sceneCacheDirectory.empty();
+}
+
+void convertMeshGeometry(const aiMesh* mesh, std::vector<vlr::Vertex>* vertices, std::vector<uint32_t>* indices) {
+    using namespace vlr;
+
+    vertices->clear();
+    vertices->reserve(mesh->mNumVertices);
+    for (int v = 0; v < mesh->mNumVertices; ++v) {
+        const aiVector3D &p = mesh->mVertices[v];
+        const aiVector3D &n = mesh->mNormals[v];
+        Vector3D tangent, bitangent;
+        if (mesh->mTangents == nullptr)
+            Normal3D(n.x, n.y, n.z).makeCoordinateSystem(&tangent, &bitangent);
+        aiVector3D t(NAN, NAN, NAN);
+        if (mesh->mTangents)
+            t = mesh->mTangents[v];
+        if (!std::isfinite(t.x) || !std::isfinite(t.y) || !std::isfinite(t.z))
+            t = aiVector3D(tangent[0], tangent[1], tangent[2]);
+        const aiVector3D &uv = mesh->mNumUVComponents[0] > 0 ? mesh->mTextureCoords[0][v] : aiVector3D(0, 0, 0);
+
+        Vertex outVtx{ Point3D(p.x, p.y, p.z), Normal3D(n.x, n.y, n.z), Vector3D(t.x, t.y, t.z), TexCoord2D(uv.x, uv.y) };
+        float dotNT = dot(outVtx.normal, outVtx.tc0Direction);
+        if (std::fabs(dotNT) >= 0.01f)
+            outVtx.tc0Direction = normalize(outVtx.tc0Direction - dotNT * outVtx.normal);
+        //VLRAssert(absDot(outVtx.normal, outVtx.tc0Direction) < 0.01f, "shading normal and tangent must be orthogonal: %g", absDot(outVtx.normal, outVtx.tangent));
+        vertices->push_back(outVtx);
+    }
+
+    indices->clear();
+    indices->reserve(3 * mesh->mNumFaces);
+    for (int f = 0; f < mesh->mNumFaces; ++f) {
+        const aiFace &face = mesh->mFaces[f];
+        indices->push_back(face.mIndices[0]);
+        indices->push_back(face.mIndices[1]);
+        indices->push_back(face.mIndices[2]);
+    }
+}
+
+static uint32_t getSceneCacheFlags(bool flipWinding, bool flipV) {
+    return (flipWinding ? SceneCacheFlag_FlipWinding : 0) | (flipV ? SceneCacheFlag_FlipV : 0);
+}
+
+static bool getSourceStamp(const std::string &filePath, uint64_t* size, int64_t* writeTime) {
+    std::error_code ec;
+    *size = static_cast<uint64_t>(std::filesystem::file_size(filePath, ec));
+    if (ec)
+        return false;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(filePath, ec);
+    if (ec)
+        return false;
+    *writeTime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+// JP: ファイル名は元ファイルの名前と、絶対パスと読み込みフラグのハッシュから作る。
+// EN: The file name is made from the name of the source file and the hash of the absolute path and loading flags.
+static std::filesystem::path getSceneCachePath(const std::string &filePath, bool flipWinding, bool flipV) {
+    std::error_code ec;
+    std::filesystem::path absPath = std::filesystem::absolute(filePath, ec);
+    std::string key = (ec ? std::filesystem::path(filePath) : absPath).generic_string();
+    key += "|" + std::to_string(getSceneCacheFlags(flipWinding, flipV));
+
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : key) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001B3ull;
+    }
+    char hashStr[17];
+    snprintf(hashStr, sizeof(hashStr), "%016llx", static_cast<unsigned long long>(hash));
+
+    return s_sceneCacheDirectory /
+        (std::filesystem::path(filePath).stem().string() + "_" + hashStr + ".vlrscene");
+}
+
+static uint64_t alignOffset(uint64_t offset) {
+    return (offset + DataAlignment - 1) / DataAlignment * DataAlignment;
+}
+
+
+
+bool readSceneCache(const std::string &filePath, bool flipWinding, bool flipV, CachedScene* cachedScene) {
+    if (!sceneCacheEnabled())
+        return false;
+
+    uint64_t sourceSize;
+    int64_t sourceWriteTime;
+    if (!getSourceStamp(filePath, &sourceSize, &sourceWriteTime))
+        return false;
+
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(getSceneCachePath(filePath, flipWinding, flipV)))
+        return false;
+    const uint8_t* fileData = file->data();
+    uint64_t fileSize = file->size();
+    if (fileSize < sizeof(SceneCacheHeader))
+        return false;
+
+    SceneCacheHeader header;
+    std::memcpy(&header, fileData, sizeof(header));
+    if (header.magic != SceneCacheMagic || header.version != SceneCacheVersion ||
+        header.vertexSize != sizeof(vlr::Vertex) || header.flags != getSceneCacheFlags(flipWinding, flipV) ||
+        header.sourceSize != sourceSize || header.sourceWriteTime != sourceWriteTime ||
+        header.fileSize != fileSize || header.numNodes == 0)
+        return false;
+
+    const auto sectionIsValid = [&](const SceneCacheSection &section, uint64_t elementSize) {
+        return section.offset % DataAlignment == 0 &&
+            section.offset <= fileSize && section.size <= fileSize - section.offset &&
+            section.size % elementSize == 0;
+    };
+    if (!sectionIsValid(header.nodes, sizeof(SceneCacheNode)) ||
+        !sectionIsValid(header.nodeMeshIndices, sizeof(uint32_t)) ||
+        !sectionIsValid(header.meshes, sizeof(SceneCacheMesh)) ||
+        !sectionIsValid(header.materials, sizeof(SceneCacheMaterial)) ||
+        !sectionIsValid(header.properties, sizeof(SceneCacheProperty)) ||
+        !sectionIsValid(header.strings, 1) ||
+        !sectionIsValid(header.propertyData, 1))
+        return false;
+    if (header.nodes.size / sizeof(SceneCacheNode) != header.numNodes ||
+        header.meshes.size / sizeof(SceneCacheMesh) != header.numMeshes ||
+        header.materials.size / sizeof(SceneCacheMaterial) != header.numMaterials ||
+        header.properties.size / sizeof(SceneCacheProperty) != header.numProperties ||
+        header.strings.size == 0 || fileData[header.strings.offset + header.strings.size - 1] != '\0')
+        return false;
+
+    // JP: セクションはアラインされているので、マップしたファイルを構造体として直接参照する。
+    // EN: Sections are aligned, so refer to the mapped file directly as structures.
+    const auto* nodes = reinterpret_cast<const SceneCacheNode*>(fileData + header.nodes.offset);
+    const auto* nodeMeshIndices = reinterpret_cast<const uint32_t*>(fileData + header.nodeMeshIndices.offset);
+    const auto* meshes = reinterpret_cast<const SceneCacheMesh*>(fileData + header.meshes.offset);
+    const auto* materials = reinterpret_cast<const SceneCacheMaterial*>(fileData + header.materials.offset);
+    const auto* properties = reinterpret_cast<const SceneCacheProperty*>(fileData + header.properties.offset);
+    const char* strings = reinterpret_cast<const char*>(fileData + header.strings.offset);
+    const uint8_t* propertyData = fileData + header.propertyData.offset;
+    uint64_t numNodeMeshIndices = header.nodeMeshIndices.size / sizeof(uint32_t);
+
+    // JP: 構築の途中で失敗しないよう、先に全ての参照を検証する。
+    //     子の範囲が重なると同じノードを2回削除することになるので、各ノードの親が1つであることも確かめる。
+    // EN: Validate all the references first so that the construction doesn't fail halfway.
+    //     Overlapping child ranges would delete the same node twice, so also check that each node has a single parent.
+    std::vector<bool> hasParent(header.numNodes, false);
+    for (uint32_t i = 0; i < header.numNodes; ++i) {
+        const SceneCacheNode &node = nodes[i];
+        if (node.nameOffset >= header.strings.size ||
+            static_cast<uint64_t>(node.firstMeshIndex) + node.numMeshes > numNodeMeshIndices)
+            return false;
+        for (uint32_t m = 0; m < node.numMeshes; ++m) {
+            if (nodeMeshIndices[node.firstMeshIndex + m] >= header.numMeshes)
+                return false;
+        }
+        if (node.numChildren == 0)
+            continue;
+        if (node.firstChild <= i || static_cast<uint64_t>(node.firstChild) + node.numChildren > header.numNodes)
+            return false;
+        for (uint32_t c = 0; c < node.numChildren; ++c) {
+            if (hasParent[node.firstChild + c])
+                return false;
+            hasParent[node.firstChild + c] = true;
+        }
+    }
+    for (uint32_t i = 0; i < header.numMeshes; ++i) {
+        const SceneCacheMesh &mesh = meshes[i];
+        uint64_t vertexSize = sizeof(vlr::Vertex) * static_cast<uint64_t>(mesh.numVertices);
+        uint64_t indexSize = sizeof(uint32_t) * static_cast<uint64_t>(mesh.numIndices);
+        if (mesh.nameOffset >= header.strings.size || mesh.materialIndex >= header.numMaterials ||
+            mesh.numIndices % 3 != 0 ||
+            mesh.vertexOffset % DataAlignment != 0 || mesh.vertexOffset > fileSize || vertexSize > fileSize - mesh.vertexOffset ||
+            mesh.indexOffset % DataAlignment != 0 || mesh.indexOffset > fileSize || indexSize > fileSize - mesh.indexOffset)
+            return false;
+
+        // JP: 範囲外の頂点インデックスは面積やAABBの計算とGPU上で範囲外アクセスになるので、壊れたキャッシュとして扱う。
+        // EN: Out-of-range vertex indices would access out of bounds in the area and AABB computation and on the GPU,
+        //     so treat them as a corrupt cache.
+        const auto* indices = reinterpret_cast<const uint32_t*>(fileData + mesh.indexOffset);
+        for (uint32_t k = 0; k < mesh.numIndices; ++k) {
+            if (indices[k] >= mesh.numVertices)
+                return false;
+        }
+    }
+    for (uint32_t i = 0; i < header.numMaterials; ++i) {
+        const SceneCacheMaterial &mat = materials[i];
+        if (static_cast<uint64_t>(mat.firstProperty) + mat.numProperties > header.numProperties)
+            return false;
+    }
+    for (uint32_t i = 0; i < header.numProperties; ++i) {
+        const SceneCacheProperty &prop = properties[i];
+        if (prop.keyOffset >= header.strings.size ||
+            prop.dataOffset > header.propertyData.size || prop.dataSize > header.propertyData.size - prop.dataOffset)
+            return false;
+    }
+
+    std::unique_ptr<aiScene> scene(new aiScene());
+
+    scene->mNumMaterials = header.numMaterials;
+    scene->mMaterials = new aiMaterial*[header.numMaterials];
+    for (uint32_t i = 0; i < header.numMaterials; ++i) {
+        const SceneCacheMaterial &mat = materials[i];
+        aiMaterial* aiMat = new aiMaterial();
+        for (uint32_t p = 0; p < mat.numProperties; ++p) {
+            const SceneCacheProperty &prop = properties[mat.firstProperty + p];
+            aiMat->AddBinaryProperty(propertyData + prop.dataOffset, prop.dataSize, strings + prop.keyOffset,
+                                     prop.semantic, prop.index, static_cast<aiPropertyTypeInfo>(prop.type));
+        }
+        scene->mMaterials[i] = aiMat;
+    }
+
+    scene->mNumMeshes = header.numMeshes;
+    scene->mMeshes = new aiMesh*[header.numMeshes];
+    cachedScene->geometries.resize(header.numMeshes);
+    for (uint32_t i = 0; i < header.numMeshes; ++i) {
+        const SceneCacheMesh &mesh = meshes[i];
+        aiMesh* aiMsh = new aiMesh();
+        aiMsh->mName.Set(strings + mesh.nameOffset);
+        aiMsh->mMaterialIndex = mesh.materialIndex;
+        aiMsh->mPrimitiveTypes = mesh.primitiveTypes;
+        scene->mMeshes[i] = aiMsh;
+
+        MeshGeometryView &geom = cachedScene->geometries[i];
+        geom.vertices = reinterpret_cast<const vlr::Vertex*>(fileData + mesh.vertexOffset);
+        geom.numVertices = mesh.numVertices;
+        geom.indices = reinterpret_cast<const uint32_t*>(fileData + mesh.indexOffset);
+        geom.numIndices = mesh.numIndices;
+    }
+
+    std::vector<aiNode*> aiNodes(header.numNodes);
+    for (uint32_t i = 0; i < header.numNodes; ++i) {
+        const SceneCacheNode &node = nodes[i];
+        aiNode* aiNd = new aiNode(strings + node.nameOffset);
+        std::memcpy(&aiNd->mTransformation, node.transform, sizeof(node.transform));
+        aiNd->mNumMeshes = node.numMeshes;
+        if (node.numMeshes > 0) {
+            aiNd->mMeshes = new unsigned int[node.numMeshes];
+            for (uint32_t m = 0; m < node.numMeshes; ++m)
+                aiNd->mMeshes[m] = nodeMeshIndices[node.firstMeshIndex + m];
+        }
+        aiNodes[i] = aiNd;
+    }
+    for (uint32_t i = 0; i < header.numNodes; ++i) {
+        const SceneCacheNode &node = nodes[i];
+        aiNode* aiNd = aiNodes[i];
+        aiNd->mNumChildren = node.numChildren;
+        if (node.numChildren > 0) {
+            aiNd->mChildren = new aiNode*[node.numChildren];
+            for (uint32_t c = 0; c < node.numChildren; ++c) {
+                aiNode* child = aiNodes[node.firstChild + c];
+                child->mParent = aiNd;
+                aiNd->mChildren[c] = child;
+            }
+        }
+    }
+    // JP: どの親からも参照されないノードは階層に含まれないので削除する。
+    // EN: Nodes not referenced from any parent aren't part of the hierarchy, so delete them.
+    for (uint32_t i = 1; i < header.numNodes; ++i) {
+        if (!hasParent[i])
+            delete aiNodes[i];
+    }
+    scene->mRootNode = aiNodes[0];
+
+    cachedScene->scene = std::move(scene);
+    cachedScene->mappedFile = file;
+
+    return true;
+}
+
+void storeSceneCache(const std::string &filePath, bool flipWinding, bool flipV,
+                     const aiScene* scene, const MeshGeometryView* geometries) {
+    if (!sceneCacheEnabled())
+        return;
+
+    SceneCacheHeader header = {};
+    header.magic = SceneCacheMagic;
+    header.version = SceneCacheVersion;
+    header.vertexSize = sizeof(vlr::Vertex);
+    header.flags = getSceneCacheFlags(flipWinding, flipV);
+    if (!getSourceStamp(filePath, &header.sourceSize, &header.sourceWriteTime))
+        return;
+
+    std::vector<char> strings;
+    const auto addString = [&strings](const aiString &str) {
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), str.C_Str(), str.C_Str() + str.length);
+        strings.push_back('\0');
+        return offset;
+    };
+
+    std::vector<SceneCacheNode> nodes;
+    std::vector<uint32_t> nodeMeshIndices;
+    std::vector<const aiNode*> nodeQueue = { scene->mRootNode };
+    for (size_t i = 0; i < nodeQueue.size(); ++i) {
+        const aiNode* aiNd = nodeQueue[i];
+        SceneCacheNode node = {};
+        const aiMatrix4x4 &tf = aiNd->mTransformation;
+        const float tfElems[] = {
+            tf.a1, tf.a2, tf.a3, tf.a4,
+            tf.b1, tf.b2, tf.b3, tf.b4,
+            tf.c1, tf.c2, tf.c3, tf.c4,
+            tf.d1, tf.d2, tf.d3, tf.d4,
+        };
+        std::memcpy(node.transform, tfElems, sizeof(node.transform));
+        node.nameOffset = addString(aiNd->mName);
+        node.firstMeshIndex = static_cast<uint32_t>(nodeMeshIndices.size());
+        node.numMeshes = aiNd->mNumMeshes;
+        nodeMeshIndices.insert(nodeMeshIndices.end(), aiNd->mMeshes, aiNd->mMeshes + aiNd->mNumMeshes);
+        node.firstChild = static_cast<uint32_t>(nodeQueue.size());
+        node.numChildren = aiNd->mNumChildren;
+        nodeQueue.insert(nodeQueue.end(), aiNd->mChildren, aiNd->mChildren + aiNd->mNumChildren);
+        nodes.push_back(node);
+    }
+
+    std::vector<SceneCacheMesh> meshes(scene->mNumMeshes);
+    for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
+        const aiMesh* aiMsh = scene->mMeshes[i];
+        SceneCacheMesh &mesh = meshes[i];
+        mesh = {};
+        mesh.numVertices = geometries[i].numVertices;
+        mesh.numIndices = geometries[i].numIndices;
+        mesh.materialIndex = aiMsh->mMaterialIndex;
+        mesh.primitiveTypes = aiMsh->mPrimitiveTypes;
+        mesh.nameOffset = addString(aiMsh->mName);
+    }
+
+    std::vector<SceneCacheMaterial> materials(scene->mNumMaterials);
+    std::vector<SceneCacheProperty> properties;
+    std::vector<uint8_t> propertyData;
+    for (uint32_t i = 0; i < scene->mNumMaterials; ++i) {
+        const aiMaterial* aiMat = scene->mMaterials[i];
+        materials[i].firstProperty = static_cast<uint32_t>(properties.size());
+        materials[i].numProperties = aiMat->mNumProperties;
+        for (uint32_t p = 0; p < aiMat->mNumProperties; ++p) {
+            const aiMaterialProperty* aiProp = aiMat->mProperties[p];
+            SceneCacheProperty prop = {};
+            prop.dataOffset = propertyData.size();
+            prop.dataSize = aiProp->mDataLength;
+            prop.keyOffset = addString(aiProp->mKey);
+            prop.semantic = aiProp->mSemantic;
+            prop.index = aiProp->mIndex;
+            prop.type = static_cast<uint32_t>(aiProp->mType);
+            propertyData.insert(propertyData.end(), aiProp->mData, aiProp->mData + aiProp->mDataLength);
+            properties.push_back(prop);
+        }
+    }
+
+    header.numNodes = static_cast<uint32_t>(nodes.size());
+    header.numMeshes = scene->mNumMeshes;
+    header.numMaterials = scene->mNumMaterials;
+    header.numProperties = static_cast<uint32_t>(properties.size());
+
+    uint64_t offset = sizeof(SceneCacheHeader);
+    const auto placeSection = [&offset](SceneCacheSection* section, uint64_t size) {
+        offset = alignOffset(offset);
+        section->offset = offset;
+        section->size = size;
+        offset += size;
+    };
+    placeSection(&header.nodes, sizeof(SceneCacheNode) * nodes.size());
+    placeSection(&header.nodeMeshIndices, sizeof(uint32_t) * nodeMeshIndices.size());
+    placeSection(&header.meshes, sizeof(SceneCacheMesh) * meshes.size());
+    placeSection(&header.materials, sizeof(SceneCacheMaterial) * materials.size());
+    placeSection(&header.properties, sizeof(SceneCacheProperty) * properties.size());
+    placeSection(&header.strings, strings.size());
+    placeSection(&header.propertyData, propertyData.size());
+    for (SceneCacheMesh &mesh : meshes) {
+        offset = alignOffset(offset);
+        mesh.vertexOffset = offset;
+        offset += sizeof(vlr::Vertex) * static_cast<uint64_t>(mesh.numVertices);
+        offset = alignOffset(offset);
+        mesh.indexOffset = offset;
+        offset += sizeof(uint32_t) * static_cast<uint64_t>(mesh.numIndices);
+    }
+    header.fileSize = offset;
+
+    // JP: 書きかけのファイルを読まないように一時ファイルに書いてからリネームする。
+    // EN: Write to a temporary file and rename it so that a partially written file is never read.
+    std::filesystem::path path = getSceneCachePath(filePath, flipWinding, flipV);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream ofs(tempPath, std::ios::binary);
+        if (!ofs) {
+            hpprintf("Failed to write the scene cache %s.\n", tempPath.string().c_str());
+            return;
+        }
+        uint64_t position = 0;
+        const auto writeAt = [&ofs, &position](uint64_t dstOffset, const void* data, uint64_t size) {
+            const char padding[DataAlignment] = {};
+            ofs.write(padding, static_cast<std::streamsize>(dstOffset - position));
+            ofs.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+            position = dstOffset + size;
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.nodes.offset, nodes.data(), header.nodes.size);
+        writeAt(header.nodeMeshIndices.offset, nodeMeshIndices.data(), header.nodeMeshIndices.size);
+        writeAt(header.meshes.offset, meshes.data(), header.meshes.size);
+        writeAt(header.materials.offset, materials.data(), header.materials.size);
+        writeAt(header.properties.offset, properties.data(), header.properties.size);
+        writeAt(header.strings.offset, strings.data(), header.strings.size);
+        writeAt(header.propertyData.offset, propertyData.data(), header.propertyData.size);
+        for (uint32_t i = 0; i < scene->mNumMeshes; ++i) {
+            const SceneCacheMesh &mesh = meshes[i];
+            writeAt(mesh.vertexOffset, geometries[i].vertices, sizeof(vlr::Vertex) * static_cast<uint64_t>(mesh.numVertices));
+            writeAt(mesh.indexOffset, geometries[i].indices, sizeof(uint32_t) * static_cast<uint64_t>(mesh.numIndices));
+        }
+        if (!ofs) {
+            hpprintf("Failed to write the scene cache %s.\n", tempPath.string().c_str());
+            ofs.close();
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        std::filesystem::remove(tempPath, ec);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "common.h"
+
+#include <VLR/vlrcpp.h>
+
+#include <assimp/scene.h>
+
+#include <memory>
+#include <vector>
+
+// JP: assimpで読み込んだシーンのバイナリキャッシュ(.vlrscene)。
+//     ノード階層、トランスフォーム、vlr::Vertexに変換済みの頂点とインデックス、マテリアルのプロパティ(テクスチャーのパスを含む)を保持する。
+//     各セクションとメッシュごとのデータはアラインしたオフセットに置くので、ファイルをメモリにマップしてそのまま参照できる。
+//     キャッシュは元ファイルのパスと読み込みフラグごとに作られ、元ファイルのサイズか更新日時が変わると無効になる。
+//     OBJから参照されるMTLなどの変更は検知しない。
+// EN: Binary cache (.vlrscene) of scenes read by assimp.
+//     Holds the node hierarchy, transforms, vertices already converted into vlr::Vertex, indices,
+//     and material properties (including texture paths).
+//     Each section and per-mesh data are placed at aligned offsets,
+//     so the file can be mapped into memory and referenced as is.
+//     A cache is created per source file path and loading flags,
+//     and is invalidated when the size or the modification time of the source file changes.
+//     Changes of files referenced by the source such as MTL of OBJ aren't detected.
+
+struct MeshGeometryView {
+    const vlr::Vertex* vertices;
+    uint32_t numVertices;
+    const uint32_t* indices;
+    uint32_t numIndices;
+};
+
+// JP: キャッシュから復元したシーン。
+//     aiSceneはノード、マテリアルとメッシュのメタデータ(名前、マテリアル番号、プリミティブの種類)のみを持ち、
+//     aiMeshに頂点配列は無い。ジオメトリはマップしたファイルを指すgeometriesから取る。
+// EN: Scene restored from the cache.
+//     aiScene only has nodes, materials and metadata of meshes (name, material index, primitive types),
+//     and aiMesh has no vertex arrays. Geometry is taken from geometries pointing into the mapped file.
+struct CachedScene {
+    std::unique_ptr<aiScene> scene;
+    std::vector<MeshGeometryView> geometries;
+    std::shared_ptr<const void> mappedFile;
+};
+
+// JP: 空のパスを指定するとキャッシュを無効にする(デフォルト)。
+// EN: Specifying an empty path disables the cache (default).
+void setSceneCacheDirectory(const std::filesystem::path &dirPath);
+bool sceneCacheEnabled();
+
+// JP: aiMeshの頂点とインデックスをキャッシュが保持する形式(vlr::Vertexと三角形のインデックス)に変換する。
+// EN: Converts vertices and indices of aiMesh into the form the cache holds (vlr::Vertex and triangle indices).
+void convertMeshGeometry(const aiMesh* mesh, std::vector<vlr::Vertex>* vertices, std::vector<uint32_t>* indices);
+
+// JP: 有効なキャッシュが存在すれば読み込む。存在しないか不正な場合はfalseを返す。
+// EN: Read the cache if a valid one exists. Returns false when missing or malformed.
+bool readSceneCache(const std::string &filePath, bool flipWinding, bool flipV, CachedScene* cachedScene);
+
+// JP: geometriesはシーンのメッシュごとの変換済みのデータ。三角形メッシュ以外は空で良い。
+// EN: geometries is the converted data per mesh of the scene. It can be empty for non-triangle meshes.
+void storeSceneCache(const std::string &filePath, bool flipWinding, bool flipV,
+                     const aiScene* scene, const MeshGeometryView* geometries);
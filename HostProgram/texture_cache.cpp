@@ -0,0 +1,202 @@
+#include "texture_cache.h"
+#include "mapped_file.h"
+
+#include <cstring>
+
+static std::filesystem::path s_textureCacheDirectory;
+
+// JP: ファイルの構成:
+//     ヘッダー、レベル表(オフセット, サイズ) x レベル数、各レベルのデータ(LevelAlignmentにアライン)
+// EN: File layout:
+//     header, level table (offset, size) x number of levels, data of each level (aligned to LevelAlignment)
+static constexpr uint32_t TextureCacheMagic = 0x54524C56; // "VLRT"
+static constexpr uint32_t TextureCacheVersion = 1;
+static constexpr uint64_t LevelAlignment = 64;
+
+struct TextureCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t numLevels;
+    char originalFormat[24];
+    char dataFormat[24];
+};
+
+struct TextureCacheLevel {
+    uint64_t offset;
+    uint64_t size;
+};
+
+
+
+void setTextureCacheDirectory(const std::filesystem::path &dirPath) {
+    s_textureCacheDirectory = dirPath;
+    if (s_textureCacheDirectory.empty())
+        return;
+
+    std::error_code ec;
+    std::filesystem::create_directories(s_textureCacheDirectory, ec);
+    if (ec) {
+        hpprintf("Failed to create the texture cache directory %s, the cache is disabled.\n",
+                 s_textureCacheDirectory.string().c_str());
+        s_textureCacheDirectory.clear();
+    }
+}
+
+bool textureCacheEnabled() {
+    return !s_textureCacheDirectory.empty();
+}
+
+
+
+// JP: キーは元ファイルの絶対パス、サイズ、更新日時のハッシュにする。ファイルの中身は読まないので、
+//     キャッシュにヒットした場合は元ファイルに触れず、ミスした場合もデコードで一度読むだけで済む。
+// EN: The key is the hash of the absolute path, the size and the modification time of the source file.
+//     The file content isn't read, so a cache hit doesn't touch the source file,
+//     and a miss reads it only once for decoding.
+bool computeTextureCacheKey(const vlr::ContextRef &context, const std::string &filepath,
+                            const std::string &spectrumType, const std::string &colorSpace,
+                            std::string* key) {
+    std::error_code ec;
+    uint64_t fileSize = static_cast<uint64_t>(std::filesystem::file_size(filepath, ec));
+    if (ec)
+        return false;
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(filepath, ec);
+    if (ec)
+        return false;
+    std::filesystem::path absPath = std::filesystem::absolute(filepath, ec);
+    std::string source = (ec ? std::filesystem::path(filepath) : absPath).generic_string();
+    source += "|" + std::to_string(fileSize) + "|" + std::to_string(writeTime.time_since_epoch().count());
+
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (char c : source) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001B3ull;
+    }
+    char hashStr[17];
+    snprintf(hashStr, sizeof(hashStr), "%016llx", static_cast<unsigned long long>(hash));
+
+    const auto tolower = [](std::string str) {
+        const auto tolower = [](unsigned char c) { return std::tolower(c); };
+        std::transform(str.cbegin(), str.cend(), str.begin(), tolower);
+        return str;
+    };
+
+    *key = std::filesystem::path(filepath).stem().string() + "_" + hashStr + "_" +
+        tolower(spectrumType) + "_" + tolower(colorSpace) + "_" + tolower(context->getBuildFlavor());
+    return true;
+}
+
+static std::filesystem::path getTextureCachePath(const std::string &key) {
+    return s_textureCacheDirectory / (key + ".vlrtex");
+}
+
+
+
+bool readCachedTexture(const std::string &key, DecodedImage* image) {
+    if (!textureCacheEnabled())
+        return false;
+
+    // JP: ファイルをマップし、各レベルはマップした領域を直接指したまま所有権ごとlibVLRに渡す。
+    // EN: Map the file and hand it over to libVLR with each level pointing directly into the mapped region.
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(getTextureCachePath(key)))
+        return false;
+    const uint8_t* fileData = file->data();
+    uint64_t fileSize = file->size();
+    if (fileSize < sizeof(TextureCacheHeader))
+        return false;
+
+    TextureCacheHeader header;
+    std::memcpy(&header, fileData, sizeof(header));
+    header.originalFormat[sizeof(header.originalFormat) - 1] = '\0';
+    header.dataFormat[sizeof(header.dataFormat) - 1] = '\0';
+    uint64_t levelTableEnd = sizeof(TextureCacheHeader) + sizeof(TextureCacheLevel) * static_cast<uint64_t>(header.numLevels);
+    if (header.magic != TextureCacheMagic || header.version != TextureCacheVersion ||
+        header.numLevels == 0 || levelTableEnd > fileSize)
+        return false;
+
+    std::vector<uint8_t*> levelData(header.numLevels);
+    std::vector<size_t> levelSizes(header.numLevels);
+    for (uint32_t i = 0; i < header.numLevels; ++i) {
+        TextureCacheLevel level;
+        std::memcpy(&level, fileData + sizeof(TextureCacheHeader) + sizeof(TextureCacheLevel) * i, sizeof(level));
+        if (level.offset < levelTableEnd || level.offset > fileSize || level.size > fileSize - level.offset)
+            return false;
+        levelData[i] = const_cast<uint8_t*>(fileData + level.offset);
+        levelSizes[i] = static_cast<size_t>(level.size);
+    }
+
+    image->reset();
+    image->kind = DecodedImage::Kind::Converted;
+    image->width = header.width;
+    image->height = header.height;
+    image->originalFormat = header.originalFormat;
+    image->format = header.dataFormat;
+    image->levels = std::move(levelData);
+    image->sizes = std::move(levelSizes);
+    image->release = [](void* userData) { delete static_cast<MappedFile*>(userData); };
+    image->userData = file.release();
+    image->textureCacheKey = key;
+
+    return true;
+}
+
+void storeCachedTexture(const std::string &key, const vlr::LinearImage2DRef &image) {
+    if (!textureCacheEnabled())
+        return;
+
+    TextureCacheHeader header = {};
+    header.magic = TextureCacheMagic;
+    header.version = TextureCacheVersion;
+    header.width = image->getWidth();
+    header.height = image->getHeight();
+    header.numLevels = image->getNumMipmapLevels();
+    snprintf(header.originalFormat, sizeof(header.originalFormat), "%s", image->getOriginalDataFormat());
+    snprintf(header.dataFormat, sizeof(header.dataFormat), "%s", image->getDataFormat());
+
+    std::vector<TextureCacheLevel> levels(header.numLevels);
+    uint64_t offset = sizeof(TextureCacheHeader) + sizeof(TextureCacheLevel) * static_cast<uint64_t>(header.numLevels);
+    for (uint32_t i = 0; i < header.numLevels; ++i) {
+        offset = (offset + LevelAlignment - 1) / LevelAlignment * LevelAlignment;
+        levels[i].offset = offset;
+        levels[i].size = image->copyLevelData(i, nullptr);
+        offset += levels[i].size;
+    }
+
+    // JP: 書きかけのファイルを読まないように一時ファイルに書いてからリネームする。
+    // EN: Write to a temporary file and rename it so that a partially written file is never read.
+    std::filesystem::path path = getTextureCachePath(key);
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream ofs(tempPath, std::ios::binary);
+        if (!ofs) {
+            hpprintf("Failed to write the texture cache %s.\n", tempPath.string().c_str());
+            return;
+        }
+        ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        ofs.write(reinterpret_cast<const char*>(levels.data()), sizeof(TextureCacheLevel) * levels.size());
+        std::vector<uint8_t> levelData;
+        for (uint32_t i = 0; i < header.numLevels; ++i) {
+            const char padding[LevelAlignment] = {};
+            ofs.write(padding, static_cast<std::streamsize>(levels[i].offset - static_cast<uint64_t>(ofs.tellp())));
+            levelData.resize(levels[i].size);
+            image->copyLevelData(i, levelData.data());
+            ofs.write(reinterpret_cast<const char*>(levelData.data()), levelData.size());
+        }
+        if (!ofs) {
+            hpprintf("Failed to write the texture cache %s.\n", tempPath.string().c_str());
+            ofs.close();
+            std::error_code ec;
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec)
+        std::filesystem::remove(tempPath, ec);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "image.h"
+
+// JP: 内部形式に変換済みのテクスチャーのディスクキャッシュ。
+//     元ファイルのパス、サイズと更新日時、スペクトルタイプ、色空間、ライブラリのビルドの種類をキーとする。
+//     ミップレベルごとのデータをアラインしたオフセットに格納し、読み込み時はファイル全体をメモリにマップしてそのまま渡す。
+// EN: On-disk cache of textures converted into the internal format.
+//     Keyed by the path, the size and the modification time of the source file, the spectrum type, the color space
+//     and the build flavor of the library.
+//     Data of each mip level is stored at an aligned offset, and on read the whole file is mapped into memory
+//     and handed over as is.
+
+// JP: 空のパスを指定するとキャッシュを無効にする(デフォルト)。
+// EN: Specifying an empty path disables the cache (default).
+void setTextureCacheDirectory(const std::filesystem::path &dirPath);
+bool textureCacheEnabled();
+
+// JP: キャッシュのキーを計算する。ファイルの情報が取れない場合はfalseを返す。
+// EN: Compute the cache key. Returns false when the file information can't be obtained.
+bool computeTextureCacheKey(const vlr::ContextRef &context, const std::string &filepath,
+                            const std::string &spectrumType, const std::string &colorSpace,
+                            std::string* key);
+
+// JP: キャッシュに存在すれば変換済みのデータを読み込む。存在しないか不正な場合はfalseを返す。
+//     libVLRのオブジェクトは作らないので複数のスレッドから呼べる。
+// EN: Read the converted data if it exists in the cache. Returns false when missing or malformed.
+//     Doesn't create libVLR objects, so it can be called from multiple threads.
+bool readCachedTexture(const std::string &key, DecodedImage* image);
+
+// JP: 画像の内部形式のデータをキャッシュに書き込む。
+// EN: Write the internal-format data of the image into the cache.
+void storeCachedTexture(const std::string &key, const vlr::LinearImage2DRef &image);
@@ -64,6 +64,7 @@ namespace vlr {
         surfPt.shadingFrame = shadingFrame;
         surfPt.isPoint = false;
         surfPt.atInfinity = false;
+        surfPt.texCoordFootprint = 0.0f;
 
         surfPt.geometricNormal = geometricNormal;
         surfPt.u = lx;
@@ -109,6 +110,7 @@ namespace vlr {
         surfPt->shadingFrame = shadingFrame;
         surfPt->isPoint = false;
         surfPt->atInfinity = false;
+        surfPt->texCoordFootprint = 0.0f;
 
         surfPt->geometricNormal = geometricNormal;
         surfPt->u = lx;
@@ -244,6 +246,7 @@ namespace vlr {
         surfPt.shadingFrame = shadingFrame;
         surfPt.isPoint = true;
         surfPt.atInfinity = false;
+        surfPt.texCoordFootprint = 0.0f;
 
         surfPt.geometricNormal = geometricNormal;
         surfPt.u = 0;
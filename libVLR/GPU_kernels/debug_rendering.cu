@@ -165,6 +165,7 @@ namespace vlr {
         surfPt.shadingFrame = shadingFrame;
         surfPt.isPoint = false;
         surfPt.atInfinity = true;
+        surfPt.texCoordFootprint = 0.0f;
 
         surfPt.geometricNormal = -direction;
         surfPt.u = phi;
@@ -49,6 +49,7 @@ namespace vlr {
         surfPt->shadingFrame = shadingFrame;
         surfPt->isPoint = false;
         surfPt->atInfinity = true;
+        surfPt->texCoordFootprint = 0.0f;
         surfPt->geometricNormal = geometricNormal;
         surfPt->u = posPhi;
         surfPt->v = theta;
@@ -100,6 +101,7 @@ namespace vlr {
         surfPt.shadingFrame = shadingFrame;
         surfPt.isPoint = false;
         surfPt.atInfinity = true;
+        surfPt.texCoordFootprint = 0.0f;
         surfPt.geometricNormal = geometricNormal;
         surfPt.u = posPhi;
         surfPt.v = theta;
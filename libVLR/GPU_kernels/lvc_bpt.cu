@@ -880,6 +880,7 @@ namespace vlr {
             surfPtE.shadingFrame = shadingFrame;
             surfPtE.isPoint = false;
             surfPtE.atInfinity = true;
+            surfPtE.texCoordFootprint = 0.0f;
             surfPtE.geometricNormal = -direction;
             surfPtE.u = posPhi;
             surfPtE.v = theta;
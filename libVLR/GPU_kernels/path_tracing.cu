@@ -62,6 +62,10 @@ namespace vlr {
         roPayload.wls = wls;
         roPayload.prevDirPDF = We1Result.dirPDF;
         roPayload.prevSampledType = We1Result.sampledType;
+        // JP: ピクセルが張る立体角(方向PDFの逆数)からレイコーンの広がり角を求める。
+        // EN: Derive the spread angle of the ray cone from the solid angle subtended by a pixel (reciprocal of the direction PDF).
+        roPayload.coneWidth = 0.0f;
+        roPayload.coneSpreadAngle = 1.0f / std::sqrt(We1Result.dirPDF);
         roPayload.pathLength = 0;
         roPayload.maxLengthTerminate = false;
         PTWriteOnlyPayload woPayload = {};
@@ -115,6 +119,8 @@ namespace vlr {
             rayDir = woPayload.nextDirection;
             roPayload.prevDirPDF = woPayload.dirPDF;
             roPayload.prevSampledType = woPayload.sampledType;
+            roPayload.coneWidth = woPayload.coneWidth;
+            roPayload.coneSpreadAngle = woPayload.coneSpreadAngle;
         }
         plp.rngBuffer.write(launchIndex, rwPayload.rng);
         if (!rwPayload.contribution.allFinite()) {
@@ -142,9 +148,11 @@ namespace vlr {
         KernelRNG &rng = rwPayload->rng;
         WavelengthSamples &wls = roPayload->wls;
 
+        float coneWidth = roPayload->coneWidth + roPayload->coneSpreadAngle * optixGetRayTmax();
+
         SurfacePoint surfPt;
         float hypAreaPDF;
-        calcSurfacePoint(hp, wls, &surfPt, &hypAreaPDF);
+        calcSurfacePoint(hp, wls, &surfPt, &hypAreaPDF, coneWidth);
 
         const SurfaceMaterialDescriptor &matDesc = plp.materialDescriptorBuffer[hp.sbtr->geomInst.materialIndex];
         constexpr TransportMode transportMode = TransportMode::Radiance;
@@ -255,6 +263,12 @@ namespace vlr {
         woPayload->nextDirection = dirIn;
         woPayload->dirPDF = fsResult.dirPDF;
         woPayload->sampledType = fsResult.sampledType;
+        // JP: レイコーンを伝播する。デルタでない散乱ではサンプルしたローブの広がり(1 / sqrt(PDF))までコーンを広げる。
+        // EN: Propagate the ray cone. Non-delta scattering widens the cone up to the spread of the sampled lobe (1 / sqrt(PDF)).
+        woPayload->coneWidth = coneWidth;
+        woPayload->coneSpreadAngle = fsResult.sampledType.isDelta() ?
+            roPayload->coneSpreadAngle :
+            std::fmax(roPayload->coneSpreadAngle, 1.0f / std::sqrt(fsResult.dirPDF));
         woPayload->terminate = false;
     }
 
@@ -297,6 +311,7 @@ namespace vlr {
         surfPt.shadingFrame = shadingFrame;
         surfPt.isPoint = false;
         surfPt.atInfinity = true;
+        surfPt.texCoordFootprint = 0.0f;
 
         surfPt.geometricNormal = -direction;
         surfPt.u = phi;
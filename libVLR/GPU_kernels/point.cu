@@ -27,6 +27,7 @@ namespace vlr {
         surfPt->shadingFrame = ReferenceFrame(tc0Direction, shadingNormal);
         surfPt->isPoint = true;
         surfPt->atInfinity = false;
+        surfPt->texCoordFootprint = 0.0f;
         surfPt->geometricNormal = shadingNormal;
         surfPt->u = u;
         surfPt->v = v;
@@ -73,6 +74,7 @@ namespace vlr {
         surfPt.shadingFrame = ReferenceFrame(tc0Direction, shadingNormal);
         surfPt.isPoint = true;
         surfPt.atInfinity = false;
+        surfPt.texCoordFootprint = 0.0f;
         surfPt.geometricNormal = shadingNormal;
         surfPt.u = 0.0f;
         surfPt.v = 0.0f;
@@ -281,13 +281,21 @@ namespace vlr {
 
 
 
+    // JP: テクスチャー座標空間でのフットプリントの幅をテクセル数に換算してミップレベルを求める。
+    // EN: Compute the mip level by converting the footprint width in texture coordinate space into texels.
+    CUDA_DEVICE_FUNCTION float calcTextureLod(const Image2DTextureShaderNode &nodeData, const SurfacePoint &surfPt) {
+        float footprintInTexels =
+            surfPt.texCoordFootprint * std::sqrt(static_cast<float>(nodeData.width) * static_cast<float>(nodeData.height));
+        return footprintInTexels > 1.0f ? std::log2(footprintInTexels) : 0.0f;
+    }
+
     RT_CALLABLE_PROGRAM float RT_DC_NAME(Image2DTextureShaderNode_float1)(
         const ShaderNodePlug &plug,
         const SurfacePoint &surfPt, const WavelengthSamples &wls) {
         auto &nodeData = *getData<Image2DTextureShaderNode>(plug.nodeDescIndex);
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, 0.0f);
+        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, calcTextureLod(nodeData, surfPt));
 
         if (plug.option == 0)
             return texValue.x;
@@ -307,7 +315,7 @@ namespace vlr {
         auto &nodeData = *getData<Image2DTextureShaderNode>(plug.nodeDescIndex);
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, 0.0f);
+        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, calcTextureLod(nodeData, surfPt));
 
         if (plug.option == 0)
             return make_float2(texValue.x, texValue.y);
@@ -325,7 +333,7 @@ namespace vlr {
         auto &nodeData = *getData<Image2DTextureShaderNode>(plug.nodeDescIndex);
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, 0.0f);
+        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, calcTextureLod(nodeData, surfPt));
 
         if (plug.option == 0)
             return make_float3(texValue.x, texValue.y, texValue.z);
@@ -341,7 +349,7 @@ namespace vlr {
         auto &nodeData = *getData<Image2DTextureShaderNode>(plug.nodeDescIndex);
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, 0.0f);
+        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, calcTextureLod(nodeData, surfPt));
 
         return texValue;
     }
@@ -355,7 +363,7 @@ namespace vlr {
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
         float4 texValue;
         if (bumpType != BumpType::HeightMap) {
-            texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, 0.0f);
+            texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, calcTextureLod(nodeData, surfPt));
         }
         else {
             // w z
@@ -398,7 +406,7 @@ namespace vlr {
         auto &nodeData = *getData<Image2DTextureShaderNode>(plug.nodeDescIndex);
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, 0.0f);
+        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, calcTextureLod(nodeData, surfPt));
         DataFormat dataFormat = nodeData.getDataFormat();
         if (dataFormat == DataFormat::Gray32F ||
             dataFormat == DataFormat::Gray8 ||
@@ -438,7 +446,7 @@ namespace vlr {
         auto &nodeData = *getData<Image2DTextureShaderNode>(plug.nodeDescIndex);
 
         Point3D texCoord = calcNode(nodeData.nodeTexCoord, Point3D(surfPt.texCoord.u, surfPt.texCoord.v, 0.0f), surfPt, wls);
-        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, 0.0f);
+        float4 texValue = tex2DLod<float4>(nodeData.texture, texCoord.x, texCoord.y, calcTextureLod(nodeData, surfPt));
 
         if (plug.option == 0)
             return texValue.x;
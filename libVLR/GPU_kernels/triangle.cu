@@ -8,9 +8,9 @@ namespace vlr {
         const GeometryInstance &geomInst = param.sbtr->geomInst;
 
         const Triangle &triangle = geomInst.asTriMesh.triangleBuffer[param.primIndex];
-        const Vertex &v0 = geomInst.asTriMesh.vertexBuffer[triangle.index0];
-        const Vertex &v1 = geomInst.asTriMesh.vertexBuffer[triangle.index1];
-        const Vertex &v2 = geomInst.asTriMesh.vertexBuffer[triangle.index2];
+        const Vertex v0 = fetchTriangleMeshVertex(geomInst, triangle.index0);
+        const Vertex v1 = fetchTriangleMeshVertex(geomInst, triangle.index1);
+        const Vertex v2 = fetchTriangleMeshVertex(geomInst, triangle.index2);
 
         Vector3D e1 = v1.position - v0.position;
         Vector3D e2 = v2.position - v0.position;
@@ -34,6 +34,16 @@ namespace vlr {
         }
         TexCoord2D texCoord = b0 * v0.texCoord + b1 * v1.texCoord + b2 * v2.texCoord;
 
+        // JP: テクスチャー座標空間とローカル空間の面積比から単位長さあたりのテクスチャー座標の変化量を求める。
+        //     calcSurfacePoint()が変換による面積の拡大率で補正し、レイコーンの幅を掛けてフットプリントにする。
+        // EN: Compute the texture coordinate change per unit length from the area ratio
+        //     between texture coordinate space and local space.
+        //     calcSurfacePoint() corrects it by the area scale of the transform
+        //     and multiplies it by the ray cone width to obtain the footprint.
+        float texCoordArea = 0.5f * std::fabs((v1.texCoord.u - v0.texCoord.u) * (v2.texCoord.v - v0.texCoord.v) -
+                                              (v2.texCoord.u - v0.texCoord.u) * (v1.texCoord.v - v0.texCoord.v));
+        float texCoordPerLength = area > 0.0f ? std::sqrt(texCoordArea / area) : 0.0f;
+
         // JP: 法線と接線が直交することを保証する。
         //     直交性の消失は重心座標補間によっておこる？
         // EN: guarantee the orthogonality between the normal and tangent.
@@ -50,6 +60,7 @@ namespace vlr {
         surfPt->u = b0;
         surfPt->v = b1;
         surfPt->texCoord = texCoord;
+        surfPt->texCoordFootprint = texCoordPerLength;
     }
 
     RT_CALLABLE_PROGRAM void RT_DC_NAME(decodeHitPointForTriangle)(
@@ -60,9 +71,9 @@ namespace vlr {
         const GeometryInstance &geomInst = plp.geomInstBuffer[geomInstIndex];
 
         const Triangle &triangle = geomInst.asTriMesh.triangleBuffer[primIndex];
-        const Vertex &v0 = geomInst.asTriMesh.vertexBuffer[triangle.index0];
-        const Vertex &v1 = geomInst.asTriMesh.vertexBuffer[triangle.index1];
-        const Vertex &v2 = geomInst.asTriMesh.vertexBuffer[triangle.index2];
+        const Vertex v0 = fetchTriangleMeshVertex(geomInst, triangle.index0);
+        const Vertex v1 = fetchTriangleMeshVertex(geomInst, triangle.index1);
+        const Vertex v2 = fetchTriangleMeshVertex(geomInst, triangle.index2);
 
         const StaticTransform &transform = inst.transform;
 
@@ -102,6 +113,7 @@ namespace vlr {
         surfPt->shadingFrame = ReferenceFrame(tc0Direction, shadingNormal);
         surfPt->isPoint = false;
         surfPt->atInfinity = false;
+        surfPt->texCoordFootprint = 0.0f;
         surfPt->geometricNormal = geometricNormal;
         surfPt->u = b0;
         surfPt->v = b1;
@@ -124,9 +136,9 @@ namespace vlr {
         //printf("%g, %u, %g\n", sample.uElem, primIdx, primProb);
 
         const Triangle &triangle = geomInst.asTriMesh.triangleBuffer[primIdx];
-        const Vertex &v0 = geomInst.asTriMesh.vertexBuffer[triangle.index0];
-        const Vertex &v1 = geomInst.asTriMesh.vertexBuffer[triangle.index1];
-        const Vertex &v2 = geomInst.asTriMesh.vertexBuffer[triangle.index2];
+        const Vertex v0 = fetchTriangleMeshVertex(geomInst, triangle.index0);
+        const Vertex v1 = fetchTriangleMeshVertex(geomInst, triangle.index1);
+        const Vertex v2 = fetchTriangleMeshVertex(geomInst, triangle.index2);
 
         const StaticTransform &transform = inst.transform;
 
@@ -170,6 +182,7 @@ namespace vlr {
         surfPt.shadingFrame = ReferenceFrame(tc0Direction, shadingNormal);
         surfPt.isPoint = false;
         surfPt.atInfinity = false;
+        surfPt.texCoordFootprint = 0.0f;
         surfPt.geometricNormal = geometricNormal;
         surfPt.u = b0;
         surfPt.v = b1;
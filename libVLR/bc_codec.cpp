@@ -0,0 +1,1732 @@
+#include "bc_codec.h"
+#include "thread_pool.h"
+
+namespace vlr {
+    DataFormat getDecodedDataFormat(DataFormat bcFormat) {
+        switch (bcFormat) {
+        case DataFormat::BC1:
+        case DataFormat::BC2:
+        case DataFormat::BC3:
+        case DataFormat::BC7:
+            return DataFormat::RGBA8x4;
+        case DataFormat::BC4:
+            return DataFormat::Gray8;
+        case DataFormat::BC4_Signed:
+            return DataFormat::Gray32F;
+        case DataFormat::BC5:
+        case DataFormat::BC5_Signed:
+            return DataFormat::RG32Fx2;
+        case DataFormat::BC6H:
+        case DataFormat::BC6H_Signed:
+            return DataFormat::RGBA16Fx4;
+        default:
+            VLRAssert(false, "Data format is not a block compressed format.");
+            return DataFormat::NumFormats;
+        }
+    }
+
+    static uint32_t getBlockSize(DataFormat bcFormat) {
+        switch (bcFormat) {
+        case DataFormat::BC1:
+        case DataFormat::BC4:
+        case DataFormat::BC4_Signed:
+            return 8;
+        default:
+            return 16;
+        }
+    }
+
+    size_t getBlockCompressedDataSize(DataFormat bcFormat, uint32_t width, uint32_t height) {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(bcFormat);
+    }
+
+
+
+    // ----------------------------------------------------------------
+    // JP: ブロック共通のユーティリティ。
+    // EN: Utilities shared by the block decoders.
+
+    static inline uint16_t readUInt16(const uint8_t* p) {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    static inline uint32_t readUInt32(const uint8_t* p) {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    static inline uint64_t readUInt64(const uint8_t* p) {
+        return readUInt32(p) | (static_cast<uint64_t>(readUInt32(p + 4)) << 32);
+    }
+
+    // JP: 128bitブロックをLSBから順に読み出す。
+    // EN: Reads a 128-bit block sequentially from the LSB.
+    class BlockBitReader {
+        uint64_t m_lo, m_hi;
+        uint32_t m_pos;
+
+    public:
+        BlockBitReader(const uint8_t* block, uint32_t pos = 0) :
+            m_lo(readUInt64(block)), m_hi(readUInt64(block + 8)), m_pos(pos) {}
+
+        uint32_t read(uint32_t numBits) {
+            VLRAssert(numBits <= 32 && m_pos + numBits <= 128, "Invalid read.");
+            if (numBits == 0)
+                return 0;
+            uint64_t value;
+            if (m_pos >= 64)
+                value = m_hi >> (m_pos - 64);
+            else if (m_pos + numBits <= 64 || m_pos == 0)
+                value = m_lo >> m_pos;
+            else
+                value = (m_lo >> m_pos) | (m_hi << (64 - m_pos));
+            m_pos += numBits;
+            return static_cast<uint32_t>(value & ((1ull << numBits) - 1));
+        }
+
+        uint32_t getPosition() const {
+            return m_pos;
+        }
+    };
+
+    static inline void unpackRGB565(uint16_t c, int32_t rgb[3]) {
+        int32_t r = (c >> 11) & 0x1F;
+        int32_t g = (c >> 5) & 0x3F;
+        int32_t b = c & 0x1F;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // JP: BC1-3のカラーブロック。BC2/3では常に4色モードで解釈する。
+    // EN: Color block of BC1-3. BC2/3 always interpret it in the four-color mode.
+    static void decodeColorBlock(const uint8_t* block, bool forceFourColors, RGBA8x4 pixels[16]) {
+        uint16_t c0 = readUInt16(block);
+        uint16_t c1 = readUInt16(block + 2);
+        int32_t rgb0[3], rgb1[3];
+        unpackRGB565(c0, rgb0);
+        unpackRGB565(c1, rgb1);
+
+        RGBA8x4 palette[4];
+        palette[0] = RGBA8x4{ (uint8_t)rgb0[0], (uint8_t)rgb0[1], (uint8_t)rgb0[2], 255 };
+        palette[1] = RGBA8x4{ (uint8_t)rgb1[0], (uint8_t)rgb1[1], (uint8_t)rgb1[2], 255 };
+        if (c0 > c1 || forceFourColors) {
+            palette[2] = RGBA8x4{
+                (uint8_t)((2 * rgb0[0] + rgb1[0] + 1) / 3),
+                (uint8_t)((2 * rgb0[1] + rgb1[1] + 1) / 3),
+                (uint8_t)((2 * rgb0[2] + rgb1[2] + 1) / 3),
+                255 };
+            palette[3] = RGBA8x4{
+                (uint8_t)((rgb0[0] + 2 * rgb1[0] + 1) / 3),
+                (uint8_t)((rgb0[1] + 2 * rgb1[1] + 1) / 3),
+                (uint8_t)((rgb0[2] + 2 * rgb1[2] + 1) / 3),
+                255 };
+        }
+        else {
+            palette[2] = RGBA8x4{
+                (uint8_t)((rgb0[0] + rgb1[0] + 1) / 2),
+                (uint8_t)((rgb0[1] + rgb1[1] + 1) / 2),
+                (uint8_t)((rgb0[2] + rgb1[2] + 1) / 2),
+                255 };
+            palette[3] = RGBA8x4{ 0, 0, 0, 0 };
+        }
+
+        uint32_t indices = readUInt32(block + 4);
+        for (int i = 0; i < 16; ++i)
+            pixels[i] = palette[(indices >> (2 * i)) & 0x3];
+    }
+
+    // JP: BC3のアルファ、BC4/5の各チャンネルで使われる8段階/6段階の補間ブロック。
+    // EN: Interpolated 8-step/6-step block used by BC3 alpha and each channel of BC4/5.
+    static void decodeUNormChannelBlock(const uint8_t* block, uint8_t values[16]) {
+        int32_t v0 = block[0];
+        int32_t v1 = block[1];
+        uint8_t palette[8];
+        palette[0] = v0;
+        palette[1] = v1;
+        if (v0 > v1) {
+            for (int i = 1; i < 7; ++i)
+                palette[i + 1] = static_cast<uint8_t>(((7 - i) * v0 + i * v1 + 3) / 7);
+        }
+        else {
+            for (int i = 1; i < 5; ++i)
+                palette[i + 1] = static_cast<uint8_t>(((5 - i) * v0 + i * v1 + 2) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        uint64_t indices = readUInt64(block) >> 16;
+        for (int i = 0; i < 16; ++i)
+            values[i] = palette[(indices >> (3 * i)) & 0x7];
+    }
+
+    static void decodeSNormChannelBlock(const uint8_t* block, float values[16]) {
+        // JP: -128は-127と同じく-1.0として扱う。
+        // EN: -128 is treated as -1.0 the same as -127.
+        float v0 = std::max<int32_t>(static_cast<int8_t>(block[0]), -127) / 127.0f;
+        float v1 = std::max<int32_t>(static_cast<int8_t>(block[1]), -127) / 127.0f;
+        float palette[8];
+        palette[0] = v0;
+        palette[1] = v1;
+        if (static_cast<int8_t>(block[0]) > static_cast<int8_t>(block[1])) {
+            for (int i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * v0 + i * v1) / 7;
+        }
+        else {
+            for (int i = 1; i < 5; ++i)
+                palette[i + 1] = ((5 - i) * v0 + i * v1) / 5;
+            palette[6] = -1.0f;
+            palette[7] = 1.0f;
+        }
+
+        uint64_t indices = readUInt64(block) >> 16;
+        for (int i = 0; i < 16; ++i)
+            values[i] = palette[(indices >> (3 * i)) & 0x7];
+    }
+
+    // END: Utilities shared by the block decoders.
+    // ----------------------------------------------------------------
+
+
+
+    void decodeBC1Block(const uint8_t* block, RGBA8x4 pixels[16]) {
+        decodeColorBlock(block, false, pixels);
+    }
+
+    void decodeBC2Block(const uint8_t* block, RGBA8x4 pixels[16]) {
+        decodeColorBlock(block + 8, true, pixels);
+        uint64_t alphas = readUInt64(block);
+        for (int i = 0; i < 16; ++i)
+            pixels[i].a = static_cast<uint8_t>(((alphas >> (4 * i)) & 0xF) * 17);
+    }
+
+    void decodeBC3Block(const uint8_t* block, RGBA8x4 pixels[16]) {
+        decodeColorBlock(block + 8, true, pixels);
+        uint8_t alphas[16];
+        decodeUNormChannelBlock(block, alphas);
+        for (int i = 0; i < 16; ++i)
+            pixels[i].a = alphas[i];
+    }
+
+    void decodeBC4Block(const uint8_t* block, Gray8 pixels[16]) {
+        uint8_t values[16];
+        decodeUNormChannelBlock(block, values);
+        for (int i = 0; i < 16; ++i)
+            pixels[i].v = values[i];
+    }
+
+    void decodeBC4SignedBlock(const uint8_t* block, Gray32F pixels[16]) {
+        float values[16];
+        decodeSNormChannelBlock(block, values);
+        for (int i = 0; i < 16; ++i)
+            pixels[i].v = values[i];
+    }
+
+    void decodeBC5Block(const uint8_t* block, RG32Fx2 pixels[16]) {
+        uint8_t reds[16], greens[16];
+        decodeUNormChannelBlock(block, reds);
+        decodeUNormChannelBlock(block + 8, greens);
+        for (int i = 0; i < 16; ++i)
+            pixels[i] = RG32Fx2{ reds[i] / 255.0f, greens[i] / 255.0f };
+    }
+
+    void decodeBC5SignedBlock(const uint8_t* block, RG32Fx2 pixels[16]) {
+        float reds[16], greens[16];
+        decodeSNormChannelBlock(block, reds);
+        decodeSNormChannelBlock(block + 8, greens);
+        for (int i = 0; i < 16; ++i)
+            pixels[i] = RG32Fx2{ reds[i], greens[i] };
+    }
+
+
+
+    // ----------------------------------------------------------------
+    // JP: BC6H/BC7の共通テーブル。
+    // EN: Tables shared by BC6H/BC7.
+
+    // JP: 2分割パーティション。ビットiがピクセルiのサブセット番号。
+    // EN: Two-subset partitions. Bit i is the subset index of pixel i.
+    static const uint16_t s_partitions2[64] = {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+        0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+        0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+        0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+        0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+    };
+
+    // JP: 3分割パーティション。
+    // EN: Three-subset partitions.
+    static const uint8_t s_partitions3[64][16] = {
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+        { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+        { 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 },
+        { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+        { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+        { 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 },
+        { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+        { 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+        { 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 },
+        { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 },
+        { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+        { 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 },
+        { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+        { 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 },
+        { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+        { 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+        { 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 },
+        { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+        { 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 },
+        { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 },
+        { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+        { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 },
+        { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+        { 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 },
+        { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+        { 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 },
+        { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 },
+        { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 },
+        { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+        { 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 },
+        { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+        { 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 },
+        { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 },
+        { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+        { 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+        { 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+        { 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 },
+        { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+        { 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 },
+        { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 },
+    };
+
+    // JP: 各サブセットのアンカーピクセル(インデックスのMSBが省略される)。サブセット0は常にピクセル0。
+    // EN: Anchor pixel of each subset (the MSB of its index is omitted). Subset 0 is always pixel 0.
+    static const uint8_t s_anchors2[64] = {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+    };
+
+    static const uint8_t s_anchors3_1[64] = {
+         3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+         3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+         8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+         3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+    };
+
+    static const uint8_t s_anchors3_2[64] = {
+        15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+        15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+        15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+        15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+    };
+
+    static const int32_t s_weights2[4] = { 0, 21, 43, 64 };
+    static const int32_t s_weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    static const int32_t s_weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    static inline const int32_t* getInterpolationWeights(uint32_t numIndexBits) {
+        return numIndexBits == 2 ? s_weights2 : (numIndexBits == 3 ? s_weights3 : s_weights4);
+    }
+
+    static inline int32_t interpolate(int32_t e0, int32_t e1, int32_t weight) {
+        return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+    }
+
+    // END: Tables shared by BC6H/BC7.
+    // ----------------------------------------------------------------
+
+
+
+    // ----------------------------------------------------------------
+    // JP: BC6H
+
+    enum BC6HField : uint8_t {
+        R0 = 0, G0, B0,
+        R1, G1, B1,
+        R2, G2, B2,
+        R3, G3, B3,
+    };
+
+    // JP: ヘッダー内のビット列。firstからlastへ向かって1ビットずつ格納されている(first > lastなら逆順)。
+    // EN: Bit run in the header. Bits are stored one by one going from first to last (reversed when first > last).
+    struct BC6HBitRun {
+        uint8_t field;
+        uint8_t first;
+        uint8_t last;
+    };
+
+    struct BC6HModeInfo {
+        uint32_t numRegions;
+        bool transformed;
+        uint32_t endpointBits;
+        uint32_t deltaBits[3];
+        BC6HBitRun runs[24];
+        uint32_t numRuns;
+    };
+
+    static const BC6HModeInfo s_bc6hModes[14] = {
+        { 2, true, 10, { 5, 5, 5 }, {
+            { G2, 4, 4 }, { B2, 4, 4 }, { B3, 4, 4 }, { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 },
+            { R1, 0, 4 }, { G3, 4, 4 }, { G2, 0, 3 }, { G1, 0, 4 }, { B3, 0, 0 }, { G3, 0, 3 },
+            { B1, 0, 4 }, { B3, 1, 1 }, { B2, 0, 3 }, { R2, 0, 4 }, { B3, 2, 2 }, { R3, 0, 4 },
+            { B3, 3, 3 } }, 19 },
+        { 2, true, 7, { 6, 6, 6 }, {
+            { G2, 5, 5 }, { G3, 4, 4 }, { G3, 5, 5 }, { R0, 0, 6 }, { B3, 0, 0 }, { B3, 1, 1 },
+            { B2, 4, 4 }, { G0, 0, 6 }, { B2, 5, 5 }, { B3, 2, 2 }, { G2, 4, 4 }, { B0, 0, 6 },
+            { B3, 3, 3 }, { B3, 5, 5 }, { B3, 4, 4 }, { R1, 0, 5 }, { G2, 0, 3 }, { G1, 0, 5 },
+            { G3, 0, 3 }, { B1, 0, 5 }, { B2, 0, 3 }, { R2, 0, 5 }, { R3, 0, 5 } }, 23 },
+        { 2, true, 11, { 5, 4, 4 }, {
+            { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 }, { R1, 0, 4 }, { R0, 10, 10 }, { G2, 0, 3 },
+            { G1, 0, 3 }, { G0, 10, 10 }, { B3, 0, 0 }, { G3, 0, 3 }, { B1, 0, 3 }, { B0, 10, 10 },
+            { B3, 1, 1 }, { B2, 0, 3 }, { R2, 0, 4 }, { B3, 2, 2 }, { R3, 0, 4 }, { B3, 3, 3 } }, 18 },
+        { 2, true, 11, { 4, 5, 4 }, {
+            { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 }, { R1, 0, 3 }, { R0, 10, 10 }, { G3, 4, 4 },
+            { G2, 0, 3 }, { G1, 0, 4 }, { G0, 10, 10 }, { G3, 0, 3 }, { B1, 0, 3 }, { B0, 10, 10 },
+            { B3, 1, 1 }, { B2, 0, 3 }, { R2, 0, 3 }, { B3, 0, 0 }, { B3, 2, 2 }, { R3, 0, 3 },
+            { G2, 4, 4 }, { B3, 3, 3 } }, 20 },
+        { 2, true, 11, { 4, 4, 5 }, {
+            { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 }, { R1, 0, 3 }, { R0, 10, 10 }, { B2, 4, 4 },
+            { G2, 0, 3 }, { G1, 0, 3 }, { G0, 10, 10 }, { B3, 0, 0 }, { G3, 0, 3 }, { B1, 0, 4 },
+            { B0, 10, 10 }, { B2, 0, 3 }, { R2, 0, 3 }, { B3, 1, 1 }, { B3, 2, 2 }, { R3, 0, 3 },
+            { B3, 4, 4 }, { B3, 3, 3 } }, 20 },
+        { 2, true, 9, { 5, 5, 5 }, {
+            { R0, 0, 8 }, { B2, 4, 4 }, { G0, 0, 8 }, { G2, 4, 4 }, { B0, 0, 8 }, { B3, 4, 4 },
+            { R1, 0, 4 }, { G3, 4, 4 }, { G2, 0, 3 }, { G1, 0, 4 }, { B3, 0, 0 }, { G3, 0, 3 },
+            { B1, 0, 4 }, { B3, 1, 1 }, { B2, 0, 3 }, { R2, 0, 4 }, { B3, 2, 2 }, { R3, 0, 4 },
+            { B3, 3, 3 } }, 19 },
+        { 2, true, 8, { 6, 5, 5 }, {
+            { R0, 0, 7 }, { G3, 4, 4 }, { B2, 4, 4 }, { G0, 0, 7 }, { B3, 2, 2 }, { G2, 4, 4 },
+            { B0, 0, 7 }, { B3, 3, 3 }, { B3, 4, 4 }, { R1, 0, 5 }, { G2, 0, 3 }, { G1, 0, 4 },
+            { B3, 0, 0 }, { G3, 0, 3 }, { B1, 0, 4 }, { B3, 1, 1 }, { B2, 0, 3 }, { R2, 0, 5 },
+            { R3, 0, 5 } }, 19 },
+        { 2, true, 8, { 5, 6, 5 }, {
+            { R0, 0, 7 }, { B3, 0, 0 }, { B2, 4, 4 }, { G0, 0, 7 }, { G2, 5, 5 }, { G2, 4, 4 },
+            { B0, 0, 7 }, { G3, 5, 5 }, { B3, 4, 4 }, { R1, 0, 4 }, { G3, 4, 4 }, { G2, 0, 3 },
+            { G1, 0, 5 }, { G3, 0, 3 }, { B1, 0, 4 }, { B3, 1, 1 }, { B2, 0, 3 }, { R2, 0, 4 },
+            { B3, 2, 2 }, { R3, 0, 4 }, { B3, 3, 3 } }, 21 },
+        { 2, true, 8, { 5, 5, 6 }, {
+            { R0, 0, 7 }, { B3, 1, 1 }, { B2, 4, 4 }, { G0, 0, 7 }, { B2, 5, 5 }, { G2, 4, 4 },
+            { B0, 0, 7 }, { B3, 5, 5 }, { B3, 4, 4 }, { R1, 0, 4 }, { G3, 4, 4 }, { G2, 0, 3 },
+            { G1, 0, 4 }, { B3, 0, 0 }, { G3, 0, 3 }, { B1, 0, 5 }, { B2, 0, 3 }, { R2, 0, 4 },
+            { B3, 2, 2 }, { R3, 0, 4 }, { B3, 3, 3 } }, 21 },
+        { 2, false, 6, { 6, 6, 6 }, {
+            { R0, 0, 5 }, { G3, 4, 4 }, { B3, 0, 0 }, { B3, 1, 1 }, { B2, 4, 4 }, { G0, 0, 5 },
+            { G2, 5, 5 }, { B2, 5, 5 }, { B3, 2, 2 }, { G2, 4, 4 }, { B0, 0, 5 }, { G3, 5, 5 },
+            { B3, 3, 3 }, { B3, 5, 5 }, { B3, 4, 4 }, { R1, 0, 5 }, { G2, 0, 3 }, { G1, 0, 5 },
+            { G3, 0, 3 }, { B1, 0, 5 }, { B2, 0, 3 }, { R2, 0, 5 }, { R3, 0, 5 } }, 23 },
+        { 1, false, 10, { 10, 10, 10 }, {
+            { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 }, { R1, 0, 9 }, { G1, 0, 9 }, { B1, 0, 9 } }, 6 },
+        { 1, true, 11, { 9, 9, 9 }, {
+            { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 }, { R1, 0, 8 }, { R0, 10, 10 }, { G1, 0, 8 },
+            { G0, 10, 10 }, { B1, 0, 8 }, { B0, 10, 10 } }, 9 },
+        { 1, true, 12, { 8, 8, 8 }, {
+            { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 }, { R1, 0, 7 }, { R0, 11, 10 }, { G1, 0, 7 },
+            { G0, 11, 10 }, { B1, 0, 7 }, { B0, 11, 10 } }, 9 },
+        { 1, true, 16, { 4, 4, 4 }, {
+            { R0, 0, 9 }, { G0, 0, 9 }, { B0, 0, 9 }, { R1, 0, 3 }, { R0, 15, 10 }, { G1, 0, 3 },
+            { G0, 15, 10 }, { B1, 0, 3 }, { B0, 15, 10 } }, 9 },
+    };
+
+    // JP: 5bitモード値からモード番号へ。-1は予約済み(不正)なモード。
+    // EN: 5-bit mode value to mode index. -1 is a reserved (invalid) mode.
+    static int32_t getBC6HModeIndex(uint32_t modeValue) {
+        switch (modeValue) {
+        case 0x02: return 2;
+        case 0x06: return 3;
+        case 0x0A: return 4;
+        case 0x0E: return 5;
+        case 0x12: return 6;
+        case 0x16: return 7;
+        case 0x1A: return 8;
+        case 0x1E: return 9;
+        case 0x03: return 10;
+        case 0x07: return 11;
+        case 0x0B: return 12;
+        case 0x0F: return 13;
+        default: return -1;
+        }
+    }
+
+    static inline int32_t signExtend(int32_t value, uint32_t numBits) {
+        int32_t shift = 32 - numBits;
+        return static_cast<int32_t>(static_cast<uint32_t>(value) << shift) >> shift;
+    }
+
+    static int32_t unquantizeBC6H(int32_t value, uint32_t numBits, bool isSigned) {
+        if (!isSigned) {
+            if (numBits >= 15)
+                return value;
+            if (value == 0)
+                return 0;
+            if (value == (1 << numBits) - 1)
+                return 0xFFFF;
+            return ((value << 16) + 0x8000) >> numBits;
+        }
+        else {
+            if (numBits >= 16)
+                return value;
+            bool negative = value < 0;
+            int32_t absValue = negative ? -value : value;
+            int32_t ret;
+            if (absValue == 0)
+                ret = 0;
+            else if (absValue >= (1 << (numBits - 1)) - 1)
+                ret = 0x7FFF;
+            else
+                ret = ((absValue << 15) + 0x4000) >> (numBits - 1);
+            return negative ? -ret : ret;
+        }
+    }
+
+    static uint16_t finishUnquantizeBC6H(int32_t value, bool isSigned) {
+        if (!isSigned)
+            return static_cast<uint16_t>((value * 31) >> 6);
+        if (value < 0)
+            return static_cast<uint16_t>(0x8000 | ((-value * 31) >> 5));
+        return static_cast<uint16_t>((value * 31) >> 5);
+    }
+
+    // JP: halfのビットコンストラクターは非公開なので、floatを経由して構築する。
+    //     NaN以外のhalf値はfloatとの間で正確に往復する。
+    // EN: half's bit constructor is private, so construct it through float.
+    //     Every non-NaN half value round-trips exactly through float.
+    static inline half halfFromBits(uint16_t bits) {
+        return static_cast<half>(half_float::detail::half2float<float>(bits));
+    }
+
+    static inline uint16_t bitsFromHalf(half value) {
+        return half_float::detail::float2half<std::round_to_nearest>(static_cast<float>(value));
+    }
+
+    void decodeBC6HBlock(const uint8_t* block, bool isSigned, RGBA16Fx4 pixels[16]) {
+        BlockBitReader reader(block);
+        int32_t modeIndex;
+        uint32_t modeValue = reader.read(2);
+        if (modeValue < 2)
+            modeIndex = modeValue;
+        else
+            modeIndex = getBC6HModeIndex(modeValue | (reader.read(3) << 2));
+
+        if (modeIndex < 0) {
+            // JP: 予約済みモードは黒として扱う。
+            // EN: Treat reserved modes as black.
+            const half zero = halfFromBits(0x0000);
+            const half one = halfFromBits(0x3C00);
+            for (int i = 0; i < 16; ++i)
+                pixels[i] = RGBA16Fx4{ zero, zero, zero, one };
+            return;
+        }
+
+        const BC6HModeInfo &mode = s_bc6hModes[modeIndex];
+        int32_t endpoints[4][3] = {};
+        for (uint32_t r = 0; r < mode.numRuns; ++r) {
+            const BC6HBitRun &run = mode.runs[r];
+            int32_t &value = endpoints[run.field / 3][run.field % 3];
+            if (run.first <= run.last) {
+                value |= reader.read(run.last - run.first + 1) << run.first;
+            }
+            else {
+                for (int32_t b = run.first; b >= run.last; --b)
+                    value |= reader.read(1) << b;
+            }
+        }
+        uint32_t partition = mode.numRegions == 2 ? reader.read(5) : 0;
+
+        const uint32_t numEndpoints = 2 * mode.numRegions;
+        const uint32_t endpointMask = (1u << mode.endpointBits) - 1;
+        for (uint32_t c = 0; c < 3; ++c) {
+            if (isSigned)
+                endpoints[0][c] = signExtend(endpoints[0][c], mode.endpointBits);
+            for (uint32_t e = 1; e < numEndpoints; ++e) {
+                int32_t &value = endpoints[e][c];
+                if (mode.transformed) {
+                    value = signExtend(value, mode.deltaBits[c]);
+                    value = (endpoints[0][c] + value) & endpointMask;
+                }
+                if (isSigned)
+                    value = signExtend(value, mode.endpointBits);
+            }
+            for (uint32_t e = 0; e < numEndpoints; ++e)
+                endpoints[e][c] = unquantizeBC6H(endpoints[e][c], mode.endpointBits, isSigned);
+        }
+
+        const uint32_t numIndexBits = mode.numRegions == 2 ? 3 : 4;
+        const uint32_t anchor = mode.numRegions == 2 ? s_anchors2[partition] : 0;
+        const int32_t* weights = getInterpolationWeights(numIndexBits);
+        const uint16_t partitionMask = mode.numRegions == 2 ? s_partitions2[partition] : 0;
+        const half one = halfFromBits(0x3C00);
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint32_t index = reader.read(numIndexBits - (i == 0 || i == anchor));
+            uint32_t region = (partitionMask >> i) & 0x1;
+            const int32_t* e0 = endpoints[2 * region + 0];
+            const int32_t* e1 = endpoints[2 * region + 1];
+            uint16_t rgb[3];
+            for (uint32_t c = 0; c < 3; ++c)
+                rgb[c] = finishUnquantizeBC6H(interpolate(e0[c], e1[c], weights[index]), isSigned);
+            pixels[i] = RGBA16Fx4{ halfFromBits(rgb[0]), halfFromBits(rgb[1]), halfFromBits(rgb[2]), one };
+        }
+    }
+
+    // END: BC6H
+    // ----------------------------------------------------------------
+
+
+
+    // ----------------------------------------------------------------
+    // JP: BC7
+
+    struct BC7ModeInfo {
+        uint32_t numSubsets;
+        uint32_t partitionBits;
+        uint32_t rotationBits;
+        uint32_t indexSelectionBits;
+        uint32_t colorBits;
+        uint32_t alphaBits;
+        uint32_t endpointPBits;
+        uint32_t sharedPBits;
+        uint32_t indexBits;
+        uint32_t secondaryIndexBits;
+    };
+
+    static const BC7ModeInfo s_bc7Modes[8] = {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+    };
+
+    static inline int32_t expandBits(int32_t value, uint32_t numBits) {
+        value <<= 8 - numBits;
+        return value | (value >> numBits);
+    }
+
+    void decodeBC7Block(const uint8_t* block, RGBA8x4 pixels[16]) {
+        uint32_t modeIndex = 0;
+        while (modeIndex < 8 && (block[0] & (1 << modeIndex)) == 0)
+            ++modeIndex;
+        if (modeIndex == 8) {
+            // JP: 不正なモードは透明な黒として扱う。
+            // EN: Treat the invalid mode as transparent black.
+            for (int i = 0; i < 16; ++i)
+                pixels[i] = RGBA8x4{ 0, 0, 0, 0 };
+            return;
+        }
+
+        const BC7ModeInfo &mode = s_bc7Modes[modeIndex];
+        BlockBitReader reader(block, modeIndex + 1);
+        uint32_t partition = reader.read(mode.partitionBits);
+        uint32_t rotation = reader.read(mode.rotationBits);
+        uint32_t indexSelection = reader.read(mode.indexSelectionBits);
+
+        const uint32_t numEndpoints = 2 * mode.numSubsets;
+        int32_t endpoints[6][4];
+        for (uint32_t c = 0; c < 3; ++c) {
+            for (uint32_t e = 0; e < numEndpoints; ++e)
+                endpoints[e][c] = reader.read(mode.colorBits);
+        }
+        for (uint32_t e = 0; e < numEndpoints; ++e)
+            endpoints[e][3] = reader.read(mode.alphaBits);
+
+        const bool hasPBits = mode.endpointPBits || mode.sharedPBits;
+        if (hasPBits) {
+            uint32_t pBits[6];
+            if (mode.endpointPBits) {
+                for (uint32_t e = 0; e < numEndpoints; ++e)
+                    pBits[e] = reader.read(1);
+            }
+            else {
+                for (uint32_t s = 0; s < mode.numSubsets; ++s)
+                    pBits[2 * s + 0] = pBits[2 * s + 1] = reader.read(1);
+            }
+            for (uint32_t e = 0; e < numEndpoints; ++e) {
+                for (uint32_t c = 0; c < 4; ++c)
+                    endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+            }
+        }
+
+        const uint32_t colorPrecision = mode.colorBits + hasPBits;
+        const uint32_t alphaPrecision = mode.alphaBits ? mode.alphaBits + hasPBits : 0;
+        for (uint32_t e = 0; e < numEndpoints; ++e) {
+            for (uint32_t c = 0; c < 3; ++c)
+                endpoints[e][c] = expandBits(endpoints[e][c], colorPrecision);
+            endpoints[e][3] = alphaPrecision ? expandBits(endpoints[e][3], alphaPrecision) : 255;
+        }
+
+        uint32_t anchor1 = 0, anchor2 = 0;
+        if (mode.numSubsets == 2) {
+            anchor1 = s_anchors2[partition];
+        }
+        else if (mode.numSubsets == 3) {
+            anchor1 = s_anchors3_1[partition];
+            anchor2 = s_anchors3_2[partition];
+        }
+
+        uint32_t indices[16];
+        for (uint32_t i = 0; i < 16; ++i) {
+            bool isAnchor = i == 0 || (mode.numSubsets >= 2 && i == anchor1) || (mode.numSubsets == 3 && i == anchor2);
+            indices[i] = reader.read(mode.indexBits - isAnchor);
+        }
+        uint32_t secondaryIndices[16] = {};
+        if (mode.secondaryIndexBits) {
+            for (uint32_t i = 0; i < 16; ++i)
+                secondaryIndices[i] = reader.read(mode.secondaryIndexBits - (i == 0));
+        }
+
+        const int32_t* colorWeights = getInterpolationWeights(mode.indexBits);
+        const int32_t* alphaWeights = colorWeights;
+        const uint32_t* colorIndices = indices;
+        const uint32_t* alphaIndices = indices;
+        if (mode.secondaryIndexBits) {
+            alphaIndices = secondaryIndices;
+            alphaWeights = getInterpolationWeights(mode.secondaryIndexBits);
+            if (indexSelection) {
+                std::swap(colorIndices, alphaIndices);
+                std::swap(colorWeights, alphaWeights);
+            }
+        }
+
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint32_t subset = 0;
+            if (mode.numSubsets == 2)
+                subset = (s_partitions2[partition] >> i) & 0x1;
+            else if (mode.numSubsets == 3)
+                subset = s_partitions3[partition][i];
+            const int32_t* e0 = endpoints[2 * subset + 0];
+            const int32_t* e1 = endpoints[2 * subset + 1];
+
+            int32_t colorWeight = colorWeights[colorIndices[i]];
+            int32_t alphaWeight = alphaWeights[alphaIndices[i]];
+            uint8_t rgba[4] = {
+                static_cast<uint8_t>(interpolate(e0[0], e1[0], colorWeight)),
+                static_cast<uint8_t>(interpolate(e0[1], e1[1], colorWeight)),
+                static_cast<uint8_t>(interpolate(e0[2], e1[2], colorWeight)),
+                static_cast<uint8_t>(interpolate(e0[3], e1[3], alphaWeight)),
+            };
+            if (rotation > 0)
+                std::swap(rgba[3], rgba[rotation - 1]);
+            pixels[i] = RGBA8x4{ rgba[0], rgba[1], rgba[2], rgba[3] };
+        }
+    }
+
+    // END: BC7
+    // ----------------------------------------------------------------
+
+
+
+    static constexpr uint32_t MinNumPixelsPerChunk = 65536;
+
+    template <typename PixelType, typename BlockDecoder>
+    static void decodeBlocks(const uint8_t* data, uint32_t width, uint32_t height, uint32_t blockSize,
+                             PixelType* dstData, BlockDecoder decodeBlock) {
+        const uint32_t numBlocksX = (width + 3) / 4;
+        const uint32_t numBlocksY = (height + 3) / 4;
+        ThreadPool::getShared().parallelFor(
+            0, numBlocksY, std::max<uint32_t>(MinNumPixelsPerChunk / (16 * numBlocksX), 1),
+            [&](uint32_t byBegin, uint32_t byEnd) {
+            PixelType pixels[16];
+            for (uint32_t by = byBegin; by < byEnd; ++by) {
+                const uint8_t* blockRow = data + static_cast<size_t>(by) * numBlocksX * blockSize;
+                uint32_t numRows = std::min<uint32_t>(height - 4 * by, 4);
+                for (uint32_t bx = 0; bx < numBlocksX; ++bx) {
+                    decodeBlock(blockRow + static_cast<size_t>(bx) * blockSize, pixels);
+                    // JP: 画像端の端数ブロックは範囲内のピクセルのみ書き出す。
+                    // EN: Only write in-range pixels for partial blocks at the image border.
+                    uint32_t numCols = std::min<uint32_t>(width - 4 * bx, 4);
+                    for (uint32_t y = 0; y < numRows; ++y) {
+                        PixelType* dstRow = dstData + static_cast<size_t>(4 * by + y) * width + 4 * bx;
+                        std::copy_n(&pixels[4 * y], numCols, dstRow);
+                    }
+                }
+            }
+        });
+    }
+
+    void decodeBlockCompressedImageData(const uint8_t* data, uint32_t width, uint32_t height, DataFormat bcFormat,
+                                        uint8_t* dstData) {
+        VLRAssert(width > 0 && height > 0, "Image size must be non-zero.");
+        uint32_t blockSize = getBlockSize(bcFormat);
+
+#define VLR_TEMP_EXPR0(format, PixelType, func) \
+    case format: \
+        decodeBlocks<PixelType>(data, width, height, blockSize, reinterpret_cast<PixelType*>(dstData), func); \
+        break
+
+        switch (bcFormat) {
+            VLR_TEMP_EXPR0(DataFormat::BC1, RGBA8x4, decodeBC1Block);
+            VLR_TEMP_EXPR0(DataFormat::BC2, RGBA8x4, decodeBC2Block);
+            VLR_TEMP_EXPR0(DataFormat::BC3, RGBA8x4, decodeBC3Block);
+            VLR_TEMP_EXPR0(DataFormat::BC4, Gray8, decodeBC4Block);
+            VLR_TEMP_EXPR0(DataFormat::BC4_Signed, Gray32F, decodeBC4SignedBlock);
+            VLR_TEMP_EXPR0(DataFormat::BC5, RG32Fx2, decodeBC5Block);
+            VLR_TEMP_EXPR0(DataFormat::BC5_Signed, RG32Fx2, decodeBC5SignedBlock);
+            VLR_TEMP_EXPR0(DataFormat::BC6H, RGBA16Fx4,
+                           [](const uint8_t* block, RGBA16Fx4* pixels) { decodeBC6HBlock(block, false, pixels); });
+            VLR_TEMP_EXPR0(DataFormat::BC6H_Signed, RGBA16Fx4,
+                           [](const uint8_t* block, RGBA16Fx4* pixels) { decodeBC6HBlock(block, true, pixels); });
+            VLR_TEMP_EXPR0(DataFormat::BC7, RGBA8x4, decodeBC7Block);
+        default:
+            VLRAssert(false, "Data format is not a block compressed format.");
+            break;
+        }
+
+#undef VLR_TEMP_EXPR0
+    }
+
+
+
+    // ----------------------------------------------------------------
+    // JP: エンコーダー共通のユーティリティ。
+    // EN: Utilities shared by the encoders.
+
+    // JP: 128bitブロックにLSBから順に書き込む。
+    // EN: Writes a 128-bit block sequentially from the LSB.
+    class BlockBitWriter {
+        uint64_t m_lo, m_hi;
+        uint32_t m_pos;
+
+    public:
+        BlockBitWriter() : m_lo(0), m_hi(0), m_pos(0) {}
+
+        void write(uint32_t value, uint32_t numBits) {
+            VLRAssert(numBits <= 32 && m_pos + numBits <= 128, "Invalid write.");
+            if (numBits == 0)
+                return;
+            uint64_t bits = value & ((1ull << numBits) - 1);
+            if (m_pos >= 64) {
+                m_hi |= bits << (m_pos - 64);
+            }
+            else {
+                m_lo |= bits << m_pos;
+                if (m_pos + numBits > 64)
+                    m_hi |= bits >> (64 - m_pos);
+            }
+            m_pos += numBits;
+        }
+
+        uint32_t getPosition() const {
+            return m_pos;
+        }
+
+        void store(uint8_t* block) const {
+            for (int i = 0; i < 8; ++i) {
+                block[i] = static_cast<uint8_t>(m_lo >> (8 * i));
+                block[8 + i] = static_cast<uint8_t>(m_hi >> (8 * i));
+            }
+        }
+    };
+
+    // JP: 点群を主軸で近似する。residualは主軸からの距離の二乗和の近似値。
+    // EN: Approximate a point set by its principal axis. residual approximates the squared distance sum to the axis.
+    struct PrincipalAxisFit {
+        float mean[4];
+        float axis[4];
+        float tMin, tMax;
+        float residual;
+    };
+
+    static PrincipalAxisFit fitPrincipalAxis(const float (*points)[4], uint32_t numPoints, uint32_t numChannels) {
+        PrincipalAxisFit fit = {};
+        for (uint32_t i = 0; i < numPoints; ++i) {
+            for (uint32_t c = 0; c < numChannels; ++c)
+                fit.mean[c] += points[i][c];
+        }
+        for (uint32_t c = 0; c < numChannels; ++c)
+            fit.mean[c] /= numPoints;
+
+        float cov[4][4] = {};
+        for (uint32_t i = 0; i < numPoints; ++i) {
+            float d[4];
+            for (uint32_t c = 0; c < numChannels; ++c)
+                d[c] = points[i][c] - fit.mean[c];
+            for (uint32_t r = 0; r < numChannels; ++r) {
+                for (uint32_t c = 0; c < numChannels; ++c)
+                    cov[r][c] += d[r] * d[c];
+            }
+        }
+        float trace = 0.0f;
+        for (uint32_t c = 0; c < numChannels; ++c)
+            trace += cov[c][c];
+        if (trace <= 0.0f)
+            return fit;
+
+        // JP: べき乗法。初期ベクトルは対角成分から作る。
+        // EN: Power iteration. The initial vector is made from the diagonal.
+        float axis[4];
+        for (uint32_t c = 0; c < numChannels; ++c)
+            axis[c] = cov[c][c] + 1e-3f * trace;
+        float eigenValue = 0.0f;
+        for (int iter = 0; iter < 8; ++iter) {
+            float next[4] = {};
+            for (uint32_t r = 0; r < numChannels; ++r) {
+                for (uint32_t c = 0; c < numChannels; ++c)
+                    next[r] += cov[r][c] * axis[c];
+            }
+            float sqLength = 0.0f;
+            for (uint32_t c = 0; c < numChannels; ++c)
+                sqLength += next[c] * next[c];
+            if (sqLength <= 0.0f)
+                return fit;
+            float recLength = 1.0f / std::sqrt(sqLength);
+            for (uint32_t c = 0; c < numChannels; ++c)
+                axis[c] = next[c] * recLength;
+        }
+        for (uint32_t r = 0; r < numChannels; ++r) {
+            for (uint32_t c = 0; c < numChannels; ++c)
+                eigenValue += axis[r] * cov[r][c] * axis[c];
+        }
+        fit.residual = std::max(trace - eigenValue, 0.0f);
+
+        fit.tMin = INFINITY;
+        fit.tMax = -INFINITY;
+        for (uint32_t i = 0; i < numPoints; ++i) {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < numChannels; ++c)
+                t += (points[i][c] - fit.mean[c]) * axis[c];
+            fit.tMin = std::min(fit.tMin, t);
+            fit.tMax = std::max(fit.tMax, t);
+        }
+        for (uint32_t c = 0; c < numChannels; ++c)
+            fit.axis[c] = axis[c];
+
+        return fit;
+    }
+
+    // JP: インデックスに対応する補間係数を固定して、端点を最小二乗法で解き直す。
+    // EN: Re-solve endpoints in the least squares sense with the interpolation factors given by the indices fixed.
+    static bool solveEndpointsLeastSquares(const float (*points)[4], const float* factors, uint32_t numPoints,
+                                           uint32_t numChannels, float minValue, float maxValue,
+                                           float endpoint0[4], float endpoint1[4]) {
+        float a = 0.0f, b = 0.0f, c = 0.0f;
+        float x0[4] = {}, x1[4] = {};
+        for (uint32_t i = 0; i < numPoints; ++i) {
+            float t = factors[i];
+            float s = 1.0f - t;
+            a += s * s;
+            b += s * t;
+            c += t * t;
+            for (uint32_t ch = 0; ch < numChannels; ++ch) {
+                x0[ch] += s * points[i][ch];
+                x1[ch] += t * points[i][ch];
+            }
+        }
+        float det = a * c - b * b;
+        if (std::fabs(det) < 1e-6f)
+            return false;
+        float recDet = 1.0f / det;
+        for (uint32_t ch = 0; ch < numChannels; ++ch) {
+            endpoint0[ch] = clamp((c * x0[ch] - b * x1[ch]) * recDet, minValue, maxValue);
+            endpoint1[ch] = clamp((a * x1[ch] - b * x0[ch]) * recDet, minValue, maxValue);
+        }
+        return true;
+    }
+
+    // JP: パーティションを主軸近似の残差が小さい順に並べ、上位を返す。
+    // EN: Sort partitions by the residual of the principal axis approximation and return the best ones.
+    template <typename PartitionFunc>
+    static uint32_t rankPartitions(const float (*points)[4], uint32_t numChannels,
+                                   uint32_t numSubsets, uint32_t numPartitions, PartitionFunc getSubset,
+                                   uint32_t maxNumCandidates, uint32_t* candidates) {
+        std::pair<float, uint32_t> residuals[64];
+        for (uint32_t p = 0; p < numPartitions; ++p) {
+            float residual = 0.0f;
+            for (uint32_t s = 0; s < numSubsets; ++s) {
+                float subsetPoints[16][4];
+                uint32_t numPoints = 0;
+                for (uint32_t i = 0; i < 16; ++i) {
+                    if (getSubset(p, i) == s)
+                        std::copy_n(points[i], 4, subsetPoints[numPoints++]);
+                }
+                residual += fitPrincipalAxis(subsetPoints, numPoints, numChannels).residual;
+            }
+            residuals[p] = std::make_pair(residual, p);
+        }
+        uint32_t numCandidates = std::min(maxNumCandidates, numPartitions);
+        std::partial_sort(residuals, residuals + numCandidates, residuals + numPartitions);
+        for (uint32_t i = 0; i < numCandidates; ++i)
+            candidates[i] = residuals[i].second;
+        return numCandidates;
+    }
+
+    // END: Utilities shared by the encoders.
+    // ----------------------------------------------------------------
+
+
+
+    // ----------------------------------------------------------------
+    // JP: BC7エンコーダー
+    // EN: BC7 encoder
+
+    enum class BC7PBitType {
+        None,
+        PerEndpoint,
+        Shared,
+    };
+
+    // JP: 同じインデックスを共有するチャンネル群(サブセットのRGB(A)、またはモード4/5のRGBとA)の量子化結果。
+    // EN: Quantization result of channels sharing indices (RGB(A) of a subset, or RGB and A of mode 4/5).
+    struct BC7ChannelGroupFit {
+        int32_t quantized[2][4];
+        uint32_t pBits[2];
+        uint8_t indices[16];
+        int64_t error;
+    };
+
+    struct BC7ChannelGroup {
+        uint32_t channels[4];
+        uint32_t numChannels;
+        uint32_t bits[4];
+        BC7PBitType pBitType;
+        uint32_t indexBits;
+    };
+
+    static int32_t quantizeBC7Endpoint(const float* values, const BC7ChannelGroup &group, int32_t pBit,
+                                       int32_t quantized[4], int32_t decoded[4]) {
+        int32_t error = 0;
+        for (uint32_t c = 0; c < group.numChannels; ++c) {
+            uint32_t numBits = group.bits[c];
+            int32_t maxQ = (1 << numBits) - 1;
+            uint32_t precision = numBits + (pBit >= 0);
+            float scaled = values[c] / 255.0f * ((1 << precision) - 1);
+            int32_t estimate = pBit >= 0 ?
+                static_cast<int32_t>(std::round((scaled - pBit) * 0.5f)) :
+                static_cast<int32_t>(std::round(scaled));
+            int32_t bestError = INT32_MAX;
+            for (int32_t q = std::max(estimate - 1, 0); q <= std::min(estimate + 1, maxQ); ++q) {
+                int32_t dec = expandBits(pBit >= 0 ? ((q << 1) | pBit) : q, precision);
+                float diff = dec - values[c];
+                int32_t e = static_cast<int32_t>(diff * diff);
+                if (e < bestError) {
+                    bestError = e;
+                    quantized[c] = q;
+                    decoded[c] = dec;
+                }
+            }
+            error += bestError;
+        }
+        return error;
+    }
+
+    static int64_t assignBC7Indices(const int32_t (*pixels)[4], const uint8_t* pixelIndices, uint32_t numPixels,
+                                    const BC7ChannelGroup &group, const int32_t decoded[2][4],
+                                    uint8_t indices[16]) {
+        const uint32_t numIndices = 1 << group.indexBits;
+        const int32_t* weights = getInterpolationWeights(group.indexBits);
+        int32_t palette[16][4];
+        for (uint32_t k = 0; k < numIndices; ++k) {
+            for (uint32_t c = 0; c < group.numChannels; ++c)
+                palette[k][c] = interpolate(decoded[0][c], decoded[1][c], weights[k]);
+        }
+
+        int64_t error = 0;
+        for (uint32_t i = 0; i < numPixels; ++i) {
+            const int32_t* pixel = pixels[pixelIndices[i]];
+            int32_t bestError = INT32_MAX;
+            uint32_t bestIndex = 0;
+            for (uint32_t k = 0; k < numIndices; ++k) {
+                int32_t e = 0;
+                for (uint32_t c = 0; c < group.numChannels; ++c) {
+                    int32_t diff = palette[k][c] - pixel[group.channels[c]];
+                    e += diff * diff;
+                }
+                if (e < bestError) {
+                    bestError = e;
+                    bestIndex = k;
+                }
+            }
+            indices[pixelIndices[i]] = static_cast<uint8_t>(bestIndex);
+            error += bestError;
+        }
+        return error;
+    }
+
+    static void fitBC7ChannelGroup(const int32_t (*pixels)[4], const uint8_t* pixelIndices, uint32_t numPixels,
+                                   const BC7ChannelGroup &group, uint32_t anchorPixel, uint32_t numRefinements,
+                                   BC7ChannelGroupFit* fit) {
+        float points[16][4];
+        for (uint32_t i = 0; i < numPixels; ++i) {
+            for (uint32_t c = 0; c < group.numChannels; ++c)
+                points[i][c] = static_cast<float>(pixels[pixelIndices[i]][group.channels[c]]);
+        }
+        PrincipalAxisFit axisFit = fitPrincipalAxis(points, numPixels, group.numChannels);
+        float endpoints[2][4];
+        for (uint32_t c = 0; c < group.numChannels; ++c) {
+            endpoints[0][c] = clamp(axisFit.mean[c] + axisFit.tMin * axisFit.axis[c], 0.0f, 255.0f);
+            endpoints[1][c] = clamp(axisFit.mean[c] + axisFit.tMax * axisFit.axis[c], 0.0f, 255.0f);
+        }
+        if (axisFit.residual == 0.0f && axisFit.tMin > axisFit.tMax) {
+            for (uint32_t c = 0; c < group.numChannels; ++c)
+                endpoints[0][c] = endpoints[1][c] = axisFit.mean[c];
+        }
+
+        fit->error = INT64_MAX;
+        const int32_t* weights = getInterpolationWeights(group.indexBits);
+        for (uint32_t iter = 0; iter <= numRefinements; ++iter) {
+            BC7ChannelGroupFit trial;
+            int32_t decoded[2][4];
+            if (group.pBitType == BC7PBitType::None) {
+                for (uint32_t e = 0; e < 2; ++e) {
+                    quantizeBC7Endpoint(endpoints[e], group, -1, trial.quantized[e], decoded[e]);
+                    trial.pBits[e] = 0;
+                }
+            }
+            else if (group.pBitType == BC7PBitType::PerEndpoint) {
+                for (uint32_t e = 0; e < 2; ++e) {
+                    int32_t q[2][4], dec[2][4];
+                    int32_t error0 = quantizeBC7Endpoint(endpoints[e], group, 0, q[0], dec[0]);
+                    int32_t error1 = quantizeBC7Endpoint(endpoints[e], group, 1, q[1], dec[1]);
+                    uint32_t p = error1 < error0;
+                    std::copy_n(q[p], 4, trial.quantized[e]);
+                    std::copy_n(dec[p], 4, decoded[e]);
+                    trial.pBits[e] = p;
+                }
+            }
+            else {
+                int32_t q[2][2][4], dec[2][2][4];
+                int32_t errors[2];
+                for (int32_t p = 0; p < 2; ++p) {
+                    errors[p] = quantizeBC7Endpoint(endpoints[0], group, p, q[p][0], dec[p][0]) +
+                        quantizeBC7Endpoint(endpoints[1], group, p, q[p][1], dec[p][1]);
+                }
+                uint32_t p = errors[1] < errors[0];
+                for (uint32_t e = 0; e < 2; ++e) {
+                    std::copy_n(q[p][e], 4, trial.quantized[e]);
+                    std::copy_n(dec[p][e], 4, decoded[e]);
+                    trial.pBits[e] = p;
+                }
+            }
+            trial.error = assignBC7Indices(pixels, pixelIndices, numPixels, group, decoded, trial.indices);
+            if (trial.error < fit->error)
+                *fit = trial;
+            if (fit->error == 0 || iter == numRefinements)
+                break;
+
+            float factors[16];
+            for (uint32_t i = 0; i < numPixels; ++i)
+                factors[i] = weights[trial.indices[pixelIndices[i]]] / 64.0f;
+            if (!solveEndpointsLeastSquares(points, factors, numPixels, group.numChannels, 0.0f, 255.0f,
+                                            endpoints[0], endpoints[1]))
+                break;
+        }
+
+        // JP: アンカーピクセルのインデックスのMSBが0になるよう端点を入れ替える。補間は対称なので誤差は変わらない。
+        // EN: Swap the endpoints so that the MSB of the anchor pixel's index is 0.
+        //     Interpolation is symmetric, so the error doesn't change.
+        const uint32_t numIndices = 1 << group.indexBits;
+        if (fit->indices[anchorPixel] >= numIndices / 2) {
+            std::swap(fit->quantized[0], fit->quantized[1]);
+            std::swap(fit->pBits[0], fit->pBits[1]);
+            for (uint32_t i = 0; i < numPixels; ++i) {
+                uint8_t &index = fit->indices[pixelIndices[i]];
+                index = static_cast<uint8_t>(numIndices - 1 - index);
+            }
+        }
+    }
+
+    static inline uint32_t getBC7Subset(uint32_t numSubsets, uint32_t partition, uint32_t pixel) {
+        if (numSubsets == 2)
+            return (s_partitions2[partition] >> pixel) & 0x1;
+        else if (numSubsets == 3)
+            return s_partitions3[partition][pixel];
+        return 0;
+    }
+
+    static int64_t encodeBC7Mode(const int32_t (*srcPixels)[4], uint32_t modeIndex, uint32_t partition,
+                                 uint32_t rotation, uint32_t indexSelection, uint32_t numRefinements,
+                                 uint8_t* block) {
+        const BC7ModeInfo &mode = s_bc7Modes[modeIndex];
+
+        int32_t pixels[16][4];
+        for (uint32_t i = 0; i < 16; ++i) {
+            std::copy_n(srcPixels[i], 4, pixels[i]);
+            if (rotation > 0)
+                std::swap(pixels[i][3], pixels[i][rotation - 1]);
+        }
+
+        const BC7PBitType pBitType = mode.endpointPBits ? BC7PBitType::PerEndpoint :
+            (mode.sharedPBits ? BC7PBitType::Shared : BC7PBitType::None);
+
+        int64_t error = 0;
+        BC7ChannelGroupFit fits[3];
+        BC7ChannelGroupFit alphaFit;
+        uint32_t anchors[3] = { 0, 0, 0 };
+        if (mode.numSubsets == 2) {
+            anchors[1] = s_anchors2[partition];
+        }
+        else if (mode.numSubsets == 3) {
+            anchors[1] = s_anchors3_1[partition];
+            anchors[2] = s_anchors3_2[partition];
+        }
+
+        if (mode.secondaryIndexBits == 0) {
+            BC7ChannelGroup group = {
+                { 0, 1, 2, 3 }, mode.alphaBits ? 4u : 3u,
+                { mode.colorBits, mode.colorBits, mode.colorBits, mode.alphaBits },
+                pBitType, mode.indexBits
+            };
+            for (uint32_t s = 0; s < mode.numSubsets; ++s) {
+                uint8_t pixelIndices[16];
+                uint32_t numPixels = 0;
+                for (uint32_t i = 0; i < 16; ++i) {
+                    if (getBC7Subset(mode.numSubsets, partition, i) == s)
+                        pixelIndices[numPixels++] = static_cast<uint8_t>(i);
+                }
+                fitBC7ChannelGroup(pixels, pixelIndices, numPixels, group, anchors[s], numRefinements, &fits[s]);
+                error += fits[s].error;
+            }
+            // JP: アルファを持たないモードでは復元アルファは常に255。
+            // EN: Decoded alpha is always 255 in modes without alpha.
+            if (mode.alphaBits == 0) {
+                for (uint32_t i = 0; i < 16; ++i)
+                    error += (255 - pixels[i][3]) * (255 - pixels[i][3]);
+            }
+        }
+        else {
+            const uint8_t allPixels[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+            BC7ChannelGroup colorGroup = {
+                { 0, 1, 2 }, 3, { mode.colorBits, mode.colorBits, mode.colorBits },
+                BC7PBitType::None, indexSelection ? mode.secondaryIndexBits : mode.indexBits
+            };
+            BC7ChannelGroup alphaGroup = {
+                { 3 }, 1, { mode.alphaBits },
+                BC7PBitType::None, indexSelection ? mode.indexBits : mode.secondaryIndexBits
+            };
+            fitBC7ChannelGroup(pixels, allPixels, 16, colorGroup, 0, numRefinements, &fits[0]);
+            fitBC7ChannelGroup(pixels, allPixels, 16, alphaGroup, 0, numRefinements, &alphaFit);
+            error = fits[0].error + alphaFit.error;
+        }
+
+        BlockBitWriter writer;
+        writer.write(1 << modeIndex, modeIndex + 1);
+        writer.write(partition, mode.partitionBits);
+        writer.write(rotation, mode.rotationBits);
+        writer.write(indexSelection, mode.indexSelectionBits);
+        for (uint32_t c = 0; c < 3; ++c) {
+            for (uint32_t s = 0; s < mode.numSubsets; ++s) {
+                for (uint32_t e = 0; e < 2; ++e)
+                    writer.write(fits[s].quantized[e][c], mode.colorBits);
+            }
+        }
+        if (mode.alphaBits) {
+            for (uint32_t s = 0; s < mode.numSubsets; ++s) {
+                for (uint32_t e = 0; e < 2; ++e) {
+                    if (mode.secondaryIndexBits == 0)
+                        writer.write(fits[s].quantized[e][3], mode.alphaBits);
+                    else
+                        writer.write(alphaFit.quantized[e][0], mode.alphaBits);
+                }
+            }
+        }
+        if (pBitType == BC7PBitType::PerEndpoint) {
+            for (uint32_t s = 0; s < mode.numSubsets; ++s) {
+                for (uint32_t e = 0; e < 2; ++e)
+                    writer.write(fits[s].pBits[e], 1);
+            }
+        }
+        else if (pBitType == BC7PBitType::Shared) {
+            for (uint32_t s = 0; s < mode.numSubsets; ++s)
+                writer.write(fits[s].pBits[0], 1);
+        }
+
+        if (mode.secondaryIndexBits == 0) {
+            for (uint32_t i = 0; i < 16; ++i) {
+                uint32_t s = getBC7Subset(mode.numSubsets, partition, i);
+                bool isAnchor = i == anchors[s];
+                writer.write(fits[s].indices[i], mode.indexBits - isAnchor);
+            }
+        }
+        else {
+            const BC7ChannelGroupFit &primary = indexSelection ? alphaFit : fits[0];
+            const BC7ChannelGroupFit &secondary = indexSelection ? fits[0] : alphaFit;
+            for (uint32_t i = 0; i < 16; ++i)
+                writer.write(primary.indices[i], mode.indexBits - (i == 0));
+            for (uint32_t i = 0; i < 16; ++i)
+                writer.write(secondary.indices[i], mode.secondaryIndexBits - (i == 0));
+        }
+        VLRAssert(writer.getPosition() == 128, "BC7 block size mismatch: %u", writer.getPosition());
+        writer.store(block);
+
+        return error;
+    }
+
+    void encodeBC7Block(const RGBA8x4 srcPixels[16], BlockCompressionQuality quality, uint8_t* block) {
+        int32_t pixels[16][4];
+        float points[16][4];
+        bool isOpaque = true;
+        for (uint32_t i = 0; i < 16; ++i) {
+            const RGBA8x4 &src = srcPixels[i];
+            pixels[i][0] = src.r;
+            pixels[i][1] = src.g;
+            pixels[i][2] = src.b;
+            pixels[i][3] = src.a;
+            for (uint32_t c = 0; c < 4; ++c)
+                points[i][c] = static_cast<float>(pixels[i][c]);
+            isOpaque &= src.a == 255;
+        }
+
+        uint32_t numPartitionCandidates;
+        uint32_t numRefinements;
+        switch (quality) {
+        case BlockCompressionQuality::Fast:
+            numPartitionCandidates = 0;
+            numRefinements = 0;
+            break;
+        case BlockCompressionQuality::Normal:
+            numPartitionCandidates = 2;
+            numRefinements = 1;
+            break;
+        default:
+            numPartitionCandidates = 6;
+            numRefinements = 2;
+            break;
+        }
+
+        int64_t bestError = INT64_MAX;
+        uint8_t trialBlock[16];
+        const auto tryMode = [&](uint32_t modeIndex, uint32_t partition, uint32_t rotation, uint32_t indexSelection) {
+            if (bestError == 0)
+                return;
+            int64_t error = encodeBC7Mode(pixels, modeIndex, partition, rotation, indexSelection,
+                                          numRefinements, trialBlock);
+            if (error < bestError) {
+                bestError = error;
+                std::copy_n(trialBlock, 16, block);
+            }
+        };
+        const auto tryPartitionedMode = [&](uint32_t modeIndex) {
+            const BC7ModeInfo &mode = s_bc7Modes[modeIndex];
+            uint32_t candidates[64];
+            uint32_t numCandidates = rankPartitions(
+                points, mode.alphaBits ? 4 : 3, mode.numSubsets, 1 << mode.partitionBits,
+                [&mode](uint32_t p, uint32_t i) { return getBC7Subset(mode.numSubsets, p, i); },
+                numPartitionCandidates, candidates);
+            for (uint32_t i = 0; i < numCandidates; ++i)
+                tryMode(modeIndex, candidates[i], 0, 0);
+        };
+
+        // JP: モード6(1サブセット, RGBA 7.7.7.7+P, 4bitインデックス)は全品質で試す。
+        // EN: Mode 6 (one subset, RGBA 7.7.7.7+P, 4-bit indices) is tried at every quality.
+        tryMode(6, 0, 0, 0);
+        if (quality == BlockCompressionQuality::Fast)
+            return;
+
+        if (isOpaque) {
+            tryPartitionedMode(1);
+            tryPartitionedMode(3);
+            if (quality == BlockCompressionQuality::High) {
+                tryPartitionedMode(0);
+                tryPartitionedMode(2);
+            }
+        }
+        else {
+            tryMode(5, 0, 0, 0);
+            tryPartitionedMode(7);
+            if (quality == BlockCompressionQuality::High) {
+                for (uint32_t rotation = 0; rotation < 4; ++rotation) {
+                    if (rotation > 0)
+                        tryMode(5, 0, rotation, 0);
+                    tryMode(4, 0, rotation, 0);
+                    tryMode(4, 0, rotation, 1);
+                }
+            }
+        }
+    }
+
+    // END: BC7 encoder
+    // ----------------------------------------------------------------
+
+
+
+    // ----------------------------------------------------------------
+    // JP: BC6Hエンコーダー(符号無しのみ)
+    //     BC6Hは半精度浮動小数点数のビット列を整数として補間するため、その領域(ビット列 * 64 / 31)で誤差を測る。
+    // EN: BC6H encoder (unsigned only)
+    //     BC6H interpolates half-precision bit patterns as integers,
+    //     so the error is measured in that domain (bit pattern * 64 / 31).
+
+    static const uint32_t s_bc6hModeCodes[14] = {
+        0x00, 0x01, 0x02, 0x06, 0x0A, 0x0E, 0x12, 0x16, 0x1A, 0x1E, 0x03, 0x07, 0x0B, 0x0F
+    };
+
+    static inline uint16_t clampToUnsignedHalfBits(half value) {
+        uint16_t bits = bitsFromHalf(value);
+        // JP: 負値とNaNは0に、無限大は最大の有限値にクランプする。
+        // EN: Clamp negative values and NaN to 0, infinity to the largest finite value.
+        if ((bits & 0x8000) || ((bits & 0x7C00) == 0x7C00 && (bits & 0x03FF)))
+            return 0;
+        return std::min<uint16_t>(bits, 0x7BFF);
+    }
+
+    static inline float toBC6HDomain(half value) {
+        return clampToUnsignedHalfBits(value) * (64.0f / 31.0f);
+    }
+
+    static int32_t quantizeBC6HEndpoint(float value, uint32_t numBits) {
+        int32_t maxQ = (1 << numBits) - 1;
+        int32_t estimate = static_cast<int32_t>(value * (1 << numBits) / 65536.0f);
+        int32_t bestQ = 0;
+        float bestError = INFINITY;
+        for (int32_t q = std::max(estimate - 1, 0); q <= std::min(estimate + 1, maxQ); ++q) {
+            float error = std::fabs(unquantizeBC6H(q, numBits, false) - value);
+            if (error < bestError) {
+                bestError = error;
+                bestQ = q;
+            }
+        }
+        return bestQ;
+    }
+
+    static float assignBC6HIndices(const float (*values)[4], uint32_t numIndexBits,
+                                   uint16_t partitionMask, uint32_t anchorPixel, bool restrictAnchors,
+                                   const int32_t unquantized[4][3], uint8_t indices[16]) {
+        const uint32_t numIndices = 1 << numIndexBits;
+        const int32_t* weights = getInterpolationWeights(numIndexBits);
+        float palettes[2][16][3];
+        for (uint32_t r = 0; r < 2; ++r) {
+            for (uint32_t k = 0; k < numIndices; ++k) {
+                for (uint32_t c = 0; c < 3; ++c)
+                    palettes[r][k][c] = static_cast<float>(
+                        interpolate(unquantized[2 * r + 0][c], unquantized[2 * r + 1][c], weights[k]));
+            }
+        }
+
+        float error = 0.0f;
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint32_t region = (partitionMask >> i) & 0x1;
+            bool isAnchor = i == 0 || i == anchorPixel;
+            uint32_t maxIndex = (restrictAnchors && isAnchor) ? numIndices / 2 : numIndices;
+            float bestError = INFINITY;
+            uint32_t bestIndex = 0;
+            for (uint32_t k = 0; k < maxIndex; ++k) {
+                float e = 0.0f;
+                for (uint32_t c = 0; c < 3; ++c) {
+                    float diff = palettes[region][k][c] - values[i][c];
+                    e += diff * diff;
+                }
+                if (e < bestError) {
+                    bestError = e;
+                    bestIndex = k;
+                }
+            }
+            indices[i] = static_cast<uint8_t>(bestIndex);
+            error += bestError;
+        }
+        return error;
+    }
+
+    static float encodeBC6HMode(const float (*values)[4], uint32_t modeIndex, uint32_t partition,
+                                uint32_t numRefinements, uint8_t* block) {
+        const BC6HModeInfo &mode = s_bc6hModes[modeIndex];
+        const uint32_t numIndexBits = mode.numRegions == 2 ? 3 : 4;
+        const uint32_t numIndices = 1 << numIndexBits;
+        const uint32_t anchorPixel = mode.numRegions == 2 ? s_anchors2[partition] : 0;
+        const uint16_t partitionMask = mode.numRegions == 2 ? s_partitions2[partition] : 0;
+        const int32_t* weights = getInterpolationWeights(numIndexBits);
+
+        float regionValues[2][16][4];
+        uint8_t regionPixels[2][16];
+        uint32_t numRegionPixels[2] = { 0, 0 };
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint32_t region = (partitionMask >> i) & 0x1;
+            std::copy_n(values[i], 4, regionValues[region][numRegionPixels[region]]);
+            regionPixels[region][numRegionPixels[region]++] = static_cast<uint8_t>(i);
+        }
+
+        float endpoints[4][4];
+        for (uint32_t r = 0; r < mode.numRegions; ++r) {
+            PrincipalAxisFit axisFit = fitPrincipalAxis(regionValues[r], numRegionPixels[r], 3);
+            bool degenerate = axisFit.tMin > axisFit.tMax;
+            for (uint32_t c = 0; c < 3; ++c) {
+                endpoints[2 * r + 0][c] = degenerate ? axisFit.mean[c] :
+                    clamp(axisFit.mean[c] + axisFit.tMin * axisFit.axis[c], 0.0f, 65535.0f);
+                endpoints[2 * r + 1][c] = degenerate ? axisFit.mean[c] :
+                    clamp(axisFit.mean[c] + axisFit.tMax * axisFit.axis[c], 0.0f, 65535.0f);
+            }
+        }
+
+        float bestError = INFINITY;
+        for (uint32_t iter = 0; iter <= numRefinements; ++iter) {
+            int32_t quantized[4][3] = {};
+            int32_t unquantized[4][3] = {};
+            uint8_t indices[16];
+            const auto unquantizeAll = [&]() {
+                for (uint32_t e = 0; e < 2 * mode.numRegions; ++e) {
+                    for (uint32_t c = 0; c < 3; ++c)
+                        unquantized[e][c] = unquantizeBC6H(quantized[e][c], mode.endpointBits, false);
+                }
+            };
+            for (uint32_t e = 0; e < 2 * mode.numRegions; ++e) {
+                for (uint32_t c = 0; c < 3; ++c)
+                    quantized[e][c] = quantizeBC6HEndpoint(endpoints[e][c], mode.endpointBits);
+            }
+            unquantizeAll();
+
+            // JP: 差分化の前にアンカーのインデックスのMSBが0になるよう端点を入れ替える。
+            // EN: Swap endpoints so that the MSB of the anchor indices is 0 before computing deltas.
+            assignBC6HIndices(values, numIndexBits, partitionMask, anchorPixel, false, unquantized, indices);
+            if (indices[0] >= numIndices / 2)
+                std::swap(quantized[0], quantized[1]);
+            if (mode.numRegions == 2 && indices[anchorPixel] >= numIndices / 2)
+                std::swap(quantized[2], quantized[3]);
+
+            // JP: 差分が表現範囲に収まらない場合はクランプする。
+            // EN: Clamp deltas that don't fit in the representable range.
+            if (mode.transformed) {
+                for (uint32_t e = 1; e < 2 * mode.numRegions; ++e) {
+                    for (uint32_t c = 0; c < 3; ++c) {
+                        int32_t maxDelta = (1 << (mode.deltaBits[c] - 1)) - 1;
+                        int32_t delta = clamp(quantized[e][c] - quantized[0][c], -maxDelta - 1, maxDelta);
+                        quantized[e][c] = quantized[0][c] + delta;
+                    }
+                }
+            }
+            unquantizeAll();
+            float error = assignBC6HIndices(values, numIndexBits, partitionMask, anchorPixel, true,
+                                            unquantized, indices);
+
+            if (error < bestError) {
+                bestError = error;
+
+                BlockBitWriter writer;
+                writer.write(s_bc6hModeCodes[modeIndex], modeIndex < 2 ? 2 : 5);
+                for (uint32_t i = 0; i < mode.numRuns; ++i) {
+                    const BC6HBitRun &run = mode.runs[i];
+                    uint32_t e = run.field / 3;
+                    uint32_t c = run.field % 3;
+                    uint32_t value = quantized[e][c];
+                    if (mode.transformed && e > 0)
+                        value = (quantized[e][c] - quantized[0][c]) & ((1 << mode.deltaBits[c]) - 1);
+                    if (run.first <= run.last) {
+                        writer.write(value >> run.first, run.last - run.first + 1);
+                    }
+                    else {
+                        for (int32_t b = run.first; b >= run.last; --b)
+                            writer.write(value >> b, 1);
+                    }
+                }
+                if (mode.numRegions == 2)
+                    writer.write(partition, 5);
+                for (uint32_t i = 0; i < 16; ++i)
+                    writer.write(indices[i], numIndexBits - (i == 0 || i == anchorPixel));
+                VLRAssert(writer.getPosition() == 128, "BC6H block size mismatch: %u", writer.getPosition());
+                writer.store(block);
+            }
+            if (bestError == 0.0f || iter == numRefinements)
+                break;
+
+            bool solved = true;
+            for (uint32_t r = 0; r < mode.numRegions && solved; ++r) {
+                float factors[16];
+                for (uint32_t i = 0; i < numRegionPixels[r]; ++i)
+                    factors[i] = weights[indices[regionPixels[r][i]]] / 64.0f;
+                solved = solveEndpointsLeastSquares(regionValues[r], factors, numRegionPixels[r], 3, 0.0f, 65535.0f,
+                                                    endpoints[2 * r + 0], endpoints[2 * r + 1]);
+            }
+            if (!solved)
+                break;
+        }
+
+        return bestError;
+    }
+
+    void encodeBC6HBlock(const RGBA16Fx4 srcPixels[16], BlockCompressionQuality quality, uint8_t* block) {
+        float values[16][4];
+        for (uint32_t i = 0; i < 16; ++i) {
+            values[i][0] = toBC6HDomain(srcPixels[i].r);
+            values[i][1] = toBC6HDomain(srcPixels[i].g);
+            values[i][2] = toBC6HDomain(srcPixels[i].b);
+            values[i][3] = 0.0f;
+        }
+
+        uint32_t numPartitionCandidates;
+        uint32_t numRefinements;
+        switch (quality) {
+        case BlockCompressionQuality::Fast:
+            numPartitionCandidates = 0;
+            numRefinements = 0;
+            break;
+        case BlockCompressionQuality::Normal:
+            numPartitionCandidates = 2;
+            numRefinements = 1;
+            break;
+        default:
+            numPartitionCandidates = 6;
+            numRefinements = 2;
+            break;
+        }
+
+        float bestError = INFINITY;
+        uint8_t trialBlock[16];
+        const auto tryMode = [&](uint32_t modeIndex, uint32_t partition) {
+            if (bestError == 0.0f)
+                return;
+            float error = encodeBC6HMode(values, modeIndex, partition, numRefinements, trialBlock);
+            if (error < bestError) {
+                bestError = error;
+                std::copy_n(trialBlock, 16, block);
+            }
+        };
+
+        // JP: 1領域のモード(10.10, 11.9)は全品質で試す。
+        // EN: The one-region modes (10.10, 11.9) are tried at every quality.
+        tryMode(10, 0);
+        tryMode(11, 0);
+        if (quality == BlockCompressionQuality::Fast)
+            return;
+
+        tryMode(12, 0);
+        tryMode(13, 0);
+
+        uint32_t candidates[32];
+        uint32_t numCandidates = rankPartitions(
+            values, 3, 2, 32,
+            [](uint32_t p, uint32_t i) { return (s_partitions2[p] >> i) & 0x1u; },
+            numPartitionCandidates, candidates);
+        static const uint32_t normalTwoRegionModes[] = { 0, 1, 5, 9 };
+        for (uint32_t i = 0; i < numCandidates; ++i) {
+            if (quality == BlockCompressionQuality::High) {
+                for (uint32_t modeIndex = 0; modeIndex < 10; ++modeIndex)
+                    tryMode(modeIndex, candidates[i]);
+            }
+            else {
+                for (uint32_t modeIndex : normalTwoRegionModes)
+                    tryMode(modeIndex, candidates[i]);
+            }
+        }
+    }
+
+    // END: BC6H encoder
+    // ----------------------------------------------------------------
+
+
+
+    template <typename PixelType, typename BlockEncoder>
+    static void encodeBlocks(const PixelType* srcData, uint32_t width, uint32_t height,
+                             uint8_t* dstData, BlockEncoder encodeBlock) {
+        const uint32_t numBlocksX = (width + 3) / 4;
+        const uint32_t numBlocksY = (height + 3) / 4;
+        ThreadPool::getShared().parallelFor(
+            0, numBlocksY, 1,
+            [&](uint32_t byBegin, uint32_t byEnd) {
+            PixelType pixels[16];
+            for (uint32_t by = byBegin; by < byEnd; ++by) {
+                for (uint32_t bx = 0; bx < numBlocksX; ++bx) {
+                    // JP: 画像端の端数ブロックは端のピクセルを複製して埋める。
+                    // EN: Fill partial blocks at the image border by replicating the edge pixels.
+                    for (uint32_t y = 0; y < 4; ++y) {
+                        uint32_t py = std::min(4 * by + y, height - 1);
+                        for (uint32_t x = 0; x < 4; ++x) {
+                            uint32_t px = std::min(4 * bx + x, width - 1);
+                            pixels[4 * y + x] = srcData[static_cast<size_t>(py) * width + px];
+                        }
+                    }
+                    encodeBlock(pixels, dstData + (static_cast<size_t>(by) * numBlocksX + bx) * 16);
+                }
+            }
+        });
+    }
+
+    void encodeBlockCompressedImageData(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                        DataFormat bcFormat, BlockCompressionQuality quality,
+                                        uint8_t* dstData) {
+        VLRAssert(width > 0 && height > 0, "Image size must be non-zero.");
+        switch (bcFormat) {
+        case DataFormat::BC7:
+            encodeBlocks(reinterpret_cast<const RGBA8x4*>(srcData), width, height, dstData,
+                         [quality](const RGBA8x4* pixels, uint8_t* block) { encodeBC7Block(pixels, quality, block); });
+            break;
+        case DataFormat::BC6H:
+            encodeBlocks(reinterpret_cast<const RGBA16Fx4*>(srcData), width, height, dstData,
+                         [quality](const RGBA16Fx4* pixels, uint8_t* block) { encodeBC6HBlock(pixels, quality, block); });
+            break;
+        default:
+            VLRAssert(false, "Encoding into %s is not supported.", getEnumMemberFromValue(bcFormat));
+            break;
+        }
+    }
+
+    double computeBlockCompressionPSNR(const uint8_t* srcData, const uint8_t* bcData, uint32_t width, uint32_t height,
+                                       DataFormat bcFormat) {
+        DataFormat decodedFormat = getDecodedDataFormat(bcFormat);
+        std::vector<uint8_t> decodedData(sizesOfDataFormats[static_cast<uint32_t>(decodedFormat)] * width * height);
+        decodeBlockCompressedImageData(bcData, width, height, bcFormat, decodedData.data());
+
+        // JP: LDRはRGBAの8bit値で誤差を測る。
+        //     HDRはBC6Hが量子化を行う領域である、RGBの符号無し半精度浮動小数点数のビット列で誤差を測る。
+        //     ビット列は値の対数にほぼ比例するので、明るさに依らず相対誤差が等しく評価される。
+        // EN: Measure the error in 8-bit RGBA values for LDR.
+        //     HDR is measured in unsigned half-precision bit patterns of RGB, the domain BC6H quantizes in.
+        //     The bit pattern is nearly proportional to the log of the value, so relative errors weigh the same at any brightness.
+        std::vector<double> rowSqErrors(height, 0.0);
+        ThreadPool::getShared().parallelFor(
+            0, height, std::max<uint32_t>(MinNumPixelsPerChunk / width, 1),
+            [&](uint32_t yBegin, uint32_t yEnd) {
+            for (uint32_t y = yBegin; y < yEnd; ++y) {
+                double sqError = 0.0;
+                for (uint32_t x = 0; x < width; ++x) {
+                    size_t idx = static_cast<size_t>(y) * width + x;
+                    if (decodedFormat == DataFormat::RGBA8x4) {
+                        const RGBA8x4 &a = reinterpret_cast<const RGBA8x4*>(srcData)[idx];
+                        const RGBA8x4 &b = reinterpret_cast<const RGBA8x4*>(decodedData.data())[idx];
+                        int32_t diffs[4] = { a.r - b.r, a.g - b.g, a.b - b.b, a.a - b.a };
+                        for (int32_t diff : diffs)
+                            sqError += diff * diff;
+                    }
+                    else {
+                        const RGBA16Fx4 &a = reinterpret_cast<const RGBA16Fx4*>(srcData)[idx];
+                        const RGBA16Fx4 &b = reinterpret_cast<const RGBA16Fx4*>(decodedData.data())[idx];
+                        half srcValues[3] = { a.r, a.g, a.b };
+                        half decValues[3] = { b.r, b.g, b.b };
+                        for (uint32_t c = 0; c < 3; ++c) {
+                            int32_t diff = static_cast<int32_t>(clampToUnsignedHalfBits(srcValues[c])) -
+                                clampToUnsignedHalfBits(decValues[c]);
+                            sqError += static_cast<double>(diff) * diff;
+                        }
+                    }
+                }
+                rowSqErrors[y] = sqError;
+            }
+        });
+
+        double sqError = 0.0;
+        for (double e : rowSqErrors)
+            sqError += e;
+        const bool isLDR = decodedFormat == DataFormat::RGBA8x4;
+        double mse = sqError / (static_cast<double>(width) * height * (isLDR ? 4 : 3));
+        double peak = isLDR ? 255.0 : 0x7BFF;
+        if (mse == 0.0)
+            return INFINITY;
+        return 10.0 * std::log10(peak * peak / mse);
+    }
+}
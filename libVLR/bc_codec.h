@@ -0,0 +1,51 @@
+#pragma once
+
+#include "image.h"
+
+namespace vlr {
+    // JP: ブロック圧縮形式をデコードした結果のリニア形式。
+    //     BC1/2/3/7 -> RGBA8x4, BC4 -> Gray8, BC4_Signed -> Gray32F, BC5(_Signed) -> RG32Fx2, BC6H(_Signed) -> RGBA16Fx4
+    // EN: Linear format as the result of decoding a block compressed format.
+    //     BC1/2/3/7 -> RGBA8x4, BC4 -> Gray8, BC4_Signed -> Gray32F, BC5(_Signed) -> RG32Fx2, BC6H(_Signed) -> RGBA16Fx4
+    DataFormat getDecodedDataFormat(DataFormat bcFormat);
+
+    size_t getBlockCompressedDataSize(DataFormat bcFormat, uint32_t width, uint32_t height);
+
+    void decodeBC1Block(const uint8_t* block, RGBA8x4 pixels[16]);
+    void decodeBC2Block(const uint8_t* block, RGBA8x4 pixels[16]);
+    void decodeBC3Block(const uint8_t* block, RGBA8x4 pixels[16]);
+    void decodeBC4Block(const uint8_t* block, Gray8 pixels[16]);
+    void decodeBC4SignedBlock(const uint8_t* block, Gray32F pixels[16]);
+    void decodeBC5Block(const uint8_t* block, RG32Fx2 pixels[16]);
+    void decodeBC5SignedBlock(const uint8_t* block, RG32Fx2 pixels[16]);
+    void decodeBC6HBlock(const uint8_t* block, bool isSigned, RGBA16Fx4 pixels[16]);
+    void decodeBC7Block(const uint8_t* block, RGBA8x4 pixels[16]);
+
+    // JP: 1ミップレベル分のブロック圧縮データをgetDecodedDataFormat()の形式にデコードする。
+    //     ブロック行単位で共有スレッドプール上で並列に処理する。
+    // EN: Decode block compressed data of one mip level into the format of getDecodedDataFormat().
+    //     Processes block rows in parallel on the shared thread pool.
+    void decodeBlockCompressedImageData(const uint8_t* data, uint32_t width, uint32_t height, DataFormat bcFormat,
+                                        uint8_t* dstData);
+
+    // JP: 4x4ピクセルを1ブロックにエンコードする。BC6Hは符号無しのみで、負値は0にクランプされアルファは捨てられる。
+    // EN: Encode 4x4 pixels into a block. BC6H is unsigned only, negative values are clamped to 0 and alpha is dropped.
+    void encodeBC6HBlock(const RGBA16Fx4 pixels[16], BlockCompressionQuality quality, uint8_t* block);
+    void encodeBC7Block(const RGBA8x4 pixels[16], BlockCompressionQuality quality, uint8_t* block);
+
+    // JP: 1ミップレベル分のリニアな画像データをブロック圧縮する。
+    //     入力はBC7の場合RGBA8x4、BC6Hの場合RGBA16Fx4で、ブロック行単位で共有スレッドプール上で並列に処理する。
+    // EN: Block-compress linear image data of one mip level.
+    //     The input is RGBA8x4 for BC7 and RGBA16Fx4 for BC6H. Processes block rows in parallel on the shared thread pool.
+    void encodeBlockCompressedImageData(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                        DataFormat bcFormat, BlockCompressionQuality quality,
+                                        uint8_t* dstData);
+
+    // JP: エンコード前の画像データとブロック圧縮データのPSNR[dB]を計算する。
+    //     LDRはRGBAの8bit値(ピーク255)、HDRはRGBの符号無し半精度浮動小数点数のビット列(ピーク0x7BFF)で測る。
+    // EN: Compute the PSNR [dB] between image data before encoding and its block compressed data.
+    //     LDR is measured in 8-bit RGBA values (peak 255),
+    //     HDR in unsigned half-precision bit patterns of RGB (peak 0x7BFF), which is roughly a log domain.
+    double computeBlockCompressionPSNR(const uint8_t* srcData, const uint8_t* bcData, uint32_t width, uint32_t height,
+                                       DataFormat bcFormat);
+}
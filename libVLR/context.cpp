@@ -3,6 +3,8 @@
 #include <random>
 
 #include "scene.h"
+#include "prefix_sum.h"
+#include "distribution_builder.h"
 
 namespace vlr {
     cudau::BufferType g_bufferType = cudau::BufferType::Device;
@@ -115,6 +117,9 @@ namespace vlr {
         m_ID = getInstanceID();
 
         m_cuContext = cuContext;
+        m_editingScene = nullptr;
+
+        m_defaultImageResidencyPolicy = ImageResidencyPolicy::Keep;
 
         m_optix = {};
         m_optix.nodeProcedureSetBuffer.initialize(m_cuContext, 256);
@@ -1652,34 +1657,92 @@ namespace vlr {
         m_optix.dirtySurfaceMaterials.insert(mat);
     }
 
+    void Context::registerImage2D(Image2D* image) {
+        std::lock_guard<std::mutex> lock(m_imageMutex);
+        m_images.insert(image);
+    }
+
+    void Context::unregisterImage2D(Image2D* image) {
+        std::lock_guard<std::mutex> lock(m_imageMutex);
+        m_images.erase(image);
+    }
+
+    void Context::getImageMemoryReport(ImageMemoryReport* report) {
+        std::lock_guard<std::mutex> lock(m_imageMutex);
+        *report = {};
+        for (const Image2D* image : m_images) {
+            ++report->numImages;
+            if (image->isHostDataReleased())
+                ++report->numReleasedImages;
+            report->hostResidentSize += image->getHostMemorySize();
+            report->spilledSize += image->getSpilledSize();
+            report->deviceSize += image->getDeviceMemorySize();
+        }
+    }
+
+    void Context::getVertexMemoryReport(VertexMemoryReport* report) const {
+        *report = {};
+        for (const TriangleMeshSurfaceNode* mesh : m_triangleMeshes) {
+            uint32_t numVertices = mesh->getNumVertices();
+            ++report->numMeshes;
+            if (mesh->getVertexFormat() == VLRVertexFormat_Compact)
+                ++report->numCompactMeshes;
+            report->numVertices += numVertices;
+            report->fullFormatSize += sizeof(Vertex) * numVertices;
+            report->compactFormatSize += sizeof(shared::CompactVertex) * numVertices;
+        }
+    }
+
 
 
     // ----------------------------------------------------------------
     // Miscellaneous
 
     template <typename RealType>
-    void DiscreteDistribution1DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numValues) {
+    void DiscreteDistribution1DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numValues,
+                                                              shared::DistributionLayout layout) {
         CUcontext cuContext = context.getCUcontext();
 
         m_numValues = static_cast<uint32_t>(numValues);
+        m_layout = layout;
+
+        if (m_layout == shared::DistributionLayout::SumTree) {
+            m_sumTree.resize(shared::computeSumTreeSize(m_numValues));
+            m_integral = buildSumTree(values, m_numValues, m_sumTree.data());
+            m_CDF.initialize(cuContext, g_bufferType, m_sumTree);
+            return;
+        }
+
         m_PMF.initialize(cuContext, g_bufferType, m_numValues);
-        m_CDF.initialize(cuContext, g_bufferType, m_numValues + 1);
+
+        if (m_layout == shared::DistributionLayout::AliasTable) {
+            ParallelPrefixSum prefixSum;
+            double integral = prefixSum.sum(m_numValues, [values](uint32_t i) { return values[i]; });
+            m_integral = static_cast<RealType>(integral);
+
+            RealType* PMF = m_PMF.map();
+            ThreadPool::getShared().parallelFor(
+                0, m_numValues, 1 << 14,
+                [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; ++i)
+                    PMF[i] = static_cast<RealType>(values[i] / integral);
+            });
+
+            m_aliasTable.initialize(cuContext, g_bufferType, m_numValues);
+            shared::AliasTableEntry<RealType>* aliasTable = m_aliasTable.map();
+            buildAliasTable(PMF, m_numValues, aliasTable);
+            m_aliasTable.unmap();
+            m_PMF.unmap();
+            return;
+        }
+
+        m_CDF.initialize(cuContext, g_bufferType, getCDFSize(m_numValues, m_layout));
 
         RealType* PMF = m_PMF.map();
         RealType* CDF = m_CDF.map();
-        std::memcpy(PMF, values, sizeof(RealType) * m_numValues);
-
-        CompensatedSum<RealType> sum(0);
-        for (int i = 0; i < static_cast<int>(m_numValues); ++i) {
-            CDF[i] = sum;
-            sum += PMF[i];
-        }
-        m_integral = sum;
-        for (int i = 0; i < static_cast<int>(m_numValues); ++i) {
-            PMF[i] /= m_integral;
-            CDF[i] /= m_integral;
-        }
-        CDF[m_numValues] = 1.0f;
+        m_integral = computeDiscreteCDF(values, m_numValues, PMF, CDF);
+        if (m_layout == shared::DistributionLayout::BTreeCDF)
+            buildCDFBTree(CDF, m_numValues);
 
         m_CDF.unmap();
         m_PMF.unmap();
@@ -1687,17 +1750,43 @@ namespace vlr {
 
     template <typename RealType>
     void DiscreteDistribution1DTemplate<RealType>::finalize(Context &context) {
-        if (m_CDF.isInitialized() && m_PMF.isInitialized()) {
+        if (m_aliasTable.isInitialized())
+            m_aliasTable.finalize();
+        if (m_CDF.isInitialized())
             m_CDF.finalize();
+        if (m_PMF.isInitialized())
             m_PMF.finalize();
+        m_sumTree.clear();
+        m_sumTree.shrink_to_fit();
+    }
+
+    template <typename RealType>
+    void DiscreteDistribution1DTemplate<RealType>::updateValues(Context &context, const uint32_t* indices, const RealType* values, uint32_t numUpdates,
+                                                                CUstream stream) {
+        VLRAssert(m_layout == shared::DistributionLayout::SumTree, "Only SumTree supports updating values.");
+        if (numUpdates == 0)
+            return;
+
+        // JP: 変化したノードを連続する範囲にまとめて転送する。間隔が小さい範囲は転送回数を減らすためにつなげる。
+        // EN: Transfer the changed nodes as contiguous ranges.
+        //     Ranges separated by small gaps are joined to reduce the number of transfers.
+        constexpr uint32_t MaxGap = 16;
+        std::vector<SumTreeNodeRange> dirtyRanges;
+        m_integral = updateSumTree(m_sumTree.data(), m_numValues, indices, values, numUpdates, MaxGap, &dirtyRanges);
+        for (const SumTreeNodeRange &range : dirtyRanges) {
+            CUDADRV_CHECK(cuMemcpyHtoDAsync(m_CDF.getCUdeviceptrAt(range.begin), m_sumTree.data() + range.begin,
+                                            sizeof(RealType) * (range.end - range.begin), stream));
         }
     }
 
     template <typename RealType>
     void DiscreteDistribution1DTemplate<RealType>::getInternalType(shared::DiscreteDistribution1DTemplate<RealType>* instance) const {
-        if (m_PMF.isInitialized() && m_CDF.isInitialized())
+        if (isInitialized())
             new (instance) shared::DiscreteDistribution1DTemplate<RealType>(
-                m_PMF.getDevicePointer(), m_CDF.getDevicePointer(), m_integral, m_numValues);
+                m_PMF.isInitialized() ? m_PMF.getDevicePointer() : nullptr,
+                m_CDF.isInitialized() ? m_CDF.getDevicePointer() : nullptr,
+                m_aliasTable.isInitialized() ? m_aliasTable.getDevicePointer() : nullptr,
+                m_integral, m_numValues, m_layout);
     }
 
     template class DiscreteDistribution1DTemplate<float>;
@@ -1705,28 +1794,21 @@ namespace vlr {
 
 
     template <typename RealType>
-    void RegularConstantContinuousDistribution1DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numValues) {
+    void RegularConstantContinuousDistribution1DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numValues,
+                                                                               shared::DistributionLayout layout) {
+        VLRAssert(layout != shared::DistributionLayout::AliasTable, "Alias table isn't supported for this distribution.");
         CUcontext cuContext = context.getCUcontext();
 
         m_numValues = static_cast<uint32_t>(numValues);
+        m_layout = layout;
         m_PDF.initialize(cuContext, g_bufferType, m_numValues);
-        m_CDF.initialize(cuContext, g_bufferType, m_numValues + 1);
+        m_CDF.initialize(cuContext, g_bufferType, getCDFSize(m_numValues, m_layout));
 
         RealType* PDF = m_PDF.map();
         RealType* CDF = m_CDF.map();
-        std::memcpy(PDF, values, sizeof(RealType) * m_numValues);
-
-        CompensatedSum<RealType> sum{ 0 };
-        for (int i = 0; i < static_cast<int>(m_numValues); ++i) {
-            CDF[i] = sum;
-            sum += PDF[i] / m_numValues;
-        }
-        m_integral = sum;
-        for (int i = 0; i < static_cast<int>(m_numValues); ++i) {
-            PDF[i] /= m_integral;
-            CDF[i] /= m_integral;
-        }
-        CDF[m_numValues] = 1.0f;
+        m_integral = computeRegularConstantCDF(values, m_numValues, PDF, CDF);
+        if (m_layout == shared::DistributionLayout::BTreeCDF)
+            buildCDFBTree(CDF, m_numValues);
 
         m_CDF.unmap();
         m_PDF.unmap();
@@ -1743,7 +1825,7 @@ namespace vlr {
     template <typename RealType>
     void RegularConstantContinuousDistribution1DTemplate<RealType>::getInternalType(shared::RegularConstantContinuousDistribution1DTemplate<RealType>* instance) const {
         new (instance) shared::RegularConstantContinuousDistribution1DTemplate<RealType>(
-            m_PDF.getDevicePointer(), m_CDF.getDevicePointer(), m_integral, m_numValues);
+            m_PDF.getDevicePointer(), m_CDF.getDevicePointer(), m_integral, m_numValues, m_layout);
     }
 
     template class RegularConstantContinuousDistribution1DTemplate<float>;
@@ -1754,44 +1836,56 @@ namespace vlr {
     void RegularConstantContinuousDistribution2DTemplate<RealType>::initialize(Context &context, const RealType* values, size_t numD1, size_t numD2) {
         CUcontext cuContext = context.getCUcontext();
 
-        m_1DDists = new RegularConstantContinuousDistribution1DTemplate<RealType>[numD2];
-        m_raw1DDists.initialize(cuContext, g_bufferType, static_cast<uint32_t>(numD2));
-
+        uint32_t numValues = static_cast<uint32_t>(numD1);
+        uint32_t numRows = static_cast<uint32_t>(numD2);
+        size_t PDFSize = static_cast<size_t>(numValues) * numRows;
+        uint32_t CDFSize = getCDFSize(numValues, shared::DefaultCDFLayout);
+        m_rowData.initialize(cuContext, g_bufferType, static_cast<uint32_t>(PDFSize + static_cast<size_t>(CDFSize) * numRows));
+        m_raw1DDists.initialize(cuContext, g_bufferType, numRows);
+
+        RealType* PDFs = m_rowData.map();
+        RealType* CDFs = PDFs + PDFSize;
+        const RealType* devicePDFs = m_rowData.getDevicePointer();
+        const RealType* deviceCDFs = devicePDFs + PDFSize;
         shared::RegularConstantContinuousDistribution1DTemplate<RealType>* rawDists = m_raw1DDists.map();
 
-        // JP: まず各行に関するDistribution1Dを作成する。
-        // EN: First, create Distribution1D's for every rows.
-        CompensatedSum<RealType> sum(0);
-        RealType* integrals = new RealType[numD2];
-        for (int i = 0; i < numD2; ++i) {
-            RegularConstantContinuousDistribution1D &dist = m_1DDists[i];
-            dist.initialize(context, values + i * numD1, numD1);
-            dist.getInternalType(&rawDists[i]);
-            integrals[i] = dist.getIntegral();
-            sum += integrals[i];
-        }
+        // JP: まず各行の分布を並列に作成する。
+        // EN: First, create distributions for every rows in parallel.
+        std::vector<RealType> integrals(numRows);
+        uint32_t grainSize = std::max<uint32_t>(1, (1 << 14) / std::max<uint32_t>(numValues, 1));
+        ThreadPool::getShared().parallelFor(
+            0, numRows, grainSize,
+            [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                size_t PDFOffset = static_cast<size_t>(numValues) * i;
+                size_t CDFOffset = static_cast<size_t>(CDFSize) * i;
+                integrals[i] = computeRegularConstantCDF(values + PDFOffset, numValues, PDFs + PDFOffset, CDFs + CDFOffset);
+                if (shared::DefaultCDFLayout == shared::DistributionLayout::BTreeCDF)
+                    buildCDFBTree(CDFs + CDFOffset, numValues);
+                new (&rawDists[i]) shared::RegularConstantContinuousDistribution1DTemplate<RealType>(
+                    devicePDFs + PDFOffset, deviceCDFs + CDFOffset, integrals[i], numValues,
+                    shared::DefaultCDFLayout);
+            }
+        });
+
+        m_raw1DDists.unmap();
+        m_rowData.unmap();
 
         // JP: 各行の積分値を用いてDistribution1Dを作成する。
         // EN: create a Distribution1D using integral values of each row.
-        m_top1DDist.initialize(context, integrals, numD2);
-        delete[] integrals;
+        m_top1DDist.initialize(context, integrals.data(), numRows);
 
         VLRAssert(std::isfinite(m_top1DDist.getIntegral()), "invalid integral value.");
-
-        m_raw1DDists.unmap();
     }
 
     template <typename RealType>
     void RegularConstantContinuousDistribution2DTemplate<RealType>::finalize(Context &context) {
-        m_top1DDist.finalize(context);
-
-        for (int i = m_top1DDist.getNumValues() - 1; i >= 0; --i) {
-            m_1DDists[i].finalize(context);
-        }
+        if (!isInitialized())
+            return;
 
+        m_top1DDist.finalize(context);
         m_raw1DDists.finalize();
-        delete[] m_1DDists;
-        m_1DDists = nullptr;
+        m_rowData.finalize();
     }
 
     template <typename RealType>
@@ -1804,6 +1898,44 @@ namespace vlr {
 
     template class RegularConstantContinuousDistribution2DTemplate<float>;
 
+
+
+    void LightBVH::initialize(Context &context, const shared::LightBounds* lights, uint32_t numLights) {
+        CUcontext cuContext = context.getCUcontext();
+
+        buildLightBVH(lights, numLights, &m_nodes, &m_bitTrails);
+
+        // JP: 空のバッファーは作れないので最低1要素確保する。
+        // EN: Allocate at least one element since an empty buffer can't be created.
+        m_nodeBuffer.initialize(cuContext, g_bufferType, std::max<uint32_t>(static_cast<uint32_t>(m_nodes.size()), 1));
+        m_bitTrailBuffer.initialize(cuContext, g_bufferType, std::max<uint32_t>(numLights, 1));
+        if (!m_nodes.empty())
+            m_nodeBuffer.write(m_nodes);
+        if (numLights > 0)
+            m_bitTrailBuffer.write(m_bitTrails);
+    }
+
+    void LightBVH::finalize(Context &context) {
+        if (!isInitialized())
+            return;
+        m_bitTrailBuffer.finalize();
+        m_nodeBuffer.finalize();
+        m_bitTrails.clear();
+        m_nodes.clear();
+    }
+
+    void LightBVH::getInternalType(shared::LightBVH* instance) const {
+        new (instance) shared::LightBVH(
+            m_nodeBuffer.getDevicePointer(), m_bitTrailBuffer.getDevicePointer(),
+            static_cast<uint32_t>(m_nodes.size()), static_cast<uint32_t>(m_bitTrails.size()));
+    }
+
+    void LightBVH::getHostInternalType(shared::LightBVH* instance) const {
+        new (instance) shared::LightBVH(
+            m_nodes.data(), m_bitTrails.data(),
+            static_cast<uint32_t>(m_nodes.size()), static_cast<uint32_t>(m_bitTrails.size()));
+    }
+
     // END: Miscellaneous
     // ----------------------------------------------------------------
 }
@@ -4,6 +4,9 @@
 #include "shared/light_transport_common.h"
 
 #include "slot_finder.h"
+#include "transform_arena.h"
+
+#include <mutex>
 
 namespace vlr {
     extern cudau::BufferType g_bufferType;
@@ -133,6 +136,10 @@ namespace vlr {
     class Camera;
     class ShaderNode;
     class SurfaceMaterial;
+    class Image2D;
+    struct ImageMemoryReport;
+    class TriangleMeshSurfaceNode;
+    struct VertexMemoryReport;
 
     class Context : public TypeAwareClass {
         static uint32_t NextID;
@@ -343,6 +350,15 @@ namespace vlr {
         cudau::Kernel m_convertToRGB;
 
         Scene* m_scene;
+        // JP: beginEdits()からcommitEdits()までの間、ノードの接続の変更を記録するシーン。編集中でなければnullptr。
+        // EN: Scene recording changes of node links between beginEdits() and commitEdits(). nullptr when not editing.
+        Scene* m_editingScene;
+        SHTransformArena m_shTransformArena;
+
+        std::mutex m_imageMutex;
+        std::unordered_set<Image2D*> m_images;
+        ImageResidencyPolicy m_defaultImageResidencyPolicy;
+        std::unordered_set<TriangleMeshSurfaceNode*> m_triangleMeshes;
 
         uint32_t m_width;
         uint32_t m_height;
@@ -373,6 +389,12 @@ namespace vlr {
         void readOutputBuffer(float* data);
 
         void setScene(Scene* scene);
+        void setEditingScene(Scene* scene) {
+            m_editingScene = scene;
+        }
+        Scene* getEditingScene() const {
+            return m_editingScene;
+        }
         void setRenderer(VLRRenderer renderer) {
             m_renderer = renderer;
         }
@@ -390,6 +412,9 @@ namespace vlr {
         CUcontext getCUcontext() const {
             return m_cuContext;
         }
+        SHTransformArena &getSHTransformArena() {
+            return m_shTransformArena;
+        }
         optixu::Context getOptiXContext() const {
             return m_optix.context;
         }
@@ -448,6 +473,24 @@ namespace vlr {
         void markShaderNodeDescriptorDirty(ShaderNode* node);
         void markSurfaceMaterialDescriptorDirty(SurfaceMaterial* mat);
 
+        void registerImage2D(Image2D* image);
+        void unregisterImage2D(Image2D* image);
+        void setDefaultImageResidencyPolicy(ImageResidencyPolicy policy) {
+            m_defaultImageResidencyPolicy = policy;
+        }
+        ImageResidencyPolicy getDefaultImageResidencyPolicy() const {
+            return m_defaultImageResidencyPolicy;
+        }
+        void getImageMemoryReport(ImageMemoryReport* report);
+
+        void registerTriangleMesh(TriangleMeshSurfaceNode* mesh) {
+            m_triangleMeshes.insert(mesh);
+        }
+        void unregisterTriangleMesh(TriangleMeshSurfaceNode* mesh) {
+            m_triangleMeshes.erase(mesh);
+        }
+        void getVertexMemoryReport(VertexMemoryReport* report) const;
+
         void computeInstanceAABBs(
             CUstream stream,
             const uint32_t* instIndices, const uint32_t* itemOffsets,
@@ -500,18 +543,43 @@ namespace vlr {
     class DiscreteDistribution1DTemplate {
         cudau::TypedBuffer<RealType> m_PMF;
         cudau::TypedBuffer<RealType> m_CDF;
+        cudau::TypedBuffer<shared::AliasTableEntry<RealType>> m_aliasTable;
+        std::vector<RealType> m_sumTree; // JP: SumTreeの場合のホスト側の複製。 EN: Host-side copy for SumTree.
         RealType m_integral;
         uint32_t m_numValues;
+        shared::DistributionLayout m_layout;
 
     public:
-        void initialize(Context &context, const RealType* values, size_t numValues);
+        // JP: layoutでサンプリング用データの配置を選ぶ。どの配置でもサンプルの分布は変わらない。
+        // EN: layout selects the layout of the sampling data. The distribution of samples is the same for any layout.
+        void initialize(Context &context, const RealType* values, size_t numValues,
+                        shared::DistributionLayout layout = shared::DefaultCDFLayout);
         void finalize(Context &context);
 
+        // JP: indices[i]番目の値をvalues[i]に置き換える。SumTreeの場合のみ使用可能。
+        //     和の木のうち更新された葉から根までの経路だけを再計算し、変化した範囲だけをデバイスに転送するので
+        //     k個の値の更新はO(k log n)で済む。getInternalType()で得たインスタンスは更新後もそのまま使える。
+        //     他の配置では全体をinitialize()し直す必要がある。
+        // EN: Replace the indices[i]-th value with values[i]. Available only for SumTree.
+        //     Only the paths from the updated leaves to the root of the sum tree are recomputed,
+        //     and only the changed ranges are transferred to the device, so updating k values costs O(k log n).
+        //     An instance obtained by getInternalType() remains valid after the update.
+        //     Other layouts require re-initialize() of the whole distribution.
+        void updateValues(Context &context, const uint32_t* indices, const RealType* values, uint32_t numUpdates,
+                          CUstream stream = 0);
+
+        bool isInitialized() const { return m_CDF.isInitialized() || m_aliasTable.isInitialized(); }
+        uint32_t getNumValues() const { return m_numValues; }
+        shared::DistributionLayout getLayout() const { return m_layout; }
+
         DiscreteDistribution1DTemplate &operator=(DiscreteDistribution1DTemplate &&v) {
             m_PMF = std::move(v.m_PMF);
             m_CDF = std::move(v.m_CDF);
+            m_aliasTable = std::move(v.m_aliasTable);
+            m_sumTree = std::move(v.m_sumTree);
             m_integral = v.m_integral;
             m_numValues = v.m_numValues;
+            m_layout = v.m_layout;
             return *this;
         }
 
@@ -528,9 +596,13 @@ namespace vlr {
         cudau::TypedBuffer<RealType> m_CDF;
         RealType m_integral;
         uint32_t m_numValues;
+        shared::DistributionLayout m_layout;
 
     public:
-        void initialize(Context &context, const RealType* values, size_t numValues);
+        // JP: layoutにはLinearCDFかBTreeCDFを指定する。
+        // EN: layout is either LinearCDF or BTreeCDF.
+        void initialize(Context &context, const RealType* values, size_t numValues,
+                        shared::DistributionLayout layout = shared::DefaultCDFLayout);
         void finalize(Context &context);
 
         RegularConstantContinuousDistribution1DTemplate &operator=(RegularConstantContinuousDistribution1DTemplate &&v) {
@@ -538,6 +610,7 @@ namespace vlr {
             m_CDF = std::move(v.m_CDF);
             m_integral = v.m_integral;
             m_numValues = v.m_numValues;
+            m_layout = v.m_layout;
             return *this;
         }
 
@@ -553,16 +626,19 @@ namespace vlr {
 
     template <typename RealType>
     class RegularConstantContinuousDistribution2DTemplate {
+        // JP: 全行のPDFとCDFを1つのバッファーにまとめる。前半が各行のPDF(numD1要素ずつ)、後半が各行のCDF。
+        //     各行と上位の分布はshared::DefaultCDFLayoutの配置で構築する。
+        // EN: PDFs and CDFs of all the rows in a single buffer.
+        //     The first half holds PDF of each row (numD1 entries each), the second half CDF of each row.
+        //     The rows and the top-level distribution are built in the shared::DefaultCDFLayout layout.
+        cudau::TypedBuffer<RealType> m_rowData;
         cudau::TypedBuffer<shared::RegularConstantContinuousDistribution1DTemplate<RealType>> m_raw1DDists;
-        RegularConstantContinuousDistribution1DTemplate<RealType>* m_1DDists;
         RegularConstantContinuousDistribution1DTemplate<RealType> m_top1DDist;
 
     public:
-        RegularConstantContinuousDistribution2DTemplate() : m_1DDists(nullptr) {}
-
         RegularConstantContinuousDistribution2DTemplate &operator=(RegularConstantContinuousDistribution2DTemplate &&v) {
+            m_rowData = std::move(v.m_rowData);
             m_raw1DDists = std::move(v.m_raw1DDists);
-            m_1DDists = std::move(v.m_1DDists);
             m_top1DDist = std::move(v.m_top1DDist);
             return *this;
         }
@@ -570,13 +646,37 @@ namespace vlr {
         void initialize(Context &context, const RealType* values, size_t numD1, size_t numD2);
         void finalize(Context &context);
 
-        bool isInitialized() const { return m_1DDists != nullptr; }
+        bool isInitialized() const { return m_raw1DDists.isInitialized(); }
 
         void getInternalType(shared::RegularConstantContinuousDistribution2DTemplate<RealType>* instance) const;
     };
 
     using RegularConstantContinuousDistribution2D = RegularConstantContinuousDistribution2DTemplate<float>;
 
+
+
+    // JP: 光源のBVHをホスト側で構築する(buildLightBVH()を参照)。
+    //     ホスト側にもデータを保持するので、CPUからもサンプリングや確率の評価ができる。
+    // EN: Build a BVH of lights on the host (see buildLightBVH()).
+    //     The data is kept on the host as well, so sampling and probability evaluation are available on the CPU too.
+    class LightBVH {
+        std::vector<shared::LightBVHNode> m_nodes;
+        std::vector<uint64_t> m_bitTrails;
+        cudau::TypedBuffer<shared::LightBVHNode> m_nodeBuffer;
+        cudau::TypedBuffer<uint64_t> m_bitTrailBuffer;
+
+    public:
+        // JP: 放射の無い光源はBVHに含めず、選択確率はゼロになる。
+        // EN: Lights without emission are not included in the BVH, and their probabilities are zero.
+        void initialize(Context &context, const shared::LightBounds* lights, uint32_t numLights);
+        void finalize(Context &context);
+
+        bool isInitialized() const { return m_bitTrailBuffer.isInitialized(); }
+
+        void getInternalType(shared::LightBVH* instance) const;
+        void getHostInternalType(shared::LightBVH* instance) const;
+    };
+
     // END: Miscellaneous
     // ----------------------------------------------------------------
 }
@@ -0,0 +1,475 @@
+﻿#include "distribution_builder.h"
+#include "prefix_sum.h"
+
+namespace vlr {
+    // JP: [0, n)を並列に処理する際のチャンク。小さい入力では分割しない。
+    // EN: Chunks to process [0, n) in parallel. Small inputs aren't split.
+    static uint32_t getNumParallelChunks(uint32_t n) {
+        constexpr uint32_t minChunkSize = 1 << 14;
+        uint32_t maxNumChunks = 4 * ThreadPool::getShared().getNumThreads();
+        return std::max<uint32_t>(std::min<uint32_t>((n + minChunkSize - 1) / minChunkSize, maxNumChunks), 1);
+    }
+
+    template <typename RealType>
+    void buildAliasTable(const RealType* PMF, uint32_t numValues, shared::AliasTableEntry<RealType>* aliasTable) {
+        const auto scaled = [&](uint32_t i) {
+            return static_cast<double>(PMF[i]) * numValues;
+        };
+
+        // JP: 軽い要素と重い要素を元の順序を保って分ける。
+        // EN: Split light and heavy items preserving the original order.
+        uint32_t numChunks = getNumParallelChunks(numValues);
+        uint32_t chunkSize = (numValues + numChunks - 1) / numChunks;
+        std::vector<uint32_t> numLightsPerChunk(numChunks + 1, 0);
+        ThreadPool::getShared().parallelFor(
+            0, numChunks, 1,
+            [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c) {
+                uint32_t numLights = 0;
+                for (uint32_t i = c * chunkSize; i < std::min((c + 1) * chunkSize, numValues); ++i)
+                    numLights += scaled(i) < 1.0;
+                numLightsPerChunk[c + 1] = numLights;
+            }
+        });
+        for (uint32_t c = 0; c < numChunks; ++c)
+            numLightsPerChunk[c + 1] += numLightsPerChunk[c];
+        uint32_t numLights = numLightsPerChunk[numChunks];
+        uint32_t numHeavies = numValues - numLights;
+        std::vector<uint32_t> lights(numLights);
+        std::vector<uint32_t> heavies(numHeavies);
+        ThreadPool::getShared().parallelFor(
+            0, numChunks, 1,
+            [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c) {
+                uint32_t lightIdx = numLightsPerChunk[c];
+                uint32_t heavyIdx = c * chunkSize - lightIdx;
+                for (uint32_t i = c * chunkSize; i < std::min((c + 1) * chunkSize, numValues); ++i) {
+                    if (scaled(i) < 1.0)
+                        lights[lightIdx++] = i;
+                    else
+                        heavies[heavyIdx++] = i;
+                }
+            }
+        });
+
+        // JP: 丸め誤差で重い要素が無い場合は全て自身を選ぶ。
+        // EN: When there is no heavy item due to rounding errors, every bucket selects itself.
+        if (numHeavies == 0) {
+            for (uint32_t i = 0; i < numValues; ++i)
+                aliasTable[i] = shared::AliasTableEntry<RealType>{ 1, i };
+            return;
+        }
+
+        std::vector<double> lightDeficits(numLights + 1);
+        std::vector<double> heavyExcesses(numHeavies + 1);
+        parallelExclusivePrefixSum(numLights, [&](uint32_t k) { return 1.0 - scaled(lights[k]); }, lightDeficits.data());
+        parallelExclusivePrefixSum(numHeavies, [&](uint32_t k) { return scaled(heavies[k]) - 1.0; }, heavyExcesses.data());
+
+        ThreadPool::getShared().parallelFor(
+            0, numLights, 1 << 12,
+            [&](uint32_t begin, uint32_t end) {
+            for (uint32_t k = begin; k < end; ++k) {
+                auto it = std::upper_bound(heavyExcesses.cbegin(), heavyExcesses.cend() - 1, lightDeficits[k]);
+                uint32_t j = static_cast<uint32_t>(std::distance(heavyExcesses.cbegin(), it)) - 1;
+                j = std::min(j, numHeavies - 1);
+                uint32_t i = lights[k];
+                aliasTable[i] = shared::AliasTableEntry<RealType>{ static_cast<RealType>(scaled(i)), heavies[j] };
+            }
+        });
+        ThreadPool::getShared().parallelFor(
+            0, numHeavies, 1 << 12,
+            [&](uint32_t begin, uint32_t end) {
+            for (uint32_t j = begin; j < end; ++j) {
+                uint32_t i = heavies[j];
+                if (j == numHeavies - 1) {
+                    // JP: 最後の重い要素が丸め誤差を吸収する。
+                    // EN: The last heavy item absorbs rounding errors.
+                    aliasTable[i] = shared::AliasTableEntry<RealType>{ 1, i };
+                    continue;
+                }
+                auto it = std::lower_bound(lightDeficits.cbegin(), lightDeficits.cend(), heavyExcesses[j + 1]);
+                double consumed = it != lightDeficits.cend() ? *it : lightDeficits.back();
+                double probability = std::min(std::max(1.0 - (consumed - heavyExcesses[j + 1]), 0.0), 1.0);
+                aliasTable[i] = shared::AliasTableEntry<RealType>{ static_cast<RealType>(probability), heavies[j + 1] };
+            }
+        });
+    }
+
+    template void buildAliasTable<float>(const float* PMF, uint32_t numValues, shared::AliasTableEntry<float>* aliasTable);
+
+
+
+    template <typename RealType>
+    RealType computeDiscreteCDF(const RealType* values, uint32_t numValues, RealType* PMF, RealType* CDF) {
+        const auto getValue = [values](uint32_t i) {
+            return values[i];
+        };
+        ParallelPrefixSum prefixSum;
+        double integral = prefixSum.sum(numValues, getValue);
+        prefixSum.scan(getValue, [&](uint32_t i, double prefix) {
+            PMF[i] = static_cast<RealType>(values[i] / integral);
+            CDF[i] = static_cast<RealType>(prefix / integral);
+        });
+        CDF[numValues] = 1.0f;
+
+        return static_cast<RealType>(integral);
+    }
+
+    template <typename RealType>
+    RealType computeRegularConstantCDF(const RealType* values, uint32_t numValues, RealType* PDF, RealType* CDF) {
+        const auto getValue = [values, numValues](uint32_t i) {
+            return static_cast<double>(values[i]) / numValues;
+        };
+        ParallelPrefixSum prefixSum;
+        double integral = prefixSum.sum(numValues, getValue);
+        prefixSum.scan(getValue, [&](uint32_t i, double prefix) {
+            PDF[i] = static_cast<RealType>(values[i] / integral);
+            CDF[i] = static_cast<RealType>(prefix / integral);
+        });
+        CDF[numValues] = 1.0f;
+
+        return static_cast<RealType>(integral);
+    }
+
+    template float computeDiscreteCDF<float>(const float* values, uint32_t numValues, float* PMF, float* CDF);
+    template float computeRegularConstantCDF<float>(const float* values, uint32_t numValues, float* PDF, float* CDF);
+
+
+
+    uint32_t getCDFSize(uint32_t numValues, shared::DistributionLayout layout) {
+        if (layout == shared::DistributionLayout::BTreeCDF) {
+            uint32_t numNodes[shared::CDFBTreeMaxNumLevels];
+            uint32_t numLevels;
+            return shared::computeCDFBTreeLevels(numValues, numNodes, &numLevels);
+        }
+        return numValues + 1;
+    }
+
+    template <typename RealType>
+    void buildCDFBTree(RealType* CDF, uint32_t numValues) {
+        constexpr uint32_t nodeSize = shared::CDFBTreeNodeSize;
+        uint32_t numNodes[shared::CDFBTreeMaxNumLevels];
+        uint32_t numLevels;
+        shared::computeCDFBTreeLevels(numValues, numNodes, &numLevels);
+
+        const RealType padding = std::numeric_limits<RealType>::infinity();
+        std::fill(CDF + numValues + 1, CDF + numNodes[0] * nodeSize, padding);
+
+        RealType* levelData = CDF + numNodes[0] * nodeSize;
+        // JP: 1つ上の階層の子1つがまとめる葉の数。
+        // EN: Number of leaves covered by a child of a node at the level.
+        uint64_t numLeavesPerChild = 1;
+        for (uint32_t level = 1; level < numLevels; ++level) {
+            ThreadPool::getShared().parallelFor(
+                0, numNodes[level], 1 << 10,
+                [&](uint32_t begin, uint32_t end) {
+                for (uint32_t nodeIdx = begin; nodeIdx < end; ++nodeIdx) {
+                    for (uint32_t k = 0; k < nodeSize; ++k) {
+                        uint64_t leafIdx = (static_cast<uint64_t>(nodeIdx) * (nodeSize + 1) + k + 1) * numLeavesPerChild;
+                        levelData[nodeIdx * nodeSize + k] = leafIdx < numNodes[0] ? CDF[leafIdx * nodeSize] : padding;
+                    }
+                }
+            });
+            levelData += numNodes[level] * nodeSize;
+            numLeavesPerChild *= nodeSize + 1;
+        }
+    }
+
+    template void buildCDFBTree<float>(float* CDF, uint32_t numValues);
+
+
+
+    template <typename RealType>
+    RealType buildSumTree(const RealType* values, uint32_t numValues, RealType* sumTree) {
+        uint32_t numLeaves = nextPowerOf2(numValues);
+        sumTree[0] = 0.0f;
+        ThreadPool::getShared().parallelFor(
+            0, numLeaves, 1 << 14,
+            [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i)
+                sumTree[numLeaves + i] = i < numValues ? values[i] : 0.0f;
+        });
+        // JP: 下の階層から順に、各階層内は並列に部分和を求める。
+        // EN: Compute partial sums level by level from the bottom, in parallel within each level.
+        for (uint32_t levelBegin = numLeaves >> 1; levelBegin >= 1; levelBegin >>= 1) {
+            ThreadPool::getShared().parallelFor(
+                levelBegin, 2 * levelBegin, 1 << 14,
+                [&](uint32_t begin, uint32_t end) {
+                for (uint32_t nodeIdx = begin; nodeIdx < end; ++nodeIdx)
+                    sumTree[nodeIdx] = sumTree[2 * nodeIdx] + sumTree[2 * nodeIdx + 1];
+            });
+        }
+        return sumTree[1];
+    }
+
+    template <typename RealType>
+    RealType updateSumTree(RealType* sumTree, uint32_t numValues,
+                           const uint32_t* indices, const RealType* values, uint32_t numUpdates,
+                           uint32_t maxGap, std::vector<SumTreeNodeRange>* dirtyRanges) {
+        dirtyRanges->clear();
+        if (numUpdates == 0)
+            return sumTree[1];
+
+        uint32_t numLeaves = nextPowerOf2(numValues);
+        std::vector<uint32_t> levelNodes(numUpdates);
+        for (uint32_t i = 0; i < numUpdates; ++i) {
+            VLRAssert(indices[i] < numValues, "Index %u is out of range [0, %u).", indices[i], numValues);
+            levelNodes[i] = numLeaves + indices[i];
+            sumTree[levelNodes[i]] = values[i];
+        }
+        std::sort(levelNodes.begin(), levelNodes.end());
+        levelNodes.erase(std::unique(levelNodes.begin(), levelNodes.end()), levelNodes.end());
+
+        // JP: 更新されたノードの親を階層ごとに重複なく集めて再計算する。
+        //     各階層のノード番号は昇順に並ぶので、隣り合う兄弟は同じ親にまとまる。
+        // EN: Collect the parents of the updated nodes level by level without duplicates and recompute them.
+        //     Node indices at each level are sorted in ascending order, so adjacent siblings share the same parent.
+        std::vector<uint32_t> dirtyNodes = levelNodes;
+        while (levelNodes[0] > 1) {
+            uint32_t numParents = 0;
+            for (uint32_t i = 0; i < levelNodes.size(); ++i) {
+                uint32_t parentIdx = levelNodes[i] >> 1;
+                if (numParents == 0 || levelNodes[numParents - 1] != parentIdx)
+                    levelNodes[numParents++] = parentIdx;
+            }
+            levelNodes.resize(numParents);
+            for (uint32_t parentIdx : levelNodes)
+                sumTree[parentIdx] = sumTree[2 * parentIdx] + sumTree[2 * parentIdx + 1];
+            dirtyNodes.insert(dirtyNodes.end(), levelNodes.cbegin(), levelNodes.cend());
+        }
+
+        std::sort(dirtyNodes.begin(), dirtyNodes.end());
+        SumTreeNodeRange range = { dirtyNodes[0], dirtyNodes[0] + 1 };
+        for (uint32_t i = 1; i < dirtyNodes.size(); ++i) {
+            uint32_t nodeIdx = dirtyNodes[i];
+            if (nodeIdx > range.end + maxGap) {
+                dirtyRanges->push_back(range);
+                range.begin = nodeIdx;
+            }
+            range.end = nodeIdx + 1;
+        }
+        dirtyRanges->push_back(range);
+
+        return sumTree[1];
+    }
+
+    template float buildSumTree<float>(const float* values, uint32_t numValues, float* sumTree);
+    template float updateSumTree<float>(float* sumTree, uint32_t numValues,
+                                        const uint32_t* indices, const float* values, uint32_t numUpdates,
+                                        uint32_t maxGap, std::vector<SumTreeNodeRange>* dirtyRanges);
+
+
+
+    // JP: 方向コーン(軸と半角の余弦)の和集合を求める。
+    // EN: Compute the union of direction cones (axis and cosine of the half angle).
+    static void unifyDirectionCones(const Vector3D &axisA, float cosThetaA, const Vector3D &axisB, float cosThetaB,
+                                    Vector3D* axis, float* cosTheta) {
+        const float pi = static_cast<float>(VLR_M_PI);
+        float thetaA = std::acos(clamp(cosThetaA, -1.0f, 1.0f));
+        float thetaB = std::acos(clamp(cosThetaB, -1.0f, 1.0f));
+        float thetaD = std::acos(clamp(dot(axisA, axisB), -1.0f, 1.0f));
+        if (std::min(thetaD + thetaB, pi) <= thetaA) {
+            *axis = axisA;
+            *cosTheta = cosThetaA;
+            return;
+        }
+        if (std::min(thetaD + thetaA, pi) <= thetaB) {
+            *axis = axisB;
+            *cosTheta = cosThetaB;
+            return;
+        }
+
+        // JP: 両方を含むコーンの半角と、axisAからの回転角。
+        // EN: Half angle of the cone including both, and the rotation angle from axisA.
+        float thetaO = (thetaA + thetaD + thetaB) / 2;
+        Vector3D rotAxis = cross(axisA, axisB);
+        if (thetaO >= pi || rotAxis.sqLength() == 0.0f) {
+            *axis = axisA;
+            *cosTheta = -1.0f;
+            return;
+        }
+        float thetaR = thetaO - thetaA;
+        rotAxis = normalize(rotAxis);
+        *axis = normalize(axisA * std::cos(thetaR) + cross(rotAxis, axisA) * std::sin(thetaR));
+        *cosTheta = std::cos(thetaO);
+    }
+
+    // JP: 光源範囲の和集合。パワーがゼロの範囲は空として扱う。
+    // EN: Union of light bounds. Bounds with zero power are treated as empty.
+    static shared::LightBounds unifyLightBounds(const shared::LightBounds &a, const shared::LightBounds &b) {
+        if (a.power == 0.0f)
+            return b;
+        if (b.power == 0.0f)
+            return a;
+
+        shared::LightBounds ret;
+        ret.bounds = calcUnion(a.bounds, b.bounds);
+        unifyDirectionCones(a.axis, a.cosThetaO, b.axis, b.cosThetaO, &ret.axis, &ret.cosThetaO);
+        ret.cosThetaE = std::min(a.cosThetaE, b.cosThetaE);
+        ret.power = a.power + b.power;
+        ret.twoSided = a.twoSided || b.twoSided;
+        return ret;
+    }
+
+    // JP: SAOHのコスト。パワー、放射方向の立体角の尺度、表面積と細長さの補正の積。
+    // EN: SAOH cost. Product of the power, the measure of the solid angle of emission, the surface area and the elongation factor.
+    static float evaluateSAOHCost(const shared::LightBounds &b, const BoundingBox3D &nodeBounds, uint32_t axis) {
+        if (b.power == 0.0f)
+            return 0.0f;
+        const float pi = static_cast<float>(VLR_M_PI);
+        float thetaO = std::acos(clamp(b.cosThetaO, -1.0f, 1.0f));
+        float thetaE = std::acos(clamp(b.cosThetaE, -1.0f, 1.0f));
+        float thetaW = std::min(thetaO + thetaE, pi);
+        float sinThetaO = std::sqrt(std::max(1 - b.cosThetaO * b.cosThetaO, 0.0f));
+        float measureOmega = 2 * pi * (1 - b.cosThetaO) +
+            pi / 2 * (2 * thetaW * sinThetaO - std::cos(thetaO - 2 * thetaW) - 2 * thetaO * sinThetaO + b.cosThetaO);
+        Vector3D d = nodeBounds.maxP - nodeBounds.minP;
+        float kr = d[axis] > 0.0f ? std::max(std::max(d.x, d.y), d.z) / d[axis] : 1.0f;
+        return b.power * measureOmega * kr * b.bounds.surfaceArea();
+    }
+
+    struct LightBVHBuildItem {
+        shared::LightBounds bounds;
+        Point3D centroid;
+        uint32_t lightIndex;
+    };
+
+    // JP: 深さがこれを超えたら中央値で分割し、ビット列が64bitに収まる深さに抑える。
+    // EN: Split at the median beyond this depth to keep the depth within the 64-bit bit trail.
+    static constexpr uint32_t LightBVHMaxSAOHDepth = 31;
+
+    static uint32_t buildLightBVHNode(LightBVHBuildItem* items, uint32_t numItems, uint64_t bitTrail, uint32_t depth,
+                                      std::vector<shared::LightBVHNode>* nodes, std::vector<uint64_t>* bitTrails) {
+        uint32_t nodeIndex = static_cast<uint32_t>(nodes->size());
+        nodes->emplace_back();
+        if (numItems == 1) {
+            shared::LightBVHNode &leaf = (*nodes)[nodeIndex];
+            leaf.lightBounds = items[0].bounds;
+            leaf.childOrLightIndex = items[0].lightIndex;
+            leaf.isLeaf = true;
+            (*bitTrails)[items[0].lightIndex] = bitTrail;
+            return nodeIndex;
+        }
+
+        BoundingBox3D nodeBounds = items[0].bounds.bounds;
+        BoundingBox3D centroidBounds(items[0].centroid);
+        for (uint32_t i = 1; i < numItems; ++i) {
+            nodeBounds.unify(items[i].bounds.bounds);
+            centroidBounds.unify(items[i].centroid);
+        }
+
+        // JP: 各軸についてセントロイドをバケットに分け、コストが最小となる分割を探す。
+        // EN: Bin the centroids for each axis and find the split with the minimum cost.
+        constexpr uint32_t numBuckets = 12;
+        float minCost = INFINITY;
+        uint32_t minCostAxis = 0;
+        uint32_t minCostSplit = 0;
+        const auto getBucket = [&](const LightBVHBuildItem &item, uint32_t axis) {
+            float cMin = centroidBounds.minP[axis];
+            float cMax = centroidBounds.maxP[axis];
+            float t = (item.centroid[axis] - cMin) / (cMax - cMin);
+            return std::min(static_cast<uint32_t>(numBuckets * t), numBuckets - 1);
+        };
+        if (depth < LightBVHMaxSAOHDepth) {
+            for (uint32_t axis = 0; axis < 3; ++axis) {
+                if (centroidBounds.maxP[axis] == centroidBounds.minP[axis])
+                    continue;
+
+                shared::LightBounds buckets[numBuckets] = {};
+                uint32_t counts[numBuckets] = {};
+                for (uint32_t i = 0; i < numItems; ++i) {
+                    uint32_t b = getBucket(items[i], axis);
+                    buckets[b] = unifyLightBounds(buckets[b], items[i].bounds);
+                    ++counts[b];
+                }
+
+                for (uint32_t split = 0; split < numBuckets - 1; ++split) {
+                    shared::LightBounds below = {};
+                    shared::LightBounds above = {};
+                    uint32_t numBelow = 0;
+                    for (uint32_t b = 0; b <= split; ++b) {
+                        below = unifyLightBounds(below, buckets[b]);
+                        numBelow += counts[b];
+                    }
+                    for (uint32_t b = split + 1; b < numBuckets; ++b)
+                        above = unifyLightBounds(above, buckets[b]);
+                    if (numBelow == 0 || numBelow == numItems)
+                        continue;
+
+                    float cost = evaluateSAOHCost(below, nodeBounds, axis) + evaluateSAOHCost(above, nodeBounds, axis);
+                    if (cost < minCost) {
+                        minCost = cost;
+                        minCostAxis = axis;
+                        minCostSplit = split;
+                    }
+                }
+            }
+        }
+
+        uint32_t numFirstItems;
+        if (minCost < INFINITY) {
+            LightBVHBuildItem* mid = std::partition(
+                items, items + numItems,
+                [&](const LightBVHBuildItem &item) {
+                return getBucket(item, minCostAxis) <= minCostSplit;
+            });
+            numFirstItems = static_cast<uint32_t>(mid - items);
+        }
+        else {
+            Vector3D extent = centroidBounds.maxP - centroidBounds.minP;
+            uint32_t axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+            numFirstItems = numItems / 2;
+            std::nth_element(
+                items, items + numFirstItems, items + numItems,
+                [axis](const LightBVHBuildItem &a, const LightBVHBuildItem &b) {
+                return a.centroid[axis] < b.centroid[axis];
+            });
+        }
+
+        uint32_t firstChild = buildLightBVHNode(items, numFirstItems, bitTrail, depth + 1, nodes, bitTrails);
+        uint32_t secondChild = buildLightBVHNode(items + numFirstItems, numItems - numFirstItems,
+                                                 bitTrail | (1ull << depth), depth + 1, nodes, bitTrails);
+
+        shared::LightBVHNode &node = (*nodes)[nodeIndex];
+        node.lightBounds = unifyLightBounds((*nodes)[firstChild].lightBounds, (*nodes)[secondChild].lightBounds);
+        node.childOrLightIndex = secondChild;
+        node.isLeaf = false;
+        return nodeIndex;
+    }
+
+    void buildLightBVH(const shared::LightBounds* lights, uint32_t numLights,
+                       std::vector<shared::LightBVHNode>* nodes, std::vector<uint64_t>* bitTrails) {
+        std::vector<LightBVHBuildItem> items;
+        items.reserve(numLights);
+        for (uint32_t i = 0; i < numLights; ++i) {
+            const shared::LightBounds &light = lights[i];
+            if (light.power <= 0.0f || !light.bounds.isValid())
+                continue;
+            items.push_back(LightBVHBuildItem{ light, light.bounds.centroid(), i });
+        }
+
+        nodes->clear();
+        bitTrails->assign(numLights, shared::LightBVH::InvalidBitTrail);
+        if (!items.empty()) {
+            nodes->reserve(2 * items.size() - 1);
+            buildLightBVHNode(items.data(), static_cast<uint32_t>(items.size()), 0, 0, nodes, bitTrails);
+        }
+    }
+
+    shared::LightBounds createTriangleLightBounds(const Point3D &p0, const Point3D &p1, const Point3D &p2,
+                                                    float power, bool twoSided) {
+        shared::LightBounds ret;
+        ret.bounds = BoundingBox3D(p0);
+        ret.bounds.unify(p1).unify(p2);
+        Vector3D n = cross(p1 - p0, p2 - p0);
+        float length = n.length();
+        ret.axis = length > 0.0f ? n / length : Vector3D(0, 0, 1);
+        ret.cosThetaO = 1.0f;
+        // JP: 完全拡散放射面を仮定し、法線から90度まで放射する。
+        // EN: Assume a perfectly diffuse emitter which emits up to 90 degrees from the normal.
+        ret.cosThetaE = 0.0f;
+        ret.power = length > 0.0f ? power : 0.0f;
+        ret.twoSided = twoSided;
+        return ret;
+    }
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+
+namespace vlr {
+    // JP: 分布のサンプリング用データのホスト側での構築。
+    //     Contextやデバイスのバッファーに依らないので、CPU上で単体でテストできる。
+    // EN: Host-side construction of sampling data of distributions.
+    //     Independent of Context and device buffers so that they can be tested standalone on the CPU.
+
+    // JP: Walker/Voseのエイリアステーブルを並列に構築する。PMFは正規化済みであること。
+    //     軽い要素(n * p < 1)の不足分と重い要素(n * p >= 1)の超過分をそれぞれ累積して並べると、
+    //     逐次のスイープ法による割り当ては各要素の二分探索で独立に求まる。
+    //     軽い要素は自身の不足分の開始位置を含む重い要素をエイリアスとし、
+    //     重い要素は超過分を使い切った位置からはみ出た分を次の重い要素で埋める。
+    // EN: Build a Walker/Vose alias table in parallel. PMF needs to be normalized.
+    //     Lining up the cumulative deficits of light items (n * p < 1) and the cumulative excesses of heavy items (n * p >= 1),
+    //     the assignment of the sequential sweeping method is found independently per item by binary search.
+    //     A light item takes the heavy item containing the start of its deficit as the alias,
+    //     and a heavy item has its overshoot beyond its excess filled by the next heavy item.
+    template <typename RealType>
+    void buildAliasTable(const RealType* PMF, uint32_t numValues, shared::AliasTableEntry<RealType>* aliasTable);
+
+    // JP: 離散分布のPMFとCDF(numValues + 1要素)を並列プレフィックス和で計算し、値の総和を返す。
+    // EN: Compute PMF and CDF (numValues + 1 entries) of a discrete distribution by parallel prefix sum
+    //     and return the sum of the values.
+    template <typename RealType>
+    RealType computeDiscreteCDF(const RealType* values, uint32_t numValues, RealType* PMF, RealType* CDF);
+
+    // JP: 区分定数分布のPDFとCDF(numValues + 1要素)を並列プレフィックス和で計算し、積分値を返す。
+    // EN: Compute PDF and CDF (numValues + 1 entries) of a piecewise constant distribution by parallel prefix sum
+    //     and return the integral.
+    template <typename RealType>
+    RealType computeRegularConstantCDF(const RealType* values, uint32_t numValues, RealType* PDF, RealType* CDF);
+
+    // JP: レイアウトに応じたCDFの要素数。B+木の場合は内部ノードを含む。
+    // EN: Number of CDF entries for the layout. Includes the internal nodes in the case of the B+ tree.
+    uint32_t getCDFSize(uint32_t numValues, shared::DistributionLayout layout);
+
+    // JP: CDFの後ろにB+木の内部ノードを構築する。CDFにはgetCDFSize()が返す要素数の領域が必要。
+    // EN: Build internal nodes of the B+ tree after the CDF. The CDF needs the space of the size returned by getCDFSize().
+    template <typename RealType>
+    void buildCDFBTree(RealType* CDF, uint32_t numValues);
+
+    // JP: valuesを葉とする和の木(shared::computeSumTreeSize()要素)を構築し、総和を返す。
+    // EN: Build a sum tree (shared::computeSumTreeSize() entries) whose leaves are the values, and return the total sum.
+    template <typename RealType>
+    RealType buildSumTree(const RealType* values, uint32_t numValues, RealType* sumTree);
+
+    // JP: 和の木のノードの範囲[begin, end)。
+    // EN: Range [begin, end) of sum tree nodes.
+    struct SumTreeNodeRange {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // JP: indices[i]番目の葉をvalues[i]に置き換え、更新された葉から根までの経路だけを再計算して総和を返す。
+    //     同じインデックスが複数回現れた場合は最後の値が残る。
+    //     再計算したノードを昇順の範囲にまとめてdirtyRangesに返す。間隔がmaxGap以下の範囲はつなげる。
+    // EN: Replace the indices[i]-th leaf with values[i], recompute only the paths from the updated leaves to the root,
+    //     and return the total sum. When the same index appears more than once, the last value remains.
+    //     The recomputed nodes are returned in dirtyRanges as ranges in ascending order.
+    //     Ranges separated by gaps of at most maxGap are joined.
+    template <typename RealType>
+    RealType updateSumTree(RealType* sumTree, uint32_t numValues,
+                           const uint32_t* indices, const RealType* values, uint32_t numUpdates,
+                           uint32_t maxGap, std::vector<SumTreeNodeRange>* dirtyRanges);
+
+    // JP: SAOH(Surface Area Orientation Heuristic)に基づいて光源のBVHを構築する。
+    //     放射の無い光源はBVHに含めず、ビット列はshared::LightBVH::InvalidBitTrailになる。
+    // EN: Build a BVH of lights based on SAOH (Surface Area Orientation Heuristic).
+    //     Lights without emission are not included in the BVH, and their bit trails become shared::LightBVH::InvalidBitTrail.
+    void buildLightBVH(const shared::LightBounds* lights, uint32_t numLights,
+                       std::vector<shared::LightBVHNode>* nodes, std::vector<uint64_t>* bitTrails);
+
+    // JP: 三角形光源の範囲を作る。
+    // EN: Create bounds of a triangle light.
+    shared::LightBounds createTriangleLightBounds(const Point3D &p0, const Point3D &p1, const Point3D &p2,
+                                                  float power, bool twoSided);
+}
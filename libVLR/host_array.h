@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include "shared/common_internal.h"
+
+namespace vlr {
+    // JP: 頂点やインデックスのホスト側の配列。自身のstd::vectorか、呼び出し側から所有権を受け取ったバッファーを保持する。
+    //     受け取ったバッファーはコピーせずに参照し、不要になった時点(遅くとも破棄時)で解放関数を一度だけ呼ぶ。
+    // EN: Host-side array of vertices or indices. Holds either its own std::vector or a buffer whose ownership
+    //     has been transferred from the caller.
+    //     The transferred buffer is referenced without copying, and the release function is called exactly once
+    //     when no longer needed (at destruction at the latest).
+    template <typename T>
+    class HostArray {
+        std::vector<T> m_vector;
+        const T* m_externalData;
+        uint32_t m_numExternalElements;
+        void (*m_releaseFunc)(void* userData);
+        void* m_userData;
+
+    public:
+        HostArray() :
+            m_externalData(nullptr), m_numExternalElements(0), m_releaseFunc(nullptr), m_userData(nullptr) {}
+        HostArray(std::vector<T> &&v) :
+            m_vector(std::move(v)),
+            m_externalData(nullptr), m_numExternalElements(0), m_releaseFunc(nullptr), m_userData(nullptr) {}
+        HostArray(const T* data, uint32_t numElements, void (*releaseFunc)(void* userData), void* userData) :
+            m_externalData(data), m_numExternalElements(numElements), m_releaseFunc(releaseFunc), m_userData(userData) {}
+        HostArray(HostArray &&v) noexcept :
+            m_vector(std::move(v.m_vector)),
+            m_externalData(v.m_externalData), m_numExternalElements(v.m_numExternalElements),
+            m_releaseFunc(v.m_releaseFunc), m_userData(v.m_userData) {
+            v.m_vector.clear();
+            v.m_externalData = nullptr;
+            v.m_numExternalElements = 0;
+            v.m_releaseFunc = nullptr;
+            v.m_userData = nullptr;
+        }
+        HostArray &operator=(HostArray &&v) noexcept {
+            if (this != &v) {
+                release();
+                std::swap(m_vector, v.m_vector);
+                std::swap(m_externalData, v.m_externalData);
+                std::swap(m_numExternalElements, v.m_numExternalElements);
+                std::swap(m_releaseFunc, v.m_releaseFunc);
+                std::swap(m_userData, v.m_userData);
+            }
+            return *this;
+        }
+        HostArray(const HostArray &) = delete;
+        HostArray &operator=(const HostArray &) = delete;
+        ~HostArray() {
+            release();
+        }
+
+        void release() {
+            m_vector = std::vector<T>();
+            m_externalData = nullptr;
+            m_numExternalElements = 0;
+            if (m_releaseFunc)
+                m_releaseFunc(m_userData);
+            m_releaseFunc = nullptr;
+            m_userData = nullptr;
+        }
+
+        bool isExternal() const {
+            return m_externalData != nullptr;
+        }
+        const T* data() const {
+            return m_externalData ? m_externalData : m_vector.data();
+        }
+        uint32_t size() const {
+            return m_externalData ? m_numExternalElements : static_cast<uint32_t>(m_vector.size());
+        }
+        bool empty() const {
+            return size() == 0;
+        }
+        const T &operator[](uint32_t index) const {
+            return data()[index];
+        }
+    };
+}
@@ -1,30 +1,12 @@
 ﻿#include "image.h"
+#include "shader_nodes.h"
+#include "bc_codec.h"
+#include "image_resampler.h"
+#include "image_conversion.h"
+#include "lz_codec.h"
+#include "thread_pool.h"
 
 namespace vlr {
-    const size_t sizesOfDataFormats[static_cast<uint32_t>(DataFormat::NumFormats)] = {
-    sizeof(RGB8x3),
-    sizeof(RGB_8x4),
-    sizeof(RGBA8x4),
-    sizeof(RGBA16Fx4),
-    sizeof(RGBA32Fx4),
-    sizeof(RG32Fx2),
-    sizeof(Gray32F),
-    sizeof(Gray8),
-    sizeof(GrayA8x2),
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    0,
-    sizeof(uvsA8x4),
-    sizeof(uvsA16Fx4),
-    };
-
     // TODO: ちょっとわかりにくい。
     // ShaderNodePlugのoptionとコンポーネント位置を分離して指定できるようにするとわかりやすそう。
     uint32_t getComponentStartIndex(DataFormat dataFormat, BumpType bumpType, ShaderNodePlugType ptype, uint32_t index) {
@@ -248,91 +230,24 @@ namespace vlr {
     }
 
     DataFormat Image2D::getInternalFormat(DataFormat inputFormat, SpectrumType spectrumType) {
-        const auto asis = [](DataFormat inputFormat) {
-            switch (inputFormat) {
-            case DataFormat::RGB8x3:
-                return DataFormat::RGBA8x4;
-            case DataFormat::RGB_8x4:
-                return DataFormat::RGBA8x4;
-            case DataFormat::RGBA8x4:
-                return DataFormat::RGBA8x4;
-            case DataFormat::RGBA16Fx4:
-                return DataFormat::RGBA16Fx4;
-            case DataFormat::RGBA32Fx4:
-                return DataFormat::RGBA32Fx4;
-            case DataFormat::RG32Fx2:
-                return DataFormat::RG32Fx2;
-            case DataFormat::Gray32F:
-                return DataFormat::Gray32F;
-            case DataFormat::Gray8:
-                return DataFormat::Gray8;
-            case DataFormat::GrayA8x2:
-                return DataFormat::GrayA8x2;
-            case DataFormat::BC1:
-                return DataFormat::BC1;
-            case DataFormat::BC2:
-                return DataFormat::BC2;
-            case DataFormat::BC3:
-                return DataFormat::BC3;
-            case DataFormat::BC4:
-                return DataFormat::BC4;
-            case DataFormat::BC4_Signed:
-                return DataFormat::BC4_Signed;
-            case DataFormat::BC5:
-                return DataFormat::BC5;
-            case DataFormat::BC5_Signed:
-                return DataFormat::BC5_Signed;
-            case DataFormat::BC6H:
-                return DataFormat::BC6H;
-            case DataFormat::BC6H_Signed:
-                return DataFormat::BC6H_Signed;
-            case DataFormat::BC7:
-                return DataFormat::BC7;
-            case DataFormat::uvsA8x4:
-                return DataFormat::uvsA8x4;
-            case DataFormat::uvsA16Fx4:
-                return DataFormat::uvsA16Fx4;
-            default:
-                VLRAssert(false, "Data format is invalid.");
-                break;
-            }
-            return DataFormat(0);
-        };
-
-        if (spectrumType == SpectrumType::NA) {
-            return asis(inputFormat);
-        }
-        else {
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-            switch (inputFormat) {
-            case DataFormat::RGB8x3:
-                return DataFormat::uvsA8x4;
-            case DataFormat::RGB_8x4:
-                return DataFormat::uvsA8x4;
-            case DataFormat::RGBA8x4:
-                return DataFormat::uvsA8x4;
-            case DataFormat::RGBA16Fx4:
-                return DataFormat::uvsA16Fx4;
-            case DataFormat::RGBA32Fx4:
-                VLRAssert_NotImplemented();
-                return DataFormat::uvsA16Fx4;
-            default:
-                break;
-            }
-            return asis(inputFormat);
-#else
-            return asis(inputFormat);
-#endif
-        }
-        return DataFormat(0);
+        return getConvertedDataFormat(inputFormat, spectrumType);
     }
 
-    Image2D::Image2D(Context &context, uint32_t width, uint32_t height,
+    Image2D::Image2D(Context &context, uint32_t width, uint32_t height, uint32_t numMipmapLevels,
                      DataFormat originalDataFormat, SpectrumType spectrumType, ColorSpace colorSpace) :
+        Image2D(context, width, height, numMipmapLevels,
+                originalDataFormat, getInternalFormat(originalDataFormat, spectrumType), spectrumType, colorSpace) {
+    }
+
+    Image2D::Image2D(Context &context, uint32_t width, uint32_t height, uint32_t numMipmapLevels,
+                     DataFormat originalDataFormat, DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace) :
         Queryable(context), m_width(width), m_height(height),
-        m_originalDataFormat(originalDataFormat), m_spectrumType(spectrumType), m_colorSpace(colorSpace)
+        m_originalDataFormat(originalDataFormat), m_dataFormat(dataFormat), m_spectrumType(spectrumType), m_colorSpace(colorSpace),
+        m_numMipmapLevels(numMipmapLevels),
+        m_residencyPolicy(context.getDefaultImageResidencyPolicy()), m_hostDataReleased(false), m_spilledSize(0)
     {
-        m_dataFormat = getInternalFormat(m_originalDataFormat, spectrumType);
+        m_context.registerImage2D(this);
+
         m_needsHW_sRGB_degamma = false;
         if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma) {
             if (m_dataFormat == DataFormat::RGBA8x4 ||
@@ -351,8 +266,23 @@ namespace vlr {
     }
 
     Image2D::~Image2D() {
+        // JP: ノードが破棄済みの画像を参照し続けないよう、デバイス側のデータを解放する前に切り離す。
+        // EN: Detach the nodes before releasing the device-side data so that they don't keep referencing a destroyed image.
+        std::unordered_set<Image2DTextureShaderNode*> textureShaderNodes = std::move(m_textureShaderNodes);
+        for (Image2DTextureShaderNode* node : textureShaderNodes)
+            node->onImageDestroyed();
+        std::unordered_set<EnvironmentTextureShaderNode*> envTextureShaderNodes = std::move(m_environmentTextureShaderNodes);
+        for (EnvironmentTextureShaderNode* node : envTextureShaderNodes)
+            node->onImageDestroyed();
+
+        if (!m_spillFilePath.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(m_spillFilePath, ec);
+        }
         if (m_optixDataBuffer.isInitialized())
             m_optixDataBuffer.finalize();
+
+        m_context.unregisterImage2D(this);
     }
 
     const cudau::Array &Image2D::getOptiXObject() const {
@@ -363,7 +293,7 @@ namespace vlr {
         CUcontext cudaContext = optixContext.getCUcontext();
         cudau::ArraySurface useSurfaceLoadStore = cudau::ArraySurface::Disable;
         cudau::ArrayTextureGather useTextureGather = cudau::ArrayTextureGather::Enable;
-        uint32_t numMipmapLevels = 1;
+        uint32_t numMipmapLevels = m_numMipmapLevels;
 
 #define VLR_TEMP_EXPR0(format, elementType, numChs) \
     case format: \
@@ -414,268 +344,259 @@ namespace vlr {
 
 
 
-    template <bool enableDegamma>
-    struct sRGB_D65_ColorSpaceFunc {
-        static float degamma(float v) {
-            if constexpr (enableDegamma)
-                return sRGB_degamma(v);
-            else
-                return v;
-        }
-        static uint8_t degamma(uint8_t v) {
-            if constexpr (enableDegamma)
-                return static_cast<uint8_t>(std::min<uint32_t>(255, 256 * sRGB_degamma(v / 255.0f)));
-            else
-                return v;
-        }
+    void Image2D::setResidencyPolicy(ImageResidencyPolicy policy) {
+        if (policy == m_residencyPolicy)
+            return;
 
-        static void RGB_to_XYZ(const float RGB[3], float XYZ[3]) {
-            transformTristimulus(mat_Rec709_D65_to_XYZ, RGB, XYZ);
-        }
-    };
-
-    template <bool enableDegamma>
-    struct sRGB_E_ColorSpaceFunc {
-        static float degamma(float v) {
-            if constexpr (enableDegamma)
-                return sRGB_degamma(v);
-            else
-                return v;
-        }
-        static uint8_t degamma(uint8_t v) {
-            if constexpr (enableDegamma)
-                return static_cast<uint8_t>(std::min<uint32_t>(255, 256 * sRGB_degamma(v / 255.0f)));
-            else
-                return v;
+        // JP: アップロード済みの場合は新しいポリシーを即座に適用する。
+        // EN: Apply the new policy immediately when already uploaded.
+        restoreHostData();
+        if (!m_spillFilePath.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(m_spillFilePath, ec);
+            m_spillFilePath.clear();
+            m_spilledSize = 0;
         }
-
-        static void RGB_to_XYZ(const float RGB[3], float XYZ[3]) {
-            transformTristimulus(mat_Rec709_E_to_XYZ, RGB, XYZ);
+        m_residencyPolicy = policy;
+        if (m_optixDataBuffer.isInitialized())
+            releaseHostData();
+    }
+
+    size_t Image2D::getHostMemorySize() const {
+        std::vector<HostLevel> levels;
+        getHostLevels(&levels);
+        size_t size = 0;
+        for (const HostLevel &level : levels)
+            size += level.size;
+        return size;
+    }
+
+    size_t Image2D::getDeviceMemorySize() const {
+        if (!m_optixDataBuffer.isInitialized())
+            return 0;
+        if (m_hostDataReleased) {
+            size_t size = 0;
+            for (size_t levelSize : m_releasedLevelSizes)
+                size += levelSize;
+            return size;
+        }
+        return getHostMemorySize();
+    }
+
+    // JP: 全レベルを連結して圧縮し、一時ディレクトリ下のファイルに書き出す。
+    //     ホスト側データはアップロード後に変更されないので、既に書き出し済みならファイルを再利用する。
+    // EN: Concatenate all levels, compress them and write to a file under the temporary directory.
+    //     Host-side data doesn't change after upload, so reuse the file if it has already been written.
+    bool Image2D::spillHostData(const std::vector<HostLevel> &levels) const {
+        if (!m_spillFilePath.empty())
+            return true;
+
+        static std::atomic<uint32_t> s_spillFileSerial = 0;
+
+        std::error_code ec;
+        std::filesystem::path spillDir = std::filesystem::temp_directory_path(ec);
+        if (ec)
+            return false;
+        spillDir /= "VLR_image_spill";
+        std::filesystem::create_directories(spillDir, ec);
+        if (ec)
+            return false;
+
+        size_t totalSize = 0;
+        for (const HostLevel &level : levels)
+            totalSize += level.size;
+        std::vector<uint8_t> concatenated;
+        concatenated.reserve(totalSize);
+        for (const HostLevel &level : levels)
+            concatenated.insert(concatenated.end(), level.data, level.data + level.size);
+        std::vector<uint8_t> compressed;
+        compressLZ(concatenated.data(), concatenated.size(), &compressed);
+
+        std::filesystem::path filePath = spillDir / (
+            "image_" + std::to_string(m_context.getID()) + "_" + std::to_string(s_spillFileSerial++) + ".bin");
+        std::ofstream ofs(filePath, std::ios::binary);
+        if (!ofs.write(reinterpret_cast<const char*>(compressed.data()), compressed.size())) {
+            ofs.close();
+            std::filesystem::remove(filePath, ec);
+            return false;
+        }
+
+        m_spillFilePath = filePath;
+        m_spilledSize = compressed.size();
+        return true;
+    }
+
+    bool Image2D::restoreSpilledHostData(std::vector<std::vector<uint8_t>> &levels) const {
+        std::ifstream ifs(m_spillFilePath, std::ios::binary);
+        if (!ifs)
+            return false;
+        std::vector<uint8_t> compressed(m_spilledSize);
+        if (!ifs.read(reinterpret_cast<char*>(compressed.data()), compressed.size()))
+            return false;
+
+        size_t totalSize = 0;
+        for (size_t levelSize : m_releasedLevelSizes)
+            totalSize += levelSize;
+        std::vector<uint8_t> concatenated(totalSize);
+        if (!decompressLZ(compressed.data(), compressed.size(), concatenated.data(), totalSize))
+            return false;
+
+        size_t offset = 0;
+        for (uint32_t i = 0; i < levels.size(); ++i) {
+            levels[i].assign(concatenated.cbegin() + offset, concatenated.cbegin() + offset + m_releasedLevelSizes[i]);
+            offset += m_releasedLevelSizes[i];
+        }
+        return true;
+    }
+
+    void Image2D::releaseHostData() const {
+        if (m_residencyPolicy == ImageResidencyPolicy::Keep || m_hostDataReleased)
+            return;
+
+        std::vector<HostLevel> levels;
+        getHostLevels(&levels);
+        VLRAssert(levels.size() <= m_optixDataBuffer.getNumMipmapLevels(),
+                  "Every level must have its device copy before releasing the host-side data.");
+
+        if (m_residencyPolicy == ImageResidencyPolicy::SpillToDisk && !spillHostData(levels)) {
+            vlrprintf("Failed to spill image data to disk, keep it on the host.\n");
+            return;
+        }
+
+        m_releasedLevelSizes.resize(levels.size());
+        for (uint32_t i = 0; i < levels.size(); ++i)
+            m_releasedLevelSizes[i] = levels[i].size;
+        freeHostLevels();
+        m_hostDataReleased = true;
+    }
+
+    void Image2D::resetContents(uint32_t width, uint32_t height, uint32_t numMipmapLevels) {
+        VLRAssert(!isUsedAsEnvironmentTexture(), "An image referenced by environment texture nodes can't be replaced.");
+        freeHostLevels();
+        m_hostDataReleased = false;
+        m_releasedLevelSizes.clear();
+        if (!m_spillFilePath.empty()) {
+            std::error_code ec;
+            std::filesystem::remove(m_spillFilePath, ec);
+            m_spillFilePath.clear();
+            m_spilledSize = 0;
         }
-    };
-
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGB8x3 &srcData, RGBA8x4 &dstData) {
-        dstData.r = ColorSpaceFunc::degamma(srcData.r);
-        dstData.g = ColorSpaceFunc::degamma(srcData.g);
-        dstData.b = ColorSpaceFunc::degamma(srcData.b);
-        dstData.a = 255;
-    }
-
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGB_8x4 &srcData, RGBA8x4 &dstData) {
-        dstData.r = ColorSpaceFunc::degamma(srcData.r);
-        dstData.g = ColorSpaceFunc::degamma(srcData.g);
-        dstData.b = ColorSpaceFunc::degamma(srcData.b);
-        dstData.a = 255;
-    }
-
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGBA8x4 &srcData, RGBA8x4 &dstData) {
-        dstData.r = ColorSpaceFunc::degamma(srcData.r);
-        dstData.g = ColorSpaceFunc::degamma(srcData.g);
-        dstData.b = ColorSpaceFunc::degamma(srcData.b);
-        dstData.a = srcData.a;
-    }
-
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGBA16Fx4 &srcData, RGBA16Fx4 &dstData) {
-        dstData.r = static_cast<half>(ColorSpaceFunc::degamma(static_cast<float>(srcData.r)));
-        dstData.g = static_cast<half>(ColorSpaceFunc::degamma(static_cast<float>(srcData.g)));
-        dstData.b = static_cast<half>(ColorSpaceFunc::degamma(static_cast<float>(srcData.b)));
-        dstData.a = srcData.a;
-    }
-
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGBA32Fx4 &srcData, RGBA32Fx4 &dstData) {
-        dstData.r = ColorSpaceFunc::degamma(srcData.r);
-        dstData.g = ColorSpaceFunc::degamma(srcData.g);
-        dstData.b = ColorSpaceFunc::degamma(srcData.b);
-        dstData.a = srcData.a;
-    }
-
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RG32Fx2 &srcData, RG32Fx2 &dstData) {
-        dstData.r = ColorSpaceFunc::degamma(srcData.r);
-        dstData.g = ColorSpaceFunc::degamma(srcData.g);
-    }
-
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const Gray32F &srcData, Gray32F &dstData) {
-        dstData.v = ColorSpaceFunc::degamma(srcData.v);
-    }
+        if (m_optixDataBuffer.isInitialized())
+            m_optixDataBuffer.finalize();
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const Gray8 &srcData, Gray8 &dstData) {
-        dstData.v = ColorSpaceFunc::degamma(srcData.v);
+        m_width = width;
+        m_height = height;
+        m_numMipmapLevels = numMipmapLevels;
     }
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const GrayA8x2 &srcData, GrayA8x2 &dstData) {
-        dstData.v = ColorSpaceFunc::degamma(srcData.v);
-        dstData.a = srcData.a;
+    void Image2D::notifyContentsChanged() const {
+        for (Image2DTextureShaderNode* node : m_textureShaderNodes)
+            node->onImageContentsChanged();
     }
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(float RGB[3], uvsA8x4 &dstData) {
-        RGB[0] = ColorSpaceFunc::degamma(RGB[0]);
-        RGB[1] = ColorSpaceFunc::degamma(RGB[1]);
-        RGB[2] = ColorSpaceFunc::degamma(RGB[2]);
-
-        float XYZ[3];
-        ColorSpaceFunc::RGB_to_XYZ(RGB, XYZ);
+    bool Image2D::restoreHostData() const {
+        if (!m_hostDataReleased)
+            return false;
 
-        float b = XYZ[0] + XYZ[1] + XYZ[2];
-        float xy[2];
-        xy[0] = b > 0.0f ? XYZ[0] / b : (1.0f / 3.0f);
-        xy[1] = b > 0.0f ? XYZ[1] / b : (1.0f / 3.0f);
+        std::vector<std::vector<uint8_t>> levels(m_releasedLevelSizes.size());
 
-        float uv[2];
-        UpsampledSpectrum::xy_to_uv(xy, uv);
+        // JP: ディスクから復元できない場合(DropAfterUploadやファイルの破損を含む)はデバイス上のコピーを読み戻す。
+        // EN: Read back the device copy when the data can't be restored from disk
+        //     (including DropAfterUpload and a corrupted file).
+        if (m_spillFilePath.empty() || !restoreSpilledHostData(levels)) {
+            if (!m_spillFilePath.empty())
+                vlrprintf("Spilled image data failed the integrity check, read back the device copy instead.\n");
+            for (uint32_t i = 0; i < levels.size(); ++i) {
+                std::vector<uint8_t> &level = levels[i];
+                level.resize(m_releasedLevelSizes[i]);
+                auto srcData = m_optixDataBuffer.map<uint8_t>(i, 0, cudau::BufferMapFlag::ReadOnly);
+                std::copy_n(srcData, level.size(), level.data());
+                m_optixDataBuffer.unmap(i);
+            }
+        }
+        adoptHostLevels(std::move(levels));
 
-        dstData.u = static_cast<uint8_t>(255 * clamp<float>(uv[0] / UpsampledSpectrum::GridWidth(), 0, 1));
-        dstData.v = static_cast<uint8_t>(255 * clamp<float>(uv[1] / UpsampledSpectrum::GridHeight(), 0, 1));
-        dstData.s = static_cast<uint8_t>(255 * clamp<float>(b / 3.0f, 0, 1));
+        m_releasedLevelSizes.clear();
+        m_hostDataReleased = false;
+        return true;
     }
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(float RGB[3], uvsA16Fx4 &dstData) {
-        RGB[0] = ColorSpaceFunc::degamma(RGB[0]);
-        RGB[1] = ColorSpaceFunc::degamma(RGB[1]);
-        RGB[2] = ColorSpaceFunc::degamma(RGB[2]);
-
-        float XYZ[3];
-        ColorSpaceFunc::RGB_to_XYZ(RGB, XYZ);
-
-        float b = XYZ[0] + XYZ[1] + XYZ[2];
-        float xy[2];
-        xy[0] = b > 0.0f ? XYZ[0] / b : (1.0f / 3.0f);
-        xy[1] = b > 0.0f ? XYZ[1] / b : (1.0f / 3.0f);
-
-        float uv[2];
-        UpsampledSpectrum::xy_to_uv(xy, uv);
-
-        dstData.u = static_cast<half>(uv[0]);
-        dstData.v = static_cast<half>(uv[1]);
-        // JP: よくあるテクスチャーの値だとInfになってしまうため
-        //     本来は割るべきところを割らないままにしておく。
-        // EN: 
-        dstData.s = static_cast<half>(b/* / UpsampledSpectrum::EqualEnergyReflectance()*/);
-    }
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGB8x3 &srcData, uvsA8x4 &dstData) {
-        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
-        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
-        dstData.a = 255;
-    }
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGB8x3 &srcData, uvsA16Fx4 &dstData) {
-        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
-        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
-        dstData.a = static_cast<half>(1.0f);
-    }
+    
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGB_8x4 &srcData, uvsA8x4 &dstData) {
-        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
-        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
-        dstData.a = 255;
-    }
+    std::vector<ParameterInfo> LinearImage2D::ParameterInfos;
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGB_8x4 &srcData, uvsA16Fx4 &dstData) {
-        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
-        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
-        dstData.a = static_cast<half>(1.0f);
+    // static
+    void LinearImage2D::initialize(Context &context) {
     }
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGBA8x4 &srcData, uvsA8x4 &dstData) {
-        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
-        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
-        dstData.a = srcData.a;
+    // static
+    void LinearImage2D::finalize(Context &context) {
     }
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGBA8x4 &srcData, uvsA16Fx4 &dstData) {
-        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
-        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
-        dstData.a = static_cast<half>(srcData.a / 255.0f);
-    }
+    LinearImage2D::LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height,
+                                 DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                                 bool generateMipmaps) :
+        Image2D(context, width, height,
+                generateMipmaps ? getNumMipmapLevelsForFullChain(width, height) : 1,
+                dataFormat, spectrumType, colorSpace), m_copyDone(false) {
+        VLRAssert(dataFormat < DataFormat::BC1 || dataFormat > DataFormat::BC7, "Specified data format is a block compressed format.");
+        initializeData(linearData, dataFormat);
 
-    template <typename ColorSpaceFunc>
-    void perPixelFunc(const RGBA16Fx4 &srcData, uvsA16Fx4 &dstData) {
-        float RGB[] = { srcData.r, srcData.g, srcData.b };
-        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
-        dstData.a = srcData.a;
+        if (generateMipmaps)
+            this->generateMipmaps();
     }
 
-    template <typename SrcType, typename DstType, typename ColorSpaceFunc>
-    void processAllPixels(const uint8_t* srcData, uint8_t* dstData, uint32_t width, uint32_t height) {
-        if /* constexpr */ (std::is_same<SrcType, DstType>::value &&
-            (std::is_same<ColorSpaceFunc, sRGB_D65_ColorSpaceFunc<false>>::value ||
-             std::is_same<ColorSpaceFunc, sRGB_E_ColorSpaceFunc<false>>::value)) {
-            auto srcHead = reinterpret_cast<const SrcType*>(srcData);
-            auto dstHead = reinterpret_cast<SrcType*>(dstData);
-            std::copy_n(srcHead, width * height, dstHead);
+    LinearImage2D::LinearImage2D(Context &context, ExternalImageData &&linearData, uint32_t width, uint32_t height,
+                                 DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                                 bool generateMipmaps) :
+        Image2D(context, width, height,
+                generateMipmaps ? getNumMipmapLevelsForFullChain(width, height) : 1,
+                dataFormat, spectrumType, colorSpace), m_copyDone(false) {
+        VLRAssert(dataFormat < DataFormat::BC1 || dataFormat > DataFormat::BC7, "Specified data format is a block compressed format.");
+        VLRAssert(linearData.getNumLevels() == 1, "Linear image data must have exactly one level.");
+
+        // JP: 内部形式が同じで(ハードウェアデガンマに任せられないsRGBの)デガンマも不要な場合、
+        //     変換は単なるコピーになるので受け取ったデータをそのまま保持する。
+        // EN: When the internal format is the same and no degamma is needed (sRGB that can't rely on hardware degamma),
+        //     the conversion is a mere copy, so keep the received data as is.
+        bool passThrough = getDataFormat() == dataFormat &&
+            (colorSpace != ColorSpace::Rec709_D65_sRGBGamma || needsHW_sRGB_degamma());
+        if (passThrough) {
+            VLRAssert(linearData.getLevelSize(0) >= getLevelSize(0), "Linear image data is too small.");
+            m_externalData = std::move(linearData);
         }
         else {
-            auto srcHead = reinterpret_cast<const SrcType*>(srcData);
-            auto dstHead = reinterpret_cast<DstType*>(dstData);
-            for (int y = 0; y < static_cast<int>(height); ++y) {
-                auto srcLineHead = srcHead + width * y;
-                auto dstLineHead = dstHead + width * y;
-                for (int x = 0; x < static_cast<int>(width); ++x) {
-                    auto &src = *(srcLineHead + x);
-                    auto &dst = *(dstLineHead + x);
-                    perPixelFunc<ColorSpaceFunc>(src, dst);
-                }
-            }
+            initializeData(linearData.getLevel(0), dataFormat);
+            linearData.release();
         }
-    }
 
-    
-
-    std::vector<ParameterInfo> LinearImage2D::ParameterInfos;
-
-    // static
-    void LinearImage2D::initialize(Context &context) {
-    }
-
-    // static
-    void LinearImage2D::finalize(Context &context) {
+        if (generateMipmaps)
+            this->generateMipmaps();
     }
 
-    template <typename SrcType, typename DstType, typename DstTypeForNA>
-    static inline void processAllPixels(const uint8_t* srcData, uint8_t* dstData,
-                                        SpectrumType spectrumType, ColorSpace colorSpace, uint32_t width, uint32_t height) {
-        if (spectrumType != SpectrumType::NA) {
-            if (spectrumType == SpectrumType::Reflectance ||
-                spectrumType == SpectrumType::IndexOfRefraction) {
-                if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
-                    processAllPixels<SrcType, DstType, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
-                else
-                    processAllPixels<SrcType, DstType, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
-            }
-            else {
-                if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
-                    processAllPixels<SrcType, DstType, sRGB_D65_ColorSpaceFunc<true>>(srcData, dstData, width, height);
-                else
-                    processAllPixels<SrcType, DstType, sRGB_D65_ColorSpaceFunc<false>>(srcData, dstData, width, height);
-            }
-        }
-        else {
-            processAllPixels<SrcType, DstTypeForNA, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+    LinearImage2D::LinearImage2D(Context &context, ExternalImageData &&convertedData, uint32_t width, uint32_t height,
+                                 DataFormat originalDataFormat, DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace) :
+        Image2D(context, width, height, convertedData.getNumLevels(),
+                originalDataFormat, dataFormat, spectrumType, colorSpace), m_copyDone(false) {
+        VLRAssert(dataFormat == getInternalFormat(originalDataFormat, spectrumType),
+                  "Data format %s is not the internal format of %s.",
+                  getEnumMemberFromValue(dataFormat), getEnumMemberFromValue(originalDataFormat));
+        for (uint32_t mipLevel = 0; mipLevel < convertedData.getNumLevels(); ++mipLevel) {
+            VLRAssert(convertedData.getLevelSize(mipLevel) >= getLevelSize(mipLevel),
+                      "Data of mip level %u is too small.", mipLevel);
         }
+        m_externalData = std::move(convertedData);
     }
 
-    LinearImage2D::LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height,
-                                 DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace) :
-        Image2D(context, width, height, dataFormat, spectrumType, colorSpace), m_copyDone(false) {
-        VLRAssert(dataFormat < DataFormat::BC1 || dataFormat > DataFormat::BC7, "Specified data format is a block compressed format.");
-        m_data.resize(getStride() * getWidth() * getHeight());
+    void LinearImage2D::initializeData(const uint8_t* linearData, DataFormat dataFormat) {
+        uint32_t width = getWidth();
+        uint32_t height = getHeight();
+        SpectrumType spectrumType = getSpectrumType();
+        ColorSpace colorSpace = getColorSpace();
+        m_data.resize(getLevelSize(0));
+
 
         //{
         //    /*
@@ -707,339 +628,126 @@ namespace vlr {
         //    printf("");
         //}
 
-        switch (dataFormat) {
-        case DataFormat::RGB8x3: {
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-            processAllPixels<RGB8x3, uvsA8x4, RGBA8x4>(linearData, m_data.data(), spectrumType, colorSpace, width, height);
-#else
-            processAllPixels<RGB8x3, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-#endif
-            break;
-        }
-        case DataFormat::RGB_8x4: {
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-            processAllPixels<RGB_8x4, uvsA8x4, RGBA8x4>(linearData, m_data.data(), spectrumType, colorSpace, width, height);
-#else
-            processAllPixels<RGB_8x4, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-#endif
-            break;
-        }
-        case DataFormat::RGBA8x4: {
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-            processAllPixels<RGBA8x4, uvsA8x4, RGBA8x4>(linearData, m_data.data(), spectrumType, colorSpace, width, height);
-#else
-            processAllPixels<RGBA8x4, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-#endif
-            break;
-        }
-        case DataFormat::RGBA16Fx4: {
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-            processAllPixels<RGBA16Fx4, uvsA16Fx4, RGBA16Fx4>(linearData, m_data.data(), spectrumType, colorSpace, width, height);
-#else
-            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
-                processAllPixels<RGBA16Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<true>>(linearData, m_data.data(), width, height);
-            else
-                processAllPixels<RGBA16Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-#endif
-            break;
-        }
-        case DataFormat::RGBA32Fx4: {
-#if defined(VLR_USE_SPECTRAL_RENDERING)
-            VLRAssert_NotImplemented();
-#else
-            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
-                processAllPixels<RGBA32Fx4, RGBA32Fx4, sRGB_E_ColorSpaceFunc<true>>(linearData, m_data.data(), width, height);
-            else
-                processAllPixels<RGBA32Fx4, RGBA32Fx4, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-#endif
-            break;
-        }
-        case DataFormat::RG32Fx2: {
-            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
-                processAllPixels<RG32Fx2, RG32Fx2, sRGB_E_ColorSpaceFunc<true>>(linearData, m_data.data(), width, height);
-            else
-                processAllPixels<RG32Fx2, RG32Fx2, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-            break;
-        }
-        case DataFormat::Gray32F: {
-            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
-                processAllPixels<Gray32F, Gray32F, sRGB_E_ColorSpaceFunc<true>>(linearData, m_data.data(), width, height);
-            else
-                processAllPixels<Gray32F, Gray32F, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-            break;
-        }
-        case DataFormat::Gray8: {
-            processAllPixels<Gray8, Gray8, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-            break;
-        }
-        case DataFormat::GrayA8x2: {
-            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
-                processAllPixels<GrayA8x2, GrayA8x2, sRGB_E_ColorSpaceFunc<true>>(linearData, m_data.data(), width, height);
-            else
-                processAllPixels<GrayA8x2, GrayA8x2, sRGB_E_ColorSpaceFunc<false>>(linearData, m_data.data(), width, height);
-            break;
-        }
-        case DataFormat::uvsA8x4:
-        case DataFormat::uvsA16Fx4:
-            std::copy(linearData, linearData + getStride() * width * height, reinterpret_cast<uint8_t*>(m_data.data()));
-            break;
-        default:
-            VLRAssert(false, "Data format is invalid.");
-            break;
+        convertLinearImageData(linearData, width, height, dataFormat, spectrumType, colorSpace, m_data.data());
+    }
+
+    // JP: 各レベルを1つ上のレベルからボックスフィルターで生成する。
+    //     リサンプラーがsRGBエンコードされたデータはリニア空間で、uvs形式はXYZでフィルタリングする。
+    // EN: Generate each level from the level above with the box filter.
+    //     The resampler filters sRGB-encoded data in linear space and the uvs formats in XYZ.
+    void LinearImage2D::generateMipmaps() {
+        uint32_t numMipmapLevels = getNumMipmapLevels();
+        m_mipData.resize(numMipmapLevels - 1);
+        const uint8_t* srcData = getLevelData(0);
+        uint32_t srcWidth = getWidth();
+        uint32_t srcHeight = getHeight();
+        for (uint32_t mipLevel = 1; mipLevel < numMipmapLevels; ++mipLevel) {
+            uint32_t dstWidth = std::max<uint32_t>(srcWidth >> 1, 1);
+            uint32_t dstHeight = std::max<uint32_t>(srcHeight >> 1, 1);
+            std::vector<uint8_t> &dstData = m_mipData[mipLevel - 1];
+            dstData.resize(static_cast<size_t>(getStride()) * dstWidth * dstHeight);
+            resampleLinearImageData(srcData, srcWidth, srcHeight, dstData.data(), dstWidth, dstHeight,
+                                    getDataFormat(), needsHW_sRGB_degamma(), ResamplingFilter::Box);
+
+            srcData = dstData.data();
+            srcWidth = dstWidth;
+            srcHeight = dstHeight;
         }
     }
 
-    Image2D* LinearImage2D::createShrinkedImage2D(uint32_t width, uint32_t height) const {
-        uint32_t orgWidth = getWidth();
-        uint32_t orgHeight = getHeight();
-        uint32_t stride = getStride();
-        VLRAssert(width <= orgWidth && height <= orgHeight, "Image size must be smaller than the original.");
+    void LinearImage2D::getHostLevels(std::vector<HostLevel>* levels) const {
+        levels->clear();
+        if (isHostDataReleased())
+            return;
+        for (uint32_t mipLevel = 0; mipLevel < getNumMipmapLevels(); ++mipLevel)
+            levels->push_back(HostLevel{ getLevelData(mipLevel), getLevelSize(mipLevel) });
+    }
+
+    void LinearImage2D::freeHostLevels() const {
+        std::vector<uint8_t>().swap(m_data);
+        std::vector<std::vector<uint8_t>>().swap(m_mipData);
+        m_externalData.release();
+    }
+
+    void LinearImage2D::adoptHostLevels(std::vector<std::vector<uint8_t>> &&levels) const {
+        VLRAssert(!levels.empty(), "At least one level is required.");
+        m_data = std::move(levels[0]);
+        m_mipData.resize(levels.size() - 1);
+        for (uint32_t i = 1; i < levels.size(); ++i)
+            m_mipData[i - 1] = std::move(levels[i]);
+    }
+
+    Image2D* LinearImage2D::createShrinkedImage2D(uint32_t width, uint32_t height, ResamplingFilter filter) const {
+        VLRAssert(width <= getWidth() && height <= getHeight(), "Image size must be smaller than the original.");
+        ScopedHostData hostData(*this);
         std::vector<uint8_t> data;
-        data.resize(stride * width * height);
-
-        float deltaOrgX = static_cast<float>(orgWidth) / width;
-        float deltaOrgY = static_cast<float>(orgHeight) / height;
-        for (int y = 0; y < static_cast<int>(height); ++y) {
-            float top = deltaOrgY * y;
-            float bottom = deltaOrgY * (y + 1);
-            uint32_t topPix = static_cast<uint32_t>(top);
-            uint32_t bottomPix = static_cast<uint32_t>(ceilf(bottom)) - 1;
-
-            for (int x = 0; x < static_cast<int>(width); ++x) {
-                float left = deltaOrgX * x;
-                float right = deltaOrgX * (x + 1);
-                uint32_t leftPix = static_cast<uint32_t>(left);
-                uint32_t rightPix = static_cast<uint32_t>(ceilf(right)) - 1;
-
-                CompensatedSum<float> sumWeight(0);
-                //float area = (bottom - top) * (right - left);
-
-                // UL, UR, LL, LR
-                float weightsCorners[] = {
-                    (leftPix + 1 - left) * (topPix + 1 - top),
-                    (right - rightPix) * (topPix + 1 - top),
-                    (leftPix + 1 - left) * (bottom - bottomPix),
-                    (right - rightPix) * (bottom - bottomPix)
-                };
-                // Top, Left, Right, Bottom
-                float weightsEdges[] = {
-                    topPix + 1 - top,
-                    leftPix + 1 - left,
-                    right - rightPix,
-                    bottom - bottomPix
-                };
-
-                switch (getDataFormat()) {
-                case DataFormat::RGBA16Fx4: {
-                    CompensatedSum<float> sumR(0), sumG(0), sumB(0), sumA(0);
-                    RGBA16Fx4 pix;
-
-                    uint32_t corners[] = { leftPix, topPix, rightPix, topPix, leftPix, bottomPix, rightPix, bottomPix };
-                    for (int i = 0; i < 4; ++i) {
-                        pix = get<RGBA16Fx4>(corners[2 * i + 0], corners[2 * i + 1]);
-                        float weight = weightsCorners[i];
-                        sumR += weight * float(pix.r);
-                        sumG += weight * float(pix.g);
-                        sumB += weight * float(pix.b);
-                        sumA += weight * float(pix.a);
-                        sumWeight += weight;
-                    }
-
-                    for (uint32_t x = leftPix + 1; x < rightPix; ++x) {
-                        pix = get<RGBA16Fx4>(x, topPix);
-                        float weightT = weightsEdges[0];
-                        sumR += weightT * float(pix.r);
-                        sumG += weightT * float(pix.g);
-                        sumB += weightT * float(pix.b);
-                        sumA += weightT * float(pix.a);
-
-                        pix = get<RGBA16Fx4>(x, bottomPix);
-                        float weightB = weightsEdges[3];
-                        sumR += weightB * float(pix.r);
-                        sumG += weightB * float(pix.g);
-                        sumB += weightB * float(pix.b);
-                        sumA += weightB * float(pix.a);
-                    }
-                    if (rightPix > (leftPix + 1))
-                        sumWeight += static_cast<float>(2 * (rightPix - leftPix - 1));
-                    for (uint32_t y = topPix + 1; y < bottomPix; ++y) {
-                        pix = get<RGBA16Fx4>(leftPix, y);
-                        float weightL = weightsEdges[1];
-                        sumR += weightL * float(pix.r);
-                        sumG += weightL * float(pix.g);
-                        sumB += weightL * float(pix.b);
-                        sumA += weightL * float(pix.a);
-
-                        pix = get<RGBA16Fx4>(rightPix, y);
-                        float weightR = weightsEdges[2];
-                        sumR += weightR * float(pix.r);
-                        sumG += weightR * float(pix.g);
-                        sumB += weightR * float(pix.b);
-                        sumA += weightR * float(pix.a);
-                    }
-                    if (bottomPix > (topPix + 1))
-                        sumWeight += static_cast<float>(2 * (bottomPix - topPix - 1));
-
-                    for (uint32_t y = topPix + 1; y < bottomPix; ++y) {
-                        for (uint32_t x = leftPix + 1; x < rightPix; ++x) {
-                            pix = get<RGBA16Fx4>(x, y);
-                            sumR += float(pix.r);
-                            sumG += float(pix.g);
-                            sumB += float(pix.b);
-                            sumA += float(pix.a);
-                        }
-                    }
-                    if (bottomPix > topPix && rightPix > leftPix)
-                        sumWeight += static_cast<float>((bottomPix - topPix - 1) * (rightPix - leftPix - 1));
-
-                    *(RGBA16Fx4*)&data[(y * width + x) * stride] = RGBA16Fx4{ half(sumR / sumWeight), half(sumG / sumWeight), half(sumB / sumWeight), half(sumA / sumWeight) };
-                    break;
-                }
-                case DataFormat::uvsA16Fx4: {
-                    CompensatedSum<float> sum_u(0), sum_v(0), sum_s(0), sumA(0);
-                    uvsA16Fx4 pix;
-
-                    uint32_t corners[] = { leftPix, topPix, rightPix, topPix, leftPix, bottomPix, rightPix, bottomPix };
-                    for (int i = 0; i < 4; ++i) {
-                        pix = get<uvsA16Fx4>(corners[2 * i + 0], corners[2 * i + 1]);
-                        float weight = weightsCorners[i];
-                        sum_u += weightsCorners[i] * float(pix.u);
-                        sum_v += weightsCorners[i] * float(pix.v);
-                        sum_s += weightsCorners[i] * float(pix.s);
-                        sumA += weightsCorners[i] * float(pix.a);
-                        sumWeight += weight;
-                    }
-
-                    for (uint32_t x = leftPix + 1; x < rightPix; ++x) {
-                        pix = get<uvsA16Fx4>(x, topPix);
-                        float weightT = weightsEdges[0];
-                        sum_u += weightT * float(pix.u);
-                        sum_v += weightT * float(pix.v);
-                        sum_s += weightT * float(pix.s);
-                        sumA += weightT * float(pix.a);
-
-                        pix = get<uvsA16Fx4>(x, bottomPix);
-                        float weightB = weightsEdges[3];
-                        sum_u += weightB * float(pix.u);
-                        sum_v += weightB * float(pix.v);
-                        sum_s += weightB * float(pix.s);
-                        sumA += weightB * float(pix.a);
-                    }
-                    if (rightPix > (leftPix + 1))
-                        sumWeight += static_cast<float>(2 * (rightPix - leftPix - 1));
-                    for (uint32_t y = topPix + 1; y < bottomPix; ++y) {
-                        pix = get<uvsA16Fx4>(leftPix, y);
-                        float weightL = weightsEdges[1];
-                        sum_u += weightL * float(pix.u);
-                        sum_v += weightL * float(pix.v);
-                        sum_s += weightL * float(pix.s);
-                        sumA += weightL * float(pix.a);
-
-                        pix = get<uvsA16Fx4>(rightPix, y);
-                        float weightR = weightsEdges[2];
-                        sum_u += weightR * float(pix.u);
-                        sum_v += weightR * float(pix.v);
-                        sum_s += weightR * float(pix.s);
-                        sumA += weightR * float(pix.a);
-                    }
-                    if (bottomPix > (topPix + 1))
-                        sumWeight += static_cast<float>(2 * (bottomPix - topPix - 1));
-
-                    for (uint32_t y = topPix + 1; y < bottomPix; ++y) {
-                        for (uint32_t x = leftPix + 1; x < rightPix; ++x) {
-                            pix = get<uvsA16Fx4>(x, y);
-                            sum_u += float(pix.u);
-                            sum_v += float(pix.v);
-                            sum_s += float(pix.s);
-                            sumA += float(pix.a);
-                        }
-                    }
-                    if (bottomPix > topPix && rightPix > leftPix)
-                        sumWeight += static_cast<float>((bottomPix - topPix - 1) * (rightPix - leftPix - 1));
-
-                    *reinterpret_cast<uvsA16Fx4*>(&data[(y * width + x) * stride]) = uvsA16Fx4{
-                        half(sum_u / sumWeight),
-                        half(sum_v / sumWeight),
-                        half(sum_s / sumWeight),
-                        half(sumA / sumWeight) };
-                    break;
-                }
-                default:
-                    VLRAssert_ShouldNotBeCalled();
-                    break;
-                }
-            }
-        }
+        data.resize(static_cast<size_t>(getStride()) * width * height);
+
+        resampleLinearImageData(getLevelData(0), getWidth(), getHeight(), data.data(), width, height,
+                                getDataFormat(), needsHW_sRGB_degamma(), filter);
+
+        // JP: 内部データが既にデガンマ済みの場合は再度デガンマされないように色空間からガンマを外す。
+        // EN: Remove the gamma from the color space when the internal data has already been degamma'd
+        //     so that it isn't degamma'd again.
+        ColorSpace colorSpace = getColorSpace();
+        if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma && !needsHW_sRGB_degamma())
+            colorSpace = ColorSpace::Rec709_D65;
 
         return new LinearImage2D(
-            m_context, data.data(), width, height, getDataFormat(), getSpectrumType(), getColorSpace());
+            m_context, data.data(), width, height, getDataFormat(), getSpectrumType(), colorSpace);
     }
 
     Image2D* LinearImage2D::createLuminanceImage2D() const {
+        ScopedHostData hostData(*this);
         uint32_t width = getWidth();
         uint32_t height = getHeight();
-        uint32_t stride;
-        DataFormat newDataFormat;
-        switch (getDataFormat()) {
-        case DataFormat::RGBA16Fx4: {
-            stride = sizeof(float);
-            newDataFormat = DataFormat::Gray32F;
-            break;
-        }
-        case DataFormat::uvsA16Fx4: {
-            stride = sizeof(float);
-            newDataFormat = DataFormat::Gray32F;
-            break;
-        }
-        default:
-            VLRAssert_ShouldNotBeCalled();
-            break;
-        }
         std::vector<uint8_t> data;
-        data.resize(stride * width * height);
-
-        for (int y = 0; y < static_cast<int>(height); ++y) {
-            for (int x = 0; x < static_cast<int>(width); ++x) {
-                switch (getDataFormat()) {
-                case DataFormat::RGBA16Fx4: {
-                    RGBA16Fx4 pix = get<RGBA16Fx4>(x, y);
-                    float Y = mat_Rec709_D65_to_XYZ[1] * pix.r + mat_Rec709_D65_to_XYZ[4] * pix.g + mat_Rec709_D65_to_XYZ[7] * pix.b;
-                    *reinterpret_cast<float*>(&data[(y * width + x) * stride]) = Y;
-                    break;
-                }
-                case DataFormat::uvsA16Fx4: {
-                    uvsA16Fx4 pix = get<uvsA16Fx4>(x, y);
-                    float uv[2] = { pix.u, pix.v };
-                    float xy[2];
-                    UpsampledSpectrum::uv_to_xy(uv, xy);
-                    float b = pix.s/* * UpsampledSpectrum::EqualEnergyReflectance()*/;
-                    float Y = xy[1] * b;
-                    *reinterpret_cast<float*>(&data[(y * width + x) * stride]) = Y;
-                    break;
-                }
-                default:
-                    VLRAssert_ShouldNotBeCalled();
-                    break;
-                }
-            }
-        }
+        data.resize(sizeof(float) * width * height);
+
+        computeLinearImageLuminance(getLevelData(0), width, height, getDataFormat(), needsHW_sRGB_degamma(),
+                                    reinterpret_cast<float*>(data.data()));
+
+        // JP: 輝度はリニアな値なのでガンマは外す。
+        // EN: Luminance is a linear value, so remove the gamma.
+        ColorSpace colorSpace = getColorSpace();
+        if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+            colorSpace = ColorSpace::Rec709_D65;
 
-        return new LinearImage2D(m_context, data.data(), width, height, newDataFormat, getSpectrumType(), getColorSpace());
+        return new LinearImage2D(m_context, data.data(), width, height, DataFormat::Gray32F, getSpectrumType(), colorSpace);
+    }
+
+    size_t LinearImage2D::copyLevelData(uint32_t mipLevel, uint8_t* dst) const {
+        VLRAssert(mipLevel < getNumMipmapLevels(), "Mip level is out of range.");
+        size_t size = getLevelSize(mipLevel);
+        if (dst) {
+            ScopedHostData hostData(*this);
+            const uint8_t* srcData = getLevelData(mipLevel);
+            std::copy(srcData, srcData + size, dst);
+        }
+        return size;
     }
 
     void* LinearImage2D::createLinearImageData() const {
-        uint8_t* ret = new uint8_t[m_data.size()];
-        std::copy(m_data.cbegin(), m_data.cend(), ret);
+        ScopedHostData hostData(*this);
+        const uint8_t* srcData = getLevelData(0);
+        size_t size = getLevelSize(0);
+        uint8_t* ret = new uint8_t[size];
+        std::copy(srcData, srcData + size, ret);
         return ret;
     }
 
     const cudau::Array &LinearImage2D::getOptiXObject() const {
         const cudau::Array &buffer = Image2D::getOptiXObject();
         if (!m_copyDone) {
-            auto dstData = m_optixDataBuffer.map<uint8_t>(0);
-            std::copy(m_data.cbegin(), m_data.cend(), dstData);
-            m_optixDataBuffer.unmap(0);
+            int32_t numMipLevels = static_cast<int32_t>(m_optixDataBuffer.getNumMipmapLevels());
+            for (int mipLevel = 0; mipLevel < numMipLevels; ++mipLevel) {
+                const uint8_t* srcMipData = getLevelData(mipLevel);
+                auto dstData = m_optixDataBuffer.map<uint8_t>(mipLevel);
+                std::copy(srcMipData, srcMipData + getLevelSize(mipLevel), dstData);
+                m_optixDataBuffer.unmap(mipLevel);
+            }
             m_copyDone = true;
+            releaseHostData();
         }
         return buffer;
     }
@@ -1058,7 +766,8 @@ namespace vlr {
     
     BlockCompressedImage2D::BlockCompressedImage2D(Context &context, const uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height, 
                                                    DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace) :
-        Image2D(context, width, height, dataFormat, spectrumType, colorSpace), m_copyDone(false) {
+        Image2D(context, width, height, mipCount, dataFormat, spectrumType, colorSpace), m_copyDone(false),
+        m_encodingPSNR(0.0f), m_encodingTime(0.0f) {
         VLRAssert(dataFormat >= DataFormat::BC1 && dataFormat <= DataFormat::BC7, "Specified data format is not block compressed format.");
         m_data.resize(mipCount);
         for (int i = 0; i < static_cast<int>(mipCount); ++i) {
@@ -1067,19 +776,179 @@ namespace vlr {
         }
     }
 
-    Image2D* BlockCompressedImage2D::createShrinkedImage2D(uint32_t width, uint32_t height) const {
-        VLRAssert_NotImplemented();
-        return nullptr;
+    BlockCompressedImage2D::BlockCompressedImage2D(Context &context, ExternalImageData &&data, uint32_t width, uint32_t height,
+                                                   DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace) :
+        Image2D(context, width, height, data.getNumLevels(), dataFormat, spectrumType, colorSpace), m_copyDone(false),
+        m_encodingPSNR(0.0f), m_encodingTime(0.0f) {
+        VLRAssert(dataFormat >= DataFormat::BC1 && dataFormat <= DataFormat::BC7, "Specified data format is not block compressed format.");
+        m_externalData = std::move(data);
+    }
+
+    // JP: HDRはエンコード前にデガンマするので色空間からガンマを外す。
+    //     LDRはBC7のままハードウェアデガンマに任せられるので色空間を引き継ぐ。
+    // EN: HDR is degamma'd before encoding, so remove the gamma from the color space.
+    //     LDR can rely on hardware degamma as BC7, so inherit the color space.
+    static ColorSpace getColorSpaceForEncoding(DataFormat linearDataFormat, ColorSpace colorSpace) {
+        if (BlockCompressedImage2D::getEncodedDataFormat(linearDataFormat) == DataFormat::BC6H &&
+            colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+            return ColorSpace::Rec709_D65;
+        return colorSpace;
+    }
+
+    // static
+    DataFormat BlockCompressedImage2D::getEncodedDataFormat(DataFormat linearDataFormat) {
+        switch (linearDataFormat) {
+        case DataFormat::RGB8x3:
+        case DataFormat::RGB_8x4:
+        case DataFormat::RGBA8x4:
+            return DataFormat::BC7;
+        case DataFormat::RGBA16Fx4:
+        case DataFormat::RGBA32Fx4:
+            return DataFormat::BC6H;
+        default:
+            return DataFormat::NumFormats;
+        }
+    }
+
+    BlockCompressedImage2D::BlockCompressedImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height,
+                                                   DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                                                   bool generateMipmaps, BlockCompressionQuality quality) :
+        Image2D(context, width, height,
+                generateMipmaps ? getNumMipmapLevelsForFullChain(width, height) : 1,
+                dataFormat, getEncodedDataFormat(dataFormat), spectrumType, getColorSpaceForEncoding(dataFormat, colorSpace)),
+        m_copyDone(false) {
+        VLRAssert(getEncodedDataFormat(dataFormat) != DataFormat::NumFormats,
+                  "Encoding %s into a block compressed format is not supported.", getEnumMemberFromValue(dataFormat));
+        const DataFormat bcFormat = getDataFormat();
+        const DataFormat srcFormat = bcFormat == DataFormat::BC7 ? DataFormat::RGBA8x4 : DataFormat::RGBA16Fx4;
+        const size_t srcStride = sizesOfDataFormats[static_cast<uint32_t>(srcFormat)];
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        // JP: エンコーダーの入力形式(RGBA8x4かRGBA16Fx4)に変換する。
+        //     8bitデータはガンマのまま、HDRデータはここでデガンマする。
+        // EN: Convert to the input format of the encoder (RGBA8x4 or RGBA16Fx4).
+        //     8-bit data stays gamma-encoded while HDR data gets degamma'd here.
+        std::vector<uint8_t> level(srcStride * width * height);
+        const bool degamma = colorSpace == ColorSpace::Rec709_D65_sRGBGamma;
+        convertLinearImageDataForEncoding(linearData, width, height, dataFormat, degamma, level.data());
+
+        // JP: 各レベルを1つ上のエンコード前のレベルから生成してエンコードする。
+        // EN: Generate each level from the unencoded level above and encode it.
+        uint32_t numMipmapLevels = getNumMipmapLevels();
+        m_data.resize(numMipmapLevels);
+        std::vector<uint8_t> topLevel;
+        uint32_t levelWidth = width;
+        uint32_t levelHeight = height;
+        for (uint32_t mipLevel = 0; mipLevel < numMipmapLevels; ++mipLevel) {
+            if (mipLevel > 0) {
+                uint32_t dstWidth = std::max<uint32_t>(levelWidth >> 1, 1);
+                uint32_t dstHeight = std::max<uint32_t>(levelHeight >> 1, 1);
+                std::vector<uint8_t> dstLevel(srcStride * dstWidth * dstHeight);
+                resampleLinearImageData(level.data(), levelWidth, levelHeight, dstLevel.data(), dstWidth, dstHeight,
+                                        srcFormat, needsHW_sRGB_degamma(), ResamplingFilter::Box);
+                if (mipLevel == 1)
+                    topLevel = std::move(level);
+                level = std::move(dstLevel);
+                levelWidth = dstWidth;
+                levelHeight = dstHeight;
+            }
+
+            m_data[mipLevel].resize(getBlockCompressedDataSize(bcFormat, levelWidth, levelHeight));
+            encodeBlockCompressedImageData(level.data(), levelWidth, levelHeight, bcFormat, quality,
+                                           m_data[mipLevel].data());
+        }
+        if (numMipmapLevels == 1)
+            topLevel = std::move(level);
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        m_encodingTime = static_cast<float>(std::chrono::duration<double, std::milli>(endTime - startTime).count());
+        m_encodingPSNR = static_cast<float>(
+            computeBlockCompressionPSNR(topLevel.data(), m_data[0].data(), width, height, bcFormat));
+    }
+
+    void BlockCompressedImage2D::getHostLevels(std::vector<HostLevel>* levels) const {
+        levels->clear();
+        for (uint32_t mipLevel = 0; mipLevel < getNumStoredMipmapLevels(); ++mipLevel)
+            levels->push_back(HostLevel{ getStoredLevelData(mipLevel), getStoredLevelSize(mipLevel) });
+    }
+
+    void BlockCompressedImage2D::freeHostLevels() const {
+        std::vector<std::vector<uint8_t>>().swap(m_data);
+        m_externalData.release();
+    }
+
+    void BlockCompressedImage2D::adoptHostLevels(std::vector<std::vector<uint8_t>> &&levels) const {
+        m_data = std::move(levels);
+    }
+
+    void BlockCompressedImage2D::replaceData(ExternalImageData &&data, uint32_t width, uint32_t height) {
+        resetContents(width, height, data.getNumLevels());
+        m_externalData = std::move(data);
+        m_copyDone = false;
+        m_encodingPSNR = 0.0f;
+        m_encodingTime = 0.0f;
+        notifyContentsChanged();
+    }
+
+    LinearImage2D* BlockCompressedImage2D::createDecodedImage2D(uint32_t mipLevel) const {
+        VLRAssert(mipLevel < getNumStoredMipmapLevels(), "Mip level is out of range.");
+        ScopedHostData hostData(*this);
+        uint32_t width = std::max<uint32_t>(getWidth() >> mipLevel, 1);
+        uint32_t height = std::max<uint32_t>(getHeight() >> mipLevel, 1);
+        DataFormat bcFormat = getDataFormat();
+        VLRAssert(getStoredLevelSize(mipLevel) >= getBlockCompressedDataSize(bcFormat, width, height),
+                  "Data size of mip level %u is too small.", mipLevel);
+
+        DataFormat decodedFormat = getDecodedDataFormat(bcFormat);
+        std::vector<uint8_t> data;
+        data.resize(sizesOfDataFormats[static_cast<uint32_t>(decodedFormat)] * width * height);
+        decodeBlockCompressedImageData(getStoredLevelData(mipLevel), width, height, bcFormat, data.data());
+
+        // JP: BC1/2/3/4/7はデコード後もsRGBエンコードのままなので色空間を引き継ぐ。
+        //     それ以外はハードウェアデガンマ対象外だったので、再度デガンマされないように色空間からガンマを外す。
+        // EN: BC1/2/3/4/7 remain sRGB encoded after decoding, so inherit the color space.
+        //     The others were not subject to hardware degamma, so remove the gamma from the color space
+        //     so that they aren't degamma'd again.
+        ColorSpace colorSpace = getColorSpace();
+        if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma && !needsHW_sRGB_degamma())
+            colorSpace = ColorSpace::Rec709_D65;
+
+        return new LinearImage2D(m_context, data.data(), width, height, decodedFormat, getSpectrumType(), colorSpace);
+    }
+
+    Image2D* BlockCompressedImage2D::createShrinkedImage2D(uint32_t width, uint32_t height, ResamplingFilter filter) const {
+        VLRAssert(width <= getWidth() && height <= getHeight(), "Image size must be smaller than the original.");
+
+        // JP: 目標解像度以上で最も小さいミップレベルをデコード元にしてデコード量を減らす。
+        // EN: Decode from the smallest mip level that is still at least the target resolution to reduce decoding work.
+        uint32_t mipLevel = 0;
+        while (mipLevel + 1 < getNumStoredMipmapLevels() &&
+               std::max<uint32_t>(getWidth() >> (mipLevel + 1), 1) >= width &&
+               std::max<uint32_t>(getHeight() >> (mipLevel + 1), 1) >= height)
+            ++mipLevel;
+
+        LinearImage2D* decodedImage = createDecodedImage2D(mipLevel);
+        if (decodedImage->getWidth() == width && decodedImage->getHeight() == height)
+            return decodedImage;
+
+        Image2D* ret = decodedImage->createShrinkedImage2D(width, height, filter);
+        delete decodedImage;
+        return ret;
     }
 
     Image2D* BlockCompressedImage2D::createLuminanceImage2D() const {
-        VLRAssert_NotImplemented();
-        return nullptr;
+        LinearImage2D* decodedImage = createDecodedImage2D(0);
+        Image2D* ret = decodedImage->createLuminanceImage2D();
+        delete decodedImage;
+        return ret;
     }
 
     void* BlockCompressedImage2D::createLinearImageData() const {
-        VLRAssert_NotImplemented();
-        return nullptr;
+        LinearImage2D* decodedImage = createDecodedImage2D(0);
+        void* ret = decodedImage->createLinearImageData();
+        delete decodedImage;
+        return ret;
     }
 
     const cudau::Array &BlockCompressedImage2D::getOptiXObject() const {
@@ -1087,12 +956,13 @@ namespace vlr {
         if (!m_copyDone) {
             int32_t numMipLevels = static_cast<int32_t>(m_optixDataBuffer.getNumMipmapLevels());
             for (int mipLevel = 0; mipLevel < numMipLevels; ++mipLevel) {
-                const std::vector<uint8_t> &srcMipData = m_data[mipLevel];
+                const uint8_t* srcMipData = getStoredLevelData(mipLevel);
                 auto dstData = m_optixDataBuffer.map<uint8_t>(mipLevel);
-                std::copy(srcMipData.cbegin(), srcMipData.cend(), dstData);
+                std::copy(srcMipData, srcMipData + getStoredLevelSize(mipLevel), dstData);
                 m_optixDataBuffer.unmap(mipLevel);
             }
             m_copyDone = true;
+            releaseHostData();
         }
         return buffer;
     }
@@ -19,6 +19,91 @@ namespace vlr {
 
     uint32_t getComponentStartIndex(DataFormat dataFormat, BumpType bumpType, ShaderNodePlugType ptype, uint32_t index);
 
+    enum class ResamplingFilter {
+        Box = 0,
+        Tent,
+        Lanczos3,
+    };
+
+    // JP: コンテキスト内の画像のメモリ使用量の集計。
+    // EN: Summary of memory usage of images in a context.
+    struct ImageMemoryReport {
+        uint32_t numImages;
+        uint32_t numReleasedImages;
+        size_t hostResidentSize;
+        size_t spilledSize;
+        size_t deviceSize;
+    };
+
+    // JP: 呼び出し側から所有権を受け取ったミップレベルごとの画像データ。
+    //     コピーせずに参照し、不要になった時点(遅くとも破棄時)で解放関数を一度だけ呼ぶ。
+    // EN: Per-mip-level image data whose ownership has been transferred from the caller.
+    //     Referenced without copying, and the release function is called exactly once when no longer needed
+    //     (at destruction at the latest).
+    class ExternalImageData {
+        std::vector<const uint8_t*> m_levels;
+        std::vector<size_t> m_sizes;
+        void (*m_releaseFunc)(void* userData);
+        void* m_userData;
+
+    public:
+        ExternalImageData() : m_releaseFunc(nullptr), m_userData(nullptr) {}
+        ExternalImageData(const uint8_t* const* levels, const size_t* sizes, uint32_t numLevels,
+                          void (*releaseFunc)(void* userData), void* userData) :
+            m_levels(levels, levels + numLevels), m_sizes(sizes, sizes + numLevels),
+            m_releaseFunc(releaseFunc), m_userData(userData) {}
+        ExternalImageData(ExternalImageData &&v) noexcept :
+            m_levels(std::move(v.m_levels)), m_sizes(std::move(v.m_sizes)),
+            m_releaseFunc(v.m_releaseFunc), m_userData(v.m_userData) {
+            v.m_levels.clear();
+            v.m_sizes.clear();
+            v.m_releaseFunc = nullptr;
+            v.m_userData = nullptr;
+        }
+        ExternalImageData &operator=(ExternalImageData &&v) noexcept {
+            if (this != &v) {
+                release();
+                std::swap(m_levels, v.m_levels);
+                std::swap(m_sizes, v.m_sizes);
+                std::swap(m_releaseFunc, v.m_releaseFunc);
+                std::swap(m_userData, v.m_userData);
+            }
+            return *this;
+        }
+        ExternalImageData(const ExternalImageData &) = delete;
+        ExternalImageData &operator=(const ExternalImageData &) = delete;
+        ~ExternalImageData() {
+            release();
+        }
+
+        void release() {
+            m_levels.clear();
+            m_sizes.clear();
+            if (m_releaseFunc)
+                m_releaseFunc(m_userData);
+            m_releaseFunc = nullptr;
+            m_userData = nullptr;
+        }
+
+        explicit operator bool() const {
+            return !m_levels.empty();
+        }
+        uint32_t getNumLevels() const {
+            return static_cast<uint32_t>(m_levels.size());
+        }
+        const uint8_t* getLevel(uint32_t level) const {
+            return m_levels[level];
+        }
+        size_t getLevelSize(uint32_t level) const {
+            return m_sizes[level];
+        }
+    };
+
+
+
+    class Image2DTextureShaderNode;
+    class EnvironmentTextureShaderNode;
+
     class Image2D : public Queryable {
         uint32_t m_width, m_height;
         DataFormat m_originalDataFormat;
@@ -26,10 +111,67 @@ namespace vlr {
         bool m_needsHW_sRGB_degamma;
         SpectrumType m_spectrumType;
         ColorSpace m_colorSpace;
+        uint32_t m_numMipmapLevels;
+
+        ImageResidencyPolicy m_residencyPolicy;
+        mutable bool m_hostDataReleased;
+        mutable std::vector<size_t> m_releasedLevelSizes;
+        mutable std::filesystem::path m_spillFilePath;
+        mutable size_t m_spilledSize;
+
+        mutable std::unordered_set<Image2DTextureShaderNode*> m_textureShaderNodes;
+        mutable std::unordered_set<EnvironmentTextureShaderNode*> m_environmentTextureShaderNodes;
+
+    protected:
+        struct HostLevel {
+            const uint8_t* data;
+            size_t size;
+        };
+
+    private:
+        bool spillHostData(const std::vector<HostLevel> &levels) const;
+        bool restoreSpilledHostData(std::vector<std::vector<uint8_t>> &levels) const;
 
     protected:
         mutable cudau::Array m_optixDataBuffer;
 
+        // JP: 派生クラスが保持するミップレベルごとのホスト側データ。
+        //     解放時はfreeHostLevels()、復元時は復元したデータをadoptHostLevels()で渡す。
+        // EN: Host-side data per mip level held by the derived class.
+        //     freeHostLevels() is called on release, and adoptHostLevels() receives the restored data.
+        virtual void getHostLevels(std::vector<HostLevel>* levels) const = 0;
+        virtual void freeHostLevels() const = 0;
+        virtual void adoptHostLevels(std::vector<std::vector<uint8_t>> &&levels) const = 0;
+        // JP: アップロード後にポリシーに従ってホスト側データを解放する。
+        // EN: Release host-side data according to the policy after upload.
+        void releaseHostData() const;
+        // JP: 解放済みのホスト側データをディスクかデバイスから実体化する。解放済みだった場合は真を返す。
+        // EN: Re-materialize released host-side data from disk or the device. Returns true if it was released.
+        bool restoreHostData() const;
+
+        // JP: スコープ中はホスト側データを実体化し、抜ける時に再び解放する。
+        // EN: Re-materializes host-side data during the scope and releases it again on exit.
+        class ScopedHostData {
+            const Image2D &m_image;
+            bool m_restored;
+
+        public:
+            ScopedHostData(const Image2D &image) : m_image(image), m_restored(image.restoreHostData()) {}
+            ~ScopedHostData() {
+                if (m_restored)
+                    m_image.releaseHostData();
+            }
+        };
+
+        // JP: 内容を差し替える前にホスト側とデバイス側のデータを破棄し、大きさを更新する。
+        //     差し替え後はnotifyContentsChanged()で参照しているテクスチャーノードに知らせる。
+        //     環境テクスチャーノードから参照されている画像は差し替えられない。
+        // EN: Discard host- and device-side data and update the size before replacing the contents.
+        //     Texture nodes referencing the image are informed by notifyContentsChanged() after the replacement.
+        //     An image referenced by environment texture nodes can't be replaced.
+        void resetContents(uint32_t width, uint32_t height, uint32_t numMipmapLevels);
+        void notifyContentsChanged() const;
+
     public:
         VLR_DECLARE_TYPE_AWARE_CLASS_INTERFACE();
 
@@ -37,12 +179,20 @@ namespace vlr {
         static void finalize(Context &context);
 
         static DataFormat getInternalFormat(DataFormat inputFormat, SpectrumType spectrumType);
+        static uint32_t getNumMipmapLevelsForFullChain(uint32_t width, uint32_t height) {
+            return prevPowOf2Exponent(std::max(width, height)) + 1;
+        }
 
-        Image2D(Context &context, uint32_t width, uint32_t height,
+        Image2D(Context &context, uint32_t width, uint32_t height, uint32_t numMipmapLevels,
                 DataFormat originalDataFormat, SpectrumType spectrumType, ColorSpace colorSpace);
+        // JP: 内部形式を明示的に指定する。ロード時にブロック圧縮する場合に使う。
+        // EN: Specify the internal format explicitly. Used for block compression on load.
+        Image2D(Context &context, uint32_t width, uint32_t height, uint32_t numMipmapLevels,
+                DataFormat originalDataFormat, DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace);
         virtual ~Image2D();
 
-        virtual Image2D* createShrinkedImage2D(uint32_t width, uint32_t height) const = 0;
+        virtual Image2D* createShrinkedImage2D(uint32_t width, uint32_t height,
+                                              ResamplingFilter filter = ResamplingFilter::Box) const = 0;
         virtual Image2D* createLuminanceImage2D() const = 0;
         virtual void* createLinearImageData() const = 0;
 
@@ -52,6 +202,9 @@ namespace vlr {
         uint32_t getHeight() const {
             return m_height;
         }
+        uint32_t getNumMipmapLevels() const {
+            return m_numMipmapLevels;
+        }
         uint32_t getStride() const {
             return static_cast<uint32_t>(sizesOfDataFormats[static_cast<uint32_t>(m_dataFormat)]);
         }
@@ -81,6 +234,42 @@ namespace vlr {
             return m_colorSpace;
         }
 
+        void setResidencyPolicy(ImageResidencyPolicy policy);
+        ImageResidencyPolicy getResidencyPolicy() const {
+            return m_residencyPolicy;
+        }
+        bool isHostDataReleased() const {
+            return m_hostDataReleased;
+        }
+        size_t getHostMemorySize() const;
+        size_t getSpilledSize() const {
+            return m_spilledSize;
+        }
+        size_t getDeviceMemorySize() const;
+
+        // JP: この画像を参照しているテクスチャーノード。内容の差し替え時にテクスチャーオブジェクトを作り直させる。
+        //     画像の破棄時にはどちらの種類のノードも空の画像を参照するように戻す。
+        // EN: Texture nodes referencing this image. They are made to recreate texture objects when the contents are replaced.
+        //     On destruction of the image, nodes of both kinds are reset to reference the null image.
+        void addTextureShaderNode(Image2DTextureShaderNode* node) const {
+            m_textureShaderNodes.insert(node);
+        }
+        void removeTextureShaderNode(Image2DTextureShaderNode* node) const {
+            m_textureShaderNodes.erase(node);
+        }
+        // JP: 環境テクスチャーノードは内容から重点サンプリング用のマップを作るため、参照されている間は差し替えを拒否する。
+        // EN: Environment texture nodes build importance maps from the contents,
+        //     so replacement is rejected while they reference the image.
+        void addEnvironmentTextureShaderNode(EnvironmentTextureShaderNode* node) const {
+            m_environmentTextureShaderNodes.insert(node);
+        }
+        void removeEnvironmentTextureShaderNode(EnvironmentTextureShaderNode* node) const {
+            m_environmentTextureShaderNodes.erase(node);
+        }
+        bool isUsedAsEnvironmentTexture() const {
+            return !m_environmentTextureShaderNodes.empty();
+        }
+
         virtual const cudau::Array &getOptiXObject() const;
     };
 
@@ -89,9 +278,33 @@ namespace vlr {
     class LinearImage2D : public Image2D {
         VLR_DECLARE_QUERYABLE_INTERFACE();
 
-        std::vector<uint8_t> m_data;
+        mutable std::vector<uint8_t> m_data;
+        // JP: ミップレベル1以降のデータ。
+        // EN: Data of mip level 1 and later.
+        mutable std::vector<std::vector<uint8_t>> m_mipData;
+        // JP: 変換が不要な場合はm_dataにコピーせず受け取ったデータを先頭のミップレベルとして使う。
+        // EN: Use the received data as the leading mip levels without copying into m_data when no conversion is needed.
+        mutable ExternalImageData m_externalData;
         mutable bool m_copyDone;
 
+        void initializeData(const uint8_t* linearData, DataFormat dataFormat);
+        void generateMipmaps();
+
+        const uint8_t* getLevelData(uint32_t mipLevel) const {
+            if (mipLevel < m_externalData.getNumLevels())
+                return m_externalData.getLevel(mipLevel);
+            return mipLevel == 0 ? m_data.data() : m_mipData[mipLevel - 1].data();
+        }
+        size_t getLevelSize(uint32_t mipLevel) const {
+            return static_cast<size_t>(getStride()) *
+                std::max<uint32_t>(getWidth() >> mipLevel, 1) * std::max<uint32_t>(getHeight() >> mipLevel, 1);
+        }
+
+    protected:
+        void getHostLevels(std::vector<HostLevel>* levels) const override;
+        void freeHostLevels() const override;
+        void adoptHostLevels(std::vector<std::vector<uint8_t>> &&levels) const override;
+
     public:
         VLR_DECLARE_TYPE_AWARE_CLASS_INTERFACE();
 
@@ -99,16 +312,40 @@ namespace vlr {
         static void finalize(Context &context);
 
         // JP: "linearData" はメモリ上のレイアウトがリニアであることを意味しており、ガンマカーブ云々を表しているのではない。
+        //     generateMipmapsが真の場合はホスト側でミップチェーン全体を生成する。
         // EN: "linearData" means data layout is linear, it doesn't mean gamma curve.
+        //     Generates the full mip chain on the host when generateMipmaps is true.
         LinearImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height,
-                      DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace);
+                      DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                      bool generateMipmaps = false);
+        // JP: 所有権を受け取ったデータから作る。内部形式への変換が不要ならコピーしない。
+        //     変換が必要な場合は変換後すぐに解放する。
+        // EN: Create from data whose ownership has been transferred. No copy is made if no conversion to the internal
+        //     format is needed. Otherwise the data is released right after conversion.
+        LinearImage2D(Context &context, ExternalImageData &&linearData, uint32_t width, uint32_t height,
+                      DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                      bool generateMipmaps = false);
+        // JP: 内部形式に変換済みのデータ(ミップレベルを含む)の所有権を受け取り、変換せずに作る。
+        //     colorSpaceには変換前のデータの色空間を指定する。キャッシュからの復元などに使う。
+        // EN: Take ownership of data already converted into the internal format (including mip levels)
+        //     and create without conversion. colorSpace is the color space of the data before conversion.
+        //     Used for restoring from a cache for example.
+        LinearImage2D(Context &context, ExternalImageData &&convertedData, uint32_t width, uint32_t height,
+                      DataFormat originalDataFormat, DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace);
 
         template <typename PixelType>
         PixelType get(uint32_t x, uint32_t y) const {
-            return *reinterpret_cast<const PixelType*>(m_data.data() + (y * getWidth() + x) * getStride());
+            VLRAssert(!isHostDataReleased(), "Host-side data has been released.");
+            return *reinterpret_cast<const PixelType*>(getLevelData(0) + (y * getWidth() + x) * getStride());
         }
 
-        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height) const override;
+        // JP: 指定したミップレベルの内部形式のデータをdstにコピーしてサイズを返す。dstがnullptrの場合はサイズのみ返す。
+        // EN: Copy the data of the specified mip level in the internal format into dst and return the size.
+        //     Returns only the size when dst is nullptr.
+        size_t copyLevelData(uint32_t mipLevel, uint8_t* dst) const;
+
+        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height,
+                                      ResamplingFilter filter = ResamplingFilter::Box) const override;
         Image2D* createLuminanceImage2D() const override;
         void* createLinearImageData() const override;
 
@@ -120,8 +357,25 @@ namespace vlr {
     class BlockCompressedImage2D : public Image2D {
         VLR_DECLARE_QUERYABLE_INTERFACE();
 
-        std::vector<std::vector<uint8_t>> m_data;
+        mutable std::vector<std::vector<uint8_t>> m_data;
+        // JP: 所有権を受け取ったデータはm_dataにコピーせずそのまま使う。
+        // EN: Data whose ownership has been transferred is used as is without copying into m_data.
+        mutable ExternalImageData m_externalData;
         mutable bool m_copyDone;
+        float m_encodingPSNR;
+        float m_encodingTime;
+
+        const uint8_t* getStoredLevelData(uint32_t mipLevel) const {
+            return m_externalData ? m_externalData.getLevel(mipLevel) : m_data[mipLevel].data();
+        }
+        size_t getStoredLevelSize(uint32_t mipLevel) const {
+            return m_externalData ? m_externalData.getLevelSize(mipLevel) : m_data[mipLevel].size();
+        }
+
+    protected:
+        void getHostLevels(std::vector<HostLevel>* levels) const override;
+        void freeHostLevels() const override;
+        void adoptHostLevels(std::vector<std::vector<uint8_t>> &&levels) const override;
 
     public:
         VLR_DECLARE_TYPE_AWARE_CLASS_INTERFACE();
@@ -129,10 +383,49 @@ namespace vlr {
         static void initialize(Context &context);
         static void finalize(Context &context);
 
+        // JP: リニアな形式をロード時にエンコードする場合の圧縮形式。LDRはBC7、HDRはBC6H。
+        //     エンコードできない形式の場合はNumFormatsを返す。
+        // EN: Compressed format when encoding a linear format on load. BC7 for LDR, BC6H for HDR.
+        //     Returns NumFormats for a format that can't be encoded.
+        static DataFormat getEncodedDataFormat(DataFormat linearDataFormat);
+
         BlockCompressedImage2D(Context &context, const uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
                                DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace);
+        // JP: 所有権を受け取ったデータからコピーせずに作る。
+        // EN: Create from data whose ownership has been transferred without copying.
+        BlockCompressedImage2D(Context &context, ExternalImageData &&data, uint32_t width, uint32_t height,
+                               DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace);
+        // JP: リニアな画像データをCPUでBC7/BC6Hにエンコードして作る。
+        // EN: Create by encoding linear image data into BC7/BC6H on the CPU.
+        BlockCompressedImage2D(Context &context, const uint8_t* linearData, uint32_t width, uint32_t height,
+                               DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                               bool generateMipmaps, BlockCompressionQuality quality);
+
+        // JP: エンコードして作った場合の最上位レベルのPSNR[dB]とエンコード時間[ms]。それ以外は0。
+        //     BC6HのPSNRは半精度浮動小数点数のビット列(ほぼ対数)の領域で測る。
+        // EN: PSNR [dB] of the top level and encoding time [ms] when created by encoding. Zero otherwise.
+        //     PSNR for BC6H is measured in the half-precision bit pattern (roughly log) domain.
+        float getEncodingPSNR() const {
+            return m_encodingPSNR;
+        }
+        float getEncodingTime() const {
+            return m_encodingTime;
+        }
 
-        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height) const override;
+        uint32_t getNumStoredMipmapLevels() const {
+            return m_externalData ? m_externalData.getNumLevels() : static_cast<uint32_t>(m_data.size());
+        }
+        // JP: 同じ形式の別の解像度のミップチェーンで内容を差し替える。
+        //     小さいミップレベルだけで先に作っておき、後からフル解像度に差し替えるストリーミングに使う。
+        // EN: Replace the contents with a mip chain of another resolution in the same format.
+        //     Used for streaming that creates the image from small mip levels first and replaces it with the full resolution later.
+        void replaceData(ExternalImageData &&data, uint32_t width, uint32_t height);
+        // JP: 指定したミップレベルをソフトウェアでデコードしたリニアな画像を作る。
+        // EN: Create a linear image by decoding the specified mip level in software.
+        LinearImage2D* createDecodedImage2D(uint32_t mipLevel) const;
+
+        Image2D* createShrinkedImage2D(uint32_t width, uint32_t height,
+                                      ResamplingFilter filter = ResamplingFilter::Box) const override;
         Image2D* createLuminanceImage2D() const override;
         void* createLinearImageData() const override;
 
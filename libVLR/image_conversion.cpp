@@ -0,0 +1,593 @@
+﻿#include "image_conversion.h"
+#include "image_simd.h"
+#include "thread_pool.h"
+
+namespace vlr {
+    const size_t sizesOfDataFormats[static_cast<uint32_t>(DataFormat::NumFormats)] = {
+    sizeof(RGB8x3),
+    sizeof(RGB_8x4),
+    sizeof(RGBA8x4),
+    sizeof(RGBA16Fx4),
+    sizeof(RGBA32Fx4),
+    sizeof(RG32Fx2),
+    sizeof(Gray32F),
+    sizeof(Gray8),
+    sizeof(GrayA8x2),
+    0,
+    0,
+    0,
+    0,
+    0,
+    0,
+    0,
+    0,
+    0,
+    0,
+    sizeof(uvsA8x4),
+    sizeof(uvsA16Fx4),
+    };
+
+
+
+    DataFormat getConvertedDataFormat(DataFormat inputFormat, SpectrumType spectrumType) {
+        const auto asis = [](DataFormat inputFormat) {
+            switch (inputFormat) {
+            case DataFormat::RGB8x3:
+                return DataFormat::RGBA8x4;
+            case DataFormat::RGB_8x4:
+                return DataFormat::RGBA8x4;
+            case DataFormat::RGBA8x4:
+                return DataFormat::RGBA8x4;
+            case DataFormat::RGBA16Fx4:
+                return DataFormat::RGBA16Fx4;
+            case DataFormat::RGBA32Fx4:
+                return DataFormat::RGBA32Fx4;
+            case DataFormat::RG32Fx2:
+                return DataFormat::RG32Fx2;
+            case DataFormat::Gray32F:
+                return DataFormat::Gray32F;
+            case DataFormat::Gray8:
+                return DataFormat::Gray8;
+            case DataFormat::GrayA8x2:
+                return DataFormat::GrayA8x2;
+            case DataFormat::BC1:
+                return DataFormat::BC1;
+            case DataFormat::BC2:
+                return DataFormat::BC2;
+            case DataFormat::BC3:
+                return DataFormat::BC3;
+            case DataFormat::BC4:
+                return DataFormat::BC4;
+            case DataFormat::BC4_Signed:
+                return DataFormat::BC4_Signed;
+            case DataFormat::BC5:
+                return DataFormat::BC5;
+            case DataFormat::BC5_Signed:
+                return DataFormat::BC5_Signed;
+            case DataFormat::BC6H:
+                return DataFormat::BC6H;
+            case DataFormat::BC6H_Signed:
+                return DataFormat::BC6H_Signed;
+            case DataFormat::BC7:
+                return DataFormat::BC7;
+            case DataFormat::uvsA8x4:
+                return DataFormat::uvsA8x4;
+            case DataFormat::uvsA16Fx4:
+                return DataFormat::uvsA16Fx4;
+            default:
+                VLRAssert(false, "Data format is invalid.");
+                break;
+            }
+            return DataFormat(0);
+        };
+
+        if (spectrumType == SpectrumType::NA) {
+            return asis(inputFormat);
+        }
+        else {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+            switch (inputFormat) {
+            case DataFormat::RGB8x3:
+                return DataFormat::uvsA8x4;
+            case DataFormat::RGB_8x4:
+                return DataFormat::uvsA8x4;
+            case DataFormat::RGBA8x4:
+                return DataFormat::uvsA8x4;
+            case DataFormat::RGBA16Fx4:
+                return DataFormat::uvsA16Fx4;
+            case DataFormat::RGBA32Fx4:
+                VLRAssert_NotImplemented();
+                return DataFormat::uvsA16Fx4;
+            default:
+                break;
+            }
+            return asis(inputFormat);
+#else
+            return asis(inputFormat);
+#endif
+        }
+        return DataFormat(0);
+    }
+
+
+
+    template <bool enableDegamma>
+    struct sRGB_D65_ColorSpaceFunc {
+        static constexpr bool EnableDegamma = enableDegamma;
+        static const float* getMatRGB_to_XYZ() {
+            return mat_Rec709_D65_to_XYZ;
+        }
+
+        static float degamma(float v) {
+            if constexpr (enableDegamma)
+                return sRGB_degamma(v);
+            else
+                return v;
+        }
+        static uint8_t degamma(uint8_t v) {
+            if constexpr (enableDegamma)
+                return static_cast<uint8_t>(std::min<uint32_t>(255, 256 * sRGB_degamma(v / 255.0f)));
+            else
+                return v;
+        }
+
+        static void RGB_to_XYZ(const float RGB[3], float XYZ[3]) {
+            transformTristimulus(mat_Rec709_D65_to_XYZ, RGB, XYZ);
+        }
+    };
+
+    template <bool enableDegamma>
+    struct sRGB_E_ColorSpaceFunc {
+        static constexpr bool EnableDegamma = enableDegamma;
+        static const float* getMatRGB_to_XYZ() {
+            return mat_Rec709_E_to_XYZ;
+        }
+
+        static float degamma(float v) {
+            if constexpr (enableDegamma)
+                return sRGB_degamma(v);
+            else
+                return v;
+        }
+        static uint8_t degamma(uint8_t v) {
+            if constexpr (enableDegamma)
+                return static_cast<uint8_t>(std::min<uint32_t>(255, 256 * sRGB_degamma(v / 255.0f)));
+            else
+                return v;
+        }
+
+        static void RGB_to_XYZ(const float RGB[3], float XYZ[3]) {
+            transformTristimulus(mat_Rec709_E_to_XYZ, RGB, XYZ);
+        }
+    };
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGB8x3 &srcData, RGBA8x4 &dstData) {
+        dstData.r = ColorSpaceFunc::degamma(srcData.r);
+        dstData.g = ColorSpaceFunc::degamma(srcData.g);
+        dstData.b = ColorSpaceFunc::degamma(srcData.b);
+        dstData.a = 255;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGB_8x4 &srcData, RGBA8x4 &dstData) {
+        dstData.r = ColorSpaceFunc::degamma(srcData.r);
+        dstData.g = ColorSpaceFunc::degamma(srcData.g);
+        dstData.b = ColorSpaceFunc::degamma(srcData.b);
+        dstData.a = 255;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGBA8x4 &srcData, RGBA8x4 &dstData) {
+        dstData.r = ColorSpaceFunc::degamma(srcData.r);
+        dstData.g = ColorSpaceFunc::degamma(srcData.g);
+        dstData.b = ColorSpaceFunc::degamma(srcData.b);
+        dstData.a = srcData.a;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGBA16Fx4 &srcData, RGBA16Fx4 &dstData) {
+        dstData.r = static_cast<half>(ColorSpaceFunc::degamma(static_cast<float>(srcData.r)));
+        dstData.g = static_cast<half>(ColorSpaceFunc::degamma(static_cast<float>(srcData.g)));
+        dstData.b = static_cast<half>(ColorSpaceFunc::degamma(static_cast<float>(srcData.b)));
+        dstData.a = srcData.a;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGBA32Fx4 &srcData, RGBA32Fx4 &dstData) {
+        dstData.r = ColorSpaceFunc::degamma(srcData.r);
+        dstData.g = ColorSpaceFunc::degamma(srcData.g);
+        dstData.b = ColorSpaceFunc::degamma(srcData.b);
+        dstData.a = srcData.a;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGBA32Fx4 &srcData, RGBA16Fx4 &dstData) {
+        dstData.r = static_cast<half>(ColorSpaceFunc::degamma(srcData.r));
+        dstData.g = static_cast<half>(ColorSpaceFunc::degamma(srcData.g));
+        dstData.b = static_cast<half>(ColorSpaceFunc::degamma(srcData.b));
+        dstData.a = static_cast<half>(srcData.a);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RG32Fx2 &srcData, RG32Fx2 &dstData) {
+        dstData.r = ColorSpaceFunc::degamma(srcData.r);
+        dstData.g = ColorSpaceFunc::degamma(srcData.g);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const Gray32F &srcData, Gray32F &dstData) {
+        dstData.v = ColorSpaceFunc::degamma(srcData.v);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const Gray8 &srcData, Gray8 &dstData) {
+        dstData.v = ColorSpaceFunc::degamma(srcData.v);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const GrayA8x2 &srcData, GrayA8x2 &dstData) {
+        dstData.v = ColorSpaceFunc::degamma(srcData.v);
+        dstData.a = srcData.a;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(float RGB[3], uvsA8x4 &dstData) {
+        RGB[0] = ColorSpaceFunc::degamma(RGB[0]);
+        RGB[1] = ColorSpaceFunc::degamma(RGB[1]);
+        RGB[2] = ColorSpaceFunc::degamma(RGB[2]);
+
+        float XYZ[3];
+        ColorSpaceFunc::RGB_to_XYZ(RGB, XYZ);
+
+        float b = XYZ[0] + XYZ[1] + XYZ[2];
+        float xy[2];
+        xy[0] = b > 0.0f ? XYZ[0] / b : (1.0f / 3.0f);
+        xy[1] = b > 0.0f ? XYZ[1] / b : (1.0f / 3.0f);
+
+        float uv[2];
+        UpsampledSpectrum::xy_to_uv(xy, uv);
+
+        dstData.u = static_cast<uint8_t>(255 * clamp<float>(uv[0] / UpsampledSpectrum::GridWidth(), 0, 1));
+        dstData.v = static_cast<uint8_t>(255 * clamp<float>(uv[1] / UpsampledSpectrum::GridHeight(), 0, 1));
+        dstData.s = static_cast<uint8_t>(255 * clamp<float>(b / 3.0f, 0, 1));
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(float RGB[3], uvsA16Fx4 &dstData) {
+        RGB[0] = ColorSpaceFunc::degamma(RGB[0]);
+        RGB[1] = ColorSpaceFunc::degamma(RGB[1]);
+        RGB[2] = ColorSpaceFunc::degamma(RGB[2]);
+
+        float XYZ[3];
+        ColorSpaceFunc::RGB_to_XYZ(RGB, XYZ);
+
+        float b = XYZ[0] + XYZ[1] + XYZ[2];
+        float xy[2];
+        xy[0] = b > 0.0f ? XYZ[0] / b : (1.0f / 3.0f);
+        xy[1] = b > 0.0f ? XYZ[1] / b : (1.0f / 3.0f);
+
+        float uv[2];
+        UpsampledSpectrum::xy_to_uv(xy, uv);
+
+        dstData.u = static_cast<half>(uv[0]);
+        dstData.v = static_cast<half>(uv[1]);
+        // JP: よくあるテクスチャーの値だとInfになってしまうため
+        //     本来は割るべきところを割らないままにしておく。
+        // EN: 
+        dstData.s = static_cast<half>(b/* / UpsampledSpectrum::EqualEnergyReflectance()*/);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGB8x3 &srcData, uvsA8x4 &dstData) {
+        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
+        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
+        dstData.a = 255;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGB8x3 &srcData, uvsA16Fx4 &dstData) {
+        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
+        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
+        dstData.a = static_cast<half>(1.0f);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGB_8x4 &srcData, uvsA8x4 &dstData) {
+        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
+        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
+        dstData.a = 255;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGB_8x4 &srcData, uvsA16Fx4 &dstData) {
+        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
+        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
+        dstData.a = static_cast<half>(1.0f);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGBA8x4 &srcData, uvsA8x4 &dstData) {
+        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
+        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
+        dstData.a = srcData.a;
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGBA8x4 &srcData, uvsA16Fx4 &dstData) {
+        float RGB[] = { srcData.r / 255.0f, srcData.g / 255.0f, srcData.b / 255.0f };
+        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
+        dstData.a = static_cast<half>(srcData.a / 255.0f);
+    }
+
+    template <typename ColorSpaceFunc>
+    void perPixelFunc(const RGBA16Fx4 &srcData, uvsA16Fx4 &dstData) {
+        float RGB[] = { srcData.r, srcData.g, srcData.b };
+        perPixelFunc<ColorSpaceFunc>(RGB, dstData);
+        dstData.a = srcData.a;
+    }
+
+    // JP: RGB -> uvs変換は重いので、数百ピクセル単位でRGB値をSoAにデガンマ済みのfloatとして集め、
+    //     実行中のCPUに応じたSIMDカーネルでまとめて変換する。
+    //     8bitソースのデガンマはperPixelFunc()と同値の256要素のテーブルを引く。
+    // EN: RGB -> uvs conversion is heavy, so gather degamma'd RGB values as SoA floats for a few hundreds of pixels,
+    //     then batch-convert them with the SIMD kernel selected for the running CPU.
+    //     Degamma of 8-bit sources looks up 256-entry tables holding the same values as perPixelFunc().
+    static constexpr uint32_t NumPixelsPerUVSBatch = 256;
+
+    template <typename SrcType>
+    inline void gatherRGB(const SrcType &src, const float* table, float* R, float* G, float* B) {
+        *R = table[src.r];
+        *G = table[src.g];
+        *B = table[src.b];
+    }
+    inline void gatherRGB(const RGBA16Fx4 &src, const float* table, float* R, float* G, float* B) {
+        *R = static_cast<float>(src.r);
+        *G = static_cast<float>(src.g);
+        *B = static_cast<float>(src.b);
+    }
+
+    inline uint8_t getAlpha8(const RGB8x3 &src) { return 255; }
+    inline uint8_t getAlpha8(const RGB_8x4 &src) { return 255; }
+    inline uint8_t getAlpha8(const RGBA8x4 &src) { return src.a; }
+    inline half getAlpha16F(const RGB8x3 &src) { return static_cast<half>(1.0f); }
+    inline half getAlpha16F(const RGB_8x4 &src) { return static_cast<half>(1.0f); }
+    inline half getAlpha16F(const RGBA8x4 &src) { return static_cast<half>(src.a / 255.0f); }
+    inline half getAlpha16F(const RGBA16Fx4 &src) { return src.a; }
+
+    template <typename SrcType, typename DstType>
+    struct IsBatchedUVSConversion {
+        static constexpr bool value =
+            (std::is_same<DstType, uvsA8x4>::value &&
+             (std::is_same<SrcType, RGB8x3>::value ||
+              std::is_same<SrcType, RGB_8x4>::value ||
+              std::is_same<SrcType, RGBA8x4>::value)) ||
+            (std::is_same<DstType, uvsA16Fx4>::value &&
+             (std::is_same<SrcType, RGB8x3>::value ||
+              std::is_same<SrcType, RGB_8x4>::value ||
+              std::is_same<SrcType, RGBA8x4>::value ||
+              std::is_same<SrcType, RGBA16Fx4>::value));
+    };
+
+    template <typename ColorSpaceFunc, typename SrcType, typename DstType>
+    void processRowToUVS(const SrcType* srcLineHead, DstType* dstLineHead, uint32_t width) {
+        const float* table = getUNorm8ToFloatTable(ColorSpaceFunc::EnableDegamma);
+        float R[NumPixelsPerUVSBatch];
+        float G[NumPixelsPerUVSBatch];
+        float B[NumPixelsPerUVSBatch];
+        for (uint32_t xBegin = 0; xBegin < width; xBegin += NumPixelsPerUVSBatch) {
+            uint32_t numPixels = std::min(width - xBegin, NumPixelsPerUVSBatch);
+            for (uint32_t i = 0; i < numPixels; ++i) {
+                const SrcType &src = srcLineHead[xBegin + i];
+                DstType &dst = dstLineHead[xBegin + i];
+                gatherRGB(src, table, &R[i], &G[i], &B[i]);
+                if constexpr (std::is_same<DstType, uvsA8x4>::value)
+                    dst.a = getAlpha8(src);
+                else
+                    dst.a = getAlpha16F(src);
+            }
+            if constexpr (std::is_same<SrcType, RGBA16Fx4>::value) {
+                for (uint32_t i = 0; i < numPixels; ++i) {
+                    R[i] = ColorSpaceFunc::degamma(R[i]);
+                    G[i] = ColorSpaceFunc::degamma(G[i]);
+                    B[i] = ColorSpaceFunc::degamma(B[i]);
+                }
+            }
+            encodeLinearRGBToUVS(ColorSpaceFunc::getMatRGB_to_XYZ(), R, G, B, numPixels, dstLineHead + xBegin);
+        }
+    }
+
+    template <typename ColorSpaceFunc, typename SrcType, typename DstType>
+    void processRow(const SrcType* srcLineHead, DstType* dstLineHead, uint32_t width) {
+        if constexpr (IsBatchedUVSConversion<SrcType, DstType>::value) {
+            processRowToUVS<ColorSpaceFunc>(srcLineHead, dstLineHead, width);
+        }
+        else {
+            for (uint32_t x = 0; x < width; ++x)
+                perPixelFunc<ColorSpaceFunc>(srcLineHead[x], dstLineHead[x]);
+        }
+    }
+
+    // JP: 画素変換はピクセル単位で独立しているので行単位のバンドに分割して共有スレッドプールで並列に処理する。
+    //     各ピクセルは逐次版と同じ関数で変換されるので結果はビット単位で一致する。
+    // EN: Pixel conversion is independent per pixel, so split the image into row bands and process them in parallel
+    //     on the shared thread pool. Each pixel goes through the same function as the serial path,
+    //     so the result is bit-identical.
+    static constexpr uint32_t MinNumPixelsPerBand = 16384;
+
+    template <typename SrcType, typename DstType, typename ColorSpaceFunc>
+    void processAllPixels(const uint8_t* srcData, uint8_t* dstData, uint32_t width, uint32_t height) {
+        if (width == 0 || height == 0)
+            return;
+
+        uint32_t numRowsPerBand = std::max<uint32_t>((MinNumPixelsPerBand + width - 1) / width, 1);
+        ThreadPool &threadPool = ThreadPool::getShared();
+
+        if constexpr (std::is_same<SrcType, DstType>::value &&
+            (std::is_same<ColorSpaceFunc, sRGB_D65_ColorSpaceFunc<false>>::value ||
+             std::is_same<ColorSpaceFunc, sRGB_E_ColorSpaceFunc<false>>::value)) {
+            auto srcHead = reinterpret_cast<const SrcType*>(srcData);
+            auto dstHead = reinterpret_cast<SrcType*>(dstData);
+            threadPool.parallelFor(0, height, numRowsPerBand,
+                                   [srcHead, dstHead, width](uint32_t yBegin, uint32_t yEnd) {
+                std::copy_n(srcHead + static_cast<size_t>(width) * yBegin, static_cast<size_t>(width) * (yEnd - yBegin),
+                            dstHead + static_cast<size_t>(width) * yBegin);
+            });
+        }
+        else {
+            auto srcHead = reinterpret_cast<const SrcType*>(srcData);
+            auto dstHead = reinterpret_cast<DstType*>(dstData);
+            threadPool.parallelFor(0, height, numRowsPerBand,
+                                   [srcHead, dstHead, width](uint32_t yBegin, uint32_t yEnd) {
+                for (uint32_t y = yBegin; y < yEnd; ++y) {
+                    auto srcLineHead = srcHead + static_cast<size_t>(width) * y;
+                    auto dstLineHead = dstHead + static_cast<size_t>(width) * y;
+                    processRow<ColorSpaceFunc>(srcLineHead, dstLineHead, width);
+                }
+            });
+        }
+    }
+
+    template <typename SrcType, typename DstType, typename DstTypeForNA>
+    static inline void processAllPixels(const uint8_t* srcData, uint8_t* dstData,
+                                        SpectrumType spectrumType, ColorSpace colorSpace, uint32_t width, uint32_t height) {
+        if (spectrumType != SpectrumType::NA) {
+            if (spectrumType == SpectrumType::Reflectance ||
+                spectrumType == SpectrumType::IndexOfRefraction) {
+                if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+                    processAllPixels<SrcType, DstType, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+                else
+                    processAllPixels<SrcType, DstType, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            }
+            else {
+                if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+                    processAllPixels<SrcType, DstType, sRGB_D65_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+                else
+                    processAllPixels<SrcType, DstType, sRGB_D65_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            }
+        }
+        else {
+            processAllPixels<SrcType, DstTypeForNA, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+        }
+    }
+
+    void convertLinearImageData(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                                uint8_t* dstData) {
+        switch (dataFormat) {
+        case DataFormat::RGB8x3: {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+            processAllPixels<RGB8x3, uvsA8x4, RGBA8x4>(srcData, dstData, spectrumType, colorSpace, width, height);
+#else
+            processAllPixels<RGB8x3, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+#endif
+            break;
+        }
+        case DataFormat::RGB_8x4: {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+            processAllPixels<RGB_8x4, uvsA8x4, RGBA8x4>(srcData, dstData, spectrumType, colorSpace, width, height);
+#else
+            processAllPixels<RGB_8x4, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+#endif
+            break;
+        }
+        case DataFormat::RGBA8x4: {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+            processAllPixels<RGBA8x4, uvsA8x4, RGBA8x4>(srcData, dstData, spectrumType, colorSpace, width, height);
+#else
+            processAllPixels<RGBA8x4, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+#endif
+            break;
+        }
+        case DataFormat::RGBA16Fx4: {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+            processAllPixels<RGBA16Fx4, uvsA16Fx4, RGBA16Fx4>(srcData, dstData, spectrumType, colorSpace, width, height);
+#else
+            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+                processAllPixels<RGBA16Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+            else
+                processAllPixels<RGBA16Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+#endif
+            break;
+        }
+        case DataFormat::RGBA32Fx4: {
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+            VLRAssert_NotImplemented();
+#else
+            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+                processAllPixels<RGBA32Fx4, RGBA32Fx4, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+            else
+                processAllPixels<RGBA32Fx4, RGBA32Fx4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+#endif
+            break;
+        }
+        case DataFormat::RG32Fx2: {
+            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+                processAllPixels<RG32Fx2, RG32Fx2, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+            else
+                processAllPixels<RG32Fx2, RG32Fx2, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        }
+        case DataFormat::Gray32F: {
+            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+                processAllPixels<Gray32F, Gray32F, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+            else
+                processAllPixels<Gray32F, Gray32F, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        }
+        case DataFormat::Gray8: {
+            processAllPixels<Gray8, Gray8, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        }
+        case DataFormat::GrayA8x2: {
+            if (colorSpace == ColorSpace::Rec709_D65_sRGBGamma)
+                processAllPixels<GrayA8x2, GrayA8x2, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+            else
+                processAllPixels<GrayA8x2, GrayA8x2, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        }
+        case DataFormat::uvsA8x4: {
+            processAllPixels<uvsA8x4, uvsA8x4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        }
+        case DataFormat::uvsA16Fx4: {
+            processAllPixels<uvsA16Fx4, uvsA16Fx4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        }
+        default:
+            VLRAssert(false, "Data format is invalid.");
+            break;
+        }
+    }
+
+    void convertLinearImageDataForEncoding(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                           DataFormat dataFormat, bool degamma,
+                                           uint8_t* dstData) {
+        switch (dataFormat) {
+        case DataFormat::RGB8x3:
+            processAllPixels<RGB8x3, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        case DataFormat::RGB_8x4:
+            processAllPixels<RGB_8x4, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        case DataFormat::RGBA8x4:
+            processAllPixels<RGBA8x4, RGBA8x4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        case DataFormat::RGBA16Fx4:
+            if (degamma)
+                processAllPixels<RGBA16Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+            else
+                processAllPixels<RGBA16Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        case DataFormat::RGBA32Fx4:
+            if (degamma)
+                processAllPixels<RGBA32Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<true>>(srcData, dstData, width, height);
+            else
+                processAllPixels<RGBA32Fx4, RGBA16Fx4, sRGB_E_ColorSpaceFunc<false>>(srcData, dstData, width, height);
+            break;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            break;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include "image.h"
+
+namespace vlr {
+    // JP: 入力形式とスペクトル種別から内部形式を決める。
+    // EN: Determine the internal format from the input format and the spectrum type.
+    DataFormat getConvertedDataFormat(DataFormat inputFormat, SpectrumType spectrumType);
+
+    // JP: リニアなレイアウトの画像データを内部形式(getConvertedDataFormat())に変換する。
+    //     行単位のバンドに分割して共有スレッドプール上で並列に処理する。
+    //     各ピクセルの変換は独立しているので結果はバンド分割に依らずビット単位で一致する。
+    // EN: Convert image data with linear layout into the internal format (getConvertedDataFormat()).
+    //     Processes row bands in parallel on the shared thread pool.
+    //     Each pixel is converted independently, so the result is bit-identical regardless of the band split.
+    void convertLinearImageData(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                DataFormat dataFormat, SpectrumType spectrumType, ColorSpace colorSpace,
+                                uint8_t* dstData);
+
+    // JP: リニアなレイアウトの画像データをブロック圧縮エンコーダーの入力形式に変換する。
+    //     BC7向けはRGBA8x4(ガンマのまま)、BC6H向けはRGBA16Fx4(degammaが真ならデガンマ済み)。
+    // EN: Convert image data with linear layout into the input format of the block compression encoder.
+    //     RGBA8x4 (stays gamma-encoded) for BC7 and RGBA16Fx4 (degamma'd when degamma is true) for BC6H.
+    void convertLinearImageDataForEncoding(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                           DataFormat dataFormat, bool degamma,
+                                           uint8_t* dstData);
+}
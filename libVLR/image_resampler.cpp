@@ -0,0 +1,501 @@
+#include "image_resampler.h"
+#include "image_simd.h"
+#include "thread_pool.h"
+
+namespace vlr {
+    // ----------------------------------------------------------------
+    // JP: 各ピクセル形式とフィルタリング用のfloatチャンネル列との変換。
+    // EN: Conversion between each pixel format and float channels for filtering.
+
+    static inline float decodeUNorm8(uint8_t v) {
+        return v / 255.0f;
+    }
+
+    static inline uint8_t encodeUNorm8(float v) {
+        return static_cast<uint8_t>(clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    static inline uint8_t encodeUNorm8_sRGB(float v) {
+        return encodeUNorm8(sRGB_gamma(clamp(v, 0.0f, 1.0f)));
+    }
+
+    template <typename PixelType>
+    struct PixelCodec;
+
+    template <>
+    struct PixelCodec<RGB8x3> {
+        static constexpr uint32_t NumChannels = 3;
+        static constexpr bool NonNegative = true;
+        static void decode(const RGB8x3 &src, const float* table, float* dst) {
+            dst[0] = table[src.r];
+            dst[1] = table[src.g];
+            dst[2] = table[src.b];
+        }
+        static void encode(const float* src, bool sRGB, RGB8x3 &dst) {
+            auto enc = sRGB ? encodeUNorm8_sRGB : encodeUNorm8;
+            dst.r = enc(src[0]);
+            dst.g = enc(src[1]);
+            dst.b = enc(src[2]);
+        }
+    };
+
+    template <>
+    struct PixelCodec<RGB_8x4> {
+        static constexpr uint32_t NumChannels = 3;
+        static constexpr bool NonNegative = true;
+        static void decode(const RGB_8x4 &src, const float* table, float* dst) {
+            dst[0] = table[src.r];
+            dst[1] = table[src.g];
+            dst[2] = table[src.b];
+        }
+        static void encode(const float* src, bool sRGB, RGB_8x4 &dst) {
+            auto enc = sRGB ? encodeUNorm8_sRGB : encodeUNorm8;
+            dst.r = enc(src[0]);
+            dst.g = enc(src[1]);
+            dst.b = enc(src[2]);
+            dst.dummy = 255;
+        }
+    };
+
+    template <>
+    struct PixelCodec<RGBA8x4> {
+        static constexpr uint32_t NumChannels = 4;
+        static constexpr bool NonNegative = true;
+        static void decode(const RGBA8x4 &src, const float* table, float* dst) {
+            dst[0] = table[src.r];
+            dst[1] = table[src.g];
+            dst[2] = table[src.b];
+            dst[3] = decodeUNorm8(src.a);
+        }
+        static void encode(const float* src, bool sRGB, RGBA8x4 &dst) {
+            auto enc = sRGB ? encodeUNorm8_sRGB : encodeUNorm8;
+            dst.r = enc(src[0]);
+            dst.g = enc(src[1]);
+            dst.b = enc(src[2]);
+            dst.a = encodeUNorm8(src[3]);
+        }
+    };
+
+    template <>
+    struct PixelCodec<RGBA16Fx4> {
+        static constexpr uint32_t NumChannels = 4;
+        static constexpr bool NonNegative = true;
+        static void decode(const RGBA16Fx4 &src, const float* table, float* dst) {
+            dst[0] = src.r;
+            dst[1] = src.g;
+            dst[2] = src.b;
+            dst[3] = src.a;
+        }
+        static void encode(const float* src, bool sRGB, RGBA16Fx4 &dst) {
+            dst.r = static_cast<half>(src[0]);
+            dst.g = static_cast<half>(src[1]);
+            dst.b = static_cast<half>(src[2]);
+            dst.a = static_cast<half>(src[3]);
+        }
+    };
+
+    template <>
+    struct PixelCodec<RGBA32Fx4> {
+        static constexpr uint32_t NumChannels = 4;
+        static constexpr bool NonNegative = true;
+        static void decode(const RGBA32Fx4 &src, const float* table, float* dst) {
+            dst[0] = src.r;
+            dst[1] = src.g;
+            dst[2] = src.b;
+            dst[3] = src.a;
+        }
+        static void encode(const float* src, bool sRGB, RGBA32Fx4 &dst) {
+            dst = RGBA32Fx4{ src[0], src[1], src[2], src[3] };
+        }
+    };
+
+    template <>
+    struct PixelCodec<RG32Fx2> {
+        static constexpr uint32_t NumChannels = 2;
+        static constexpr bool NonNegative = false;
+        static void decode(const RG32Fx2 &src, const float* table, float* dst) {
+            dst[0] = src.r;
+            dst[1] = src.g;
+        }
+        static void encode(const float* src, bool sRGB, RG32Fx2 &dst) {
+            dst = RG32Fx2{ src[0], src[1] };
+        }
+    };
+
+    template <>
+    struct PixelCodec<Gray32F> {
+        static constexpr uint32_t NumChannels = 1;
+        static constexpr bool NonNegative = false;
+        static void decode(const Gray32F &src, const float* table, float* dst) {
+            dst[0] = src.v;
+        }
+        static void encode(const float* src, bool sRGB, Gray32F &dst) {
+            dst.v = src[0];
+        }
+    };
+
+    template <>
+    struct PixelCodec<Gray8> {
+        static constexpr uint32_t NumChannels = 1;
+        static constexpr bool NonNegative = true;
+        static void decode(const Gray8 &src, const float* table, float* dst) {
+            dst[0] = table[src.v];
+        }
+        static void encode(const float* src, bool sRGB, Gray8 &dst) {
+            dst.v = sRGB ? encodeUNorm8_sRGB(src[0]) : encodeUNorm8(src[0]);
+        }
+    };
+
+    template <>
+    struct PixelCodec<GrayA8x2> {
+        static constexpr uint32_t NumChannels = 2;
+        static constexpr bool NonNegative = true;
+        static void decode(const GrayA8x2 &src, const float* table, float* dst) {
+            dst[0] = table[src.v];
+            dst[1] = decodeUNorm8(src.a);
+        }
+        static void encode(const float* src, bool sRGB, GrayA8x2 &dst) {
+            dst.v = sRGB ? encodeUNorm8_sRGB(src[0]) : encodeUNorm8(src[0]);
+            dst.a = encodeUNorm8(src[1]);
+        }
+    };
+
+    // JP: uvs形式のu, vは線形な量ではないため、XYZに戻してからフィルタリングする。
+    // EN: u, v of the uvs formats are not linear quantities, so filter them after converting back to XYZ.
+    static inline void uvb_to_XYZ(float u, float v, float b, float XYZ[3]) {
+        float uv[2] = { u, v };
+        float xy[2];
+        UpsampledSpectrum::uv_to_xy(uv, xy);
+        XYZ[0] = xy[0] * b;
+        XYZ[1] = xy[1] * b;
+        XYZ[2] = (1 - xy[0] - xy[1]) * b;
+    }
+
+    static inline void XYZ_to_uvb(const float XYZ[3], float uv[2], float* b) {
+        *b = XYZ[0] + XYZ[1] + XYZ[2];
+        float xy[2];
+        xy[0] = *b > 0.0f ? XYZ[0] / *b : (1.0f / 3.0f);
+        xy[1] = *b > 0.0f ? XYZ[1] / *b : (1.0f / 3.0f);
+        UpsampledSpectrum::xy_to_uv(xy, uv);
+    }
+
+    template <>
+    struct PixelCodec<uvsA8x4> {
+        static constexpr uint32_t NumChannels = 4;
+        static constexpr bool NonNegative = true;
+        static void decode(const uvsA8x4 &src, const float* table, float* dst) {
+            uvb_to_XYZ(decodeUNorm8(src.u) * UpsampledSpectrum::GridWidth(),
+                       decodeUNorm8(src.v) * UpsampledSpectrum::GridHeight(),
+                       decodeUNorm8(src.s) * 3.0f, dst);
+            dst[3] = decodeUNorm8(src.a);
+        }
+        static void encode(const float* src, bool sRGB, uvsA8x4 &dst) {
+            float uv[2], b;
+            XYZ_to_uvb(src, uv, &b);
+            dst.u = encodeUNorm8(uv[0] / UpsampledSpectrum::GridWidth());
+            dst.v = encodeUNorm8(uv[1] / UpsampledSpectrum::GridHeight());
+            dst.s = encodeUNorm8(b / 3.0f);
+            dst.a = encodeUNorm8(src[3]);
+        }
+    };
+
+    template <>
+    struct PixelCodec<uvsA16Fx4> {
+        static constexpr uint32_t NumChannels = 4;
+        static constexpr bool NonNegative = true;
+        static void decode(const uvsA16Fx4 &src, const float* table, float* dst) {
+            uvb_to_XYZ(src.u, src.v, src.s, dst);
+            dst[3] = src.a;
+        }
+        static void encode(const float* src, bool sRGB, uvsA16Fx4 &dst) {
+            float uv[2], b;
+            XYZ_to_uvb(src, uv, &b);
+            dst.u = static_cast<half>(uv[0]);
+            dst.v = static_cast<half>(uv[1]);
+            dst.s = static_cast<half>(b);
+            dst.a = static_cast<half>(src[3]);
+        }
+    };
+
+    // END: Conversion between each pixel format and float channels for filtering.
+    // ----------------------------------------------------------------
+
+
+
+    // ----------------------------------------------------------------
+    // JP: 1軸分のフィルター係数。出力ピクセルごとに開始位置と正規化済みの重みを保持する。
+    //     画像端はクランプし、範囲外のタップは端のピクセルに畳み込む。
+    // EN: Filter coefficients for one axis. Holds the start position and normalized weights for each output pixel.
+    //     Clamps at the image border, folding out-of-range taps into the edge pixel.
+
+    struct FilterTaps {
+        std::vector<uint32_t> starts;
+        std::vector<float> weights;
+        uint32_t numTaps;
+    };
+
+    static float evaluateFilter(ResamplingFilter filter, float t) {
+        t = std::fabs(t);
+        switch (filter) {
+        case ResamplingFilter::Tent:
+            return std::max(1.0f - t, 0.0f);
+        case ResamplingFilter::Lanczos3: {
+            if (t >= 3.0f)
+                return 0.0f;
+            if (t < 1e-6f)
+                return 1.0f;
+            float pt = VLR_M_PI * t;
+            return 3.0f * std::sin(pt) * std::sin(pt / 3.0f) / (pt * pt);
+        }
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            return 0.0f;
+        }
+    }
+
+    static FilterTaps computeFilterTaps(uint32_t srcSize, uint32_t dstSize, ResamplingFilter filter) {
+        float scale = static_cast<float>(srcSize) / dstSize;
+        float filterScale = std::max(scale, 1.0f);
+        float radius;
+        switch (filter) {
+        case ResamplingFilter::Box:
+            radius = 0.5f * filterScale;
+            break;
+        case ResamplingFilter::Tent:
+            radius = filterScale;
+            break;
+        case ResamplingFilter::Lanczos3:
+            radius = 3.0f * filterScale;
+            break;
+        default:
+            VLRAssert_ShouldNotBeCalled();
+            radius = 0.0f;
+            break;
+        }
+
+        FilterTaps taps;
+        taps.numTaps = std::min(static_cast<uint32_t>(std::ceil(2 * radius)) + 1, srcSize);
+        taps.starts.resize(dstSize);
+        taps.weights.resize(static_cast<size_t>(dstSize) * taps.numTaps, 0.0f);
+
+        for (uint32_t i = 0; i < dstSize; ++i) {
+            float center = (i + 0.5f) * scale;
+            int32_t first = static_cast<int32_t>(std::floor(center - radius));
+            int32_t last = static_cast<int32_t>(std::ceil(center + radius));
+            int32_t start = clamp<int32_t>(first, 0, static_cast<int32_t>(srcSize - taps.numTaps));
+            taps.starts[i] = start;
+
+            float* weights = &taps.weights[static_cast<size_t>(i) * taps.numTaps];
+            float sumWeight = 0.0f;
+            for (int32_t j = first; j <= last; ++j) {
+                float weight;
+                if (filter == ResamplingFilter::Box) {
+                    // JP: ボックスはピクセルとフットプリントの重なり面積を重みとする。
+                    // EN: Box uses the overlap between the pixel and the footprint as the weight.
+                    weight = std::max(std::min(j + 1.0f, center + radius) - std::max<float>(j, center - radius), 0.0f);
+                }
+                else {
+                    weight = evaluateFilter(filter, (j + 0.5f - center) / filterScale);
+                }
+                if (weight == 0.0f)
+                    continue;
+                int32_t idx = clamp<int32_t>(j, 0, static_cast<int32_t>(srcSize) - 1) - start;
+                // JP: 縮小率が大きいとクランプ後のタップが範囲に収まらない場合があるので丸め込む。
+                // EN: Taps may fall outside the range after clamping with a large ratio, fold them in.
+                idx = clamp<int32_t>(idx, 0, static_cast<int32_t>(taps.numTaps) - 1);
+                weights[idx] += weight;
+                sumWeight += weight;
+            }
+            VLRAssert(sumWeight != 0.0f, "Filter weights sum up to zero.");
+            for (uint32_t k = 0; k < taps.numTaps; ++k)
+                weights[k] /= sumWeight;
+        }
+
+        return taps;
+    }
+
+    // END: Filter coefficients for one axis.
+    // ----------------------------------------------------------------
+
+
+
+    // JP: 水平パスの内側ループ。4チャンネルの場合はSSEでピクセル単位にまとめて積和する。
+    // EN: Inner loop of the horizontal pass. Multiply-accumulates a whole pixel with SSE for 4 channels.
+    template <uint32_t NumChannels>
+    static inline void filterHorizontally(const float* srcRow, const FilterTaps &taps, uint32_t dstWidth, float* dstRow) {
+        for (uint32_t x = 0; x < dstWidth; ++x) {
+            const float* src = srcRow + static_cast<size_t>(taps.starts[x]) * NumChannels;
+            const float* weights = &taps.weights[static_cast<size_t>(x) * taps.numTaps];
+            float* dst = dstRow + static_cast<size_t>(x) * NumChannels;
+            if constexpr (NumChannels == 4) {
+                __m128 sum = _mm_setzero_ps();
+                for (uint32_t k = 0; k < taps.numTaps; ++k)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(src + 4 * k)));
+                _mm_storeu_ps(dst, sum);
+            }
+            else {
+                float sum[NumChannels] = {};
+                for (uint32_t k = 0; k < taps.numTaps; ++k) {
+                    for (uint32_t c = 0; c < NumChannels; ++c)
+                        sum[c] += weights[k] * src[NumChannels * k + c];
+                }
+                for (uint32_t c = 0; c < NumChannels; ++c)
+                    dst[c] = sum[c];
+            }
+        }
+    }
+
+    static constexpr uint32_t MinNumPixelsPerChunk = 65536;
+
+    template <typename PixelType>
+    static void resampleLinearImageData(const PixelType* srcData, uint32_t srcWidth, uint32_t srcHeight,
+                                        PixelType* dstData, uint32_t dstWidth, uint32_t dstHeight,
+                                        bool sRGBEncoded, ResamplingFilter filter) {
+        using Codec = PixelCodec<PixelType>;
+        constexpr uint32_t NumChannels = Codec::NumChannels;
+
+        const float* table = getUNorm8ToFloatTable(sRGBEncoded);
+        FilterTaps tapsX = computeFilterTaps(srcWidth, dstWidth, filter);
+        FilterTaps tapsY = computeFilterTaps(srcHeight, dstHeight, filter);
+
+        ThreadPool &threadPool = ThreadPool::getShared();
+        const size_t dstRowSize = static_cast<size_t>(dstWidth) * NumChannels;
+
+        // JP: 水平パス: 入力の各行をデコードしてから横方向にフィルタリングする。
+        // EN: Horizontal pass: decode each input row then filter horizontally.
+        std::vector<float> intermediate(dstRowSize * srcHeight);
+        threadPool.parallelFor(
+            0, srcHeight, std::max<uint32_t>(MinNumPixelsPerChunk / srcWidth, 1),
+            [&](uint32_t yBegin, uint32_t yEnd) {
+            std::vector<float> decodedRow(static_cast<size_t>(srcWidth) * NumChannels);
+            for (uint32_t y = yBegin; y < yEnd; ++y) {
+                const PixelType* srcRow = srcData + static_cast<size_t>(srcWidth) * y;
+                for (uint32_t x = 0; x < srcWidth; ++x)
+                    Codec::decode(srcRow[x], table, &decodedRow[static_cast<size_t>(x) * NumChannels]);
+                filterHorizontally<NumChannels>(decodedRow.data(), tapsX, dstWidth, &intermediate[dstRowSize * y]);
+            }
+        });
+
+        // JP: 垂直パス: 行全体への積和(ベクトル化しやすい)を重ねてからエンコードする。
+        // EN: Vertical pass: accumulate whole rows (vectorization friendly) then encode.
+        threadPool.parallelFor(
+            0, dstHeight, std::max<uint32_t>(MinNumPixelsPerChunk / dstWidth, 1),
+            [&](uint32_t yBegin, uint32_t yEnd) {
+            std::vector<float> accumRow(dstRowSize);
+            for (uint32_t y = yBegin; y < yEnd; ++y) {
+                std::fill(accumRow.begin(), accumRow.end(), 0.0f);
+                float* __restrict accum = accumRow.data();
+                const float* weights = &tapsY.weights[static_cast<size_t>(y) * tapsY.numTaps];
+                for (uint32_t k = 0; k < tapsY.numTaps; ++k) {
+                    float weight = weights[k];
+                    if (weight == 0.0f)
+                        continue;
+                    const float* __restrict srcRow = &intermediate[dstRowSize * (tapsY.starts[y] + k)];
+                    for (size_t i = 0; i < dstRowSize; ++i)
+                        accum[i] += weight * srcRow[i];
+                }
+
+                PixelType* dstRow = dstData + static_cast<size_t>(dstWidth) * y;
+                for (uint32_t x = 0; x < dstWidth; ++x) {
+                    float* pix = accum + static_cast<size_t>(x) * NumChannels;
+                    // JP: Lanczosの負のローブによる負値を除く。
+                    // EN: Remove negative values caused by the negative lobes of Lanczos.
+                    if constexpr (Codec::NonNegative) {
+                        for (uint32_t c = 0; c < NumChannels; ++c)
+                            pix[c] = std::max(pix[c], 0.0f);
+                    }
+                    Codec::encode(pix, sRGBEncoded, dstRow[x]);
+                }
+            }
+        });
+    }
+
+    void resampleLinearImageData(const uint8_t* srcData, uint32_t srcWidth, uint32_t srcHeight,
+                                 uint8_t* dstData, uint32_t dstWidth, uint32_t dstHeight,
+                                 DataFormat dataFormat, bool sRGBEncoded, ResamplingFilter filter) {
+        VLRAssert(srcWidth > 0 && srcHeight > 0 && dstWidth > 0 && dstHeight > 0, "Image size must be non-zero.");
+
+#define VLR_TEMP_EXPR0(format, PixelType) \
+    case format: \
+        resampleLinearImageData<PixelType>( \
+            reinterpret_cast<const PixelType*>(srcData), srcWidth, srcHeight, \
+            reinterpret_cast<PixelType*>(dstData), dstWidth, dstHeight, \
+            sRGBEncoded, filter); \
+        break
+
+        switch (dataFormat) {
+            VLR_TEMP_EXPR0(DataFormat::RGB8x3, RGB8x3);
+            VLR_TEMP_EXPR0(DataFormat::RGB_8x4, RGB_8x4);
+            VLR_TEMP_EXPR0(DataFormat::RGBA8x4, RGBA8x4);
+            VLR_TEMP_EXPR0(DataFormat::RGBA16Fx4, RGBA16Fx4);
+            VLR_TEMP_EXPR0(DataFormat::RGBA32Fx4, RGBA32Fx4);
+            VLR_TEMP_EXPR0(DataFormat::RG32Fx2, RG32Fx2);
+            VLR_TEMP_EXPR0(DataFormat::Gray32F, Gray32F);
+            VLR_TEMP_EXPR0(DataFormat::Gray8, Gray8);
+            VLR_TEMP_EXPR0(DataFormat::GrayA8x2, GrayA8x2);
+            VLR_TEMP_EXPR0(DataFormat::uvsA8x4, uvsA8x4);
+            VLR_TEMP_EXPR0(DataFormat::uvsA16Fx4, uvsA16Fx4);
+        default:
+            VLRAssert(false, "Data format is not a linear format.");
+            break;
+        }
+
+#undef VLR_TEMP_EXPR0
+    }
+
+
+
+    template <typename PixelType>
+    static void computeLinearImageLuminance(const PixelType* srcData, uint32_t width, uint32_t height,
+                                            bool sRGBEncoded, float* dstData) {
+        using Codec = PixelCodec<PixelType>;
+
+        const float* table = getUNorm8ToFloatTable(sRGBEncoded);
+        ThreadPool::getShared().parallelFor(
+            0, height, std::max<uint32_t>(MinNumPixelsPerChunk / width, 1),
+            [&](uint32_t yBegin, uint32_t yEnd) {
+            for (size_t i = static_cast<size_t>(width) * yBegin; i < static_cast<size_t>(width) * yEnd; ++i) {
+                float values[4] = {};
+                Codec::decode(srcData[i], table, values);
+                if constexpr (std::is_same_v<PixelType, uvsA8x4> || std::is_same_v<PixelType, uvsA16Fx4>)
+                    dstData[i] = values[1];
+                else if constexpr (std::is_same_v<PixelType, Gray32F> || std::is_same_v<PixelType, Gray8> ||
+                                   std::is_same_v<PixelType, GrayA8x2>)
+                    dstData[i] = values[0];
+                else
+                    dstData[i] = mat_Rec709_D65_to_XYZ[1] * values[0] + mat_Rec709_D65_to_XYZ[4] * values[1] +
+                                 mat_Rec709_D65_to_XYZ[7] * values[2];
+            }
+        });
+    }
+
+    void computeLinearImageLuminance(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                     DataFormat dataFormat, bool sRGBEncoded, float* dstData) {
+        VLRAssert(width > 0 && height > 0, "Image size must be non-zero.");
+
+#define VLR_TEMP_EXPR0(format, PixelType) \
+    case format: \
+        computeLinearImageLuminance<PixelType>( \
+            reinterpret_cast<const PixelType*>(srcData), width, height, sRGBEncoded, dstData); \
+        break
+
+        switch (dataFormat) {
+            VLR_TEMP_EXPR0(DataFormat::RGB8x3, RGB8x3);
+            VLR_TEMP_EXPR0(DataFormat::RGB_8x4, RGB_8x4);
+            VLR_TEMP_EXPR0(DataFormat::RGBA8x4, RGBA8x4);
+            VLR_TEMP_EXPR0(DataFormat::RGBA16Fx4, RGBA16Fx4);
+            VLR_TEMP_EXPR0(DataFormat::RGBA32Fx4, RGBA32Fx4);
+            VLR_TEMP_EXPR0(DataFormat::RG32Fx2, RG32Fx2);
+            VLR_TEMP_EXPR0(DataFormat::Gray32F, Gray32F);
+            VLR_TEMP_EXPR0(DataFormat::Gray8, Gray8);
+            VLR_TEMP_EXPR0(DataFormat::GrayA8x2, GrayA8x2);
+            VLR_TEMP_EXPR0(DataFormat::uvsA8x4, uvsA8x4);
+            VLR_TEMP_EXPR0(DataFormat::uvsA16Fx4, uvsA16Fx4);
+        default:
+            VLRAssert(false, "Data format is not a linear format.");
+            break;
+        }
+
+#undef VLR_TEMP_EXPR0
+    }
+}
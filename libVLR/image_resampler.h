@@ -0,0 +1,25 @@
+#pragma once
+
+#include "image.h"
+
+namespace vlr {
+    // JP: リニアなレイアウトの画像データを別の解像度にリサンプリングする。
+    //     水平・垂直の分離可能な2パスで、共有スレッドプール上で並列に処理する。
+    //     sRGBEncodedが真の場合(ハードウェアデガンマ前提の8bitデータ)はリニア空間でフィルタリングしてから再エンコードする。
+    //     uvs形式はXYZに戻してからフィルタリングする。
+    // EN: Resample image data with linear layout into another resolution.
+    //     Processes in separable horizontal and vertical passes in parallel on the shared thread pool.
+    //     When sRGBEncoded is true (8-bit data relying on hardware degamma),
+    //     filtering happens in linear space and the result is re-encoded.
+    //     The uvs formats are filtered after converting back to XYZ.
+    void resampleLinearImageData(const uint8_t* srcData, uint32_t srcWidth, uint32_t srcHeight,
+                                 uint8_t* dstData, uint32_t dstWidth, uint32_t dstHeight,
+                                 DataFormat dataFormat, bool sRGBEncoded, ResamplingFilter filter);
+
+    // JP: リニアなレイアウトの画像データの輝度(XYZのY)を計算する。
+    //     RGB形式はRec.709 D65、2チャンネル形式は(r, g, 0)、グレー形式は値そのものを輝度とみなす。
+    // EN: Compute the luminance (Y of XYZ) of image data with linear layout.
+    //     RGB formats are regarded as Rec.709 D65, two-channel formats as (r, g, 0) and gray formats as the luminance itself.
+    void computeLinearImageLuminance(const uint8_t* srcData, uint32_t width, uint32_t height,
+                                     DataFormat dataFormat, bool sRGBEncoded, float* dstData);
+}
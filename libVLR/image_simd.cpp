@@ -0,0 +1,365 @@
+#include "image_simd.h"
+
+#include <atomic>
+
+#if defined(VLR_Platform_Windows_MSVC)
+#   include <intrin.h>
+#   define VLR_TARGET_SSE4_1
+#   define VLR_TARGET_AVX2_F16C
+#else
+#   include <cpuid.h>
+#   define VLR_TARGET_SSE4_1 __attribute__((target("sse4.1")))
+#   define VLR_TARGET_AVX2_F16C __attribute__((target("avx2,f16c")))
+#endif
+
+namespace vlr {
+    static void cpuid(uint32_t leaf, uint32_t subLeaf, uint32_t regs[4]) {
+#if defined(VLR_Platform_Windows_MSVC)
+        int iregs[4];
+        __cpuidex(iregs, static_cast<int>(leaf), static_cast<int>(subLeaf));
+        for (int i = 0; i < 4; ++i)
+            regs[i] = static_cast<uint32_t>(iregs[i]);
+#else
+        __cpuid_count(leaf, subLeaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    static uint64_t xgetbv0() {
+#if defined(VLR_Platform_Windows_MSVC)
+        return _xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+    }
+
+    static SIMDInstructionSet detectSIMDInstructionSet() {
+        uint32_t regs[4];
+        cpuid(0, 0, regs);
+        uint32_t maxLeaf = regs[0];
+        if (maxLeaf < 1)
+            return SIMDInstructionSet::Scalar;
+
+        cpuid(1, 0, regs);
+        bool hasSSE4_1 = (regs[2] >> 19) & 0x1;
+        bool hasF16C = (regs[2] >> 29) & 0x1;
+        bool hasAVX = (regs[2] >> 28) & 0x1;
+        bool hasOSXSAVE = (regs[2] >> 27) & 0x1;
+
+        bool hasAVX2 = false;
+        if (maxLeaf >= 7) {
+            cpuid(7, 0, regs);
+            hasAVX2 = (regs[1] >> 5) & 0x1;
+        }
+
+        // JP: OSがYMMレジスターの状態を保存するかも確認する。
+        // EN: Also check that the OS saves the YMM register state.
+        bool osSupportsYMM = hasOSXSAVE && (xgetbv0() & 0x6) == 0x6;
+
+        if (hasAVX && hasAVX2 && hasF16C && osSupportsYMM)
+            return SIMDInstructionSet::AVX2_F16C;
+        if (hasSSE4_1)
+            return SIMDInstructionSet::SSE4_1;
+        return SIMDInstructionSet::Scalar;
+    }
+
+    SIMDInstructionSet getSupportedSIMDInstructionSet() {
+        static const SIMDInstructionSet s_instSet = detectSIMDInstructionSet();
+        return s_instSet;
+    }
+
+    static std::atomic<SIMDInstructionSet> s_maxInstSet(SIMDInstructionSet::AVX2_F16C);
+
+    void setMaxSIMDInstructionSet(SIMDInstructionSet maxInstSet) {
+        s_maxInstSet.store(maxInstSet, std::memory_order_relaxed);
+    }
+
+    static SIMDInstructionSet getActiveSIMDInstructionSet() {
+        SIMDInstructionSet supported = getSupportedSIMDInstructionSet();
+        SIMDInstructionSet maxInstSet = s_maxInstSet.load(std::memory_order_relaxed);
+        return static_cast<uint32_t>(maxInstSet) < static_cast<uint32_t>(supported) ? maxInstSet : supported;
+    }
+
+
+
+    struct UNorm8ToFloatTables {
+        float linear[256];
+        float degamma[256];
+
+        UNorm8ToFloatTables() {
+            for (int i = 0; i < 256; ++i) {
+                linear[i] = i / 255.0f;
+                degamma[i] = sRGB_degamma(i / 255.0f);
+            }
+        }
+    };
+
+    const float* getUNorm8ToFloatTable(bool enableDegamma) {
+        static const UNorm8ToFloatTables s_tables;
+        return enableDegamma ? s_tables.degamma : s_tables.linear;
+    }
+
+
+
+    // JP: UpsampledSpectrum::xy_to_uv()の係数。
+    // EN: Coefficients of UpsampledSpectrum::xy_to_uv().
+    static constexpr float xy_to_u[] = { 16.730260708356887f, 7.7801960340706f, -2.170152247475828f };
+    static constexpr float xy_to_v[] = { -7.530081094743006f, 16.192422314095225f, 1.1125529268825947f };
+
+    // JP: スカラー版。image.cppのperPixelFunc()と同一の計算。
+    // EN: Scalar version. Identical computation to perPixelFunc() in image.cpp.
+    static inline void encodeLinearRGBToUVS_scalar(const float mat[9], float R, float G, float B,
+                                                   float* u, float* v, float* b) {
+        float RGB[] = { R, G, B };
+        float XYZ[3];
+        transformTristimulus(mat, RGB, XYZ);
+
+        *b = XYZ[0] + XYZ[1] + XYZ[2];
+        float xy[2];
+        xy[0] = *b > 0.0f ? XYZ[0] / *b : (1.0f / 3.0f);
+        xy[1] = *b > 0.0f ? XYZ[1] / *b : (1.0f / 3.0f);
+
+        float uv[2];
+        UpsampledSpectrum::xy_to_uv(xy, uv);
+        *u = uv[0];
+        *v = uv[1];
+    }
+
+    static inline void encodeLinearRGBToUVS8_scalar(const float mat[9], float R, float G, float B, uvsA8x4* dst) {
+        float u, v, b;
+        encodeLinearRGBToUVS_scalar(mat, R, G, B, &u, &v, &b);
+        dst->u = static_cast<uint8_t>(255 * clamp<float>(u / UpsampledSpectrum::GridWidth(), 0, 1));
+        dst->v = static_cast<uint8_t>(255 * clamp<float>(v / UpsampledSpectrum::GridHeight(), 0, 1));
+        dst->s = static_cast<uint8_t>(255 * clamp<float>(b / 3.0f, 0, 1));
+    }
+
+    static inline void encodeLinearRGBToUVS16F_scalar(const float mat[9], float R, float G, float B, uvsA16Fx4* dst) {
+        float u, v, b;
+        encodeLinearRGBToUVS_scalar(mat, R, G, B, &u, &v, &b);
+        dst->u = static_cast<half>(u);
+        dst->v = static_cast<half>(v);
+        dst->s = static_cast<half>(b);
+    }
+
+
+
+    // JP: SIMD版は FMA を使わず、スカラー版と同じ順序で乗算・加算・除算を行うため結果が一致する。
+    //     (half変換はhalf.hppの既定と同じ切り捨て丸め(オーバーフローはInf)を使用する。)
+    // EN: The SIMD versions don't use FMA and apply multiplications, additions and divisions in the same order as
+    //     the scalar version, so the results match.
+    //     (Half conversion uses truncation with overflow to Inf, the same as the half.hpp default.)
+
+    struct UVS_SSE {
+        __m128 u, v, b;
+    };
+
+    VLR_TARGET_SSE4_1 static inline UVS_SSE encodeLinearRGBToUVS_SSE(const float mat[9], __m128 R, __m128 G, __m128 B) {
+        __m128 X = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(mat[0]), R), _mm_mul_ps(_mm_set1_ps(mat[3]), G)),
+                              _mm_mul_ps(_mm_set1_ps(mat[6]), B));
+        __m128 Y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(mat[1]), R), _mm_mul_ps(_mm_set1_ps(mat[4]), G)),
+                              _mm_mul_ps(_mm_set1_ps(mat[7]), B));
+        __m128 Z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(mat[2]), R), _mm_mul_ps(_mm_set1_ps(mat[5]), G)),
+                              _mm_mul_ps(_mm_set1_ps(mat[8]), B));
+
+        UVS_SSE ret;
+        ret.b = _mm_add_ps(_mm_add_ps(X, Y), Z);
+        __m128 positive = _mm_cmpgt_ps(ret.b, _mm_setzero_ps());
+        __m128 oneThird = _mm_set1_ps(1.0f / 3.0f);
+        __m128 x = _mm_blendv_ps(oneThird, _mm_div_ps(X, ret.b), positive);
+        __m128 y = _mm_blendv_ps(oneThird, _mm_div_ps(Y, ret.b), positive);
+
+        ret.u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(xy_to_u[0]), x), _mm_mul_ps(_mm_set1_ps(xy_to_u[1]), y)),
+                           _mm_set1_ps(xy_to_u[2]));
+        ret.v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(xy_to_v[0]), x), _mm_mul_ps(_mm_set1_ps(xy_to_v[1]), y)),
+                           _mm_set1_ps(xy_to_v[2]));
+
+        return ret;
+    }
+
+    VLR_TARGET_SSE4_1 static inline __m128i quantizeUNorm8_SSE(__m128 value, float divisor) {
+        __m128 t = _mm_div_ps(value, _mm_set1_ps(divisor));
+        t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        return _mm_cvttps_epi32(_mm_mul_ps(_mm_set1_ps(255.0f), t));
+    }
+
+    VLR_TARGET_SSE4_1 static void encodeLinearRGBToUVS8_SSE4_1(const float mat[9],
+                                                                 const float* R, const float* G, const float* B, uint32_t numPixels,
+                                                                 uvsA8x4* dst) {
+        uint32_t i = 0;
+        for (; i + 4 <= numPixels; i += 4) {
+            UVS_SSE uvs = encodeLinearRGBToUVS_SSE(mat, _mm_loadu_ps(R + i), _mm_loadu_ps(G + i), _mm_loadu_ps(B + i));
+            __m128i u = quantizeUNorm8_SSE(uvs.u, static_cast<float>(UpsampledSpectrum::GridWidth()));
+            __m128i v = quantizeUNorm8_SSE(uvs.v, static_cast<float>(UpsampledSpectrum::GridHeight()));
+            __m128i s = quantizeUNorm8_SSE(uvs.b, 3.0f);
+
+            __m128i* dstPtr = reinterpret_cast<__m128i*>(dst + i);
+            __m128i alpha = _mm_and_si128(_mm_loadu_si128(dstPtr), _mm_set1_epi32(0xFF000000));
+            __m128i packed = _mm_or_si128(_mm_or_si128(u, _mm_slli_epi32(v, 8)), _mm_or_si128(_mm_slli_epi32(s, 16), alpha));
+            _mm_storeu_si128(dstPtr, packed);
+        }
+        for (; i < numPixels; ++i)
+            encodeLinearRGBToUVS8_scalar(mat, R[i], G[i], B[i], dst + i);
+    }
+
+    VLR_TARGET_SSE4_1 static void encodeLinearRGBToUVS16F_SSE4_1(const float mat[9],
+                                                                   const float* R, const float* G, const float* B, uint32_t numPixels,
+                                                                   uvsA16Fx4* dst) {
+        uint32_t i = 0;
+        for (; i + 4 <= numPixels; i += 4) {
+            UVS_SSE uvs = encodeLinearRGBToUVS_SSE(mat, _mm_loadu_ps(R + i), _mm_loadu_ps(G + i), _mm_loadu_ps(B + i));
+            alignas(16) float u[4], v[4], b[4];
+            _mm_store_ps(u, uvs.u);
+            _mm_store_ps(v, uvs.v);
+            _mm_store_ps(b, uvs.b);
+            for (int j = 0; j < 4; ++j) {
+                uvsA16Fx4 &d = dst[i + j];
+                d.u = static_cast<half>(u[j]);
+                d.v = static_cast<half>(v[j]);
+                d.s = static_cast<half>(b[j]);
+            }
+        }
+        for (; i < numPixels; ++i)
+            encodeLinearRGBToUVS16F_scalar(mat, R[i], G[i], B[i], dst + i);
+    }
+
+
+
+    struct UVS_AVX {
+        __m256 u, v, b;
+    };
+
+    VLR_TARGET_AVX2_F16C static inline UVS_AVX encodeLinearRGBToUVS_AVX2(const float mat[9], __m256 R, __m256 G, __m256 B) {
+        __m256 X = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(mat[0]), R), _mm256_mul_ps(_mm256_set1_ps(mat[3]), G)),
+                                 _mm256_mul_ps(_mm256_set1_ps(mat[6]), B));
+        __m256 Y = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(mat[1]), R), _mm256_mul_ps(_mm256_set1_ps(mat[4]), G)),
+                                 _mm256_mul_ps(_mm256_set1_ps(mat[7]), B));
+        __m256 Z = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(mat[2]), R), _mm256_mul_ps(_mm256_set1_ps(mat[5]), G)),
+                                 _mm256_mul_ps(_mm256_set1_ps(mat[8]), B));
+
+        UVS_AVX ret;
+        ret.b = _mm256_add_ps(_mm256_add_ps(X, Y), Z);
+        __m256 positive = _mm256_cmp_ps(ret.b, _mm256_setzero_ps(), _CMP_GT_OQ);
+        __m256 oneThird = _mm256_set1_ps(1.0f / 3.0f);
+        __m256 x = _mm256_blendv_ps(oneThird, _mm256_div_ps(X, ret.b), positive);
+        __m256 y = _mm256_blendv_ps(oneThird, _mm256_div_ps(Y, ret.b), positive);
+
+        ret.u = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(xy_to_u[0]), x), _mm256_mul_ps(_mm256_set1_ps(xy_to_u[1]), y)),
+                              _mm256_set1_ps(xy_to_u[2]));
+        ret.v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(xy_to_v[0]), x), _mm256_mul_ps(_mm256_set1_ps(xy_to_v[1]), y)),
+                              _mm256_set1_ps(xy_to_v[2]));
+
+        return ret;
+    }
+
+    VLR_TARGET_AVX2_F16C static inline __m256i quantizeUNorm8_AVX2(__m256 value, float divisor) {
+        __m256 t = _mm256_div_ps(value, _mm256_set1_ps(divisor));
+        t = _mm256_min_ps(_mm256_max_ps(t, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        return _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_set1_ps(255.0f), t));
+    }
+
+    // JP: F16Cの切り捨て丸めはオーバーフロー時に最大値になるため、half.hppに合わせてInfに置き換える。
+    // EN: F16C truncation saturates to the max finite value on overflow, so replace it with Inf to match half.hpp.
+    VLR_TARGET_AVX2_F16C static inline __m128i convertToHalfTruncated_AVX2(__m256 value) {
+        __m128i h = _mm256_cvtps_ph(value, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        __m256 absValue = _mm256_and_ps(value, _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+        __m256i overflow = _mm256_castps_si256(_mm256_cmp_ps(absValue, _mm256_set1_ps(65536.0f), _CMP_GE_OQ));
+        __m128i overflow16 = _mm_packs_epi32(_mm256_castsi256_si128(overflow), _mm256_extracti128_si256(overflow, 1));
+        __m128i inf = _mm_or_si128(_mm_and_si128(h, _mm_set1_epi16(static_cast<int16_t>(0x8000))), _mm_set1_epi16(0x7C00));
+        return _mm_blendv_epi8(h, inf, overflow16);
+    }
+
+    VLR_TARGET_AVX2_F16C static void encodeLinearRGBToUVS8_AVX2(const float mat[9],
+                                                                 const float* R, const float* G, const float* B, uint32_t numPixels,
+                                                                 uvsA8x4* dst) {
+        uint32_t i = 0;
+        for (; i + 8 <= numPixels; i += 8) {
+            UVS_AVX uvs = encodeLinearRGBToUVS_AVX2(mat, _mm256_loadu_ps(R + i), _mm256_loadu_ps(G + i), _mm256_loadu_ps(B + i));
+            __m256i u = quantizeUNorm8_AVX2(uvs.u, static_cast<float>(UpsampledSpectrum::GridWidth()));
+            __m256i v = quantizeUNorm8_AVX2(uvs.v, static_cast<float>(UpsampledSpectrum::GridHeight()));
+            __m256i s = quantizeUNorm8_AVX2(uvs.b, 3.0f);
+
+            __m256i* dstPtr = reinterpret_cast<__m256i*>(dst + i);
+            __m256i alpha = _mm256_and_si256(_mm256_loadu_si256(dstPtr), _mm256_set1_epi32(0xFF000000));
+            __m256i packed = _mm256_or_si256(_mm256_or_si256(u, _mm256_slli_epi32(v, 8)),
+                                             _mm256_or_si256(_mm256_slli_epi32(s, 16), alpha));
+            _mm256_storeu_si256(dstPtr, packed);
+        }
+        for (; i < numPixels; ++i)
+            encodeLinearRGBToUVS8_scalar(mat, R[i], G[i], B[i], dst + i);
+    }
+
+    VLR_TARGET_AVX2_F16C static void encodeLinearRGBToUVS16F_AVX2(const float mat[9],
+                                                                   const float* R, const float* G, const float* B, uint32_t numPixels,
+                                                                   uvsA16Fx4* dst) {
+        static_assert(sizeof(uvsA16Fx4) == 8, "Unexpected uvsA16Fx4 layout.");
+        uint32_t i = 0;
+        for (; i + 8 <= numPixels; i += 8) {
+            UVS_AVX uvs = encodeLinearRGBToUVS_AVX2(mat, _mm256_loadu_ps(R + i), _mm256_loadu_ps(G + i), _mm256_loadu_ps(B + i));
+            __m128i u = convertToHalfTruncated_AVX2(uvs.u);
+            __m128i v = convertToHalfTruncated_AVX2(uvs.v);
+            __m128i s = convertToHalfTruncated_AVX2(uvs.b);
+
+            // JP: 既存のアルファを保持しつつ u, v, s, a の順にインターリーブする。
+            // EN: Interleave into u, v, s, a order while keeping the existing alpha.
+            __m128i* dstPtr = reinterpret_cast<__m128i*>(dst + i);
+            __m128i d01 = _mm_loadu_si128(dstPtr + 0);
+            __m128i d23 = _mm_loadu_si128(dstPtr + 1);
+            __m128i d45 = _mm_loadu_si128(dstPtr + 2);
+            __m128i d67 = _mm_loadu_si128(dstPtr + 3);
+            // a values are at 16-bit lanes 3 and 7 of each register.
+            __m128i a0123 = _mm_packus_epi32(_mm_srli_epi64(d01, 48), _mm_srli_epi64(d23, 48));
+            __m128i a4567 = _mm_packus_epi32(_mm_srli_epi64(d45, 48), _mm_srli_epi64(d67, 48));
+            // a0123: a0, 0, a1, 0, a2, 0, a3, 0 as 16-bit lanes -> compact to a0..a3 in low half.
+            __m128i alphaShuffle = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+            __m128i a = _mm_unpacklo_epi64(_mm_shuffle_epi8(a0123, alphaShuffle), _mm_shuffle_epi8(a4567, alphaShuffle));
+
+            __m128i uvLo = _mm_unpacklo_epi16(u, v);
+            __m128i uvHi = _mm_unpackhi_epi16(u, v);
+            __m128i saLo = _mm_unpacklo_epi16(s, a);
+            __m128i saHi = _mm_unpackhi_epi16(s, a);
+            _mm_storeu_si128(dstPtr + 0, _mm_unpacklo_epi32(uvLo, saLo));
+            _mm_storeu_si128(dstPtr + 1, _mm_unpackhi_epi32(uvLo, saLo));
+            _mm_storeu_si128(dstPtr + 2, _mm_unpacklo_epi32(uvHi, saHi));
+            _mm_storeu_si128(dstPtr + 3, _mm_unpackhi_epi32(uvHi, saHi));
+        }
+        for (; i < numPixels; ++i)
+            encodeLinearRGBToUVS16F_scalar(mat, R[i], G[i], B[i], dst + i);
+    }
+
+
+
+    void encodeLinearRGBToUVS(const float matRGB_to_XYZ[9],
+                              const float* R, const float* G, const float* B, uint32_t numPixels,
+                              uvsA8x4* dst) {
+        switch (getActiveSIMDInstructionSet()) {
+        case SIMDInstructionSet::AVX2_F16C:
+            encodeLinearRGBToUVS8_AVX2(matRGB_to_XYZ, R, G, B, numPixels, dst);
+            break;
+        case SIMDInstructionSet::SSE4_1:
+            encodeLinearRGBToUVS8_SSE4_1(matRGB_to_XYZ, R, G, B, numPixels, dst);
+            break;
+        default:
+            for (uint32_t i = 0; i < numPixels; ++i)
+                encodeLinearRGBToUVS8_scalar(matRGB_to_XYZ, R[i], G[i], B[i], dst + i);
+            break;
+        }
+    }
+
+    void encodeLinearRGBToUVS(const float matRGB_to_XYZ[9],
+                              const float* R, const float* G, const float* B, uint32_t numPixels,
+                              uvsA16Fx4* dst) {
+        switch (getActiveSIMDInstructionSet()) {
+        case SIMDInstructionSet::AVX2_F16C:
+            encodeLinearRGBToUVS16F_AVX2(matRGB_to_XYZ, R, G, B, numPixels, dst);
+            break;
+        case SIMDInstructionSet::SSE4_1:
+            encodeLinearRGBToUVS16F_SSE4_1(matRGB_to_XYZ, R, G, B, numPixels, dst);
+            break;
+        default:
+            for (uint32_t i = 0; i < numPixels; ++i)
+                encodeLinearRGBToUVS16F_scalar(matRGB_to_XYZ, R[i], G[i], B[i], dst + i);
+            break;
+        }
+    }
+}
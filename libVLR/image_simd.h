@@ -0,0 +1,39 @@
+#pragma once
+
+#include "image.h"
+
+namespace vlr {
+    enum class SIMDInstructionSet {
+        Scalar = 0,
+        SSE4_1,
+        AVX2_F16C,
+    };
+
+    // JP: 実行中のCPUがサポートする命令セットを返す。結果はキャッシュされる。
+    // EN: Returns the instruction set supported by the running CPU. The result is cached.
+    SIMDInstructionSet getSupportedSIMDInstructionSet();
+
+    // JP: 以降の変換で使う命令セットの上限を設定する。実行中のCPUがサポートしない命令セットは使われない。
+    //     各実装の結果をビット単位で比較するテスト用。
+    // EN: Set the upper limit of the instruction set used by subsequent conversions.
+    //     An instruction set that the running CPU doesn't support is never used.
+    //     Intended for tests comparing the results of the implementations bit for bit.
+    void setMaxSIMDInstructionSet(SIMDInstructionSet maxInstSet);
+
+    // JP: 8bit値 -> [0, 1]のfloat値への変換テーブル(256要素)。sRGBのデガンマ有り/無し。
+    //     perPixelFunc()の v / 255.0f, sRGB_degamma(v / 255.0f) と同じ値を保持する。
+    // EN: 8-bit value -> [0, 1] float conversion tables (256 entries), with or without sRGB degamma.
+    //     These hold the same values as v / 255.0f, sRGB_degamma(v / 255.0f) in perPixelFunc().
+    const float* getUNorm8ToFloatTable(bool enableDegamma);
+
+    // JP: リニアなRGB値(SoA)をuvs形式にまとめて変換する。
+    //     スカラー版のperPixelFunc()と同じ演算順序で計算する。アルファ値には触れない。
+    // EN: Batch-convert linear RGB values (SoA) into the uvs format.
+    //     Computes with the same operation order as the scalar perPixelFunc(). Alpha values are left untouched.
+    void encodeLinearRGBToUVS(const float matRGB_to_XYZ[9],
+                              const float* R, const float* G, const float* B, uint32_t numPixels,
+                              uvsA8x4* dst);
+    void encodeLinearRGBToUVS(const float matRGB_to_XYZ[9],
+                              const float* R, const float* G, const float* B, uint32_t numPixels,
+                              uvsA16Fx4* dst);
+}
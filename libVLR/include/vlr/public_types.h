@@ -56,12 +56,18 @@ enum VLRDebugRenderingMode {
     VLRDebugRenderingMode_DenoiserNormal,
 };
 
+enum VLRVertexFormat {
+    VLRVertexFormat_Full = 0,
+    VLRVertexFormat_Compact,
+};
+
 #if !defined(__cplusplus)
 typedef enum VLRParameterFormFlag VLRParameterFormFlag;
 typedef enum VLRShaderNodePlugType VLRShaderNodePlugType;
 typedef struct VLRShaderNodePlug VLRShaderNodePlug;
 typedef enum VLRDebugRenderingMode VLRDebugRenderingMode;
 typedef enum VLRRenderer VLRRenderer;
+typedef enum VLRVertexFormat VLRVertexFormat;
 #endif
 
 
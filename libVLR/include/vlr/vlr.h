@@ -59,6 +59,13 @@ VLR_PROCESS_CLASS_LIST();
 #   define VLR_TYPEDEF_DONE
 #endif
 
+// JP: 所有権を渡した画像データが不要になった時にuserDataを引数として一度だけ呼ばれる。
+// EN: Called exactly once with userData when image data whose ownership has been transferred is no longer needed.
+typedef void (*VLRImageDataReleaseFunction)(void* userData);
+// JP: 所有権を渡した頂点・インデックスのデータが不要になった時にuserDataを引数として一度だけ呼ばれる。
+// EN: Called exactly once with userData when vertex / index data whose ownership has been transferred is no longer needed.
+typedef void (*VLRMeshDataReleaseFunction)(void* userData);
+
 
 
 VLR_API const char* vlrGetErrorMessage(VLRResult code);
@@ -75,6 +82,11 @@ VLR_API VLRResult vlrDestroyContext(
 VLR_API VLRResult vlrContextGetCUcontext(
     VLRContext context,
     CUcontext* cuContext);
+// JP: ビルドの種類("RGB"か"Spectral")。内部形式に変換済みのデータをキャッシュする際のキーに使う。
+// EN: Build flavor ("RGB" or "Spectral"). Used as a key when caching data converted into the internal format.
+VLR_API VLRResult vlrContextGetBuildFlavor(
+    VLRContext context,
+    const char** flavor);
 
 VLR_API VLRResult vlrContextBindOutputBuffer(
     VLRContext context,
@@ -104,6 +116,19 @@ VLR_API VLRResult vlrContextRender(
     VLRContext context,
     CUstream stream, VLRCameraConst camera, bool denoise, uint32_t shrinkCoeff, bool firstFrame,
     uint32_t limitNumAccumFrames, uint32_t* numAccumFrames);
+VLR_API VLRResult vlrContextSetDefaultImageResidencyPolicy(
+    VLRContext context,
+    const char* policy);
+VLR_API VLRResult vlrContextGetImageMemoryReport(
+    VLRContext context,
+    uint32_t* numImages, uint32_t* numReleasedImages,
+    size_t* hostResidentSize, size_t* spilledSize, size_t* deviceSize);
+// JP: 三角形メッシュの頂点を全てFull/Compactの頂点形式で保持した場合のサイズ。
+// EN: Sizes when all the triangle mesh vertices are held in the Full / Compact vertex format.
+VLR_API VLRResult vlrContextGetVertexMemoryReport(
+    VLRContext context,
+    uint32_t* numMeshes, uint32_t* numCompactMeshes, uint32_t* numVertices,
+    size_t* fullFormatSize, size_t* compactFormatSize);
 
 
 
@@ -244,12 +269,21 @@ VLR_API VLRResult vlrImage2DGetHeight(
 VLR_API VLRResult vlrImage2DGetStride(
     VLRImage2DConst image,
     uint32_t* stride);
+VLR_API VLRResult vlrImage2DGetDataFormat(
+    VLRImage2DConst image,
+    const char** format);
+VLR_API VLRResult vlrImage2DGetNumMipmapLevels(
+    VLRImage2DConst image,
+    uint32_t* numMipmapLevels);
 VLR_API VLRResult vlrImage2DGetOriginalDataFormat(
     VLRImage2DConst image,
     const char** format);
 VLR_API VLRResult vlrImage2DOriginalHasAlpha(
     VLRImage2DConst image,
     bool* hasAlpha);
+VLR_API VLRResult vlrImage2DSetResidencyPolicy(
+    VLRImage2D image,
+    const char* policy);
 
 
 
@@ -260,9 +294,49 @@ VLR_API VLRResult vlrLinearImage2DCreate(
     uint8_t* linearData, uint32_t width, uint32_t height,
     const char* format, const char* spectrumType, const char* colorSpace,
     VLRLinearImage2D* image);
+// JP: generateMipmapsが真の場合はフルのミップチェーンを生成する。
+//     パストレーサーはレイコーンの幅からミップレベルを選択する。他のレンダラーは最も詳細なレベルを参照する。
+// EN: Generates the full mip chain when generateMipmaps is true.
+//     The path tracer selects the mip level from the ray cone width. Other renderers refer to the finest level.
+VLR_API VLRResult vlrLinearImage2DCreateWithMipmaps(
+    VLRContext context,
+    uint8_t* linearData, uint32_t width, uint32_t height,
+    const char* format, const char* spectrumType, const char* colorSpace,
+    bool generateMipmaps,
+    VLRLinearImage2D* image);
+// JP: linearDataの所有権を受け取り、コピーせずに使えるならそのまま使う。
+//     ポインターのnullチェックを通った後は、形式が不正でエラーになる場合も含めてreleaseが一度だけ呼ばれる。
+// EN: Takes ownership of linearData and uses it as is when it can be used without copying.
+//     Once the pointers pass the null check, release is called exactly once,
+//     including when the formats are rejected.
+VLR_API VLRResult vlrLinearImage2DCreateFromOwnedData(
+    VLRContext context,
+    uint8_t* linearData, uint32_t width, uint32_t height,
+    const char* format, const char* spectrumType, const char* colorSpace,
+    bool generateMipmaps,
+    VLRImageDataReleaseFunction release, void* userData,
+    VLRLinearImage2D* image);
+// JP: 内部形式に変換済みのデータ(ミップレベルを含む)の所有権を受け取り、変換せずに作る。
+//     dataFormatはoriginalFormatとspectrumTypeに対する内部形式である必要がある。
+//     ポインターのnullチェックを通った後は、形式やサイズが不正でエラーになる場合も含めてreleaseが一度だけ呼ばれる。
+// EN: Takes ownership of data already converted into the internal format (including mip levels)
+//     and creates without conversion. dataFormat must be the internal format for originalFormat and spectrumType.
+//     Once the pointers pass the null check, release is called exactly once,
+//     including when the formats or sizes are rejected.
+VLR_API VLRResult vlrLinearImage2DCreateFromConvertedData(
+    VLRContext context,
+    uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+    const char* originalFormat, const char* dataFormat, const char* spectrumType, const char* colorSpace,
+    VLRImageDataReleaseFunction release, void* userData,
+    VLRLinearImage2D* image);
 VLR_API VLRResult vlrLinearImage2DDestroy(
     VLRContext context,
     VLRLinearImage2D image);
+// JP: 指定したミップレベルの内部形式のデータをコピーする。dataがnullptrの場合はサイズのみ返す。
+// EN: Copies the data of the specified mip level in the internal format. Returns only the size when data is nullptr.
+VLR_API VLRResult vlrLinearImage2DCopyLevelData(
+    VLRLinearImage2DConst image,
+    uint32_t mipLevel, uint8_t* data, size_t* size);
 
 
 
@@ -273,9 +347,45 @@ VLR_API VLRResult vlrBlockCompressedImage2DCreate(
     uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
     const char* dataFormat, const char* spectrumType, const char* colorSpace,
     VLRBlockCompressedImage2D* image);
+// JP: 各ミップレベルのデータの所有権を受け取りコピーせずに使う。data, sizesの配列自体は呼び出し中のみ参照する。
+//     引数の検証を通った後はエラーの場合も含めてreleaseが一度だけ呼ばれる。
+// EN: Takes ownership of the data of each mip level and uses it without copying.
+//     The data and sizes arrays themselves are referenced only during the call.
+//     Once the arguments pass validation, release is called exactly once, including on error.
+VLR_API VLRResult vlrBlockCompressedImage2DCreateFromOwnedData(
+    VLRContext context,
+    uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+    const char* dataFormat, const char* spectrumType, const char* colorSpace,
+    VLRImageDataReleaseFunction release, void* userData,
+    VLRBlockCompressedImage2D* image);
+VLR_API VLRResult vlrBlockCompressedImage2DCreateFromLinearData(
+    VLRContext context,
+    uint8_t* linearData, uint32_t width, uint32_t height,
+    const char* format, const char* spectrumType, const char* colorSpace,
+    bool generateMipmaps, const char* quality,
+    VLRBlockCompressedImage2D* image);
 VLR_API VLRResult vlrBlockCompressedImage2DDestroy(
     VLRContext context,
     VLRBlockCompressedImage2D image);
+// JP: エンコードして作った場合の最上位レベルのPSNR[dB]とエンコード時間[ms]を返す。それ以外は0。
+//     BC7はRGBAの8bit値、BC6HはRGBの半精度浮動小数点数のビット列(ほぼ対数)の領域でPSNRを測る。
+// EN: Returns the PSNR [dB] of the top level and the encoding time [ms] when created by encoding. Zero otherwise.
+//     PSNR is measured in 8-bit RGBA values for BC7 and in the half-precision bit pattern (roughly log) domain of RGB for BC6H.
+VLR_API VLRResult vlrBlockCompressedImage2DGetEncodingStatistics(
+    VLRBlockCompressedImage2DConst image,
+    float* psnr, float* encodingTimeInMs);
+// JP: 画像の内容を同じ形式の別の解像度のミップチェーンで差し替える。
+//     Image2DTextureノードは自動的に追従する。重点サンプリング用のマップを持つEnvironmentTextureノードから
+//     参照されている画像は差し替えられず、VLRResult_InvalidArgumentを返す。
+//     データの所有権の扱いはvlrBlockCompressedImage2DCreateFromOwnedData()と同じ。
+// EN: Replace the contents of the image with a mip chain of another resolution in the same format.
+//     Image2DTexture nodes follow automatically. An image referenced by EnvironmentTexture nodes,
+//     which hold importance maps, can't be replaced and VLRResult_InvalidArgument is returned.
+//     Ownership of the data is handled the same as vlrBlockCompressedImage2DCreateFromOwnedData().
+VLR_API VLRResult vlrBlockCompressedImage2DReplaceWithOwnedData(
+    VLRBlockCompressedImage2D image,
+    uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+    VLRImageDataReleaseFunction release, void* userData);
 
 
 
@@ -345,14 +455,36 @@ VLR_API VLRResult vlrTriangleMeshSurfaceNodeCreate(
 VLR_API VLRResult vlrTriangleMeshSurfaceNodeDestroy(
     VLRContext context,
     VLRTriangleMeshSurfaceNode surfaceNode);
+VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVertexFormat(
+    VLRTriangleMeshSurfaceNode surfaceNode,
+    VLRVertexFormat format);
 VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVertices(
     VLRTriangleMeshSurfaceNode surfaceNode,
     const VLRVertex* vertices, uint32_t numVertices);
+// JP: verticesの所有権を受け取りコピーせずに使う。コンパクトな頂点形式の場合は変換後すぐに解放する。
+//     引数の検証を通った後はエラーの場合も含めてreleaseが一度だけ呼ばれる。
+// EN: Takes ownership of vertices and uses them without copying. Released right after conversion
+//     for the compact vertex format.
+//     Once the arguments pass validation, release is called exactly once, including on error.
+VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVerticesFromOwnedData(
+    VLRTriangleMeshSurfaceNode surfaceNode,
+    const VLRVertex* vertices, uint32_t numVertices,
+    VLRMeshDataReleaseFunction release, void* userData);
 VLR_API VLRResult vlrTriangleMeshSurfaceNodeAddMaterialGroup(
     VLRTriangleMeshSurfaceNode surfaceNode,
     const uint32_t* indices, uint32_t numIndices,
     VLRSurfaceMaterialConst material,
     VLRShaderNodePlug nodeNormal, VLRShaderNodePlug nodeTangent, VLRShaderNodePlug nodeAlpha);
+// JP: indicesの所有権を受け取りコピーせずに使う。
+//     引数の検証を通った後はエラーの場合も含めてreleaseが一度だけ呼ばれる。
+// EN: Takes ownership of indices and uses them without copying.
+//     Once the arguments pass validation, release is called exactly once, including on error.
+VLR_API VLRResult vlrTriangleMeshSurfaceNodeAddMaterialGroupFromOwnedData(
+    VLRTriangleMeshSurfaceNode surfaceNode,
+    const uint32_t* indices, uint32_t numIndices,
+    VLRSurfaceMaterialConst material,
+    VLRShaderNodePlug nodeNormal, VLRShaderNodePlug nodeTangent, VLRShaderNodePlug nodeAlpha,
+    VLRMeshDataReleaseFunction release, void* userData);
 
 
 
@@ -430,6 +562,10 @@ VLR_API VLRResult vlrSceneSetEnvironment(
 VLR_API VLRResult vlrSceneSetEnvironmentRotation(
     VLRScene scene,
     float rotationPhi);
+VLR_API VLRResult vlrSceneBeginEdits(
+    VLRScene scene);
+VLR_API VLRResult vlrSceneCommitEdits(
+    VLRScene scene);
 
 
 
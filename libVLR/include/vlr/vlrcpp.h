@@ -251,6 +251,16 @@ namespace vlr {
             errorCheck(vlrImage2DGetStride(getRaw<VLRImage2D>(), &stride));
             return stride;
         }
+        const char* getDataFormat() const {
+            const char* format;
+            errorCheck(vlrImage2DGetDataFormat(getRaw<VLRImage2D>(), &format));
+            return format;
+        }
+        uint32_t getNumMipmapLevels() const {
+            uint32_t numMipmapLevels;
+            errorCheck(vlrImage2DGetNumMipmapLevels(getRaw<VLRImage2D>(), &numMipmapLevels));
+            return numMipmapLevels;
+        }
         const char* getOriginalDataFormat() const {
             const char* format;
             errorCheck(vlrImage2DGetOriginalDataFormat(getRaw<VLRImage2D>(), &format));
@@ -261,6 +271,9 @@ namespace vlr {
             errorCheck(vlrImage2DOriginalHasAlpha(getRaw<VLRImage2D>(), &hasAlpha));
             return hasAlpha;
         }
+        void setResidencyPolicy(const char* policy) {
+            errorCheck(vlrImage2DSetResidencyPolicy(getRaw<VLRImage2D>(), policy));
+        }
     };
 
 
@@ -269,16 +282,49 @@ namespace vlr {
     public:
         LinearImage2DHolder(const ContextConstRef &context,
                             const uint8_t* linearData, uint32_t width, uint32_t height,
-                            const char* format, const char* spectrumType, const char* colorSpace) :
+                            const char* format, const char* spectrumType, const char* colorSpace,
+                            bool generateMipmaps) :
             Image2DHolder(context) {
-            errorCheck(vlrLinearImage2DCreate(
+            errorCheck(vlrLinearImage2DCreateWithMipmaps(
                 getRawContext(m_context),
                 const_cast<uint8_t*>(linearData), width, height, format, spectrumType, colorSpace,
+                generateMipmaps,
+                (VLRLinearImage2D*)&m_raw));
+        }
+        LinearImage2DHolder(const ContextConstRef &context,
+                            uint8_t* linearData, uint32_t width, uint32_t height,
+                            const char* format, const char* spectrumType, const char* colorSpace,
+                            bool generateMipmaps,
+                            VLRImageDataReleaseFunction release, void* userData) :
+            Image2DHolder(context) {
+            errorCheck(vlrLinearImage2DCreateFromOwnedData(
+                getRawContext(m_context),
+                linearData, width, height, format, spectrumType, colorSpace,
+                generateMipmaps, release, userData,
+                (VLRLinearImage2D*)&m_raw));
+        }
+        LinearImage2DHolder(const ContextConstRef &context,
+                            uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+                            const char* originalFormat, const char* dataFormat,
+                            const char* spectrumType, const char* colorSpace,
+                            VLRImageDataReleaseFunction release, void* userData) :
+            Image2DHolder(context) {
+            errorCheck(vlrLinearImage2DCreateFromConvertedData(
+                getRawContext(m_context),
+                const_cast<uint8_t**>(data), const_cast<size_t*>(sizes), mipCount, width, height,
+                originalFormat, dataFormat, spectrumType, colorSpace,
+                release, userData,
                 (VLRLinearImage2D*)&m_raw));
         }
         ~LinearImage2DHolder() {
             errorCheck(vlrLinearImage2DDestroy(getRawContext(m_context), getRaw<VLRLinearImage2D>()));
         }
+
+        size_t copyLevelData(uint32_t mipLevel, uint8_t* data) const {
+            size_t size;
+            errorCheck(vlrLinearImage2DCopyLevelData(getRaw<VLRLinearImage2D>(), mipLevel, data, &size));
+            return size;
+        }
     };
 
 
@@ -296,10 +342,48 @@ namespace vlr {
                 mipCount, width, height, dataFormat, spectrumType, colorSpace,
                 (VLRBlockCompressedImage2D*)&m_raw));
         }
+        BlockCompressedImage2DHolder(
+            const ContextConstRef &context,
+            uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+            const char* dataFormat, const char* spectrumType, const char* colorSpace,
+            VLRImageDataReleaseFunction release, void* userData) :
+            Image2DHolder(context) {
+            errorCheck(vlrBlockCompressedImage2DCreateFromOwnedData(
+                getRawContext(m_context),
+                const_cast<uint8_t**>(data), const_cast<size_t*>(sizes),
+                mipCount, width, height, dataFormat, spectrumType, colorSpace,
+                release, userData,
+                (VLRBlockCompressedImage2D*)&m_raw));
+        }
+        BlockCompressedImage2DHolder(
+            const ContextConstRef &context,
+            const uint8_t* linearData, uint32_t width, uint32_t height,
+            const char* format, const char* spectrumType, const char* colorSpace,
+            bool generateMipmaps, const char* quality) :
+            Image2DHolder(context) {
+            errorCheck(vlrBlockCompressedImage2DCreateFromLinearData(
+                getRawContext(m_context),
+                const_cast<uint8_t*>(linearData), width, height, format, spectrumType, colorSpace,
+                generateMipmaps, quality,
+                (VLRBlockCompressedImage2D*)&m_raw));
+        }
         ~BlockCompressedImage2DHolder() {
             errorCheck(vlrBlockCompressedImage2DDestroy(
                 getRawContext(m_context), getRaw<VLRBlockCompressedImage2D>()));
         }
+
+        void getEncodingStatistics(float* psnr, float* encodingTimeInMs) const {
+            errorCheck(vlrBlockCompressedImage2DGetEncodingStatistics(
+                getRaw<VLRBlockCompressedImage2D>(), psnr, encodingTimeInMs));
+        }
+        void replaceWithOwnedData(
+            uint8_t* const* data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+            VLRImageDataReleaseFunction release, void* userData) {
+            errorCheck(vlrBlockCompressedImage2DReplaceWithOwnedData(
+                getRaw<VLRBlockCompressedImage2D>(),
+                const_cast<uint8_t**>(data), const_cast<size_t*>(sizes), mipCount, width, height,
+                release, userData));
+        }
     };
 
 
@@ -482,10 +566,22 @@ namespace vlr {
                 getRawContext(m_context), getRaw<VLRTriangleMeshSurfaceNode>()));
         }
 
+        void setVertexFormat(VLRVertexFormat format) {
+            errorCheck(vlrTriangleMeshSurfaceNodeSetVertexFormat(
+                getRaw<VLRTriangleMeshSurfaceNode>(), format));
+        }
         void setVertices(vlr::Vertex* vertices, uint32_t numVertices) {
             errorCheck(vlrTriangleMeshSurfaceNodeSetVertices(
                 getRaw<VLRTriangleMeshSurfaceNode>(), reinterpret_cast<VLRVertex*>(vertices), numVertices));
         }
+        // JP: verticesの所有権を渡す。不要になった時にrelease(userData)が一度だけ呼ばれる。
+        // EN: Transfers ownership of vertices. release(userData) is called exactly once when they are no longer needed.
+        void setVerticesFromOwnedData(const vlr::Vertex* vertices, uint32_t numVertices,
+                                      VLRMeshDataReleaseFunction release, void* userData) {
+            errorCheck(vlrTriangleMeshSurfaceNodeSetVerticesFromOwnedData(
+                getRaw<VLRTriangleMeshSurfaceNode>(), reinterpret_cast<const VLRVertex*>(vertices), numVertices,
+                release, userData));
+        }
         void addMaterialGroup(uint32_t* indices, uint32_t numIndices,
                               const SurfaceMaterialRef &material,
                               const ShaderNodePlug &nodeNormal, const ShaderNodePlug& nodeTangent, const ShaderNodePlug &nodeAlpha) {
@@ -498,6 +594,22 @@ namespace vlr {
                 material->getRaw<VLRSurfaceMaterial>(),
                 nodeNormal.plug, nodeTangent.plug, nodeAlpha.plug));
         }
+        // JP: indicesの所有権を渡す。不要になった時にrelease(userData)が一度だけ呼ばれる。
+        // EN: Transfers ownership of indices. release(userData) is called exactly once when they are no longer needed.
+        void addMaterialGroupFromOwnedData(const uint32_t* indices, uint32_t numIndices,
+                                           const SurfaceMaterialRef &material,
+                                           const ShaderNodePlug &nodeNormal, const ShaderNodePlug& nodeTangent, const ShaderNodePlug &nodeAlpha,
+                                           VLRMeshDataReleaseFunction release, void* userData) {
+            m_materials.push_back(material);
+            m_nodeNormals.push_back(nodeNormal);
+            m_nodeTangents.push_back(nodeTangent);
+            m_nodeAlphas.push_back(nodeAlpha);
+            errorCheck(vlrTriangleMeshSurfaceNodeAddMaterialGroupFromOwnedData(
+                getRaw<VLRTriangleMeshSurfaceNode>(), indices, numIndices,
+                material->getRaw<VLRSurfaceMaterial>(),
+                nodeNormal.plug, nodeTangent.plug, nodeAlpha.plug,
+                release, userData));
+        }
     };
 
 
@@ -634,6 +746,20 @@ namespace vlr {
         void setEnvironmentRotation(float rotationPhi) {
             errorCheck(vlrSceneSetEnvironmentRotation(getRaw<VLRScene>(), rotationPhi));
         }
+
+        // JP: beginEdits()からcommitEdits()までのシーングラフの編集(ノードの接続とトランスフォームの変更)は記録だけされ、
+        //     正味の変更が一度に伝播してIASへまとめて反映される。
+        //     入れ子にでき、最も外側のcommitEdits()で反映される。同時に編集できるシーンはコンテキストごとに1つ。
+        // EN: Edits of the scene graph (changes of node links and transforms) between beginEdits() and commitEdits()
+        //     are only recorded, and the net changes are propagated once and reflected to the IAS at once.
+        //     They can be nested, and are reflected at the outermost commitEdits().
+        //     Only one scene per context can be edited at a time.
+        void beginEdits() {
+            errorCheck(vlrSceneBeginEdits(getRaw<VLRScene>()));
+        }
+        void commitEdits() {
+            errorCheck(vlrSceneCommitEdits(getRaw<VLRScene>()));
+        }
     };
 
 
@@ -709,6 +835,11 @@ namespace vlr {
             errorCheck(vlrContextGetCUcontext(m_rawContext, &cuContext));
             return cuContext;
         }
+        const char* getBuildFlavor() const {
+            const char* flavor;
+            errorCheck(vlrContextGetBuildFlavor(m_rawContext, &flavor));
+            return flavor;
+        }
 
         void bindOutputBuffer(uint32_t width, uint32_t height, uint32_t glTexID) const {
             errorCheck(vlrContextBindOutputBuffer(m_rawContext, width, height, glTexID));
@@ -748,15 +879,59 @@ namespace vlr {
                                         shrinkCoeff, firstFrame, limitNumAccumFrames, numAccumFrames));
         }
 
+        void setDefaultImageResidencyPolicy(const char* policy) const {
+            errorCheck(vlrContextSetDefaultImageResidencyPolicy(m_rawContext, policy));
+        }
+        void getImageMemoryReport(uint32_t* numImages, uint32_t* numReleasedImages,
+                                  size_t* hostResidentSize, size_t* spilledSize, size_t* deviceSize) const {
+            errorCheck(vlrContextGetImageMemoryReport(m_rawContext, numImages, numReleasedImages,
+                                                      hostResidentSize, spilledSize, deviceSize));
+        }
+        void getVertexMemoryReport(uint32_t* numMeshes, uint32_t* numCompactMeshes, uint32_t* numVertices,
+                                   size_t* fullFormatSize, size_t* compactFormatSize) const {
+            errorCheck(vlrContextGetVertexMemoryReport(m_rawContext, numMeshes, numCompactMeshes, numVertices,
+                                                       fullFormatSize, compactFormatSize));
+        }
+
 
 
         LinearImage2DRef createLinearImage2D(
             const uint8_t* linearData, uint32_t width, uint32_t height,
-            const char* format, const char* spectrumType, const char* colorSpace) const {
+            const char* format, const char* spectrumType, const char* colorSpace,
+            bool generateMipmaps = false) const {
             return std::make_shared<LinearImage2DHolder>(
                 shared_from_this(),
                 linearData, width, height,
-                format, spectrumType, colorSpace);
+                format, spectrumType, colorSpace, generateMipmaps);
+        }
+
+        // JP: linearDataの所有権を渡す。不要になった時にrelease(userData)が一度だけ呼ばれる。
+        // EN: Transfers ownership of linearData. release(userData) is called exactly once when it is no longer needed.
+        LinearImage2DRef createLinearImage2DFromOwnedData(
+            uint8_t* linearData, uint32_t width, uint32_t height,
+            const char* format, const char* spectrumType, const char* colorSpace,
+            bool generateMipmaps,
+            VLRImageDataReleaseFunction release, void* userData) const {
+            return std::make_shared<LinearImage2DHolder>(
+                shared_from_this(),
+                linearData, width, height,
+                format, spectrumType, colorSpace, generateMipmaps,
+                release, userData);
+        }
+
+        // JP: 内部形式に変換済みのデータの所有権を渡す。不要になった時にrelease(userData)が一度だけ呼ばれる。
+        // EN: Transfers ownership of data already converted into the internal format.
+        //     release(userData) is called exactly once when it is no longer needed.
+        LinearImage2DRef createLinearImage2DFromConvertedData(
+            uint8_t** data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+            const char* originalFormat, const char* dataFormat,
+            const char* spectrumType, const char* colorSpace,
+            VLRImageDataReleaseFunction release, void* userData) const {
+            return std::make_shared<LinearImage2DHolder>(
+                shared_from_this(),
+                data, sizes, mipCount, width, height,
+                originalFormat, dataFormat, spectrumType, colorSpace,
+                release, userData);
         }
 
         BlockCompressedImage2DRef createBlockCompressedImage2D(
@@ -768,6 +943,30 @@ namespace vlr {
                 format, spectrumType, colorSpace);
         }
 
+        // JP: 各ミップレベルのデータの所有権を渡す。不要になった時にrelease(userData)が一度だけ呼ばれる。
+        // EN: Transfers ownership of the data of each mip level.
+        //     release(userData) is called exactly once when it is no longer needed.
+        BlockCompressedImage2DRef createBlockCompressedImage2DFromOwnedData(
+            uint8_t** data, const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+            const char* format, const char* spectrumType, const char* colorSpace,
+            VLRImageDataReleaseFunction release, void* userData) const {
+            return std::make_shared<BlockCompressedImage2DHolder>(
+                shared_from_this(),
+                data, sizes, mipCount, width, height,
+                format, spectrumType, colorSpace,
+                release, userData);
+        }
+
+        BlockCompressedImage2DRef createBlockCompressedImage2DFromLinearData(
+            const uint8_t* linearData, uint32_t width, uint32_t height,
+            const char* format, const char* spectrumType, const char* colorSpace,
+            bool generateMipmaps = false, const char* quality = "Normal") const {
+            return std::make_shared<BlockCompressedImage2DHolder>(
+                shared_from_this(),
+                linearData, width, height,
+                format, spectrumType, colorSpace, generateMipmaps, quality);
+        }
+
 
 
         ShaderNodeRef createShaderNode(const char* typeName) const {
@@ -0,0 +1,247 @@
+#include "lz_codec.h"
+#include "thread_pool.h"
+
+namespace vlr {
+    // JP: ストリームの構成:
+    //     magic(u32), 元のサイズ(u64), チャンクサイズ(u32), チャンク数(u32),
+    //     各チャンクの圧縮サイズと展開後のデータの64bit FNV-1aチェックサム((u32, u64) x チャンク数), チャンク列
+    //     圧縮サイズの最上位ビットが立っているチャンクは無圧縮で格納されている。
+    //     チャンク内はLZ4に似たシーケンス列: トークン(上位4bit: リテラル長, 下位4bit: マッチ長 - 4)、
+    //     追加のリテラル長、リテラル、オフセット(u16)、追加のマッチ長。最後のシーケンスはマッチを持たない。
+    // EN: Stream layout:
+    //     magic (u32), original size (u64), chunk size (u32), number of chunks (u32),
+    //     compressed size and 64-bit FNV-1a checksum of the decompressed data of each chunk ((u32, u64) x number of chunks),
+    //     chunks
+    //     A chunk whose compressed size has the most significant bit set is stored uncompressed.
+    //     A chunk is a sequence list similar to LZ4: token (upper 4 bits: literal length, lower 4 bits: match length - 4),
+    //     extra literal length, literals, offset (u16), extra match length. The last sequence has no match.
+    static constexpr uint32_t StreamMagic = 0x5A524C56; // "VLRZ"
+    static constexpr uint32_t ChunkSize = 1 << 20;
+    static constexpr uint32_t RawChunkFlag = 0x80000000;
+    static constexpr uint32_t MinMatchLength = 4;
+    static constexpr uint32_t MaxOffset = 65535;
+    static constexpr uint32_t HashBits = 14;
+    static constexpr size_t HeaderSize = sizeof(uint32_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t);
+    static constexpr size_t ChunkEntrySize = sizeof(uint32_t) + sizeof(uint64_t);
+
+    static inline uint32_t readUInt32(const uint8_t* data) {
+        uint32_t ret;
+        std::memcpy(&ret, data, sizeof(ret));
+        return ret;
+    }
+
+    static inline uint64_t readUInt64(const uint8_t* data) {
+        uint64_t ret;
+        std::memcpy(&ret, data, sizeof(ret));
+        return ret;
+    }
+
+    static uint64_t computeFNV1a64(const uint8_t* data, size_t size) {
+        uint64_t hash = 0xCBF29CE484222325;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= data[i];
+            hash *= 0x100000001B3;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    static inline void appendValue(std::vector<uint8_t>* dst, T value) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        dst->insert(dst->end(), bytes, bytes + sizeof(T));
+    }
+
+    static inline void appendLength(std::vector<uint8_t>* dst, size_t length) {
+        while (length >= 255) {
+            dst->push_back(255);
+            length -= 255;
+        }
+        dst->push_back(static_cast<uint8_t>(length));
+    }
+
+    static void appendSequence(std::vector<uint8_t>* dst, const uint8_t* literals, size_t numLiterals,
+                               uint32_t offset, size_t matchLength) {
+        size_t extraMatchLength = matchLength > 0 ? matchLength - MinMatchLength : 0;
+        uint8_t token = static_cast<uint8_t>((std::min<size_t>(numLiterals, 15) << 4) |
+                                             std::min<size_t>(extraMatchLength, 15));
+        dst->push_back(token);
+        if (numLiterals >= 15)
+            appendLength(dst, numLiterals - 15);
+        dst->insert(dst->end(), literals, literals + numLiterals);
+        if (matchLength == 0)
+            return;
+        dst->push_back(static_cast<uint8_t>(offset & 0xFF));
+        dst->push_back(static_cast<uint8_t>(offset >> 8));
+        if (extraMatchLength >= 15)
+            appendLength(dst, extraMatchLength - 15);
+    }
+
+    static void compressChunk(const uint8_t* src, uint32_t size, std::vector<uint8_t>* dst) {
+        std::vector<uint32_t> hashTable(1 << HashBits, UINT32_MAX);
+        uint32_t anchor = 0;
+        uint32_t pos = 0;
+        while (pos + MinMatchLength <= size) {
+            uint32_t sequence = readUInt32(src + pos);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - HashBits);
+            uint32_t candidate = hashTable[hash];
+            hashTable[hash] = pos;
+            if (candidate != UINT32_MAX && pos - candidate <= MaxOffset && readUInt32(src + candidate) == sequence) {
+                uint32_t matchLength = MinMatchLength;
+                while (pos + matchLength < size && src[candidate + matchLength] == src[pos + matchLength])
+                    ++matchLength;
+                appendSequence(dst, src + anchor, pos - anchor, pos - candidate, matchLength);
+                pos += matchLength;
+                anchor = pos;
+            }
+            else {
+                ++pos;
+            }
+        }
+        appendSequence(dst, src + anchor, size - anchor, 0, 0);
+    }
+
+    static bool decompressChunk(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+        size_t ip = 0;
+        size_t op = 0;
+        const auto readLength = [&](size_t* length) {
+            uint8_t value;
+            do {
+                if (ip >= srcSize)
+                    return false;
+                value = src[ip++];
+                *length += value;
+            } while (value == 255);
+            return true;
+        };
+
+        while (ip < srcSize) {
+            uint8_t token = src[ip++];
+            size_t numLiterals = token >> 4;
+            if (numLiterals == 15 && !readLength(&numLiterals))
+                return false;
+            if (numLiterals > srcSize - ip || numLiterals > dstSize - op)
+                return false;
+            std::copy_n(src + ip, numLiterals, dst + op);
+            ip += numLiterals;
+            op += numLiterals;
+            if (ip == srcSize)
+                break;
+
+            if (srcSize - ip < 2)
+                return false;
+            uint32_t offset = src[ip] | (src[ip + 1] << 8);
+            ip += 2;
+            size_t matchLength = token & 0xF;
+            if (matchLength == 15 && !readLength(&matchLength))
+                return false;
+            matchLength += MinMatchLength;
+            if (offset == 0 || offset > op || matchLength > dstSize - op)
+                return false;
+            // JP: マッチは自身と重なり得るので1バイトずつコピーする。
+            // EN: A match may overlap itself, so copy byte by byte.
+            for (size_t i = 0; i < matchLength; ++i, ++op)
+                dst[op] = dst[op - offset];
+        }
+
+        return op == dstSize;
+    }
+
+    void compressLZ(const uint8_t* data, size_t size, std::vector<uint8_t>* compressedData) {
+        uint32_t numChunks = static_cast<uint32_t>((size + ChunkSize - 1) / ChunkSize);
+        std::vector<std::vector<uint8_t>> chunks(numChunks);
+        std::vector<uint64_t> checksums(numChunks);
+        ThreadPool::getShared().parallelFor(
+            0, numChunks, 1,
+            [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c) {
+                const uint8_t* src = data + static_cast<size_t>(c) * ChunkSize;
+                uint32_t chunkSize = static_cast<uint32_t>(std::min<size_t>(size - static_cast<size_t>(c) * ChunkSize, ChunkSize));
+                std::vector<uint8_t> &chunk = chunks[c];
+                checksums[c] = computeFNV1a64(src, chunkSize);
+                compressChunk(src, chunkSize, &chunk);
+                if (chunk.size() >= chunkSize)
+                    chunk.clear();
+            }
+        });
+
+        compressedData->clear();
+        appendValue<uint32_t>(compressedData, StreamMagic);
+        appendValue<uint64_t>(compressedData, size);
+        appendValue<uint32_t>(compressedData, ChunkSize);
+        appendValue<uint32_t>(compressedData, numChunks);
+        for (uint32_t c = 0; c < numChunks; ++c) {
+            uint32_t chunkSize = static_cast<uint32_t>(std::min<size_t>(size - static_cast<size_t>(c) * ChunkSize, ChunkSize));
+            appendValue<uint32_t>(compressedData, chunks[c].empty() ? (chunkSize | RawChunkFlag) :
+                                  static_cast<uint32_t>(chunks[c].size()));
+            appendValue<uint64_t>(compressedData, checksums[c]);
+        }
+        for (uint32_t c = 0; c < numChunks; ++c) {
+            if (chunks[c].empty()) {
+                const uint8_t* src = data + static_cast<size_t>(c) * ChunkSize;
+                size_t chunkSize = std::min<size_t>(size - static_cast<size_t>(c) * ChunkSize, ChunkSize);
+                compressedData->insert(compressedData->end(), src, src + chunkSize);
+            }
+            else {
+                compressedData->insert(compressedData->end(), chunks[c].cbegin(), chunks[c].cend());
+            }
+        }
+    }
+
+    bool getDecompressedLZSize(const uint8_t* compressedData, size_t compressedSize, size_t* size) {
+        if (compressedSize < HeaderSize || readUInt32(compressedData) != StreamMagic)
+            return false;
+        uint64_t rawSize;
+        std::memcpy(&rawSize, compressedData + sizeof(uint32_t), sizeof(rawSize));
+        *size = static_cast<size_t>(rawSize);
+        return true;
+    }
+
+    bool decompressLZ(const uint8_t* compressedData, size_t compressedSize, uint8_t* dstData, size_t dstSize) {
+        size_t rawSize;
+        if (!getDecompressedLZSize(compressedData, compressedSize, &rawSize) || rawSize != dstSize)
+            return false;
+        uint32_t chunkSize = readUInt32(compressedData + sizeof(uint32_t) + sizeof(uint64_t));
+        uint32_t numChunks = readUInt32(compressedData + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint32_t));
+        if (chunkSize == 0 || numChunks != (rawSize + chunkSize - 1) / chunkSize ||
+            compressedSize < HeaderSize + ChunkEntrySize * static_cast<size_t>(numChunks))
+            return false;
+
+        std::vector<size_t> chunkOffsets(numChunks + 1);
+        chunkOffsets[0] = HeaderSize + ChunkEntrySize * static_cast<size_t>(numChunks);
+        for (uint32_t c = 0; c < numChunks; ++c) {
+            uint32_t size = readUInt32(compressedData + HeaderSize + ChunkEntrySize * c) & ~RawChunkFlag;
+            chunkOffsets[c + 1] = chunkOffsets[c] + size;
+        }
+        if (chunkOffsets[numChunks] != compressedSize)
+            return false;
+
+        std::atomic<bool> success = true;
+        ThreadPool::getShared().parallelFor(
+            0, numChunks, 1,
+            [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c) {
+                const uint8_t* src = compressedData + chunkOffsets[c];
+                size_t srcSize = chunkOffsets[c + 1] - chunkOffsets[c];
+                uint8_t* dst = dstData + static_cast<size_t>(c) * chunkSize;
+                size_t size = std::min<size_t>(rawSize - static_cast<size_t>(c) * chunkSize, chunkSize);
+                const uint8_t* entry = compressedData + HeaderSize + ChunkEntrySize * c;
+                bool isRaw = (readUInt32(entry) & RawChunkFlag) != 0;
+                if (isRaw) {
+                    if (srcSize != size) {
+                        success = false;
+                        continue;
+                    }
+                    std::copy_n(src, size, dst);
+                }
+                else if (!decompressChunk(src, srcSize, dst, size)) {
+                    success = false;
+                    continue;
+                }
+                if (computeFNV1a64(dst, size) != readUInt64(entry + sizeof(uint32_t)))
+                    success = false;
+            }
+        });
+
+        return success;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "shared/common_internal.h"
+
+namespace vlr {
+    // JP: ホスト側キャッシュ用の軽量なLZ77系可逆圧縮。
+    //     データを固定サイズのチャンクに分割し、共有スレッドプール上で独立に圧縮・展開する。
+    //     圧縮結果は元のサイズと、チャンクごとのチェックサムを持つチャンク表を含む自己記述的なバイト列になる。
+    // EN: Lightweight LZ77-family lossless compression for host-side caches.
+    //     Splits data into fixed-size chunks that are compressed/decompressed independently on the shared thread pool.
+    //     The compressed result is a self-describing byte stream including the original size
+    //     and the chunk table with a checksum per chunk.
+    void compressLZ(const uint8_t* data, size_t size, std::vector<uint8_t>* compressedData);
+
+    // JP: compressLZ()の出力から元のサイズを読み取る。不正な入力の場合はfalseを返す。
+    // EN: Read the original size from the output of compressLZ(). Returns false for malformed input.
+    bool getDecompressedLZSize(const uint8_t* compressedData, size_t compressedSize, size_t* size);
+
+    // JP: compressLZ()の出力を展開する。dstSizeは元のサイズと一致する必要がある。
+    //     不正な入力の場合や展開したデータがチェックサムと一致しない場合はfalseを返す。
+    // EN: Decompress the output of compressLZ(). dstSize must match the original size.
+    //     Returns false for malformed input or when the decompressed data doesn't match the checksums.
+    bool decompressLZ(const uint8_t* compressedData, size_t compressedSize, uint8_t* dstData, size_t dstSize);
+}
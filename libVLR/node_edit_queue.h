@@ -0,0 +1,251 @@
+﻿#pragma once
+
+#include "shared/common_internal.h"
+
+namespace vlr {
+    // JP: シーングラフの編集のトランザクション中に、親子の接続の変更とトランスフォームの更新を記録する。
+    //     同じ接続の追加と削除は打ち消し合い、コミット時には正味の変更だけを適用する。
+    //     削除は親側の接続から、追加は子側の接続から適用するので、各ノードの変更は
+    //     そのノードがまだ上に繋がっていない状態でまとめられ、親へは一度だけ伝わる。
+    // EN: Records changes of parent-child links and transform updates during a transaction of scene graph edits.
+    //     Addition and removal of the same link cancel each other, and only the net changes are applied on commit.
+    //     Removals are applied from links on the parent side and additions from links on the child side,
+    //     so changes under each node are combined while the node isn't connected upward yet,
+    //     and are propagated to its parents only once.
+    template <typename NodeType>
+    class NodeEditQueue {
+        // JP: 記録時は末尾に追加して親に番号を振るだけにする。
+        //     コミット時は親の番号で数え上げソートして親ごとにまとめ、同じ接続の変更の打ち消しは親の中で求める。
+        // EN: Recording only appends and numbers the parent.
+        //     On commit, edits are grouped per parent by a counting sort on the parent number,
+        //     and cancellation of changes of the same link is resolved within each parent.
+        struct LinkEdit {
+            NodeType* parent;
+            NodeType* child;
+            uint32_t parentSlot;
+            bool linked;
+            bool isDiscarded;
+        };
+        struct NetLinkEdit {
+            NodeType* parent;
+            NodeType* child;
+            uint32_t order;
+            uint32_t parentSlot;
+            bool linked;
+        };
+        // JP: 親ごとにまとめた接続の変更。親の番号sの変更はedits[groupBegins[s], groupBegins[s + 1])。
+        // EN: Link edits grouped per parent. Edits of parent number s are edits[groupBegins[s], groupBegins[s + 1]).
+        struct GroupedLinkEdits {
+            std::vector<NetLinkEdit> edits;
+            std::vector<uint32_t> groupBegins;
+        };
+
+        std::vector<LinkEdit> m_linkEdits;
+        std::unordered_map<const NodeType*, uint32_t> m_parentSlots;
+        std::vector<NodeType*> m_updatedNodes;
+        std::unordered_set<const NodeType*> m_updatedNodeSet;
+
+        uint32_t getParentSlot(const NodeType* parent) {
+            return m_parentSlots.try_emplace(parent, static_cast<uint32_t>(m_parentSlots.size())).first->second;
+        }
+
+        // JP: 親の番号で安定に数え上げソートする。各親の中は記録順のまま。
+        // EN: Stable counting sort by the parent number. Each parent keeps the recorded order.
+        GroupedLinkEdits groupByParent(const std::vector<NetLinkEdit> &edits) const {
+            uint32_t numSlots = static_cast<uint32_t>(m_parentSlots.size());
+            GroupedLinkEdits ret;
+            ret.groupBegins.resize(numSlots + 1, 0);
+            for (const NetLinkEdit &edit : edits)
+                ++ret.groupBegins[edit.parentSlot + 1];
+            for (uint32_t s = 0; s < numSlots; ++s)
+                ret.groupBegins[s + 1] += ret.groupBegins[s];
+            std::vector<uint32_t> writePos(ret.groupBegins.cbegin(), ret.groupBegins.cend() - 1);
+            ret.edits.resize(edits.size());
+            for (const NetLinkEdit &edit : edits)
+                ret.edits[writePos[edit.parentSlot]++] = edit;
+            return ret;
+        }
+
+        // JP: 同じ接続の最初と最後の変更が同じ向きなら正味の変更がある。
+        //     (ParentNodeは既に有る接続を追加せず、無い接続を削除しないので、追加から始まる接続は元々無く、削除から始まる接続は元々有る。)
+        //     結果は親ごとにまとまり、各親の中は記録順に並ぶ。
+        // EN: There is a net change when the first and the last changes of the same link go in the same direction.
+        //     (ParentNode doesn't add an existing link nor remove a missing one, so a link starting with an addition
+        //     didn't exist, and a link starting with a removal existed.)
+        //     Results are grouped per parent, and each parent is in the recorded order.
+        void collectNetLinkEdits(const std::vector<NetLinkEdit> &edits,
+                                 GroupedLinkEdits* removals, GroupedLinkEdits* additions) const {
+            uint32_t numSlots = static_cast<uint32_t>(m_parentSlots.size());
+            GroupedLinkEdits grouped = groupByParent(edits);
+            GroupedLinkEdits* netEdits[2] = { removals, additions };
+            for (GroupedLinkEdits* net : netEdits) {
+                net->edits.clear();
+                net->groupBegins.resize(numSlots + 1);
+            }
+            for (uint32_t s = 0; s < numSlots; ++s) {
+                for (GroupedLinkEdits* net : netEdits)
+                    net->groupBegins[s] = static_cast<uint32_t>(net->edits.size());
+                auto groupBegin = grouped.edits.begin() + grouped.groupBegins[s];
+                auto groupEnd = grouped.edits.begin() + grouped.groupBegins[s + 1];
+                if (groupEnd - groupBegin == 1) {
+                    netEdits[groupBegin->linked]->edits.push_back(*groupBegin);
+                    continue;
+                }
+
+                // JP: 子ごとにまとめる。各親の子の数は少ないので親の中でソートする。
+                // EN: Group per child. Each parent has a small number of children, so sort within the parent.
+                std::sort(groupBegin, groupEnd,
+                          [](const NetLinkEdit &a, const NetLinkEdit &b) {
+                              if (a.child != b.child)
+                                  return std::less<const NodeType*>()(a.child, b.child);
+                              return a.order < b.order;
+                          });
+                for (auto linkBegin = groupBegin; linkBegin != groupEnd;) {
+                    auto linkEnd = linkBegin + 1;
+                    while (linkEnd != groupEnd && linkEnd->child == linkBegin->child)
+                        ++linkEnd;
+                    const NetLinkEdit &last = *(linkEnd - 1);
+                    if (last.linked == linkBegin->linked)
+                        netEdits[last.linked]->edits.push_back(last);
+                    linkBegin = linkEnd;
+                }
+                for (GroupedLinkEdits* net : netEdits) {
+                    std::sort(net->edits.begin() + net->groupBegins[s], net->edits.end(),
+                              [](const NetLinkEdit &a, const NetLinkEdit &b) {
+                                  return a.order < b.order;
+                              });
+                }
+            }
+            for (GroupedLinkEdits* net : netEdits)
+                net->groupBegins[numSlots] = static_cast<uint32_t>(net->edits.size());
+        }
+
+        // JP: 子がさらに親である接続を先にした順(深さ優先探索の帰りがけ順)に並べる。
+        //     結果が決定的になるよう、根も兄弟も記録順に辿る。深い階層でもスタックが溢れないよう明示的なスタックを使う。
+        // EN: Order links so that links whose parent is the child come first (post-order of depth-first search).
+        //     Both roots and siblings are traversed in the recorded order to make the result deterministic.
+        //     Uses an explicit stack so that deep hierarchies don't overflow the stack.
+        std::vector<NetLinkEdit> sortInPostOrder(const GroupedLinkEdits &netEdits) const {
+            const std::vector<NetLinkEdit> &edits = netEdits.edits;
+            std::vector<uint32_t> posByOrder(m_linkEdits.size(), 0xFFFFFFFF);
+            for (uint32_t pos = 0; pos < edits.size(); ++pos)
+                posByOrder[edits[pos].order] = pos;
+
+            struct StackEntry {
+                uint32_t pos;
+                uint32_t nextPos;
+                uint32_t endPos;
+            };
+            std::vector<StackEntry> stack;
+            std::vector<uint8_t> visited(edits.size(), 0);
+            const auto push = [&](uint32_t pos) {
+                // JP: 子をさらに親とする接続の範囲。
+                // EN: Range of links having the child as the parent.
+                uint32_t beginPos = 0;
+                uint32_t endPos = 0;
+                auto it = m_parentSlots.find(edits[pos].child);
+                if (it != m_parentSlots.cend()) {
+                    beginPos = netEdits.groupBegins[it->second];
+                    endPos = netEdits.groupBegins[it->second + 1];
+                }
+                visited[pos] = 1;
+                stack.push_back(StackEntry{ pos, beginPos, endPos });
+            };
+
+            std::vector<NetLinkEdit> sorted;
+            sorted.reserve(edits.size());
+            for (uint32_t pos : posByOrder) {
+                if (pos == 0xFFFFFFFF || visited[pos])
+                    continue;
+                push(pos);
+                while (!stack.empty()) {
+                    StackEntry &entry = stack.back();
+                    if (entry.nextPos < entry.endPos) {
+                        uint32_t childPos = entry.nextPos++;
+                        if (!visited[childPos])
+                            push(childPos);
+                        continue;
+                    }
+                    sorted.push_back(edits[entry.pos]);
+                    stack.pop_back();
+                }
+            }
+            return sorted;
+        }
+
+        std::vector<NetLinkEdit> gatherLinkEdits(const NodeType* node) {
+            std::vector<NetLinkEdit> edits;
+            if (!node)
+                edits.reserve(m_linkEdits.size());
+            for (uint32_t i = 0; i < m_linkEdits.size(); ++i) {
+                LinkEdit &edit = m_linkEdits[i];
+                if (edit.isDiscarded || (node && edit.parent != node && edit.child != node))
+                    continue;
+                edits.push_back(NetLinkEdit{ edit.parent, edit.child, i, edit.parentSlot, edit.linked });
+                if (node)
+                    edit.isDiscarded = true;
+            }
+            return edits;
+        }
+
+    public:
+        void addLink(NodeType* parent, NodeType* child) {
+            m_linkEdits.push_back(LinkEdit{ parent, child, getParentSlot(parent), true, false });
+        }
+        void removeLink(NodeType* parent, NodeType* child) {
+            m_linkEdits.push_back(LinkEdit{ parent, child, getParentSlot(parent), false, false });
+        }
+        void updateNode(NodeType* node) {
+            if (m_updatedNodeSet.insert(node).second)
+                m_updatedNodes.push_back(node);
+        }
+
+        bool empty() const {
+            return m_linkEdits.empty() && m_updatedNodes.empty();
+        }
+
+        // JP: 正味の変更を削除、追加、トランスフォームの更新の順に適用して記録を空にする。
+        //     applyLink(parent, child, linked)は接続を実際に変更し、applyUpdate(node)は更新を親へ伝える。
+        // EN: Apply the net changes in the order of removals, additions and transform updates, then clear the records.
+        //     applyLink(parent, child, linked) actually changes a link, and applyUpdate(node) propagates an update to parents.
+        template <typename LinkFunc, typename UpdateFunc>
+        void apply(const LinkFunc &applyLink, const UpdateFunc &applyUpdate) {
+            GroupedLinkEdits removals;
+            GroupedLinkEdits additions;
+            collectNetLinkEdits(gatherLinkEdits(nullptr), &removals, &additions);
+
+            std::vector<NetLinkEdit> sortedRemovals = sortInPostOrder(removals);
+            for (auto it = sortedRemovals.crbegin(); it != sortedRemovals.crend(); ++it)
+                applyLink(it->parent, it->child, false);
+            std::vector<NetLinkEdit> sortedAdditions = sortInPostOrder(additions);
+            for (const NetLinkEdit &edit : sortedAdditions)
+                applyLink(edit.parent, edit.child, true);
+            for (NodeType* node : m_updatedNodes) {
+                if (m_updatedNodeSet.count(node))
+                    applyUpdate(node);
+            }
+
+            m_linkEdits.clear();
+            m_parentSlots.clear();
+            m_updatedNodes.clear();
+            m_updatedNodeSet.clear();
+        }
+
+        // JP: 破棄されるノードに関わる接続の正味の変更をその場で適用して記録から取り除き、ノードの更新の記録は捨てる。
+        //     破棄の時点でノードの接続が実際の状態と一致する。破棄はまれなので全ての記録を走査する。
+        // EN: Apply the net changes of links involving a node being destroyed right away and remove them from the records,
+        //     and discard the update record of the node.
+        //     The links of the node match the actual state at destruction. Destruction is rare, so all the records are scanned.
+        template <typename LinkFunc>
+        void flushNode(const NodeType* node, const LinkFunc &applyLink) {
+            GroupedLinkEdits removals;
+            GroupedLinkEdits additions;
+            collectNetLinkEdits(gatherLinkEdits(node), &removals, &additions);
+            for (const NetLinkEdit &edit : removals.edits)
+                applyLink(edit.parent, edit.child, false);
+            for (const NetLinkEdit &edit : additions.edits)
+                applyLink(edit.parent, edit.child, true);
+            m_updatedNodeSet.erase(node);
+        }
+    };
+}
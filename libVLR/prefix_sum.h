@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "thread_pool.h"
+
+namespace vlr {
+    // JP: 重要度分布の構築用の並列プレフィックス和。
+    //     値をブロックに分割し、ブロック内はKahanの補償加算、ブロック間の繰り上げは倍精度で累積する。
+    //     sum()で全体の和を先に求めるので、scan()では全体の和で正規化しながら書き出せる。
+    // EN: Parallel prefix sum to build importance distributions.
+    //     Values are split into blocks; Kahan compensated summation within a block and double-precision carries between blocks.
+    //     sum() computes the total beforehand, so scan() can write out results normalized by the total.
+    class ParallelPrefixSum {
+        static constexpr uint32_t BlockSize = 1 << 14;
+
+        std::vector<double> m_blockOffsets;
+        uint32_t m_numValues;
+
+        uint32_t getNumBlocks() const {
+            return (m_numValues + BlockSize - 1) / BlockSize;
+        }
+
+    public:
+        ParallelPrefixSum() : m_numValues(0) {}
+
+        // JP: 各ブロックの和を計算し、全体の和を返す。getValue(i)は[0, numValues)の各値を返す。
+        // EN: Compute the sum of each block and return the total. getValue(i) returns each value in [0, numValues).
+        template <typename ValueFunc>
+        double sum(uint32_t numValues, const ValueFunc &getValue) {
+            m_numValues = numValues;
+            uint32_t numBlocks = getNumBlocks();
+            m_blockOffsets.assign(numBlocks + 1, 0.0);
+            ThreadPool::getShared().parallelFor(
+                0, numBlocks, 1,
+                [&](uint32_t blockBegin, uint32_t blockEnd) {
+                for (uint32_t b = blockBegin; b < blockEnd; ++b) {
+                    CompensatedSum<double> blockSum(0.0);
+                    for (uint32_t i = b * BlockSize; i < std::min((b + 1) * BlockSize, m_numValues); ++i)
+                        blockSum += static_cast<double>(getValue(i));
+                    m_blockOffsets[b + 1] = blockSum;
+                }
+            });
+
+            CompensatedSum<double> carry(0.0);
+            for (uint32_t b = 0; b < numBlocks; ++b) {
+                carry += m_blockOffsets[b + 1];
+                m_blockOffsets[b + 1] = carry;
+            }
+
+            return m_blockOffsets[numBlocks];
+        }
+
+        // JP: sum()と同じ値について、各iにi未満の値の和(排他的プレフィックス和)をstore(i, prefix)で渡す。
+        // EN: For the same values as sum(), pass the sum of values before i (exclusive prefix sum) to store(i, prefix) for each i.
+        template <typename ValueFunc, typename StoreFunc>
+        void scan(const ValueFunc &getValue, const StoreFunc &store) const {
+            ThreadPool::getShared().parallelFor(
+                0, getNumBlocks(), 1,
+                [&](uint32_t blockBegin, uint32_t blockEnd) {
+                for (uint32_t b = blockBegin; b < blockEnd; ++b) {
+                    CompensatedSum<double> localSum(0.0);
+                    for (uint32_t i = b * BlockSize; i < std::min((b + 1) * BlockSize, m_numValues); ++i) {
+                        store(i, m_blockOffsets[b] + localSum);
+                        localSum += static_cast<double>(getValue(i));
+                    }
+                }
+            });
+        }
+    };
+
+    // JP: 排他的プレフィックス和をprefix(numValues + 1要素、末尾は全体の和)に書き出し、全体の和を返す。
+    // EN: Write the exclusive prefix sum to prefix (numValues + 1 entries, the last is the total) and return the total.
+    template <typename ValueFunc>
+    double parallelExclusivePrefixSum(uint32_t numValues, const ValueFunc &getValue, double* prefix) {
+        ParallelPrefixSum prefixSum;
+        double total = prefixSum.sum(numValues, getValue);
+        prefixSum.scan(getValue, [prefix](uint32_t i, double value) { prefix[i] = value; });
+        prefix[numValues] = total;
+        return total;
+    }
+}
@@ -26,6 +26,8 @@ namespace vlr {
     const char* EnumTextureFilter = "TextureFilter";
     const char* EnumTextureWrapMode = "TextureWrapMode";
     const char* EnumTangentType = "TangentType";
+    const char* EnumBlockCompressionQuality = "BlockCompressionQuality";
+    const char* EnumImageResidencyPolicy = "ImageResidencyPolicy";
 
     static bool s_enumTableInitialized = false;
     static const std::unordered_map<std::string, std::vector<std::pair<const char*, uint32_t>>> s_enumTables = {
@@ -98,6 +100,20 @@ namespace vlr {
                 {"Radial Z", static_cast<uint32_t>(TangentType::RadialZ)},
             }
         },
+        {
+            EnumBlockCompressionQuality, {
+                {"Fast", static_cast<uint32_t>(BlockCompressionQuality::Fast)},
+                {"Normal", static_cast<uint32_t>(BlockCompressionQuality::Normal)},
+                {"High", static_cast<uint32_t>(BlockCompressionQuality::High)},
+            }
+        },
+        {
+            EnumImageResidencyPolicy, {
+                {"Keep", static_cast<uint32_t>(ImageResidencyPolicy::Keep)},
+                {"DropAfterUpload", static_cast<uint32_t>(ImageResidencyPolicy::DropAfterUpload)},
+                {"SpillToDisk", static_cast<uint32_t>(ImageResidencyPolicy::SpillToDisk)},
+            }
+        },
     };
     static std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>> s_enumNameToIntTables;
     static std::unordered_map<std::string, std::unordered_map<uint32_t, std::string>> s_enumIntToNameTables;
@@ -206,6 +222,8 @@ namespace vlr {
     VLR_DEFINE_GET_ENUM_VALUE_FROM_MEMBER(TextureFilter);
     VLR_DEFINE_GET_ENUM_VALUE_FROM_MEMBER(TextureWrapMode);
     VLR_DEFINE_GET_ENUM_VALUE_FROM_MEMBER(TangentType);
+    VLR_DEFINE_GET_ENUM_VALUE_FROM_MEMBER(BlockCompressionQuality);
+    VLR_DEFINE_GET_ENUM_VALUE_FROM_MEMBER(ImageResidencyPolicy);
 
     VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE(SpectrumType);
     VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE(ColorSpace);
@@ -214,6 +232,8 @@ namespace vlr {
     VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE(TextureFilter);
     VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE(TextureWrapMode);
     VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE(TangentType);
+    VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE(BlockCompressionQuality);
+    VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE(ImageResidencyPolicy);
 
 #undef VLR_DEFINE_GET_ENUM_MEMBER_FROM_VALUE
 #undef VLR_DEFINE_GET_ENUM_VALUE_FROM_MEMBER
@@ -59,6 +59,8 @@ namespace vlr {
     extern const char* EnumTextureFilter;
     extern const char* EnumTextureWrapMode;
     extern const char* EnumTangentType;
+    extern const char* EnumBlockCompressionQuality;
+    extern const char* EnumImageResidencyPolicy;
 
     uint32_t getNumEnumMembers(const char* typeName);
     const char* getEnumMemberAt(const char* typeName, uint32_t index);
@@ -1,44 +1,13 @@
 ﻿#include "scene.h"
+#include "thread_pool.h"
+#include "triangle_setup.h"
 
 namespace vlr {
     // ----------------------------------------------------------------
     // Shallow Hierarchy
 
-    StaticTransform SHTransform::resolveTransform() const {
-        int32_t stackIdx = 0;
-        const SHTransform* stack[10];
-        std::fill_n(stack, lengthof(stack), nullptr);
-        const SHTransform* nextSHTr = m_childIsTransform ? m_childTransform : nullptr;
-        while (nextSHTr) {
-            stack[stackIdx++] = nextSHTr;
-            nextSHTr = nextSHTr->m_childIsTransform ? nextSHTr->m_childTransform : nullptr;
-        }
-
-        StaticTransform res;
-        std::string concatenatedName = "";
-        --stackIdx;
-        while (stackIdx >= 0) {
-            const SHTransform* shtr = stack[stackIdx--];
-            res = shtr->m_transform * res;
-            concatenatedName = "-" + shtr->getName() + concatenatedName;
-        }
-        res = m_transform * res;
-        concatenatedName = m_name + concatenatedName;
-
-        return res;
-
-        //if (true/*m_parent*/) {
-        //    vlrDevPrintf("%s:\n", concatenatedName.c_str());
-        //    vlrDevPrintf("%g, %g, %g, %g\n", mat[0], mat[4], mat[8], mat[12]);
-        //    vlrDevPrintf("%g, %g, %g, %g\n", mat[1], mat[5], mat[9], mat[13]);
-        //    vlrDevPrintf("%g, %g, %g, %g\n", mat[2], mat[6], mat[10], mat[14]);
-        //    vlrDevPrintf("%g, %g, %g, %g\n", mat[3], mat[7], mat[11], mat[15]);
-        //    vlrDevPrintf("\n");
-        //}
-    }
-
     void SHTransform::setTransform(const StaticTransform &transform) {
-        m_transform = transform;
+        m_arena->setLocalMatrix(m_arenaIndex, transform.getMatrix(), transform.getInverseMatrix());
     }
 
     void SHTransform::update() {
@@ -51,7 +20,9 @@ namespace vlr {
 
     StaticTransform SHTransform::getStaticTransform() const {
         if (isStatic()) {
-            return resolveTransform();
+            m_arena->resolve();
+            return StaticTransform(m_arena->getResolvedMatrix(m_arenaIndex),
+                                   m_arena->getResolvedInverseMatrix(m_arenaIndex));
         }
         else {
             VLRAssert_ShouldNotBeCalled();
@@ -99,6 +70,14 @@ namespace vlr {
         TriangleMeshSurfaceNode::finalize(context);
     }
 
+    SurfaceNode::~SurfaceNode() {
+        Scene* editingScene = m_context.getEditingScene();
+        if (editingScene)
+            editingScene->flushNodeEdits(this);
+        while (!m_parents.empty())
+            removeParent(*m_parents.rbegin());
+    }
+
     void SurfaceNode::addParent(ParentNode* parent) {
         VLRAssert(parent != nullptr, "parent must be not null.");
         m_parents.insert(parent);
@@ -136,15 +115,20 @@ namespace vlr {
     }
 
     TriangleMeshSurfaceNode::TriangleMeshSurfaceNode(Context &context, const std::string &name) :
-        SurfaceNode(context, name) {}
+        SurfaceNode(context, name), m_vertexFormat(VLRVertexFormat_Full) {
+        m_context.registerTriangleMesh(this);
+    }
 
     TriangleMeshSurfaceNode::~TriangleMeshSurfaceNode() {
+        m_context.unregisterTriangleMesh(this);
         for (auto it = m_materialGroups.rbegin(); it != m_materialGroups.rend(); ++it) {
             MaterialGroup &matGroup = *it;
             delete matGroup.shGeomInst;
             matGroup.primDist.finalize(m_context);
             matGroup.optixIndexBuffer.finalize();
         }
+        m_optixPreTransform.finalize();
+        m_optixCompactVertexBuffer.finalize();
         m_optixVertexBuffer.finalize();
     }
 
@@ -172,51 +156,118 @@ namespace vlr {
         SurfaceNode::removeParent(parent);
     }
 
-    void TriangleMeshSurfaceNode::setVertices(std::vector<Vertex> &&vertices) {
-        m_vertices = vertices;
+    Point3D TriangleMeshSurfaceNode::getPosition(uint32_t index) const {
+        if (m_vertexFormat == VLRVertexFormat_Compact)
+            return shared::decodeCompactVertexPosition(m_compactVertices[index], m_positionOffset, m_positionScale);
+        return m_vertices[index].position;
+    }
+
+    void TriangleMeshSurfaceNode::setVertexFormat(VLRVertexFormat format) {
+        if (!m_vertices.empty() || !m_compactVertices.empty()) {
+            vlrprintf("%s: The vertex format needs to be set before vertices.\n", m_name.c_str());
+            return;
+        }
+        m_vertexFormat = format;
+    }
 
+    void TriangleMeshSurfaceNode::setVertices(HostArray<Vertex> &&vertices) {
         CUcontext cuContext = m_context.getCUcontext();
-        m_optixVertexBuffer.initialize(cuContext, g_bufferType, m_vertices);
 
-        // TODO: 頂点情報更新時の処理。(IndexBufferとの整合性など)
+        // JP: 2回目以降の呼び出しは既存のマテリアルグループのインデックスを保ったまま頂点を差し替える。
+        // EN: Calls from the second time on replace vertices keeping the indices of the existing material groups.
+        bool isUpdate = m_optixVertexBuffer.isInitialized() || m_optixCompactVertexBuffer.isInitialized();
+        if (isUpdate && !m_materialGroups.empty()) {
+            size_t numCurVertices = m_vertexFormat == VLRVertexFormat_Compact ?
+                m_compactVertices.size() : m_vertices.size();
+            if (vertices.size() != numCurVertices) {
+                vlrprintf("%s: The number of vertices can't be changed after adding material groups.\n", m_name.c_str());
+                return;
+            }
+        }
+
+        if (m_vertexFormat == VLRVertexFormat_Compact) {
+            uint32_t numVertices = vertices.size();
+            m_compactVertices.resize(numVertices);
+            encodeCompactVertices(vertices.data(), numVertices, m_compactVertices.data(),
+                                  &m_positionOffset, &m_positionScale);
+            vertices.release();
+
+            m_optixCompactVertexBuffer.finalize();
+            m_optixCompactVertexBuffer.initialize(cuContext, g_bufferType, m_compactVertices);
+
+            // JP: GASの構築時にSNORM16の位置[-1, 1]^3をメッシュのAABBに戻す行列。
+            // EN: Matrix to bring SNORM16 positions in [-1, 1]^3 back to the mesh AABB when building the GAS.
+            std::vector<float> preTransform = {
+                m_positionScale.x, 0.0f, 0.0f, m_positionOffset.x,
+                0.0f, m_positionScale.y, 0.0f, m_positionOffset.y,
+                0.0f, 0.0f, m_positionScale.z, m_positionOffset.z,
+            };
+            m_optixPreTransform.finalize();
+            m_optixPreTransform.initialize(cuContext, g_bufferType, preTransform);
+        }
+        else {
+            m_vertices = std::move(vertices);
+            m_optixVertexBuffer.finalize();
+            m_optixVertexBuffer.initialize(cuContext, g_bufferType, m_vertices.data(), m_vertices.size());
+        }
+
+        if (!isUpdate || m_materialGroups.empty())
+            return;
+
+        // JP: 頂点位置に依存するAABBと面積の分布を作り直す。
+        // EN: Recreate the AABBs and area distributions which depend on the vertex positions.
+        std::set<const SHGeometryInstance*> delta;
+        for (MaterialGroup &matGroup : m_materialGroups) {
+            std::vector<float> areas;
+            computeTriangleAreas(matGroup, nullptr, &areas, &matGroup.aabb);
+            if (matGroup.material->isEmitting()) {
+                matGroup.primDist.finalize(m_context);
+                matGroup.primDist.initialize(m_context, areas.data(), areas.size(), shared::DistributionLayout::AliasTable);
+            }
+            delta.insert(matGroup.shGeomInst);
+        }
+
+        // JP: 親達にジオメトリインスタンスの更新を行わせる。
+        //     シーンでは更新されたジオメトリインスタンスを含むGASだけがdirtyになる。
+        // EN: Let parents update geometry instances.
+        //     Only the GASes containing the updated geometry instances become dirty in the scene.
+        for (auto it = m_parents.cbegin(); it != m_parents.cend(); ++it) {
+            ParentNode* parent = *it;
+            parent->updateGeometryInstance(delta);
+        }
+    }
+
+    void TriangleMeshSurfaceNode::computeTriangleAreas(
+        const MaterialGroup &matGroup, shared::Triangle* dstTriangles,
+        std::vector<float>* areas, BoundingBox3D* aabb) const {
+        uint32_t numTriangles = matGroup.indices.size() / 3;
+        areas->resize(numTriangles);
+        setupTriangles(matGroup.indices.data(), numTriangles,
+                       [this](uint32_t index) { return getPosition(index); },
+                       dstTriangles, areas->data(), aabb);
     }
 
     void TriangleMeshSurfaceNode::addMaterialGroup(
-        std::vector<uint32_t> &&indices, const SurfaceMaterial* material, 
+        HostArray<uint32_t> &&indices, const SurfaceMaterial* material, 
         const ShaderNodePlug &nodeNormal, const ShaderNodePlug& nodeTangent, const ShaderNodePlug &nodeAlpha) {
         CUcontext cuContext = m_context.getCUcontext();
 
         MaterialGroup matGroup;
-        CompensatedSum<float> sumImportances(0.0f);
         {
             matGroup.indices = std::move(indices);
-            uint32_t numTriangles = static_cast<uint32_t>(matGroup.indices.size()) / 3;
+            uint32_t numTriangles = matGroup.indices.size() / 3;
 
             matGroup.optixIndexBuffer.initialize(cuContext, g_bufferType, numTriangles);
 
             std::vector<float> areas;
-            areas.resize(numTriangles);
-            BoundingBox3D aabb;
             auto dstTriangles = matGroup.optixIndexBuffer.map(0, cudau::BufferMapFlag::WriteOnlyDiscard);
-            for (auto i = 0; i < static_cast<int>(numTriangles); ++i) {
-                uint32_t i0 = matGroup.indices[3 * i + 0];
-                uint32_t i1 = matGroup.indices[3 * i + 1];
-                uint32_t i2 = matGroup.indices[3 * i + 2];
-
-                dstTriangles[i] = shared::Triangle{ i0, i1, i2 };
-
-                const Vertex (&v)[3] = { m_vertices[i0], m_vertices[i1], m_vertices[i2] };
-                areas[i] = 0.5f * cross(v[1].position - v[0].position,
-                                        v[2].position - v[0].position).length();
-                sumImportances += areas[i];
-
-                aabb.unify(v[0].position).unify(v[1].position).unify(v[2].position);
-            }
+            computeTriangleAreas(matGroup, dstTriangles, &areas, &matGroup.aabb);
             matGroup.optixIndexBuffer.unmap(0);
-            matGroup.aabb = aabb;
 
+            // JP: プリミティブ数が多くなり得るのでエイリアステーブルでO(1)サンプルする。
+            // EN: The number of primitives can be large, so sample in O(1) using an alias table.
             if (material->isEmitting())
-                matGroup.primDist.initialize(m_context, areas.data(), areas.size());
+                matGroup.primDist.initialize(m_context, areas.data(), areas.size(), shared::DistributionLayout::AliasTable);
         }
 
         ShaderNodePlug plugNormal;
@@ -263,13 +314,28 @@ namespace vlr {
         }
     }
 
+    CUdeviceptr TriangleMeshSurfaceNode::getPreTransform() const {
+        if (m_vertexFormat == VLRVertexFormat_Compact)
+            return m_optixPreTransform.getCUdeviceptr();
+        return 0;
+    }
+
     void TriangleMeshSurfaceNode::setupData(
         uint32_t userData, uint32_t geomInstIndex,
         optixu::GeometryInstance* optixGeomInst, shared::GeometryInstance* geomInst) const {
         const OptiXProgramSet &progSet = s_optiXProgramSets.at(m_context.getID());
         const MaterialGroup &matGroup = m_materialGroups[userData];
 
-        geomInst->asTriMesh.vertexBuffer = m_optixVertexBuffer.getDevicePointer();
+        if (m_vertexFormat == VLRVertexFormat_Compact) {
+            geomInst->asTriMesh.vertexBuffer = nullptr;
+            geomInst->asTriMesh.compactVertexBuffer = m_optixCompactVertexBuffer.getDevicePointer();
+            geomInst->asTriMesh.positionOffset = m_positionOffset;
+            geomInst->asTriMesh.positionScale = m_positionScale;
+        }
+        else {
+            geomInst->asTriMesh.vertexBuffer = m_optixVertexBuffer.getDevicePointer();
+            geomInst->asTriMesh.compactVertexBuffer = nullptr;
+        }
         geomInst->asTriMesh.triangleBuffer = matGroup.optixIndexBuffer.getDevicePointer();
         matGroup.primDist.getInternalType(&geomInst->asTriMesh.primDistribution);
         geomInst->asTriMesh.aabb = matGroup.aabb;
@@ -288,7 +354,13 @@ namespace vlr {
         optixu::Material optixMaterial = matGroup.nodeAlpha.isValid() ?
             m_context.getOptiXMaterialWithAlpha() :
             m_context.getOptiXMaterialDefault();
-        optixGeomInst->setVertexBuffer(m_optixVertexBuffer);
+        if (m_vertexFormat == VLRVertexFormat_Compact) {
+            optixGeomInst->setVertexFormat(OPTIX_VERTEX_FORMAT_SNORM16_3);
+            optixGeomInst->setVertexBuffer(m_optixCompactVertexBuffer);
+        }
+        else {
+            optixGeomInst->setVertexBuffer(m_optixVertexBuffer);
+        }
         optixGeomInst->setTriangleBuffer(matGroup.optixIndexBuffer);
         optixGeomInst->setNumMaterials(1, optixu::BufferView());
         optixGeomInst->setMaterial(0, 0, optixMaterial);
@@ -357,7 +429,7 @@ namespace vlr {
     }
 
     void PointSurfaceNode::setVertices(std::vector<Vertex> &&vertices) {
-        m_vertices = vertices;
+        m_vertices = std::move(vertices);
 
         CUcontext cuContext = m_context.getCUcontext();
         m_optixVertexBuffer.initialize(cuContext, g_bufferType, m_vertices);
@@ -370,27 +442,19 @@ namespace vlr {
         CUcontext cuContext = m_context.getCUcontext();
 
         MaterialGroup matGroup;
-        CompensatedSum<float> sumImportances(0.0f);
         {
             matGroup.indices = std::move(indices);
             uint32_t numPoints = static_cast<uint32_t>(matGroup.indices.size());
 
             matGroup.optixIndexBuffer.initialize(cuContext, g_bufferType, numPoints);
+            matGroup.optixIndexBuffer.write(matGroup.indices);
 
-            std::vector<float> importances;
-            importances.resize(numPoints);
-            {
-                auto dstPoints = matGroup.optixIndexBuffer.map(0, cudau::BufferMapFlag::WriteOnlyDiscard);
-                for (auto i = 0; i < static_cast<int>(numPoints); ++i) {
-                    dstPoints[i] = matGroup.indices[i];
-                    importances[i] = 1.0f;
-                    sumImportances += importances[i];
-                }
-                matGroup.optixIndexBuffer.unmap(0);
-            }
+            std::vector<float> importances(numPoints, 1.0f);
 
+            // JP: プリミティブ数が多くなり得るのでエイリアステーブルでO(1)サンプルする。
+            // EN: The number of primitives can be large, so sample in O(1) using an alias table.
             if (material->isEmitting())
-                matGroup.primDist.initialize(m_context, importances.data(), importances.size());
+                matGroup.primDist.initialize(m_context, importances.data(), importances.size(), shared::DistributionLayout::AliasTable);
         }
 
         matGroup.material = material;
@@ -519,7 +583,7 @@ namespace vlr {
         m_shGeomGroup = new SHGeometryGroup();
         if (m_localToWorld->isStatic()) {
             auto tr = dynamic_cast<const StaticTransform*>(m_localToWorld);
-            SHTransform* shtr = new SHTransform(name, *tr, m_shGeomGroup);
+            SHTransform* shtr = new SHTransform(&m_context.getSHTransformArena(), name, *tr, m_shGeomGroup);
             m_shTransforms[nullptr] = shtr;
         }
         else {
@@ -541,7 +605,7 @@ namespace vlr {
             it->second->setName(name);
     }
 
-    void ParentNode::createConcatanatedTransforms(const std::set<SHTransform*> &childDelta, std::set<SHTransform*>* delta) {
+    void ParentNode::createConcatanatedTransforms(const std::vector<SHTransform*> &childDelta, std::vector<SHTransform*>* delta) {
         // JP: 自分自身のTransformと子InternalNodeが持つSHTransformを繋げたSHTransformを生成。
         //     子のSHTransformをキーとして辞書に保存する。
         // EN: Create a SHTransform concatenating own transform and a child internal node's transform.
@@ -549,10 +613,10 @@ namespace vlr {
         for (auto it = childDelta.cbegin(); it != childDelta.cend(); ++it) {
             if (m_localToWorld->isStatic()) {
                 auto tr = dynamic_cast<const StaticTransform*>(m_localToWorld);
-                SHTransform* shtr = new SHTransform(m_name, *tr, *it);
+                SHTransform* shtr = new SHTransform(&m_context.getSHTransformArena(), m_name, *tr, *it);
                 m_shTransforms[*it] = shtr;
                 if (delta)
-                    delta->insert(shtr);
+                    delta->push_back(shtr);
             }
             else {
                 VLRAssert_NotImplemented();
@@ -560,25 +624,25 @@ namespace vlr {
         }
     }
 
-    void ParentNode::removeConcatanatedTransforms(const std::set<SHTransform*> &childDelta, std::set<SHTransform*>* delta) {
+    void ParentNode::removeConcatanatedTransforms(const std::vector<SHTransform*> &childDelta, std::vector<SHTransform*>* delta) {
         // JP: 
         // EN: 
         for (auto it = childDelta.cbegin(); it != childDelta.cend(); ++it) {
             SHTransform* shtr = m_shTransforms.at(*it);
             m_shTransforms.erase(*it);
             if (delta)
-                delta->insert(shtr);
+                delta->push_back(shtr);
         }
     }
 
-    void ParentNode::updateConcatanatedTransforms(const std::set<SHTransform*> &childDelta, std::set<SHTransform*>* delta) {
+    void ParentNode::updateConcatanatedTransforms(const std::vector<SHTransform*> &childDelta, std::vector<SHTransform*>* delta) {
         // JP: 
         // EN: 
         for (auto it = childDelta.cbegin(); it != childDelta.cend(); ++it) {
             SHTransform* shtr = m_shTransforms.at(*it);
             shtr->update();
             if (delta)
-                delta->insert(shtr);
+                delta->push_back(shtr);
         }
     }
 
@@ -632,12 +696,28 @@ namespace vlr {
         }
     }
 
+    void ParentNode::linkChild(Node* child) {
+        Scene* editingScene = m_context.getEditingScene();
+        if (editingScene)
+            editingScene->recordLink(this, child, true);
+        else
+            child->addParent(this);
+    }
+
+    void ParentNode::unlinkChild(Node* child) {
+        Scene* editingScene = m_context.getEditingScene();
+        if (editingScene)
+            editingScene->recordLink(this, child, false);
+        else
+            child->removeParent(this);
+    }
+
     void ParentNode::addChild(InternalNode* child) {
         if (m_children.count(child) > 0)
             return;
         m_children.insert(child);
         m_orderedChildren.push_back(child);
-        child->addParent(this);
+        linkChild(child);
     }
 
     void ParentNode::removeChild(InternalNode* child) {
@@ -646,7 +726,7 @@ namespace vlr {
         m_children.erase(child);
         auto idx = std::find(m_orderedChildren.cbegin(), m_orderedChildren.cend(), child);
         m_orderedChildren.erase(idx);
-        child->removeParent(this);
+        unlinkChild(child);
     }
 
     void ParentNode::addChild(SurfaceNode* child) {
@@ -654,7 +734,7 @@ namespace vlr {
             return;
         m_children.insert(child);
         m_orderedChildren.push_back(child);
-        child->addParent(this);
+        linkChild(child);
     }
 
     void ParentNode::removeChild(SurfaceNode* child) {
@@ -663,7 +743,7 @@ namespace vlr {
         m_children.erase(child);
         auto idx = std::find(m_orderedChildren.cbegin(), m_orderedChildren.cend(), child);
         m_orderedChildren.erase(idx);
-        child->removeParent(this);
+        unlinkChild(child);
     }
 
     uint32_t ParentNode::getNumChildren() const {
@@ -687,12 +767,25 @@ namespace vlr {
     }
 
     InternalNode::~InternalNode() {
+        Scene* editingScene = m_context.getEditingScene();
+        if (editingScene)
+            editingScene->flushNodeEdits(this);
         for (vlr::Node* child : m_orderedChildren)
             child->removeParent(this);
     }
 
-    void InternalNode::transformAddEvent(const std::set<SHTransform*> &childDelta) {
-        std::set<SHTransform*> delta;
+    void InternalNode::transformAddEvent(const std::vector<SHTransform*> &childDelta) {
+        // JP: 親が無い場合は増分を通知する先が無いので作らない。
+        //     ワイドなツリーを上から構築する場合に各レベルで増分を作り直さずに済む。
+        // EN: Don't build the delta when there is no parent to notify it.
+        //     This avoids rebuilding the delta at every level when a wide tree is built top-down.
+        if (m_parents.empty()) {
+            createConcatanatedTransforms(childDelta, nullptr);
+            return;
+        }
+
+        std::vector<SHTransform*> delta;
+        delta.reserve(childDelta.size());
         createConcatanatedTransforms(childDelta, &delta);
         VLRAssert(childDelta.size() == delta.size(), "The number of elements must match.");
 
@@ -704,8 +797,9 @@ namespace vlr {
         }
     }
 
-    void InternalNode::transformRemoveEvent(const std::set<SHTransform*> &childDelta) {
-        std::set<SHTransform*> delta;
+    void InternalNode::transformRemoveEvent(const std::vector<SHTransform*> &childDelta) {
+        std::vector<SHTransform*> delta;
+        delta.reserve(childDelta.size());
         removeConcatanatedTransforms(childDelta, &delta);
         VLRAssert(childDelta.size() == delta.size(), "The number of elements must match.");
 
@@ -720,8 +814,14 @@ namespace vlr {
             delete *it;
     }
 
-    void InternalNode::transformUpdateEvent(const std::set<SHTransform*> &childDelta) {
-        std::set<SHTransform*> delta;
+    void InternalNode::transformUpdateEvent(const std::vector<SHTransform*> &childDelta) {
+        if (m_parents.empty()) {
+            updateConcatanatedTransforms(childDelta, nullptr);
+            return;
+        }
+
+        std::vector<SHTransform*> delta;
+        delta.reserve(childDelta.size());
         updateConcatanatedTransforms(childDelta, &delta);
         VLRAssert(childDelta.size() == delta.size(), "The number of elements must match.");
 
@@ -775,9 +875,18 @@ namespace vlr {
     void InternalNode::setTransform(const Transform* localToWorld) {
         ParentNode::setTransform(localToWorld);
 
-        std::set<SHTransform*> delta;
+        Scene* editingScene = m_context.getEditingScene();
+        if (editingScene)
+            editingScene->recordTransformUpdate(this);
+        else
+            propagateTransformUpdate();
+    }
+
+    void InternalNode::propagateTransformUpdate() {
+        std::vector<SHTransform*> delta;
+        delta.reserve(m_shTransforms.size());
         for (auto it = m_shTransforms.cbegin(); it != m_shTransforms.cend(); ++it)
-            delta.insert(it->second);
+            delta.push_back(it->second);
 
         // JP: 親達に変形情報が更新されたことを通知する。
         // EN: Notify parents that the transforms has been updated.
@@ -791,9 +900,10 @@ namespace vlr {
         VLRAssert(parent != nullptr, "parent must be not null.");
         m_parents.insert(parent);
 
-        std::set<SHTransform*> delta;
+        std::vector<SHTransform*> delta;
+        delta.reserve(m_shTransforms.size());
         for (auto it = m_shTransforms.cbegin(); it != m_shTransforms.cend(); ++it)
-            delta.insert(it->second);
+            delta.push_back(it->second);
 
         // JP: 追加した親に「親自身のTransformとこのノードが管理するSHTransformの連結SHTransform」の追加を行わせる。
         // EN: Let the new parent add
@@ -830,9 +940,10 @@ namespace vlr {
                 parent->geometryRemoveEvent(shtr, children);
         }
 
-        std::set<SHTransform*> delta;
+        std::vector<SHTransform*> delta;
+        delta.reserve(m_shTransforms.size());
         for (auto it = m_shTransforms.cbegin(); it != m_shTransforms.cend(); ++it)
-            delta.insert(it->second);
+            delta.push_back(it->second);
 
         // JP: 削除される親に「親自身のTransformとこのノードが管理するSHTransformの連結SHTransform」の削除を行わせる。
         // EN: Let the parent being removed remove
@@ -853,7 +964,8 @@ namespace vlr {
     
     Scene::Scene(Context &context, const Transform* localToWorld) :
         ParentNode(context, "Root", localToWorld),
-        m_iasIsDirty(true),
+        m_iasIsDirty(true), m_lightInstSetIsDirty(true),
+        m_editNestCount(0), m_iasChildrenAreDirty(false),
         m_matEnv(nullptr), m_envNode(nullptr), m_envIsDirty(false) {
         CUcontext cuContext = m_context.getCUcontext();
 
@@ -873,7 +985,6 @@ namespace vlr {
         {
             m_envGeomInst = {};
             m_envGeomInst.geomInstIndex = m_geomInstBuffer.allocate();
-            m_envGeomInst.referenceCount = 1;
             m_envGeomInst.data.isActive = false;
 
             m_envInst = {};
@@ -912,8 +1023,24 @@ namespace vlr {
     }
 
     Scene::~Scene() {
+        // JP: 記録済みのノードの変更を適用してから子を外す。子を外す間のIASの更新は行わない。
+        // EN: Apply recorded node edits before removing children. Don't update the IAS while removing children.
+        if (m_context.getEditingScene() == this) {
+            applyNodeEdits();
+            m_context.setEditingScene(nullptr);
+        }
+        ++m_editNestCount;
         for (vlr::Node* child : m_orderedChildren)
             child->removeParent(this);
+        if (!m_pendingDestroyedInstances.empty()) {
+            m_ias.clearChildren();
+            for (optixu::Instance &optixInst : m_pendingDestroyedInstances)
+                optixInst.destroy();
+            m_pendingDestroyedInstances.clear();
+        }
+        for (optixu::GeometryInstance &optixGeomInst : m_pendingDestroyedGeometryInstances)
+            optixGeomInst.destroy();
+        m_pendingDestroyedGeometryInstances.clear();
 
         if (m_envNode)
             delete m_envNode;
@@ -955,8 +1082,9 @@ namespace vlr {
         m_geomInstBuffer.finalize();
     }
 
-    void Scene::transformAddEvent(const std::set<SHTransform*> &childDelta) {
-        std::set<SHTransform*> concatDelta;
+    void Scene::transformAddEvent(const std::vector<SHTransform*> &childDelta) {
+        std::vector<SHTransform*> concatDelta;
+        concatDelta.reserve(childDelta.size());
         createConcatanatedTransforms(childDelta, &concatDelta);
         VLRAssert(childDelta.size() == concatDelta.size(), "The number of elements must match.");
 
@@ -973,10 +1101,12 @@ namespace vlr {
             inst.data.importance = 0.0f;
             inst.data.isActive = false;
         }
+        m_lightInstSetIsDirty = true;
     }
 
-    void Scene::transformRemoveEvent(const std::set<SHTransform*> &childDelta) {
-        std::set<SHTransform*> concatDelta;
+    void Scene::transformRemoveEvent(const std::vector<SHTransform*> &childDelta) {
+        std::vector<SHTransform*> concatDelta;
+        concatDelta.reserve(childDelta.size());
         removeConcatanatedTransforms(childDelta, &concatDelta);
         VLRAssert(childDelta.size() == concatDelta.size(), "The number of elements must match.");
 
@@ -986,16 +1116,23 @@ namespace vlr {
             SHTransform* shtr = *it;
 
             Instance &inst = m_instances.at(shtr);
-            uint32_t instIdxInIas = m_ias.findChildIndex(inst.optixInst);
-            if (instIdxInIas != 0xFFFFFFFF)
-                m_ias.removeChildAt(instIdxInIas);
+            if (m_editNestCount > 0) {
+                m_pendingDestroyedInstances.push_back(inst.optixInst);
+                m_iasChildrenAreDirty = true;
+            }
+            else {
+                uint32_t instIdxInIas = m_ias.findChildIndex(inst.optixInst);
+                if (instIdxInIas != 0xFFFFFFFF)
+                    m_ias.removeChildAt(instIdxInIas);
+                inst.optixInst.destroy();
+            }
             uint32_t instIndex = inst.instIndex;
-            inst.optixInst.destroy();
             m_instBuffer.release(instIndex);
             m_instances.erase(shtr);
             m_dirtyInstances.erase(shtr);
             m_removedInstanceIndices.insert(instIndex);
         }
+        m_lightInstSetIsDirty = true;
 
         for (auto it = concatDelta.cbegin(); it != concatDelta.cend(); ++it)
             delete *it;
@@ -1003,8 +1140,9 @@ namespace vlr {
         m_iasIsDirty = true;
     }
 
-    void Scene::transformUpdateEvent(const std::set<SHTransform*> &childDelta) {
-        std::set<SHTransform*> delta;
+    void Scene::transformUpdateEvent(const std::vector<SHTransform*> &childDelta) {
+        std::vector<SHTransform*> delta;
+        delta.reserve(childDelta.size());
         updateConcatanatedTransforms(childDelta, &delta);
         VLRAssert(childDelta.size() == delta.size(), "The number of elements must match.");
 
@@ -1020,29 +1158,24 @@ namespace vlr {
 
     void Scene::geometryAddEvent(const SHTransform* childTransform,
                                  const std::set<const SHGeometryInstance*> &childDelta) {
+        // JP: トランスフォームパスに含まれるジオメトリグループに対応するGASにジオメトリインスタンスを追加する。
+        // EN: Add geometry instances to the GAS corresponding to a geometry group
+        //     contained in the transform path.
+        const SHTransform* shtr = m_shTransforms.at(childTransform);
+        const SHGeometryGroup* shGeomGroup = shtr->getGeometryDescendant();
+        std::vector<const SHGeometryInstance*> newGeomInsts;
+        bool isNewGeomGroup = m_geometryTracker.addChildren(shGeomGroup, childDelta, &newGeomInsts);
+
         // JP: 追加されたジオメトリインスタンスをOptiX上に生成する。
         // EN: Create the added geometry instances on OptiX.
-        for (const SHGeometryInstance* shGeomInst : childDelta) {
-            if (m_geometryInstances.count(shGeomInst) > 0) {
-                GeometryInstance &geomInst = m_geometryInstances.at(shGeomInst);
-                ++geomInst.referenceCount;
-                continue;
-            }
+        for (const SHGeometryInstance* shGeomInst : newGeomInsts) {
             GeometryInstance &geomInst = m_geometryInstances[shGeomInst];
             geomInst = {};
             geomInst.geomInstIndex = m_geomInstBuffer.allocate();
             if (shGeomInst->surfNode->isIntersectable())
                 geomInst.optixGeomInst = m_optixScene.createGeometryInstance();
-            geomInst.referenceCount = 1;
-            m_dirtyGeometryInstances.insert(shGeomInst);
         }
 
-        // JP: トランスフォームパスに含まれるジオメトリグループに対応するGASにジオメトリインスタンスを追加する。
-        // EN: Add geometry instances to the GAS corresponding to a geometry group
-        //     contained in the transform path.
-        const SHTransform* shtr = m_shTransforms.at(childTransform);
-        const SHGeometryGroup* shGeomGroup = shtr->getGeometryDescendant();
-        bool isNewGeomGroup = m_geometryASes.count(shGeomGroup) == 0;
         if (isNewGeomGroup) {
             GeometryAS &gas = m_geometryASes[shGeomGroup];
             gas.optixGas = m_optixScene.createGeometryAccelerationStructure();
@@ -1050,20 +1183,16 @@ namespace vlr {
             gas.optixGas.setNumMaterialSets(1);
             gas.optixGas.setNumRayTypes(0, shared::MaxNumRayTypes);
         }
-        GeometryAS &gas = m_geometryASes.at(shGeomGroup);
-        for (const SHGeometryInstance* shGeomInst : childDelta) {
-            GeometryInstance &geomInst = m_geometryInstances.at(shGeomInst);
-            if (shGeomInst->surfNode->isIntersectable() &&
-                gas.optixGas.findChildIndex(geomInst.optixGeomInst) == 0xFFFFFFFF)
-                gas.optixGas.addChild(geomInst.optixGeomInst);
-        }
-        m_dirtyGeometryASes.insert(shGeomGroup);
 
         // JP: トランスフォームパスに対応するインスタンスにGASをセット、IASにインスタンスを追加する。
+        //     IASの子の一覧の作り直しが控えている場合はそれに任せる。
         // EN: Set the GAS to the instance corresponding to the transform path, then add the instance to the IAS.
+        //     Leave it to the rebuild of the list of IAS children if one is pending.
         const Instance &inst = m_instances.at(shtr);
         inst.optixInst.setChild(m_geometryASes.at(shGeomGroup).optixGas);
-        if (m_ias.findChildIndex(inst.optixInst) == 0xFFFFFFFF)
+        if (m_editNestCount > 0)
+            m_iasChildrenAreDirty = true;
+        else if (!m_iasChildrenAreDirty && m_ias.findChildIndex(inst.optixInst) == 0xFFFFFFFF)
             m_ias.addChild(inst.optixInst);
         m_dirtyInstances.insert(shtr);
 
@@ -1074,52 +1203,50 @@ namespace vlr {
                                     const std::set<const SHGeometryInstance*> &childDelta) {
         const SHTransform* shtr = m_shTransforms.at(childTransform);
         const SHGeometryGroup* shGeomGroup = shtr->getGeometryDescendant();
-        GeometryAS &gas = m_geometryASes.at(shGeomGroup);
 
         // JP: トランスフォームパスに含まれるジオメトリグループに対応するGASからジオメトリインスタンスを削除する。
-        //     削除されるジオメトリインスタンスをOptiX上からも削除する。
+        //     GASの子は他のGASと独立に参照を数え、ジオメトリインスタンス自体は全ての参照が無くなった時点で削除する。
+        //     OptiXのGASがまだ参照し得るので、OptiX上のジオメトリインスタンスの破棄はprepareSetup()まで遅らせる。
         // EN: Remove geometry instances from the GAS corresponding to a geometry group
         //     contained in the transform path.
-        //     Remove the geometry instances being removed also from OptiX.
-        uint32_t numRemovedGeomInsts = 0;
-        for (const SHGeometryInstance* shGeomInst : childDelta) {
+        //     Children of a GAS are reference-counted independently of other GASes,
+        //     and a geometry instance itself is removed when all the references are gone.
+        //     The OptiX GAS may still refer to it, so destruction of the geometry instance on OptiX
+        //     is deferred until prepareSetup().
+        std::vector<const SHGeometryInstance*> removedGeomInsts;
+        bool isEmptyGeomGroup;
+        uint32_t numRemovedGeomInsts = m_geometryTracker.removeChildren(
+            shGeomGroup, childDelta, &removedGeomInsts, &isEmptyGeomGroup);
+        for (const SHGeometryInstance* shGeomInst : removedGeomInsts) {
             GeometryInstance &geomInst = m_geometryInstances.at(shGeomInst);
-            if (--geomInst.referenceCount > 0)
-                continue;
-            if (shGeomInst->surfNode->isIntersectable())
-                gas.optixGas.removeChildAt(gas.optixGas.findChildIndex(geomInst.optixGeomInst));
-            ++numRemovedGeomInsts;
-
-            geomInst.optixGeomInst.destroy();
+            if (geomInst.optixGeomInst)
+                m_pendingDestroyedGeometryInstances.push_back(geomInst.optixGeomInst);
             uint32_t geomInstIndex = geomInst.geomInstIndex;
             m_geomInstBuffer.release(geomInstIndex);
             m_geometryInstances.erase(shGeomInst);
-            m_dirtyGeometryInstances.erase(shGeomInst);
             m_removedGeometryInstanceIndices.insert(geomInstIndex);
         }
 
         // JP: 空になったGASは削除する。
         // EN: Remove the GAS if empty.
-        bool isEmptyGeomGroup = gas.optixGas.getNumChildren() == 0;
         if (isEmptyGeomGroup) {
+            GeometryAS &gas = m_geometryASes.at(shGeomGroup);
             gas.optixGasMem.finalize();
             gas.optixGas.destroy();
             m_geometryASes.erase(shGeomGroup);
         }
-        else {
-            if (numRemovedGeomInsts > 0)
-                m_dirtyGeometryASes.insert(shGeomGroup);
-        }
 
-        // JP: トランスフォームパスに対応するインスタンスをIASから削除する。
-        // EN: Remove the instance corresponding to the transform path from the IAS.
+        // JP: GASが削除された場合は、同じジオメトリグループに至る全てのトランスフォームパスのインスタンスをIASから外す。
+        //     該当するインスタンスはこのパスに限らないので、IASの子の一覧を作り直す。
+        //     編集中でなくても作り直しはコミットかprepareSetup()まで遅らせ、削除のたびに全インスタンスを走査しない。
+        // EN: When the GAS is removed, remove instances of all transform paths reaching the same geometry group
+        //     from the IAS.
+        //     The corresponding instances aren't limited to this path, so rebuild the list of children of the IAS.
+        //     Even outside of edits, defer the rebuild until a commit or prepareSetup()
+        //     so that each removal doesn't scan all the instances.
         if (numRemovedGeomInsts > 0) {
-            if (isEmptyGeomGroup) {
-                Instance &inst = m_instances.at(shtr);
-                uint32_t instIdxInIas = m_ias.findChildIndex(inst.optixInst);
-                if (instIdxInIas != 0xFFFFFFFF)
-                    m_ias.removeChildAt(instIdxInIas);
-            }
+            if (isEmptyGeomGroup)
+                m_iasChildrenAreDirty = true;
             m_dirtyInstances.insert(shtr);
         }
 
@@ -1128,16 +1255,13 @@ namespace vlr {
 
     void Scene::geometryUpdateEvent(const SHTransform* childTransform,
                                     const std::set<const SHGeometryInstance*> &childDelta) {
-        // JP: 更新されるジオメトリインスタンスをdirtyとしてマークする。
-        // EN: Mark the geometry instances being updated as dirty.
-        for (const SHGeometryInstance* shGeomInst : childDelta)
-            m_dirtyGeometryInstances.insert(shGeomInst);
-
-        // JP: トランスフォームパスに含まれるジオメトリグループに対応するGASをdirtyとしてマークする。
-        // EN: Mark the GAS corresponding to a geometry group contained in the transform path as dirty.
+        // JP: 更新されるジオメトリインスタンスと、トランスフォームパスに含まれるジオメトリグループに対応するGASを
+        //     dirtyとしてマークする。
+        // EN: Mark the geometry instances being updated and the GAS corresponding to a geometry group
+        //     contained in the transform path as dirty.
         const SHTransform* shtr = m_shTransforms.at(childTransform);
         const SHGeometryGroup* shGeomGroup = shtr->getGeometryDescendant();
-        m_dirtyGeometryASes.insert(shGeomGroup);
+        m_geometryTracker.updateChildren(shGeomGroup, childDelta);
 
         // JP: トランスフォームパスに対応するインスタンスをdirtyとしてマークする。
         // EN: Mark the instance corresponding to the transform path as dirty.
@@ -1146,7 +1270,99 @@ namespace vlr {
         m_iasIsDirty = true;
     }
 
+    void Scene::applyPendingEdits() {
+        if (m_iasChildrenAreDirty) {
+            // JP: 空でないGASを子に持つインスタンスがIASの子となる。
+            //     インスタンスのインデックス順に並べて結果を決定的にする。
+            // EN: Instances having a non-empty GAS as the child become children of the IAS.
+            //     Sort them in the order of instance indices to make the result deterministic.
+            std::vector<std::pair<uint32_t, optixu::Instance>> children;
+            children.reserve(m_instances.size());
+            for (auto it = m_instances.cbegin(); it != m_instances.cend(); ++it) {
+                if (m_geometryASes.count(it->first->getGeometryDescendant()) > 0)
+                    children.emplace_back(it->second.instIndex, it->second.optixInst);
+            }
+            std::sort(children.begin(), children.end(),
+                      [](const std::pair<uint32_t, optixu::Instance> &a, const std::pair<uint32_t, optixu::Instance> &b) {
+                          return a.first < b.first;
+                      });
+            std::vector<optixu::Instance> optixInsts(children.size());
+            for (uint32_t i = 0; i < children.size(); ++i)
+                optixInsts[i] = children[i].second;
+            m_ias.setChildren(optixInsts.data(), static_cast<uint32_t>(optixInsts.size()));
+
+            m_iasChildrenAreDirty = false;
+            m_iasIsDirty = true;
+        }
+
+        // JP: IASの子の一覧を作り直した後ならインスタンスを破棄できる。
+        // EN: Instances can be destroyed after rebuilding the list of children of the IAS.
+        for (optixu::Instance &optixInst : m_pendingDestroyedInstances)
+            optixInst.destroy();
+        m_pendingDestroyedInstances.clear();
+    }
+
+    static void applyNodeLink(Node* parent, Node* child, bool linked) {
+        if (linked)
+            child->addParent(static_cast<ParentNode*>(parent));
+        else
+            child->removeParent(static_cast<ParentNode*>(parent));
+    }
+
+    void Scene::applyNodeEdits() {
+        m_nodeEditQueue.apply(
+            applyNodeLink,
+            [](Node* node) {
+                static_cast<InternalNode*>(node)->propagateTransformUpdate();
+            });
+    }
+
+    void Scene::beginEdits() {
+        if (m_editNestCount++ == 0) {
+            VLRAssert(m_context.getEditingScene() == nullptr, "Another scene is being edited.");
+            m_context.setEditingScene(this);
+        }
+    }
+
+    void Scene::commitEdits() {
+        VLRAssert(m_editNestCount > 0, "commitEdits() is called without beginEdits().");
+        if (m_editNestCount > 1) {
+            --m_editNestCount;
+            return;
+        }
+        // JP: ノードのイベントはIASの子の更新を遅らせたまま伝播させ、その後IASの子をまとめて作り直す。
+        // EN: Propagate node events with updates of IAS children still deferred,
+        //     then rebuild the children of the IAS at once.
+        applyNodeEdits();
+        m_context.setEditingScene(nullptr);
+        m_editNestCount = 0;
+        applyPendingEdits();
+    }
+
+    void Scene::recordLink(ParentNode* parent, Node* child, bool linked) {
+        if (linked)
+            m_nodeEditQueue.addLink(parent, child);
+        else
+            m_nodeEditQueue.removeLink(parent, child);
+    }
+
+    void Scene::recordTransformUpdate(InternalNode* node) {
+        m_nodeEditQueue.updateNode(node);
+    }
+
+    void Scene::flushNodeEdits(Node* node) {
+        m_nodeEditQueue.flushNode(node, applyNodeLink);
+    }
+
     void Scene::prepareSetup(size_t* asScratchSize, optixu::Scene* optixScene) {
+        if (m_editNestCount > 0) {
+            vlrprintf("Scene edits haven't been committed before rendering. Applying pending edits.\n");
+            applyNodeEdits();
+        }
+        // JP: 編集の外で遅らせたIASの子の作り直しもここで行う。
+        // EN: Also do the rebuild of IAS children deferred outside of edits here.
+        applyPendingEdits();
+
         CUcontext cuContext = m_context.getCUcontext();
         *asScratchSize = 0;
 
@@ -1157,17 +1373,38 @@ namespace vlr {
 
         // JP: GPUに送るジオメトリインスタンスのデータをセットアップする。
         // EN: Setup the geometry instance data sent to a GPU.
-        for (const SHGeometryInstance* shGeomInst : m_dirtyGeometryInstances) {
+        for (const SHGeometryInstance* shGeomInst : m_geometryTracker.getDirtyGeometryInstances()) {
             GeometryInstance &geomInst = m_geometryInstances.at(shGeomInst);
             shGeomInst->surfNode->setupData(
                 shGeomInst->userData, geomInst.geomInstIndex, &geomInst.optixGeomInst, &geomInst.data);
         }
 
-        // JP: GASのメモリを初期化していない、もしくはサイズが足りない場合にのみ確保を行う。
+        // JP: 子が変わったGASはOptiX上の子をまとめて設定し直す。
+        //     GASのメモリを初期化していない、もしくはサイズが足りない場合にのみ確保を行う。
         //     既に必要なサイズ以上を確保している場合は何もしない。
-        // EN: GAS memory allocation is done only when it is not initialized or the size is insufficient.
-        for (const SHGeometryGroup* shGeomGroup : m_dirtyGeometryASes) {
+        // EN: Set the children on OptiX at once for GASes whose children have changed.
+        //     GAS memory allocation is done only when it is not initialized or the size is insufficient.
+        std::vector<optixu::GeometryInstance> optixGeomInsts;
+        std::vector<CUdeviceptr> preTransforms;
+        for (const SHGeometryGroup* shGeomGroup : m_geometryTracker.getDirtyGeometryASes()) {
             GeometryAS &gas = m_geometryASes.at(shGeomGroup);
+            if (m_geometryTracker.childrenAreDirty(shGeomGroup)) {
+                const auto &children = m_geometryTracker.getChildren(shGeomGroup);
+                optixGeomInsts.clear();
+                preTransforms.clear();
+                for (uint32_t i = 0; i < children.size(); ++i) {
+                    const SHGeometryInstance* shGeomInst = children.keyAt(i);
+                    const SurfaceNode* surfNode = shGeomInst->surfNode;
+                    if (!surfNode->isIntersectable())
+                        continue;
+                    optixGeomInsts.push_back(m_geometryInstances.at(shGeomInst).optixGeomInst);
+                    preTransforms.push_back(surfNode->getPreTransform());
+                }
+                gas.optixGas.setChildren(optixGeomInsts.data(), preTransforms.data(),
+                                         static_cast<uint32_t>(optixGeomInsts.size()));
+                m_geometryTracker.clearChildrenDirty(shGeomGroup);
+            }
+
             OptixAccelBufferSizes asSizes;
             gas.optixGas.prepareForBuild(&asSizes);
             if (asSizes.outputSizeInBytes > 0 &&
@@ -1181,6 +1418,12 @@ namespace vlr {
                 *asScratchSize, asSizes.tempSizeInBytes, asSizes.tempUpdateSizeInBytes });
         }
 
+        // JP: 全てのGASの子を設定し直した後ならジオメトリインスタンスを破棄できる。
+        // EN: Geometry instances can be destroyed after setting the children of all GASes again.
+        for (optixu::GeometryInstance &optixGeomInst : m_pendingDestroyedGeometryInstances)
+            optixGeomInst.destroy();
+        m_pendingDestroyedGeometryInstances.clear();
+
         // JP: IASのメモリを初期化していない、もしくはサイズが足りない場合にのみ確保を行う。
         //     既に必要なサイズ以上を確保している場合は何もしない。
         // EN: IAS memory allocation is done only when it is not initialized or the size is insufficient.
@@ -1208,11 +1451,11 @@ namespace vlr {
 
         // JP: ジオメトリインスタンスのデータをGPUに転送する。
         // EN: Transfer the geometry instance data to a GPU.
-        for (const SHGeometryInstance* shGeomInst : m_dirtyGeometryInstances) {
+        for (const SHGeometryInstance* shGeomInst : m_geometryTracker.getDirtyGeometryInstances()) {
             GeometryInstance &geomInst = m_geometryInstances.at(shGeomInst);
             m_geomInstBuffer.update(geomInst.geomInstIndex, geomInst.data, stream);
         }
-        m_dirtyGeometryInstances.clear();
+        m_geometryTracker.clearDirtyGeometryInstances();
         for (uint32_t geomInstIndex : m_removedGeometryInstanceIndices) {
             shared::GeometryInstance initialGeomInst = {};
             initialGeomInst.isActive = false;
@@ -1316,11 +1559,11 @@ namespace vlr {
 
         // JP: dirtyとしてマークされているGASをビルドする。
         // EN: Build GASes marked as dirty.
-        for (const SHGeometryGroup* shGeomGroup : m_dirtyGeometryASes) {
+        for (const SHGeometryGroup* shGeomGroup : m_geometryTracker.getDirtyGeometryASes()) {
             GeometryAS &gas = m_geometryASes.at(shGeomGroup);
             gas.optixGas.rebuild(stream, gas.optixGasMem, asScratchMem);
         }
-        m_dirtyGeometryASes.clear();
+        m_geometryTracker.clearDirtyGeometryASes();
 
         // JP: IASがdirtyな場合はビルドを行う。
         // EN: Build the IAS when marked as dirty.
@@ -1377,19 +1620,43 @@ namespace vlr {
             //       sceneBounds.center.x, sceneBounds.center.y, sceneBounds.center.z,
             //       sceneBounds.worldDiscArea);
 
-            std::vector<uint32_t> instIndices;
-            instIndices.push_back(m_envInst.instIndex);
-            for (auto &it : m_instances)
-                instIndices.push_back(it.second.instIndex);
-            m_lightInstIndices.finalize();
-            m_lightInstIndices.initialize(cuContext, g_bufferType, instIndices, stream);
-
             std::vector<float> lightImportances;
             lightImportances.push_back(m_envInst.data.importance);
             for (auto &it : m_instances)
                 lightImportances.push_back(it.second.data.importance);
-            m_lightInstDist.finalize(m_context);
-            m_lightInstDist.initialize(m_context, lightImportances.data(), lightImportances.size());
+
+            // JP: インスタンスの集合が変わっていなければ重要度が変化したインスタンスだけを和の木に反映する。
+            //     マテリアルの編集などで一部の重要度だけが変わる場合に分布全体の再構築と転送を避けられる。
+            // EN: Apply only the instances whose importance changed to the sum tree unless the set of instances changed.
+            //     This avoids rebuilding and transferring the whole distribution
+            //     when only some importances change, e.g. by material edits.
+            if (!m_lightInstSetIsDirty && m_lightInstDist.isInitialized() &&
+                m_lightInstImportances.size() == lightImportances.size()) {
+                std::vector<uint32_t> updatedIndices;
+                std::vector<float> updatedImportances;
+                for (uint32_t i = 0; i < lightImportances.size(); ++i) {
+                    if (lightImportances[i] != m_lightInstImportances[i]) {
+                        updatedIndices.push_back(i);
+                        updatedImportances.push_back(lightImportances[i]);
+                    }
+                }
+                m_lightInstDist.updateValues(m_context, updatedIndices.data(), updatedImportances.data(),
+                                             static_cast<uint32_t>(updatedIndices.size()), stream);
+            }
+            else {
+                std::vector<uint32_t> instIndices;
+                instIndices.push_back(m_envInst.instIndex);
+                for (auto &it : m_instances)
+                    instIndices.push_back(it.second.instIndex);
+                m_lightInstIndices.finalize();
+                m_lightInstIndices.initialize(cuContext, g_bufferType, instIndices, stream);
+
+                m_lightInstDist.finalize(m_context);
+                m_lightInstDist.initialize(m_context, lightImportances.data(), lightImportances.size(),
+                                           shared::DistributionLayout::SumTree);
+                m_lightInstSetIsDirty = false;
+            }
+            m_lightInstImportances = std::move(lightImportances);
         }
 
         launchParams->geomInstBuffer = m_geomInstBuffer.optixBuffer.getDevicePointer();
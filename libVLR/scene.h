@@ -1,6 +1,9 @@
 ﻿#pragma once
 
 #include "materials.h"
+#include "host_array.h"
+#include "node_edit_queue.h"
+#include "scene_geometry_tracker.h"
 
 namespace vlr {
     class Transform : public TypeAwareClass {
@@ -22,6 +25,7 @@ namespace vlr {
         VLR_DECLARE_TYPE_AWARE_CLASS_INTERFACE();
 
         StaticTransform(const Matrix4x4 &m = Matrix4x4::Identity()) : m_matrix(m), m_invMatrix(invert(m)) {}
+        StaticTransform(const Matrix4x4 &m, const Matrix4x4 &invM) : m_matrix(m), m_invMatrix(invM) {}
 
         bool isStatic() const override { return true; }
 
@@ -34,6 +38,12 @@ namespace vlr {
             m_matrix.getArray(mat);
             m_invMatrix.getArray(invMat);
         }
+        const Matrix4x4 &getMatrix() const {
+            return m_matrix;
+        }
+        const Matrix4x4 &getInverseMatrix() const {
+            return m_invMatrix;
+        }
     };
 
 
@@ -49,32 +59,40 @@ namespace vlr {
     struct SHGeometryInstance;
     class SurfaceNode;
 
+    // JP: 削除は末尾の子との入れ替えで行うので、削除によって子の順番は変わり得る。
+    // EN: Removal swaps a child with the last one, so removal can change the order of children.
     class SHGeometryGroup {
-        std::vector<const SHGeometryInstance*> m_shGeomInsts;
+        SwapRemoveSet<const SHGeometryInstance*> m_shGeomInsts;
 
     public:
         SHGeometryGroup() {}
         ~SHGeometryGroup() {}
 
         void addChild(const SHGeometryInstance* geomInst) {
-            m_shGeomInsts.push_back(geomInst);
+            VLRAssert(!m_shGeomInsts.contains(geomInst),
+                      "SHGeometryInstance %p is already a child of SHGeometryGroup %p.", geomInst, this);
+            m_shGeomInsts.add(geomInst);
         }
         void removeChild(const SHGeometryInstance* geomInst) {
-            auto idx = std::find(m_shGeomInsts.cbegin(), m_shGeomInsts.cend(), geomInst);
-            VLRAssert(idx != m_shGeomInsts.cend(), "SHGeometryInstance %p is not a child of SHGeometryGroup %p.", geomInst, this);
-            m_shGeomInsts.erase(idx);
+            VLRAssert(m_shGeomInsts.contains(geomInst),
+                      "SHGeometryInstance %p is not a child of SHGeometryGroup %p.", geomInst, this);
+            m_shGeomInsts.remove(geomInst);
         }
+        // JP: ジオメトリの中身は各SurfaceNodeが持つので、ここでは所属の確認だけを行う。
+        // EN: Each SurfaceNode owns the contents of its geometry, so this only checks membership.
         void updateChild(const SHGeometryInstance* geomInst) {
-            auto idx = std::find(m_shGeomInsts.cbegin(), m_shGeomInsts.cend(), geomInst);
-            VLRAssert(idx != m_shGeomInsts.cend(), "SHGeometryInstance %p is not a child of SHGeometryGroup %p.", geomInst, this);
-            VLRAssert_NotImplemented();
+            VLRAssert(hasChild(geomInst), "SHGeometryInstance %p is not a child of SHGeometryGroup %p.", geomInst, this);
+        }
+
+        bool hasChild(const SHGeometryInstance* geomInst) const {
+            return m_shGeomInsts.contains(geomInst);
         }
 
         const SHGeometryInstance* childAt(uint32_t index) const {
             return m_shGeomInsts[index];
         }
         uint32_t getNumChildren() const {
-            return static_cast<uint32_t>(m_shGeomInsts.size());
+            return m_shGeomInsts.size();
         }
     };
 
@@ -85,28 +103,39 @@ namespace vlr {
         SHGeometryInstance() : surfNode(nullptr), userData(0) {}
     };
 
+    // JP: 行列自体はSHTransformArenaに置き、SHTransformはそのインデックスを持つ。
+    // EN: The matrices themselves are placed in SHTransformArena, and SHTransform holds the index.
     class SHTransform {
         std::string m_name;
 
-        StaticTransform m_transform;
+        SHTransformArena* m_arena;
+        uint32_t m_arenaIndex;
         union {
             const SHTransform* m_childTransform;
             const SHGeometryGroup* m_childGeomGroup;
         };
         bool m_childIsTransform;
 
-        StaticTransform resolveTransform() const;
-
     public:
-        SHTransform(const std::string &name, const StaticTransform &transform, const SHGeometryGroup* geomGroup) :
+        SHTransform(SHTransformArena* arena, const std::string &name,
+                    const StaticTransform &transform, const SHGeometryGroup* geomGroup) :
             m_name(name),
-            m_transform(transform), m_childGeomGroup(geomGroup),
-            m_childIsTransform(false) {}
-        SHTransform(const std::string &name, const StaticTransform &transform, const SHTransform* childTransform) :
+            m_arena(arena), m_childGeomGroup(geomGroup),
+            m_childIsTransform(false) {
+            m_arenaIndex = m_arena->allocate(transform.getMatrix(), transform.getInverseMatrix(),
+                                             SHTransformArena::InvalidIndex);
+        }
+        SHTransform(SHTransformArena* arena, const std::string &name,
+                    const StaticTransform &transform, const SHTransform* childTransform) :
             m_name(name),
-            m_transform(transform), m_childTransform(childTransform),
-            m_childIsTransform(true) {}
-        ~SHTransform() {}
+            m_arena(arena), m_childTransform(childTransform),
+            m_childIsTransform(true) {
+            m_arenaIndex = m_arena->allocate(transform.getMatrix(), transform.getInverseMatrix(),
+                                             childTransform->m_arenaIndex);
+        }
+        ~SHTransform() {
+            m_arena->release(m_arenaIndex);
+        }
 
         const std::string &getName() const { return m_name; }
         void setName(const std::string &name) {
@@ -132,6 +161,18 @@ namespace vlr {
     class InternalNode;
     class Scene;
 
+    // JP: コンテキスト内の三角形メッシュの頂点のメモリ使用量の集計。
+    //     各頂点形式のサイズは全ての頂点をその形式で保持した場合の値。
+    // EN: Summary of memory usage of triangle mesh vertices in a context.
+    //     The size of each vertex format is the value when all the vertices are held in that format.
+    struct VertexMemoryReport {
+        uint32_t numMeshes;
+        uint32_t numCompactMeshes;
+        uint32_t numVertices;
+        size_t fullFormatSize;
+        size_t compactFormatSize;
+    };
+
 
 
     class Node : public Object {
@@ -173,15 +214,15 @@ namespace vlr {
         static void finalize(Context &context);
 
         SurfaceNode(Context &context, const std::string &name) : Node(context, name) {}
-        virtual ~SurfaceNode() {
-            while (!m_parents.empty())
-                removeParent(*m_parents.rbegin());
-        }
+        virtual ~SurfaceNode();
 
         void addParent(ParentNode* parent) override;
         void removeParent(ParentNode* parent) override;
 
         virtual bool isIntersectable() const { return true; }
+        // JP: GASの構築時に頂点に適用する3x4行列(デバイスポインター)。不要な場合は0。
+        // EN: 3x4 matrix (device pointer) applied to vertices when building a GAS. 0 if unnecessary.
+        virtual CUdeviceptr getPreTransform() const { return 0; }
         virtual void setupData(
             uint32_t userData, uint32_t geomInstIndex,
             optixu::GeometryInstance* optixGeomInst, shared::GeometryInstance* geomInst) const = 0;
@@ -199,7 +240,7 @@ namespace vlr {
         static std::unordered_map<uint32_t, OptiXProgramSet> s_optiXProgramSets;
 
         struct MaterialGroup {
-            std::vector<uint32_t> indices;
+            HostArray<uint32_t> indices;
             cudau::TypedBuffer<shared::Triangle> optixIndexBuffer;
             DiscreteDistribution1D primDist;
             const SurfaceMaterial* material;
@@ -235,10 +276,27 @@ namespace vlr {
             }
         };
 
-        std::vector<Vertex> m_vertices;
+        VLRVertexFormat m_vertexFormat;
+        HostArray<Vertex> m_vertices;
         cudau::TypedBuffer<Vertex> m_optixVertexBuffer;
+        // JP: コンパクトな頂点形式の場合はこちらだけを保持する。
+        //     位置の復元はGASの構築時にはpreTransformの行列で、シェーディング時にはpositionOffset/Scaleで行う。
+        // EN: Only these are held for the compact vertex format.
+        //     Positions are restored by the preTransform matrix when building the GAS,
+        //     and by positionOffset/Scale when shading.
+        std::vector<shared::CompactVertex> m_compactVertices;
+        cudau::TypedBuffer<shared::CompactVertex> m_optixCompactVertexBuffer;
+        cudau::TypedBuffer<float> m_optixPreTransform;
+        Point3D m_positionOffset;
+        Vector3D m_positionScale;
         std::vector<MaterialGroup> m_materialGroups;
 
+        Point3D getPosition(uint32_t index) const;
+        // JP: 三角形の面積とAABBを計算する。dstTrianglesが非nullptrの場合は三角形のインデックスも書き込む。
+        // EN: Compute the triangle areas and the AABB. Also writes triangle indices if dstTriangles is non-null.
+        void computeTriangleAreas(const MaterialGroup &matGroup, shared::Triangle* dstTriangles,
+                                  std::vector<float>* areas, BoundingBox3D* aabb) const;
+
     public:
         VLR_DECLARE_TYPE_AWARE_CLASS_INTERFACE();
 
@@ -251,11 +309,29 @@ namespace vlr {
         void addParent(ParentNode* parent) override;
         void removeParent(ParentNode* parent) override;
 
-        void setVertices(std::vector<Vertex> &&vertices);
+        // JP: 頂点形式はsetVertices()の前に指定する必要がある。
+        //     マテリアルグループの追加後にsetVertices()を呼ぶと同じ数の頂点でジオメトリをその場で更新する。
+        //     頂点とインデックスは呼び出し側から所有権を受け取ったバッファーでも良い。
+        // EN: The vertex format needs to be specified before setVertices().
+        //     Calling setVertices() after adding material groups updates the geometry in place
+        //     with the same number of vertices.
+        //     Vertices and indices can also be buffers whose ownership has been transferred from the caller.
+        void setVertexFormat(VLRVertexFormat format);
+        VLRVertexFormat getVertexFormat() const {
+            return m_vertexFormat;
+        }
+        uint32_t getNumVertices() const {
+            if (m_vertexFormat == VLRVertexFormat_Compact)
+                return static_cast<uint32_t>(m_compactVertices.size());
+            return m_vertices.size();
+        }
+        void setVertices(HostArray<Vertex> &&vertices);
         void addMaterialGroup(
-            std::vector<uint32_t> &&indices, const SurfaceMaterial* material, 
+            HostArray<uint32_t> &&indices, const SurfaceMaterial* material, 
             const ShaderNodePlug &nodeNormal, const ShaderNodePlug& nodeTangent, const ShaderNodePlug &nodeAlpha);
 
+        CUdeviceptr getPreTransform() const override;
+
         void setupData(
             uint32_t userData, uint32_t geomInstIndex,
             optixu::GeometryInstance* optixGeomInst, shared::GeometryInstance* geomInst) const;
@@ -375,9 +451,15 @@ namespace vlr {
 
         SHGeometryGroup* m_shGeomGroup;
 
-        void createConcatanatedTransforms(const std::set<SHTransform*>& childDelta, std::set<SHTransform*>* delta);
-        void removeConcatanatedTransforms(const std::set<SHTransform*>& childDelta, std::set<SHTransform*>* delta);
-        void updateConcatanatedTransforms(const std::set<SHTransform*>& childDelta, std::set<SHTransform*>* delta);
+        void createConcatanatedTransforms(const std::vector<SHTransform*>& childDelta, std::vector<SHTransform*>* delta);
+        void removeConcatanatedTransforms(const std::vector<SHTransform*>& childDelta, std::vector<SHTransform*>* delta);
+        void updateConcatanatedTransforms(const std::vector<SHTransform*>& childDelta, std::vector<SHTransform*>* delta);
+
+        // JP: シーンの編集中は子との接続の変更を記録するだけにして、イベントの伝播をコミットまで遅らせる。
+        // EN: While a scene is being edited, changes of links to children are only recorded,
+        //     and event propagation is deferred until the commit.
+        void linkChild(Node* child);
+        void unlinkChild(Node* child);
 
     public:
         VLR_DECLARE_TYPE_AWARE_CLASS_INTERFACE();
@@ -391,9 +473,9 @@ namespace vlr {
         void removeGeometryInstance(const std::set<const SHGeometryInstance*> &childDelta);
         void updateGeometryInstance(const std::set<const SHGeometryInstance*> &childDelta);
 
-        virtual void transformAddEvent(const std::set<SHTransform*> &childDelta) = 0;
-        virtual void transformRemoveEvent(const std::set<SHTransform*> &childDelta) = 0;
-        virtual void transformUpdateEvent(const std::set<SHTransform*> &childDelta) = 0;
+        virtual void transformAddEvent(const std::vector<SHTransform*> &childDelta) = 0;
+        virtual void transformRemoveEvent(const std::vector<SHTransform*> &childDelta) = 0;
+        virtual void transformUpdateEvent(const std::vector<SHTransform*> &childDelta) = 0;
 
         virtual void geometryAddEvent(const SHTransform* childTransform,
                                       const std::set<const SHGeometryInstance*> &childDelta) = 0;
@@ -427,9 +509,9 @@ namespace vlr {
         InternalNode(Context &context, const std::string &name, const Transform* localToWorld);
         ~InternalNode();
 
-        void transformAddEvent(const std::set<SHTransform*> &childDelta) override;
-        void transformRemoveEvent(const std::set<SHTransform*> &childDelta) override;
-        void transformUpdateEvent(const std::set<SHTransform*> &childDelta) override;
+        void transformAddEvent(const std::vector<SHTransform*> &childDelta) override;
+        void transformRemoveEvent(const std::vector<SHTransform*> &childDelta) override;
+        void transformUpdateEvent(const std::vector<SHTransform*> &childDelta) override;
 
         void geometryAddEvent(const SHTransform* childTransform,
                               const std::set<const SHGeometryInstance*> &childDelta) override;
@@ -439,6 +521,7 @@ namespace vlr {
                                  const std::set<const SHGeometryInstance*> &childDelta) override;
 
         void setTransform(const Transform* localToWorld) override;
+        void propagateTransformUpdate();
 
         void addParent(ParentNode* parent) override;
         void removeParent(ParentNode* parent) override;
@@ -465,13 +548,20 @@ namespace vlr {
         CUdeviceptr m_sceneBounds;
         cudau::TypedBuffer<uint32_t> m_lightInstIndices;
         DiscreteDistribution1D m_lightInstDist;
+        // JP: 前回転送したインスタンスの重要度。インスタンスの集合が変わらなければ差分だけを分布に反映する。
+        // EN: Importances of instances transferred last time.
+        //     Only the differences are applied to the distribution unless the set of instances changes.
+        std::vector<float> m_lightInstImportances;
+        bool m_lightInstSetIsDirty;
 
         struct GeometryInstance {
             optixu::GeometryInstance optixGeomInst;
             uint32_t geomInstIndex;
             shared::GeometryInstance data;
-            uint32_t referenceCount;
         };
+        // JP: GASの子と参照数はm_geometryTrackerが持ち、OptiXのGASの子はprepareSetup()でまとめて設定する。
+        // EN: m_geometryTracker holds the children of the GAS and their reference counts,
+        //     and children of the OptiX GAS are set at once in prepareSetup().
         struct GeometryAS {
             optixu::GeometryAccelerationStructure optixGas;
             cudau::Buffer optixGasMem;
@@ -495,12 +585,34 @@ namespace vlr {
         std::unordered_map<const SHGeometryGroup*, GeometryAS> m_geometryASes;
         std::unordered_map<const SHTransform*, Instance> m_instances;
 
-        std::unordered_set<const SHGeometryInstance*> m_dirtyGeometryInstances;
+        SceneGeometryTracker<const SHGeometryGroup*, const SHGeometryInstance*> m_geometryTracker;
         std::unordered_set<uint32_t> m_removedGeometryInstanceIndices;
-        std::unordered_set<const SHGeometryGroup*> m_dirtyGeometryASes;
         std::unordered_set<const SHTransform*> m_dirtyInstances;
         std::unordered_set<uint32_t> m_removedInstanceIndices;
 
+        // JP: beginEdits()/commitEdits()の入れ子の深さ。
+        //     編集中はIASの子の増減を個別に行わず、コミット時に子の一覧をまとめて作り直す。
+        //     IASから外されていないインスタンスの破棄もコミットまで遅らせる。
+        // EN: Nesting depth of beginEdits()/commitEdits().
+        //     While editing, children of the IAS aren't added / removed one by one,
+        //     and the list of children is rebuilt at once on commit.
+        //     Destruction of instances not yet removed from the IAS is also deferred until the commit.
+        uint32_t m_editNestCount;
+        bool m_iasChildrenAreDirty;
+        std::vector<optixu::Instance> m_pendingDestroyedInstances;
+        // JP: OptiXのGASの子は遅れて更新されるので、ジオメトリインスタンスの破棄もprepareSetup()まで遅らせる。
+        // EN: Children of OptiX GASes are updated lazily,
+        //     so destruction of geometry instances is also deferred until prepareSetup().
+        std::vector<optixu::GeometryInstance> m_pendingDestroyedGeometryInstances;
+        // JP: 編集中に記録したノードの接続の変更とトランスフォームの更新。
+        //     コミット時に正味の変更だけをまとめて伝播させる。
+        // EN: Changes of node links and transform updates recorded while editing.
+        //     Only the net changes are propagated at once on commit.
+        NodeEditQueue<Node> m_nodeEditQueue;
+
+        void applyNodeEdits();
+        void applyPendingEdits();
+
     public:
         VLR_DECLARE_TYPE_AWARE_CLASS_INTERFACE();
 
@@ -510,9 +622,9 @@ namespace vlr {
         Scene(Context &context, const Transform* localToWorld);
         ~Scene();
 
-        void transformAddEvent(const std::set<SHTransform*> &childDelta) override;
-        void transformRemoveEvent(const std::set<SHTransform*> &childDelta) override;
-        void transformUpdateEvent(const std::set<SHTransform*> &childDelta) override;
+        void transformAddEvent(const std::vector<SHTransform*> &childDelta) override;
+        void transformRemoveEvent(const std::vector<SHTransform*> &childDelta) override;
+        void transformUpdateEvent(const std::vector<SHTransform*> &childDelta) override;
 
         void geometryAddEvent(const SHTransform* childTransform,
                               const std::set<const SHGeometryInstance*> &childDelta) override;
@@ -521,6 +633,16 @@ namespace vlr {
         void geometryUpdateEvent(const SHTransform* childTransform,
                                  const std::set<const SHGeometryInstance*> &childDelta) override;
 
+        void beginEdits();
+        void commitEdits();
+        bool isEditing() const {
+            return m_editNestCount > 0;
+        }
+
+        void recordLink(ParentNode* parent, Node* child, bool linked);
+        void recordTransformUpdate(InternalNode* node);
+        void flushNodeEdits(Node* node);
+
         void prepareSetup(size_t* asScratchSize, optixu::Scene* optixScene);
         void setup(
             CUstream stream,
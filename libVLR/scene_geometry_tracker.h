@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include "swap_remove_containers.h"
+
+namespace vlr {
+    // JP: シーンのGASごとの子のジオメトリインスタンスとその参照数、ジオメトリインスタンス自体の参照数、
+    //     そしてdirtyなGASとジオメトリインスタンスを管理する。
+    //     OptiXのオブジェクトは持たず、生成や破棄が必要になったものを呼び出し側に返す。
+    // EN: Manages child geometry instances of each GAS of a scene with their reference counts,
+    //     reference counts of the geometry instances themselves, and dirty GASes and geometry instances.
+    //     Doesn't hold OptiX objects, and returns what needs to be created or destroyed to the caller.
+    template <typename GeomGroupKey, typename GeomInstKey>
+    class SceneGeometryTracker {
+    public:
+        // JP: GASに属するジオメトリインスタンスと、それを含むトランスフォームパスの数。
+        // EN: Geometry instances belonging to a GAS and the number of transform paths containing each.
+        using Children = SwapRemoveMap<GeomInstKey, uint32_t>;
+
+    private:
+        struct GeometryAS {
+            Children children;
+            bool childrenAreDirty;
+        };
+
+        std::unordered_map<GeomInstKey, uint32_t> m_geomInstReferenceCounts;
+        std::unordered_map<GeomGroupKey, GeometryAS> m_geometryASes;
+        std::unordered_set<GeomInstKey> m_dirtyGeometryInstances;
+        std::unordered_set<GeomGroupKey> m_dirtyGeometryASes;
+
+    public:
+        // JP: トランスフォームパスが至るGASにジオメトリインスタンスを追加する。
+        //     初めて現れたジオメトリインスタンスをnewGeomInstsに追加し、GASが新しく作られた場合はtrueを返す。
+        // EN: Add geometry instances to the GAS a transform path reaches.
+        //     Appends geometry instances appearing for the first time to newGeomInsts,
+        //     and returns true if the GAS is newly created.
+        template <typename GeomInstContainer>
+        bool addChildren(const GeomGroupKey &geomGroup, const GeomInstContainer &delta,
+                         std::vector<GeomInstKey>* newGeomInsts) {
+            for (const GeomInstKey &geomInst : delta) {
+                if (m_geomInstReferenceCounts[geomInst]++ > 0)
+                    continue;
+                newGeomInsts->push_back(geomInst);
+                m_dirtyGeometryInstances.insert(geomInst);
+            }
+
+            bool isNewGeomGroup = m_geometryASes.count(geomGroup) == 0;
+            GeometryAS &gas = m_geometryASes[geomGroup];
+            if (isNewGeomGroup)
+                gas.childrenAreDirty = false;
+            for (const GeomInstKey &geomInst : delta) {
+                uint32_t* referenceCount = gas.children.find(geomInst);
+                if (referenceCount) {
+                    ++*referenceCount;
+                    continue;
+                }
+                gas.children.add(geomInst, 1);
+                gas.childrenAreDirty = true;
+            }
+            m_dirtyGeometryASes.insert(geomGroup);
+
+            return isNewGeomGroup;
+        }
+
+        // JP: トランスフォームパスが至るGASからジオメトリインスタンスを削除し、GASの子から外れた数を返す。
+        //     全ての参照が無くなったジオメトリインスタンスをremovedGeomInstsに追加する。
+        //     GASが空になった場合はGAS自体を削除してgeomGroupIsRemovedをtrueにする。
+        // EN: Remove geometry instances from the GAS a transform path reaches,
+        //     and return the number of instances which left the children of the GAS.
+        //     Appends geometry instances whose references are all gone to removedGeomInsts.
+        //     When the GAS becomes empty, removes the GAS itself and sets geomGroupIsRemoved to true.
+        template <typename GeomInstContainer>
+        uint32_t removeChildren(const GeomGroupKey &geomGroup, const GeomInstContainer &delta,
+                                std::vector<GeomInstKey>* removedGeomInsts, bool* geomGroupIsRemoved) {
+            GeometryAS &gas = m_geometryASes.at(geomGroup);
+            uint32_t numRemovedChildren = 0;
+            for (const GeomInstKey &geomInst : delta) {
+                uint32_t* referenceCount = gas.children.find(geomInst);
+                VLRAssert(referenceCount != nullptr, "The geometry instance is not a child of the GAS.");
+                if (--*referenceCount == 0) {
+                    gas.children.remove(geomInst);
+                    gas.childrenAreDirty = true;
+                    ++numRemovedChildren;
+                }
+
+                auto it = m_geomInstReferenceCounts.find(geomInst);
+                if (--it->second > 0)
+                    continue;
+                m_geomInstReferenceCounts.erase(it);
+                m_dirtyGeometryInstances.erase(geomInst);
+                removedGeomInsts->push_back(geomInst);
+            }
+
+            *geomGroupIsRemoved = gas.children.empty();
+            if (*geomGroupIsRemoved) {
+                m_geometryASes.erase(geomGroup);
+                m_dirtyGeometryASes.erase(geomGroup);
+            }
+            else if (numRemovedChildren > 0) {
+                m_dirtyGeometryASes.insert(geomGroup);
+            }
+
+            return numRemovedChildren;
+        }
+
+        // JP: 更新されたジオメトリインスタンスと、トランスフォームパスが至るGASだけをdirtyとしてマークする。
+        //     頂点バッファーの再確保でpreTransformが変わり得るので、GASの子も設定し直す対象とする。
+        // EN: Mark only the updated geometry instances and the GAS the transform path reaches as dirty.
+        //     Reallocating a vertex buffer may change the preTransform, so the children of the GAS need to be set again.
+        template <typename GeomInstContainer>
+        void updateChildren(const GeomGroupKey &geomGroup, const GeomInstContainer &delta) {
+            for (const GeomInstKey &geomInst : delta)
+                m_dirtyGeometryInstances.insert(geomInst);
+            m_geometryASes.at(geomGroup).childrenAreDirty = true;
+            m_dirtyGeometryASes.insert(geomGroup);
+        }
+
+        bool contains(const GeomGroupKey &geomGroup) const {
+            return m_geometryASes.count(geomGroup) > 0;
+        }
+        const Children &getChildren(const GeomGroupKey &geomGroup) const {
+            return m_geometryASes.at(geomGroup).children;
+        }
+        bool childrenAreDirty(const GeomGroupKey &geomGroup) const {
+            return m_geometryASes.at(geomGroup).childrenAreDirty;
+        }
+        void clearChildrenDirty(const GeomGroupKey &geomGroup) {
+            m_geometryASes.at(geomGroup).childrenAreDirty = false;
+        }
+
+        const std::unordered_set<GeomInstKey> &getDirtyGeometryInstances() const {
+            return m_dirtyGeometryInstances;
+        }
+        void clearDirtyGeometryInstances() {
+            m_dirtyGeometryInstances.clear();
+        }
+        const std::unordered_set<GeomGroupKey> &getDirtyGeometryASes() const {
+            return m_dirtyGeometryASes;
+        }
+        void clearDirtyGeometryASes() {
+            m_dirtyGeometryASes.clear();
+        }
+    };
+}
@@ -1653,13 +1653,28 @@ namespace vlr {
     }
 
     Image2DTextureShaderNode::~Image2DTextureShaderNode() {
+        if (m_image != NullImages.at(m_context.getID()))
+            m_image->removeTextureShaderNode(this);
         if (m_textureObject)
             cuTexObjectDestroy(m_textureObject);
     }
 
+    void Image2DTextureShaderNode::onImageContentsChanged() {
+        createTextureSampler();
+        m_context.markShaderNodeDescriptorDirty(this);
+    }
+
+    void Image2DTextureShaderNode::onImageDestroyed() {
+        m_image = NullImages.at(m_context.getID());
+        createTextureSampler();
+        m_context.markShaderNodeDescriptorDirty(this);
+    }
+
     void Image2DTextureShaderNode::createTextureSampler() {
         m_textureSampler.setXyFilterMode(static_cast<cudau::TextureFilterMode>(m_xyFilter));
-        m_textureSampler.setMipMapFilterMode(cudau::TextureFilterMode::Point);
+        m_textureSampler.setMipMapFilterMode(m_image->getNumMipmapLevels() > 1 ?
+                                             cudau::TextureFilterMode::Linear :
+                                             cudau::TextureFilterMode::Point);
         m_textureSampler.setWrapMode(0, static_cast<cudau::TextureWrapMode>(m_wrapU));
         m_textureSampler.setWrapMode(1, static_cast<cudau::TextureWrapMode>(m_wrapV));
         m_textureSampler.setReadMode(m_image->needsHW_sRGB_degamma() ?
@@ -1824,7 +1839,12 @@ namespace vlr {
 
     bool Image2DTextureShaderNode::set(const char* paramName, const Image2D* image) {
         if (testParamName(paramName, "image")) {
-            m_image = image ? image : NullImages.at(m_context.getID());
+            const Image2D* nullImage = NullImages.at(m_context.getID());
+            if (m_image != nullImage)
+                m_image->removeTextureShaderNode(this);
+            m_image = image ? image : nullImage;
+            if (m_image != nullImage)
+                m_image->addTextureShaderNode(this);
         }
         else {
             return false;
@@ -1903,10 +1923,18 @@ namespace vlr {
     }
 
     EnvironmentTextureShaderNode::~EnvironmentTextureShaderNode() {
+        if (m_image != NullImages.at(m_context.getID()))
+            m_image->removeEnvironmentTextureShaderNode(this);
         if (m_textureObject)
             cuTexObjectDestroy(m_textureObject);
     }
 
+    void EnvironmentTextureShaderNode::onImageDestroyed() {
+        m_image = NullImages.at(m_context.getID());
+        createTextureSampler();
+        m_context.markShaderNodeDescriptorDirty(this);
+    }
+
     void EnvironmentTextureShaderNode::createTextureSampler() {
         m_textureSampler.setXyFilterMode(static_cast<cudau::TextureFilterMode>(m_xyFilter));
         m_textureSampler.setMipMapFilterMode(cudau::TextureFilterMode::Point);
@@ -1978,7 +2006,12 @@ namespace vlr {
 
     bool EnvironmentTextureShaderNode::set(const char* paramName, const Image2D* image) {
         if (testParamName(paramName, "image")) {
-            m_image = image ? image : NullImages.at(m_context.getID());
+            const Image2D* nullImage = NullImages.at(m_context.getID());
+            if (m_image != nullImage)
+                m_image->removeEnvironmentTextureShaderNode(this);
+            m_image = image ? image : nullImage;
+            if (m_image != nullImage)
+                m_image->addEnvironmentTextureShaderNode(this);
         }
         else {
             return false;
@@ -588,6 +588,11 @@ namespace vlr {
         Image2DTextureShaderNode(Context &context);
         ~Image2DTextureShaderNode();
 
+        // JP: 参照している画像の内容が差し替えられた時と、画像が破棄される時に呼ばれる。
+        // EN: Called when the contents of the referenced image have been replaced and when the image is destroyed.
+        void onImageContentsChanged();
+        void onImageDestroyed();
+
         bool get(const char* paramName, const char** enumValue) const override;
         bool get(const char* paramName, float* values, uint32_t length) const override;
         bool get(const char* paramName, const Image2D** image) const override;
@@ -639,6 +644,10 @@ namespace vlr {
         EnvironmentTextureShaderNode(Context &context);
         ~EnvironmentTextureShaderNode();
 
+        // JP: 参照している画像が破棄される時に呼ばれる。
+        // EN: Called when the referenced image is destroyed.
+        void onImageDestroyed();
+
         bool get(const char* paramName, const char** enumValue) const override;
         bool get(const char* paramName, const Image2D** image) const override;
 
@@ -21,6 +21,9 @@
 #define JAKOB_SPECTRAL_UPSAMPLING 1
 
 //#define VLR_USE_SPECTRAL_RENDERING
+// JP: 有効にするとCDFを使う分布が既定で16分岐のB+木の配置(DistributionLayout::BTreeCDF)で構築される。
+// EN: When enabled, distributions using a CDF are built in the 16-ary B+ tree layout (DistributionLayout::BTreeCDF) by default.
+//#define VLR_USE_BTREE_CDF
 #define SPECTRAL_UPSAMPLING_METHOD MENG_SPECTRAL_UPSAMPLING
 #define VLR_Color_System_is_based_on VLR_Color_System_CIE_1931_2deg
 static constexpr uint32_t NumSpectralSamples = 4;
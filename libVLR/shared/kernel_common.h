@@ -52,6 +52,11 @@ namespace vlr::shared {
         union {
             struct {
                 const Vertex* vertexBuffer;
+                // JP: コンパクトな頂点形式の場合のみ非nullでvertexBufferの代わりに使われる。
+                // EN: Non-null only for the compact vertex format, used instead of vertexBuffer.
+                const CompactVertex* compactVertexBuffer;
+                Point3D positionOffset;
+                Vector3D positionScale;
                 const Triangle* triangleBuffer;
                 DiscreteDistribution1D primDistribution;
                 BoundingBox3D aabb;
@@ -98,6 +103,13 @@ namespace vlr::shared {
         }
     };
 
+    CUDA_DEVICE_FUNCTION Vertex fetchTriangleMeshVertex(const GeometryInstance &geomInst, uint32_t index) {
+        if (geomInst.asTriMesh.compactVertexBuffer)
+            return decodeCompactVertex(geomInst.asTriMesh.compactVertexBuffer[index],
+                                       geomInst.asTriMesh.positionOffset, geomInst.asTriMesh.positionScale);
+        return geomInst.asTriMesh.vertexBuffer[index];
+    }
+
     struct Instance {
         union {
             StaticTransform transform;
@@ -179,6 +191,11 @@ namespace vlr::shared {
         Normal3D geometricNormal;
         ReferenceFrame shadingFrame;
         TexCoord2D texCoord;
+        // JP: テクスチャー座標空間でのレイのフットプリントの幅。テクスチャーのミップレベル選択に使う。
+        //     0の場合は最も詳細なレベルを参照する。
+        // EN: Width of the ray footprint in texture coordinate space, used to select the mip level of textures.
+        //     0 refers to the finest level.
+        float texCoordFootprint;
         struct {
             bool isPoint : 1;
             bool atInfinity : 1;
@@ -8,6 +8,8 @@ namespace vlr::shared {
         WavelengthSamples wls;
         float prevDirPDF;
         DirectionType prevSampledType;
+        float coneWidth; // at the ray origin
+        float coneSpreadAngle;
         unsigned int pathLength : 16;
         unsigned int maxLengthTerminate : 1;
     };
@@ -17,6 +19,8 @@ namespace vlr::shared {
         Vector3D nextDirection;
         float dirPDF;
         DirectionType sampledType;
+        float coneWidth;
+        float coneSpreadAngle;
         unsigned int terminate : 1;
     };
 
@@ -539,6 +539,7 @@ namespace vlr::shared {
         surfPt.geomInstIndex = hp.sbtr->geomInst.geomInstIndex;
         surfPt.geomInstIndex = hp.primIndex;
         decodeHitPoint(hp, &surfPt, &hypAreaPDF);
+        surfPt.texCoordFootprint = 0.0f;
         surfPt.position = transform<TransformKind::ObjectToWorld>(surfPt.position);
         surfPt.shadingFrame = ReferenceFrame(normalize(transform<TransformKind::ObjectToWorld>(surfPt.shadingFrame.x)),
                                              normalize(transform<TransformKind::ObjectToWorld>(surfPt.shadingFrame.z)));
@@ -606,18 +607,44 @@ namespace vlr::shared {
 
 
 
+    // JP: coneWidth̓qbg_ł̃CR[̕BeNX`[̃~bvxIɎgB
+    //     0̏ꍇ͍łڍׂȃxQƂB
+    // EN: coneWidth is the width of the ray cone at the hit point, used to select the mip level of textures.
+    //     0 refers to the finest level.
     CUDA_DEVICE_FUNCTION void calcSurfacePoint(
-        const HitPointParameter &hp, const WavelengthSamples &wls, SurfacePoint* surfPt, float* hypAreaPDF) {
+        const HitPointParameter &hp, const WavelengthSamples &wls, SurfacePoint* surfPt, float* hypAreaPDF,
+        float coneWidth = 0.0f) {
         ProgSigDecodeLocalHitPoint decodeLocalHitPoint(hp.sbtr->geomInst.progDecodeLocalHitPoint);
         surfPt->instIndex = optixGetInstanceId();
         surfPt->geomInstIndex = hp.sbtr->geomInst.geomInstIndex;
         surfPt->primIndex = hp.primIndex;
         decodeLocalHitPoint(hp, surfPt, hypAreaPDF);
+        Normal3D localGeometricNormal = surfPt->geometricNormal;
         surfPt->position = transform<TransformKind::ObjectToWorld>(surfPt->position);
         surfPt->shadingFrame = ReferenceFrame(normalize(transform<TransformKind::ObjectToWorld>(surfPt->shadingFrame.x)),
                                               normalize(transform<TransformKind::ObjectToWorld>(surfPt->shadingFrame.z)));
         surfPt->geometricNormal = normalize(transform<TransformKind::ObjectToWorld>(surfPt->geometricNormal));
 
+        // JP: CR[̕eNX`[WԂ̃tbgvgɕϊB΂߂猩قǈL΂B
+        //     decodeLocalHitPoint()̓[JԂ̖ʐς狁߂Ă̂ŁA
+        //     IuWFNg烏[hւ̕ϊɂʂ̖ʐς̊g嗦ŕ␳B
+        // EN: Convert the ray cone width into the footprint in texture coordinate space.
+        //     It gets stretched at grazing angles.
+        //     decodeLocalHitPoint() computes it from the area in local space,
+        //     so correct it by the area scale of the surface under the object-to-world transform.
+        if (coneWidth > 0.0f) {
+            Vector3D localTangent, localBitangent;
+            localGeometricNormal.makeCoordinateSystem(&localTangent, &localBitangent);
+            float areaScale = cross(transform<TransformKind::ObjectToWorld>(localTangent),
+                                    transform<TransformKind::ObjectToWorld>(localBitangent)).length();
+            float cosTerm = absDot(asVector3D(optixGetWorldRayDirection()), surfPt->geometricNormal);
+            surfPt->texCoordFootprint *= areaScale > 0.0f ?
+                coneWidth / (std::sqrt(areaScale) * std::fmax(cosTerm, 1e-2f)) : 0.0f;
+        }
+        else {
+            surfPt->texCoordFootprint = 0.0f;
+        }
+
         Normal3D localNormal = calcNode(hp.sbtr->geomInst.nodeNormal, Normal3D(0.0f, 0.0f, 1.0f), *surfPt, wls);
         applyBumpMapping(localNormal, surfPt);
 
@@ -144,6 +144,22 @@ namespace vlr {
 
 
 
+    enum class BlockCompressionQuality {
+        Fast = 0,
+        Normal,
+        High,
+    };
+
+    // JP: アップロード後のホスト側画素データの扱い。
+    // EN: How to handle host-side pixel data after upload.
+    enum class ImageResidencyPolicy {
+        Keep = 0,
+        DropAfterUpload,
+        SpillToDisk,
+    };
+
+
+
     enum class BumpType {
         NormalMap_DirectX = 0,
         NormalMap_OpenGL,
@@ -178,52 +194,218 @@ namespace vlr {
 
 
     namespace shared {
+        // JP: 離散分布・区分定数分布のサンプリング用データの配置。
+        //     LinearCDF: CDFをそのまま二分探索する。
+        //     BTreeCDF: CDFを葉とする16分木(B+木)の内部ノードをCDFの後ろに追加し、キャッシュラインごとに探索する。
+        //     AliasTable: CDFの代わりにエイリアステーブルを作りO(1)でサンプルする(離散分布のみ)。
+        //     SumTree: 正規化していない値を葉とする二分木の部分和を持ち、k個の値の更新をO(k log n)で反映できる(離散分布のみ)。
+        // EN: Layout of sampling data of discrete and piecewise constant distributions.
+        //     LinearCDF: Binary search in the CDF as is.
+        //     BTreeCDF: Append internal nodes of a 16-ary B+ tree whose leaves are the CDF, and search cache line by cache line.
+        //     AliasTable: Build an alias table instead of the CDF to sample in O(1) (discrete distributions only).
+        //     SumTree: Hold partial sums of a binary tree whose leaves are the unnormalized values,
+        //              so updates of k values can be applied in O(k log n) (discrete distributions only).
+        enum class DistributionLayout : uint32_t {
+            LinearCDF = 0,
+            BTreeCDF,
+            AliasTable,
+            SumTree,
+        };
+
+        // JP: CDFを使う分布の既定の配置。ビルド時にVLR_USE_BTREE_CDFで切り替える。
+        // EN: Default layout of distributions using a CDF. Switched at build time by VLR_USE_BTREE_CDF.
+#if defined(VLR_USE_BTREE_CDF)
+        static constexpr DistributionLayout DefaultCDFLayout = DistributionLayout::BTreeCDF;
+#else
+        static constexpr DistributionLayout DefaultCDFLayout = DistributionLayout::LinearCDF;
+#endif
+
+        // JP: B+木の各ノードは16要素(floatで1キャッシュライン)、内部ノードは17個の子を持つ。
+        //     葉は末尾を無限大で埋めたCDFそのもので、内部ノードのk番目のキーはk + 1番目の子の部分木の先頭の値となる。
+        //     内部ノードは葉の直後に下の階層から順に並ぶ。
+        // EN: Each node of the B+ tree has 16 entries (one cache line for float), and an internal node has 17 children.
+        //     The leaves are the CDF itself padded with infinity at the end,
+        //     and the k-th key of an internal node is the first value of the subtree of the (k + 1)-th child.
+        //     Internal nodes follow the leaves from the lowest level upward.
+        static constexpr uint32_t CDFBTreeNodeSize = 16;
+        static constexpr uint32_t CDFBTreeMaxNumLevels = 8;
+
+        // JP: 各階層のノード数を求め、B+木全体の要素数を返す。
+        // EN: Compute the number of nodes at each level and return the number of entries of the whole B+ tree.
+        CUDA_DEVICE_FUNCTION uint32_t computeCDFBTreeLevels(uint32_t numValues, uint32_t numNodes[CDFBTreeMaxNumLevels], uint32_t* numLevels) {
+            numNodes[0] = (numValues + 1 + CDFBTreeNodeSize - 1) / CDFBTreeNodeSize;
+            uint32_t size = numNodes[0] * CDFBTreeNodeSize;
+            *numLevels = 1;
+            while (numNodes[*numLevels - 1] > 1) {
+                numNodes[*numLevels] = (numNodes[*numLevels - 1] + CDFBTreeNodeSize) / (CDFBTreeNodeSize + 1);
+                size += numNodes[*numLevels] * CDFBTreeNodeSize;
+                ++*numLevels;
+            }
+            return size;
+        }
+
+        // JP: CDF[idx] <= uとなる[0, numValues)中の最大のidxを求める。
+        //     B+木は葉がCDFそのものなので、どちらの配置でも同じインデックスを返す。
+        // EN: Find the largest idx in [0, numValues) such that CDF[idx] <= u.
+        //     The leaves of the B+ tree are the CDF itself, so both layouts return the same index.
+        template <typename RealType>
+        CUDA_DEVICE_FUNCTION uint32_t searchCDF(const RealType* CDF, uint32_t numValues, DistributionLayout layout, RealType u) {
+            if (layout != DistributionLayout::BTreeCDF) {
+                int idx = 0;
+                for (int d = nextPowerOf2(numValues) >> 1; d >= 1; d >>= 1) {
+                    if (idx + d >= numValues)
+                        continue;
+                    if (CDF[idx + d] <= u)
+                        idx += d;
+                }
+                VLRAssert(idx >= 0 && idx < numValues, "Invalid Index!: %d", idx);
+                return idx;
+            }
+
+            uint32_t numNodes[CDFBTreeMaxNumLevels];
+            uint32_t numLevels;
+            uint32_t offset = computeCDFBTreeLevels(numValues, numNodes, &numLevels);
+            uint32_t nodeIdx = 0;
+            for (int level = numLevels - 1; level >= 0; --level) {
+                offset -= numNodes[level] * CDFBTreeNodeSize;
+                const RealType* node = CDF + offset + nodeIdx * CDFBTreeNodeSize;
+                // JP: ノード内はu以下の要素を分岐無しで数える。
+                // EN: Count entries less than or equal to u within a node without branches.
+                uint32_t count = 0;
+                for (uint32_t i = 0; i < CDFBTreeNodeSize; ++i)
+                    count += node[i] <= u;
+                nodeIdx = level > 0 ? nodeIdx * (CDFBTreeNodeSize + 1) + count : nodeIdx * CDFBTreeNodeSize + count;
+            }
+            VLRAssert(nodeIdx >= 1 && nodeIdx <= numValues, "Invalid Index!: %u", nodeIdx - 1);
+            return nodeIdx - 1;
+        }
+
+        // JP: エイリアステーブルの各バケット。probabilityの確率でバケット自身の要素、それ以外はaliasの要素を選ぶ。
+        // EN: A bucket of an alias table. Selects the bucket's own item with "probability", otherwise the "alias" item.
+        template <typename RealType>
+        struct AliasTableEntry {
+            RealType probability;
+            uint32_t alias;
+        };
+
+        // JP: 和の木は要素数を2のべき乗Pに切り上げた2P要素の配列で、[1]が総和、[P + i]がi番目の値、
+        //     [j]が[2j]と[2j + 1]の和となる。
+        // EN: A sum tree is an array of 2P entries where P is the number of values rounded up to a power of 2,
+        //     [1] is the total sum, [P + i] is the i-th value, and [j] is the sum of [2j] and [2j + 1].
+        CUDA_DEVICE_FUNCTION uint32_t computeSumTreeSize(uint32_t numValues) {
+            return 2 * nextPowerOf2(numValues);
+        }
+
+        // JP: 根から左右の部分木の和と比較しながら葉まで降りる。値がゼロの部分木には降りない。
+        //     正規化せずに総和を参照するので、値を更新しても分布の構造体を転送し直す必要はない。
+        // EN: Descend from the root to a leaf comparing against the sums of the left and right subtrees,
+        //     never descending into a subtree whose value is zero.
+        //     The total sum is referenced without normalization, so the distribution struct need not be re-uploaded on value updates.
+        template <typename RealType>
+        CUDA_DEVICE_FUNCTION uint32_t sampleSumTree(const RealType* sumTree, uint32_t numValues, RealType u, RealType* remapped) {
+            uint32_t numLeaves = nextPowerOf2(numValues);
+            RealType t = u * sumTree[1];
+            uint32_t nodeIdx = 1;
+            while (nodeIdx < numLeaves) {
+                RealType leftSum = sumTree[2 * nodeIdx];
+                RealType rightSum = sumTree[2 * nodeIdx + 1];
+                if (t < leftSum || rightSum == 0) {
+                    nodeIdx = 2 * nodeIdx;
+                }
+                else {
+                    t -= leftSum;
+                    nodeIdx = 2 * nodeIdx + 1;
+                }
+            }
+            RealType value = sumTree[nodeIdx];
+            *remapped = ::vlr::min<RealType>(t / value, 0.99999994f);
+            uint32_t idx = nodeIdx - numLeaves;
+            VLRAssert(idx < numValues, "Invalid Index!: %u", idx);
+            return idx;
+        }
+
         template <typename RealType>
         class DiscreteDistribution1DTemplate {
             const RealType* m_PMF;
-            const RealType* m_CDF;
+            const RealType* m_CDF; // JP: SumTreeの場合は和の木。 EN: Sum tree for SumTree.
+            const AliasTableEntry<RealType>* m_aliasTable;
             RealType m_integral;
             uint32_t m_numValues;
+            DistributionLayout m_layout;
+
+            // JP: uの上位の桁でバケットを、残りの桁でバケット内の選択を決める。
+            //     uの精度(floatで24bit)のうちlog2(numValues)bitがバケットの選択に使われるので、
+            //     要素数が非常に多い場合はバケット内の選択の分解能が下がる。
+            // EN: Higher digits of u select a bucket, and the remaining digits make the choice within the bucket.
+            //     log2(numValues) bits of u's precision (24 bits for float) are used for the bucket selection,
+            //     so the resolution of the choice within a bucket decreases for a very large number of items.
+            CUDA_DEVICE_FUNCTION uint32_t sampleAliasTable(RealType u, RealType* remapped) const {
+                RealType su = u * m_numValues;
+                uint32_t idx = ::vlr::min<uint32_t>(static_cast<uint32_t>(su), m_numValues - 1);
+                RealType t = su - idx;
+                const AliasTableEntry<RealType> &entry = m_aliasTable[idx];
+                if (t < entry.probability) {
+                    *remapped = t / entry.probability;
+                }
+                else {
+                    *remapped = (t - entry.probability) / (1 - entry.probability);
+                    idx = entry.alias;
+                }
+                return idx;
+            }
 
         public:
-            DiscreteDistribution1DTemplate(const RealType* PMF, const RealType* CDF, RealType integral, uint32_t numValues) :
-                m_PMF(PMF), m_CDF(CDF), m_integral(integral), m_numValues(numValues) {}
+            DiscreteDistribution1DTemplate(const RealType* PMF, const RealType* CDF, const AliasTableEntry<RealType>* aliasTable,
+                                           RealType integral, uint32_t numValues, DistributionLayout layout) :
+                m_PMF(PMF), m_CDF(CDF), m_aliasTable(aliasTable), m_integral(integral), m_numValues(numValues), m_layout(layout) {}
 
             CUDA_DEVICE_FUNCTION DiscreteDistribution1DTemplate() {}
 
             CUDA_DEVICE_FUNCTION uint32_t sample(RealType u, RealType* prob) const {
                 VLRAssert(u >= 0 && u < 1, "\"u\": %g must be in range [0, 1).", u);
-                int idx = 0;
-                for (int d = nextPowerOf2(m_numValues) >> 1; d >= 1; d >>= 1) {
-                    if (idx + d >= m_numValues)
-                        continue;
-                    if (m_CDF[idx + d] <= u)
-                        idx += d;
+                if (m_aliasTable) {
+                    RealType remapped;
+                    uint32_t idx = sampleAliasTable(u, &remapped);
+                    *prob = m_PMF[idx];
+                    return idx;
+                }
+                if (m_layout == DistributionLayout::SumTree) {
+                    RealType remapped;
+                    uint32_t idx = sampleSumTree(m_CDF, m_numValues, u, &remapped);
+                    *prob = evaluatePMF(idx);
+                    return idx;
                 }
-                VLRAssert(idx >= 0 && idx < m_numValues, "Invalid Index!: %d", idx);
+                uint32_t idx = searchCDF(m_CDF, m_numValues, m_layout, u);
                 *prob = m_PMF[idx];
                 return idx;
             }
             CUDA_DEVICE_FUNCTION uint32_t sample(RealType u, RealType* prob, RealType* remapped) const {
                 VLRAssert(u >= 0 && u < 1, "\"u\": %g must be in range [0, 1).", u);
-                int idx = 0;
-                for (int d = nextPowerOf2(m_numValues) >> 1; d >= 1; d >>= 1) {
-                    if (idx + d >= m_numValues)
-                        continue;
-                    if (m_CDF[idx + d] <= u)
-                        idx += d;
+                if (m_aliasTable) {
+                    uint32_t idx = sampleAliasTable(u, remapped);
+                    *prob = m_PMF[idx];
+                    return idx;
                 }
-                VLRAssert(idx >= 0 && idx < m_numValues, "Invalid Index!: %d", idx);
+                if (m_layout == DistributionLayout::SumTree) {
+                    uint32_t idx = sampleSumTree(m_CDF, m_numValues, u, remapped);
+                    *prob = evaluatePMF(idx);
+                    return idx;
+                }
+                uint32_t idx = searchCDF(m_CDF, m_numValues, m_layout, u);
                 *prob = m_PMF[idx];
                 *remapped = (u - m_CDF[idx]) / (m_CDF[idx + 1] - m_CDF[idx]);
                 return idx;
             }
             CUDA_DEVICE_FUNCTION RealType evaluatePMF(uint32_t idx) const {
                 VLRAssert(idx >= 0 && idx < m_numValues, "\"idx\" is out of range [0, %u)", m_numValues);
+                if (m_layout == DistributionLayout::SumTree)
+                    return m_CDF[nextPowerOf2(m_numValues) + idx] / m_CDF[1];
                 return m_PMF[idx];
             }
 
-            CUDA_DEVICE_FUNCTION RealType integral() const { return m_integral; }
+            CUDA_DEVICE_FUNCTION RealType integral() const {
+                return m_layout == DistributionLayout::SumTree ? m_CDF[1] : m_integral;
+            }
             CUDA_DEVICE_FUNCTION uint32_t numValues() const { return m_numValues; }
         };
 
@@ -237,23 +419,18 @@ namespace vlr {
             const RealType* m_CDF;
             RealType m_integral;
             uint32_t m_numValues;
+            DistributionLayout m_layout;
 
         public:
-            RegularConstantContinuousDistribution1DTemplate(const RealType* PDF, const RealType* CDF, RealType integral, uint32_t numValues) :
-                m_PDF(PDF), m_CDF(CDF), m_integral(integral), m_numValues(numValues) {}
+            RegularConstantContinuousDistribution1DTemplate(const RealType* PDF, const RealType* CDF, RealType integral, uint32_t numValues,
+                                                            DistributionLayout layout) :
+                m_PDF(PDF), m_CDF(CDF), m_integral(integral), m_numValues(numValues), m_layout(layout) {}
 
             CUDA_DEVICE_FUNCTION RegularConstantContinuousDistribution1DTemplate() {}
 
             CUDA_DEVICE_FUNCTION RealType sample(RealType u, RealType* probDensity) const {
                 VLRAssert(u >= 0 && u < 1, "\"u\": %g must be in range [0, 1).", u);
-                int idx = 0;
-                for (int d = nextPowerOf2(m_numValues) >> 1; d >= 1; d >>= 1) {
-                    if (idx + d >= m_numValues)
-                        continue;
-                    if (m_CDF[idx + d] <= u)
-                        idx += d;
-                }
-                VLRAssert(idx >= 0 && idx < m_numValues, "Invalid Index!: %d", idx);
+                uint32_t idx = searchCDF(m_CDF, m_numValues, m_layout, u);
                 *probDensity = m_PDF[idx];
                 RealType t = (u - m_CDF[idx]) / (m_CDF[idx + 1] - m_CDF[idx]);
                 return (idx + t) / m_numValues;
@@ -301,6 +478,184 @@ namespace vlr {
 
 
 
+        // JP: 光源の放射の空間的な範囲と方向的な範囲を保守的に表す。
+        //     放射面の法線がaxisを中心とする半角θoのコーン内にあり、各法線からθeまでの方向に放射する。
+        // EN: Conservative spatial and directional extent of emission of lights.
+        //     Normals of emitting surfaces lie within the cone around "axis" with half angle θo,
+        //     and each normal emits toward directions up to θe from it.
+        struct LightBounds {
+            BoundingBox3D bounds;
+            Vector3D axis;
+            float cosThetaO;
+            float cosThetaE;
+            float power;
+            bool twoSided;
+
+            // JP: シェーディング点pから見た重要度の上界を見積もる。nがゼロベクトルの場合は表面の向きを考慮しない。
+            // EN: Estimate an upper bound of importance seen from shading point p. Surface orientation is ignored when n is zero.
+            CUDA_DEVICE_FUNCTION float importance(const Point3D &p, const Normal3D &n) const {
+                const auto safeSqrt = [](float x) {
+                    return std::sqrt(::vlr::max(x, 0.0f));
+                };
+                // JP: cos(max(0, θa - θb))とsin(max(0, θa - θb))。
+                // EN: cos(max(0, θa - θb)) and sin(max(0, θa - θb)).
+                const auto cosSubClamped = [](float sinThetaA, float cosThetaA, float sinThetaB, float cosThetaB) {
+                    if (cosThetaA > cosThetaB)
+                        return 1.0f;
+                    return cosThetaA * cosThetaB + sinThetaA * sinThetaB;
+                };
+                const auto sinSubClamped = [](float sinThetaA, float cosThetaA, float sinThetaB, float cosThetaB) {
+                    if (cosThetaA > cosThetaB)
+                        return 0.0f;
+                    return sinThetaA * cosThetaB - cosThetaA * sinThetaB;
+                };
+
+                Point3D center = bounds.centroid();
+                float halfDiagonal = 0.5f * (bounds.maxP - bounds.minP).length();
+                float dist2 = ::vlr::max(sqDistance(p, center), halfDiagonal);
+
+                // JP: 点から見てバウンディング球が張る角度θb。
+                // EN: Angle θb subtended by the bounding sphere seen from the point.
+                float cosThetaB = -1.0f;
+                if (sqDistance(p, center) > halfDiagonal * halfDiagonal)
+                    cosThetaB = safeSqrt(1 - halfDiagonal * halfDiagonal / sqDistance(p, center));
+                float sinThetaB = safeSqrt(1 - cosThetaB * cosThetaB);
+
+                Vector3D dirToPoint = p - center;
+                float distToPoint = dirToPoint.length();
+                dirToPoint = distToPoint > 0.0f ? dirToPoint / distToPoint : axis;
+                float cosThetaW = dot(axis, dirToPoint);
+                if (twoSided)
+                    cosThetaW = std::fabs(cosThetaW);
+                float sinThetaW = safeSqrt(1 - cosThetaW * cosThetaW);
+
+                // JP: 点への方向と放射方向のコーンとの最小の角度θ' = max(0, θw - θo - θb)。
+                // EN: Minimum angle θ' = max(0, θw - θo - θb) between the direction to the point and the emission cone.
+                float sinThetaO = safeSqrt(1 - cosThetaO * cosThetaO);
+                float cosThetaX = cosSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+                float sinThetaX = sinSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+                float cosThetaP = cosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+                if (cosThetaP <= cosThetaE)
+                    return 0.0f;
+
+                float ret = power * cosThetaP / dist2;
+                if (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f) {
+                    float cosThetaI = absDot(dirToPoint, n);
+                    float sinThetaI = safeSqrt(1 - cosThetaI * cosThetaI);
+                    ret *= cosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+                }
+                return ::vlr::max(ret, 0.0f);
+            }
+        };
+
+        struct LightBVHNode {
+            LightBounds lightBounds;
+            // JP: 内部ノードの場合は2番目の子のインデックス(1番目の子は直後に並ぶ)、葉の場合は光源のインデックス。
+            // EN: Index of the second child for an internal node (the first child follows immediately),
+            //     index of the light for a leaf.
+            uint32_t childOrLightIndex;
+            bool isLeaf;
+        };
+
+        // JP: 光源ごとに1つの葉を持つ光源のBVH。シェーディング点から見た各ノードの重要度に比例して子を選びながら辿る。
+        //     各光源の根からの経路(ビット列、深さdのビットが1なら2番目の子)を持つので、任意の光源の選択確率を評価できる。
+        // EN: BVH of lights with a leaf per light. Traverse choosing a child proportional to its importance seen from the shading point.
+        //     It holds the path from the root for each light (a bit string, the bit at depth d is 1 for the second child),
+        //     so the probability of choosing an arbitrary light can be evaluated.
+        class LightBVH {
+            const LightBVHNode* m_nodes;
+            const uint64_t* m_bitTrails;
+            uint32_t m_numNodes;
+            uint32_t m_numLights;
+
+            // JP: 子の範囲は親より狭いので、親の重要度が正でも両方の子の重要度がゼロになり得る。
+            //     その場合は行き止まりにせずパワーに比例して子を選び、選択確率の和を1に保つ。
+            //     そのような部分木の光源は寄与を持たないので推定量は変わらない。
+            // EN: Bounds of children are tighter than the parent's, so both children can have zero importance
+            //     even when the parent's importance is positive.
+            //     In that case choose a child proportional to power instead of hitting a dead end, keeping the probabilities summing to 1.
+            //     Lights in such a subtree have no contribution, so the estimator is unchanged.
+            CUDA_DEVICE_FUNCTION float calcFirstChildProbability(uint32_t nodeIndex, const Point3D &p, const Normal3D &n) const {
+                const LightBounds &bounds0 = m_nodes[nodeIndex + 1].lightBounds;
+                const LightBounds &bounds1 = m_nodes[m_nodes[nodeIndex].childOrLightIndex].lightBounds;
+                float importance0 = bounds0.importance(p, n);
+                float importance1 = bounds1.importance(p, n);
+                if (importance0 + importance1 == 0.0f)
+                    return bounds0.power / (bounds0.power + bounds1.power);
+                return importance0 / (importance0 + importance1);
+            }
+
+        public:
+            // JP: 光源が選べない(重要度が全てゼロ)場合に返す無効な光源インデックス。
+            // EN: Invalid light index returned when no light can be chosen (all importances are zero).
+            static constexpr uint32_t InvalidLightIndex = 0xFFFFFFFF;
+            // JP: BVHに含まれない光源のビット列。
+            // EN: Bit trail of a light not included in the BVH.
+            static constexpr uint64_t InvalidBitTrail = 0xFFFFFFFFFFFFFFFFull;
+
+            LightBVH(const LightBVHNode* nodes, const uint64_t* bitTrails, uint32_t numNodes, uint32_t numLights) :
+                m_nodes(nodes), m_bitTrails(bitTrails), m_numNodes(numNodes), m_numLights(numLights) {}
+
+            CUDA_DEVICE_FUNCTION LightBVH() {}
+
+            CUDA_DEVICE_FUNCTION uint32_t sample(const Point3D &p, const Normal3D &n, float u, float* prob, float* remapped) const {
+                VLRAssert(u >= 0 && u < 1, "\"u\": %g must be in range [0, 1).", u);
+                *prob = 0.0f;
+                if (m_numNodes == 0 || m_nodes[0].lightBounds.importance(p, n) == 0.0f)
+                    return InvalidLightIndex;
+
+                uint32_t nodeIndex = 0;
+                float pmf = 1.0f;
+                while (!m_nodes[nodeIndex].isLeaf) {
+                    float prob0 = calcFirstChildProbability(nodeIndex, p, n);
+                    if (u < prob0) {
+                        u = u / prob0;
+                        pmf *= prob0;
+                        nodeIndex = nodeIndex + 1;
+                    }
+                    else {
+                        u = (u - prob0) / (1 - prob0);
+                        pmf *= 1 - prob0;
+                        nodeIndex = m_nodes[nodeIndex].childOrLightIndex;
+                    }
+                    // JP: 丸め誤差でuが1にならないようにする。
+                    // EN: Prevent u from becoming 1 due to rounding errors.
+                    u = ::vlr::min(u, 0.99999994f);
+                }
+
+                *prob = pmf;
+                *remapped = u;
+                return m_nodes[nodeIndex].childOrLightIndex;
+            }
+            CUDA_DEVICE_FUNCTION float evaluatePMF(const Point3D &p, const Normal3D &n, uint32_t lightIndex) const {
+                VLRAssert(lightIndex < m_numLights, "\"lightIndex\" is out of range [0, %u)", m_numLights);
+                uint64_t bitTrail = m_bitTrails[lightIndex];
+                if (bitTrail == InvalidBitTrail || m_nodes[0].lightBounds.importance(p, n) == 0.0f)
+                    return 0.0f;
+
+                uint32_t nodeIndex = 0;
+                float pmf = 1.0f;
+                while (!m_nodes[nodeIndex].isLeaf) {
+                    float prob0 = calcFirstChildProbability(nodeIndex, p, n);
+                    if (bitTrail & 1) {
+                        pmf *= 1 - prob0;
+                        nodeIndex = m_nodes[nodeIndex].childOrLightIndex;
+                    }
+                    else {
+                        pmf *= prob0;
+                        nodeIndex = nodeIndex + 1;
+                    }
+                    bitTrail >>= 1;
+                }
+
+                return pmf;
+            }
+
+            CUDA_DEVICE_FUNCTION uint32_t numLights() const { return m_numLights; }
+        };
+
+
+
         class StaticTransform {
             Matrix4x4 m_matrix;
             Matrix4x4 m_invMatrix;
@@ -542,6 +897,106 @@ namespace vlr {
 
 
 
+        // JP: TriangleMeshSurfaceNodeのコンパクトな頂点形式(18バイト)。
+        //     位置はメッシュのAABBに対する符号付き16bit正規化整数で、OptiXのSNORM16_3としてそのままGASの入力にもなる。
+        //     法線と接線は八面体写像した16bit x 2、テクスチャー座標はhalfで保持する。
+        // EN: Compact vertex format (18 bytes) of TriangleMeshSurfaceNode.
+        //     The position is signed 16-bit normalized integers relative to the mesh AABB,
+        //     which is also directly used as the GAS input as OptiX's SNORM16_3.
+        //     The normal and tangent are octahedral-mapped 16-bit x 2, and the texture coordinates are half.
+        struct CompactVertex {
+            int16_t position[3];
+            half texCoord[2];
+            int16_t normal[2];
+            int16_t tc0Direction[2];
+        };
+
+        // JP: OptiXのSNORM16と同じ変換。
+        // EN: Same conversion as OptiX's SNORM16.
+        CUDA_DEVICE_FUNCTION int16_t encodeSNorm16(float v) {
+            v = ::vlr::clamp(v, -1.0f, 1.0f);
+            return static_cast<int16_t>(v * 32767 + (v >= 0 ? 0.5f : -0.5f));
+        }
+
+        CUDA_DEVICE_FUNCTION float decodeSNorm16(int16_t v) {
+            return ::vlr::max(v / 32767.0f, -1.0f);
+        }
+
+        // JP: 単位ベクトルを八面体に射影し、さらに正方形に展開した2次元座標で表す。
+        // EN: Project a unit vector onto an octahedron, then represent it by 2D coordinates unfolded onto a square.
+        CUDA_DEVICE_FUNCTION void encodeOctahedralVector(const Vector3D &v, int16_t encoded[2]) {
+            float sumAbs = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+            float x = v.x / sumAbs;
+            float y = v.y / sumAbs;
+            if (v.z < 0) {
+                float tx = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+                float ty = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+                x = tx;
+                y = ty;
+            }
+            encoded[0] = encodeSNorm16(x);
+            encoded[1] = encodeSNorm16(y);
+        }
+
+        CUDA_DEVICE_FUNCTION Vector3D decodeOctahedralVector(const int16_t encoded[2]) {
+            Vector3D v(decodeSNorm16(encoded[0]), decodeSNorm16(encoded[1]), 0.0f);
+            v.z = 1 - std::fabs(v.x) - std::fabs(v.y);
+            float t = ::vlr::max(-v.z, 0.0f);
+            v.x += v.x >= 0 ? -t : t;
+            v.y += v.y >= 0 ? -t : t;
+            return normalize(v);
+        }
+
+#if defined(VLR_Host)
+        // JP: 位置はAABBの中心positionOffsetと半分の大きさpositionScaleで[-1, 1]^3に正規化して量子化する。
+        //     八面体写像は長さゼロのベクトルを表せないので、法線が無い場合はZ軸、接線が無い場合は法線に直交する方向で代用する。
+        // EN: The position is normalized into [-1, 1]^3 by the AABB center positionOffset and half extent positionScale,
+        //     then quantized.
+        //     Octahedral mapping can't represent a zero-length vector, so substitute the Z axis when the normal is missing,
+        //     and a direction orthogonal to the normal when the tangent is missing.
+        inline CompactVertex encodeCompactVertex(
+            const Vertex &v, const Point3D &positionOffset, const Vector3D &positionScale) {
+            Normal3D normal = v.normal;
+            if (!(normal.sqLength() > 0.0f))
+                normal = Normal3D(0, 0, 1);
+            Vector3D tc0Direction = v.tc0Direction;
+            if (!(tc0Direction.sqLength() > 0.0f)) {
+                Vector3D bitangent;
+                normalize(normal).makeCoordinateSystem(&tc0Direction, &bitangent);
+            }
+
+            CompactVertex ret;
+            Vector3D d = v.position - positionOffset;
+            ret.position[0] = encodeSNorm16(positionScale.x > 0 ? d.x / positionScale.x : 0.0f);
+            ret.position[1] = encodeSNorm16(positionScale.y > 0 ? d.y / positionScale.y : 0.0f);
+            ret.position[2] = encodeSNorm16(positionScale.z > 0 ? d.z / positionScale.z : 0.0f);
+            ret.texCoord[0] = half(v.texCoord.u);
+            ret.texCoord[1] = half(v.texCoord.v);
+            encodeOctahedralVector(static_cast<Vector3D>(normal), ret.normal);
+            encodeOctahedralVector(tc0Direction, ret.tc0Direction);
+            return ret;
+        }
+#endif
+
+        CUDA_DEVICE_FUNCTION Point3D decodeCompactVertexPosition(
+            const CompactVertex &v, const Point3D &positionOffset, const Vector3D &positionScale) {
+            return positionOffset + Vector3D(positionScale.x * decodeSNorm16(v.position[0]),
+                                             positionScale.y * decodeSNorm16(v.position[1]),
+                                             positionScale.z * decodeSNorm16(v.position[2]));
+        }
+
+        CUDA_DEVICE_FUNCTION Vertex decodeCompactVertex(
+            const CompactVertex &v, const Point3D &positionOffset, const Vector3D &positionScale) {
+            Vertex ret;
+            ret.position = decodeCompactVertexPosition(v, positionOffset, positionScale);
+            ret.normal = Normal3D(decodeOctahedralVector(v.normal));
+            ret.tc0Direction = decodeOctahedralVector(v.tc0Direction);
+            ret.texCoord = TexCoord2D(v.texCoord[0], v.texCoord[1]);
+            return ret;
+        }
+
+
+
         struct CameraDescriptor {
             int32_t progSetupIDF;
             uint32_t idfProcedureSetIndex;
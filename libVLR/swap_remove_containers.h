@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include "shared/common_internal.h"
+
+namespace vlr {
+    // JP: 要素の位置をハッシュマップで引き、削除は末尾の要素との入れ替えで行う集合。
+    //     追加、削除、検索はO(1)で、要素は連続して並ぶがその順番は削除によって変わり得る。
+    // EN: Set which looks up the position of an element by a hash map, and removal swaps the element with the last one.
+    //     Addition, removal and lookup are O(1), and elements are contiguous but their order can change by removal.
+    template <typename KeyType>
+    class SwapRemoveSet {
+        std::vector<KeyType> m_keys;
+        std::unordered_map<KeyType, uint32_t> m_indices;
+
+    public:
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        void add(const KeyType &key) {
+            VLRAssert(m_indices.count(key) == 0, "The key already exists.");
+            m_indices[key] = static_cast<uint32_t>(m_keys.size());
+            m_keys.push_back(key);
+        }
+        // JP: 削除した要素があった位置を返す。末尾の要素でなければ、末尾の要素がその位置に移る。
+        // EN: Returns the position where the removed element was.
+        //     Unless it was the last element, the last element moves to that position.
+        uint32_t remove(const KeyType &key) {
+            auto it = m_indices.find(key);
+            VLRAssert(it != m_indices.cend(), "The key doesn't exist.");
+            uint32_t index = it->second;
+            m_indices.erase(it);
+            uint32_t lastIndex = static_cast<uint32_t>(m_keys.size()) - 1;
+            if (index != lastIndex) {
+                m_keys[index] = m_keys[lastIndex];
+                m_indices[m_keys[index]] = index;
+            }
+            m_keys.pop_back();
+            return index;
+        }
+
+        uint32_t indexOf(const KeyType &key) const {
+            auto it = m_indices.find(key);
+            if (it == m_indices.cend())
+                return InvalidIndex;
+            return it->second;
+        }
+        bool contains(const KeyType &key) const {
+            return m_indices.count(key) > 0;
+        }
+
+        const KeyType &operator[](uint32_t index) const {
+            return m_keys[index];
+        }
+        const std::vector<KeyType> &getElements() const {
+            return m_keys;
+        }
+        uint32_t size() const {
+            return static_cast<uint32_t>(m_keys.size());
+        }
+        bool empty() const {
+            return m_keys.empty();
+        }
+    };
+
+
+
+    // JP: キーごとに値を持つSwapRemoveSet。値はキーと同じ位置に並び、削除時に一緒に入れ替わる。
+    // EN: SwapRemoveSet holding a value per key. Values are placed at the same positions as keys,
+    //     and are swapped together on removal.
+    template <typename KeyType, typename ValueType>
+    class SwapRemoveMap {
+        SwapRemoveSet<KeyType> m_keys;
+        std::vector<ValueType> m_values;
+
+    public:
+        void add(const KeyType &key, const ValueType &value) {
+            m_keys.add(key);
+            m_values.push_back(value);
+        }
+        void remove(const KeyType &key) {
+            uint32_t index = m_keys.remove(key);
+            if (index != m_values.size() - 1)
+                m_values[index] = std::move(m_values.back());
+            m_values.pop_back();
+        }
+
+        // JP: キーが無い場合はnullptrを返す。
+        // EN: Returns nullptr if the key doesn't exist.
+        ValueType* find(const KeyType &key) {
+            uint32_t index = m_keys.indexOf(key);
+            if (index == SwapRemoveSet<KeyType>::InvalidIndex)
+                return nullptr;
+            return &m_values[index];
+        }
+        const ValueType* find(const KeyType &key) const {
+            uint32_t index = m_keys.indexOf(key);
+            if (index == SwapRemoveSet<KeyType>::InvalidIndex)
+                return nullptr;
+            return &m_values[index];
+        }
+        bool contains(const KeyType &key) const {
+            return m_keys.contains(key);
+        }
+
+        const KeyType &keyAt(uint32_t index) const {
+            return m_keys[index];
+        }
+        ValueType &valueAt(uint32_t index) {
+            return m_values[index];
+        }
+        const ValueType &valueAt(uint32_t index) const {
+            return m_values[index];
+        }
+        uint32_t size() const {
+            return m_keys.size();
+        }
+        bool empty() const {
+            return m_keys.empty();
+        }
+    };
+}
@@ -0,0 +1,108 @@
+#include "thread_pool.h"
+
+namespace vlr {
+    static thread_local bool s_isWorkerThread = false;
+
+    // static
+    bool ThreadPool::processChunk(Job* job) {
+        uint32_t chunkIdx = job->nextChunk.fetch_add(1);
+        if (chunkIdx >= job->numChunks)
+            return false;
+
+        uint32_t chunkBegin = job->begin + chunkIdx * job->grainSize;
+        uint32_t chunkEnd = std::min(chunkBegin + job->grainSize, job->end);
+        (*job->func)(chunkBegin, chunkEnd);
+
+        return true;
+    }
+
+    void ThreadPool::workerMain() {
+        s_isWorkerThread = true;
+        while (true) {
+            Job* job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_jobAvailable.wait(lock, [this]() { return m_terminate || !m_jobs.empty(); });
+                if (m_terminate)
+                    break;
+                job = m_jobs.front();
+                // JP: 全チャンクが取得済みならキューから外す。
+                // EN: Remove the job from the queue once all the chunks have been taken.
+                if (job->nextChunk.load() >= job->numChunks) {
+                    m_jobs.pop_front();
+                    continue;
+                }
+                ++job->numActiveWorkers;
+            }
+
+            while (processChunk(job)) {}
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --job->numActiveWorkers;
+            }
+            m_jobFinished.notify_all();
+        }
+    }
+
+    ThreadPool::ThreadPool(uint32_t numThreads) : m_terminate(false) {
+        numThreads = std::max<uint32_t>(numThreads, 1);
+        m_workers.reserve(numThreads - 1);
+        for (uint32_t i = 0; i < numThreads - 1; ++i)
+            m_workers.emplace_back(&ThreadPool::workerMain, this);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_terminate = true;
+        }
+        m_jobAvailable.notify_all();
+        for (std::thread &worker : m_workers)
+            worker.join();
+    }
+
+    // static
+    ThreadPool &ThreadPool::getShared() {
+        static ThreadPool s_pool(std::max<uint32_t>(std::thread::hardware_concurrency(), 1));
+        return s_pool;
+    }
+
+    void ThreadPool::parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize,
+                                 const std::function<void(uint32_t, uint32_t)> &func) {
+        if (begin >= end)
+            return;
+        grainSize = std::max<uint32_t>(grainSize, 1);
+        uint32_t numChunks = (end - begin + grainSize - 1) / grainSize;
+        if (numChunks == 1 || m_workers.empty() || s_isWorkerThread) {
+            func(begin, end);
+            return;
+        }
+
+        Job job;
+        job.func = &func;
+        job.begin = begin;
+        job.end = end;
+        job.grainSize = grainSize;
+        job.numChunks = numChunks;
+        job.nextChunk = 0;
+        job.numActiveWorkers = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(&job);
+        }
+        m_jobAvailable.notify_all();
+
+        while (processChunk(&job)) {}
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // JP: ジョブをキューから外した上で、処理中のワーカーが全員抜けるのを待つ。
+        //     呼び出しスレッドが全チャンクを取得し終えているので、これで全チャンクの完了が保証される。
+        // EN: Remove the job from the queue, then wait for all the workers still processing it to leave.
+        //     The calling thread has already taken all the chunks, so this guarantees every chunk has completed.
+        auto it = std::find(m_jobs.begin(), m_jobs.end(), &job);
+        if (it != m_jobs.end())
+            m_jobs.erase(it);
+        m_jobFinished.wait(lock, [&job]() { return job.numActiveWorkers == 0; });
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "shared/common_internal.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace vlr {
+    // JP: ホスト側の重い前処理(テクスチャ変換など)を分割実行するためのワーカースレッドプール。
+    //     プロセス内で一つのインスタンスを共有する。
+    // EN: Worker thread pool to split heavy host-side preprocessing (e.g. texture conversion).
+    //     A single instance is shared in the process.
+    class ThreadPool {
+        struct Job {
+            const std::function<void(uint32_t, uint32_t)>* func;
+            uint32_t begin;
+            uint32_t end;
+            uint32_t grainSize;
+            uint32_t numChunks;
+            std::atomic<uint32_t> nextChunk;
+            uint32_t numActiveWorkers; // guarded by m_mutex
+        };
+
+        std::vector<std::thread> m_workers;
+        std::deque<Job*> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_jobAvailable;
+        std::condition_variable m_jobFinished;
+        bool m_terminate;
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        static bool processChunk(Job* job);
+        void workerMain();
+
+    public:
+        ThreadPool(uint32_t numThreads);
+        ~ThreadPool();
+
+        static ThreadPool &getShared();
+
+        uint32_t getNumThreads() const {
+            return static_cast<uint32_t>(m_workers.size()) + 1;
+        }
+
+        // JP: [begin, end)をgrainSizeごとのチャンクに分割して並列に処理する。呼び出しスレッドも処理に参加する。
+        //     ワーカースレッド内から呼ばれた場合は(デッドロックを避けるため)逐次実行する。
+        // EN: Process [begin, end) in parallel split into chunks of grainSize. The calling thread also participates.
+        //     Runs serially when called from a worker thread (to avoid deadlock).
+        void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize,
+                         const std::function<void(uint32_t, uint32_t)> &func);
+    };
+}
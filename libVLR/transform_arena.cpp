@@ -0,0 +1,116 @@
+﻿#include "transform_arena.h"
+#include "thread_pool.h"
+
+namespace vlr {
+    uint32_t SHTransformArena::allocate(const Matrix4x4 &localMatrix, const Matrix4x4 &localInvMatrix, uint32_t nextIndex) {
+        uint32_t index;
+        if (m_freeIndices.empty()) {
+            index = static_cast<uint32_t>(m_entries.size());
+            m_entries.emplace_back();
+        }
+        else {
+            index = m_freeIndices.back();
+            m_freeIndices.pop_back();
+        }
+
+        Entry &entry = m_entries[index];
+        entry.localMatrix = localMatrix;
+        entry.localInvMatrix = localInvMatrix;
+        entry.nextIndex = nextIndex;
+        entry.level = 0;
+        if (nextIndex != InvalidIndex) {
+            VLRAssert(m_entries[nextIndex].isAlive, "The next entry %u has been released.", nextIndex);
+            entry.level = m_entries[nextIndex].level + 1;
+        }
+        entry.isAlive = true;
+        entry.isDirty = true;
+        entry.isUpdated = false;
+        m_maxLevel = std::max(m_maxLevel, entry.level);
+        m_hasDirtyEntries = true;
+
+        return index;
+    }
+
+    void SHTransformArena::release(uint32_t index) {
+        Entry &entry = m_entries[index];
+        VLRAssert(entry.isAlive, "Entry %u has been already released.", index);
+        entry.isAlive = false;
+        entry.isDirty = false;
+        m_freeIndices.push_back(index);
+    }
+
+    void SHTransformArena::setLocalMatrix(uint32_t index, const Matrix4x4 &localMatrix, const Matrix4x4 &localInvMatrix) {
+        Entry &entry = m_entries[index];
+        VLRAssert(entry.isAlive, "Entry %u has been released.", index);
+        entry.localMatrix = localMatrix;
+        entry.localInvMatrix = localInvMatrix;
+        entry.isDirty = true;
+        m_hasDirtyEntries = true;
+    }
+
+    void SHTransformArena::resolve() {
+        if (!m_hasDirtyEntries)
+            return;
+
+        // JP: 生きているエントリーを段ごとに並べる(計数ソート)。
+        // EN: Line up alive entries per level (counting sort).
+        uint32_t numEntries = static_cast<uint32_t>(m_entries.size());
+        m_levelOffsets.assign(m_maxLevel + 2, 0);
+        for (uint32_t i = 0; i < numEntries; ++i) {
+            const Entry &entry = m_entries[i];
+            if (entry.isAlive)
+                ++m_levelOffsets[entry.level + 1];
+        }
+        for (uint32_t l = 0; l <= m_maxLevel; ++l)
+            m_levelOffsets[l + 1] += m_levelOffsets[l];
+        m_sortedIndices.resize(m_levelOffsets[m_maxLevel + 1]);
+        {
+            std::vector<uint32_t> cursors(m_levelOffsets.cbegin(), m_levelOffsets.cend() - 1);
+            for (uint32_t i = 0; i < numEntries; ++i) {
+                const Entry &entry = m_entries[i];
+                if (entry.isAlive)
+                    m_sortedIndices[cursors[entry.level]++] = i;
+            }
+        }
+
+        // JP: 浅い段から順に、自身か連鎖の次のエントリーが更新されたエントリーの行列を計算し直す。
+        //     同じ段のエントリーは互いに依存しない。
+        // EN: From shallower levels, recompute matrices of entries whose own or the next entry has been updated.
+        //     Entries at the same level don't depend on each other.
+        const auto resolveEntries = [this](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                Entry &entry = m_entries[m_sortedIndices[i]];
+                if (entry.nextIndex == InvalidIndex) {
+                    if (entry.isDirty) {
+                        entry.resolvedMatrix = entry.localMatrix;
+                        entry.resolvedInvMatrix = entry.localInvMatrix;
+                        entry.isUpdated = true;
+                    }
+                    continue;
+                }
+                const Entry &next = m_entries[entry.nextIndex];
+                if (entry.isDirty || next.isUpdated) {
+                    entry.resolvedMatrix = entry.localMatrix * next.resolvedMatrix;
+                    entry.resolvedInvMatrix = next.resolvedInvMatrix * entry.localInvMatrix;
+                    entry.isUpdated = true;
+                }
+            }
+        };
+        constexpr uint32_t minParallelLevelSize = 4096;
+        for (uint32_t l = 0; l <= m_maxLevel; ++l) {
+            uint32_t begin = m_levelOffsets[l];
+            uint32_t end = m_levelOffsets[l + 1];
+            if (end - begin >= minParallelLevelSize)
+                ThreadPool::getShared().parallelFor(begin, end, 1024, resolveEntries);
+            else
+                resolveEntries(begin, end);
+        }
+
+        for (uint32_t index : m_sortedIndices) {
+            Entry &entry = m_entries[index];
+            entry.isDirty = false;
+            entry.isUpdated = false;
+        }
+        m_hasDirtyEntries = false;
+    }
+}
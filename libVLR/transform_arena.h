@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include "shared/basic_types_internal.h"
+
+namespace vlr {
+    // JP: 浅いシーン階層の連結トランスフォーム(SHTransform)の行列を連続した配列にまとめて保持する。
+    //     各エントリーはローカル行列と、連鎖の次にあたるエントリーのインデックスを持ち、
+    //     解決済みの行列は「ローカル行列 x 次のエントリーの解決済み行列」となる。
+    //     連鎖の次のエントリーは必ず浅い段にあるので、段の順に一度走査すれば変更の影響を受けたエントリーだけを更新できる。
+    //     段が大きい場合は段内を並列に処理する。
+    // EN: Holds matrices of concatenated transforms (SHTransform) of the shallow scene hierarchy in a contiguous array.
+    //     Each entry has a local matrix and the index of the next entry in the chain,
+    //     and its resolved matrix is "local matrix x resolved matrix of the next entry".
+    //     The next entry in a chain is always at a shallower level, so a single pass in the level order
+    //     updates only the entries affected by changes.
+    //     A large level is processed in parallel.
+    class SHTransformArena {
+        struct Entry {
+            Matrix4x4 localMatrix;
+            Matrix4x4 localInvMatrix;
+            Matrix4x4 resolvedMatrix;
+            Matrix4x4 resolvedInvMatrix;
+            uint32_t nextIndex;
+            uint32_t level;
+            bool isAlive;
+            bool isDirty;
+            bool isUpdated;
+        };
+
+        std::vector<Entry> m_entries;
+        std::vector<uint32_t> m_freeIndices;
+        std::vector<uint32_t> m_sortedIndices;
+        std::vector<uint32_t> m_levelOffsets;
+        uint32_t m_maxLevel;
+        bool m_hasDirtyEntries;
+
+        SHTransformArena(const SHTransformArena &) = delete;
+        SHTransformArena &operator=(const SHTransformArena &) = delete;
+
+    public:
+        static constexpr uint32_t InvalidIndex = 0xFFFFFFFF;
+
+        SHTransformArena() : m_maxLevel(0), m_hasDirtyEntries(false) {}
+
+        // JP: nextIndexには連鎖の次のエントリー、無い場合はInvalidIndexを指定する。
+        // EN: Specify the next entry in the chain as nextIndex, or InvalidIndex if there is none.
+        uint32_t allocate(const Matrix4x4 &localMatrix, const Matrix4x4 &localInvMatrix, uint32_t nextIndex);
+        void release(uint32_t index);
+
+        void setLocalMatrix(uint32_t index, const Matrix4x4 &localMatrix, const Matrix4x4 &localInvMatrix);
+
+        // JP: 変更されたエントリーとそれを連鎖に含むエントリーの解決済み行列を更新する。変更が無ければ何もしない。
+        // EN: Update resolved matrices of changed entries and entries containing them in the chain.
+        //     Does nothing when there is no change.
+        void resolve();
+
+        const Matrix4x4 &getResolvedMatrix(uint32_t index) const {
+            VLRAssert(!m_hasDirtyEntries, "resolve() needs to be called beforehand.");
+            return m_entries[index].resolvedMatrix;
+        }
+        const Matrix4x4 &getResolvedInverseMatrix(uint32_t index) const {
+            VLRAssert(!m_hasDirtyEntries, "resolve() needs to be called beforehand.");
+            return m_entries[index].resolvedInvMatrix;
+        }
+    };
+}
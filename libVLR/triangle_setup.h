@@ -0,0 +1,90 @@
+﻿#pragma once
+
+#include "shared/shared.h"
+#include "thread_pool.h"
+
+namespace vlr {
+    // JP: 三角形のインデックスのパック、面積とAABBの計算をチャンクに分けて並列に行い、チャンクごとのAABBを最後にまとめる。
+    //     getPosition(i)はi番目の頂点位置を返す。dstTrianglesがnullptrの場合はインデックスを書き込まない。
+    // EN: Pack triangle indices and compute the areas and the AABB in parallel chunks, then merge the AABB of each chunk at the end.
+    //     getPosition(i) returns the position of the i-th vertex. Indices aren't written if dstTriangles is nullptr.
+    template <typename PositionFunc>
+    void setupTriangles(const uint32_t* indices, uint32_t numTriangles, const PositionFunc &getPosition,
+                        shared::Triangle* dstTriangles, float* areas, BoundingBox3D* aabb) {
+        constexpr uint32_t chunkSize = 1 << 16;
+        uint32_t numChunks = (numTriangles + chunkSize - 1) / chunkSize;
+        std::vector<BoundingBox3D> chunkAabbs(numChunks);
+        ThreadPool::getShared().parallelFor(
+            0, numChunks, 1,
+            [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c) {
+                BoundingBox3D chunkAabb;
+                uint32_t triEnd = std::min(chunkSize * (c + 1), numTriangles);
+                for (uint32_t i = chunkSize * c; i < triEnd; ++i) {
+                    uint32_t i0 = indices[3 * i + 0];
+                    uint32_t i1 = indices[3 * i + 1];
+                    uint32_t i2 = indices[3 * i + 2];
+
+                    if (dstTriangles)
+                        dstTriangles[i] = shared::Triangle{ i0, i1, i2 };
+
+                    Point3D p0 = getPosition(i0);
+                    Point3D p1 = getPosition(i1);
+                    Point3D p2 = getPosition(i2);
+                    areas[i] = 0.5f * cross(p1 - p0, p2 - p0).length();
+
+                    chunkAabb.unify(p0).unify(p1).unify(p2);
+                }
+                chunkAabbs[c] = chunkAabb;
+            }
+        });
+        *aabb = BoundingBox3D();
+        for (const BoundingBox3D &chunkAabb : chunkAabbs)
+            aabb->unify(chunkAabb);
+    }
+
+
+
+    // JP: 頂点をコンパクト形式に変換する。位置を量子化するオフセットとスケールは全頂点のAABBから求める。
+    //     setVertices()で頂点を差し替える場合も、その都度新しい頂点から求め直す。
+    // EN: Convert vertices to the compact format. The offset and scale to quantize positions are derived from
+    //     the AABB of all the vertices.
+    //     They are derived again from the new vertices also when setVertices() replaces vertices.
+    inline void encodeCompactVertices(const Vertex* vertices, uint32_t numVertices,
+                                      shared::CompactVertex* dstVertices,
+                                      Point3D* positionOffset, Vector3D* positionScale) {
+        constexpr uint32_t chunkSize = 1 << 16;
+        uint32_t numChunks = (numVertices + chunkSize - 1) / chunkSize;
+
+        std::vector<BoundingBox3D> chunkAabbs(numChunks);
+        ThreadPool::getShared().parallelFor(
+            0, numChunks, 1,
+            [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c) {
+                BoundingBox3D aabb;
+                for (uint32_t i = chunkSize * c; i < std::min(chunkSize * (c + 1), numVertices); ++i)
+                    aabb.unify(vertices[i].position);
+                chunkAabbs[c] = aabb;
+            }
+        });
+        BoundingBox3D aabb(Point3D(0.0f));
+        if (numVertices > 0) {
+            aabb = chunkAabbs[0];
+            for (const BoundingBox3D &chunkAabb : chunkAabbs)
+                aabb.unify(chunkAabb);
+        }
+        *positionOffset = aabb.centroid();
+        *positionScale = 0.5f * (aabb.maxP - aabb.minP);
+
+        Point3D offset = *positionOffset;
+        Vector3D scale = *positionScale;
+        ThreadPool::getShared().parallelFor(
+            0, numChunks, 1,
+            [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+            for (uint32_t c = chunkBegin; c < chunkEnd; ++c) {
+                for (uint32_t i = chunkSize * c; i < std::min(chunkSize * (c + 1), numVertices); ++i)
+                    dstVertices[i] = shared::encodeCompactVertex(vertices[i], offset, scale);
+            }
+        });
+    }
+}
@@ -994,6 +994,41 @@ namespace optixu {
         m->scene->markSBTLayoutDirty();
     }
 
+    void GeometryAccelerationStructure::setChildren(const GeometryInstance* geomInsts, const CUdeviceptr* preTransforms,
+                                                    uint32_t numChildren) const {
+        struct ChildKeyHash {
+            size_t operator()(const std::pair<_GeometryInstance*, CUdeviceptr> &key) const {
+                return std::hash<_GeometryInstance*>()(key.first) ^ (std::hash<CUdeviceptr>()(key.second) * 31);
+            }
+        };
+        std::unordered_set<std::pair<_GeometryInstance*, CUdeviceptr>, ChildKeyHash> uniqueChildren;
+        uniqueChildren.reserve(numChildren);
+        m->children.clear();
+        m->children.reserve(numChildren);
+        for (uint32_t i = 0; i < numChildren; ++i) {
+            _GeometryInstance* _geomInst = extract(geomInsts[i]);
+            CUdeviceptr preTransform = preTransforms ? preTransforms[i] : 0;
+            m->throwRuntimeError(_geomInst, "Invalid geometry instance %p.", _geomInst);
+            m->throwRuntimeError(_geomInst->getScene() == m->scene, "Scene mismatch for the given geometry instance %s.",
+                                 _geomInst->getName().c_str());
+            m->throwRuntimeError(_geomInst->getGeometryType() == m->geomType,
+                                 "Geometry type mismatch for the given geometry instance %s.",
+                                 _geomInst->getName().c_str());
+            m->throwRuntimeError(m->geomType == GeometryType::Triangles || preTransform == 0,
+                                 "Pre-transform is valid only for triangles.");
+            m->throwRuntimeError(uniqueChildren.insert(std::make_pair(_geomInst, preTransform)).second,
+                                 "Geometry instance %s with transform %p is given multiple times.",
+                                 _geomInst->getName().c_str(), preTransform);
+            Priv::Child child;
+            child.geomInst = _geomInst;
+            child.preTransform = preTransform;
+            m->children.push_back(std::move(child));
+        }
+
+        m->markDirty();
+        m->scene->markSBTLayoutDirty();
+    }
+
     void GeometryAccelerationStructure::markDirty() const {
         m->markDirty();
         m->scene->markSBTLayoutDirty();
@@ -1873,6 +1908,24 @@ namespace optixu {
         m->markDirty(false);
     }
 
+    void InstanceAccelerationStructure::setChildren(const Instance* instances, uint32_t numInstances) const {
+        std::unordered_set<_Instance*> uniqueChildren;
+        uniqueChildren.reserve(numInstances);
+        m->children.clear();
+        m->children.reserve(numInstances);
+        for (uint32_t i = 0; i < numInstances; ++i) {
+            _Instance* _inst = extract(instances[i]);
+            m->throwRuntimeError(_inst, "Invalid instance %p.", _inst);
+            m->throwRuntimeError(_inst->getScene() == m->scene, "Scene mismatch for the given instance %s.",
+                                 _inst->getName().c_str());
+            m->throwRuntimeError(uniqueChildren.insert(_inst).second, "Instance %s is given multiple times.",
+                                 _inst->getName().c_str());
+            m->children.push_back(_inst);
+        }
+
+        m->markDirty(false);
+    }
+
     void InstanceAccelerationStructure::markDirty() const {
         m->markDirty(false);
     }
@@ -1110,6 +1110,9 @@ private: \
         }
         void removeChildAt(uint32_t index) const;
         void clearChildren() const;
+        // JP: 子をまとめて置き換える。preTransformsはnullptrでも良い。子ごとのユーザーデータは空になる。
+        // EN: Replace children at once. preTransforms can be nullptr. Per-child user data becomes empty.
+        void setChildren(const GeometryInstance* geomInsts, const CUdeviceptr* preTransforms, uint32_t numChildren) const;
 
         // JP: GASをdirty状態にする。
         //     ヒットグループのシェーダーバインディングテーブルレイアウトも無効化される。
@@ -1282,6 +1285,9 @@ private: \
         void addChild(Instance instance) const;
         void removeChildAt(uint32_t index) const;
         void clearChildren() const;
+        // JP: 子をまとめて置き換える。多数の子を1つずつ追加・削除するよりも高速。
+        // EN: Replace children at once. Faster than adding / removing many children one by one.
+        void setChildren(const Instance* instances, uint32_t numInstances) const;
 
         // JP: IASをdirty状態にする。
         // EN: Mark the IAS dirty.
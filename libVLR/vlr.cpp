@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "scene.h"
+#include "bc_codec.h"
 
 // e.g. Object
 // typedef vlr::Object* VLRObject;
@@ -42,6 +43,34 @@ inline bool nonNullAndCheckType(const vlr::TypeAwareClass* obj) {
     return true;
 }
 
+// JP: 列挙子の文字列を値に変換する。nullptrや未知の文字列の場合はfalseを返す。
+// EN: Convert an enum member string to its value. Return false for nullptr or an unknown string.
+template <typename EnumType>
+inline bool tryGetEnumValueFromMember(const char* member, EnumType* value) {
+    if (member == nullptr)
+        return false;
+    *value = vlr::getEnumValueFromMember<EnumType>(member);
+    return static_cast<uint32_t>(*value) != 0xFFFFFFFF;
+}
+
+// JP: 所有権を受け取る前に、ブロック圧縮形式のミップチェーンの大きさとサイズを検証する。
+// EN: Validate the dimensions and sizes of a block compressed mip chain before taking ownership.
+static bool validateBlockCompressedMipChain(const size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+                                            vlr::DataFormat bcFormat) {
+    if (bcFormat < vlr::DataFormat::BC1 || bcFormat > vlr::DataFormat::BC7)
+        return false;
+    if (width == 0 || height == 0 ||
+        mipCount > vlr::Image2D::getNumMipmapLevelsForFullChain(width, height))
+        return false;
+    for (uint32_t m = 0; m < mipCount; ++m) {
+        uint32_t mipWidth = std::max<uint32_t>(width >> m, 1);
+        uint32_t mipHeight = std::max<uint32_t>(height >> m, 1);
+        if (sizes[m] < vlr::getBlockCompressedDataSize(bcFormat, mipWidth, mipHeight))
+            return false;
+    }
+    return true;
+}
+
 
 
 VLR_API const char* vlrGetErrorMessage(VLRResult code) {
@@ -102,6 +131,25 @@ VLR_API VLRResult vlrContextGetCUcontext(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrContextGetBuildFlavor(
+    VLRContext context,
+    const char** flavor) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(context, vlr::Context);
+        if (flavor == nullptr)
+            return VLRResult_InvalidArgument;
+
+#if defined(VLR_USE_SPECTRAL_RENDERING)
+        *flavor = "Spectral";
+#else
+        *flavor = "RGB";
+#endif
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 
 
 VLR_API VLRResult vlrContextBindOutputBuffer(
@@ -232,6 +280,69 @@ VLR_API VLRResult vlrContextRender(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrContextSetDefaultImageResidencyPolicy(
+    VLRContext context,
+    const char* policy) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(context, vlr::Context);
+
+        vlr::ImageResidencyPolicy ePolicy;
+        if (!tryGetEnumValueFromMember(policy, &ePolicy))
+            return VLRResult_InvalidArgument;
+
+        context->setDefaultImageResidencyPolicy(ePolicy);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrContextGetImageMemoryReport(
+    VLRContext context,
+    uint32_t* numImages, uint32_t* numReleasedImages,
+    size_t* hostResidentSize, size_t* spilledSize, size_t* deviceSize) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(context, vlr::Context);
+        if (numImages == nullptr || numReleasedImages == nullptr ||
+            hostResidentSize == nullptr || spilledSize == nullptr || deviceSize == nullptr)
+            return VLRResult_InvalidArgument;
+
+        vlr::ImageMemoryReport report;
+        context->getImageMemoryReport(&report);
+        *numImages = report.numImages;
+        *numReleasedImages = report.numReleasedImages;
+        *hostResidentSize = report.hostResidentSize;
+        *spilledSize = report.spilledSize;
+        *deviceSize = report.deviceSize;
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrContextGetVertexMemoryReport(
+    VLRContext context,
+    uint32_t* numMeshes, uint32_t* numCompactMeshes, uint32_t* numVertices,
+    size_t* fullFormatSize, size_t* compactFormatSize) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(context, vlr::Context);
+        if (numMeshes == nullptr || numCompactMeshes == nullptr || numVertices == nullptr ||
+            fullFormatSize == nullptr || compactFormatSize == nullptr)
+            return VLRResult_InvalidArgument;
+
+        vlr::VertexMemoryReport report;
+        context->getVertexMemoryReport(&report);
+        *numMeshes = report.numMeshes;
+        *numCompactMeshes = report.numCompactMeshes;
+        *numVertices = report.numVertices;
+        *fullFormatSize = report.fullFormatSize;
+        *compactFormatSize = report.compactFormatSize;
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 
 
 VLR_API VLRResult vlrObjectGetType(
@@ -761,6 +872,32 @@ VLR_API VLRResult vlrImage2DGetStride(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrImage2DGetDataFormat(
+    VLRImage2DConst image,
+    const char** format) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(image, vlr::Image2D);
+
+        *format = vlr::getEnumMemberFromValue(image->getDataFormat());
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrImage2DGetNumMipmapLevels(
+    VLRImage2DConst image,
+    uint32_t* numMipmapLevels) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(image, vlr::Image2D);
+
+        *numMipmapLevels = image->getNumMipmapLevels();
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 VLR_API VLRResult vlrImage2DGetOriginalDataFormat(
     VLRImage2DConst image,
     const char** format) {
@@ -787,6 +924,23 @@ VLR_API VLRResult vlrImage2DOriginalHasAlpha(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrImage2DSetResidencyPolicy(
+    VLRImage2D image,
+    const char* policy) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(image, vlr::Image2D);
+
+        vlr::ImageResidencyPolicy ePolicy;
+        if (!tryGetEnumValueFromMember(policy, &ePolicy))
+            return VLRResult_InvalidArgument;
+
+        image->setResidencyPolicy(ePolicy);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 
 
 VLR_API VLRResult vlrLinearImage2DCreate(
@@ -794,6 +948,20 @@ VLR_API VLRResult vlrLinearImage2DCreate(
     uint8_t* linearData, uint32_t width, uint32_t height,
     const char* format, const char* spectrumType, const char* colorSpace,
     VLRLinearImage2D* image) {
+    return vlrLinearImage2DCreateWithMipmaps(
+        context,
+        linearData, width, height,
+        format, spectrumType, colorSpace,
+        false,
+        image);
+}
+
+VLR_API VLRResult vlrLinearImage2DCreateWithMipmaps(
+    VLRContext context,
+    uint8_t* linearData, uint32_t width, uint32_t height,
+    const char* format, const char* spectrumType, const char* colorSpace,
+    bool generateMipmaps,
+    VLRLinearImage2D* image) {
     try {
         if (image == nullptr || linearData == nullptr)
             return VLRResult_InvalidArgument;
@@ -801,6 +969,87 @@ VLR_API VLRResult vlrLinearImage2DCreate(
         *image = new vlr::LinearImage2D(*context, linearData, width, height,
                                         vlr::getEnumValueFromMember<vlr::DataFormat>(format),
                                         vlr::getEnumValueFromMember<vlr::SpectrumType>(spectrumType),
+                                        vlr::getEnumValueFromMember<vlr::ColorSpace>(colorSpace),
+                                        generateMipmaps);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrLinearImage2DCreateFromOwnedData(
+    VLRContext context,
+    uint8_t* linearData, uint32_t width, uint32_t height,
+    const char* format, const char* spectrumType, const char* colorSpace,
+    bool generateMipmaps,
+    VLRImageDataReleaseFunction release, void* userData,
+    VLRLinearImage2D* image) {
+    try {
+        if (image == nullptr || linearData == nullptr)
+            return VLRResult_InvalidArgument;
+
+        // JP: サイズを求める前に形式を検証する。不正な場合もreleaseを一度だけ呼ぶ。
+        // EN: Validate the formats before computing the size. Call release exactly once also when rejected.
+        vlr::DataFormat eDataFormat;
+        vlr::SpectrumType eSpectrumType;
+        vlr::ColorSpace eColorSpace;
+        if (!tryGetEnumValueFromMember(format, &eDataFormat) ||
+            !tryGetEnumValueFromMember(spectrumType, &eSpectrumType) ||
+            !tryGetEnumValueFromMember(colorSpace, &eColorSpace) ||
+            (eDataFormat >= vlr::DataFormat::BC1 && eDataFormat <= vlr::DataFormat::BC7) ||
+            width == 0 || height == 0) {
+            if (release)
+                release(userData);
+            return VLRResult_InvalidArgument;
+        }
+
+        size_t size = vlr::sizesOfDataFormats[static_cast<uint32_t>(eDataFormat)] * width * height;
+        const uint8_t* levels[] = { linearData };
+        vlr::ExternalImageData externalData(levels, &size, 1, release, userData);
+
+        *image = new vlr::LinearImage2D(*context, std::move(externalData), width, height,
+                                        eDataFormat, eSpectrumType, eColorSpace,
+                                        generateMipmaps);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrLinearImage2DCreateFromConvertedData(
+    VLRContext context,
+    uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+    const char* originalFormat, const char* dataFormat, const char* spectrumType, const char* colorSpace,
+    VLRImageDataReleaseFunction release, void* userData,
+    VLRLinearImage2D* image) {
+    try {
+        if (image == nullptr || data == nullptr || sizes == nullptr || mipCount == 0)
+            return VLRResult_InvalidArgument;
+        for (int m = 0; m < static_cast<int>(mipCount); ++m) {
+            if (data[m] == nullptr)
+                return VLRResult_InvalidArgument;
+        }
+
+        vlr::ExternalImageData externalData(data, sizes, mipCount, release, userData);
+
+        // JP: キャッシュファイルなど外部から来たデータなので形式とサイズを検証する。
+        // EN: Validate the formats and sizes since the data comes from outside, e.g. a cache file.
+        vlr::DataFormat eOriginalFormat = vlr::getEnumValueFromMember<vlr::DataFormat>(originalFormat);
+        vlr::DataFormat eDataFormat = vlr::getEnumValueFromMember<vlr::DataFormat>(dataFormat);
+        vlr::SpectrumType eSpectrumType = vlr::getEnumValueFromMember<vlr::SpectrumType>(spectrumType);
+        if (eOriginalFormat >= vlr::DataFormat::BC1 && eOriginalFormat <= vlr::DataFormat::BC7)
+            return VLRResult_InvalidArgument;
+        if (eDataFormat != vlr::Image2D::getInternalFormat(eOriginalFormat, eSpectrumType) ||
+            mipCount > vlr::Image2D::getNumMipmapLevelsForFullChain(width, height))
+            return VLRResult_InvalidArgument;
+        size_t stride = vlr::sizesOfDataFormats[static_cast<uint32_t>(eDataFormat)];
+        for (uint32_t m = 0; m < mipCount; ++m) {
+            if (sizes[m] < stride * std::max<uint32_t>(width >> m, 1) * std::max<uint32_t>(height >> m, 1))
+                return VLRResult_InvalidArgument;
+        }
+
+        *image = new vlr::LinearImage2D(*context, std::move(externalData), width, height,
+                                        eOriginalFormat, eDataFormat, eSpectrumType,
                                         vlr::getEnumValueFromMember<vlr::ColorSpace>(colorSpace));
 
         return VLRResult_NoError;
@@ -821,6 +1070,21 @@ VLR_API VLRResult vlrLinearImage2DDestroy(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrLinearImage2DCopyLevelData(
+    VLRLinearImage2DConst image,
+    uint32_t mipLevel, uint8_t* data, size_t* size) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(image, vlr::LinearImage2D);
+        if (size == nullptr || mipLevel >= image->getNumMipmapLevels())
+            return VLRResult_InvalidArgument;
+
+        *size = image->copyLevelData(mipLevel, data);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 
 
 VLR_API VLRResult vlrBlockCompressedImage2DCreate(
@@ -846,6 +1110,66 @@ VLR_API VLRResult vlrBlockCompressedImage2DCreate(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrBlockCompressedImage2DCreateFromOwnedData(
+    VLRContext context,
+    uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+    const char* dataFormat, const char* spectrumType, const char* colorSpace,
+    VLRImageDataReleaseFunction release, void* userData,
+    VLRBlockCompressedImage2D* image) {
+    try {
+        if (image == nullptr || data == nullptr || sizes == nullptr || mipCount == 0)
+            return VLRResult_InvalidArgument;
+        for (int m = 0; m < static_cast<int>(mipCount); ++m) {
+            if (data[m] == nullptr)
+                return VLRResult_InvalidArgument;
+        }
+
+        vlr::DataFormat eDataFormat = vlr::getEnumValueFromMember<vlr::DataFormat>(dataFormat);
+        if (!validateBlockCompressedMipChain(sizes, mipCount, width, height, eDataFormat))
+            return VLRResult_InvalidArgument;
+
+        vlr::ExternalImageData externalData(data, sizes, mipCount, release, userData);
+        *image = new vlr::BlockCompressedImage2D(*context, std::move(externalData), width, height,
+                                                 eDataFormat,
+                                                 vlr::getEnumValueFromMember<vlr::SpectrumType>(spectrumType),
+                                                 vlr::getEnumValueFromMember<vlr::ColorSpace>(colorSpace));
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrBlockCompressedImage2DCreateFromLinearData(
+    VLRContext context,
+    uint8_t* linearData, uint32_t width, uint32_t height,
+    const char* format, const char* spectrumType, const char* colorSpace,
+    bool generateMipmaps, const char* quality,
+    VLRBlockCompressedImage2D* image) {
+    try {
+        if (image == nullptr || linearData == nullptr || width == 0 || height == 0)
+            return VLRResult_InvalidArgument;
+
+        vlr::DataFormat eDataFormat;
+        vlr::SpectrumType eSpectrumType;
+        vlr::ColorSpace eColorSpace;
+        vlr::BlockCompressionQuality eQuality;
+        if (!tryGetEnumValueFromMember(format, &eDataFormat) ||
+            !tryGetEnumValueFromMember(spectrumType, &eSpectrumType) ||
+            !tryGetEnumValueFromMember(colorSpace, &eColorSpace) ||
+            !tryGetEnumValueFromMember(quality, &eQuality))
+            return VLRResult_InvalidArgument;
+        if (vlr::BlockCompressedImage2D::getEncodedDataFormat(eDataFormat) == vlr::DataFormat::NumFormats)
+            return VLRResult_InvalidArgument;
+
+        *image = new vlr::BlockCompressedImage2D(*context, linearData, width, height,
+                                                 eDataFormat, eSpectrumType, eColorSpace,
+                                                 generateMipmaps, eQuality);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 VLR_API VLRResult vlrBlockCompressedImage2DDestroy(
     VLRContext context,
     VLRBlockCompressedImage2D image) {
@@ -859,6 +1183,47 @@ VLR_API VLRResult vlrBlockCompressedImage2DDestroy(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrBlockCompressedImage2DGetEncodingStatistics(
+    VLRBlockCompressedImage2DConst image,
+    float* psnr, float* encodingTimeInMs) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(image, vlr::BlockCompressedImage2D);
+        if (psnr == nullptr || encodingTimeInMs == nullptr)
+            return VLRResult_InvalidArgument;
+
+        *psnr = image->getEncodingPSNR();
+        *encodingTimeInMs = image->getEncodingTime();
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrBlockCompressedImage2DReplaceWithOwnedData(
+    VLRBlockCompressedImage2D image,
+    uint8_t** data, size_t* sizes, uint32_t mipCount, uint32_t width, uint32_t height,
+    VLRImageDataReleaseFunction release, void* userData) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(image, vlr::BlockCompressedImage2D);
+        if (data == nullptr || sizes == nullptr || mipCount == 0)
+            return VLRResult_InvalidArgument;
+        for (int m = 0; m < static_cast<int>(mipCount); ++m) {
+            if (data[m] == nullptr)
+                return VLRResult_InvalidArgument;
+        }
+
+        if (!validateBlockCompressedMipChain(sizes, mipCount, width, height, image->getDataFormat()) ||
+            image->isUsedAsEnvironmentTexture())
+            return VLRResult_InvalidArgument;
+
+        vlr::ExternalImageData externalData(data, sizes, mipCount, release, userData);
+        image->replaceData(std::move(externalData), width, height);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 
 
 VLR_API VLRResult vlrShaderNodeCreate(
@@ -1121,6 +1486,21 @@ VLR_API VLRResult vlrTriangleMeshSurfaceNodeDestroy(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVertexFormat(
+    VLRTriangleMeshSurfaceNode surfaceNode,
+    VLRVertexFormat format) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(surfaceNode, vlr::TriangleMeshSurfaceNode);
+        if (format != VLRVertexFormat_Full && format != VLRVertexFormat_Compact)
+            return VLRResult_InvalidArgument;
+
+        surfaceNode->setVertexFormat(format);
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVertices(
     VLRTriangleMeshSurfaceNode surfaceNode,
     const VLRVertex* vertices, uint32_t numVertices) {
@@ -1129,8 +1509,8 @@ VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVertices(
         if (vertices == nullptr)
             return VLRResult_InvalidArgument;
 
-        std::vector<vlr::Vertex> vecVertices(numVertices);
-        std::copy_n(reinterpret_cast<const vlr::Vertex*>(vertices), numVertices, vecVertices.data());
+        const vlr::Vertex* vertexData = reinterpret_cast<const vlr::Vertex*>(vertices);
+        std::vector<vlr::Vertex> vecVertices(vertexData, vertexData + numVertices);
 
         surfaceNode->setVertices(std::move(vecVertices));
 
@@ -1139,6 +1519,25 @@ VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVertices(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrTriangleMeshSurfaceNodeSetVerticesFromOwnedData(
+    VLRTriangleMeshSurfaceNode surfaceNode,
+    const VLRVertex* vertices, uint32_t numVertices,
+    VLRMeshDataReleaseFunction release, void* userData) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(surfaceNode, vlr::TriangleMeshSurfaceNode);
+        if (vertices == nullptr || release == nullptr)
+            return VLRResult_InvalidArgument;
+
+        vlr::HostArray<vlr::Vertex> ownedVertices(
+            reinterpret_cast<const vlr::Vertex*>(vertices), numVertices, release, userData);
+
+        surfaceNode->setVertices(std::move(ownedVertices));
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 VLR_API VLRResult vlrTriangleMeshSurfaceNodeAddMaterialGroup(
     VLRTriangleMeshSurfaceNode surfaceNode,
     const uint32_t* indices, uint32_t numIndices, 
@@ -1149,8 +1548,7 @@ VLR_API VLRResult vlrTriangleMeshSurfaceNodeAddMaterialGroup(
         if (indices == nullptr || !nonNullAndCheckType<vlr::SurfaceMaterial>(material))
             return VLRResult_InvalidArgument;
 
-        std::vector<uint32_t> vecIndices(numIndices);
-        std::copy_n(indices, numIndices, vecIndices.data());
+        std::vector<uint32_t> vecIndices(indices, indices + numIndices);
 
         surfaceNode->addMaterialGroup(std::move(vecIndices), material,
             vlr::ShaderNodePlug(nodeNormal),
@@ -1162,6 +1560,29 @@ VLR_API VLRResult vlrTriangleMeshSurfaceNodeAddMaterialGroup(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrTriangleMeshSurfaceNodeAddMaterialGroupFromOwnedData(
+    VLRTriangleMeshSurfaceNode surfaceNode,
+    const uint32_t* indices, uint32_t numIndices,
+    VLRSurfaceMaterialConst material,
+    VLRShaderNodePlug nodeNormal, VLRShaderNodePlug nodeTangent, VLRShaderNodePlug nodeAlpha,
+    VLRMeshDataReleaseFunction release, void* userData) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(surfaceNode, vlr::TriangleMeshSurfaceNode);
+        if (indices == nullptr || release == nullptr || !nonNullAndCheckType<vlr::SurfaceMaterial>(material))
+            return VLRResult_InvalidArgument;
+
+        vlr::HostArray<uint32_t> ownedIndices(indices, numIndices, release, userData);
+
+        surfaceNode->addMaterialGroup(std::move(ownedIndices), material,
+            vlr::ShaderNodePlug(nodeNormal),
+            vlr::ShaderNodePlug(nodeTangent),
+            vlr::ShaderNodePlug(nodeAlpha));
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 
 
 VLR_API VLRResult vlrPointSurfaceNodeCreate(
@@ -1200,8 +1621,8 @@ VLR_API VLRResult vlrPointSurfaceNodeSetVertices(
         if (vertices == nullptr)
             return VLRResult_InvalidArgument;
 
-        std::vector<vlr::Vertex> vecVertices(numVertices);
-        std::copy_n(reinterpret_cast<const vlr::Vertex*>(vertices), numVertices, vecVertices.data());
+        const vlr::Vertex* vertexData = reinterpret_cast<const vlr::Vertex*>(vertices);
+        std::vector<vlr::Vertex> vecVertices(vertexData, vertexData + numVertices);
 
         surfaceNode->setVertices(std::move(vecVertices));
 
@@ -1219,8 +1640,7 @@ VLR_API VLRResult vlrPointSurfaceNodeAddMaterialGroup(
         if (indices == nullptr || !nonNullAndCheckType<vlr::SurfaceMaterial>(material))
             return VLRResult_InvalidArgument;
 
-        std::vector<uint32_t> vecIndices(numIndices);
-        std::copy_n(indices, numIndices, vecIndices.data());
+        std::vector<uint32_t> vecIndices(indices, indices + numIndices);
 
         surfaceNode->addMaterialGroup(std::move(vecIndices), material);
 
@@ -1435,6 +1855,32 @@ VLR_API VLRResult vlrSceneSetEnvironmentRotation(
     VLR_RETURN_INTERNAL_ERROR();
 }
 
+VLR_API VLRResult vlrSceneBeginEdits(
+    VLRScene scene) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(scene, vlr::Scene);
+
+        scene->beginEdits();
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
+VLR_API VLRResult vlrSceneCommitEdits(
+    VLRScene scene) {
+    try {
+        VLR_RETURN_INVALID_INSTANCE(scene, vlr::Scene);
+        if (!scene->isEditing())
+            return VLRResult_InvalidArgument;
+
+        scene->commitEdits();
+
+        return VLRResult_NoError;
+    }
+    VLR_RETURN_INTERNAL_ERROR();
+}
+
 
 
 
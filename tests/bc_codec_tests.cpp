@@ -0,0 +1,432 @@
+#include "test_common.h"
+#include "bc_codec.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: 既知のブロックとそのデコード結果。
+//     BC1-5はD3D11の仕様の式(補間は最近接に丸める)から手で組み立てたブロックで、ピクセルiはインデックスi mod 4(8)を使う。
+//     BC7は各モードのランダムなブロックを独立した実装(Pillow)でデコードした結果で、全モードで完全に一致する。
+//     BC1-4ではPillowは補間を切り捨てるため、1だけずれる値がある。
+// EN: Known blocks and their decoded results.
+//     BC1-5 are blocks assembled by hand following the formulas of the D3D11 spec (interpolation rounds to nearest),
+//     where pixel i uses index i mod 4 (8).
+//     BC7 are random blocks of each mode decoded by an independent implementation (Pillow), which matches exactly
+//     for all modes. For BC1-4, Pillow truncates interpolation, so some values differ by 1.
+struct KnownRGBA8Block {
+    const char* name;
+    void (*decode)(const uint8_t* block, RGBA8x4 pixels[16]);
+    uint8_t block[16];
+    uint8_t expected[64];
+};
+
+static const KnownRGBA8Block knownRGBA8Blocks[] = {
+    // JP: c0 > c1: 4色モード。c0 = (31, 40, 5), c1 = (2, 63, 30)
+    // EN: c0 > c1: four-color mode. c0 = (31, 40, 5), c1 = (2, 63, 30)
+    {
+        "BC1 four colors", decodeBC1Block,
+        { 0x05, 0xFD, 0xFE, 0x17, 0xE4, 0xE4, 0xE4, 0xE4 },
+        {
+            255, 162, 41, 255, 16, 255, 247, 255, 175, 193, 110, 255, 96, 224, 178, 255,
+            255, 162, 41, 255, 16, 255, 247, 255, 175, 193, 110, 255, 96, 224, 178, 255,
+            255, 162, 41, 255, 16, 255, 247, 255, 175, 193, 110, 255, 96, 224, 178, 255,
+            255, 162, 41, 255, 16, 255, 247, 255, 175, 193, 110, 255, 96, 224, 178, 255,
+        }
+    },
+    // JP: c0 <= c1: 3色 + 透明な黒。
+    // EN: c0 <= c1: three colors + transparent black.
+    {
+        "BC1 three colors", decodeBC1Block,
+        { 0xFE, 0x17, 0x05, 0xFD, 0xE4, 0xE4, 0xE4, 0xE4 },
+        {
+            16, 255, 247, 255, 255, 162, 41, 255, 136, 209, 144, 255, 0, 0, 0, 0,
+            16, 255, 247, 255, 255, 162, 41, 255, 136, 209, 144, 255, 0, 0, 0, 0,
+            16, 255, 247, 255, 255, 162, 41, 255, 136, 209, 144, 255, 0, 0, 0, 0,
+            16, 255, 247, 255, 255, 162, 41, 255, 136, 209, 144, 255, 0, 0, 0, 0,
+        }
+    },
+    // JP: BC2/3のカラーブロックはc0 <= c1でも4色。BC2のピクセルiのアルファはi * 17。
+    // EN: The color block of BC2/3 has four colors even with c0 <= c1. The alpha of pixel i of BC2 is i * 17.
+    {
+        "BC2", decodeBC2Block,
+        { 0x10, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE, 0xFE, 0x17, 0x05, 0xFD, 0xE4, 0xE4, 0xE4, 0xE4 },
+        {
+            16, 255, 247, 0, 255, 162, 41, 17, 96, 224, 178, 34, 175, 193, 110, 51,
+            16, 255, 247, 68, 255, 162, 41, 85, 96, 224, 178, 102, 175, 193, 110, 119,
+            16, 255, 247, 136, 255, 162, 41, 153, 96, 224, 178, 170, 175, 193, 110, 187,
+            16, 255, 247, 204, 255, 162, 41, 221, 96, 224, 178, 238, 175, 193, 110, 255,
+        }
+    },
+    // JP: a0 = 200 > a1 = 30: 8段階のアルファ。
+    // EN: a0 = 200 > a1 = 30: 8-step alpha.
+    {
+        "BC3 8-step alpha", decodeBC3Block,
+        { 0xC8, 0x1E, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA, 0xFE, 0x17, 0x05, 0xFD, 0xE4, 0xE4, 0xE4, 0xE4 },
+        {
+            16, 255, 247, 200, 255, 162, 41, 30, 96, 224, 178, 176, 175, 193, 110, 151,
+            16, 255, 247, 127, 255, 162, 41, 103, 96, 224, 178, 79, 175, 193, 110, 54,
+            16, 255, 247, 200, 255, 162, 41, 30, 96, 224, 178, 176, 175, 193, 110, 151,
+            16, 255, 247, 127, 255, 162, 41, 103, 96, 224, 178, 79, 175, 193, 110, 54,
+        }
+    },
+    // JP: a0 = 30 <= a1 = 200: 6段階 + 0, 255。
+    // EN: a0 = 30 <= a1 = 200: 6-step + 0, 255.
+    {
+        "BC3 6-step alpha", decodeBC3Block,
+        { 0x1E, 0xC8, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA, 0xFE, 0x17, 0x05, 0xFD, 0xE4, 0xE4, 0xE4, 0xE4 },
+        {
+            16, 255, 247, 30, 255, 162, 41, 200, 96, 224, 178, 64, 175, 193, 110, 98,
+            16, 255, 247, 132, 255, 162, 41, 166, 96, 224, 178, 0, 175, 193, 110, 255,
+            16, 255, 247, 30, 255, 162, 41, 200, 96, 224, 178, 64, 175, 193, 110, 98,
+            16, 255, 247, 132, 255, 162, 41, 166, 96, 224, 178, 0, 175, 193, 110, 255,
+        }
+    },
+    {
+        "BC7 mode 0", decodeBC7Block,
+        { 0x53, 0xF2, 0x26, 0x65, 0xA6, 0x0C, 0x12, 0xD2, 0x89, 0x18, 0x5D, 0x95, 0x0E, 0xE8, 0x81, 0x36 },
+        {
+            82, 49, 62, 255, 65, 49, 42, 255, 116, 49, 106, 255, 65, 49, 42, 255,
+            99, 89, 187, 255, 57, 107, 74, 255, 115, 82, 231, 255, 115, 82, 231, 255,
+            99, 89, 187, 255, 65, 103, 96, 255, 91, 93, 165, 255, 115, 82, 231, 255,
+            86, 90, 147, 255, 56, 134, 186, 255, 56, 134, 186, 255, 148, 0, 66, 255,
+        }
+    },
+    {
+        "BC7 mode 1", decodeBC7Block,
+        { 0x0A, 0x16, 0x6F, 0x6B, 0x11, 0x3D, 0x17, 0x8D, 0x6C, 0x0F, 0xD3, 0x90, 0x1F, 0xF2, 0x39, 0xA1 },
+        {
+            90, 70, 54, 255, 138, 74, 72, 255, 203, 181, 190, 255, 154, 100, 100, 255,
+            178, 152, 140, 255, 106, 22, 14, 255, 171, 129, 133, 255, 219, 207, 219, 255,
+            112, 90, 75, 255, 106, 22, 14, 255, 171, 129, 133, 255, 122, 48, 43, 255,
+            112, 90, 75, 255, 203, 181, 190, 255, 154, 100, 100, 255, 187, 155, 161, 255,
+        }
+    },
+    {
+        "BC7 mode 2", decodeBC7Block,
+        { 0xA4, 0x95, 0xF2, 0x0F, 0x93, 0x95, 0x65, 0x0C, 0xF9, 0x38, 0x0B, 0x8E, 0xDB, 0x22, 0x4A, 0x6B },
+        {
+            82, 128, 76, 255, 144, 73, 76, 255, 33, 206, 115, 255, 87, 141, 96, 255,
+            82, 90, 57, 255, 247, 148, 181, 255, 206, 145, 122, 255, 247, 148, 181, 255,
+            82, 128, 76, 255, 206, 145, 122, 255, 164, 143, 59, 255, 164, 143, 59, 255,
+            82, 128, 76, 255, 144, 73, 76, 255, 33, 206, 115, 255, 198, 8, 57, 255,
+        }
+    },
+    {
+        "BC7 mode 3", decodeBC7Block,
+        { 0x28, 0x8A, 0x1E, 0x92, 0x4E, 0x8F, 0xD0, 0xAE, 0x2E, 0x1A, 0x94, 0x92, 0xA3, 0x30, 0x5F, 0x18 },
+        {
+            68, 122, 22, 255, 37, 219, 41, 255, 56, 85, 24, 255, 44, 203, 52, 255,
+            37, 219, 41, 255, 43, 46, 25, 255, 44, 203, 52, 255, 68, 122, 22, 255,
+            31, 9, 27, 255, 59, 171, 75, 255, 56, 85, 24, 255, 44, 203, 52, 255,
+            37, 219, 41, 255, 43, 46, 25, 255, 44, 203, 52, 255, 68, 122, 22, 255,
+        }
+    },
+    {
+        "BC7 mode 4", decodeBC7Block,
+        { 0x90, 0xB6, 0x10, 0x90, 0x0F, 0x9E, 0x34, 0x7F, 0xAE, 0x88, 0x6D, 0xC6, 0x50, 0x77, 0x95, 0xEC },
+        {
+            142, 24, 164, 164, 80, 9, 99, 99, 161, 28, 185, 164, 122, 19, 143, 99,
+            100, 14, 120, 36, 161, 28, 185, 36, 100, 14, 120, 36, 142, 24, 164, 227,
+            41, 0, 57, 36, 61, 5, 78, 164, 80, 9, 99, 164, 142, 24, 164, 164,
+            161, 28, 185, 227, 161, 28, 185, 164, 122, 19, 143, 227, 41, 0, 57, 36,
+        }
+    },
+    {
+        "BC7 mode 5", decodeBC7Block,
+        { 0x60, 0x5C, 0x4C, 0x3F, 0xCB, 0x2E, 0xB2, 0xC7, 0x3E, 0x14, 0x93, 0x4C, 0x86, 0x7E, 0xE0, 0x57 },
+        {
+            217, 227, 191, 140, 217, 179, 139, 48, 236, 227, 191, 140, 196, 251, 217, 185,
+            196, 203, 165, 93, 177, 203, 165, 93, 177, 251, 217, 185, 217, 203, 165, 93,
+            236, 227, 191, 140, 236, 203, 165, 93, 196, 251, 217, 185, 177, 227, 191, 140,
+            177, 203, 165, 93, 217, 227, 191, 140, 217, 203, 165, 93, 217, 251, 217, 185,
+        }
+    },
+    {
+        "BC7 mode 6", decodeBC7Block,
+        { 0xC0, 0x72, 0x49, 0x9B, 0xFA, 0x12, 0x1E, 0x83, 0x6B, 0x2A, 0xC1, 0x57, 0x26, 0xEE, 0x7D, 0x6B },
+        {
+            161, 149, 131, 23, 151, 141, 117, 21, 117, 115, 69, 15, 185, 167, 165, 28,
+            195, 175, 180, 30, 101, 103, 46, 12, 143, 135, 106, 20, 161, 149, 131, 23,
+            151, 141, 117, 21, 185, 167, 165, 28, 83, 89, 20, 9, 83, 89, 20, 9,
+            93, 97, 35, 10, 143, 135, 106, 20, 109, 109, 57, 13, 151, 141, 117, 21,
+        }
+    },
+    {
+        "BC7 mode 7", decodeBC7Block,
+        { 0x80, 0xF6, 0xAB, 0x13, 0xC3, 0x8E, 0x92, 0xCA, 0xE0, 0xD1, 0x50, 0x57, 0xB1, 0x59, 0x98, 0x7F },
+        {
+            125, 134, 85, 166, 183, 72, 83, 117, 170, 70, 42, 146, 155, 202, 164, 60,
+            140, 167, 124, 114, 155, 202, 164, 60, 170, 70, 42, 146, 170, 70, 42, 146,
+            158, 69, 4, 174, 155, 202, 164, 60, 140, 167, 124, 114, 183, 72, 83, 117,
+            195, 73, 121, 89, 195, 73, 121, 89, 170, 235, 203, 8, 140, 167, 124, 114,
+        }
+    },
+    // JP: モードビットが無いブロックは不正で、仕様では透明な黒になる。
+    // EN: A block without mode bits is invalid and decodes to transparent black by the spec.
+    {
+        "BC7 invalid mode", decodeBC7Block,
+        { 0x00, 0x22, 0xCA, 0x24, 0x6E, 0xEC, 0xEF, 0x1A, 0x59, 0xB6, 0x0D, 0xED, 0x27, 0xFC, 0x51, 0x94 },
+        {}
+    },
+};
+
+VLR_TEST(BCCodec_DecodeKnownRGBA8Blocks) {
+    for (const KnownRGBA8Block &kb : knownRGBA8Blocks) {
+        RGBA8x4 pixels[16];
+        kb.decode(kb.block, pixels);
+        uint32_t numMismatches = 0;
+        for (uint32_t i = 0; i < 16; ++i) {
+            const uint8_t* expected = &kb.expected[4 * i];
+            numMismatches += pixels[i].r != expected[0] || pixels[i].g != expected[1] ||
+                pixels[i].b != expected[2] || pixels[i].a != expected[3];
+        }
+        VLR_CHECK(numMismatches == 0, "%s: %u pixels differ", kb.name, numMismatches);
+    }
+}
+
+// JP: v0 = 250 > v1 = 10の8段階と、v0 = 10 <= v1 = 250の6段階 + 0, 255。BC5は前者を赤、後者を緑に使う。
+// EN: 8-step with v0 = 250 > v1 = 10, and 6-step + 0, 255 with v0 = 10 <= v1 = 250.
+//     BC5 uses the former for red and the latter for green.
+static const uint8_t bc4Blocks[2][8] = {
+    { 0xFA, 0x0A, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA },
+    { 0x0A, 0xFA, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA },
+};
+static const uint8_t bc4Palettes[2][8] = {
+    { 250, 10, 216, 181, 147, 113, 79, 44 },
+    { 10, 250, 58, 106, 154, 202, 0, 255 },
+};
+
+// JP: 符号付き。v0 = 127(1.0) > v1 = -128(-1.0として扱う)の8段階と、v0 = -100 <= v1 = 90の6段階 + -1, 1。
+// EN: Signed. 8-step with v0 = 127 (1.0) > v1 = -128 (treated as -1.0),
+//     and 6-step + -1, 1 with v0 = -100 <= v1 = 90.
+static const uint8_t bc4SignedBlocks[2][8] = {
+    { 0x7F, 0x80, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA },
+    { 0x9C, 0x5A, 0x88, 0xC6, 0xFA, 0x88, 0xC6, 0xFA },
+};
+static const float bc4SignedPalettes[2][8] = {
+    { 1.0f, -1.0f, 5 / 7.0f, 3 / 7.0f, 1 / 7.0f, -1 / 7.0f, -3 / 7.0f, -5 / 7.0f },
+    { -100 / 127.0f, 90 / 127.0f, -62 / 127.0f, -24 / 127.0f, 14 / 127.0f, 52 / 127.0f, -1.0f, 1.0f },
+};
+
+VLR_TEST(BCCodec_DecodeKnownBC4BC5Blocks) {
+    for (uint32_t b = 0; b < 2; ++b) {
+        Gray8 unormPixels[16];
+        decodeBC4Block(bc4Blocks[b], unormPixels);
+        Gray32F snormPixels[16];
+        decodeBC4SignedBlock(bc4SignedBlocks[b], snormPixels);
+        uint32_t numUNormMismatches = 0;
+        uint32_t numSNormMismatches = 0;
+        for (uint32_t i = 0; i < 16; ++i) {
+            numUNormMismatches += unormPixels[i].v != bc4Palettes[b][i % 8];
+            numSNormMismatches += std::fabs(snormPixels[i].v - bc4SignedPalettes[b][i % 8]) > 1e-6f;
+        }
+        VLR_CHECK(numUNormMismatches == 0, "BC4 block %u: %u pixels differ", b, numUNormMismatches);
+        VLR_CHECK(numSNormMismatches == 0, "BC4 signed block %u: %u pixels differ", b, numSNormMismatches);
+    }
+
+    uint8_t bc5Block[16];
+    std::memcpy(bc5Block, bc4Blocks[0], 8);
+    std::memcpy(bc5Block + 8, bc4Blocks[1], 8);
+    uint8_t bc5SignedBlock[16];
+    std::memcpy(bc5SignedBlock, bc4SignedBlocks[0], 8);
+    std::memcpy(bc5SignedBlock + 8, bc4SignedBlocks[1], 8);
+    RG32Fx2 unormPixels[16];
+    decodeBC5Block(bc5Block, unormPixels);
+    RG32Fx2 snormPixels[16];
+    decodeBC5SignedBlock(bc5SignedBlock, snormPixels);
+    uint32_t numUNormMismatches = 0;
+    uint32_t numSNormMismatches = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        numUNormMismatches += unormPixels[i].r != bc4Palettes[0][i % 8] / 255.0f ||
+            unormPixels[i].g != bc4Palettes[1][i % 8] / 255.0f;
+        numSNormMismatches += std::fabs(snormPixels[i].r - bc4SignedPalettes[0][i % 8]) > 1e-6f ||
+            std::fabs(snormPixels[i].g - bc4SignedPalettes[1][i % 8]) > 1e-6f;
+    }
+    VLR_CHECK(numUNormMismatches == 0, "BC5: %u pixels differ", numUNormMismatches);
+    VLR_CHECK(numSNormMismatches == 0, "BC5 signed: %u pixels differ", numSNormMismatches);
+}
+
+// JP: BC6Hのブロックは各フィールドの値から仕様のビット配置で組み立て、期待値は仕様の逆量子化と補間の式で
+//     求めた半精度浮動小数点数のビット列。符号無しのものはPillowの8bitの結果とも一致する。
+//     - モード10(0x03): 変換無し、10bit、1領域。ピクセルiのインデックスはi。
+//       符号無しはR 0 -> 1023, G 1023 -> 0, B 512、符号付きはR -511 -> 511, G 0 -> -256, B 100 -> -100。
+//     - モード0: デルタ変換、10bit + 5bitデルタ、2領域(パーティション13)。
+//       基準(300, 700, 64)にデルタ(10, -12, 15), (-16, 5, 0), (7, 7, -3)。
+//     - モード11(0x07)符号付き: デルタ変換、11bit + 9bitデルタ。(-600, 900, -20)にデルタ(100, -200, -255)。
+// EN: BC6H blocks are assembled from the values of each field with the bit layout of the spec,
+//     and the expected values are half-precision bit patterns computed with the unquantization and interpolation
+//     formulas of the spec. The unsigned ones also match the 8-bit result of Pillow.
+//     - Mode 10 (0x03): untransformed, 10 bits, one region. The index of pixel i is i.
+//       Unsigned is R 0 -> 1023, G 1023 -> 0, B 512, signed is R -511 -> 511, G 0 -> -256, B 100 -> -100.
+//     - Mode 0: delta transformed, 10 bits + 5-bit deltas, two regions (partition 13).
+//       Deltas (10, -12, 15), (-16, 5, 0), (7, 7, -3) on the base (300, 700, 64).
+//     - Mode 11 (0x07) signed: delta transformed, 11 bits + 9-bit deltas. Delta (100, -200, -255) on (-600, 900, -20).
+struct KnownBC6HBlock {
+    const char* name;
+    bool isSigned;
+    uint8_t block[16];
+    uint16_t expected[48];
+};
+
+static const KnownBC6HBlock knownBC6HBlocks[] = {
+    {
+        "mode 10 unsigned", false,
+        { 0x03, 0x80, 0xFF, 0x01, 0xFC, 0x1F, 0x00, 0x00, 0x11, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE },
+        {
+            0x0000, 0x7BFF, 0x3E0F, 0x07C0, 0x743F, 0x3E0F, 0x1170, 0x6A8F, 0x3E0F, 0x1930, 0x62CF, 0x3E0F,
+            0x20F0, 0x5B0F, 0x3E0F, 0x28B0, 0x534F, 0x3E0F, 0x3260, 0x499F, 0x3E0F, 0x3A20, 0x41DF, 0x3E0F,
+            0x41DF, 0x3A20, 0x3E0F, 0x499F, 0x3260, 0x3E0F, 0x534F, 0x28B0, 0x3E0F, 0x5B0F, 0x20F0, 0x3E0F,
+            0x62CF, 0x1930, 0x3E0F, 0x6A8F, 0x1170, 0x3E0F, 0x743F, 0x07C0, 0x3E0F, 0x7BFF, 0x0000, 0x3E0F,
+        }
+    },
+    {
+        "mode 10 signed", true,
+        { 0x23, 0x40, 0x00, 0xC8, 0xF8, 0x0F, 0x60, 0xCE, 0x11, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE },
+        {
+            0xFBFF, 0x0000, 0x1857, 0xEC7F, 0x83E1, 0x154C, 0xD91F, 0x88BB, 0x117E, 0xC99F, 0x8C9D, 0x0E73,
+            0xBA20, 0x907F, 0x0B68, 0xAAA0, 0x9461, 0x085D, 0x9740, 0x993C, 0x0490, 0x87C0, 0x9D1E, 0x0185,
+            0x07C0, 0xA100, 0x8185, 0x1740, 0xA4E2, 0x8490, 0x2AA0, 0xA9BC, 0x885D, 0x3A20, 0xAD9E, 0x8B68,
+            0x499F, 0xB180, 0x8E73, 0x591F, 0xB562, 0x917E, 0x6C7F, 0xBA3D, 0x954C, 0x7BFF, 0xBE1F, 0x9857,
+        }
+    },
+    {
+        "mode 0 unsigned", false,
+        { 0x90, 0x25, 0x5E, 0x81, 0x50, 0x8A, 0xBE, 0x07, 0xE0, 0xB3, 0x1D, 0x8D, 0xF5, 0x11, 0x8D, 0xB5 },
+        {
+            0x24E6, 0x5436, 0x0893, 0x248F, 0x549F, 0x0810, 0x24BA, 0x546A, 0x0852, 0x24E6, 0x5436, 0x0893,
+            0x2516, 0x53FC, 0x08DC, 0x2542, 0x53C8, 0x091D, 0x256D, 0x5393, 0x095F, 0x2599, 0x535F, 0x09A0,
+            0x2273, 0x556E, 0x07CF, 0x22D7, 0x5577, 0x07C2, 0x233C, 0x557F, 0x07B5, 0x23A0, 0x5588, 0x07A8,
+            0x240F, 0x5592, 0x0799, 0x2473, 0x559B, 0x078C, 0x24D8, 0x55A3, 0x077F, 0x233C, 0x557F, 0x07B5,
+        }
+    },
+    {
+        "mode 11 signed", true,
+        { 0x07, 0x35, 0xC2, 0xD9, 0x27, 0x13, 0xA7, 0x80, 0x11, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE },
+        {
+            0xC8B7, 0x6D0B, 0x827B, 0xC7F5, 0x6B88, 0x8469, 0xC703, 0x69A3, 0x86D2, 0xC641, 0x6820, 0x88C0,
+            0xC580, 0x669C, 0x8AAE, 0xC4BE, 0x6519, 0x8C9C, 0xC3CC, 0x6334, 0x8F06, 0xC30A, 0x61B1, 0x90F4,
+            0xC248, 0x602D, 0x92E3, 0xC186, 0x5EAA, 0x94D1, 0xC094, 0x5CC5, 0x973A, 0xBFD2, 0x5B42, 0x9928,
+            0xBF11, 0x59BE, 0x9B16, 0xBE4F, 0x583B, 0x9D04, 0xBD5D, 0x5657, 0x9F6E, 0xBC9B, 0x54D3, 0xA15C,
+        }
+    },
+    // JP: 予約済みのモード(0x13)は不透明な黒になる。
+    // EN: A reserved mode (0x13) decodes to opaque black.
+    {
+        "reserved mode", false,
+        { 0x13, 0x35, 0xC2, 0xD9, 0x27, 0x13, 0xA7, 0x80, 0x11, 0x32, 0x54, 0x76, 0x98, 0xBA, 0xDC, 0xFE },
+        {}
+    },
+};
+
+VLR_TEST(BCCodec_DecodeKnownBC6HBlocks) {
+    for (const KnownBC6HBlock &kb : knownBC6HBlocks) {
+        RGBA16Fx4 pixels[16];
+        decodeBC6HBlock(kb.block, kb.isSigned, pixels);
+        uint32_t numMismatches = 0;
+        for (uint32_t i = 0; i < 16; ++i) {
+            uint16_t bits[4];
+            std::memcpy(bits, &pixels[i], sizeof(bits));
+            numMismatches += bits[0] != kb.expected[3 * i + 0] || bits[1] != kb.expected[3 * i + 1] ||
+                bits[2] != kb.expected[3 * i + 2] || bits[3] != 0x3C00;
+        }
+        VLR_CHECK(numMismatches == 0, "BC6H %s: %u pixels differ", kb.name, numMismatches);
+    }
+}
+
+
+
+// JP: 滑らかなグラデーション、エッジ、ノイズを含む合成画像。サイズは4の倍数でなく、端のブロックも通る。
+// EN: Synthetic images with smooth gradients, edges and noise. The size isn't a multiple of 4 so edge blocks are covered.
+static constexpr uint32_t psnrTestWidth = 98;
+static constexpr uint32_t psnrTestHeight = 70;
+
+static std::vector<RGBA8x4> createLDRTestImage() {
+    std::mt19937 rng(6);
+    std::uniform_int_distribution<int32_t> noise(-6, 6);
+    std::vector<RGBA8x4> image(psnrTestWidth * psnrTestHeight);
+    for (uint32_t y = 0; y < psnrTestHeight; ++y) {
+        for (uint32_t x = 0; x < psnrTestWidth; ++x) {
+            float fx = x / static_cast<float>(psnrTestWidth - 1);
+            float fy = y / static_cast<float>(psnrTestHeight - 1);
+            bool edge = ((x / 12) + (y / 9)) % 3 == 0;
+            int32_t rgba[4] = {
+                static_cast<int32_t>(255 * fx),
+                static_cast<int32_t>(255 * (0.5f + 0.5f * std::sin(6.0f * fy + 3.0f * fx))),
+                edge ? 220 : 40,
+                static_cast<int32_t>(255 * (1 - fx * fy)),
+            };
+            RGBA8x4 &pix = image[psnrTestWidth * y + x];
+            pix.r = static_cast<uint8_t>(clamp(rgba[0] + noise(rng), 0, 255));
+            pix.g = static_cast<uint8_t>(clamp(rgba[1] + noise(rng), 0, 255));
+            pix.b = static_cast<uint8_t>(clamp(rgba[2] + noise(rng), 0, 255));
+            pix.a = static_cast<uint8_t>(clamp(rgba[3], 0, 255));
+        }
+    }
+    return image;
+}
+
+// JP: 1e-3から1e+3程度まで変化するHDR画像。
+// EN: HDR image ranging from about 1e-3 to 1e+3.
+static std::vector<RGBA16Fx4> createHDRTestImage() {
+    std::mt19937 rng(6);
+    std::uniform_real_distribution<float> noise(0.95f, 1.05f);
+    std::vector<RGBA16Fx4> image(psnrTestWidth * psnrTestHeight);
+    for (uint32_t y = 0; y < psnrTestHeight; ++y) {
+        for (uint32_t x = 0; x < psnrTestWidth; ++x) {
+            float fx = x / static_cast<float>(psnrTestWidth - 1);
+            float fy = y / static_cast<float>(psnrTestHeight - 1);
+            float luminance = std::pow(10.0f, 6.0f * fx - 3.0f);
+            bool edge = ((x / 12) + (y / 9)) % 3 == 0;
+            float rgb[3] = {
+                luminance * (0.5f + 0.5f * fy),
+                luminance * (0.5f + 0.5f * std::sin(6.0f * fy)),
+                luminance * (edge ? 1.0f : 0.1f),
+            };
+            RGBA16Fx4 &pix = image[psnrTestWidth * y + x];
+            pix.r = static_cast<half>(rgb[0] * noise(rng));
+            pix.g = static_cast<half>(rgb[1] * noise(rng));
+            pix.b = static_cast<half>(rgb[2] * noise(rng));
+            pix.a = static_cast<half>(1.0f);
+        }
+    }
+    return image;
+}
+
+template <typename PixelType>
+static double encodeAndComputePSNR(const std::vector<PixelType> &image, DataFormat bcFormat,
+                                   BlockCompressionQuality quality) {
+    std::vector<uint8_t> bcData(getBlockCompressedDataSize(bcFormat, psnrTestWidth, psnrTestHeight));
+    encodeBlockCompressedImageData(reinterpret_cast<const uint8_t*>(image.data()), psnrTestWidth, psnrTestHeight,
+                                   bcFormat, quality, bcData.data());
+    return computeBlockCompressionPSNR(reinterpret_cast<const uint8_t*>(image.data()), bcData.data(),
+                                       psnrTestWidth, psnrTestHeight, bcFormat);
+}
+
+// JP: エンコードしてデコードした結果のPSNRが品質ごとの下限を下回らず、品質を上げても悪化しないことを確認する。
+// EN: Check that the PSNR after encoding and decoding doesn't fall below the floor for each quality,
+//     and doesn't get worse with a higher quality.
+VLR_TEST(BCCodec_EncodePSNRFloors) {
+    const BlockCompressionQuality qualities[] = {
+        BlockCompressionQuality::Fast, BlockCompressionQuality::Normal, BlockCompressionQuality::High };
+    const char* qualityNames[] = { "Fast", "Normal", "High" };
+    // JP: 下限は現在の結果(BC7 37.8/39.3/40.4, BC6H 45.6/51.6/52.1)から約1.5dB下げた値。
+    // EN: The floors are about 1.5 dB below the current results (BC7 37.8/39.3/40.4, BC6H 45.6/51.6/52.1).
+    const double bc7Floors[] = { 36.0, 38.0, 39.0 };
+    const double bc6hFloors[] = { 44.0, 50.0, 50.5 };
+
+    std::vector<RGBA8x4> ldrImage = createLDRTestImage();
+    std::vector<RGBA16Fx4> hdrImage = createHDRTestImage();
+    double prevBC7PSNR = 0.0;
+    double prevBC6HPSNR = 0.0;
+    for (uint32_t q = 0; q < std::size(qualities); ++q) {
+        double bc7PSNR = encodeAndComputePSNR(ldrImage, DataFormat::BC7, qualities[q]);
+        double bc6hPSNR = encodeAndComputePSNR(hdrImage, DataFormat::BC6H, qualities[q]);
+        printf("  %-6s: BC7 %.2f [dB], BC6H %.2f [dB]\n", qualityNames[q], bc7PSNR, bc6hPSNR);
+        VLR_CHECK(bc7PSNR >= bc7Floors[q], "BC7 %s: %.2f [dB] < %.2f [dB]", qualityNames[q], bc7PSNR, bc7Floors[q]);
+        VLR_CHECK(bc6hPSNR >= bc6hFloors[q], "BC6H %s: %.2f [dB] < %.2f [dB]", qualityNames[q], bc6hPSNR, bc6hFloors[q]);
+        VLR_CHECK(bc7PSNR >= prevBC7PSNR - 0.05, "BC7 %s is worse than the lower quality", qualityNames[q]);
+        VLR_CHECK(bc6hPSNR >= prevBC6HPSNR - 0.05, "BC6H %s is worse than the lower quality", qualityNames[q]);
+        prevBC7PSNR = bc7PSNR;
+        prevBC6HPSNR = bc6hPSNR;
+    }
+}
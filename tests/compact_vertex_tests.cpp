@@ -0,0 +1,113 @@
+#include "test_common.h"
+#include "shared/shared.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+static Vector3D createRandomDirection(std::mt19937 &rng) {
+    std::uniform_real_distribution<float> u01;
+    float z = 2 * u01(rng) - 1;
+    float phi = 2 * static_cast<float>(VLR_M_PI) * u01(rng);
+    float r = std::sqrt(std::max(1 - z * z, 0.0f));
+    return Vector3D(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+// JP: 小さな角度も精度良く求められるよう、弦の長さから2つの単位ベクトルの間の角度[度]を求める。
+// EN: Angle in degrees between two unit vectors from the chord length, accurate for small angles as well.
+static float computeAngleInDegrees(const Vector3D &a, const Vector3D &b) {
+    return 2 * std::asin(std::min((a - b).length() / 2, 1.0f)) * 180 / static_cast<float>(VLR_M_PI);
+}
+
+static bool isFiniteUnitVector(const Vector3D &v) {
+    return std::isfinite(v.x) && std::isfinite(v.y) && std::isfinite(v.z) && std::fabs(v.length() - 1.0f) < 1e-4f;
+}
+
+
+
+// JP: 位置、法線、接線、テクスチャー座標がそれぞれの量子化の精度で復元されることを確認する。
+//     八面体の各面と境界(軸方向、負のZ側の折り返し)も含める。
+// EN: Check that the position, normal, tangent and texture coordinates are restored within the precision of each quantization.
+//     Includes each face of the octahedron and its boundaries (axis directions, the folded negative Z side).
+VLR_TEST(CompactVertex_RoundTrip) {
+    const Point3D positionOffset(1.5f, -20.0f, 300.0f);
+    const Vector3D positionScale(10.0f, 0.25f, 1000.0f);
+
+    std::vector<Vector3D> directions = {
+        Vector3D(1, 0, 0), Vector3D(-1, 0, 0), Vector3D(0, 1, 0), Vector3D(0, -1, 0),
+        Vector3D(0, 0, 1), Vector3D(0, 0, -1), normalize(Vector3D(1, 1, -1)), normalize(Vector3D(-1, 1e-6f, -1)),
+    };
+    std::mt19937 rng(31);
+    std::uniform_real_distribution<float> u01;
+    for (uint32_t i = 0; i < 100000; ++i)
+        directions.push_back(createRandomDirection(rng));
+
+    float maxPositionError[3] = { 0, 0, 0 };
+    float maxNormalAngle = 0.0f;
+    float maxTangentAngle = 0.0f;
+    float maxTexCoordError = 0.0f;
+    for (uint32_t i = 0; i < directions.size(); ++i) {
+        Vertex v;
+        v.position = positionOffset + Vector3D(positionScale.x * (2 * u01(rng) - 1),
+                                               positionScale.y * (2 * u01(rng) - 1),
+                                               positionScale.z * (2 * u01(rng) - 1));
+        v.normal = Normal3D(directions[i]);
+        v.tc0Direction = directions[(i + 1) % directions.size()];
+        v.texCoord = TexCoord2D(u01(rng), 4 * u01(rng) - 2);
+
+        shared::CompactVertex cv = shared::encodeCompactVertex(v, positionOffset, positionScale);
+        Vertex dv = shared::decodeCompactVertex(cv, positionOffset, positionScale);
+
+        Vector3D d = dv.position - v.position;
+        maxPositionError[0] = std::max(maxPositionError[0], std::fabs(d.x) / positionScale.x);
+        maxPositionError[1] = std::max(maxPositionError[1], std::fabs(d.y) / positionScale.y);
+        maxPositionError[2] = std::max(maxPositionError[2], std::fabs(d.z) / positionScale.z);
+        maxNormalAngle = std::max(maxNormalAngle, computeAngleInDegrees(static_cast<Vector3D>(dv.normal), static_cast<Vector3D>(v.normal)));
+        maxTangentAngle = std::max(maxTangentAngle, computeAngleInDegrees(dv.tc0Direction, v.tc0Direction));
+        maxTexCoordError = std::max(maxTexCoordError, std::fabs(dv.texCoord.u - v.texCoord.u));
+        maxTexCoordError = std::max(maxTexCoordError, std::fabs(dv.texCoord.v - v.texCoord.v));
+    }
+
+    // JP: 位置はSNORM16の半ステップ、方向は16bitの八面体写像で0.01度程度、テクスチャー座標はhalfの精度(|x| < 2で2^-10)。
+    // EN: Half a step of SNORM16 for the position, about 0.01 degrees for the 16-bit octahedral mapping of directions,
+    //     and the half precision (2^-10 for |x| < 2) for the texture coordinates.
+    const float positionTolerance = 0.5f / 32767 + 1e-6f;
+    const float directionTolerance = 0.01f;
+    for (uint32_t axis = 0; axis < 3; ++axis)
+        VLR_CHECK(maxPositionError[axis] <= positionTolerance, "axis %u: position error %g of the scale", axis, maxPositionError[axis]);
+    VLR_CHECK(maxNormalAngle <= directionTolerance, "normal: max error %g [deg]", maxNormalAngle);
+    VLR_CHECK(maxTangentAngle <= directionTolerance, "tangent: max error %g [deg]", maxTangentAngle);
+    VLR_CHECK(maxTexCoordError <= 1.0f / 1024, "texture coordinates: error %g", maxTexCoordError);
+}
+
+// JP: 長さゼロの法線や接線(メッシュに法線や接線が無い場合)でもNaNにならず、有効な方向に符号化されることを確認する。
+// EN: Check that zero-length normals and tangents (when a mesh lacks them) don't produce NaN and are encoded as valid directions.
+VLR_TEST(CompactVertex_ZeroLengthDirections) {
+    const Point3D positionOffset(0.0f, 0.0f, 0.0f);
+    const Vector3D positionScale(1.0f, 1.0f, 1.0f);
+    const Vector3D tangents[] = { Vector3D(0, 0, 0), Vector3D(1, 0, 0) };
+    const Normal3D normals[] = { Normal3D(0, 0, 0), Normal3D(0, 1, 0) };
+    for (const Normal3D &normal : normals) {
+        for (const Vector3D &tangent : tangents) {
+            Vertex v;
+            v.position = Point3D(0.5f, -0.5f, 0.25f);
+            v.normal = normal;
+            v.tc0Direction = tangent;
+            v.texCoord = TexCoord2D(0.0f, 1.0f);
+
+            shared::CompactVertex cv = shared::encodeCompactVertex(v, positionOffset, positionScale);
+            Vertex dv = shared::decodeCompactVertex(cv, positionOffset, positionScale);
+            Vector3D n = static_cast<Vector3D>(dv.normal);
+            VLR_CHECK(isFiniteUnitVector(n), "normal (%g, %g, %g), tangent (%g, %g, %g): decoded normal (%g, %g, %g)",
+                      normal.x, normal.y, normal.z, tangent.x, tangent.y, tangent.z, n.x, n.y, n.z);
+            VLR_CHECK(isFiniteUnitVector(dv.tc0Direction),
+                      "normal (%g, %g, %g), tangent (%g, %g, %g): decoded tangent (%g, %g, %g)",
+                      normal.x, normal.y, normal.z, tangent.x, tangent.y, tangent.z,
+                      dv.tc0Direction.x, dv.tc0Direction.y, dv.tc0Direction.z);
+            // JP: 代用された接線は法線に直交する。
+            // EN: A substituted tangent is orthogonal to the normal.
+            if (tangent.sqLength() == 0.0f)
+                VLR_CHECK(std::fabs(dot(n, dv.tc0Direction)) < 1e-3f, "normal (%g, %g, %g): substituted tangent isn't orthogonal",
+                          normal.x, normal.y, normal.z);
+        }
+    }
+}
@@ -0,0 +1,528 @@
+#include "test_common.h"
+#include "distribution_builder.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: テスト用の重みの種類。ゼロや極端な偏りを含む。
+// EN: Kinds of weights for tests, including zeros and extreme skews.
+enum class WeightPattern {
+    Uniform = 0,
+    Random,
+    SparseZeros,
+    PowerLaw,
+    SingleDominant,
+};
+
+static const char* getWeightPatternName(WeightPattern pattern) {
+    switch (pattern) {
+    case WeightPattern::Uniform: return "Uniform";
+    case WeightPattern::Random: return "Random";
+    case WeightPattern::SparseZeros: return "SparseZeros";
+    case WeightPattern::PowerLaw: return "PowerLaw";
+    case WeightPattern::SingleDominant: return "SingleDominant";
+    default: return "Unknown";
+    }
+}
+
+static const WeightPattern weightPatterns[] = {
+    WeightPattern::Uniform, WeightPattern::Random, WeightPattern::SparseZeros,
+    WeightPattern::PowerLaw, WeightPattern::SingleDominant,
+};
+
+static std::vector<float> createWeights(WeightPattern pattern, uint32_t numValues, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01;
+    std::vector<float> weights(numValues);
+    for (uint32_t i = 0; i < numValues; ++i) {
+        switch (pattern) {
+        case WeightPattern::Uniform:
+            weights[i] = 1.0f;
+            break;
+        case WeightPattern::Random:
+            weights[i] = u01(rng);
+            break;
+        case WeightPattern::SparseZeros:
+            weights[i] = u01(rng) < 0.7f ? 0.0f : u01(rng);
+            break;
+        case WeightPattern::PowerLaw:
+            weights[i] = std::pow(u01(rng), 8.0f);
+            break;
+        case WeightPattern::SingleDominant:
+            weights[i] = i == numValues / 3 ? 1e6f : 1e-3f;
+            break;
+        }
+    }
+    if (pattern == WeightPattern::SparseZeros)
+        weights[numValues - 1] = 1.0f;
+    return weights;
+}
+
+static std::vector<float> normalizeWeights(const std::vector<float> &weights) {
+    double sum = 0.0;
+    for (float w : weights)
+        sum += w;
+    std::vector<float> PMF(weights.size());
+    for (uint32_t i = 0; i < weights.size(); ++i)
+        PMF[i] = static_cast<float>(weights[i] / sum);
+    return PMF;
+}
+
+// JP: テスト側で独立に作る参照用のCDF(numValues + 1要素)。
+// EN: Reference CDF (numValues + 1 entries) built independently on the test side.
+static std::vector<float> createReferenceCDF(const std::vector<float> &weights) {
+    double sum = 0.0;
+    for (float w : weights)
+        sum += w;
+    std::vector<float> CDF(weights.size() + 1);
+    double prefix = 0.0;
+    for (uint32_t i = 0; i < weights.size(); ++i) {
+        CDF[i] = static_cast<float>(prefix / sum);
+        prefix += weights[i];
+    }
+    CDF[weights.size()] = 1.0f;
+    return CDF;
+}
+
+
+
+// JP: エイリアステーブルが表す各要素の確率(自身のバケットの確率と、他のバケットからエイリアスされる確率の和)が
+//     元のPMFと一致することを確認する。
+// EN: Check that the probability of each item represented by the alias table
+//     (its own bucket's probability plus the probabilities aliased from other buckets) matches the original PMF.
+VLR_TEST(AliasTable_ReconstructsPMF) {
+    const uint32_t sizes[] = { 1, 2, 7, 1000, 100000 };
+    for (WeightPattern pattern : weightPatterns) {
+        for (uint32_t numValues : sizes) {
+            std::vector<float> PMF = normalizeWeights(createWeights(pattern, numValues, numValues));
+            std::vector<shared::AliasTableEntry<float>> aliasTable(numValues);
+            buildAliasTable(PMF.data(), numValues, aliasTable.data());
+
+            std::vector<double> reconstructed(numValues, 0.0);
+            bool validEntries = true;
+            for (uint32_t i = 0; i < numValues; ++i) {
+                const shared::AliasTableEntry<float> &entry = aliasTable[i];
+                validEntries &= entry.alias < numValues && entry.probability >= 0.0f && entry.probability <= 1.0f;
+                if (!validEntries)
+                    break;
+                reconstructed[i] += static_cast<double>(entry.probability) / numValues;
+                reconstructed[entry.alias] += (1.0 - entry.probability) / numValues;
+            }
+            VLR_CHECK(validEntries, "%s n=%u: invalid table entry", getWeightPatternName(pattern), numValues);
+            if (!validEntries)
+                continue;
+
+            double maxError = 0.0;
+            uint32_t numZeroItemsSelected = 0;
+            for (uint32_t i = 0; i < numValues; ++i) {
+                maxError = std::max(maxError, std::fabs(reconstructed[i] - PMF[i]));
+                if (PMF[i] == 0.0f && reconstructed[i] > 1e-6 / numValues)
+                    ++numZeroItemsSelected;
+            }
+            VLR_CHECK(maxError < 1e-6, "%s n=%u: max PMF error %g",
+                      getWeightPatternName(pattern), numValues, maxError);
+            VLR_CHECK(numZeroItemsSelected == 0, "%s n=%u: %u zero-weight items are selectable",
+                      getWeightPatternName(pattern), numValues, numZeroItemsSelected);
+        }
+    }
+}
+
+// JP: 共有側のサンプラーを通して、選ばれる頻度がPMFに従い、remappedが[0, 1)で一様になることを確認する。
+// EN: Through the shared sampler, check that the selection frequencies follow the PMF
+//     and that remapped is uniform in [0, 1).
+VLR_TEST(AliasTable_SamplingMatchesPMF) {
+    const uint32_t numValues = 64;
+    const uint32_t numSamples = 1 << 22;
+    for (WeightPattern pattern : weightPatterns) {
+        std::vector<float> weights = createWeights(pattern, numValues, 123);
+        std::vector<float> PMF = normalizeWeights(weights);
+        std::vector<shared::AliasTableEntry<float>> aliasTable(numValues);
+        buildAliasTable(PMF.data(), numValues, aliasTable.data());
+        shared::DiscreteDistribution1D dist(PMF.data(), nullptr, aliasTable.data(), 1.0f, numValues,
+                                            shared::DistributionLayout::AliasTable);
+
+        std::vector<uint32_t> counts(numValues, 0);
+        double remappedSum = 0.0;
+        bool remappedInRange = true;
+        bool probMatches = true;
+        for (uint32_t s = 0; s < numSamples; ++s) {
+            float u = (s + 0.5f) / numSamples;
+            float prob, remapped;
+            uint32_t idx = dist.sample(u, &prob, &remapped);
+            ++counts[idx];
+            remappedSum += remapped;
+            remappedInRange &= remapped >= 0.0f && remapped <= 1.0f;
+            probMatches &= prob == PMF[idx];
+        }
+        VLR_CHECK(remappedInRange, "%s: remapped out of [0, 1]", getWeightPatternName(pattern));
+        VLR_CHECK(probMatches, "%s: returned probability differs from the PMF", getWeightPatternName(pattern));
+        double remappedMean = remappedSum / numSamples;
+        VLR_CHECK(std::fabs(remappedMean - 0.5) < 1e-3, "%s: mean of remapped %g",
+                  getWeightPatternName(pattern), remappedMean);
+
+        double maxError = 0.0;
+        for (uint32_t i = 0; i < numValues; ++i)
+            maxError = std::max(maxError, std::fabs(static_cast<double>(counts[i]) / numSamples - PMF[i]));
+        VLR_CHECK(maxError < 1e-5, "%s: max frequency error %g", getWeightPatternName(pattern), maxError);
+    }
+}
+
+// JP: エイリアステーブルとCDFの二分探索のサンプリング速度を比較する。
+//     サンプルの相関として、同じuに対してCDFと同じ要素が選ばれる割合を測る。
+//     CDFはuに対して単調なので低食い違い列の層化をそのまま保つが、
+//     エイリアステーブルはバケット内の分岐で別の要素に飛ぶ分だけ層化が崩れる。
+// EN: Compare sampling throughput of the alias table and the binary search over the CDF.
+//     As the sample correlation, measure the fraction of u for which the same item as the CDF is selected.
+//     The CDF is monotonic in u and keeps the stratification of low-discrepancy sequences as is,
+//     while the alias table breaks it to the extent that the branch within a bucket jumps to another item.
+VLR_BENCHMARK(AliasTable_vs_CDF) {
+    const uint32_t sizes[] = { 1 << 10, 1 << 16, 1 << 20, 1 << 24 };
+    const uint32_t numSamples = isQuickRun() ? (1 << 16) : (1 << 24);
+    for (uint32_t numValues : sizes) {
+        if (isQuickRun() && numValues > (1 << 16))
+            break;
+        std::vector<float> weights = createWeights(WeightPattern::Random, numValues, 7);
+        std::vector<float> PMF = normalizeWeights(weights);
+        std::vector<float> CDF = createReferenceCDF(weights);
+        std::vector<shared::AliasTableEntry<float>> aliasTable(numValues);
+        double buildTime = measureBestTime(3, [&]() {
+            buildAliasTable(PMF.data(), numValues, aliasTable.data());
+        });
+        shared::DiscreteDistribution1D aliasDist(PMF.data(), nullptr, aliasTable.data(), 1.0f, numValues,
+                                                 shared::DistributionLayout::AliasTable);
+        shared::DiscreteDistribution1D cdfDist(PMF.data(), CDF.data(), nullptr, 1.0f, numValues,
+                                               shared::DistributionLayout::LinearCDF);
+
+        // JP: 分岐予測やキャッシュが有利にならないようランダムな順序のuを使う。
+        // EN: Use u in random order so that branch prediction and caches don't get an unfair advantage.
+        std::mt19937 rng(numValues);
+        std::uniform_real_distribution<float> u01;
+        std::vector<float> us(numSamples);
+        for (float &u : us)
+            u = std::min(u01(rng), 0.99999994f);
+
+        std::vector<uint32_t> aliasIndices(numSamples);
+        std::vector<uint32_t> cdfIndices(numSamples);
+        const auto sampleAll = [&](const shared::DiscreteDistribution1D &dist, std::vector<uint32_t> &indices) {
+            float probSum = 0.0f;
+            for (uint32_t s = 0; s < numSamples; ++s) {
+                float prob;
+                indices[s] = dist.sample(us[s], &prob);
+                probSum += prob;
+            }
+            return probSum;
+        };
+        double aliasTime = measureBestTime(3, [&]() { sampleAll(aliasDist, aliasIndices); });
+        double cdfTime = measureBestTime(3, [&]() { sampleAll(cdfDist, cdfIndices); });
+
+        uint32_t numAgreements = 0;
+        for (uint32_t s = 0; s < numSamples; ++s)
+            numAgreements += aliasIndices[s] == cdfIndices[s];
+
+        printf("  n = %9u: build %8.3f [ms], alias %7.2f [MSamples/s], CDF %7.2f [MSamples/s], "
+               "same item as CDF %5.1f%%\n",
+               numValues, buildTime * 1e3,
+               numSamples / aliasTime * 1e-6, numSamples / cdfTime * 1e-6,
+               100.0 * numAgreements / numSamples);
+    }
+}
+
+// JP: B+木の探索が線形配置のCDFの二分探索と同じ要素を返すことを確認する。
+//     階層数が変わる境界の要素数、CDFの値ちょうどのu、0と1直前のu、ゼロの重みが続く区間を含める。
+// EN: Check that the B+ tree search returns the same item as the binary search over the linear CDF.
+//     Includes the numbers of items at boundaries where the number of levels changes,
+//     u exactly at CDF values, u at 0 and just below 1, and runs of zero weights.
+VLR_TEST(BTreeCDF_MatchesLinearSearch) {
+    const uint32_t sizes[] = { 1, 2, 15, 16, 17, 271, 272, 273, 4623, 4624, 78607, 78608, 100000 };
+    const uint32_t numRandomUs = 1 << 14;
+    for (WeightPattern pattern : weightPatterns) {
+        for (uint32_t numValues : sizes) {
+            std::vector<float> CDF = createReferenceCDF(createWeights(pattern, numValues, numValues));
+            std::vector<float> btree(getCDFSize(numValues, shared::DistributionLayout::BTreeCDF));
+            std::copy(CDF.cbegin(), CDF.cend(), btree.begin());
+            buildCDFBTree(btree.data(), numValues);
+
+            std::vector<float> us;
+            us.push_back(0.0f);
+            us.push_back(0.99999994f);
+            // JP: 末尾付近のCDFの値は1に丸まり得るが、uは[0, 1)なので含めない。
+            // EN: CDF values near the end may round to 1, but they are excluded since u is in [0, 1).
+            for (uint32_t i = 0; i < numValues; ++i) {
+                if (CDF[i] < 1.0f)
+                    us.push_back(CDF[i]);
+                us.push_back(std::nextafter(CDF[i], 0.0f));
+            }
+            std::mt19937 rng(numValues);
+            std::uniform_real_distribution<float> u01;
+            for (uint32_t i = 0; i < numRandomUs; ++i)
+                us.push_back(std::min(u01(rng), 0.99999994f));
+
+            uint32_t numMismatches = 0;
+            float firstMismatchU = 0.0f;
+            for (float u : us) {
+                uint32_t linearIdx = shared::searchCDF(CDF.data(), numValues, shared::DistributionLayout::LinearCDF, u);
+                uint32_t btreeIdx = shared::searchCDF(btree.data(), numValues, shared::DistributionLayout::BTreeCDF, u);
+                if (linearIdx != btreeIdx && numMismatches++ == 0)
+                    firstMismatchU = u;
+            }
+            VLR_CHECK(numMismatches == 0, "%s n=%u: %u mismatches (first at u=%.9g)",
+                      getWeightPatternName(pattern), numValues, numMismatches, firstMismatchU);
+        }
+    }
+}
+
+// JP: 線形配置とB+木配置のCDFについて、構築時間と探索速度を比較する。
+//     構築時間は共通のCDFの後にB+木の内部ノードを構築する追加分。
+// EN: Compare build time and search throughput of the linear and B+ tree CDF layouts.
+//     The build time is the extra cost of building the B+ tree internal nodes after the common CDF.
+VLR_BENCHMARK(BTreeCDF_vs_LinearCDF) {
+    const uint32_t sizes[] = { 1000, 1 << 16, 1 << 20, 1 << 24, 100000000 };
+    const uint32_t numSamples = isQuickRun() ? (1 << 16) : (1 << 23);
+    for (uint32_t numValues : sizes) {
+        if (isQuickRun() && numValues > (1 << 16))
+            break;
+        std::vector<float> btree(getCDFSize(numValues, shared::DistributionLayout::BTreeCDF));
+        {
+            std::vector<float> CDF = createReferenceCDF(createWeights(WeightPattern::Random, numValues, 7));
+            std::copy(CDF.cbegin(), CDF.cend(), btree.begin());
+        }
+        double buildTime = measureBestTime(3, [&]() {
+            buildCDFBTree(btree.data(), numValues);
+        });
+        // JP: B+木の葉はCDFそのものなので、先頭部分を線形配置のCDFとしてそのまま使える。
+        // EN: The leaves of the B+ tree are the CDF itself, so the leading part serves as the linear CDF as is.
+        const float* CDF = btree.data();
+
+        std::mt19937 rng(numValues);
+        std::uniform_real_distribution<float> u01;
+        std::vector<float> us(numSamples);
+        for (float &u : us)
+            u = std::min(u01(rng), 0.99999994f);
+
+        std::vector<uint32_t> linearIndices(numSamples);
+        std::vector<uint32_t> btreeIndices(numSamples);
+        double linearTime = measureBestTime(3, [&]() {
+            for (uint32_t s = 0; s < numSamples; ++s)
+                linearIndices[s] = shared::searchCDF(CDF, numValues, shared::DistributionLayout::LinearCDF, us[s]);
+        });
+        double btreeTime = measureBestTime(3, [&]() {
+            for (uint32_t s = 0; s < numSamples; ++s)
+                btreeIndices[s] = shared::searchCDF(btree.data(), numValues, shared::DistributionLayout::BTreeCDF, us[s]);
+        });
+        VLR_CHECK(linearIndices == btreeIndices, "n=%u: B+ tree search differs from the linear search", numValues);
+
+        printf("  n = %9u: B+ tree build %8.3f [ms] (+%4.1f%% memory), linear %7.2f [MSamples/s], "
+               "B+ tree %7.2f [MSamples/s]\n",
+               numValues, buildTime * 1e3, 100.0 * (btree.size() - (numValues + 1)) / (numValues + 1),
+               numSamples / linearTime * 1e-6, numSamples / btreeTime * 1e-6);
+    }
+}
+
+
+
+// JP: 和の木へのランダムな更新。重みをゼロにする更新や同じインデックスへの重複した更新を含む。
+//     weightsにも同じ更新を適用する(同じインデックスは最後の値が残る)。
+// EN: Random updates to a sum tree, including updates to zero weights and duplicate updates of the same index.
+//     The same updates are applied to weights as well (the last value remains for the same index).
+static void createSumTreeUpdates(uint32_t numUpdates, uint32_t seed, std::vector<float>* weights,
+                                 std::vector<uint32_t>* indices, std::vector<float>* values) {
+    const uint32_t numValues = static_cast<uint32_t>(weights->size());
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01;
+    std::uniform_int_distribution<uint32_t> indexDist(0, numValues - 1);
+    indices->clear();
+    values->clear();
+    for (uint32_t i = 0; i < numUpdates; ++i) {
+        uint32_t index = (i > 0 && u01(rng) < 0.1f) ? (*indices)[indexDist(rng) % i] : indexDist(rng);
+        float value = u01(rng) < 0.3f ? 0.0f : (u01(rng) < 0.05f ? 1e4f * u01(rng) : u01(rng));
+        indices->push_back(index);
+        values->push_back(value);
+        (*weights)[index] = value;
+    }
+
+    // JP: 全ての重みがゼロにならないようにする。
+    // EN: Prevent all weights from becoming zero.
+    if (std::all_of(weights->cbegin(), weights->cend(), [](float w) { return w == 0.0f; })) {
+        indices->push_back(0);
+        values->push_back(1.0f);
+        (*weights)[0] = 1.0f;
+    }
+}
+
+// JP: k個の値を更新した和の木が、更新後の値から作り直した木とビット単位で一致し、
+//     同じuに対して同じ要素とremappedを返すことを確認する。
+// EN: Check that a sum tree with k values updated matches bit for bit the tree rebuilt from the updated values,
+//     and returns the same item and remapped for the same u.
+VLR_TEST(SumTree_UpdateMatchesRebuild) {
+    const uint32_t sizes[] = { 1, 2, 7, 1000, 4097 };
+    const uint32_t numsUpdates[] = { 1, 16, 300 };
+    const uint32_t numUs = 1 << 12;
+    for (WeightPattern pattern : weightPatterns) {
+        for (uint32_t numValues : sizes) {
+            for (uint32_t numUpdates : numsUpdates) {
+                std::vector<float> weights = createWeights(pattern, numValues, numValues);
+                std::vector<float> sumTree(shared::computeSumTreeSize(numValues));
+                buildSumTree(weights.data(), numValues, sumTree.data());
+
+                std::vector<uint32_t> indices;
+                std::vector<float> values;
+                createSumTreeUpdates(numUpdates, numValues + numUpdates, &weights, &indices, &values);
+                std::vector<SumTreeNodeRange> dirtyRanges;
+                float updatedSum = updateSumTree(sumTree.data(), numValues, indices.data(), values.data(),
+                                                 static_cast<uint32_t>(indices.size()), 16, &dirtyRanges);
+
+                std::vector<float> rebuiltTree(sumTree.size());
+                float rebuiltSum = buildSumTree(weights.data(), numValues, rebuiltTree.data());
+                VLR_CHECK(std::memcmp(sumTree.data(), rebuiltTree.data(), sizeof(float) * sumTree.size()) == 0 &&
+                          updatedSum == rebuiltSum,
+                          "%s n=%u k=%u: updated tree differs from the rebuilt tree",
+                          getWeightPatternName(pattern), numValues, numUpdates);
+
+                // JP: PMFは葉の値を総和で割ったもの。
+                // EN: The PMF is the leaf value divided by the total sum.
+                std::vector<float> PMF = normalizeWeights(weights);
+                shared::DiscreteDistribution1D dist(nullptr, sumTree.data(), nullptr, 0.0f, numValues,
+                                                    shared::DistributionLayout::SumTree);
+                double maxPMFError = 0.0;
+                for (uint32_t i = 0; i < numValues; ++i)
+                    maxPMFError = std::max(maxPMFError, std::fabs(static_cast<double>(dist.evaluatePMF(i)) - PMF[i]));
+                VLR_CHECK(maxPMFError < 1e-6, "%s n=%u k=%u: max PMF error %g",
+                          getWeightPatternName(pattern), numValues, numUpdates, maxPMFError);
+
+                std::mt19937 rng(numValues);
+                std::uniform_real_distribution<float> u01;
+                uint32_t numMismatches = 0;
+                for (uint32_t s = 0; s < numUs; ++s) {
+                    float u = std::min(u01(rng), 0.99999994f);
+                    float updatedRemapped, rebuiltRemapped;
+                    uint32_t updatedIdx = shared::sampleSumTree(sumTree.data(), numValues, u, &updatedRemapped);
+                    uint32_t rebuiltIdx = shared::sampleSumTree(rebuiltTree.data(), numValues, u, &rebuiltRemapped);
+                    numMismatches += updatedIdx != rebuiltIdx || updatedRemapped != rebuiltRemapped;
+                }
+                VLR_CHECK(numMismatches == 0, "%s n=%u k=%u: %u samples differ",
+                          getWeightPatternName(pattern), numValues, numUpdates, numMismatches);
+            }
+        }
+    }
+}
+
+// JP: 重みがゼロの葉が選ばれないことを、CDFの境界ちょうどとその直前のu、0と1直前のuを含めて確認する。
+//     また、層化したuで選ばれる頻度がPMFに従い、remappedが[0, 1)に収まることを確認する。
+// EN: Check that leaves with zero weights are never selected, including u exactly at and just below the CDF boundaries,
+//     and u at 0 and just below 1.
+//     Also check that the selection frequencies with stratified u follow the PMF and that remapped stays in [0, 1).
+VLR_TEST(SumTree_NeverSamplesZeroWeights) {
+    const uint32_t sizes[] = { 2, 7, 64, 1000, 4097 };
+    for (WeightPattern pattern : weightPatterns) {
+        for (uint32_t numValues : sizes) {
+            std::vector<float> weights = createWeights(pattern, numValues, numValues);
+            std::vector<float> sumTree(shared::computeSumTreeSize(numValues));
+            buildSumTree(weights.data(), numValues, sumTree.data());
+            std::vector<uint32_t> indices;
+            std::vector<float> values;
+            createSumTreeUpdates(numValues / 2, numValues, &weights, &indices, &values);
+            std::vector<SumTreeNodeRange> dirtyRanges;
+            updateSumTree(sumTree.data(), numValues, indices.data(), values.data(),
+                          static_cast<uint32_t>(indices.size()), 16, &dirtyRanges);
+
+            std::vector<float> CDF = createReferenceCDF(weights);
+            std::vector<float> us = { 0.0f, 0.99999994f };
+            for (uint32_t i = 0; i < numValues; ++i) {
+                if (CDF[i] < 1.0f)
+                    us.push_back(CDF[i]);
+                us.push_back(std::nextafter(CDF[i], 0.0f));
+            }
+            const uint32_t numStratifiedUs = 1 << 20;
+            for (uint32_t s = 0; s < numStratifiedUs; ++s)
+                us.push_back((s + 0.5f) / numStratifiedUs);
+
+            uint32_t numZeroWeightSamples = 0;
+            bool remappedInRange = true;
+            std::vector<uint32_t> counts(numValues, 0);
+            for (uint32_t s = 0; s < us.size(); ++s) {
+                float remapped;
+                uint32_t idx = shared::sampleSumTree(sumTree.data(), numValues, us[s], &remapped);
+                numZeroWeightSamples += weights[idx] == 0.0f;
+                remappedInRange &= remapped >= 0.0f && remapped < 1.0f;
+                if (s >= us.size() - numStratifiedUs)
+                    ++counts[idx];
+            }
+            VLR_CHECK(numZeroWeightSamples == 0, "%s n=%u: %u samples selected zero-weight leaves",
+                      getWeightPatternName(pattern), numValues, numZeroWeightSamples);
+            VLR_CHECK(remappedInRange, "%s n=%u: remapped out of [0, 1)", getWeightPatternName(pattern), numValues);
+
+            std::vector<float> PMF = normalizeWeights(weights);
+            double maxError = 0.0;
+            for (uint32_t i = 0; i < numValues; ++i)
+                maxError = std::max(maxError, std::fabs(static_cast<double>(counts[i]) / numStratifiedUs - PMF[i]));
+            VLR_CHECK(maxError < 1e-5, "%s n=%u: max frequency error %g",
+                      getWeightPatternName(pattern), numValues, maxError);
+        }
+    }
+}
+
+// JP: 更新が返す範囲が、更新された葉から根までの経路上の全てのノードを覆い、昇順で重ならず、
+//     間隔がmaxGapより大きいことを確認する。maxGap = 0の場合は経路上のノードちょうどになる。
+// EN: Check that the ranges returned by an update cover every node on the paths from the updated leaves to the root,
+//     are in ascending order without overlaps, and are separated by gaps larger than maxGap.
+//     With maxGap = 0 they are exactly the nodes on the paths.
+VLR_TEST(SumTree_DirtyRangesCoverChangedNodes) {
+    const uint32_t sizes[] = { 1, 1000, 4097, 1 << 16 };
+    const uint32_t numsUpdates[] = { 1, 10, 1000 };
+    const uint32_t maxGaps[] = { 0, 16 };
+    for (uint32_t numValues : sizes) {
+        for (uint32_t numUpdates : numsUpdates) {
+            for (uint32_t maxGap : maxGaps) {
+                std::vector<float> weights = createWeights(WeightPattern::Random, numValues, numValues);
+                std::vector<float> sumTree(shared::computeSumTreeSize(numValues));
+                buildSumTree(weights.data(), numValues, sumTree.data());
+                const std::vector<float> prevTree = sumTree;
+
+                std::vector<uint32_t> indices;
+                std::vector<float> values;
+                createSumTreeUpdates(numUpdates, numUpdates, &weights, &indices, &values);
+                std::vector<SumTreeNodeRange> dirtyRanges;
+                updateSumTree(sumTree.data(), numValues, indices.data(), values.data(),
+                              static_cast<uint32_t>(indices.size()), maxGap, &dirtyRanges);
+
+                std::vector<bool> onPath(sumTree.size(), false);
+                for (uint32_t index : indices) {
+                    for (uint32_t nodeIdx = nextPowerOf2(numValues) + index; nodeIdx >= 1; nodeIdx >>= 1)
+                        onPath[nodeIdx] = true;
+                }
+
+                std::vector<bool> covered(sumTree.size(), false);
+                bool validRanges = !dirtyRanges.empty();
+                for (uint32_t r = 0; r < dirtyRanges.size(); ++r) {
+                    const SumTreeNodeRange &range = dirtyRanges[r];
+                    validRanges &= range.begin >= 1 && range.begin < range.end && range.end <= sumTree.size();
+                    if (r > 0)
+                        validRanges &= range.begin > dirtyRanges[r - 1].end + maxGap;
+                    if (!validRanges)
+                        break;
+                    for (uint32_t nodeIdx = range.begin; nodeIdx < range.end; ++nodeIdx)
+                        covered[nodeIdx] = true;
+                }
+                VLR_CHECK(validRanges, "n=%u k=%u gap=%u: invalid ranges", numValues, numUpdates, maxGap);
+                if (!validRanges)
+                    continue;
+
+                uint32_t numUncoveredChanges = 0;
+                uint32_t numUncoveredPathNodes = 0;
+                uint32_t numExtraNodes = 0;
+                for (uint32_t nodeIdx = 1; nodeIdx < sumTree.size(); ++nodeIdx) {
+                    bool changed = std::memcmp(&sumTree[nodeIdx], &prevTree[nodeIdx], sizeof(float)) != 0;
+                    numUncoveredChanges += changed && !covered[nodeIdx];
+                    numUncoveredPathNodes += onPath[nodeIdx] && !covered[nodeIdx];
+                    numExtraNodes += covered[nodeIdx] && !onPath[nodeIdx];
+                }
+                VLR_CHECK(numUncoveredChanges == 0, "n=%u k=%u gap=%u: %u changed nodes aren't covered",
+                          numValues, numUpdates, maxGap, numUncoveredChanges);
+                VLR_CHECK(numUncoveredPathNodes == 0, "n=%u k=%u gap=%u: %u path nodes aren't covered",
+                          numValues, numUpdates, maxGap, numUncoveredPathNodes);
+                VLR_CHECK(maxGap > 0 || numExtraNodes == 0, "n=%u k=%u: %u nodes off the paths are covered",
+                          numValues, numUpdates, numExtraNodes);
+            }
+        }
+    }
+}
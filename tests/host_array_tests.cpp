@@ -0,0 +1,41 @@
+#include "test_common.h"
+#include "host_array.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+static void countRelease(void* userData) {
+    ++*static_cast<uint32_t*>(userData);
+}
+
+// JP: 受け取ったバッファーはコピーされず、ムーブや明示的な解放、破棄を経ても解放関数は一度だけ呼ばれる。
+// EN: A transferred buffer isn't copied, and the release function is called exactly once
+//     through moves, an explicit release and destruction.
+VLR_TEST(HostArray_ReleaseExactlyOnce) {
+    uint32_t data[] = { 0, 1, 2, 3, 4, 5 };
+    uint32_t numReleases = 0;
+    {
+        HostArray<uint32_t> a(data, 6, countRelease, &numReleases);
+        VLR_CHECK(a.isExternal() && a.data() == data && a.size() == 6 && a[5] == 5, "buffer is copied");
+        HostArray<uint32_t> b(std::move(a));
+        VLR_CHECK(a.empty() && b.data() == data && numReleases == 0, "move constructor");
+        HostArray<uint32_t> c;
+        c = std::move(b);
+        VLR_CHECK(b.empty() && c.data() == data && numReleases == 0, "move assignment");
+        c.release();
+        VLR_CHECK(c.empty() && numReleases == 1, "explicit release");
+    }
+    VLR_CHECK(numReleases == 1, "released %u times", numReleases);
+
+    numReleases = 0;
+    {
+        HostArray<uint32_t> a(data, 6, countRelease, &numReleases);
+        HostArray<uint32_t> b(data, 3, countRelease, &numReleases);
+        a = std::move(b);
+        VLR_CHECK(numReleases == 1 && a.size() == 3, "overwritten buffer isn't released");
+    }
+    VLR_CHECK(numReleases == 2, "released %u times", numReleases);
+
+    HostArray<uint32_t> v(std::vector<uint32_t>({ 7, 8, 9 }));
+    VLR_CHECK(!v.isExternal() && v.size() == 3 && v[2] == 9, "owned vector");
+}
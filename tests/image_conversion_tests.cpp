@@ -0,0 +1,102 @@
+#include "test_common.h"
+#include "image_conversion.h"
+#include "thread_pool.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+struct ConversionCase {
+    const char* name;
+    DataFormat dataFormat;
+    SpectrumType spectrumType;
+    ColorSpace colorSpace;
+};
+
+static const ConversionCase conversionCases[] = {
+    { "RGB8x3 Reflectance sRGB", DataFormat::RGB8x3, SpectrumType::Reflectance, ColorSpace::Rec709_D65_sRGBGamma },
+    { "RGB_8x4 Reflectance sRGB", DataFormat::RGB_8x4, SpectrumType::Reflectance, ColorSpace::Rec709_D65_sRGBGamma },
+    { "RGBA8x4 Reflectance sRGB", DataFormat::RGBA8x4, SpectrumType::Reflectance, ColorSpace::Rec709_D65_sRGBGamma },
+    { "RGBA8x4 LightSource linear", DataFormat::RGBA8x4, SpectrumType::LightSource, ColorSpace::Rec709_D65 },
+    { "RGBA16Fx4 Reflectance sRGB", DataFormat::RGBA16Fx4, SpectrumType::Reflectance, ColorSpace::Rec709_D65_sRGBGamma },
+    { "RGBA16Fx4 LightSource linear", DataFormat::RGBA16Fx4, SpectrumType::LightSource, ColorSpace::Rec709_D65 },
+    { "RGBA32Fx4 NA sRGB", DataFormat::RGBA32Fx4, SpectrumType::NA, ColorSpace::Rec709_D65_sRGBGamma },
+    { "RG32Fx2 NA linear", DataFormat::RG32Fx2, SpectrumType::NA, ColorSpace::Rec709_D65 },
+    { "Gray32F NA sRGB", DataFormat::Gray32F, SpectrumType::NA, ColorSpace::Rec709_D65_sRGBGamma },
+    { "Gray8 NA linear", DataFormat::Gray8, SpectrumType::NA, ColorSpace::Rec709_D65 },
+    { "GrayA8x2 NA sRGB", DataFormat::GrayA8x2, SpectrumType::NA, ColorSpace::Rec709_D65_sRGBGamma },
+};
+
+// JP: 変換後の1ピクセルの最大サイズ(RGBA32Fx4)。
+// EN: Maximum size of a converted pixel (RGBA32Fx4).
+static constexpr size_t MaxConvertedPixelSize = sizeof(RGBA32Fx4);
+
+static std::vector<uint8_t> createRandomImageData(DataFormat dataFormat, uint32_t width, uint32_t height, uint32_t seed) {
+    const size_t stride = sizesOfDataFormats[static_cast<uint32_t>(dataFormat)];
+    const size_t numPixels = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> data(stride * numPixels);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01;
+    if (dataFormat == DataFormat::RGBA16Fx4) {
+        auto values = reinterpret_cast<half*>(data.data());
+        for (size_t i = 0; i < 4 * numPixels; ++i)
+            values[i] = static_cast<half>(4.0f * u01(rng));
+    }
+    else if (dataFormat == DataFormat::RGBA32Fx4 ||
+             dataFormat == DataFormat::RG32Fx2 ||
+             dataFormat == DataFormat::Gray32F) {
+        auto values = reinterpret_cast<float*>(data.data());
+        for (size_t i = 0; i < data.size() / sizeof(float); ++i)
+            values[i] = 4.0f * u01(rng);
+    }
+    else {
+        for (uint8_t &v : data)
+            v = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// JP: 並列変換の結果が行ごとの変換(1行の画像は分割されず呼び出しスレッドで逐次処理される)と一致することを確認する。
+// EN: Check that the parallel conversion matches row-by-row conversion
+//     (an image of a single row is not split and is processed serially on the calling thread).
+VLR_TEST(ImageConversion_ParallelMatchesSerial) {
+    const uint32_t width = 333;
+    const uint32_t height = 517;
+    for (const ConversionCase &cc : conversionCases) {
+        const size_t srcStride = sizesOfDataFormats[static_cast<uint32_t>(cc.dataFormat)];
+        const size_t dstStride = sizesOfDataFormats[static_cast<uint32_t>(
+            getConvertedDataFormat(cc.dataFormat, cc.spectrumType))];
+        std::vector<uint8_t> srcData = createRandomImageData(cc.dataFormat, width, height, 12345);
+
+        std::vector<uint8_t> parallelResult(dstStride * width * height);
+        convertLinearImageData(srcData.data(), width, height, cc.dataFormat, cc.spectrumType, cc.colorSpace,
+                               parallelResult.data());
+
+        std::vector<uint8_t> serialResult(dstStride * width * height);
+        for (uint32_t y = 0; y < height; ++y) {
+            convertLinearImageData(srcData.data() + srcStride * width * y, width, 1,
+                                   cc.dataFormat, cc.spectrumType, cc.colorSpace,
+                                   serialResult.data() + dstStride * width * y);
+        }
+
+        VLR_CHECK(parallelResult == serialResult, "%s", cc.name);
+    }
+}
+
+// JP: 形式ごとの変換スループット[MPixel/s]を計測する。
+// EN: Measure the conversion throughput in MPixel/s per format.
+VLR_BENCHMARK(ImageConversion_Throughput) {
+    const uint32_t width = isQuickRun() ? 512 : 4096;
+    const uint32_t height = isQuickRun() ? 512 : 4096;
+    const uint32_t numRepeats = isQuickRun() ? 1 : 5;
+    std::vector<uint8_t> dstData(MaxConvertedPixelSize * width * height);
+    printf("  %ux%u, %u threads\n", width, height, ThreadPool::getShared().getNumThreads());
+    for (const ConversionCase &cc : conversionCases) {
+        std::vector<uint8_t> srcData = createRandomImageData(cc.dataFormat, width, height, 12345);
+        double time = measureBestTime(numRepeats, [&]() {
+            convertLinearImageData(srcData.data(), width, height, cc.dataFormat, cc.spectrumType, cc.colorSpace,
+                                   dstData.data());
+        });
+        printf("  %-32s: %8.3f [ms], %8.1f [MPixel/s]\n",
+               cc.name, time * 1e+3, static_cast<double>(width) * height * 1e-6 / time);
+    }
+}
@@ -0,0 +1,242 @@
+#include "test_common.h"
+#include "image_resampler.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+struct ResamplingSize {
+    uint32_t srcWidth;
+    uint32_t srcHeight;
+    uint32_t dstWidth;
+    uint32_t dstHeight;
+};
+
+// JP: 整数比と非整数比の縮小、拡大、1ピクセルへの縮小を含む。
+// EN: Includes downsampling with integer and non-integer ratios, upsampling and downsampling into a single pixel.
+static const ResamplingSize resamplingSizes[] = {
+    { 64, 48, 16, 12 },
+    { 37, 29, 10, 7 },
+    { 10, 8, 23, 17 },
+    { 5, 3, 2, 1 },
+    { 13, 11, 1, 1 },
+};
+
+template <typename PixelType>
+static std::vector<PixelType> resample(const std::vector<PixelType> &src, const ResamplingSize &size,
+                                       DataFormat dataFormat, bool sRGBEncoded, ResamplingFilter filter) {
+    std::vector<PixelType> dst(static_cast<size_t>(size.dstWidth) * size.dstHeight);
+    resampleLinearImageData(reinterpret_cast<const uint8_t*>(src.data()), size.srcWidth, size.srcHeight,
+                            reinterpret_cast<uint8_t*>(dst.data()), size.dstWidth, size.dstHeight,
+                            dataFormat, sRGBEncoded, filter);
+    return dst;
+}
+
+// JP: ボックスフィルターの参照実装。出力ピクセルのフットプリント(拡大時は1ピクセル幅)と入力ピクセルの
+//     重なり面積を重みとして2次元で直接平均する。範囲外は端のピクセルの値とみなす。
+// EN: Reference implementation of the box filter. Directly averages in 2D, weighting by the overlap area
+//     between the footprint of an output pixel (one pixel wide when upsampling) and input pixels.
+//     Outside of the range is regarded as the value of the edge pixel.
+static std::vector<RGBA32Fx4> resampleBoxReference(const std::vector<RGBA32Fx4> &src, const ResamplingSize &size) {
+    const auto computeFootprint = [](uint32_t i, uint32_t srcSize, uint32_t dstSize, double* minP, double* maxP) {
+        double scale = static_cast<double>(srcSize) / dstSize;
+        double halfWidth = 0.5 * std::max(scale, 1.0);
+        double center = (i + 0.5) * scale;
+        *minP = center - halfWidth;
+        *maxP = center + halfWidth;
+    };
+
+    std::vector<RGBA32Fx4> dst(static_cast<size_t>(size.dstWidth) * size.dstHeight);
+    for (uint32_t y = 0; y < size.dstHeight; ++y) {
+        double minY, maxY;
+        computeFootprint(y, size.srcHeight, size.dstHeight, &minY, &maxY);
+        for (uint32_t x = 0; x < size.dstWidth; ++x) {
+            double minX, maxX;
+            computeFootprint(x, size.srcWidth, size.dstWidth, &minX, &maxX);
+
+            double sum[4] = {};
+            double sumWeight = 0.0;
+            for (int32_t sy = static_cast<int32_t>(std::floor(minY)); sy < std::ceil(maxY); ++sy) {
+                double wy = std::min(sy + 1.0, maxY) - std::max<double>(sy, minY);
+                for (int32_t sx = static_cast<int32_t>(std::floor(minX)); sx < std::ceil(maxX); ++sx) {
+                    double wx = std::min(sx + 1.0, maxX) - std::max<double>(sx, minX);
+                    double weight = wx * wy;
+                    if (weight <= 0.0)
+                        continue;
+                    const RGBA32Fx4 &pix = src[static_cast<size_t>(size.srcWidth) *
+                                               clamp<int32_t>(sy, 0, size.srcHeight - 1) +
+                                               clamp<int32_t>(sx, 0, size.srcWidth - 1)];
+                    sum[0] += weight * pix.r;
+                    sum[1] += weight * pix.g;
+                    sum[2] += weight * pix.b;
+                    sum[3] += weight * pix.a;
+                    sumWeight += weight;
+                }
+            }
+            dst[static_cast<size_t>(size.dstWidth) * y + x] = RGBA32Fx4{
+                static_cast<float>(sum[0] / sumWeight), static_cast<float>(sum[1] / sumWeight),
+                static_cast<float>(sum[2] / sumWeight), static_cast<float>(sum[3] / sumWeight) };
+        }
+    }
+    return dst;
+}
+
+static float getMaxDifference(const std::vector<RGBA32Fx4> &a, const std::vector<RGBA32Fx4> &b) {
+    float maxDiff = 0.0f;
+    for (size_t i = 0; i < a.size(); ++i) {
+        maxDiff = std::max(maxDiff, std::fabs(a[i].r - b[i].r));
+        maxDiff = std::max(maxDiff, std::fabs(a[i].g - b[i].g));
+        maxDiff = std::max(maxDiff, std::fabs(a[i].b - b[i].b));
+        maxDiff = std::max(maxDiff, std::fabs(a[i].a - b[i].a));
+    }
+    return maxDiff;
+}
+
+VLR_TEST(ImageResampler_BoxMatchesReference) {
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> u01;
+    for (const ResamplingSize &size : resamplingSizes) {
+        std::vector<RGBA32Fx4> src(static_cast<size_t>(size.srcWidth) * size.srcHeight);
+        for (RGBA32Fx4 &pix : src)
+            pix = RGBA32Fx4{ u01(rng), u01(rng), u01(rng), u01(rng) };
+
+        std::vector<RGBA32Fx4> result = resample(src, size, DataFormat::RGBA32Fx4, false, ResamplingFilter::Box);
+        std::vector<RGBA32Fx4> reference = resampleBoxReference(src, size);
+        float maxDiff = getMaxDifference(result, reference);
+        VLR_CHECK(maxDiff < 1e-5f, "%ux%u -> %ux%u: max difference %g",
+                  size.srcWidth, size.srcHeight, size.dstWidth, size.dstHeight, maxDiff);
+    }
+}
+
+// JP: 重みは正規化されているので、どのフィルターでも一様な画像は一様なまま保たれる。
+//     8bit形式はsRGBのデガンマと再エンコードを経ても同じ値に戻る。
+// EN: Weights are normalized, so a uniform image stays uniform with any filter.
+//     8-bit formats return to the same value even through sRGB degamma and re-encoding.
+VLR_TEST(ImageResampler_PreservesConstantImages) {
+    const ResamplingFilter filters[] = { ResamplingFilter::Box, ResamplingFilter::Tent, ResamplingFilter::Lanczos3 };
+    const char* filterNames[] = { "Box", "Tent", "Lanczos3" };
+    for (uint32_t f = 0; f < std::size(filters); ++f) {
+        ResamplingFilter filter = filters[f];
+        for (const ResamplingSize &size : resamplingSizes) {
+            const size_t numSrcPixels = static_cast<size_t>(size.srcWidth) * size.srcHeight;
+
+            std::vector<RGBA32Fx4> srcF32(numSrcPixels, RGBA32Fx4{ 0.3f, 0.6f, 0.9f, 0.5f });
+            std::vector<RGBA32Fx4> dstF32 = resample(srcF32, size, DataFormat::RGBA32Fx4, false, filter);
+            std::vector<RGBA32Fx4> expectedF32(dstF32.size(), srcF32[0]);
+            float maxDiff = getMaxDifference(dstF32, expectedF32);
+            VLR_CHECK(maxDiff < 1e-5f, "%s, RGBA32Fx4, %ux%u -> %ux%u: max difference %g",
+                      filterNames[f], size.srcWidth, size.srcHeight, size.dstWidth, size.dstHeight, maxDiff);
+
+            for (bool sRGB : { false, true }) {
+                for (uint8_t value : { 0, 1, 77, 128, 254, 255 }) {
+                    std::vector<RGBA8x4> src8(numSrcPixels, RGBA8x4{ value, static_cast<uint8_t>(255 - value), 200, value });
+                    std::vector<RGBA8x4> dst8 = resample(src8, size, DataFormat::RGBA8x4, sRGB, filter);
+                    uint32_t numMismatches = 0;
+                    for (const RGBA8x4 &pix : dst8)
+                        numMismatches += std::memcmp(&pix, &src8[0], sizeof(RGBA8x4)) != 0;
+                    VLR_CHECK(numMismatches == 0, "%s, RGBA8x4%s value %u, %ux%u -> %ux%u: %u pixels changed",
+                              filterNames[f], sRGB ? " sRGB" : "", value,
+                              size.srcWidth, size.srcHeight, size.dstWidth, size.dstHeight, numMismatches);
+                }
+            }
+
+            std::vector<uvsA16Fx4> srcUVS(numSrcPixels, uvsA16Fx4{
+                static_cast<half>(5.0f), static_cast<half>(6.0f), static_cast<half>(1.5f), static_cast<half>(1.0f) });
+            std::vector<uvsA16Fx4> dstUVS = resample(srcUVS, size, DataFormat::uvsA16Fx4, false, filter);
+            float maxUVSDiff = 0.0f;
+            for (const uvsA16Fx4 &pix : dstUVS) {
+                maxUVSDiff = std::max(maxUVSDiff, std::fabs(static_cast<float>(pix.u) - 5.0f));
+                maxUVSDiff = std::max(maxUVSDiff, std::fabs(static_cast<float>(pix.v) - 6.0f));
+                maxUVSDiff = std::max(maxUVSDiff, std::fabs(static_cast<float>(pix.s) - 1.5f));
+            }
+            VLR_CHECK(maxUVSDiff < 1e-2f, "%s, uvsA16Fx4, %ux%u -> %ux%u: max difference %g",
+                      filterNames[f], size.srcWidth, size.srcHeight, size.dstWidth, size.dstHeight, maxUVSDiff);
+        }
+    }
+}
+
+// JP: sRGBでエンコードされた8bitデータはリニア空間で平均される。黒と白の市松模様を半分に縮小すると、
+//     リニアで0.5をガンマエンコードした値になり、エンコードされた値の平均(128付近)にはならない。
+// EN: sRGB-encoded 8-bit data is averaged in linear space. Halving a black and white checkerboard
+//     gives the gamma-encoded value of linear 0.5, not the average of the encoded values (around 128).
+VLR_TEST(ImageResampler_FiltersSRGBInLinearSpace) {
+    const ResamplingSize size = { 16, 16, 8, 8 };
+    std::vector<Gray8> src(static_cast<size_t>(size.srcWidth) * size.srcHeight);
+    for (uint32_t y = 0; y < size.srcHeight; ++y) {
+        for (uint32_t x = 0; x < size.srcWidth; ++x)
+            src[size.srcWidth * y + x].v = ((x + y) & 1) ? 255 : 0;
+    }
+
+    const uint8_t expectedSRGB = static_cast<uint8_t>(sRGB_gamma(0.5f) * 255.0f + 0.5f);
+    std::vector<Gray8> dstSRGB = resample(src, size, DataFormat::Gray8, true, ResamplingFilter::Box);
+    uint32_t numSRGBMismatches = 0;
+    for (const Gray8 &pix : dstSRGB)
+        numSRGBMismatches += pix.v != expectedSRGB;
+    VLR_CHECK(numSRGBMismatches == 0, "%u pixels differ from %u (sRGB)", numSRGBMismatches, expectedSRGB);
+
+    std::vector<Gray8> dstLinear = resample(src, size, DataFormat::Gray8, false, ResamplingFilter::Box);
+    uint32_t numLinearMismatches = 0;
+    for (const Gray8 &pix : dstLinear)
+        numLinearMismatches += pix.v != 128;
+    VLR_CHECK(numLinearMismatches == 0, "%u pixels differ from 128 (linear)", numLinearMismatches);
+}
+
+// JP: uvs形式はXYZで平均される。明るさと色度が異なる2色を平均すると、u, vを直接平均した値とは異なり、
+//     明るい色の色度に寄る。
+// EN: The uvs formats are averaged in XYZ. Averaging two colors with different brightness and chromaticity
+//     differs from averaging u, v directly and leans toward the chromaticity of the brighter color.
+VLR_TEST(ImageResampler_FiltersUVSInXYZ) {
+    const auto toXYZ = [](float u, float v, float b, float XYZ[3]) {
+        float uv[2] = { u, v };
+        float xy[2];
+        UpsampledSpectrum::uv_to_xy(uv, xy);
+        XYZ[0] = xy[0] * b;
+        XYZ[1] = xy[1] * b;
+        XYZ[2] = (1 - xy[0] - xy[1]) * b;
+    };
+
+    const float pixels[2][3] = {
+        { 3.0f, 4.0f, 0.1f },
+        { 8.0f, 9.0f, 2.0f },
+    };
+    float XYZ[3] = {};
+    for (const auto &pixel : pixels) {
+        float pixelXYZ[3];
+        toXYZ(pixel[0], pixel[1], pixel[2], pixelXYZ);
+        for (int c = 0; c < 3; ++c)
+            XYZ[c] += 0.5f * pixelXYZ[c];
+    }
+    float expectedB = XYZ[0] + XYZ[1] + XYZ[2];
+    float xy[2] = { XYZ[0] / expectedB, XYZ[1] / expectedB };
+    float expectedUV[2];
+    UpsampledSpectrum::xy_to_uv(xy, expectedUV);
+
+    const ResamplingSize size = { 2, 1, 1, 1 };
+    std::vector<uvsA16Fx4> src(2);
+    for (int i = 0; i < 2; ++i) {
+        src[i] = uvsA16Fx4{ static_cast<half>(pixels[i][0]), static_cast<half>(pixels[i][1]),
+                            static_cast<half>(pixels[i][2]), static_cast<half>(1.0f) };
+    }
+    std::vector<uvsA16Fx4> dst = resample(src, size, DataFormat::uvsA16Fx4, false, ResamplingFilter::Box);
+    float u = dst[0].u;
+    float v = dst[0].v;
+    float b = dst[0].s;
+    VLR_CHECK(std::fabs(u - expectedUV[0]) < 1e-2f && std::fabs(v - expectedUV[1]) < 1e-2f &&
+              std::fabs(b - expectedB) < 1e-2f,
+              "(%g, %g, %g), expected (%g, %g, %g)", u, v, b, expectedUV[0], expectedUV[1], expectedB);
+    VLR_CHECK(std::fabs(u - 5.5f) > 0.5f, "u is close to the naive average");
+
+    // JP: 8bitのuvs形式も同じ経路を通る。
+    // EN: The 8-bit uvs format goes through the same path.
+    std::vector<uvsA8x4> src8(2);
+    for (int i = 0; i < 2; ++i) {
+        src8[i] = uvsA8x4{
+            static_cast<uint8_t>(pixels[i][0] / UpsampledSpectrum::GridWidth() * 255.0f + 0.5f),
+            static_cast<uint8_t>(pixels[i][1] / UpsampledSpectrum::GridHeight() * 255.0f + 0.5f),
+            static_cast<uint8_t>(pixels[i][2] / 3.0f * 255.0f + 0.5f), 255 };
+    }
+    std::vector<uvsA8x4> dst8 = resample(src8, size, DataFormat::uvsA8x4, false, ResamplingFilter::Box);
+    float u8 = dst8[0].u / 255.0f * UpsampledSpectrum::GridWidth();
+    float v8 = dst8[0].v / 255.0f * UpsampledSpectrum::GridHeight();
+    VLR_CHECK(std::fabs(u8 - expectedUV[0]) < 0.1f && std::fabs(v8 - expectedUV[1]) < 0.1f && dst8[0].a == 255,
+              "uvsA8x4 (%g, %g), expected (%g, %g)", u8, v8, expectedUV[0], expectedUV[1]);
+}
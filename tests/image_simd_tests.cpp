@@ -0,0 +1,168 @@
+#include "test_common.h"
+#include "image_simd.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+static const char* getInstructionSetName(SIMDInstructionSet instSet) {
+    switch (instSet) {
+    case SIMDInstructionSet::Scalar:
+        return "Scalar";
+    case SIMDInstructionSet::SSE4_1:
+        return "SSE4.1";
+    case SIMDInstructionSet::AVX2_F16C:
+        return "AVX2+F16C";
+    default:
+        return "";
+    }
+}
+
+// JP: 8bit値をテーブル経由で読むか、16bit浮動小数点値か、範囲外を含む任意の浮動小数点値か。
+// EN: Whether 8-bit values are read via a table, 16-bit floating point values,
+//     or arbitrary floating point values including out-of-range ones.
+enum class UVSSourceKind {
+    UNorm8,
+    UNorm8_sRGB,
+    Float16,
+    Float32,
+};
+
+struct UVSSourceCase {
+    const char* name;
+    UVSSourceKind kind;
+};
+
+static const UVSSourceCase uvsSourceCases[] = {
+    { "8-bit linear", UVSSourceKind::UNorm8 },
+    { "8-bit sRGB degamma", UVSSourceKind::UNorm8_sRGB },
+    { "16F", UVSSourceKind::Float16 },
+    { "32F with extremes", UVSSourceKind::Float32 },
+};
+
+// JP: image_conversion.cppのgatherRGB()と同様に、各形式の値をfloatのSoAとして用意する。
+//     先頭には0(b = 0の分岐)、半精度の最大値付近(F16Cのオーバーフロー)、負値、非正規化数などを並べる。
+// EN: Prepare values of each format as float SoA, similar to gatherRGB() in image_conversion.cpp.
+//     The head holds 0 (the b = 0 branch), values around the half max (F16C overflow), negative values,
+//     denormals and so on.
+static void createUVSSource(UVSSourceKind kind, uint32_t numPixels, uint32_t seed,
+                            std::vector<float>* R, std::vector<float>* G, std::vector<float>* B) {
+    R->resize(numPixels);
+    G->resize(numPixels);
+    B->resize(numPixels);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01;
+    const float* table = getUNorm8ToFloatTable(kind == UVSSourceKind::UNorm8_sRGB);
+    for (uint32_t i = 0; i < numPixels; ++i) {
+        float* channels[] = { &(*R)[i], &(*G)[i], &(*B)[i] };
+        for (float* c : channels) {
+            switch (kind) {
+            case UVSSourceKind::UNorm8:
+            case UVSSourceKind::UNorm8_sRGB:
+                *c = table[rng() & 0xFF];
+                break;
+            case UVSSourceKind::Float16:
+                *c = static_cast<float>(static_cast<half>(65504.0f * std::pow(u01(rng), 8.0f)));
+                break;
+            case UVSSourceKind::Float32:
+                *c = 1e+6f * (u01(rng) - 0.25f);
+                break;
+            }
+        }
+    }
+
+    const float specialValues[][3] = {
+        { 0.0f, 0.0f, 0.0f },
+        { 1.0f, 1.0f, 1.0f },
+        { 65504.0f, 65504.0f, 65504.0f },
+        { 65504.0f, 0.0f, 0.0f },
+        { 0.0f, 0.0f, 65504.0f },
+        { 1e-30f, 1e-30f, 1e-30f },
+        { 1e-40f, 0.0f, 1e-40f },
+        { -1.0f, 0.5f, 0.25f },
+        { -1.0f, -1.0f, -1.0f },
+        { 1e+30f, 1.0f, 1.0f },
+        { 0.0f, 1.0f, 0.0f },
+    };
+    if (kind != UVSSourceKind::Float32)
+        return;
+    for (uint32_t i = 0; i < std::min<uint32_t>(numPixels, std::size(specialValues)); ++i) {
+        (*R)[i] = specialValues[i][0];
+        (*G)[i] = specialValues[i][1];
+        (*B)[i] = specialValues[i][2];
+    }
+}
+
+template <typename DstType>
+static std::vector<DstType> encodeUVS(SIMDInstructionSet instSet, const float mat[9],
+                                      const std::vector<float> &R, const std::vector<float> &G, const std::vector<float> &B) {
+    // JP: アルファ値に触れないことも確認するため、変換前の内容を固定のパターンで埋める。
+    // EN: Fill with a fixed pattern beforehand to also check that alpha values are left untouched.
+    std::vector<DstType> dst(R.size());
+    std::memset(dst.data(), 0xA5, sizeof(DstType) * dst.size());
+    setMaxSIMDInstructionSet(instSet);
+    encodeLinearRGBToUVS(mat, R.data(), G.data(), B.data(), static_cast<uint32_t>(R.size()), dst.data());
+    setMaxSIMDInstructionSet(SIMDInstructionSet::AVX2_F16C);
+    return dst;
+}
+
+// JP: 変換テーブルが image.cpp の perPixelFunc() の式とビット単位で一致することを確認する。
+// EN: Check that the conversion tables match the expressions of perPixelFunc() in image.cpp bit for bit.
+VLR_TEST(ImageSIMD_UNorm8Tables) {
+    const float* linear = getUNorm8ToFloatTable(false);
+    const float* degamma = getUNorm8ToFloatTable(true);
+    uint32_t numLinearMismatches = 0;
+    uint32_t numDegammaMismatches = 0;
+    for (int i = 0; i < 256; ++i) {
+        float expectedLinear = i / 255.0f;
+        float expectedDegamma = sRGB_degamma(i / 255.0f);
+        if (std::memcmp(&linear[i], &expectedLinear, sizeof(float)) != 0)
+            ++numLinearMismatches;
+        if (std::memcmp(&degamma[i], &expectedDegamma, sizeof(float)) != 0)
+            ++numDegammaMismatches;
+    }
+    VLR_CHECK(numLinearMismatches == 0, "%u linear entries differ", numLinearMismatches);
+    VLR_CHECK(numDegammaMismatches == 0, "%u sRGB degamma entries differ", numDegammaMismatches);
+}
+
+// JP: CPUがサポートする各命令セットの実装がスカラー版とビット単位で一致することを、
+//     入力の種類、色空間の行列、出力形式(uvsA8x4, uvsA16Fx4)の全ての組み合わせで確認する。
+//     画素数は端数の処理も通るようにベクトル幅の倍数からずらす。
+// EN: Check that the implementation for each instruction set supported by the CPU matches the scalar version
+//     bit for bit, for every combination of input kind, color space matrix and output format (uvsA8x4, uvsA16Fx4).
+//     The number of pixels is offset from a multiple of the vector width so that the tail is processed as well.
+VLR_TEST(ImageSIMD_MatchesScalar) {
+    const SIMDInstructionSet instSets[] = { SIMDInstructionSet::SSE4_1, SIMDInstructionSet::AVX2_F16C };
+    const struct {
+        const char* name;
+        const float* mat;
+    } matrices[] = {
+        { "Rec709(D65)", mat_Rec709_D65_to_XYZ },
+        { "Rec709(E)", mat_Rec709_E_to_XYZ },
+    };
+    const uint32_t numPixels = 4099;
+
+    for (SIMDInstructionSet instSet : instSets) {
+        if (static_cast<uint32_t>(instSet) > static_cast<uint32_t>(getSupportedSIMDInstructionSet())) {
+            printf("  %s is not supported on this CPU, skipped.\n", getInstructionSetName(instSet));
+            continue;
+        }
+        for (const UVSSourceCase &sc : uvsSourceCases) {
+            std::vector<float> R, G, B;
+            createUVSSource(sc.kind, numPixels, 1234, &R, &G, &B);
+            for (const auto &matrix : matrices) {
+                {
+                    std::vector<uvsA8x4> reference = encodeUVS<uvsA8x4>(SIMDInstructionSet::Scalar, matrix.mat, R, G, B);
+                    std::vector<uvsA8x4> result = encodeUVS<uvsA8x4>(instSet, matrix.mat, R, G, B);
+                    VLR_CHECK(std::memcmp(result.data(), reference.data(), sizeof(uvsA8x4) * numPixels) == 0,
+                              "%s, %s, %s -> uvsA8x4", getInstructionSetName(instSet), sc.name, matrix.name);
+                }
+                {
+                    std::vector<uvsA16Fx4> reference = encodeUVS<uvsA16Fx4>(SIMDInstructionSet::Scalar, matrix.mat, R, G, B);
+                    std::vector<uvsA16Fx4> result = encodeUVS<uvsA16Fx4>(instSet, matrix.mat, R, G, B);
+                    VLR_CHECK(std::memcmp(result.data(), reference.data(), sizeof(uvsA16Fx4) * numPixels) == 0,
+                              "%s, %s, %s -> uvsA16Fx4", getInstructionSetName(instSet), sc.name, matrix.name);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,253 @@
+#include "test_common.h"
+#include "distribution_builder.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: 箱の中にランダムな向きと大きさの三角形光源を散らばらせる。一部はパワーがゼロ、一部は両面放射とする。
+// EN: Scatter triangle lights of random orientations and sizes in a box. Some have zero power and some are two-sided.
+struct TriangleLight {
+    Point3D p[3];
+    float power;
+    bool twoSided;
+};
+
+static std::vector<TriangleLight> createTriangleLights(uint32_t numLights, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01;
+    const auto randomPoint = [&](float extent) {
+        return Point3D(extent * (2 * u01(rng) - 1), extent * (2 * u01(rng) - 1), extent * (2 * u01(rng) - 1));
+    };
+    std::vector<TriangleLight> lights(numLights);
+    for (TriangleLight &light : lights) {
+        Point3D center = randomPoint(10.0f);
+        float size = 0.1f + 0.4f * u01(rng);
+        for (uint32_t v = 0; v < 3; ++v)
+            light.p[v] = center + size * (randomPoint(1.0f) - Point3D(0.0f));
+        light.power = u01(rng) < 0.1f ? 0.0f : 0.1f + 10.0f * u01(rng);
+        light.twoSided = u01(rng) < 0.2f;
+    }
+    return lights;
+}
+
+static std::vector<shared::LightBounds> createLightBounds(const std::vector<TriangleLight> &lights) {
+    std::vector<shared::LightBounds> bounds(lights.size());
+    for (uint32_t i = 0; i < lights.size(); ++i) {
+        const TriangleLight &light = lights[i];
+        bounds[i] = createTriangleLightBounds(light.p[0], light.p[1], light.p[2], light.power, light.twoSided);
+    }
+    return bounds;
+}
+
+// JP: 光源を重心の点光源とみなしたシェーディング点pへの寄与。nがゼロベクトルの場合は受光側の余弦を考慮しない。
+// EN: Contribution to shading point p regarding a light as a point light at its centroid.
+//     The receiver-side cosine is ignored when n is zero.
+static double evaluateContribution(const TriangleLight &light, const Point3D &p, const Normal3D &n) {
+    Vector3D ln = cross(light.p[1] - light.p[0], light.p[2] - light.p[0]);
+    if (light.power == 0.0f || ln.sqLength() == 0.0f)
+        return 0.0;
+    ln = normalize(ln);
+    Point3D c = (light.p[0] + light.p[1] + light.p[2]) / 3.0f;
+    Vector3D dir = p - c;
+    double dist2 = dir.sqLength();
+    dir = normalize(dir);
+    double cosLight = light.twoSided ? std::fabs(dot(ln, dir)) : std::max(dot(ln, dir), 0.0f);
+    double cosReceiver = (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f) ? absDot(dir, n) : 1.0f;
+    return light.power * cosLight * cosReceiver / dist2;
+}
+
+struct ShadingPoint {
+    Point3D p;
+    Normal3D n;
+};
+
+static std::vector<ShadingPoint> createShadingPoints(uint32_t numPoints, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01;
+    std::vector<ShadingPoint> points(numPoints);
+    for (uint32_t i = 0; i < numPoints; ++i) {
+        ShadingPoint &sp = points[i];
+        sp.p = Point3D(12 * (2 * u01(rng) - 1), 12 * (2 * u01(rng) - 1), 12 * (2 * u01(rng) - 1));
+        // JP: 最初の点は表面の向きを持たない(ボリューム内の点など)。
+        // EN: The first point has no surface orientation (e.g. a point in a volume).
+        if (i == 0) {
+            sp.n = Normal3D(0.0f, 0.0f, 0.0f);
+        }
+        else {
+            Vector3D v(2 * u01(rng) - 1, 2 * u01(rng) - 1, 2 * u01(rng) - 1);
+            v = v.sqLength() > 0.0f ? normalize(v) : Vector3D(0, 0, 1);
+            sp.n = Normal3D(v.x, v.y, v.z);
+        }
+    }
+    return points;
+}
+
+// JP: 選択確率qで光源を1つ選ぶ推定量 f_i / q_i の分散を全光源の列挙で厳密に求める。
+// EN: Compute the variance of the estimator f_i / q_i choosing one light with probability q exactly by enumerating all lights.
+template <typename ProbFunc>
+static double computeEstimatorVariance(const std::vector<double> &contributions, const ProbFunc &getProbability) {
+    double total = 0.0;
+    double secondMoment = 0.0;
+    for (uint32_t i = 0; i < contributions.size(); ++i) {
+        double f = contributions[i];
+        if (f == 0.0)
+            continue;
+        total += f;
+        secondMoment += f * f / getProbability(i);
+    }
+    return std::max(secondMoment - total * total, 0.0);
+}
+
+// JP: シーンにおける従来の選択確率(パワーに比例)と一様な選択確率。
+// EN: The conventional selection probabilities in the scene (proportional to power) and uniform probabilities.
+static std::vector<double> createPowerProbabilities(const std::vector<TriangleLight> &lights) {
+    double sum = 0.0;
+    for (const TriangleLight &light : lights)
+        sum += light.power;
+    std::vector<double> probs(lights.size());
+    for (uint32_t i = 0; i < lights.size(); ++i)
+        probs[i] = lights[i].power / sum;
+    return probs;
+}
+
+
+
+// JP: 各シェーディング点について全光源の選択確率の和が1になり、寄与を持つ光源の確率がゼロにならないことを確認する。
+//     sample()が返す確率もevaluatePMF()と一致することを確認する。
+// EN: Check that the selection probabilities of all lights sum to 1 at each shading point,
+//     and that no light with a contribution has zero probability.
+//     Also check that the probability returned by sample() matches evaluatePMF().
+VLR_TEST(LightBVH_PMFSumsToOne) {
+    const uint32_t sizes[] = { 1, 2, 3, 100, 2000 };
+    for (uint32_t numLights : sizes) {
+        std::vector<TriangleLight> lights = createTriangleLights(numLights, numLights);
+        lights[0].power = 1.0f;
+        std::vector<shared::LightBounds> lightBounds = createLightBounds(lights);
+        std::vector<shared::LightBVHNode> nodes;
+        std::vector<uint64_t> bitTrails;
+        buildLightBVH(lightBounds.data(), numLights, &nodes, &bitTrails);
+        shared::LightBVH bvh(nodes.data(), bitTrails.data(), static_cast<uint32_t>(nodes.size()), numLights);
+
+        std::vector<ShadingPoint> points = createShadingPoints(32, numLights + 1);
+        for (uint32_t pIdx = 0; pIdx < points.size(); ++pIdx) {
+            const ShadingPoint &sp = points[pIdx];
+            double pmfSum = 0.0;
+            uint32_t numMissedLights = 0;
+            for (uint32_t i = 0; i < numLights; ++i) {
+                float pmf = bvh.evaluatePMF(sp.p, sp.n, i);
+                pmfSum += pmf;
+                if (pmf == 0.0f && evaluateContribution(lights[i], sp.p, sp.n) > 0.0)
+                    ++numMissedLights;
+            }
+            // JP: 全ての光源の重要度がゼロなら何も選ばれない。
+            // EN: Nothing is chosen if the importances of all lights are zero.
+            VLR_CHECK(std::fabs(pmfSum - 1.0) < 1e-4 || pmfSum == 0.0, "n=%u, point %u: sum of PMF %.7f",
+                      numLights, pIdx, pmfSum);
+            VLR_CHECK(numMissedLights == 0, "n=%u, point %u: %u lights with contributions have zero probability",
+                      numLights, pIdx, numMissedLights);
+
+            bool probMatches = true;
+            for (uint32_t s = 0; s < 64; ++s) {
+                float prob, remapped;
+                uint32_t lightIdx = bvh.sample(sp.p, sp.n, (s + 0.5f) / 64, &prob, &remapped);
+                if (lightIdx == shared::LightBVH::InvalidLightIndex) {
+                    probMatches &= pmfSum == 0.0;
+                    continue;
+                }
+                float pmf = bvh.evaluatePMF(sp.p, sp.n, lightIdx);
+                probMatches &= lightIdx < numLights && std::fabs(prob - pmf) <= 1e-5f * pmf &&
+                    remapped >= 0.0f && remapped < 1.0f;
+            }
+            VLR_CHECK(probMatches, "n=%u, point %u: sample() disagrees with evaluatePMF()", numLights, pIdx);
+        }
+    }
+}
+
+// JP: 光源のBVHによる選択の推定量の分散が、パワーに比例するフラットな選択より小さいことを確認する。
+// EN: Check that the variance of the estimator with light BVH selection is lower than with the flat selection proportional to power.
+VLR_TEST(LightBVH_ReducesVarianceOverFlat) {
+    const uint32_t numLights = 4000;
+    std::vector<TriangleLight> lights = createTriangleLights(numLights, 17);
+    std::vector<shared::LightBounds> lightBounds = createLightBounds(lights);
+    std::vector<shared::LightBVHNode> nodes;
+    std::vector<uint64_t> bitTrails;
+    buildLightBVH(lightBounds.data(), numLights, &nodes, &bitTrails);
+    shared::LightBVH bvh(nodes.data(), bitTrails.data(), static_cast<uint32_t>(nodes.size()), numLights);
+    std::vector<double> powerProbs = createPowerProbabilities(lights);
+
+    double bvhVarianceSum = 0.0;
+    double flatVarianceSum = 0.0;
+    std::vector<ShadingPoint> points = createShadingPoints(64, 5);
+    std::vector<double> contributions(numLights);
+    for (const ShadingPoint &sp : points) {
+        double total = 0.0;
+        for (uint32_t i = 0; i < numLights; ++i) {
+            contributions[i] = evaluateContribution(lights[i], sp.p, sp.n);
+            total += contributions[i];
+        }
+        // JP: 点ごとの寄与の大きさの違いで平均が支配されないよう、相対分散を足し合わせる。
+        // EN: Sum relative variances so that the average isn't dominated by differences in magnitude per point.
+        double norm = total * total;
+        bvhVarianceSum += computeEstimatorVariance(contributions, [&](uint32_t i) { return bvh.evaluatePMF(sp.p, sp.n, i); }) / norm;
+        flatVarianceSum += computeEstimatorVariance(contributions, [&](uint32_t i) { return powerProbs[i]; }) / norm;
+    }
+    VLR_CHECK(bvhVarianceSum < 0.5 * flatVarianceSum, "relative variance: light BVH %g, flat %g",
+              bvhVarianceSum / points.size(), flatVarianceSum / points.size());
+}
+
+// JP: 光源数ごとに、構築時間、サンプリング速度と、フラットな選択(パワー比例、一様)に対する分散を比較する。
+// EN: For each number of lights, compare build time, sampling throughput,
+//     and variance against the flat selections (proportional to power and uniform).
+VLR_BENCHMARK(LightBVH_vs_Flat) {
+    const uint32_t sizes[] = { 1000, 10000, 100000, 1000000 };
+    const uint32_t numSamples = isQuickRun() ? (1 << 14) : (1 << 20);
+    const uint32_t numPoints = isQuickRun() ? 4 : 16;
+    for (uint32_t numLights : sizes) {
+        if (isQuickRun() && numLights > 1000)
+            break;
+        std::vector<TriangleLight> lights = createTriangleLights(numLights, 23);
+        std::vector<shared::LightBounds> lightBounds = createLightBounds(lights);
+        std::vector<shared::LightBVHNode> nodes;
+        std::vector<uint64_t> bitTrails;
+        double buildTime = measureBestTime(3, [&]() {
+            buildLightBVH(lightBounds.data(), numLights, &nodes, &bitTrails);
+        });
+        shared::LightBVH bvh(nodes.data(), bitTrails.data(), static_cast<uint32_t>(nodes.size()), numLights);
+        std::vector<double> powerProbs = createPowerProbabilities(lights);
+
+        std::vector<ShadingPoint> points = createShadingPoints(numPoints, 29);
+        double bvhVarianceSum = 0.0;
+        double powerVarianceSum = 0.0;
+        double uniformVarianceSum = 0.0;
+        std::vector<double> contributions(numLights);
+        for (const ShadingPoint &sp : points) {
+            double total = 0.0;
+            for (uint32_t i = 0; i < numLights; ++i) {
+                contributions[i] = evaluateContribution(lights[i], sp.p, sp.n);
+                total += contributions[i];
+            }
+            double norm = total * total;
+            bvhVarianceSum += computeEstimatorVariance(contributions, [&](uint32_t i) { return bvh.evaluatePMF(sp.p, sp.n, i); }) / norm;
+            powerVarianceSum += computeEstimatorVariance(contributions, [&](uint32_t i) { return powerProbs[i]; }) / norm;
+            uniformVarianceSum += computeEstimatorVariance(contributions, [&](uint32_t i) { return 1.0 / numLights; }) / norm;
+        }
+
+        const ShadingPoint &sp = points[1];
+        double sampleTime = measureBestTime(3, [&]() {
+            float probSum = 0.0f;
+            for (uint32_t s = 0; s < numSamples; ++s) {
+                float prob, remapped;
+                bvh.sample(sp.p, sp.n, (s + 0.5f) / numSamples, &prob, &remapped);
+                probSum += prob;
+            }
+            return probSum;
+        });
+
+        printf("  n = %8u: build %9.3f [ms], sample %6.2f [MSamples/s], relative variance: "
+               "BVH %.3e, power %.3e (%.1fx), uniform %.3e (%.1fx)\n",
+               numLights, buildTime * 1e3, numSamples / sampleTime * 1e-6,
+               bvhVarianceSum / numPoints,
+               powerVarianceSum / numPoints, powerVarianceSum / bvhVarianceSum,
+               uniformVarianceSum / numPoints, uniformVarianceSum / bvhVarianceSum);
+    }
+}
@@ -0,0 +1,53 @@
+#include "test_common.h"
+#include "lz_codec.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: 圧縮しやすい部分とランダムな部分が混ざったデータを作る。
+// EN: Create data mixing compressible and random parts.
+static std::vector<uint8_t> createMixedData(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i)
+        data[i] = (i / 4096) % 2 == 0 ? static_cast<uint8_t>(i % 61) : static_cast<uint8_t>(rng());
+    return data;
+}
+
+VLR_TEST(LZCodec_RoundTrip) {
+    const size_t sizes[] = { 0, 1, 17, 4096, (1 << 20) + 123, 3 * (1 << 20) };
+    for (size_t size : sizes) {
+        std::vector<uint8_t> data = createMixedData(size, static_cast<uint32_t>(size));
+        std::vector<uint8_t> compressed;
+        compressLZ(data.data(), data.size(), &compressed);
+
+        size_t decompressedSize = 0;
+        VLR_CHECK(getDecompressedLZSize(compressed.data(), compressed.size(), &decompressedSize) &&
+                  decompressedSize == size, "size %zu: wrong decompressed size", size);
+        std::vector<uint8_t> decompressed(size);
+        VLR_CHECK(decompressLZ(compressed.data(), compressed.size(), decompressed.data(), size) &&
+                  decompressed == data, "size %zu: round trip failed", size);
+    }
+}
+
+VLR_TEST(LZCodec_DetectsCorruption) {
+    const size_t size = 2 * (1 << 20) + 5;
+    std::vector<uint8_t> data = createMixedData(size, 1);
+    std::vector<uint8_t> compressed;
+    compressLZ(data.data(), data.size(), &compressed);
+
+    // JP: 圧縮チャンクと無圧縮チャンクの両方を含むようにペイロード中の様々な位置のバイトを反転させる。
+    // EN: Flip bytes at various positions of the payload so that both compressed and raw chunks are covered.
+    std::vector<uint8_t> decompressed(size);
+    std::mt19937 rng(2);
+    const uint32_t numTrials = 64;
+    uint32_t numUndetected = 0;
+    for (uint32_t trial = 0; trial < numTrials; ++trial) {
+        std::vector<uint8_t> corrupted = compressed;
+        size_t pos = compressed.size() / 2 + rng() % (compressed.size() / 2);
+        corrupted[pos] ^= static_cast<uint8_t>(1 << (rng() % 8));
+        if (decompressLZ(corrupted.data(), corrupted.size(), decompressed.data(), size))
+            ++numUndetected;
+    }
+    VLR_CHECK(numUndetected == 0, "%u/%u corruptions went undetected", numUndetected, numTrials);
+}
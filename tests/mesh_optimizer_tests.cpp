@@ -0,0 +1,176 @@
+#include "test_common.h"
+#include "mesh_optimizer.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: gridSize x gridSizeのグリッドを2つの領域のマテリアルグループに分けたメッシュ。
+//     三角形の順序と頂点の番号をシャッフルし、一部の頂点を複製し、参照されない頂点を加える。
+// EN: Mesh of a gridSize x gridSize grid split into material groups of two regions.
+//     Shuffles the order of triangles and the vertex numbering, duplicates some vertices and adds unreferenced vertices.
+struct ShuffledGridMesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> groups[2];
+    uint32_t numUniqueVertices;
+};
+
+static ShuffledGridMesh createShuffledGridMesh(uint32_t gridSize, uint32_t seed) {
+    std::mt19937 rng(seed);
+    uint32_t numVertsPerRow = gridSize + 1;
+    ShuffledGridMesh mesh;
+    mesh.numUniqueVertices = numVertsPerRow * numVertsPerRow;
+
+    std::vector<uint32_t> vertexOrder(mesh.numUniqueVertices);
+    std::iota(vertexOrder.begin(), vertexOrder.end(), 0);
+    std::shuffle(vertexOrder.begin(), vertexOrder.end(), rng);
+    mesh.vertices.resize(mesh.numUniqueVertices);
+    for (uint32_t v = 0; v < mesh.numUniqueVertices; ++v) {
+        uint32_t x = v % numVertsPerRow;
+        uint32_t y = v / numVertsPerRow;
+        Vertex &vertex = mesh.vertices[vertexOrder[v]];
+        std::memset(&vertex, 0, sizeof(vertex));
+        vertex.position = Point3D(static_cast<float>(x), 0.0f, static_cast<float>(y));
+        vertex.normal = Normal3D(0, 1, 0);
+        vertex.tc0Direction = Vector3D(1, 0, 0);
+        vertex.texCoord = TexCoord2D(static_cast<float>(x) / gridSize, static_cast<float>(y) / gridSize);
+    }
+
+    // JP: 各三角形の3頂点と、マテリアルグループ(グリッドの左1/4が1、それ以外が0)。
+    // EN: Three vertices of each triangle and its material group (1 for the left quarter of the grid, 0 otherwise).
+    std::vector<std::array<uint32_t, 4>> triangles;
+    for (uint32_t y = 0; y < gridSize; ++y) {
+        for (uint32_t x = 0; x < gridSize; ++x) {
+            uint32_t v00 = vertexOrder[y * numVertsPerRow + x];
+            uint32_t v10 = vertexOrder[y * numVertsPerRow + x + 1];
+            uint32_t v01 = vertexOrder[(y + 1) * numVertsPerRow + x];
+            uint32_t v11 = vertexOrder[(y + 1) * numVertsPerRow + x + 1];
+            uint32_t group = x < gridSize / 4 ? 1 : 0;
+            triangles.push_back({ v00, v01, v10, group });
+            triangles.push_back({ v10, v01, v11, group });
+        }
+    }
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+
+    // JP: 複製した頂点を参照する三角形と、どこからも参照されない頂点を作る。
+    // EN: Make triangles referencing duplicated vertices, and vertices referenced from nowhere.
+    for (uint32_t t = 0; t < triangles.size(); t += 7) {
+        uint32_t &index = triangles[t][t % 3];
+        mesh.vertices.push_back(mesh.vertices[index]);
+        index = static_cast<uint32_t>(mesh.vertices.size() - 1);
+    }
+    for (uint32_t i = 0; i < 10; ++i) {
+        Vertex vertex = mesh.vertices[i];
+        vertex.position = Point3D(-1.0f, -static_cast<float>(i), 0.0f);
+        mesh.vertices.push_back(vertex);
+    }
+
+    for (const std::array<uint32_t, 4> &tri : triangles)
+        mesh.groups[tri[3]].insert(mesh.groups[tri[3]].end(), tri.cbegin(), tri.cbegin() + 3);
+    return mesh;
+}
+
+// JP: 三角形を頂点位置の組で表し、巡回順を保った正規形にする。
+// EN: Represent a triangle by its vertex positions in a canonical form preserving the winding order.
+using TrianglePositions = std::array<std::array<float, 3>, 3>;
+
+static std::vector<TrianglePositions> collectTriangles(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+    std::vector<TrianglePositions> triangles;
+    for (uint32_t t = 0; t < indices.size() / 3; ++t) {
+        TrianglePositions tri;
+        for (uint32_t k = 0; k < 3; ++k) {
+            const Point3D &p = vertices[indices[3 * t + k]].position;
+            tri[k] = { p.x, p.y, p.z };
+        }
+        std::rotate(tri.begin(), std::min_element(tri.begin(), tri.end()), tri.end());
+        triangles.push_back(tri);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+
+
+// JP: 既知のインデックス列でACMRを確認する。
+// EN: Check the ACMR with known index lists.
+VLR_TEST(MeshOptimizer_ACMRKnownSequences) {
+    // JP: 同じ三角形の繰り返しは最初の3頂点だけがミスになる。
+    // EN: Repeating the same triangle misses only the first 3 vertices.
+    std::vector<uint32_t> repeated;
+    for (uint32_t t = 0; t < 100; ++t)
+        repeated.insert(repeated.end(), { 0, 1, 2 });
+    float acmr = computeACMR(repeated.data(), static_cast<uint32_t>(repeated.size()), 3);
+    VLR_CHECK(acmr == 3.0f / 100, "repeated triangle: ACMR %g", acmr);
+
+    // JP: 頂点を共有しない三角形は毎回3ミス。
+    // EN: Triangles sharing no vertices miss 3 every time.
+    std::vector<uint32_t> disjoint(300);
+    std::iota(disjoint.begin(), disjoint.end(), 0);
+    acmr = computeACMR(disjoint.data(), static_cast<uint32_t>(disjoint.size()), 300);
+    VLR_CHECK(acmr == 3.0f, "disjoint triangles: ACMR %g", acmr);
+
+    // JP: 帯状の三角形列は1三角形あたり1頂点だけ新しい。
+    // EN: Each triangle of a strip introduces only one new vertex.
+    std::vector<uint32_t> strip;
+    for (uint32_t t = 0; t < 100; ++t)
+        strip.insert(strip.end(), { t, t + 1, t + 2 });
+    acmr = computeACMR(strip.data(), static_cast<uint32_t>(strip.size()), 102);
+    VLR_CHECK(acmr == 102.0f / 100, "strip: ACMR %g", acmr);
+
+    // JP: キャッシュより長い周期で同じ頂点を巡回すると、FIFOでは全てミスになる。
+    // EN: Cycling through the same vertices with a period longer than the cache misses every time with a FIFO.
+    std::vector<uint32_t> cycle;
+    for (uint32_t i = 0; i < 3 * 40; ++i)
+        cycle.push_back(i % 33);
+    acmr = computeACMR(cycle.data(), static_cast<uint32_t>(cycle.size()), 33, 32);
+    VLR_CHECK(acmr == 3.0f, "cycle longer than the cache: ACMR %g", acmr);
+}
+
+// JP: 最適化でジオメトリが変わらず、重複と未参照の頂点が除かれ、ACMRが改善することを確認する。
+// EN: Check that optimization doesn't change the geometry, removes duplicate and unreferenced vertices, and improves the ACMR.
+VLR_TEST(MeshOptimizer_ImprovesACMR) {
+    const uint32_t gridSize = 128;
+    ShuffledGridMesh mesh = createShuffledGridMesh(gridSize, 3);
+    std::vector<TrianglePositions> refTriangles[2] = {
+        collectTriangles(mesh.vertices, mesh.groups[0]),
+        collectTriangles(mesh.vertices, mesh.groups[1]),
+    };
+
+    std::vector<uint32_t>* groups[] = { &mesh.groups[0], &mesh.groups[1] };
+    MeshOptimizationStats stats;
+    optimizeMesh(&mesh.vertices, groups, 2, &stats);
+
+    for (uint32_t g = 0; g < 2; ++g) {
+        bool indicesInRange = std::all_of(
+            mesh.groups[g].cbegin(), mesh.groups[g].cend(),
+            [&](uint32_t index) { return index < mesh.vertices.size(); });
+        VLR_CHECK(indicesInRange, "group %u: index out of range", g);
+        if (indicesInRange)
+            VLR_CHECK(collectTriangles(mesh.vertices, mesh.groups[g]) == refTriangles[g], "group %u: geometry changed", g);
+    }
+    VLR_CHECK(stats.numVerticesAfter == mesh.numUniqueVertices && mesh.vertices.size() == mesh.numUniqueVertices,
+              "%u vertices remain, expected %u", stats.numVerticesAfter, mesh.numUniqueVertices);
+    VLR_CHECK(stats.numTriangles == 2 * gridSize * gridSize, "%u triangles", stats.numTriangles);
+
+    // JP: シャッフルされた三角形はほぼ毎回3ミス。モートン順ではグリッドの頂点の再利用が効く。
+    // EN: Shuffled triangles miss almost 3 every time. In Morton order, the reuse of grid vertices takes effect.
+    VLR_CHECK(stats.acmrBefore > 2.5f, "ACMR before %g", stats.acmrBefore);
+    VLR_CHECK(stats.acmrAfter < 1.0f, "ACMR after %g", stats.acmrAfter);
+}
+
+// JP: グリッドの大きさごとに、最適化前後のACMR、ユニークな頂点の割合と処理時間を示す。
+// EN: For each grid size, show the ACMR before and after optimization, the unique vertex ratio and the processing time.
+VLR_BENCHMARK(MeshOptimizer_Stats) {
+    const uint32_t gridSizes[] = { 64, 300, 1000 };
+    for (uint32_t gridSize : gridSizes) {
+        if (isQuickRun() && gridSize > 64)
+            break;
+        ShuffledGridMesh mesh = createShuffledGridMesh(gridSize, 5);
+        std::vector<uint32_t>* groups[] = { &mesh.groups[0], &mesh.groups[1] };
+        MeshOptimizationStats stats;
+        optimizeMesh(&mesh.vertices, groups, 2, &stats);
+        printf("  %8u triangles: ACMR %.3f -> %.3f, unique vertices %u / %u (%.1f%%), %9.2f [ms]\n",
+               stats.numTriangles, stats.acmrBefore, stats.acmrAfter,
+               stats.numVerticesAfter, stats.numVerticesBefore, 100.0f * stats.numVerticesAfter / stats.numVerticesBefore,
+               stats.milliseconds);
+    }
+}
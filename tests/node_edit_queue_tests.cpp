@@ -0,0 +1,332 @@
+#include "test_common.h"
+#include "node_edit_queue.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: ParentNode/InternalNodeのイベント伝播を模したノード。
+//     各ノードは自分から下の各パスに対応する連結トランスフォームを持ち、接続されると差分を親へ伝え、親はさらにその親へ伝える。
+// EN: Node mimicking the event propagation of ParentNode/InternalNode.
+//     Each node holds a concatenated transform for each path below it, and when linked it propagates the delta
+//     to its parents, which propagate it further to their parents.
+struct MockTransform {
+    const MockTransform* child;
+};
+
+struct MockNode {
+    std::set<MockNode*> parents;
+    // key: child transform, nullptr for the transform containing only the node itself
+    std::map<const MockTransform*, MockTransform*> transforms;
+    uint32_t numUpdates;
+
+    static uint64_t s_numEvents;
+
+    MockNode() : numUpdates(0) {
+        transforms[nullptr] = new MockTransform{ nullptr };
+    }
+    ~MockNode() {
+        for (auto it = transforms.cbegin(); it != transforms.cend(); ++it)
+            delete it->second;
+    }
+
+    std::vector<MockTransform*> getAllTransforms() const {
+        std::vector<MockTransform*> all;
+        all.reserve(transforms.size());
+        for (auto it = transforms.cbegin(); it != transforms.cend(); ++it)
+            all.push_back(it->second);
+        return all;
+    }
+
+    void transformAddEvent(const std::vector<MockTransform*> &childDelta) {
+        ++s_numEvents;
+        std::vector<MockTransform*> delta;
+        if (!parents.empty())
+            delta.reserve(childDelta.size());
+        for (MockTransform* childTransform : childDelta) {
+            MockTransform* transform = new MockTransform{ childTransform };
+            transforms[childTransform] = transform;
+            if (!parents.empty())
+                delta.push_back(transform);
+        }
+        for (MockNode* parent : parents)
+            parent->transformAddEvent(delta);
+    }
+    void transformRemoveEvent(const std::vector<MockTransform*> &childDelta) {
+        ++s_numEvents;
+        std::vector<MockTransform*> delta;
+        delta.reserve(childDelta.size());
+        for (MockTransform* childTransform : childDelta) {
+            delta.push_back(transforms.at(childTransform));
+            transforms.erase(childTransform);
+        }
+        for (MockNode* parent : parents)
+            parent->transformRemoveEvent(delta);
+        for (MockTransform* transform : delta)
+            delete transform;
+    }
+    void transformUpdateEvent() {
+        ++s_numEvents;
+        ++numUpdates;
+        for (MockNode* parent : parents)
+            parent->transformUpdateEvent();
+    }
+
+    void addParent(MockNode* parent) {
+        parents.insert(parent);
+        parent->transformAddEvent(getAllTransforms());
+    }
+    void removeParent(MockNode* parent) {
+        parents.erase(parent);
+        parent->transformRemoveEvent(getAllTransforms());
+    }
+};
+
+uint64_t MockNode::s_numEvents = 0;
+
+// JP: 編集中ならキューに記録し、そうでなければその場で伝播させる(ParentNode::linkChild()などに相当)。
+// EN: Record to the queue while editing, otherwise propagate right away (equivalent to ParentNode::linkChild() etc.).
+struct MockGraph {
+    std::vector<std::unique_ptr<MockNode>> nodes;
+    NodeEditQueue<MockNode> queue;
+    bool isEditing;
+
+    explicit MockGraph(uint32_t numNodes) : isEditing(false) {
+        for (uint32_t i = 0; i < numNodes; ++i)
+            nodes.push_back(std::make_unique<MockNode>());
+    }
+
+    static void applyLink(MockNode* parent, MockNode* child, bool linked) {
+        if (linked)
+            child->addParent(parent);
+        else
+            child->removeParent(parent);
+    }
+
+    void link(uint32_t parentIdx, uint32_t childIdx) {
+        if (isEditing)
+            queue.addLink(nodes[parentIdx].get(), nodes[childIdx].get());
+        else
+            applyLink(nodes[parentIdx].get(), nodes[childIdx].get(), true);
+    }
+    void unlink(uint32_t parentIdx, uint32_t childIdx) {
+        if (isEditing)
+            queue.removeLink(nodes[parentIdx].get(), nodes[childIdx].get());
+        else
+            applyLink(nodes[parentIdx].get(), nodes[childIdx].get(), false);
+    }
+    void update(uint32_t nodeIdx) {
+        if (isEditing) {
+            queue.updateNode(nodes[nodeIdx].get());
+        }
+        else {
+            for (MockNode* parent : nodes[nodeIdx]->parents)
+                parent->transformUpdateEvent();
+        }
+    }
+
+    void beginEdits() {
+        isEditing = true;
+    }
+    void commitEdits() {
+        isEditing = false;
+        queue.apply(applyLink, [](MockNode* node) {
+            for (MockNode* parent : node->parents)
+                parent->transformUpdateEvent();
+        });
+    }
+};
+
+
+
+// JP: 同じ接続の追加と削除が打ち消し合い、削除は親側から、追加は子側から、トランスフォームの更新は最後に適用されることを確認する。
+// EN: Check that addition and removal of the same link cancel each other, and that removals are applied from the parent side,
+//     additions from the child side, and transform updates last.
+VLR_TEST(NodeEditQueue_CancelsAndOrders) {
+    int nodes[6];
+    std::vector<std::tuple<int*, int*, bool>> applied;
+    std::vector<int*> updated;
+    const auto applyLink = [&](int* parent, int* child, bool linked) {
+        applied.emplace_back(parent, child, linked);
+    };
+    const auto applyUpdate = [&](int* node) {
+        updated.push_back(node);
+    };
+
+    // JP: 未適用の接続の追加と削除、適用済みの接続の削除と再追加はどちらも何もしない。
+    // EN: Addition then removal of an unapplied link, and removal then re-addition of an applied link both do nothing.
+    NodeEditQueue<int> queue;
+    queue.addLink(&nodes[0], &nodes[1]);
+    queue.removeLink(&nodes[0], &nodes[1]);
+    queue.removeLink(&nodes[1], &nodes[2]);
+    queue.addLink(&nodes[1], &nodes[2]);
+    queue.apply(applyLink, applyUpdate);
+    VLR_CHECK(applied.empty(), "%u links applied for cancelled edits", static_cast<uint32_t>(applied.size()));
+
+    // JP: 上から順に接続を追加しても、下の接続から適用される。更新は接続の後に一度だけ。
+    // EN: Even when links are added from the top, they are applied from the bottom. An update is applied once after the links.
+    queue.updateNode(&nodes[3]);
+    queue.addLink(&nodes[0], &nodes[1]);
+    queue.addLink(&nodes[1], &nodes[2]);
+    queue.updateNode(&nodes[3]);
+    queue.addLink(&nodes[2], &nodes[3]);
+    queue.addLink(&nodes[1], &nodes[4]);
+    queue.apply(applyLink, applyUpdate);
+    const auto indexOf = [&](int* parent, int* child) {
+        for (uint32_t i = 0; i < applied.size(); ++i) {
+            if (std::get<0>(applied[i]) == parent && std::get<1>(applied[i]) == child)
+                return static_cast<int32_t>(i);
+        }
+        return -1;
+    };
+    VLR_CHECK(applied.size() == 4, "%u links applied, expected 4", static_cast<uint32_t>(applied.size()));
+    VLR_CHECK(indexOf(&nodes[2], &nodes[3]) < indexOf(&nodes[1], &nodes[2]) &&
+              indexOf(&nodes[1], &nodes[2]) < indexOf(&nodes[0], &nodes[1]) &&
+              indexOf(&nodes[1], &nodes[4]) < indexOf(&nodes[0], &nodes[1]) &&
+              indexOf(&nodes[2], &nodes[3]) >= 0 && indexOf(&nodes[1], &nodes[4]) >= 0,
+              "additions aren't applied from the child side");
+    VLR_CHECK(updated.size() == 1 && updated[0] == &nodes[3], "%u updates applied, expected 1", static_cast<uint32_t>(updated.size()));
+    VLR_CHECK(queue.empty(), "queue isn't empty after apply()");
+
+    // JP: 削除は上の接続から適用される。
+    // EN: Removals are applied from the top.
+    applied.clear();
+    queue.removeLink(&nodes[2], &nodes[3]);
+    queue.removeLink(&nodes[1], &nodes[2]);
+    queue.removeLink(&nodes[0], &nodes[1]);
+    queue.apply(applyLink, applyUpdate);
+    VLR_CHECK(applied.size() == 3 &&
+              indexOf(&nodes[0], &nodes[1]) < indexOf(&nodes[1], &nodes[2]) &&
+              indexOf(&nodes[1], &nodes[2]) < indexOf(&nodes[2], &nodes[3]) &&
+              std::get<2>(applied[0]) == false,
+              "removals aren't applied from the parent side");
+
+    // JP: 破棄されるノードに関わる接続の変更はその場で適用され、ノードの更新は捨てられる。
+    // EN: Changes of links involving a node being destroyed are applied right away, and the update of the node is discarded.
+    applied.clear();
+    updated.clear();
+    queue.removeLink(&nodes[4], &nodes[5]);
+    queue.addLink(&nodes[5], &nodes[3]);
+    queue.addLink(&nodes[0], &nodes[3]);
+    queue.addLink(&nodes[2], &nodes[5]);
+    queue.removeLink(&nodes[2], &nodes[5]);
+    queue.updateNode(&nodes[5]);
+    queue.flushNode(&nodes[5], applyLink);
+    VLR_CHECK(applied.size() == 2 &&
+              indexOf(&nodes[4], &nodes[5]) >= 0 && std::get<2>(applied[indexOf(&nodes[4], &nodes[5])]) == false &&
+              indexOf(&nodes[5], &nodes[3]) >= 0 && std::get<2>(applied[indexOf(&nodes[5], &nodes[3])]) == true,
+              "links of the destroyed node aren't applied right away");
+    applied.clear();
+    queue.apply(applyLink, applyUpdate);
+    VLR_CHECK(applied.size() == 1 && indexOf(&nodes[0], &nodes[3]) == 0, "only the link not involving the destroyed node remains");
+    VLR_CHECK(updated.empty(), "update of the destroyed node is applied");
+}
+
+// JP: ランダムな接続の追加と削除をトランザクションにまとめても、即時に伝播させた場合と同じ連結トランスフォームができることを確認する。
+// EN: Check that grouping random additions and removals of links into transactions yields the same concatenated transforms
+//     as propagating them immediately.
+VLR_TEST(NodeEditQueue_MatchesImmediatePropagation) {
+    const uint32_t numNodes = 40;
+    MockGraph immediate(numNodes);
+    MockGraph batched(numNodes);
+
+    // JP: 親の番号を子より小さくして循環を防ぐ。
+    // EN: Keep parent indices smaller than child indices to prevent cycles.
+    std::mt19937 rng(23);
+    std::set<std::pair<uint32_t, uint32_t>> links;
+    for (uint32_t transaction = 0; transaction < 30; ++transaction) {
+        batched.beginEdits();
+        uint32_t numEdits = 1 + rng() % 40;
+        for (uint32_t e = 0; e < numEdits; ++e) {
+            uint32_t a = rng() % numNodes;
+            uint32_t b = rng() % numNodes;
+            if (a == b)
+                continue;
+            std::pair<uint32_t, uint32_t> link(std::min(a, b), std::max(a, b));
+            if (rng() % 8 == 0) {
+                immediate.update(link.second);
+                batched.update(link.second);
+            }
+            else if (links.count(link)) {
+                links.erase(link);
+                immediate.unlink(link.first, link.second);
+                batched.unlink(link.first, link.second);
+            }
+            else {
+                links.insert(link);
+                immediate.link(link.first, link.second);
+                batched.link(link.first, link.second);
+            }
+        }
+        batched.commitEdits();
+
+        bool match = true;
+        for (uint32_t i = 0; i < numNodes; ++i) {
+            match &= immediate.nodes[i]->transforms.size() == batched.nodes[i]->transforms.size();
+            match &= immediate.nodes[i]->parents.size() == batched.nodes[i]->parents.size();
+        }
+        VLR_CHECK(match, "transaction %u: the hierarchy differs from immediate propagation", transaction);
+        if (!match)
+            break;
+    }
+}
+
+// JP: 深い階層と幅の広い階層を上から順に組み立て、即時の伝播とトランザクションでのイベント数と時間を比較する。
+// EN: Build deep and wide hierarchies from the top, and compare the number of events and the time
+//     between immediate propagation and a transaction.
+VLR_BENCHMARK(NodeEditQueue_DeepAndWideHierarchies) {
+    struct HierarchyShape {
+        const char* name;
+        uint32_t depth;
+        uint32_t fanOut;
+    };
+    // JP: deepは1本の鎖、wideは4段の中間ノードの下にfanOut個ずつの葉。
+    // EN: deep is a single chain, and wide has fanOut leaves under each of 4 levels of intermediate nodes.
+    const HierarchyShape shapes[] = {
+        { "deep", isQuickRun() ? 200u : 2000u, 1 },
+        { "wide", 4, isQuickRun() ? 8u : 18u },
+    };
+    for (const HierarchyShape &shape : shapes) {
+        // JP: 各段のノードの番号。ノード0がシーンに相当する。
+        // EN: Node indices of each level. Node 0 corresponds to the scene.
+        std::vector<std::pair<uint32_t, uint32_t>> links;
+        uint32_t numNodes = 1;
+        std::vector<uint32_t> level = { 0 };
+        for (uint32_t d = 0; d < shape.depth; ++d) {
+            std::vector<uint32_t> nextLevel;
+            for (uint32_t parentIdx : level) {
+                for (uint32_t c = 0; c < shape.fanOut; ++c) {
+                    links.emplace_back(parentIdx, numNodes);
+                    nextLevel.push_back(numNodes++);
+                }
+            }
+            level = std::move(nextLevel);
+        }
+
+        uint64_t numEvents[2];
+        double times[2];
+        size_t numTransforms[2];
+        for (uint32_t batched = 0; batched < 2; ++batched) {
+            MockGraph graph(numNodes);
+            MockNode::s_numEvents = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            if (batched)
+                graph.beginEdits();
+            for (const std::pair<uint32_t, uint32_t> &link : links)
+                graph.link(link.first, link.second);
+            if (batched)
+                graph.commitEdits();
+            times[batched] = getElapsedSeconds(start);
+            numEvents[batched] = MockNode::s_numEvents;
+            numTransforms[batched] = graph.nodes[0]->transforms.size();
+        }
+        VLR_CHECK(numTransforms[0] == numTransforms[1], "%s: %zu vs %zu transforms at the root",
+                  shape.name, numTransforms[0], numTransforms[1]);
+
+        printf("  %s: %8u nodes, %9zu transforms at the root: "
+               "immediate %10llu events %9.2f [ms], batched %8llu events %9.2f [ms] (%.2fx)\n",
+               shape.name, numNodes, numTransforms[1],
+               static_cast<unsigned long long>(numEvents[0]), times[0] * 1e3,
+               static_cast<unsigned long long>(numEvents[1]), times[1] * 1e3,
+               times[0] / times[1]);
+    }
+}
@@ -0,0 +1,179 @@
+#include "test_common.h"
+#include "prefix_sum.h"
+#include "distribution_builder.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: 丸め誤差が出やすい値の並び。
+// EN: Value sequences prone to rounding errors.
+enum class ValuePattern {
+    Random = 0,
+    WideRange,
+    LargeThenTiny,
+};
+
+static const char* getValuePatternName(ValuePattern pattern) {
+    switch (pattern) {
+    case ValuePattern::Random: return "Random";
+    case ValuePattern::WideRange: return "WideRange";
+    case ValuePattern::LargeThenTiny: return "LargeThenTiny";
+    default: return "Unknown";
+    }
+}
+
+static const ValuePattern valuePatterns[] = {
+    ValuePattern::Random, ValuePattern::WideRange, ValuePattern::LargeThenTiny,
+};
+
+static std::vector<float> createValues(ValuePattern pattern, uint32_t numValues, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> u01;
+    std::vector<float> values(numValues);
+    for (uint32_t i = 0; i < numValues; ++i) {
+        switch (pattern) {
+        case ValuePattern::Random:
+            values[i] = u01(rng);
+            break;
+        case ValuePattern::WideRange:
+            values[i] = std::pow(10.0f, 16.0f * u01(rng) - 8.0f);
+            break;
+        case ValuePattern::LargeThenTiny:
+            values[i] = i == 0 ? 1e7f : 1e-3f * u01(rng);
+            break;
+        }
+    }
+    return values;
+}
+
+// JP: 補償加算したlong doubleの排他的プレフィックス和(numValues + 1要素)を参照値とする。
+// EN: Use the exclusive prefix sum (numValues + 1 entries) in compensated long double as the reference.
+static std::vector<long double> computeExactPrefixSum(const std::vector<float> &values) {
+    std::vector<long double> prefix(values.size() + 1);
+    CompensatedSum<long double> sum(0.0L);
+    for (uint32_t i = 0; i < values.size(); ++i) {
+        prefix[i] = sum;
+        sum += values[i];
+    }
+    prefix[values.size()] = sum;
+    return prefix;
+}
+
+// JP: 並列化前の区分定数分布の構築(RealTypeの補償加算による逐次ループの後に正規化)。
+// EN: Construction of a piecewise constant distribution before parallelization
+//     (serial loop of compensated summation in RealType, followed by normalization).
+static float computeSerialRegularConstantCDF(const std::vector<float> &values, float* PDF, float* CDF) {
+    uint32_t numValues = static_cast<uint32_t>(values.size());
+    std::copy(values.cbegin(), values.cend(), PDF);
+    CompensatedSum<float> sum{ 0 };
+    for (uint32_t i = 0; i < numValues; ++i) {
+        CDF[i] = sum;
+        sum += PDF[i] / numValues;
+    }
+    float integral = sum;
+    for (uint32_t i = 0; i < numValues; ++i) {
+        PDF[i] /= integral;
+        CDF[i] /= integral;
+    }
+    CDF[numValues] = 1.0f;
+    return integral;
+}
+
+static double computeMaxCDFError(const std::vector<float> &CDF, const std::vector<long double> &exactPrefix) {
+    long double total = exactPrefix.back();
+    double maxError = 0.0;
+    for (uint32_t i = 0; i < CDF.size(); ++i)
+        maxError = std::max(maxError, static_cast<double>(std::fabs(CDF[i] - exactPrefix[i] / total)));
+    return maxError;
+}
+
+static const uint32_t testSizes[] = { 1, 2, 16383, 16384, 16385, (1 << 20) + 7, 1 << 22 };
+
+
+
+// JP: ブロックの境界をまたぐ要素数で、倍精度のプレフィックス和が参照値と一致することを確認する。
+// EN: Check that the double-precision prefix sum matches the reference with numbers of values across block boundaries.
+VLR_TEST(PrefixSum_MatchesExactReference) {
+    for (ValuePattern pattern : valuePatterns) {
+        for (uint32_t numValues : testSizes) {
+            std::vector<float> values = createValues(pattern, numValues, numValues);
+            std::vector<long double> exactPrefix = computeExactPrefixSum(values);
+            std::vector<double> prefix(numValues + 1);
+            double total = parallelExclusivePrefixSum(numValues, [&](uint32_t i) { return values[i]; }, prefix.data());
+
+            double maxRelError = 0.0;
+            for (uint32_t i = 0; i <= numValues; ++i)
+                maxRelError = std::max(maxRelError, static_cast<double>(std::fabs(prefix[i] - exactPrefix[i]) / exactPrefix.back()));
+            VLR_CHECK(prefix[0] == 0.0 && total == prefix[numValues], "%s n=%u: wrong first or last entry",
+                      getValuePatternName(pattern), numValues);
+            VLR_CHECK(maxRelError < 1e-14, "%s n=%u: max relative error %g",
+                      getValuePatternName(pattern), numValues, maxRelError);
+        }
+    }
+}
+
+// JP: 区分定数分布と離散分布のCDFの誤差が、並列化前の逐次の結果より悪くならず、floatへの丸め程度に収まることを確認する。
+// EN: Check that the error of the CDFs of piecewise constant and discrete distributions isn't worse than the serial result
+//     before parallelization and stays at the level of rounding to float.
+VLR_TEST(PrefixSum_CDFErrorNotWorseThanSerial) {
+    // JP: [0, 1]の値をfloatに丸めた誤差の上限に余裕を持たせたもの。
+    // EN: Bound of the error of rounding a value in [0, 1] to float, with some margin.
+    const double roundingErrorBound = 2.0 * std::numeric_limits<float>::epsilon();
+    for (ValuePattern pattern : valuePatterns) {
+        for (uint32_t numValues : testSizes) {
+            std::vector<float> values = createValues(pattern, numValues, numValues);
+            std::vector<long double> exactPrefix = computeExactPrefixSum(values);
+            long double exactIntegral = exactPrefix.back() / numValues;
+
+            std::vector<float> PDF(numValues);
+            std::vector<float> serialCDF(numValues + 1);
+            float serialIntegral = computeSerialRegularConstantCDF(values, PDF.data(), serialCDF.data());
+            double serialError = computeMaxCDFError(serialCDF, exactPrefix);
+
+            std::vector<float> CDF(numValues + 1);
+            float integral = computeRegularConstantCDF(values.data(), numValues, PDF.data(), CDF.data());
+            double error = computeMaxCDFError(CDF, exactPrefix);
+            VLR_CHECK(error <= std::max(serialError, roundingErrorBound),
+                      "%s n=%u: CDF error %g (serial %g)", getValuePatternName(pattern), numValues, error, serialError);
+            VLR_CHECK(std::fabs(integral - exactIntegral) <= std::fabs(serialIntegral - exactIntegral) + 1e-7L * exactIntegral,
+                      "%s n=%u: integral %.9g (serial %.9g, exact %.9Lg)",
+                      getValuePatternName(pattern), numValues, integral, serialIntegral, exactIntegral);
+
+            std::vector<float> PMF(numValues);
+            std::vector<float> discreteCDF(numValues + 1);
+            computeDiscreteCDF(values.data(), numValues, PMF.data(), discreteCDF.data());
+            double discreteError = computeMaxCDFError(discreteCDF, exactPrefix);
+            VLR_CHECK(discreteError <= roundingErrorBound, "%s n=%u: discrete CDF error %g",
+                      getValuePatternName(pattern), numValues, discreteError);
+        }
+    }
+}
+
+// JP: 逐次の構築と並列プレフィックス和による構築の時間とCDFの誤差を比較する。
+// EN: Compare the time and CDF error of the serial construction and the construction by parallel prefix sum.
+VLR_BENCHMARK(PrefixSum_vs_Serial) {
+    const uint32_t sizes[] = { 1 << 16, 1 << 20, 1 << 24, 1 << 26 };
+    for (uint32_t numValues : sizes) {
+        if (isQuickRun() && numValues > (1 << 16))
+            break;
+        for (ValuePattern pattern : valuePatterns) {
+            std::vector<float> values = createValues(pattern, numValues, 11);
+            std::vector<long double> exactPrefix = computeExactPrefixSum(values);
+
+            std::vector<float> PDF(numValues);
+            std::vector<float> serialCDF(numValues + 1);
+            std::vector<float> CDF(numValues + 1);
+            double serialTime = measureBestTime(3, [&]() {
+                computeSerialRegularConstantCDF(values, PDF.data(), serialCDF.data());
+            });
+            double parallelTime = measureBestTime(3, [&]() {
+                computeRegularConstantCDF(values.data(), numValues, PDF.data(), CDF.data());
+            });
+
+            printf("  n = %9u, %-13s: serial %8.3f [ms] (max error %.2e), parallel %8.3f [ms] (max error %.2e)\n",
+                   numValues, getValuePatternName(pattern),
+                   serialTime * 1e3, computeMaxCDFError(serialCDF, exactPrefix),
+                   parallelTime * 1e3, computeMaxCDFError(CDF, exactPrefix));
+        }
+    }
+}
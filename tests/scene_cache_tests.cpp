@@ -0,0 +1,192 @@
+#include "test_common.h"
+
+// JP: シーンキャッシュのテストはassimpが見つかった場合のみビルドされる(tests/CMakeLists.txt)。
+// EN: Tests of the scene cache are built only when assimp is found (tests/CMakeLists.txt).
+#if defined(VLR_TESTS_WITH_ASSIMP)
+
+#include "scene_cache.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+
+using namespace vlrtest;
+
+// JP: construct()と同じ読み込みフラグ。
+// EN: Same loading flags as construct().
+static constexpr uint32_t importFlags = aiProcess_Triangulate | aiProcess_CalcTangentSpace;
+
+// JP: gridSize x gridSizeの四角形のグリッドをnumObjects個並べた合成シーンをOBJで書き出す。
+//     各オブジェクトはassimpで別のメッシュとノードになる。
+// EN: Write a synthetic scene of numObjects grids of gridSize x gridSize quads as OBJ.
+//     Each object becomes a separate mesh and node in assimp.
+static std::filesystem::path writeSyntheticScene(const std::filesystem::path &dirPath,
+                                                 uint32_t numObjects, uint32_t gridSize) {
+    std::filesystem::create_directories(dirPath);
+    std::filesystem::path filePath = dirPath / "synthetic.obj";
+    std::ofstream ofs(filePath);
+    uint32_t numVertsPerRow = gridSize + 1;
+    uint32_t vertexBase = 1;
+    for (uint32_t o = 0; o < numObjects; ++o) {
+        ofs << "o object" << o << "\n";
+        for (uint32_t y = 0; y < numVertsPerRow; ++y) {
+            for (uint32_t x = 0; x < numVertsPerRow; ++x) {
+                float u = static_cast<float>(x) / gridSize;
+                float v = static_cast<float>(y) / gridSize;
+                ofs << "v " << (o + u) << " " << 0.1f * std::sin(8 * u + o) << " " << v << "\n";
+                ofs << "vt " << u << " " << v << "\n";
+                ofs << "vn 0 1 0\n";
+            }
+        }
+        for (uint32_t y = 0; y < gridSize; ++y) {
+            for (uint32_t x = 0; x < gridSize; ++x) {
+                uint32_t i00 = vertexBase + y * numVertsPerRow + x;
+                uint32_t i10 = i00 + 1;
+                uint32_t i01 = i00 + numVertsPerRow;
+                uint32_t i11 = i01 + 1;
+                ofs << "f " << i00 << "/" << i00 << "/" << i00 << " "
+                    << i01 << "/" << i01 << "/" << i01 << " "
+                    << i11 << "/" << i11 << "/" << i11 << " "
+                    << i10 << "/" << i10 << "/" << i10 << "\n";
+            }
+        }
+        vertexBase += numVertsPerRow * numVertsPerRow;
+    }
+    return filePath;
+}
+
+// JP: assimpで読み込み、キャッシュが保持する形式に変換する。construct()のキャッシュが無い場合の処理に相当する。
+// EN: Import with assimp and convert into the form the cache holds. Corresponds to construct() without a cache.
+static const aiScene* importScene(Assimp::Importer &importer, const std::filesystem::path &filePath,
+                                  std::vector<std::vector<vlr::Vertex>>* vertices,
+                                  std::vector<std::vector<uint32_t>>* indices,
+                                  std::vector<MeshGeometryView>* geometries) {
+    const aiScene* scene = importer.ReadFile(filePath.string(), importFlags);
+    if (!scene)
+        return nullptr;
+    vertices->resize(scene->mNumMeshes);
+    indices->resize(scene->mNumMeshes);
+    geometries->resize(scene->mNumMeshes);
+    for (uint32_t m = 0; m < scene->mNumMeshes; ++m) {
+        const aiMesh* mesh = scene->mMeshes[m];
+        if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+            convertMeshGeometry(mesh, &(*vertices)[m], &(*indices)[m]);
+        MeshGeometryView &geom = (*geometries)[m];
+        geom.vertices = (*vertices)[m].data();
+        geom.numVertices = static_cast<uint32_t>((*vertices)[m].size());
+        geom.indices = (*indices)[m].data();
+        geom.numIndices = static_cast<uint32_t>((*indices)[m].size());
+    }
+    return scene;
+}
+
+static uint32_t countNodes(const aiNode* node) {
+    uint32_t count = 1;
+    for (uint32_t c = 0; c < node->mNumChildren; ++c)
+        count += countNodes(node->mChildren[c]);
+    return count;
+}
+
+// JP: キャッシュから復元した階層、マテリアル数と、マップしたファイルを指すジオメトリが
+//     assimpで読み込んで変換した結果とビット単位で一致することを確認する。
+// EN: Check that the hierarchy and the number of materials restored from the cache, and the geometry pointing into
+//     the mapped file match the result imported with assimp and converted, bit for bit.
+VLR_TEST(SceneCache_RoundTrip) {
+    const std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "vlr_scene_cache_tests";
+    std::filesystem::path filePath = writeSyntheticScene(dirPath, 5, 7);
+    setSceneCacheDirectory(dirPath / "cache");
+
+    Assimp::Importer importer;
+    std::vector<std::vector<vlr::Vertex>> vertices;
+    std::vector<std::vector<uint32_t>> indices;
+    std::vector<MeshGeometryView> geometries;
+    const aiScene* scene = importScene(importer, filePath, &vertices, &indices, &geometries);
+    VLR_CHECK(scene != nullptr, "failed to import %s", filePath.string().c_str());
+    if (scene) {
+        storeSceneCache(filePath.string(), false, false, scene, geometries.data());
+
+        CachedScene cachedScene;
+        bool cacheRead = readSceneCache(filePath.string(), false, false, &cachedScene);
+        VLR_CHECK(cacheRead, "failed to read the cache just stored");
+        if (cacheRead) {
+            const aiScene* restored = cachedScene.scene.get();
+            VLR_CHECK(restored->mNumMeshes == scene->mNumMeshes && restored->mNumMaterials == scene->mNumMaterials,
+                      "%u / %u meshes, %u / %u materials",
+                      restored->mNumMeshes, scene->mNumMeshes, restored->mNumMaterials, scene->mNumMaterials);
+            VLR_CHECK(countNodes(restored->mRootNode) == countNodes(scene->mRootNode), "node hierarchy differs");
+            for (uint32_t m = 0; m < std::min(restored->mNumMeshes, scene->mNumMeshes); ++m) {
+                const MeshGeometryView &a = cachedScene.geometries[m];
+                const MeshGeometryView &b = geometries[m];
+                VLR_CHECK(a.numVertices == b.numVertices && a.numIndices == b.numIndices &&
+                          std::memcmp(a.vertices, b.vertices, sizeof(vlr::Vertex) * b.numVertices) == 0 &&
+                          std::memcmp(a.indices, b.indices, sizeof(uint32_t) * b.numIndices) == 0,
+                          "geometry of mesh %u differs", m);
+            }
+        }
+    }
+
+    setSceneCacheDirectory("");
+    std::error_code ec;
+    std::filesystem::remove_all(dirPath, ec);
+}
+
+// JP: 合成シーンについて、assimpでの読み込みと変換、キャッシュの読み込みの時間を比較する。
+// EN: Compare the time of import and conversion with assimp and the time of loading the cache for synthetic scenes.
+VLR_BENCHMARK(SceneCache_LoadVsImport) {
+    const std::filesystem::path dirPath = std::filesystem::temp_directory_path() / "vlr_scene_cache_bench";
+    const struct {
+        uint32_t numObjects;
+        uint32_t gridSize;
+    } sizes[] = {
+        { 16, 32 },
+        { 64, 128 },
+        { 256, 128 },
+    };
+    const uint32_t numRepeats = isQuickRun() ? 1 : 3;
+    for (const auto &size : sizes) {
+        if (isQuickRun() && size.gridSize > 32)
+            break;
+        std::filesystem::path filePath = writeSyntheticScene(dirPath, size.numObjects, size.gridSize);
+        setSceneCacheDirectory(dirPath / "cache");
+
+        uint32_t numTriangles = 0;
+        double importTime = measureBestTime(numRepeats, [&]() {
+            Assimp::Importer importer;
+            std::vector<std::vector<vlr::Vertex>> vertices;
+            std::vector<std::vector<uint32_t>> indices;
+            std::vector<MeshGeometryView> geometries;
+            const aiScene* scene = importScene(importer, filePath, &vertices, &indices, &geometries);
+            if (!scene)
+                return;
+            numTriangles = 0;
+            for (const MeshGeometryView &geom : geometries)
+                numTriangles += geom.numIndices / 3;
+        });
+
+        // JP: キャッシュの書き出しは計測に含めない。
+        // EN: Writing the cache isn't included in the measurement.
+        {
+            Assimp::Importer importer;
+            std::vector<std::vector<vlr::Vertex>> vertices;
+            std::vector<std::vector<uint32_t>> indices;
+            std::vector<MeshGeometryView> geometries;
+            if (const aiScene* scene = importScene(importer, filePath, &vertices, &indices, &geometries))
+                storeSceneCache(filePath.string(), false, false, scene, geometries.data());
+        }
+
+        bool cacheRead = false;
+        double cacheTime = measureBestTime(numRepeats, [&]() {
+            CachedScene cachedScene;
+            cacheRead = readSceneCache(filePath.string(), false, false, &cachedScene);
+        });
+        VLR_CHECK(cacheRead, "failed to read the cache");
+
+        printf("  %4u objects, %9u triangles: assimp %9.2f [ms], cache %8.2f [ms] (x%.1f)\n",
+               size.numObjects, numTriangles, importTime * 1e+3, cacheTime * 1e+3, importTime / cacheTime);
+    }
+
+    setSceneCacheDirectory("");
+    std::error_code ec;
+    std::filesystem::remove_all(dirPath, ec);
+}
+
+#endif // #if defined(VLR_TESTS_WITH_ASSIMP)
@@ -0,0 +1,98 @@
+#include "test_common.h"
+#include "scene_geometry_tracker.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: ジオメトリグループとジオメトリインスタンスを整数で表す。差分はシーンのイベントと同じくstd::setで渡す。
+// EN: Represent geometry groups and geometry instances by integers.
+//     Deltas are passed as std::set, the same as events of the scene.
+using Tracker = SceneGeometryTracker<uint32_t, uint32_t>;
+
+static std::set<uint32_t> toSet(const std::unordered_set<uint32_t> &s) {
+    return std::set<uint32_t>(s.cbegin(), s.cend());
+}
+
+// JP: setupの後の状態を再現する。
+// EN: Reproduce the state after setup.
+static void clearDirty(Tracker &tracker) {
+    for (uint32_t geomGroup : tracker.getDirtyGeometryASes())
+        tracker.clearChildrenDirty(geomGroup);
+    tracker.clearDirtyGeometryInstances();
+    tracker.clearDirtyGeometryASes();
+}
+
+// JP: ジオメトリの更新は、更新されたジオメトリインスタンスとトランスフォームパスが至るGASだけをdirtyにする。
+//     複数のGASに共有されるジオメトリインスタンスの更新は、親達を通じて届いたパスのGASだけをdirtyにする。
+// EN: A geometry update marks only the updated geometry instances and the GAS the transform path reaches as dirty.
+//     An update of a geometry instance shared by multiple GASes marks only the GASes of the paths
+//     it arrives through via its parents.
+VLR_TEST(SceneGeometryTracker_UpdateMarksOnlyAffectedGAS) {
+    const uint32_t groupA = 1, groupB = 2, groupC = 3;
+    Tracker tracker;
+    std::vector<uint32_t> newGeomInsts;
+    tracker.addChildren(groupA, std::set<uint32_t>({ 10, 11 }), &newGeomInsts);
+    tracker.addChildren(groupB, std::set<uint32_t>({ 20 }), &newGeomInsts);
+    tracker.addChildren(groupC, std::set<uint32_t>({ 10, 30 }), &newGeomInsts);
+    VLR_CHECK(newGeomInsts == std::vector<uint32_t>({ 10, 11, 20, 30 }), "unexpected new geometry instances");
+    VLR_CHECK(toSet(tracker.getDirtyGeometryASes()) == std::set<uint32_t>({ groupA, groupB, groupC }),
+              "all GASes are dirty after addition");
+    clearDirty(tracker);
+
+    tracker.updateChildren(groupA, std::set<uint32_t>({ 11 }));
+    VLR_CHECK(toSet(tracker.getDirtyGeometryASes()) == std::set<uint32_t>({ groupA }), "GASes other than A are dirty");
+    VLR_CHECK(toSet(tracker.getDirtyGeometryInstances()) == std::set<uint32_t>({ 11 }),
+              "geometry instances other than the updated one are dirty");
+    VLR_CHECK(tracker.childrenAreDirty(groupA) && !tracker.childrenAreDirty(groupB) && !tracker.childrenAreDirty(groupC),
+              "children of unaffected GASes are marked dirty");
+    clearDirty(tracker);
+
+    tracker.updateChildren(groupA, std::set<uint32_t>({ 10 }));
+    tracker.updateChildren(groupC, std::set<uint32_t>({ 10 }));
+    VLR_CHECK(toSet(tracker.getDirtyGeometryASes()) == std::set<uint32_t>({ groupA, groupC }),
+              "updating the shared geometry instance marks B dirty or misses A / C");
+    VLR_CHECK(toSet(tracker.getDirtyGeometryInstances()) == std::set<uint32_t>({ 10 }),
+              "geometry instances other than the updated one are dirty");
+    VLR_CHECK(!tracker.childrenAreDirty(groupB), "children of B are marked dirty");
+}
+
+// JP: 同じジオメトリグループに至る複数のトランスフォームパスと、複数のGASに共有されるジオメトリインスタンスの参照数。
+//     GASは全てのパスが外れた時点で削除され、ジオメトリインスタンスは全てのGASから外れた時点で削除される。
+// EN: Reference counts for multiple transform paths reaching the same geometry group,
+//     and for a geometry instance shared by multiple GASes.
+//     A GAS is removed when all the paths are gone, and a geometry instance is removed
+//     when it has left all the GASes.
+VLR_TEST(SceneGeometryTracker_ReferenceCounts) {
+    const uint32_t groupA = 1, groupC = 3;
+    const std::set<uint32_t> childrenA = { 10, 11 };
+    Tracker tracker;
+    std::vector<uint32_t> newGeomInsts;
+    bool isNew = tracker.addChildren(groupA, childrenA, &newGeomInsts);
+    VLR_CHECK(isNew && newGeomInsts.size() == 2, "first path to A");
+    newGeomInsts.clear();
+    isNew = tracker.addChildren(groupA, childrenA, &newGeomInsts);
+    VLR_CHECK(!isNew && newGeomInsts.empty(), "second path to A creates something");
+    VLR_CHECK(tracker.getChildren(groupA).size() == 2 && *tracker.getChildren(groupA).find(10) == 2,
+              "children of A aren't counted per path");
+    tracker.addChildren(groupC, std::set<uint32_t>({ 10 }), &newGeomInsts);
+    VLR_CHECK(newGeomInsts.empty(), "shared geometry instance is created again");
+    clearDirty(tracker);
+
+    // JP: 一方のパスを外してもGASの子は変わらない。
+    // EN: Removing one of the paths doesn't change the children of the GAS.
+    std::vector<uint32_t> removedGeomInsts;
+    bool isRemoved;
+    uint32_t numRemovedChildren = tracker.removeChildren(groupA, childrenA, &removedGeomInsts, &isRemoved);
+    VLR_CHECK(numRemovedChildren == 0 && removedGeomInsts.empty() && !isRemoved, "removing the first path to A");
+    VLR_CHECK(tracker.getDirtyGeometryASes().empty(), "A is dirty although its children don't change");
+
+    numRemovedChildren = tracker.removeChildren(groupA, childrenA, &removedGeomInsts, &isRemoved);
+    VLR_CHECK(numRemovedChildren == 2 && isRemoved && !tracker.contains(groupA), "removing the last path to A");
+    VLR_CHECK(removedGeomInsts == std::vector<uint32_t>({ 11 }), "geometry instance still in C is removed");
+    VLR_CHECK(tracker.getDirtyGeometryASes().count(groupA) == 0, "removed GAS stays dirty");
+    VLR_CHECK(tracker.getChildren(groupC).contains(10), "shared geometry instance left C");
+
+    removedGeomInsts.clear();
+    tracker.removeChildren(groupC, std::set<uint32_t>({ 10 }), &removedGeomInsts, &isRemoved);
+    VLR_CHECK(removedGeomInsts == std::vector<uint32_t>({ 10 }) && isRemoved, "removing the last reference");
+}
@@ -0,0 +1,142 @@
+#include "test_common.h"
+#include "swap_remove_containers.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: Scene::GeometryASの子と同様に、キーごとに参照数を持つSwapRemoveMapを参照実装と比較する。
+// EN: Compare a SwapRemoveMap holding a reference count per key, like children of Scene::GeometryAS,
+//     with a reference implementation.
+static bool checkConsistency(const SwapRemoveMap<uint32_t, uint32_t> &map, const std::map<uint32_t, uint32_t> &reference) {
+    if (map.size() != reference.size())
+        return false;
+    std::set<uint32_t> visitedKeys;
+    for (uint32_t i = 0; i < map.size(); ++i) {
+        uint32_t key = map.keyAt(i);
+        auto it = reference.find(key);
+        if (it == reference.cend() || it->second != map.valueAt(i) || !visitedKeys.insert(key).second)
+            return false;
+        if (!map.contains(key))
+            return false;
+    }
+    return true;
+}
+
+// JP: 子の追加、参照数の変更、ランダムな順番での削除を繰り返し、位置と値が常に一致することを確認する。
+// EN: Repeat addition of children, changes of reference counts and removal in random order,
+//     and check that positions and values always stay consistent.
+VLR_TEST(SwapRemoveContainers_RandomEdits) {
+    SwapRemoveMap<uint32_t, uint32_t> map;
+    std::map<uint32_t, uint32_t> reference;
+    std::vector<uint32_t> liveKeys;
+    std::mt19937 rng(24);
+    std::uniform_int_distribution<uint32_t> opDist(0, 9);
+
+    const uint32_t numOps = 100000;
+    uint32_t nextKey = 0;
+    uint32_t numInconsistencies = 0;
+    for (uint32_t op = 0; op < numOps; ++op) {
+        uint32_t opType = opDist(rng);
+        if (liveKeys.empty() || opType < 4) {
+            uint32_t key = nextKey++;
+            map.add(key, 1);
+            reference[key] = 1;
+            liveKeys.push_back(key);
+        }
+        else if (opType < 7) {
+            // JP: 参照数の増減。0になったら削除する。
+            // EN: Increment or decrement the reference count. Remove the key when it reaches 0.
+            uint32_t liveIdx = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(liveKeys.size()) - 1)(rng);
+            uint32_t key = liveKeys[liveIdx];
+            uint32_t* referenceCount = map.find(key);
+            if (referenceCount == nullptr) {
+                ++numInconsistencies;
+                continue;
+            }
+            if (opType == 4) {
+                ++*referenceCount;
+                ++reference[key];
+            }
+            else if (--*referenceCount == 0) {
+                map.remove(key);
+                reference.erase(key);
+                liveKeys[liveIdx] = liveKeys.back();
+                liveKeys.pop_back();
+            }
+            else {
+                --reference[key];
+            }
+        }
+        else {
+            uint32_t liveIdx = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(liveKeys.size()) - 1)(rng);
+            uint32_t key = liveKeys[liveIdx];
+            map.remove(key);
+            reference.erase(key);
+            liveKeys[liveIdx] = liveKeys.back();
+            liveKeys.pop_back();
+            if (map.contains(key) || map.find(key) != nullptr)
+                ++numInconsistencies;
+        }
+
+        if (op % 1000 == 0 && !checkConsistency(map, reference))
+            ++numInconsistencies;
+    }
+    VLR_CHECK(numInconsistencies == 0, "%u inconsistencies in %u operations", numInconsistencies, numOps);
+    VLR_CHECK(checkConsistency(map, reference), "final state doesn't match the reference");
+
+    // JP: 全て削除した後は空になる。
+    // EN: The map becomes empty after removing everything.
+    for (uint32_t key : liveKeys)
+        map.remove(key);
+    VLR_CHECK(map.empty(), "%u keys remain after removing all", map.size());
+    VLR_CHECK(map.find(0) == nullptr, "removed key is still found");
+}
+
+// JP: 削除は末尾の要素をその位置に移し、それ以外の要素の位置は変えない。
+// EN: Removal moves the last element into its position, and doesn't change positions of other elements.
+VLR_TEST(SwapRemoveContainers_SwapsWithLast) {
+    SwapRemoveSet<uint32_t> set;
+    for (uint32_t i = 0; i < 5; ++i)
+        set.add(10 + i);
+
+    uint32_t index = set.remove(11);
+    VLR_CHECK(index == 1 && set[1] == 14 && set.indexOf(14) == 1, "last element isn't moved into the removed position");
+    VLR_CHECK(set[0] == 10 && set[2] == 12 && set[3] == 13 && set.size() == 4, "other elements moved");
+
+    index = set.remove(13);
+    VLR_CHECK(index == 3 && set.size() == 3 && set.indexOf(13) == SwapRemoveSet<uint32_t>::InvalidIndex,
+              "removing the last element");
+    VLR_CHECK(set.getElements() == std::vector<uint32_t>({ 10, 14, 12 }), "unexpected order after removal");
+}
+
+// JP: n個の子をランダムな順番で一つずつ削除するコストを、以前のstd::find + eraseと比較する。
+// EN: Compare the cost of removing n children one by one in random order with the previous std::find + erase.
+VLR_BENCHMARK(SwapRemoveContainers_vs_FindErase) {
+    const uint32_t sizes[] = { 1000, 10000, 100000 };
+    for (uint32_t numChildren : sizes) {
+        if (isQuickRun() && numChildren > 1000)
+            break;
+        std::vector<uint32_t> removalOrder(numChildren);
+        for (uint32_t i = 0; i < numChildren; ++i)
+            removalOrder[i] = i;
+        std::shuffle(removalOrder.begin(), removalOrder.end(), std::mt19937(numChildren));
+
+        double findEraseTime = measureBestTime(3, [&]() {
+            std::vector<uint32_t> children;
+            for (uint32_t i = 0; i < numChildren; ++i)
+                children.push_back(i);
+            for (uint32_t key : removalOrder)
+                children.erase(std::find(children.cbegin(), children.cend(), key));
+        });
+        double swapRemoveTime = measureBestTime(3, [&]() {
+            SwapRemoveSet<uint32_t> children;
+            for (uint32_t i = 0; i < numChildren; ++i)
+                children.add(i);
+            for (uint32_t key : removalOrder)
+                children.remove(key);
+        });
+
+        printf("  n = %6u: find + erase %9.3f [ms], swap-remove %7.3f [ms] (x%.1f)\n",
+               numChildren, findEraseTime * 1e3, swapRemoveTime * 1e3, findEraseTime / swapRemoveTime);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "shared/common_internal.h"
+
+#include <cstdarg>
+
+// JP: libVLRのCPU側アルゴリズム用の最小限のテスト・ベンチマーク登録機構。
+//     VLR_TESTは常に、VLR_BENCHMARKは--benchmark指定時のみ実行される。
+// EN: Minimal test/benchmark registration for CPU-side algorithms of libVLR.
+//     VLR_TEST always runs, while VLR_BENCHMARK runs only when --benchmark is specified.
+
+namespace vlrtest {
+    using TestFunction = void (*)();
+
+    struct TestEntry {
+        const char* name;
+        TestFunction function;
+        bool isBenchmark;
+    };
+
+    std::vector<TestEntry> &getTestEntries();
+
+    struct TestRegistrar {
+        TestRegistrar(const char* name, TestFunction function, bool isBenchmark) {
+            getTestEntries().push_back(TestEntry{ name, function, isBenchmark });
+        }
+    };
+
+    void reportFailure(const char* file, int32_t line, const char* fmt, ...);
+
+    // JP: ベンチマークの問題サイズ。--quick指定時は小さくする(ctestでの動作確認用)。
+    // EN: Problem size of benchmarks. Reduced when --quick is specified (for smoke runs from ctest).
+    bool isQuickRun();
+
+    inline double getElapsedSeconds(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // JP: 関数を繰り返し実行し、最速の実行時間[s]を返す。
+    // EN: Run the function repeatedly and return the fastest execution time in seconds.
+    template <typename Func>
+    double measureBestTime(uint32_t numRepeats, Func &&func) {
+        double bestTime = std::numeric_limits<double>::infinity();
+        for (uint32_t i = 0; i < numRepeats; ++i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            func();
+            bestTime = std::min(bestTime, getElapsedSeconds(start));
+        }
+        return bestTime;
+    }
+}
+
+#define VLR_TEST(Name) \
+    static void Name(); \
+    static vlrtest::TestRegistrar Name ## _registrar(#Name, Name, false); \
+    static void Name()
+
+#define VLR_BENCHMARK(Name) \
+    static void Name(); \
+    static vlrtest::TestRegistrar Name ## _registrar(#Name, Name, true); \
+    static void Name()
+
+#define VLR_CHECK(expr, fmt, ...) \
+    do { \
+        if (!(expr)) \
+            vlrtest::reportFailure(__FILE__, __LINE__, "%s: " fmt, #expr, ##__VA_ARGS__); \
+    } while (0)
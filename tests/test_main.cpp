@@ -0,0 +1,68 @@
+#include "test_common.h"
+
+namespace vlrtest {
+    static uint32_t s_numFailures = 0;
+    static bool s_quickRun = false;
+
+    std::vector<TestEntry> &getTestEntries() {
+        static std::vector<TestEntry> entries;
+        return entries;
+    }
+
+    void reportFailure(const char* file, int32_t line, const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        char str[4096];
+        vsnprintf(str, sizeof(str), fmt, args);
+        va_end(args);
+        printf("  FAILED %s(%d): %s\n", file, line, str);
+        ++s_numFailures;
+    }
+
+    bool isQuickRun() {
+        return s_quickRun;
+    }
+}
+
+// JP: 使い方: VLRTests [--benchmark] [--quick] [名前の部分文字列...]
+// EN: Usage: VLRTests [--benchmark] [--quick] [name substrings...]
+int32_t main(int32_t argc, const char* argv[]) {
+    using namespace vlrtest;
+
+    bool runBenchmarks = false;
+    std::vector<std::string> filters;
+    for (int32_t i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--benchmark")
+            runBenchmarks = true;
+        else if (arg == "--quick")
+            s_quickRun = true;
+        else
+            filters.push_back(arg);
+    }
+
+    uint32_t numRuns = 0;
+    uint32_t numFailedEntries = 0;
+    for (const TestEntry &entry : getTestEntries()) {
+        if (entry.isBenchmark && !runBenchmarks)
+            continue;
+        if (!filters.empty()) {
+            bool match = false;
+            for (const std::string &filter : filters)
+                match |= std::string(entry.name).find(filter) != std::string::npos;
+            if (!match)
+                continue;
+        }
+
+        printf("[%s] %s\n", entry.isBenchmark ? "BENCH" : "TEST ", entry.name);
+        uint32_t numFailuresBefore = s_numFailures;
+        entry.function();
+        ++numRuns;
+        if (s_numFailures != numFailuresBefore)
+            ++numFailedEntries;
+    }
+
+    printf("%u/%u passed.\n", numRuns - numFailedEntries, numRuns);
+
+    return numFailedEntries == 0 ? 0 : 1;
+}
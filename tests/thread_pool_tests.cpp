@@ -0,0 +1,96 @@
+#include "test_common.h"
+#include "thread_pool.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: [begin, end)の各要素がちょうど一度だけ処理されることを確認する。
+// EN: Check that every element of [begin, end) is processed exactly once.
+static void checkCoverage(ThreadPool &threadPool, uint32_t begin, uint32_t end, uint32_t grainSize) {
+    std::vector<std::atomic<uint32_t>> counts(end);
+    for (std::atomic<uint32_t> &count : counts)
+        count = 0;
+    std::atomic<uint32_t> numBadChunks = 0;
+    threadPool.parallelFor(begin, end, grainSize, [&](uint32_t chunkBegin, uint32_t chunkEnd) {
+        if (chunkBegin >= chunkEnd || chunkBegin < begin || chunkEnd > end)
+            ++numBadChunks;
+        for (uint32_t i = chunkBegin; i < chunkEnd; ++i)
+            ++counts[i];
+    });
+    VLR_CHECK(numBadChunks == 0, "[%u, %u) grain %u", begin, end, grainSize);
+    for (uint32_t i = 0; i < end; ++i) {
+        uint32_t expected = i >= begin ? 1 : 0;
+        if (counts[i] != expected) {
+            VLR_CHECK(counts[i] == expected, "[%u, %u) grain %u: element %u processed %u times",
+                      begin, end, grainSize, i, counts[i].load());
+            break;
+        }
+    }
+}
+
+VLR_TEST(ThreadPool_Coverage) {
+    const uint32_t threadCounts[] = { 1, 2, 4, 8 };
+    for (uint32_t numThreads : threadCounts) {
+        ThreadPool threadPool(numThreads);
+        checkCoverage(threadPool, 0, 0, 1);
+        checkCoverage(threadPool, 5, 5, 1);
+        checkCoverage(threadPool, 0, 1, 1);
+        checkCoverage(threadPool, 0, 1000, 0);
+        checkCoverage(threadPool, 0, 1000, 1);
+        checkCoverage(threadPool, 0, 1000, 7);
+        checkCoverage(threadPool, 13, 1000, 64);
+        checkCoverage(threadPool, 0, 1000, 1000);
+        checkCoverage(threadPool, 0, 1000, 5000);
+        checkCoverage(threadPool, 0, 1 << 20, 4096);
+    }
+}
+
+VLR_TEST(ThreadPool_NestedCallRunsSerially) {
+    ThreadPool threadPool(4);
+    const uint32_t numOuter = 64;
+    const uint32_t numInner = 256;
+    std::vector<std::atomic<uint32_t>> counts(numOuter * numInner);
+    for (std::atomic<uint32_t> &count : counts)
+        count = 0;
+    threadPool.parallelFor(0, numOuter, 1, [&](uint32_t outerBegin, uint32_t outerEnd) {
+        for (uint32_t o = outerBegin; o < outerEnd; ++o) {
+            threadPool.parallelFor(0, numInner, 16, [&, o](uint32_t innerBegin, uint32_t innerEnd) {
+                for (uint32_t i = innerBegin; i < innerEnd; ++i)
+                    ++counts[o * numInner + i];
+            });
+        }
+    });
+    uint32_t numWrong = 0;
+    for (std::atomic<uint32_t> &count : counts)
+        numWrong += count != 1;
+    VLR_CHECK(numWrong == 0, "%u elements not processed exactly once", numWrong);
+}
+
+VLR_TEST(ThreadPool_ConcurrentCallers) {
+    ThreadPool threadPool(4);
+    const uint32_t numCallers = 4;
+    const uint32_t numElements = 100000;
+    std::vector<uint64_t> sums(numCallers, 0);
+    std::vector<std::thread> callers;
+    for (uint32_t c = 0; c < numCallers; ++c) {
+        callers.emplace_back([&, c]() {
+            for (uint32_t rep = 0; rep < 20; ++rep) {
+                std::atomic<uint64_t> sum = 0;
+                threadPool.parallelFor(0, numElements, 1000, [&](uint32_t begin, uint32_t end) {
+                    uint64_t localSum = 0;
+                    for (uint32_t i = begin; i < end; ++i)
+                        localSum += i;
+                    sum += localSum;
+                });
+                sums[c] += sum;
+            }
+        });
+    }
+    for (std::thread &caller : callers)
+        caller.join();
+
+    const uint64_t expected = 20 * (static_cast<uint64_t>(numElements) * (numElements - 1) / 2);
+    for (uint32_t c = 0; c < numCallers; ++c)
+        VLR_CHECK(sums[c] == expected, "caller %u: %llu != %llu", c,
+                  static_cast<unsigned long long>(sums[c]), static_cast<unsigned long long>(expected));
+}
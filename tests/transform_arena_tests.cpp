@@ -0,0 +1,247 @@
+#include "test_common.h"
+#include "transform_arena.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: 平行移動、回転、スケールを組み合わせたランダムなアフィン変換とその逆行列を作る。
+// EN: Create a random affine transform combining translation, rotation and scaling, and its inverse.
+static void createRandomTransform(std::mt19937 &rng, Matrix4x4* matrix, Matrix4x4* invMatrix) {
+    std::uniform_real_distribution<float> u01;
+    Vector3D t(20 * u01(rng) - 10, 20 * u01(rng) - 10, 20 * u01(rng) - 10);
+    Vector3D axis(u01(rng) - 0.5f, u01(rng) - 0.5f, u01(rng) - 0.5f);
+    if (axis.x == 0 && axis.y == 0 && axis.z == 0)
+        axis = Vector3D(0, 0, 1);
+    float angle = 2 * VLR_M_PI * u01(rng);
+    Vector3D s(0.5f + 1.5f * u01(rng), 0.5f + 1.5f * u01(rng), 0.5f + 1.5f * u01(rng));
+    *matrix = translate(t) * rotate(angle, axis) * scale(s);
+    *invMatrix = scale(1.0f / s.x, 1.0f / s.y, 1.0f / s.z) * rotate(-angle, axis) * translate(-t);
+}
+
+// JP: アリーナのエントリーに対応するテスト側の記録。
+// EN: Test-side record corresponding to an arena entry.
+struct ReferenceEntry {
+    Matrix4x4 localMatrix;
+    Matrix4x4 localInvMatrix;
+    uint32_t nextIndex;
+    uint32_t level;
+    uint32_t numReferrers;
+    bool isAlive;
+};
+
+// JP: 連鎖を直接たどってローカル行列の積を倍精度で計算する。
+//     M = L_i * L_next * ... , M^-1 = ... * L_next^-1 * L_i^-1
+// EN: Directly walk the chain and compute the product of local matrices in double precision.
+//     M = L_i * L_next * ... , M^-1 = ... * L_next^-1 * L_i^-1
+static void computeChainProduct(const std::vector<ReferenceEntry> &reference, uint32_t index,
+                                double matrix[4][4], double invMatrix[4][4]) {
+    const auto multiply = [](const double a[4][4], const double b[4][4], double dst[4][4]) {
+        double temp[4][4];
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                double sum = 0;
+                for (int k = 0; k < 4; ++k)
+                    sum += a[r][k] * b[k][c];
+                temp[r][c] = sum;
+            }
+        }
+        std::memcpy(dst, temp, sizeof(temp));
+    };
+    const auto toDouble = [](const Matrix4x4 &m, double dst[4][4]) {
+        for (int r = 0; r < 4; ++r)
+            for (int c = 0; c < 4; ++c)
+                dst[r][c] = m[c][r];
+    };
+
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            matrix[r][c] = r == c ? 1 : 0;
+            invMatrix[r][c] = r == c ? 1 : 0;
+        }
+    }
+    for (uint32_t i = index; i != SHTransformArena::InvalidIndex; i = reference[i].nextIndex) {
+        double local[4][4];
+        double localInv[4][4];
+        toDouble(reference[i].localMatrix, local);
+        toDouble(reference[i].localInvMatrix, localInv);
+        multiply(matrix, local, matrix);
+        multiply(localInv, invMatrix, invMatrix);
+    }
+}
+
+// JP: 生きている全エントリーの解決済み行列を連鎖の積と比較し、許容誤差を超えたエントリー数を返す。
+// EN: Compare resolved matrices of all alive entries with the chain products,
+//     and return the number of entries exceeding the tolerance.
+static uint32_t countMismatches(const SHTransformArena &arena, const std::vector<ReferenceEntry> &reference) {
+    const auto isClose = [](const Matrix4x4 &m, const double ref[4][4]) {
+        double maxAbs = 0;
+        double maxDiff = 0;
+        for (int r = 0; r < 4; ++r) {
+            for (int c = 0; c < 4; ++c) {
+                maxAbs = std::max(maxAbs, std::fabs(ref[r][c]));
+                maxDiff = std::max(maxDiff, std::fabs(m[c][r] - ref[r][c]));
+            }
+        }
+        return maxDiff <= 1e-4 * (1 + maxAbs);
+    };
+
+    uint32_t numMismatches = 0;
+    for (uint32_t i = 0; i < reference.size(); ++i) {
+        if (!reference[i].isAlive)
+            continue;
+        double matrix[4][4];
+        double invMatrix[4][4];
+        computeChainProduct(reference, i, matrix, invMatrix);
+        if (!isClose(arena.getResolvedMatrix(i), matrix) ||
+            !isClose(arena.getResolvedInverseMatrix(i), invMatrix))
+            ++numMismatches;
+    }
+    return numMismatches;
+}
+
+static uint32_t allocateEntry(SHTransformArena &arena, std::vector<ReferenceEntry> &reference, std::mt19937 &rng,
+                              uint32_t nextIndex) {
+    ReferenceEntry entry;
+    createRandomTransform(rng, &entry.localMatrix, &entry.localInvMatrix);
+    entry.nextIndex = nextIndex;
+    entry.level = 0;
+    entry.numReferrers = 0;
+    entry.isAlive = true;
+    if (nextIndex != SHTransformArena::InvalidIndex) {
+        entry.level = reference[nextIndex].level + 1;
+        ++reference[nextIndex].numReferrers;
+    }
+
+    uint32_t index = arena.allocate(entry.localMatrix, entry.localInvMatrix, nextIndex);
+    if (index >= reference.size())
+        reference.resize(index + 1);
+    reference[index] = entry;
+    return index;
+}
+
+static void releaseEntry(SHTransformArena &arena, std::vector<ReferenceEntry> &reference, uint32_t index) {
+    ReferenceEntry &entry = reference[index];
+    if (entry.nextIndex != SHTransformArena::InvalidIndex)
+        --reference[entry.nextIndex].numReferrers;
+    entry.isAlive = false;
+    arena.release(index);
+}
+
+// JP: 連鎖の根の変更が深い段まで伝わり、解放したスロットが別の段のエントリーとして再利用されても正しく解決されることを確認する。
+// EN: Check that a change of a chain root propagates to deep levels,
+//     and that a released slot reused as an entry at a different level is resolved correctly.
+VLR_TEST(SHTransformArena_ChainAndSlotReuse) {
+    SHTransformArena arena;
+    std::vector<ReferenceEntry> reference;
+    std::mt19937 rng(23);
+
+    uint32_t root = allocateEntry(arena, reference, rng, SHTransformArena::InvalidIndex);
+    uint32_t middle = allocateEntry(arena, reference, rng, root);
+    uint32_t leaf = allocateEntry(arena, reference, rng, middle);
+    arena.resolve();
+    VLR_CHECK(countMismatches(arena, reference) == 0, "initial chain");
+
+    createRandomTransform(rng, &reference[root].localMatrix, &reference[root].localInvMatrix);
+    arena.setLocalMatrix(root, reference[root].localMatrix, reference[root].localInvMatrix);
+    arena.resolve();
+    VLR_CHECK(countMismatches(arena, reference) == 0, "after changing the root");
+
+    createRandomTransform(rng, &reference[middle].localMatrix, &reference[middle].localInvMatrix);
+    arena.setLocalMatrix(middle, reference[middle].localMatrix, reference[middle].localInvMatrix);
+    arena.resolve();
+    VLR_CHECK(countMismatches(arena, reference) == 0, "after changing the middle");
+
+    // JP: 段2だったスロットを段1(root直下)のエントリーとして再利用する。
+    // EN: Reuse the slot at level 2 as an entry at level 1 (directly under the root).
+    releaseEntry(arena, reference, leaf);
+    uint32_t reused = allocateEntry(arena, reference, rng, root);
+    VLR_CHECK(reused == leaf, "released slot %u isn't reused (got %u)", leaf, reused);
+    arena.resolve();
+    VLR_CHECK(countMismatches(arena, reference) == 0, "after reusing a slot at a shallower level");
+
+    // JP: 逆に段0のスロットを再利用して深い連鎖の末端にする。
+    // EN: Conversely, reuse a slot at level 0 as the end of a deep chain.
+    uint32_t otherRoot = allocateEntry(arena, reference, rng, SHTransformArena::InvalidIndex);
+    releaseEntry(arena, reference, otherRoot);
+    uint32_t deep = allocateEntry(arena, reference, rng, reused);
+    deep = allocateEntry(arena, reference, rng, deep);
+    VLR_CHECK(reference[deep].level == 3, "unexpected level %u", reference[deep].level);
+    arena.resolve();
+    VLR_CHECK(countMismatches(arena, reference) == 0, "after reusing a slot at a deeper level");
+
+    // JP: 変更が無い場合のresolve()は結果を変えない。
+    // EN: resolve() without changes doesn't alter the results.
+    Matrix4x4 before = arena.getResolvedMatrix(deep);
+    arena.resolve();
+    Matrix4x4 after = arena.getResolvedMatrix(deep);
+    VLR_CHECK(std::memcmp(&before, &after, sizeof(Matrix4x4)) == 0, "resolve() without changes altered a matrix");
+}
+
+// JP: 確保、ローカル行列の変更、(参照されていないエントリーの)解放をランダムに繰り返し、
+//     定期的に全エントリーの解決済み行列を連鎖の積と比較する。
+//     段内の並列処理も通るように、根の数を少なくして浅い段を広くする。
+// EN: Randomly repeat allocation, changes of local matrices and release (of unreferenced entries),
+//     and periodically compare resolved matrices of all entries with the chain products.
+//     Keep the number of roots small so that shallow levels become wide and go through the parallel path as well.
+VLR_TEST(SHTransformArena_RandomEdits) {
+    SHTransformArena arena;
+    std::vector<ReferenceEntry> reference;
+    std::vector<uint32_t> aliveIndices;
+    std::mt19937 rng(2023);
+    std::uniform_int_distribution<uint32_t> opDist(0, 9);
+    const uint32_t maxLevel = 6;
+
+    const auto pickAlive = [&]() {
+        return aliveIndices[std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(aliveIndices.size()) - 1)(rng)];
+    };
+
+    const uint32_t numRounds = 20;
+    const uint32_t numOpsPerRound = 2000;
+    uint32_t numMismatchingRounds = 0;
+    uint32_t numReusedSlots = 0;
+    uint32_t maxLevelWidth = 0;
+    for (uint32_t round = 0; round < numRounds; ++round) {
+        for (uint32_t op = 0; op < numOpsPerRound; ++op) {
+            uint32_t opType = opDist(rng);
+            if (aliveIndices.size() < 16 || opType < 5) {
+                uint32_t nextIndex = SHTransformArena::InvalidIndex;
+                if (!aliveIndices.empty() && opDist(rng) != 0) {
+                    nextIndex = pickAlive();
+                    while (reference[nextIndex].level >= maxLevel)
+                        nextIndex = reference[nextIndex].nextIndex;
+                }
+                uint32_t prevNumEntries = static_cast<uint32_t>(reference.size());
+                uint32_t index = allocateEntry(arena, reference, rng, nextIndex);
+                if (index < prevNumEntries)
+                    ++numReusedSlots;
+                aliveIndices.push_back(index);
+            }
+            else if (opType < 8) {
+                uint32_t index = pickAlive();
+                createRandomTransform(rng, &reference[index].localMatrix, &reference[index].localInvMatrix);
+                arena.setLocalMatrix(index, reference[index].localMatrix, reference[index].localInvMatrix);
+            }
+            else {
+                uint32_t aliveIdx = std::uniform_int_distribution<uint32_t>(0, static_cast<uint32_t>(aliveIndices.size()) - 1)(rng);
+                uint32_t index = aliveIndices[aliveIdx];
+                if (reference[index].numReferrers > 0)
+                    continue;
+                releaseEntry(arena, reference, index);
+                aliveIndices[aliveIdx] = aliveIndices.back();
+                aliveIndices.pop_back();
+            }
+        }
+
+        arena.resolve();
+        if (countMismatches(arena, reference) > 0)
+            ++numMismatchingRounds;
+        uint32_t levelWidths[maxLevel + 1] = {};
+        for (uint32_t index : aliveIndices)
+            ++levelWidths[reference[index].level];
+        for (uint32_t width : levelWidths)
+            maxLevelWidth = std::max(maxLevelWidth, width);
+    }
+    VLR_CHECK(numMismatchingRounds == 0, "%u of %u rounds have mismatching matrices", numMismatchingRounds, numRounds);
+    VLR_CHECK(numReusedSlots > 0, "no slot has been reused");
+    VLR_CHECK(maxLevelWidth >= 4096, "the widest level (%u entries) doesn't exercise the parallel path", maxLevelWidth);
+}
@@ -0,0 +1,214 @@
+#include "test_common.h"
+#include "triangle_setup.h"
+
+using namespace vlr;
+using namespace vlrtest;
+
+// JP: 起伏のあるグリッド状の合成メッシュ。(gridSize + 1)^2頂点、2 * gridSize^2三角形。
+// EN: Synthetic grid mesh with undulation. (gridSize + 1)^2 vertices and 2 * gridSize^2 triangles.
+struct GridMesh {
+    std::vector<Point3D> positions;
+    std::vector<uint32_t> indices;
+};
+
+static GridMesh createGridMesh(uint32_t gridSize) {
+    GridMesh mesh;
+    uint32_t numVertsPerRow = gridSize + 1;
+    mesh.positions.resize(static_cast<size_t>(numVertsPerRow) * numVertsPerRow);
+    ThreadPool::getShared().parallelFor(
+        0, numVertsPerRow, 1,
+        [&](uint32_t rowBegin, uint32_t rowEnd) {
+        for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+            for (uint32_t x = 0; x < numVertsPerRow; ++x) {
+                float fx = static_cast<float>(x) / gridSize;
+                float fy = static_cast<float>(y) / gridSize;
+                mesh.positions[static_cast<size_t>(y) * numVertsPerRow + x] =
+                    Point3D(fx, 0.1f * std::sin(40 * fx) * std::cos(30 * fy), fy);
+            }
+        }
+    });
+    mesh.indices.resize(6 * static_cast<size_t>(gridSize) * gridSize);
+    ThreadPool::getShared().parallelFor(
+        0, gridSize, 1,
+        [&](uint32_t rowBegin, uint32_t rowEnd) {
+        for (uint32_t y = rowBegin; y < rowEnd; ++y) {
+            for (uint32_t x = 0; x < gridSize; ++x) {
+                uint32_t v00 = y * numVertsPerRow + x;
+                uint32_t v10 = v00 + 1;
+                uint32_t v01 = v00 + numVertsPerRow;
+                uint32_t v11 = v01 + 1;
+                uint32_t* dst = &mesh.indices[6 * (static_cast<size_t>(y) * gridSize + x)];
+                dst[0] = v00; dst[1] = v01; dst[2] = v10;
+                dst[3] = v10; dst[4] = v01; dst[5] = v11;
+            }
+        }
+    });
+    return mesh;
+}
+
+// JP: 並列化前の逐次のセットアップ。
+// EN: Serial setup before parallelization.
+static void setupTrianglesSerial(const GridMesh &mesh, shared::Triangle* dstTriangles, float* areas, BoundingBox3D* aabb) {
+    uint32_t numTriangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+    *aabb = BoundingBox3D();
+    for (uint32_t i = 0; i < numTriangles; ++i) {
+        uint32_t i0 = mesh.indices[3 * i + 0];
+        uint32_t i1 = mesh.indices[3 * i + 1];
+        uint32_t i2 = mesh.indices[3 * i + 2];
+        dstTriangles[i] = shared::Triangle{ i0, i1, i2 };
+        const Point3D &p0 = mesh.positions[i0];
+        const Point3D &p1 = mesh.positions[i1];
+        const Point3D &p2 = mesh.positions[i2];
+        areas[i] = 0.5f * cross(p1 - p0, p2 - p0).length();
+        aabb->unify(p0).unify(p1).unify(p2);
+    }
+}
+
+static bool operator==(const BoundingBox3D &a, const BoundingBox3D &b) {
+    return a.minP.x == b.minP.x && a.minP.y == b.minP.y && a.minP.z == b.minP.z &&
+        a.maxP.x == b.maxP.x && a.maxP.y == b.maxP.y && a.maxP.z == b.maxP.z;
+}
+
+
+
+// JP: チャンクの境界をまたぐ三角形数で、並列のセットアップが逐次の結果と一致することを確認する。
+// EN: Check that the parallel setup matches the serial result with numbers of triangles across chunk boundaries.
+VLR_TEST(TriangleSetup_MatchesSerial) {
+    const uint32_t gridSizes[] = { 1, 181, 182, 500 };
+    for (uint32_t gridSize : gridSizes) {
+        GridMesh mesh = createGridMesh(gridSize);
+        uint32_t numTriangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+
+        std::vector<shared::Triangle> refTriangles(numTriangles);
+        std::vector<float> refAreas(numTriangles);
+        BoundingBox3D refAabb;
+        setupTrianglesSerial(mesh, refTriangles.data(), refAreas.data(), &refAabb);
+
+        std::vector<shared::Triangle> triangles(numTriangles);
+        std::vector<float> areas(numTriangles);
+        BoundingBox3D aabb;
+        setupTriangles(mesh.indices.data(), numTriangles,
+                       [&](uint32_t index) { return mesh.positions[index]; },
+                       triangles.data(), areas.data(), &aabb);
+
+        bool trianglesMatch = std::memcmp(triangles.data(), refTriangles.data(), sizeof(shared::Triangle) * numTriangles) == 0;
+        VLR_CHECK(trianglesMatch, "grid %u: packed triangles differ", gridSize);
+        VLR_CHECK(areas == refAreas, "grid %u: areas differ", gridSize);
+        VLR_CHECK(aabb == refAabb, "grid %u: AABBs differ", gridSize);
+    }
+}
+
+// JP: 同じ頂点数でsetVertices()を呼んだ場合の更新経路を再現する。
+//     コンパクト形式に変換済みのバッファーを新しい頂点で上書きし、頂点位置から三角形の面積とAABBを求め直す。
+//     位置のオフセットとスケールが新しい頂点から求め直され、結果が新しい頂点から一から作った場合と一致することを確認する。
+// EN: Reproduce the update path of setVertices() called with the same number of vertices.
+//     Overwrite the buffer already converted to the compact format with new vertices,
+//     then recompute the triangle areas and the AABB from the vertex positions.
+//     Check that the position offset and scale are derived again from the new vertices,
+//     and that the result matches the one built from scratch with the new vertices.
+VLR_TEST(TriangleSetup_CompactVertexUpdate) {
+    GridMesh mesh = createGridMesh(300);
+    uint32_t numVertices = static_cast<uint32_t>(mesh.positions.size());
+    uint32_t numTriangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+
+    std::vector<Vertex> vertices(numVertices);
+    for (uint32_t i = 0; i < numVertices; ++i) {
+        vertices[i].position = mesh.positions[i];
+        vertices[i].normal = Normal3D(0, 1, 0);
+        vertices[i].tc0Direction = Vector3D(1, 0, 0);
+        vertices[i].texCoord = TexCoord2D(mesh.positions[i].x, mesh.positions[i].z);
+    }
+    std::vector<shared::CompactVertex> compactVertices(numVertices);
+    Point3D positionOffset;
+    Vector3D positionScale;
+    encodeCompactVertices(vertices.data(), numVertices, compactVertices.data(), &positionOffset, &positionScale);
+    const Point3D prevPositionOffset = positionOffset;
+
+    // JP: メッシュのAABBが変わるように頂点を動かして差し替える。
+    // EN: Move the vertices so that the AABB of the mesh changes, then replace them.
+    std::vector<Point3D> newPositions(numVertices);
+    for (uint32_t i = 0; i < numVertices; ++i) {
+        const Point3D &p = mesh.positions[i];
+        newPositions[i] = Point3D(3 * p.x + 5, 2 * p.y - 1 + 0.5f * p.x * p.z, 0.5f * p.z);
+        vertices[i].position = newPositions[i];
+    }
+    encodeCompactVertices(vertices.data(), numVertices, compactVertices.data(), &positionOffset, &positionScale);
+
+    std::vector<shared::CompactVertex> freshVertices(numVertices);
+    Point3D freshPositionOffset;
+    Vector3D freshPositionScale;
+    encodeCompactVertices(vertices.data(), numVertices, freshVertices.data(), &freshPositionOffset, &freshPositionScale);
+    VLR_CHECK(positionOffset.x != prevPositionOffset.x, "position offset isn't derived again");
+    VLR_CHECK(std::memcmp(&positionOffset, &freshPositionOffset, sizeof(Point3D)) == 0 &&
+              std::memcmp(&positionScale, &freshPositionScale, sizeof(Vector3D)) == 0,
+              "position offset / scale differ from the ones built from scratch");
+    VLR_CHECK(std::memcmp(compactVertices.data(), freshVertices.data(), sizeof(shared::CompactVertex) * numVertices) == 0,
+              "updated vertices differ from the ones built from scratch");
+
+    // JP: 量子化の誤差の範囲で、新しい頂点位置の面積とAABBになる。
+    // EN: The areas and the AABB become those of the new vertex positions within the quantization error.
+    std::vector<float> areas(numTriangles);
+    BoundingBox3D aabb;
+    setupTriangles(mesh.indices.data(), numTriangles,
+                   [&](uint32_t index) {
+                       return shared::decodeCompactVertexPosition(compactVertices[index], positionOffset, positionScale);
+                   },
+                   nullptr, areas.data(), &aabb);
+    std::vector<float> refAreas(numTriangles);
+    BoundingBox3D refAabb;
+    setupTriangles(mesh.indices.data(), numTriangles,
+                   [&](uint32_t index) { return newPositions[index]; },
+                   nullptr, refAreas.data(), &refAabb);
+
+    Vector3D step = positionScale / 32767.0f;
+    Vector3D minDiff = aabb.minP - refAabb.minP;
+    Vector3D maxDiff = aabb.maxP - refAabb.maxP;
+    VLR_CHECK(std::fabs(minDiff.x) <= step.x && std::fabs(minDiff.y) <= step.y && std::fabs(minDiff.z) <= step.z &&
+              std::fabs(maxDiff.x) <= step.x && std::fabs(maxDiff.y) <= step.y && std::fabs(maxDiff.z) <= step.z,
+              "AABB differs beyond the quantization step");
+    double sumAreas = 0;
+    double sumRefAreas = 0;
+    for (uint32_t i = 0; i < numTriangles; ++i) {
+        sumAreas += areas[i];
+        sumRefAreas += refAreas[i];
+    }
+    VLR_CHECK(std::fabs(sumAreas - sumRefAreas) <= 1e-3 * sumRefAreas,
+              "total area %g differs from %g", sumAreas, sumRefAreas);
+}
+
+// JP: 5000万三角形の合成メッシュで、マテリアルグループのセットアップを逐次と並列で比較する。
+//     参考として、インジェスト経路で移動により省いたインデックスのコピー1回分の時間も示す。
+// EN: Compare serial and parallel material group setup on a synthetic 50M-triangle mesh.
+//     For reference, also show the time of one copy of the indices, which the ingestion path now saves by moving.
+VLR_BENCHMARK(TriangleSetup_50MTriangles) {
+    uint32_t gridSize = isQuickRun() ? 256 : 5000;
+    GridMesh mesh = createGridMesh(gridSize);
+    uint32_t numTriangles = static_cast<uint32_t>(mesh.indices.size() / 3);
+
+    std::vector<shared::Triangle> triangles(numTriangles);
+    std::vector<float> areas(numTriangles);
+    BoundingBox3D aabb;
+    double serialTime = measureBestTime(3, [&]() {
+        setupTrianglesSerial(mesh, triangles.data(), areas.data(), &aabb);
+    });
+    double parallelTime = measureBestTime(3, [&]() {
+        setupTriangles(mesh.indices.data(), numTriangles,
+                       [&](uint32_t index) { return mesh.positions[index]; },
+                       triangles.data(), areas.data(), &aabb);
+    });
+
+    double copyTime = measureBestTime(3, [&]() {
+        std::vector<uint32_t> copied = mesh.indices;
+        return copied.back();
+    });
+    double moveTime = measureBestTime(3, [&]() {
+        std::vector<uint32_t> moved = std::move(mesh.indices);
+        mesh.indices = std::move(moved);
+    });
+
+    printf("  %u triangles, %u threads: setup serial %8.2f [ms], parallel %8.2f [ms] (%.2fx), "
+           "index copy %7.2f [ms], move %.4f [ms]\n",
+           numTriangles, ThreadPool::getShared().getNumThreads(),
+           serialTime * 1e3, parallelTime * 1e3, serialTime / parallelTime,
+           copyTime * 1e3, moveTime * 1e3);
+}